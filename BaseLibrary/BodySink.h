@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: BodySink.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+using uchar = unsigned char;
+
+// Receiver of the body of an incoming HTTP message, while it is being read.
+// A site handler that opts in (SiteHandler::GetBodySink) gets the body in
+// the chunks as they are read from the network, instead of a complete
+// copy of the body in the FileBuffer of the HTTPMessage.
+// This keeps the memory of very large uploads bounded.
+//
+// The sink is owned by the HTTPMessage it is installed upon
+// and is destroyed together with the message, or when the message is
+// reset for the answer. HTTPMessage::DetachBodySink takes it over.
+
+class BodySink
+{
+public:
+  virtual ~BodySink() = default;
+
+  // Next chunk of the body. Return false to stop receiving the body
+  virtual bool OnBodyChunk(const uchar* p_data,size_t p_length) = 0;
+  // All of the body has been read (p_complete) or the reading was aborted
+  // Return false if the body as a whole could not be handled
+  virtual bool OnBodyEnd(bool p_complete) = 0;
+};
@@ -77,8 +77,14 @@ FileBuffer::FileBuffer(FileBuffer& p_orig)
                     ,DUPLICATE_SAME_ACCESS);
   }
 
+  // If it had a shared buffer, share it as well
+  if(p_orig.m_shared)
+  {
+    m_shared = p_orig.m_shared;
+    m_buffer = p_orig.m_buffer;
+  }
   // If it had a buffer, duplicate it
-  if(m_binaryLength)
+  else if(m_binaryLength)
   {
     m_buffer = new uchar[m_binaryLength + 2];
     memcpy(m_buffer,p_orig.m_buffer,m_binaryLength);
@@ -109,11 +115,7 @@ void
 FileBuffer::Reset()
 {
   // Free one buffer
-  if(m_buffer)
-  {
-    delete [] m_buffer;
-    m_buffer = NULL;
-  }
+  FreeBuffer();
   // Free buffer parts
   for(const auto& part : m_parts)
   {
@@ -246,6 +248,20 @@ FileBuffer::AddStringToBuffer(XString p_string,XString p_charset,bool p_crlf/*=t
 #endif
 }
 
+// Send a shared immutable buffer without copying it
+// The buffer stays alive as long as this FileBuffer (or a copy) needs it
+void
+FileBuffer::SetSharedBuffer(SharedBuffer p_shared)
+{
+  Reset();
+  if(p_shared && !p_shared->empty())
+  {
+    m_shared       = p_shared;
+    m_buffer       = const_cast<uchar*>(p_shared->data());
+    m_binaryLength = p_shared->size();
+  }
+}
+
 // Allocate a one-buffer block
 bool    
 FileBuffer::AllocateBuffer(size_t p_length)
@@ -314,7 +330,7 @@ FileBuffer::GetBufferCopy(uchar*& p_buffer,size_t& p_length)
       p_buffer = nullptr;
       return false;
     }
-    memcpy(p_buffer,m_buffer,p_length + 2);
+    memcpy(p_buffer,m_buffer,p_length);
   }
   else 
   {
@@ -412,10 +428,7 @@ FileBuffer::ReadFile()
     goto cleanup;
   }
   // Delete old buffer and create a new one
-  if(m_buffer)
-  {
-    delete [] m_buffer;
-  }
+  FreeBuffer();
   m_buffer = new uchar[m_binaryLength + 2];
 
   // Read file from disk in one (1) go
@@ -444,10 +457,9 @@ cleanup:
   m_file = NULL;
 
   // In case of error: free again
-  if(!result && m_buffer)
+  if(!result)
   {
-    delete [] m_buffer;
-    m_buffer = NULL;
+    FreeBuffer();
   }
   return result;
 }
@@ -528,8 +540,14 @@ FileBuffer::operator=(FileBuffer& p_orig)
                    ,DUPLICATE_SAME_ACCESS);
   }
   
+  // If it had a shared buffer, share it as well
+  if(p_orig.m_shared)
+  {
+    m_shared = p_orig.m_shared;
+    m_buffer = p_orig.m_buffer;
+  }
   // If it had a buffer, duplicate it
-  if(m_binaryLength)
+  else if(m_binaryLength)
   {
     m_buffer = new uchar[m_binaryLength + 2];
     memcpy(m_buffer,p_orig.m_buffer,m_binaryLength);
@@ -562,6 +580,13 @@ FileBuffer::operator=(FileBuffer& p_orig)
 bool
 FileBuffer::ZipBuffer()
 {
+  // A shared buffer is delivered as-is by its owner
+  // It might already be a compressed variant of the content
+  if(m_shared)
+  {
+    return false;
+  }
+
   unsigned size = (unsigned) GetLength();
 
   // Do not ZIP the buffer under the compression limit
@@ -596,7 +621,7 @@ FileBuffer::ZipBuffer()
   {
     m_binaryLength = out_data.size();
   
-    delete [] m_buffer;
+    FreeBuffer();
     m_buffer = new uchar[m_binaryLength + 2];
     for(size_t ind = 0;ind < m_binaryLength; ++ind)
     {
@@ -636,7 +661,7 @@ FileBuffer::UnZipBuffer()
   {
     m_binaryLength = out_data.size();
 
-    delete [] m_buffer;
+    FreeBuffer();
     m_buffer = new uchar[m_binaryLength + 2];
     for(size_t ind = 0; ind < m_binaryLength; ++ind)
     {
@@ -649,6 +674,21 @@ FileBuffer::UnZipBuffer()
   return false;
 }
 
+// Free the one-buffer block, or release it to the shared owner
+void
+FileBuffer::FreeBuffer()
+{
+  if(m_shared)
+  {
+    m_shared.reset();
+  }
+  else if(m_buffer)
+  {
+    delete [] m_buffer;
+  }
+  m_buffer = NULL;
+}
+
 // Make sure the FileBuffer is defragemented
 bool
 FileBuffer::Defragment()
@@ -27,6 +27,7 @@
 //
 #pragma once
 #include <vector>
+#include <memory>
 
 // Max streaming serialize/de-serialize limit
 // Files bigger than this can only be putted/gotten by indirect file references
@@ -50,6 +51,10 @@ BufPart;
 
 using Parts = std::vector<BufPart>;
 
+// Immutable buffer that can be shared between many FileBuffers
+// E.g. the contents of a static file in a content cache
+using SharedBuffer = std::shared_ptr<const std::vector<uchar>>;
+
 class FileBuffer
 {
 public:
@@ -84,6 +89,8 @@ public:
   void    AddStringToBuffer(XString p_string,XString p_charset,bool p_crlf = true);
   // Allocate a one-buffer block
   bool    AllocateBuffer(size_t p_length);
+  // Send a shared immutable buffer without copying it
+  void    SetSharedBuffer(SharedBuffer p_shared);
 
   // GETTERS
 
@@ -103,6 +110,8 @@ public:
   size_t  GetLength();
   // Get resulting file handle
   HANDLE  GetFileHandle();
+  // Buffer is borrowed from a shared owner
+  bool    GetIsShared();
 
   // OPERATORS & OPERATIONS
 
@@ -118,6 +127,8 @@ public:
 private:
   // Defragment the buffer
   bool    Defragment();
+  // Free or release the one-buffer block
+  void    FreeBuffer();
 
   // Data contents of the HTTP buffer
   XString  m_fileName;     // File to receive/send
@@ -125,6 +136,7 @@ private:
   size_t   m_binaryLength  { NULL };
   uchar*   m_buffer        { nullptr };
   Parts    m_parts;
+  SharedBuffer m_shared;   // Owner of m_buffer if borrowed
 };
 
 inline bool
@@ -151,6 +163,12 @@ FileBuffer::GetFileHandle()
   return m_file;
 }
 
+inline bool
+FileBuffer::GetIsShared()
+{
+  return m_shared != nullptr;
+}
+
 inline void
 FileBuffer::ResetFilename()
 {
@@ -27,6 +27,7 @@
 //
 #include "pch.h"
 #include "HTTPMessage.h"
+#include "HTTPMessagePool.h"
 #include "SOAPMessage.h"
 #include "JSONMessage.h"
 #include "CrackURL.h"
@@ -34,6 +35,7 @@
 #include "Crypto.h"
 #include "HTTPTime.h"
 #include "MultiPartBuffer.h"
+#include "BodySink.h"
 #include <xutility>
 #include <string>
 
@@ -392,6 +394,11 @@ HTTPMessage::~HTTPMessage()
     CloseHandle(m_token);
     m_token = NULL;
   }
+  if(m_bodySink)
+  {
+    delete m_bodySink;
+    m_bodySink = nullptr;
+  }
 }
 
 // Recycle the object for usage in a return message
@@ -417,10 +424,132 @@ HTTPMessage::Reset(bool p_resetURL /*=false*/)
   m_headers.clear();
   m_routing.clear();
 
+  // A streamed body belongs to the request. It would swallow the answer
+  if(m_bodySink)
+  {
+    EndBodySink(false);
+    delete m_bodySink;
+    m_bodySink = nullptr;
+  }
+  m_bodyStreamed = 0;
+  m_sinkFailed   = false;
+  m_sinkEnded    = false;
+
   // Leave access token untouched!
   // Leave cookie cache untouched!
 }
 
+// Back to the constructed state, for the message pool
+// Strings are emptied and containers cleared, but the object is reused
+void
+HTTPMessage::Recycle()
+{
+  if(m_token)
+  {
+    CloseHandle(m_token);
+    m_token = NULL;
+  }
+  if(m_bodySink)
+  {
+    delete m_bodySink;
+    m_bodySink = nullptr;
+  }
+  m_command        = HTTPCommand::http_response;
+  m_status         = HTTP_STATUS_OK;
+  m_request        = NULL;
+  m_connectID      = NULL;
+  m_site           = nullptr;
+  m_verbTunnel     = false;
+  m_encoding       = Encoding::EN_ACP;
+  m_sendBOM        = false;
+  m_readBuffer     = false;
+  m_contentLength  = 0;
+  m_chunkNumber    = 0;
+  m_desktop        = 0;
+  m_ifmodified     = false;
+  m_references     = 1;
+  m_XMLHttpRequest = false;
+  m_bodyStreamed   = 0;
+  m_sinkFailed     = false;
+  m_sinkEnded      = false;
+  m_contentType.Empty();
+  m_acceptEncoding.Empty();
+  m_user.Empty();
+  m_password.Empty();
+  m_url.Empty();
+  m_referrer.Empty();
+  m_cracked.Reset();
+  m_buffer.Reset();
+  m_buffer.ResetFilename();
+  m_cookies.Clear();
+  m_headers.clear();
+  m_routing.clear();
+  memset(&m_sender,    0,sizeof(SOCKADDR_IN6));
+  memset(&m_receiver,  0,sizeof(SOCKADDR_IN6));
+  memset(&m_systemtime,0,sizeof(SYSTEMTIME));
+}
+
+// Install a streaming receiver for the incoming body
+// The message becomes the owner of the sink
+void
+HTTPMessage::SetBodySink(BodySink* p_sink)
+{
+  if(m_bodySink && m_bodySink != p_sink)
+  {
+    delete m_bodySink;
+  }
+  m_bodySink     = p_sink;
+  m_bodyStreamed = 0;
+  m_sinkFailed   = false;
+  m_sinkEnded    = false;
+}
+
+// Take the body sink away from the message: the caller becomes the owner
+// Use it to keep the results of the sink after a Reset for the answer
+BodySink*
+HTTPMessage::DetachBodySink()
+{
+  BodySink* sink = m_bodySink;
+  m_bodySink = nullptr;
+  return sink;
+}
+
+// Pass a body chunk on to the body sink
+// After the sink refused a chunk, the rest of the body is read but dropped
+void
+HTTPMessage::StreamBody(const uchar* p_body,size_t p_length)
+{
+  m_bodyStreamed += p_length;
+  if(m_sinkFailed || m_sinkEnded || p_length == 0)
+  {
+    return;
+  }
+  if(!m_bodySink->OnBodyChunk(p_body,p_length))
+  {
+    m_sinkFailed = true;
+  }
+}
+
+// Ending the streaming of the body to the body sink
+// Can safely be called more than once. Only the first call reaches the sink
+bool
+HTTPMessage::EndBodySink(bool p_complete)
+{
+  if(m_bodySink == nullptr)
+  {
+    return true;
+  }
+  if(!m_sinkEnded)
+  {
+    m_sinkEnded = true;
+    if(!m_bodySink->OnBodyEnd(p_complete && !m_sinkFailed))
+    {
+      m_sinkFailed = true;
+    }
+  }
+  return !m_sinkFailed;
+}
+
 // REALLY? Do you want to do this?
 // Be sure that the message is now handled by a different site!
 bool
@@ -1210,7 +1339,14 @@ HTTPMessage::DropReference()
   {
     try
     {
-      delete this;
+      if(m_pooled)
+      {
+        HTTPMessagePool::Release(this);
+      }
+      else
+      {
+        delete this;
+      }
       return true;
     }
     catch(StdException&)
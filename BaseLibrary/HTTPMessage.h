@@ -102,6 +102,7 @@ class   FileBuffer;
 class   HTTPServer;
 class   HTTPSite;
 class   MultiPartBuffer;
+class   BodySink;
 
 class HTTPMessage
 {
@@ -156,6 +157,7 @@ public:
   void SetHasBeenAnswered()                     { m_request            = NULL;        }
   void SetChunkNumber(int p_chunk)              { m_chunkNumber        = p_chunk;     }
   void SetXMLHttpRequest(boolean p_value)       { m_XMLHttpRequest     = p_value;     }
+  void SetBodySink(BodySink* p_sink);
   void SetExtension(XString p_ext,bool p_reparse = true);
   void SetReadBuffer(bool p_read,size_t p_length = 0);
   void SetSender  (PSOCKADDR_IN6 p_address);
@@ -217,6 +219,8 @@ public:
   Routing&            GetRouting()              { return m_routing;                   }
   unsigned            GetChunkNumber()          { return m_chunkNumber;               }
   boolean             GetXMLHttpRequest()       { return m_XMLHttpRequest;            }
+  BodySink*           GetBodySink()             { return m_bodySink;                  }
+  size_t              GetBodyStreamed()         { return m_bodyStreamed;              }
 
   XString             GetBody();
   size_t              GetBodyLength();
@@ -235,8 +239,12 @@ public:
   void    ResetCookies();
   // Add a body from a text field
   void    AddBody(XString p_body,XString p_charset = _T("utf-8"));
-  // Add a body from a binary BLOB
+  // Add a body from a binary BLOB (or pass it on to the body sink)
   void    AddBody(void* p_body,unsigned p_length);
+  // Ending the streaming of the body to the body sink
+  bool    EndBodySink(bool p_complete);
+  // Take the body sink away from the message. Caller becomes the owner
+  BodySink* DetachBodySink();
   // Add a header-name / header-value pair
   void    AddHeader(XString p_name,XString p_value);
   // Add a header by known header-id
@@ -265,6 +273,10 @@ public:
   HTTPMessage& operator=(const SOAPMessage& p_message);
 
 private:
+  friend class HTTPMessagePool;
+
+  // Back to the constructed state, for the message pool
+  void    Recycle();
   // TO BE CALLED FROM THE XTOR!!
   XString DecodeCharsetAndEncoding(Encoding p_encoding,XString p_contentType,XString p_defaultContentType);
   void    ConstructBodyFromString(XString p_string,XString p_charset,bool p_withBom);
@@ -276,6 +288,8 @@ private:
   void    ReparseURL();
   // Fill message with FormData buffer
   bool    SetMultiPartBuffer (MultiPartBuffer* p_buffer);
+  // Pass a body chunk on to the body sink
+  void    StreamBody(const uchar* p_body,size_t p_length);
   // Fill message with FormData URL encoding
   bool    SetMultiPartURL    (MultiPartBuffer* p_buffer);
   bool    SetMultiPartURLGet (MultiPartBuffer* p_buffer);
@@ -311,6 +325,11 @@ private:
   SYSTEMTIME          m_systemtime;                                   // System time for m_modified
   long                m_references    { 1       };                    // Referencing system
   boolean             m_XMLHttpRequest{ false   };                    // Ajax Request (Triggers CORS!)
+  BodySink*           m_bodySink      { nullptr };                    // Streaming receiver of the incoming body
+  size_t              m_bodyStreamed  { 0       };                    // Bytes passed on to the body sink
+  bool                m_sinkFailed    { false   };                    // Body sink refused a chunk
+  bool                m_sinkEnded     { false   };                    // Body sink has been ended
+  bool                m_pooled        { false   };                    // Returns to the HTTPMessagePool
 };
 
 inline void 
@@ -352,6 +371,11 @@ HTTPMessage::AddBody(XString p_buffer,XString p_charset /*=_T("utf-8")*/)
 inline void 
 HTTPMessage::AddBody(void* p_body,unsigned p_length)
 {
+  if(m_bodySink)
+  {
+    StreamBody(reinterpret_cast<uchar*>(p_body),p_length);
+    return;
+  }
   m_buffer.AddBuffer(reinterpret_cast<uchar*>(p_body),p_length);
 }
 
@@ -0,0 +1,226 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPMessagePool.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "pch.h"
+#include "HTTPMessagePool.h"
+#include "AutoCritical.h"
+#include <vector>
+#include <atomic>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+using PooledMessages = std::vector<HTTPMessage*>;
+
+static std::atomic<bool>    g_poolEnabled   { true };
+static std::atomic<__int64> g_poolAcquired  { 0    };
+static std::atomic<__int64> g_poolAllocated { 0    };
+
+// Shared list between all threads
+class SharedMessages
+{
+public:
+  SharedMessages()
+  {
+    InitializeCriticalSection(&m_lock);
+    m_messages.reserve(MESSAGEPOOL_SHARED_MAX);
+  }
+  ~SharedMessages()
+  {
+    Clear();
+    DeleteCriticalSection(&m_lock);
+  }
+
+  // Move a batch of messages into the cache of a thread
+  void Take(PooledMessages& p_cache,size_t p_number)
+  {
+    AutoCritSec lock(&m_lock);
+    while(p_number-- && !m_messages.empty())
+    {
+      p_cache.push_back(m_messages.back());
+      m_messages.pop_back();
+    }
+  }
+
+  // Accept messages from the cache of a thread, above the maximum they are freed
+  void Give(PooledMessages& p_cache,size_t p_keep)
+  {
+    PooledMessages surplus;
+    {
+      AutoCritSec lock(&m_lock);
+      while(p_cache.size() > p_keep)
+      {
+        if(m_messages.size() < MESSAGEPOOL_SHARED_MAX)
+        {
+          m_messages.push_back(p_cache.back());
+        }
+        else
+        {
+          surplus.push_back(p_cache.back());
+        }
+        p_cache.pop_back();
+      }
+    }
+    // Freeing outside the lock
+    for(auto& message : surplus)
+    {
+      delete message;
+    }
+  }
+
+  void Clear()
+  {
+    PooledMessages messages;
+    {
+      AutoCritSec lock(&m_lock);
+      messages.swap(m_messages);
+    }
+    for(auto& message : messages)
+    {
+      delete message;
+    }
+  }
+
+private:
+  CRITICAL_SECTION m_lock;
+  PooledMessages   m_messages;
+};
+
+static SharedMessages&
+GetSharedMessages()
+{
+  static SharedMessages shared;
+  return shared;
+}
+
+// The cache of one thread
+// A thread that ends hands its messages back to the shared list
+class ThreadMessages
+{
+public:
+  ThreadMessages()
+  {
+    m_messages.reserve(MESSAGEPOOL_THREAD_CACHE + 1);
+  }
+  ~ThreadMessages()
+  {
+    GetSharedMessages().Give(m_messages,0);
+  }
+  PooledMessages m_messages;
+};
+
+static thread_local ThreadMessages t_messages;
+
+// Getting a message: recycled from the pool, or a new one
+HTTPMessage*
+HTTPMessagePool::Acquire(HTTPCommand p_command,HTTPSite* p_site)
+{
+  ++g_poolAcquired;
+
+  HTTPMessage* message = nullptr;
+  if(g_poolEnabled)
+  {
+    PooledMessages& cache = t_messages.m_messages;
+    if(cache.empty())
+    {
+      GetSharedMessages().Take(cache,MESSAGEPOOL_THREAD_CACHE / 2);
+    }
+    if(!cache.empty())
+    {
+      message = cache.back();
+      cache.pop_back();
+      message->m_command = p_command;
+      message->m_site    = p_site;
+      return message;
+    }
+  }
+  ++g_poolAllocated;
+  message = new HTTPMessage(p_command,p_site);
+  message->m_pooled = g_poolEnabled;
+  return message;
+}
+
+// Last reference of a pooled message was dropped
+// The reset is done here, on the releasing (worker) thread
+void
+HTTPMessagePool::Release(HTTPMessage* p_message)
+{
+  if(!g_poolEnabled)
+  {
+    delete p_message;
+    return;
+  }
+  p_message->Recycle();
+
+  PooledMessages& cache = t_messages.m_messages;
+  cache.push_back(p_message);
+  if(cache.size() > MESSAGEPOOL_THREAD_CACHE)
+  {
+    GetSharedMessages().Give(cache,MESSAGEPOOL_THREAD_CACHE / 2);
+  }
+}
+
+// Free all messages in the shared list
+// Caches of running threads are freed when the threads end
+void
+HTTPMessagePool::Clear()
+{
+  GetSharedMessages().Clear();
+}
+
+void
+HTTPMessagePool::SetEnabled(bool p_enabled)
+{
+  g_poolEnabled = p_enabled;
+  if(!p_enabled)
+  {
+    Clear();
+  }
+}
+
+bool
+HTTPMessagePool::GetEnabled()
+{
+  return g_poolEnabled;
+}
+
+__int64
+HTTPMessagePool::GetAcquired()
+{
+  return g_poolAcquired;
+}
+
+__int64
+HTTPMessagePool::GetAllocated()
+{
+  return g_poolAllocated;
+}
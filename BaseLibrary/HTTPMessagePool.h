@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPMessagePool.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////
+//
+// HTTPMESSAGE POOL
+//
+// Recycling of the HTTPMessage objects of the HTTP servers.
+// A message from the pool goes back to the pool when its last reference is
+// dropped. It is then reset to its constructed state instead of being freed.
+//
+// Every thread has a small cache of messages without any locking.
+// Messages are mostly made on the receiving thread and released on a worker
+// thread. So a full cache moves half of its messages to a shared list, and
+// an empty cache takes a batch from that list in one go.
+//
+// Usage:
+// HTTPMessage* msg = HTTPMessagePool::Acquire(HTTPCommand::http_get,site);
+// ...
+// msg->DropReference();   // Back into the pool
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "HTTPMessage.h"
+
+#define MESSAGEPOOL_THREAD_CACHE    64   // Messages in the cache of one thread
+#define MESSAGEPOOL_SHARED_MAX    4096   // Messages in the shared list of all threads
+
+class HTTPMessagePool
+{
+public:
+  // Getting a message: recycled from the pool, or a new one
+  static HTTPMessage* Acquire(HTTPCommand p_command,HTTPSite* p_site);
+  // Last reference of a pooled message was dropped
+  static void         Release(HTTPMessage* p_message);
+  // Free all messages in the shared list
+  static void         Clear();
+
+  // SETTERS
+  static void         SetEnabled(bool p_enabled);
+  // GETTERS
+  static bool         GetEnabled();
+  static __int64      GetAcquired();    // All messages handed out
+  static __int64      GetAllocated();   // Messages that had to be created
+};
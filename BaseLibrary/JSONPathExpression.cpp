@@ -0,0 +1,915 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: JSONPathExpression.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "pch.h"
+#include "JSONPathExpression.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+JSONPathExpression::JSONPathExpression(XString p_path,bool p_originOne /*= false*/)
+{
+  Compile(p_path,p_originOne);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// COMPILING
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+JSONPathExpression::Compile(XString p_path,bool p_originOne /*= false*/)
+{
+  m_path   = p_path;
+  m_origin = p_originOne ? 1 : 0;
+  m_valid  = false;
+  m_errorInfo.Empty();
+  m_steps.clear();
+  m_nodes.clear();
+
+  if(m_path.IsEmpty() || m_path.GetAt(0) != '$')
+  {
+    return SetError(_T("The path does not start with a '$'"));
+  }
+  int pos = 1;
+  while(pos < m_path.GetLength())
+  {
+    if(!CompileStep(m_path,pos))
+    {
+      return false;
+    }
+  }
+  m_valid = true;
+  return true;
+}
+
+bool
+JSONPathExpression::SetError(XString p_error)
+{
+  m_errorInfo = p_error;
+  m_valid     = false;
+  m_steps.clear();
+  m_nodes.clear();
+  return false;
+}
+
+static void
+SkipSpaces(const XString& p_string,int& p_pos)
+{
+  while(p_pos < p_string.GetLength() && _istspace(p_string.GetAt(p_pos)))
+  {
+    ++p_pos;
+  }
+}
+
+static bool
+IsNameCharacter(TCHAR p_char)
+{
+  return p_char != '.' && p_char != '[' && p_char != ']' && p_char != 0;
+}
+
+// One step: ".name", "..name", ".*", "..*", "[...]" or "..[...]"
+bool
+JSONPathExpression::CompileStep(const XString& p_path,int& p_pos)
+{
+  JPStep step;
+  TCHAR ch = p_path.GetAt(p_pos);
+
+  if(ch == '.')
+  {
+    ++p_pos;
+    if(p_pos < p_path.GetLength() && p_path.GetAt(p_pos) == '.')
+    {
+      step.m_recursive = true;
+      ++p_pos;
+    }
+    ch = p_pos < p_path.GetLength() ? (TCHAR) p_path.GetAt(p_pos) : 0;
+    if(ch == '[')
+    {
+      return CompileBracket(p_path,p_pos,step);
+    }
+    if(ch == '*')
+    {
+      ++p_pos;
+      step.m_type = JPStepType::JPS_Wildcard;
+      m_steps.push_back(step);
+      return true;
+    }
+    int start = p_pos;
+    while(p_pos < p_path.GetLength() && IsNameCharacter((TCHAR)p_path.GetAt(p_pos)))
+    {
+      ++p_pos;
+    }
+    if(p_pos == start)
+    {
+      return SetError(_T("Missing member name in the path at position: ") + XString(p_path.Mid(start - 1)));
+    }
+    step.m_type = JPStepType::JPS_Member;
+    step.m_name = p_path.Mid(start,p_pos - start);
+    m_steps.push_back(step);
+    return true;
+  }
+  if(ch == '[')
+  {
+    return CompileBracket(p_path,p_pos,step);
+  }
+  return SetError(_T("Missing delimiter in the path. Must be '.' or '[' at: ") + XString(p_path.Mid(p_pos)));
+}
+
+// Bracket subscription or a filter
+bool
+JSONPathExpression::CompileBracket(const XString& p_path,int& p_pos,JPStep& p_step)
+{
+  ++p_pos;  // Skip the '['
+  SkipSpaces(p_path,p_pos);
+
+  if(p_pos < p_path.GetLength() && p_path.GetAt(p_pos) == '?')
+  {
+    ++p_pos;
+    int filter = CompileOr(p_path,p_pos);
+    if(filter < 0)
+    {
+      return false;
+    }
+    SkipSpaces(p_path,p_pos);
+    if(p_pos >= p_path.GetLength() || p_path.GetAt(p_pos) != ']')
+    {
+      return SetError(_T("Missing ']' after the filter in: ") + p_path);
+    }
+    ++p_pos;
+    p_step.m_type   = JPStepType::JPS_Filter;
+    p_step.m_filter = filter;
+    m_steps.push_back(p_step);
+    return true;
+  }
+
+  // Find the closing bracket outside of quotes
+  int   start = p_pos;
+  TCHAR quote = 0;
+  while(p_pos < p_path.GetLength())
+  {
+    TCHAR ch = (TCHAR) p_path.GetAt(p_pos);
+    if(quote)
+    {
+      if(ch == quote)
+      {
+        quote = 0;
+      }
+    }
+    else if(ch == '\'' || ch == '\"')
+    {
+      quote = ch;
+    }
+    else if(ch == ']')
+    {
+      break;
+    }
+    ++p_pos;
+  }
+  if(p_pos >= p_path.GetLength())
+  {
+    return SetError(_T("Missing ']' in: ") + p_path);
+  }
+  XString subscript = p_path.Mid(start,p_pos - start);
+  ++p_pos;
+  return CompileSubscript(subscript,p_step);
+}
+
+static bool
+IsInteger(const XString& p_string)
+{
+  int pos = (p_string.GetAt(0) == '-' || p_string.GetAt(0) == '+') ? 1 : 0;
+  if(pos >= p_string.GetLength())
+  {
+    return false;
+  }
+  for(;pos < p_string.GetLength();++pos)
+  {
+    if(!_istdigit(p_string.GetAt(pos)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+JSONPathExpression::CompileSubscript(XString p_subscript,JPStep& p_step)
+{
+  p_subscript.Trim();
+  if(p_subscript.IsEmpty())
+  {
+    return SetError(_T("Empty subscription '[]' in: ") + m_path);
+  }
+
+  // Wildcard
+  if(p_subscript == _T("*"))
+  {
+    p_step.m_type = JPStepType::JPS_Wildcard;
+    m_steps.push_back(p_step);
+    return true;
+  }
+
+  // One or more quoted member names
+  TCHAR first = (TCHAR) p_subscript.GetAt(0);
+  if(first == '\'' || first == '\"')
+  {
+    int pos = 0;
+    while(pos < p_subscript.GetLength())
+    {
+      TCHAR quote = (TCHAR) p_subscript.GetAt(pos);
+      int end = p_subscript.Find(quote,pos + 1);
+      if((quote != '\'' && quote != '\"') || end < 0)
+      {
+        return SetError(_T("Invalid member name subscription: ") + p_subscript);
+      }
+      p_step.m_names.push_back(p_subscript.Mid(pos + 1,end - pos - 1));
+      pos = end + 1;
+      SkipSpaces(p_subscript,pos);
+      if(pos < p_subscript.GetLength())
+      {
+        if(p_subscript.GetAt(pos) != ',')
+        {
+          return SetError(_T("Invalid member name subscription: ") + p_subscript);
+        }
+        ++pos;
+        SkipSpaces(p_subscript,pos);
+      }
+    }
+    if(p_step.m_names.size() == 1)
+    {
+      p_step.m_type = JPStepType::JPS_Member;
+      p_step.m_name = p_step.m_names.front();
+      p_step.m_names.clear();
+    }
+    else
+    {
+      p_step.m_type = JPStepType::JPS_Members;
+    }
+    m_steps.push_back(p_step);
+    return true;
+  }
+
+  // Slice: [start:end:step]
+  if(p_subscript.Find(':') >= 0)
+  {
+    int count = 1;
+    for(int index = 0;index < p_subscript.GetLength();++index)
+    {
+      if(p_subscript.GetAt(index) == ':')
+      {
+        ++count;
+      }
+    }
+    if(count > 3)
+    {
+      return SetError(_T("Invalid slice: ") + p_subscript);
+    }
+    XString parts[3];
+    int first  = p_subscript.Find(':');
+    int second = count == 3 ? p_subscript.Find(':',first + 1) : -1;
+    parts[0] = p_subscript.Left(first).Trim();
+    parts[1] = (second < 0 ? p_subscript.Mid(first + 1) : p_subscript.Mid(first + 1,second - first - 1)).Trim();
+    if(second >= 0)
+    {
+      parts[2] = p_subscript.Mid(second + 1).Trim();
+    }
+    for(int index = 0;index < count;++index)
+    {
+      if(!parts[index].IsEmpty() && !IsInteger(parts[index]))
+      {
+        return SetError(_T("Invalid slice: ") + p_subscript);
+      }
+    }
+    if(!parts[0].IsEmpty())
+    {
+      p_step.m_hasStart = true;
+      p_step.m_start    = _ttoi(parts[0]);
+      p_step.m_start   -= p_step.m_start >= 0 ? m_origin : 0;
+    }
+    if(count > 1 && !parts[1].IsEmpty())
+    {
+      p_step.m_hasEnd = true;
+      p_step.m_end    = _ttoi(parts[1]);
+      p_step.m_end   -= p_step.m_end >= 0 ? m_origin : 0;
+    }
+    if(count > 2 && !parts[2].IsEmpty())
+    {
+      p_step.m_step = _ttoi(parts[2]);
+    }
+    if(p_step.m_step == 0)
+    {
+      return SetError(_T("Slice indexing is invalid: step = 0"));
+    }
+    p_step.m_type = JPStepType::JPS_Slice;
+    m_steps.push_back(p_step);
+    return true;
+  }
+
+  // Union: [n,m,o]
+  if(p_subscript.Find(',') >= 0)
+  {
+    int pos = 0;
+    while(pos >= 0)
+    {
+      int comma = p_subscript.Find(',',pos);
+      XString part = (comma < 0 ? p_subscript.Mid(pos) : p_subscript.Mid(pos,comma - pos)).Trim();
+      if(!IsInteger(part))
+      {
+        return SetError(_T("Invalid union operator: ") + p_subscript);
+      }
+      int index = _ttoi(part);
+      p_step.m_indices.push_back(index >= 0 ? index - m_origin : index);
+      pos = comma < 0 ? -1 : comma + 1;
+    }
+    p_step.m_type = JPStepType::JPS_Union;
+    m_steps.push_back(p_step);
+    return true;
+  }
+
+  // Single index
+  if(!IsInteger(p_subscript))
+  {
+    return SetError(_T("Invalid array index: ") + p_subscript);
+  }
+  int index = _ttoi(p_subscript);
+  p_step.m_type  = JPStepType::JPS_Index;
+  p_step.m_index = index >= 0 ? index - m_origin : index;
+  m_steps.push_back(p_step);
+  return true;
+}
+
+// or-expression: and-expression { '||' and-expression }
+int
+JSONPathExpression::CompileOr(const XString& p_filter,int& p_pos)
+{
+  int left = CompileAnd(p_filter,p_pos);
+  while(left >= 0)
+  {
+    SkipSpaces(p_filter,p_pos);
+    if(p_filter.Mid(p_pos,2) != _T("||"))
+    {
+      break;
+    }
+    p_pos += 2;
+    int right = CompileAnd(p_filter,p_pos);
+    if(right < 0)
+    {
+      return -1;
+    }
+    JPFilterNode node;
+    node.m_type  = JPNodeType::JPN_Or;
+    node.m_left  = left;
+    node.m_right = right;
+    m_nodes.push_back(node);
+    left = (int)m_nodes.size() - 1;
+  }
+  return left;
+}
+
+// and-expression: unary { '&&' unary }
+int
+JSONPathExpression::CompileAnd(const XString& p_filter,int& p_pos)
+{
+  int left = CompileUnary(p_filter,p_pos);
+  while(left >= 0)
+  {
+    SkipSpaces(p_filter,p_pos);
+    if(p_filter.Mid(p_pos,2) != _T("&&"))
+    {
+      break;
+    }
+    p_pos += 2;
+    int right = CompileUnary(p_filter,p_pos);
+    if(right < 0)
+    {
+      return -1;
+    }
+    JPFilterNode node;
+    node.m_type  = JPNodeType::JPN_And;
+    node.m_left  = left;
+    node.m_right = right;
+    m_nodes.push_back(node);
+    left = (int)m_nodes.size() - 1;
+  }
+  return left;
+}
+
+// unary: '!' unary | '(' or-expression ')' | '@' [.member]* [operator literal]
+int
+JSONPathExpression::CompileUnary(const XString& p_filter,int& p_pos)
+{
+  SkipSpaces(p_filter,p_pos);
+  TCHAR ch = p_pos < p_filter.GetLength() ? (TCHAR) p_filter.GetAt(p_pos) : 0;
+
+  if(ch == '!' && p_filter.GetAt(p_pos + 1) != '=')
+  {
+    ++p_pos;
+    int operand = CompileUnary(p_filter,p_pos);
+    if(operand < 0)
+    {
+      return -1;
+    }
+    JPFilterNode node;
+    node.m_type = JPNodeType::JPN_Not;
+    node.m_left = operand;
+    m_nodes.push_back(node);
+    return (int)m_nodes.size() - 1;
+  }
+  if(ch == '(')
+  {
+    ++p_pos;
+    int inner = CompileOr(p_filter,p_pos);
+    SkipSpaces(p_filter,p_pos);
+    if(inner < 0 || p_pos >= p_filter.GetLength() || p_filter.GetAt(p_pos) != ')')
+    {
+      if(inner >= 0)
+      {
+        SetError(_T("Missing ')' in filter: ") + p_filter);
+      }
+      return -1;
+    }
+    ++p_pos;
+    return inner;
+  }
+  if(ch != '@')
+  {
+    SetError(_T("Filter expression must test '@' members: ") + XString(p_filter.Mid(p_pos)));
+    return -1;
+  }
+  ++p_pos;
+
+  JPFilterNode node;
+  node.m_type = JPNodeType::JPN_Exists;
+  while(p_pos < p_filter.GetLength() && p_filter.GetAt(p_pos) == '.')
+  {
+    int start = ++p_pos;
+    while(p_pos < p_filter.GetLength() && (_istalnum(p_filter.GetAt(p_pos)) || p_filter.GetAt(p_pos) == '_' || p_filter.GetAt(p_pos) == '-'))
+    {
+      ++p_pos;
+    }
+    if(p_pos == start)
+    {
+      SetError(_T("Missing member name after '@.' in filter: ") + p_filter);
+      return -1;
+    }
+    node.m_members.push_back(p_filter.Mid(start,p_pos - start));
+  }
+
+  // Optional relational operator
+  SkipSpaces(p_filter,p_pos);
+  XString op = p_filter.Mid(p_pos,2);
+  int length = 2;
+  if     (op == _T("==")) node.m_operator = JPOperator::JPO_Equal;
+  else if(op == _T("!=")) node.m_operator = JPOperator::JPO_NotEqual;
+  else if(op == _T("<=")) node.m_operator = JPOperator::JPO_LessEqual;
+  else if(op == _T(">=")) node.m_operator = JPOperator::JPO_GreaterEqual;
+  else
+  {
+    length = 1;
+    switch(op.GetAt(0))
+    {
+      case '=': node.m_operator = JPOperator::JPO_Equal;   break;
+      case '<': node.m_operator = JPOperator::JPO_Less;    break;
+      case '>': node.m_operator = JPOperator::JPO_Greater; break;
+      default:  length = 0;                                break;
+    }
+  }
+  if(length)
+  {
+    p_pos += length;
+    node.m_type = JPNodeType::JPN_Compare;
+    if(CompileLiteral(p_filter,p_pos,node) < 0)
+    {
+      return -1;
+    }
+  }
+  else if(node.m_members.empty())
+  {
+    SetError(_T("A single '@' must be compared in filter: ") + p_filter);
+    return -1;
+  }
+  m_nodes.push_back(node);
+  return (int)m_nodes.size() - 1;
+}
+
+// Literal: 'string', "string", number, true, false, null or a bare word
+int
+JSONPathExpression::CompileLiteral(const XString& p_filter,int& p_pos,JPFilterNode& p_node)
+{
+  SkipSpaces(p_filter,p_pos);
+  TCHAR ch = p_pos < p_filter.GetLength() ? (TCHAR) p_filter.GetAt(p_pos) : 0;
+
+  if(ch == '\'' || ch == '\"')
+  {
+    int end = p_filter.Find(ch,p_pos + 1);
+    if(end < 0)
+    {
+      SetError(_T("Missing closing quote in filter: ") + p_filter);
+      return -1;
+    }
+    p_node.m_string = p_filter.Mid(p_pos + 1,end - p_pos - 1);
+    p_pos = end + 1;
+    return 0;
+  }
+
+  int start = p_pos;
+  while(p_pos < p_filter.GetLength())
+  {
+    ch = (TCHAR) p_filter.GetAt(p_pos);
+    if(_istspace(ch) || ch == ')' || ch == ']' || ch == '&' || ch == '|')
+    {
+      break;
+    }
+    ++p_pos;
+  }
+  if(p_pos == start)
+  {
+    SetError(_T("Missing value to compare in filter: ") + p_filter);
+    return -1;
+  }
+  p_node.m_string = p_filter.Mid(start,p_pos - start);
+
+  if     (p_node.m_string == _T("true"))  p_node.m_constant = JsonConst::JSON_TRUE;
+  else if(p_node.m_string == _T("false")) p_node.m_constant = JsonConst::JSON_FALSE;
+  else if(p_node.m_string == _T("null"))  p_node.m_constant = JsonConst::JSON_NULL;
+  else
+  {
+    ch = (TCHAR) p_node.m_string.GetAt(0);
+    if(_istdigit(ch) || ch == '-' || ch == '+' || ch == '.')
+    {
+      p_node.m_number   = bcd(p_node.m_string.GetString());
+      p_node.m_isNumber = true;
+    }
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// EVALUATION
+// Depth first: no intermediate result sets are built
+//
+//////////////////////////////////////////////////////////////////////////
+
+unsigned
+JSONPathExpression::Evaluate(JSONMessage& p_message,JPResults& p_results) const
+{
+  p_results.clear();
+  if(m_valid)
+  {
+    Walk(&p_message.GetValue(),0,&p_results,nullptr);
+  }
+  return (unsigned) p_results.size();
+}
+
+JSONvalue*
+JSONPathExpression::EvaluateFirst(JSONMessage& p_message) const
+{
+  JSONvalue* first = nullptr;
+  if(m_valid)
+  {
+    Walk(&p_message.GetValue(),0,nullptr,&first);
+  }
+  return first;
+}
+
+// Returns true if evaluation can stop (first result found)
+bool
+JSONPathExpression::Walk(JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const
+{
+  if(p_step == m_steps.size())
+  {
+    if(p_first)
+    {
+      *p_first = p_value;
+      return true;
+    }
+    p_results->push_back(p_value);
+    return false;
+  }
+  if(m_steps[p_step].m_recursive)
+  {
+    return Descend(p_value,p_step,p_results,p_first);
+  }
+  return Apply(p_value,p_step,p_results,p_first);
+}
+
+// Apply a recursive step to the value and all values below it
+bool
+JSONPathExpression::Descend(JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const
+{
+  if(Apply(p_value,p_step,p_results,p_first))
+  {
+    return true;
+  }
+  if(p_value->GetDataType() == JsonType::JDT_array)
+  {
+    for(auto& value : p_value->GetArray())
+    {
+      if(Descend(&value,p_step,p_results,p_first))
+      {
+        return true;
+      }
+    }
+  }
+  else if(p_value->GetDataType() == JsonType::JDT_object)
+  {
+    for(auto& pair : p_value->GetObject())
+    {
+      if(Descend(&pair.m_value,p_step,p_results,p_first))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool
+JSONPathExpression::Apply(JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const
+{
+  const JPStep& step  = m_steps[p_step];
+  JsonType      type  = p_value->GetDataType();
+  size_t        next  = p_step + 1;
+
+  switch(step.m_type)
+  {
+    case JPStepType::JPS_Member:
+      if(type == JsonType::JDT_object)
+      {
+        for(auto& pair : p_value->GetObject())
+        {
+          if(pair.m_name.Compare(step.m_name) == 0 && Walk(&pair.m_value,next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      else if(type == JsonType::JDT_array && !step.m_recursive)
+      {
+        // Member of all the elements of the array
+        for(auto& value : p_value->GetArray())
+        {
+          if(value.GetDataType() == JsonType::JDT_object && Apply(&value,p_step,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      break;
+    case JPStepType::JPS_Members:
+      if(type == JsonType::JDT_object)
+      {
+        for(auto& name : step.m_names)
+        {
+          for(auto& pair : p_value->GetObject())
+          {
+            if(pair.m_name.Compare(name) == 0 && Walk(&pair.m_value,next,p_results,p_first))
+            {
+              return true;
+            }
+          }
+        }
+      }
+      break;
+    case JPStepType::JPS_Wildcard:
+      if(type == JsonType::JDT_array)
+      {
+        for(auto& value : p_value->GetArray())
+        {
+          if(Walk(&value,next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      else if(type == JsonType::JDT_object)
+      {
+        for(auto& pair : p_value->GetObject())
+        {
+          if(Walk(&pair.m_value,next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      else if(!step.m_recursive)
+      {
+        // Ordinal values are matched
+        return Walk(p_value,next,p_results,p_first);
+      }
+      break;
+    case JPStepType::JPS_Index:
+      if(type == JsonType::JDT_array)
+      {
+        JSONarray& array = p_value->GetArray();
+        int index = step.m_index < 0 ? (int)array.size() + step.m_index : step.m_index;
+        if(0 <= index && index < (int)array.size())
+        {
+          return Walk(&array[index],next,p_results,p_first);
+        }
+      }
+      break;
+    case JPStepType::JPS_Union:
+      if(type == JsonType::JDT_array)
+      {
+        JSONarray& array = p_value->GetArray();
+        for(int number : step.m_indices)
+        {
+          int index = number < 0 ? (int)array.size() + number : number;
+          if(0 <= index && index < (int)array.size() && Walk(&array[index],next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      break;
+    case JPStepType::JPS_Slice:
+      if(type == JsonType::JDT_array)
+      {
+        JSONarray& array = p_value->GetArray();
+        int size  = (int)array.size();
+        int start = step.m_hasStart ? step.m_start : (step.m_step > 0 ? 0 : size - 1);
+        int end   = step.m_hasEnd   ? step.m_end   : (step.m_step > 0 ? size : -size - 1);
+        if(start < 0) start += size;
+        if(end   < 0) end   += size;
+        if(step.m_step > 0)
+        {
+          if(start < 0)    start = 0;
+          if(end   > size) end   = size;
+          for(int index = start;index < end;index += step.m_step)
+          {
+            if(Walk(&array[index],next,p_results,p_first))
+            {
+              return true;
+            }
+          }
+        }
+        else
+        {
+          if(start >= size) start = size - 1;
+          if(end   < -1)    end   = -1;
+          for(int index = start;index > end;index += step.m_step)
+          {
+            if(Walk(&array[index],next,p_results,p_first))
+            {
+              return true;
+            }
+          }
+        }
+      }
+      break;
+    case JPStepType::JPS_Filter:
+      if(type == JsonType::JDT_array)
+      {
+        for(auto& value : p_value->GetArray())
+        {
+          if(Matches(step.m_filter,value) && Walk(&value,next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      else if(type == JsonType::JDT_object)
+      {
+        for(auto& pair : p_value->GetObject())
+        {
+          if(Matches(step.m_filter,pair.m_value) && Walk(&pair.m_value,next,p_results,p_first))
+          {
+            return true;
+          }
+        }
+      }
+      break;
+  }
+  return false;
+}
+
+bool
+JSONPathExpression::Matches(int p_node,JSONvalue& p_value) const
+{
+  const JPFilterNode& node = m_nodes[p_node];
+  switch(node.m_type)
+  {
+    case JPNodeType::JPN_Or:      return Matches(node.m_left,p_value) || Matches(node.m_right,p_value);
+    case JPNodeType::JPN_And:     return Matches(node.m_left,p_value) && Matches(node.m_right,p_value);
+    case JPNodeType::JPN_Not:     return !Matches(node.m_left,p_value);
+    case JPNodeType::JPN_Exists:  return FindMember(node,p_value) != nullptr;
+    case JPNodeType::JPN_Compare: { JSONvalue* member = FindMember(node,p_value);
+                                    return member && Compare(node,*member);
+                                  }
+  }
+  return false;
+}
+
+JSONvalue*
+JSONPathExpression::FindMember(const JPFilterNode& p_node,JSONvalue& p_value) const
+{
+  JSONvalue* value = &p_value;
+  for(auto& name : p_node.m_members)
+  {
+    if(value->GetDataType() != JsonType::JDT_object)
+    {
+      return nullptr;
+    }
+    JSONvalue* found = nullptr;
+    for(auto& pair : value->GetObject())
+    {
+      if(pair.m_name.Compare(name) == 0)
+      {
+        found = &pair.m_value;
+        break;
+      }
+    }
+    if(found == nullptr)
+    {
+      return nullptr;
+    }
+    value = found;
+  }
+  return value;
+}
+
+static bool
+Relate(JPOperator p_operator,int p_compare)
+{
+  switch(p_operator)
+  {
+    case JPOperator::JPO_Equal:        return p_compare == 0;
+    case JPOperator::JPO_NotEqual:     return p_compare != 0;
+    case JPOperator::JPO_Less:         return p_compare <  0;
+    case JPOperator::JPO_LessEqual:    return p_compare <= 0;
+    case JPOperator::JPO_Greater:      return p_compare >  0;
+    case JPOperator::JPO_GreaterEqual: return p_compare >= 0;
+  }
+  return false;
+}
+
+static int
+CompareNumbers(const bcd& p_left,const bcd& p_right)
+{
+  if(p_left < p_right)
+  {
+    return -1;
+  }
+  return p_left > p_right ? 1 : 0;
+}
+
+bool
+JSONPathExpression::Compare(const JPFilterNode& p_node,const JSONvalue& p_value) const
+{
+  switch(p_value.GetDataType())
+  {
+    case JsonType::JDT_string:     return p_node.m_constant == JsonConst::JSON_NONE &&
+                                          Relate(p_node.m_operator,p_value.GetString().Compare(p_node.m_string));
+    case JsonType::JDT_number_int: return p_node.m_isNumber &&
+                                          Relate(p_node.m_operator,CompareNumbers(bcd(p_value.GetNumberInt()),p_node.m_number));
+    case JsonType::JDT_number_bcd: return p_node.m_isNumber &&
+                                          Relate(p_node.m_operator,CompareNumbers(p_value.GetNumberBcd(),p_node.m_number));
+    case JsonType::JDT_const:      if(p_node.m_constant == JsonConst::JSON_NONE)
+                                   {
+                                     return false;
+                                   }
+                                   if(p_node.m_operator == JPOperator::JPO_Equal)
+                                   {
+                                     return p_value.GetConstant() == p_node.m_constant;
+                                   }
+                                   if(p_node.m_operator == JPOperator::JPO_NotEqual)
+                                   {
+                                     return p_value.GetConstant() != p_node.m_constant;
+                                   }
+                                   return false;
+    default:                       return false;
+  }
+}
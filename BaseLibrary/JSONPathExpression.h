@@ -0,0 +1,161 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: JSONPathExpression.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// JSONPathExpression
+//
+// A JSONPath compiled once into an immutable list of steps, with the filter
+// predicates and slices already parsed. The expression holds no state of an
+// evaluation, so one expression can be evaluated by many threads at the same
+// time, against any JSONMessage. Results go into a JPResults vector of the
+// caller, so a re-used vector makes evaluation free of heap allocations.
+//
+// Same syntax as JSONPath (see JSONPath.h), plus:
+// $..name                  -> ALL the 'name' members below the root (JSONPath stops at the first)
+// $.one['two','five']      -> Union of object member names
+// $.one[?(@.a > 1 && (@.b == 'x' || !@.c))] -> Filters with proper precedence and brackets
+//
+// A member step on an array is applied to all elements of the array.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "JSONMessage.h"
+#include "JSONPath.h"
+#include "bcd.h"
+#include <vector>
+
+enum class JPStepType
+{
+  JPS_Member        // .name or ['name']
+ ,JPS_Members       // ['name','other']
+ ,JPS_Wildcard      // .* or [*]
+ ,JPS_Index         // [n]
+ ,JPS_Slice         // [start:end:step]
+ ,JPS_Union         // [n,m,o]
+ ,JPS_Filter        // [?(...)]
+};
+
+enum class JPNodeType
+{
+  JPN_Or            // left || right
+ ,JPN_And           // left && right
+ ,JPN_Not           // !operand
+ ,JPN_Exists        // @.name
+ ,JPN_Compare       // @.name <operator> literal
+};
+
+enum class JPOperator
+{
+  JPO_Equal
+ ,JPO_NotEqual
+ ,JPO_Less
+ ,JPO_LessEqual
+ ,JPO_Greater
+ ,JPO_GreaterEqual
+};
+
+// Node of a compiled filter expression
+struct JPFilterNode
+{
+  JPNodeType  m_type     { JPNodeType::JPN_Exists };
+  int         m_left     { -1 };                // Node index: left side or operand
+  int         m_right    { -1 };                // Node index: right side
+  std::vector<XString> m_members;               // Member path of '@.name.sub'. Empty = '@'
+  JPOperator  m_operator { JPOperator::JPO_Equal };
+  XString     m_string;                         // Literal as a string
+  bcd         m_number;                         // Literal as a number
+  bool        m_isNumber { false };             // Literal was a number
+  JsonConst   m_constant { JsonConst::JSON_NONE };  // Literal was true/false/null
+};
+
+// One compiled step of the path
+struct JPStep
+{
+  JPStepType        m_type      { JPStepType::JPS_Member };
+  bool              m_recursive { false };      // Step is preceded by '..'
+  XString           m_name;                     // Member name
+  std::vector<XString> m_names;                 // Union of member names
+  int               m_index     { 0 };          // Index (negative from the end)
+  std::vector<int>  m_indices;                  // Union of indices
+  int               m_start     { 0 };          // Slice
+  int               m_end       { 0 };
+  int               m_step      { 1 };
+  bool              m_hasStart  { false };
+  bool              m_hasEnd    { false };
+  int               m_filter    { -1 };         // Root node of the filter
+};
+
+class JSONPathExpression
+{
+public:
+  JSONPathExpression() = default;
+  explicit JSONPathExpression(XString p_path,bool p_originOne = false);
+
+  // Compile a path. After this the expression is read-only
+  bool        Compile(XString p_path,bool p_originOne = false);
+
+  // Evaluate against a message. Clears and fills the results. Thread safe
+  unsigned    Evaluate(JSONMessage& p_message,JPResults& p_results) const;
+  // Only the first match (no results vector needed)
+  JSONvalue*  EvaluateFirst(JSONMessage& p_message) const;
+
+  // GETTERS
+  bool        IsValid()         const { return m_valid;     }
+  XString     GetPath()         const { return m_path;      }
+  XString     GetErrorMessage() const { return m_errorInfo; }
+  size_t      GetNumberOfSteps()const { return m_steps.size(); }
+
+private:
+  // Compiling
+  bool        CompileStep   (const XString& p_path,int& p_pos);
+  bool        CompileBracket(const XString& p_path,int& p_pos,JPStep& p_step);
+  bool        CompileSubscript(XString p_subscript,JPStep& p_step);
+  int         CompileOr     (const XString& p_filter,int& p_pos);
+  int         CompileAnd    (const XString& p_filter,int& p_pos);
+  int         CompileUnary  (const XString& p_filter,int& p_pos);
+  int         CompileLiteral(const XString& p_filter,int& p_pos,JPFilterNode& p_node);
+  bool        SetError(XString p_error);
+
+  // Evaluation
+  bool        Walk   (JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const;
+  bool        Descend(JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const;
+  bool        Apply  (JSONvalue* p_value,size_t p_step,JPResults* p_results,JSONvalue** p_first) const;
+  bool        Matches(int p_node,JSONvalue& p_value) const;
+  bool        Compare(const JPFilterNode& p_node,const JSONvalue& p_value) const;
+  JSONvalue*  FindMember(const JPFilterNode& p_node,JSONvalue& p_value) const;
+
+  // DATA
+  XString     m_path;
+  int         m_origin    { 0 };
+  bool        m_valid     { false };
+  XString     m_errorInfo;
+  std::vector<JPStep>       m_steps;
+  std::vector<JPFilterNode> m_nodes;
+};
@@ -41,6 +41,7 @@
 #include "GetUserAccount.h"
 #include "AutoCritical.h"
 #include "ConvertWideString.h"
+#include "LogRingBuffer.h"
 #include <string.h>
 #include <sys/timeb.h>
 #include <process.h>
@@ -57,17 +58,76 @@ static char THIS_FILE[] = __FILE__;
 #endif
 #endif
 
+// Identities of all logfiles for the per-thread rings
+static long g_logInstances = 0;
+
+// The rings of one thread, one for each logfile it writes to
+struct LogRingSlot
+{
+  long                     m_instance;
+  std::shared_ptr<LogRing> m_ring;
+};
+
+class LogThreadRings
+{
+public:
+  ~LogThreadRings()
+  {
+    // Thread ends: the writer may remove the rings once they are empty
+    for(auto& slot : m_slots)
+    {
+      slot.m_ring->SetOrphan();
+    }
+  }
+  std::vector<LogRingSlot> m_slots;
+};
+
+static thread_local LogThreadRings t_rings;
+
+// One drained log record, to be placed in time order
+struct LogLine
+{
+  __int64  m_time   { 0 };
+  LogType  m_type   { LogType::LOG_INFO };
+  bool     m_bare   { false };
+  XString  m_text;
+  LogBuff* m_buffer { nullptr };
+};
+
+// Current time as a FILETIME number
+static __int64
+LogNow()
+{
+  FILETIME now;
+  GetSystemTimePreciseAsFileTime(&now);
+  ULARGE_INTEGER time;
+  time.LowPart  = now.dwLowDateTime;
+  time.HighPart = now.dwHighDateTime;
+  return (__int64) time.QuadPart;
+}
+
 // CTOR is private: See static NewLogfile method
 LogAnalysis::LogAnalysis(XString p_name)
             :m_name(p_name)
 {
   Acquire();
   InitializeCriticalSection(&m_lock);
+  InitializeCriticalSection(&m_ringLock);
+  m_instance = InterlockedIncrement(&g_logInstances);
 }
 
 LogAnalysis::~LogAnalysis()
 {
   Reset();
+
+  // Threads that still hold our rings, will drop them
+  for(auto& ring : m_rings)
+  {
+    ring->SetOrphan();
+  }
+  m_rings.clear();
+
+  DeleteCriticalSection(&m_ringLock);
   DeleteCriticalSection(&m_lock);
 }
 
@@ -122,7 +182,7 @@ LogAnalysis::Reset()
   else return;
 
   // Flush left-overs from the application
-  if(!m_list.empty())
+  if(!m_list.empty() || !GetRingsEmpty())
   {
     if(m_useWriter)
     {
@@ -134,7 +194,7 @@ LogAnalysis::Reset()
         // Extra context for lock
         {
           AutoCritSec lock(&m_lock);
-          if(m_list.empty())
+          if(m_list.empty() && GetRingsEmpty())
           {
             break;
           }
@@ -159,6 +219,7 @@ LogAnalysis::Reset()
     else
     {
       // Direct flushing in the current thread
+      DrainRings();
       Flush(true);
     }
   }
@@ -411,25 +472,48 @@ LogAnalysis::Initialisation()
 bool
 LogAnalysis::AnalysisLog(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTSTR p_format,...)
 {
-  // Multi threaded protection
-  AutoCritSec lock(&m_lock);
-  XString logBuffer;
-  bool result = false;
-
   // Make sure the system is initialized
-  Initialisation();
+  if(!m_initialised)
+  {
+    AutoCritSec lock(&m_lock);
+    Initialisation();
+  }
 
   // Make sure we ARE logging
   if(m_logLevel == HLL_NOLOG)
   {
-    return result;
+    return false;
   }
 
   // Check on the loglevel
   if(m_logLevel == HLL_ERRORS && (p_type == LogType::LOG_INFO || p_type == LogType::LOG_TRACE))
   {
-    return result;
+    return false;
+  }
+
+  // Lock-free to the background writer, or formatting it ourselves
+  bool result = false;
+  va_list  varargs;
+  va_start(varargs,p_format);
+  if(GetUseRings())
+  {
+    result = PostRecord(p_function,p_type,p_doFormat,p_format,varargs);
+  }
+  if(!result)
+  {
+    result = AppendLogLine(p_function,p_type,p_doFormat,p_format,varargs);
   }
+  va_end(varargs);
+
+  return result;
+}
+
+// Date, time, type and function in front of the log line
+// YYYY-MM-DD HH:MM:SS.mmm T Function_name..........
+XString
+LogAnalysis::FormatPrefix(LogType p_type,__int64 p_time,LPCTSTR p_function)
+{
+  XString logBuffer;
 
   // Timing position in the buffer
   int position = 0;
@@ -447,20 +531,23 @@ LogAnalysis::AnalysisLog(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTS
   // Get/print the time
   if(m_doTiming)
   {
-    __timeb64 now;
-    struct tm today;
+    ULARGE_INTEGER time;
+    time.QuadPart = (ULONGLONG) p_time;
+    FILETIME   utc   { time.LowPart,time.HighPart };
+    FILETIME   local { 0,0 };
+    SYSTEMTIME today;
+    FileTimeToLocalFileTime(&utc,&local);
+    FileTimeToSystemTime(&local,&today);
 
     position = 26;  // Prefix string length
-    _ftime64_s(&now);
-    _localtime64_s(&today,&now.time);
     logBuffer.Format(_T("%4.4d-%2.2d-%2.2d %2.2d:%2.2d:%2.2d.%03d %c ")
-                    ,today.tm_year + 1900
-                    ,today.tm_mon  + 1
-                    ,today.tm_mday
-                    ,today.tm_hour
-                    ,today.tm_min
-                    ,today.tm_sec
-                    ,now.millitm
+                    ,today.wYear
+                    ,today.wMonth
+                    ,today.wDay
+                    ,today.wHour
+                    ,today.wMinute
+                    ,today.wSecond
+                    ,today.wMilliseconds
                     ,type);
   }
 
@@ -471,14 +558,23 @@ LogAnalysis::AnalysisLog(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTS
     logBuffer.Append(_T("                                                ")
                     ,position + ANALYSIS_FUNCTION_SIZE - logBuffer.GetLength());
   }
+  return logBuffer;
+}
+
+// Formatting the log line in the calling thread, under the lock
+bool
+LogAnalysis::AppendLogLine(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTSTR p_format,va_list p_args)
+{
+  // Multi threaded protection
+  AutoCritSec lock(&m_lock);
+  bool result = false;
+
+  XString logBuffer = FormatPrefix(p_type,LogNow(),p_function);
 
   // Print the arguments
   if(p_doFormat)
   {
-    va_list  varargs;
-    va_start(varargs,p_format);
-    logBuffer.AppendFormatV(p_format,varargs);
-    va_end(varargs);
+    logBuffer.AppendFormatV(p_format,p_args);
   }
   else
   {
@@ -560,14 +656,9 @@ LogAnalysis::AnalysisHex(LPCTSTR p_function,XString p_name,void* p_buffer,unsign
     p_length = LOGWRITE_MAXHEXDUMP;
   }
 
-  // Multi threaded protection
-  AutoCritSec lock(&m_lock);
-
-  // Name of the object
-  AnalysisLog(p_function,LogType::LOG_TRACE,true,_T("Hexadecimal view of: %s. Length: %d"),p_name.GetString(),p_length);
-
   unsigned long  pos    = 0;
   unsigned char* buffer = static_cast<unsigned char*>(p_buffer);
+  XString        lines;
 
   while(pos < p_length)
   {
@@ -598,9 +689,22 @@ LogAnalysis::AnalysisHex(LPCTSTR p_function,XString p_name,void* p_buffer,unsign
     asciiLine.Replace(_T("\r"),_T("#"));
     asciiLine.Replace(_T("\n"),_T("#"));
 
-    // Add to the list buffer
-    XString line(hexadLine + asciiLine + _T("\n"));
-    m_list.push_back(line);
+    // Add to the lines of the dump
+    lines += hexadLine + asciiLine + _T("\n");
+  }
+
+  // Name of the object and the dump lines together
+  if(GetUseRings())
+  {
+    AnalysisLog(p_function,LogType::LOG_TRACE,true,_T("Hexadecimal view of: %s. Length: %d"),p_name.GetString(),p_length);
+    AppendBare(lines);
+  }
+  else
+  {
+    // Multi threaded protection
+    AutoCritSec lock(&m_lock);
+    AnalysisLog(p_function,LogType::LOG_TRACE,true,_T("Hexadecimal view of: %s. Length: %d"),p_name.GetString(),p_length);
+    AppendBare(lines);
   }
   // Large object now written to the buffer. Force write it
   ForceFlush();
@@ -614,14 +718,24 @@ LogAnalysis::BareStringLog(XString p_string)
 {
   if (m_file.GetIsOpen())
   {
-    // Multi threaded protection
-    AutoCritSec lock(&m_lock);
-
     p_string += _T("\n");
-    m_list.push_back(p_string);
+    AppendBare(p_string);
   }
 }
 
+// Lines without formatting or headers, in order with the other log lines
+void
+LogAnalysis::AppendBare(XString& p_lines)
+{
+  if(GetUseRings() && PostText(nullptr,LogType::LOG_TRACE,true,p_lines))
+  {
+    return;
+  }
+  // Multi threaded protection
+  AutoCritSec lock(&m_lock);
+  m_list.push_back(p_lines);
+}
+
 void
 LogAnalysis::BareBufferLog(void* p_buffer,unsigned p_length)
 {
@@ -629,15 +743,21 @@ LogAnalysis::BareBufferLog(void* p_buffer,unsigned p_length)
   BYTE* copy = new BYTE[p_length];
   memcpy(copy,p_buffer,p_length);
 
-  LogBuff buff;
-  buff.m_buffer = copy;
-  buff.m_length = p_length;
+  LogBuff* buff  = new LogBuff;
+  buff->m_buffer = copy;
+  buff->m_length = p_length;
+
+  if(GetUseRings() && PostBuffer(buff))
+  {
+    return;
+  }
 
   // Multi threaded protection
   AutoCritSec lock(&m_lock);
 
-  m_buffers.push_back(buff);
+  m_buffers.push_back(*buff);
   m_list.push_back(marker);
+  delete buff;
 }
 
 // Force flushing of the logfile
@@ -713,6 +833,312 @@ LogAnalysis::WriteLog(XString& p_buffer)
   }
 }
 
+//////////////////////////////////////////////////////////////////////////
+//
+// LOCK-FREE LOGGING
+//
+// Every logging thread writes binary records into its own ring.
+// The background writer drains the rings, formats the records
+// into log lines and adds them (in time order) to the cache list.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Only with a running background writer and an open logfile
+bool
+LogAnalysis::GetUseRings()
+{
+  return m_lockFree && m_useWriter && m_logThread != NULL && m_file.GetIsOpen();
+}
+
+// Find or create the ring of the current thread for this logfile
+LogRing*
+LogAnalysis::GetThreadRing()
+{
+  for(auto& slot : t_rings.m_slots)
+  {
+    if(slot.m_instance == m_instance)
+    {
+      return slot.m_ring.get();
+    }
+  }
+  // Forget the rings of logfiles that are gone
+  auto& slots = t_rings.m_slots;
+  slots.erase(std::remove_if(slots.begin(),slots.end(),[](LogRingSlot& p_slot)
+                             {
+                               return p_slot.m_ring->GetOrphan();
+                             }),slots.end());
+
+  std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+  {
+    AutoCritSec lock(&m_ringLock);
+    m_rings.push_back(ring);
+  }
+  slots.push_back({ m_instance,ring });
+  return ring.get();
+}
+
+// Wait for room in the ring, while the writer drains it
+LogRecord*
+LogAnalysis::ReserveRecord(LogRing* p_ring,size_t p_payload)
+{
+  LogRecord* record = nullptr;
+  unsigned   spins  = 0;
+
+  while((record = p_ring->Reserve(p_payload)) == nullptr)
+  {
+    if(m_logThread == NULL)
+    {
+      return nullptr;
+    }
+    SetEvent(m_drain);
+    if(++spins < 16)
+    {
+      SwitchToThread();
+    }
+    else
+    {
+      Sleep(1);
+    }
+  }
+  record->m_time     = LogNow();
+  record->m_function = nullptr;
+  record->m_format   = nullptr;
+  return record;
+}
+
+// Publish the record and wake the writer if needed
+bool
+LogAnalysis::CommitRecord(LogRing* p_ring,LogRecord* p_record,LogType p_type)
+{
+  size_t half = p_ring->GetSize() / 2;
+  size_t size = p_record->m_size;
+  size_t used = p_ring->Commit(p_record);
+
+  if(p_type == LogType::LOG_ERROR)
+  {
+    // In case of an error, flush immediately!
+    SetEvent(m_event);
+  }
+  else if(used >= half && used - size < half)
+  {
+    // Ring just got half full
+    SetEvent(m_drain);
+  }
+  return true;
+}
+
+bool
+LogAnalysis::PostRecord(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTSTR p_format,va_list p_args)
+{
+  static thread_local std::vector<BYTE> t_payload;
+
+  LPCTSTR function = LogIntern(p_function);
+  if(function == nullptr)
+  {
+    return false;
+  }
+
+  // Capture the arguments, so the writer can do the formatting
+  LPCTSTR format = p_doFormat ? LogIntern(p_format) : nullptr;
+  if(format)
+  {
+    t_payload.clear();
+    va_list args;
+    va_copy(args,p_args);
+    bool captured = LogCaptureArguments(format,args,t_payload);
+    va_end(args);
+
+    if(captured && t_payload.size() <= LOGRING_MAXRECORD)
+    {
+      LogRing*   ring   = GetThreadRing();
+      LogRecord* record = ReserveRecord(ring,t_payload.size());
+      if(record == nullptr)
+      {
+        return false;
+      }
+      record->m_kind     = LogRecordKind::RK_Format;
+      record->m_type     = static_cast<unsigned short>(p_type);
+      record->m_function = function;
+      record->m_format   = format;
+      if(!t_payload.empty())
+      {
+        memcpy(record->GetPayload(),t_payload.data(),t_payload.size());
+      }
+      return CommitRecord(ring,record,p_type);
+    }
+  }
+
+  // Not a format, or arguments that cannot be captured: post the text
+  XString text;
+  if(p_doFormat)
+  {
+    va_list args;
+    va_copy(args,p_args);
+    text.FormatV(p_format,args);
+    va_end(args);
+  }
+  else
+  {
+    text = p_format;
+  }
+  return PostText(function,p_type,false,text);
+}
+
+// Post a message text, or lines without a prefix (bare)
+bool
+LogAnalysis::PostText(LPCTSTR p_function,LogType p_type,bool p_bare,XString& p_text)
+{
+  LogRing*   ring   = GetThreadRing();
+  LogRecord* record = nullptr;
+  size_t     bytes  = ((size_t)p_text.GetLength() + 1) * sizeof(TCHAR);
+
+  if(bytes <= LOGRING_MAXRECORD)
+  {
+    if((record = ReserveRecord(ring,bytes)) == nullptr)
+    {
+      return false;
+    }
+    record->m_kind = p_bare ? LogRecordKind::RK_Bare : LogRecordKind::RK_Text;
+    memcpy(record->GetPayload(),p_text.GetString(),bytes);
+  }
+  else
+  {
+    // Large messages (e.g. bodies) do not go through the ring
+    if((record = ReserveRecord(ring,sizeof(XString*))) == nullptr)
+    {
+      return false;
+    }
+    XString* heap  = new XString(p_text);
+    record->m_kind = p_bare ? LogRecordKind::RK_BareHeap : LogRecordKind::RK_Heap;
+    memcpy(record->GetPayload(),&heap,sizeof(XString*));
+  }
+  record->m_type     = static_cast<unsigned short>(p_type);
+  record->m_function = p_function;
+  return CommitRecord(ring,record,p_type);
+}
+
+// Post a binary buffer. The writer becomes the owner of the buffer
+bool
+LogAnalysis::PostBuffer(LogBuff* p_buffer)
+{
+  LogRing*   ring   = GetThreadRing();
+  LogRecord* record = ReserveRecord(ring,sizeof(LogBuff*));
+  if(record == nullptr)
+  {
+    return false;
+  }
+  record->m_kind = LogRecordKind::RK_Buffer;
+  record->m_type = static_cast<unsigned short>(LogType::LOG_TRACE);
+  memcpy(record->GetPayload(),&p_buffer,sizeof(LogBuff*));
+  return CommitRecord(ring,record,LogType::LOG_TRACE);
+}
+
+// BACKGROUND WRITER: Format all records of all rings into the cache list
+void
+LogAnalysis::DrainRings()
+{
+  RingList rings;
+  {
+    AutoCritSec lock(&m_ringLock);
+    // Rings of ended threads can go, once they are empty
+    m_rings.erase(std::remove_if(m_rings.begin(),m_rings.end(),[](std::shared_ptr<LogRing>& p_ring)
+                                 {
+                                   return p_ring->GetOrphan() && p_ring->GetIsEmpty();
+                                 }),m_rings.end());
+    rings = m_rings;
+  }
+
+  std::vector<LogLine> lines;
+  for(auto& ring : rings)
+  {
+    while(LogRecord* record = ring->Peek())
+    {
+      LogLine line;
+      line.m_time = record->m_time;
+      line.m_type = static_cast<LogType>(record->m_type);
+      BYTE* payload = record->GetPayload();
+
+      switch(record->m_kind)
+      {
+        case LogRecordKind::RK_Format:  line.m_text = FormatPrefix(line.m_type,line.m_time,record->m_function);
+                                        LogFormatArguments(record->m_format,payload,record->GetLength(),line.m_text);
+                                        line.m_text += _T("\n");
+                                        break;
+        case LogRecordKind::RK_Text:    line.m_text  = FormatPrefix(line.m_type,line.m_time,record->m_function);
+                                        line.m_text += reinterpret_cast<LPCTSTR>(payload);
+                                        line.m_text += _T("\n");
+                                        break;
+        case LogRecordKind::RK_Heap:    { XString* heap = nullptr;
+                                          memcpy(&heap,payload,sizeof(XString*));
+                                          line.m_text  = FormatPrefix(line.m_type,line.m_time,record->m_function);
+                                          line.m_text += *heap + _T("\n");
+                                          delete heap;
+                                          break;
+                                        }
+        case LogRecordKind::RK_Bare:    line.m_bare = true;
+                                        line.m_text = reinterpret_cast<LPCTSTR>(payload);
+                                        break;
+        case LogRecordKind::RK_BareHeap:{ XString* heap = nullptr;
+                                          memcpy(&heap,payload,sizeof(XString*));
+                                          line.m_bare = true;
+                                          line.m_text = *heap;
+                                          delete heap;
+                                          break;
+                                        }
+        case LogRecordKind::RK_Buffer:  line.m_bare = true;
+                                        memcpy(&line.m_buffer,payload,sizeof(LogBuff*));
+                                        break;
+        default:                        break;
+      }
+      ring->Release(record);
+      lines.push_back(line);
+    }
+  }
+  if(lines.empty())
+  {
+    return;
+  }
+
+  // The lines of all threads in the order of their log calls
+  std::stable_sort(lines.begin(),lines.end(),[](const LogLine& p_left,const LogLine& p_right)
+                   {
+                     return p_left.m_time < p_right.m_time;
+                   });
+
+  // Multi threaded protection
+  AutoCritSec lock(&m_lock);
+
+  for(auto& line : lines)
+  {
+    if(line.m_buffer)
+    {
+      m_buffers.push_back(*line.m_buffer);
+      m_list.push_back(XString(_T(BUFFER_MARKER)));
+      delete line.m_buffer;
+      continue;
+    }
+    if(m_doEvents && !line.m_bare)
+    {
+      WriteEvent(m_eventLog,line.m_type,line.m_text);
+    }
+    m_list.push_back(line.m_text);
+  }
+}
+
+bool
+LogAnalysis::GetRingsEmpty()
+{
+  AutoCritSec lock(&m_ringLock);
+  for(auto& ring : m_rings)
+  {
+    if(!ring->GetIsEmpty())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Read the 'Logfile.Config' in the current directory
 // for overloads on the settings of the logfile
 void
@@ -780,6 +1206,11 @@ LogAnalysis::ReadConfig()
           SetKeepfiles(keep);
           continue;
         }
+        if(line.Left(9).CompareNoCase(_T("lockfree=")) == 0)
+        {
+          m_lockFree = _ttoi(line.Mid(9));
+          continue;
+        }
 
       }
     }
@@ -814,8 +1245,9 @@ LogAnalysis::RunLog()
   }
   else
   {
-    // Create the event before starting the thread and before ending this call!!
+    // Create the events before starting the thread and before ending this call!!
     m_event = CreateEvent(NULL,FALSE,FALSE,NULL);
+    m_drain = CreateEvent(NULL,FALSE,FALSE,NULL);
     // Basis thread of the InOutPort
     unsigned int threadID;
     if((m_logThread = reinterpret_cast<HANDLE>(_beginthreadex(NULL,0,StartingTheLog,(void *)(this),0,&threadID))) == INVALID_HANDLE_VALUE)
@@ -837,27 +1269,39 @@ LogAnalysis::RunLogAnalysis()
   // Writing thread acquires a lock on the object
   Acquire();
 
+  HANDLE events[2] = { m_event, m_drain };
+
   while(m_initialised && m_refcounter > 1)
   {
-    DWORD res = WaitForSingleObjectEx(m_event,m_interval,true);
+    DWORD res = WaitForMultipleObjectsEx(2,events,FALSE,m_interval,true);
 
     switch(res)
     {
       case WAIT_OBJECT_0:       // Full flushing requested, do it
+                                DrainRings();
                                 Flush(true);
+                                break;
+      case WAIT_OBJECT_0 + 1:   // A thread ring is getting full
+                                DrainRings();
+                                Flush(false);
+                                break;
       case WAIT_IO_COMPLETION:  break;
       case WAIT_ABANDONED:      break;
       case WAIT_TIMEOUT:        // Timeout - see if we must flush
                                 // Every fourth round, we do a forced flush
+                                DrainRings();
                                 Flush((++sync % LOGWRITE_FORCED) == 0);
                                 break;
     }
   }
   // Flush out the rest
+  DrainRings();
   Flush(true);
-  // Closing our event
+  // Closing our events
   CloseHandle(m_event);
+  CloseHandle(m_drain);
   m_event = NULL;
+  m_drain = NULL;
 
   // Also ending this thread
   m_logThread = NULL;
@@ -37,6 +37,8 @@
 
 #pragma once
 #include <deque>
+#include <vector>
+#include <memory>
 #include <time.h>
 
 // Logging Levels (HLL) of the server and client processing
@@ -94,6 +96,10 @@ struct LogBuff
 using LogList = std::deque<XString>;
 // Caching list for binary buffers
 using BufList = std::deque<LogBuff>;
+// Per-thread rings of binary log records (see LogRingBuffer.h)
+class  LogRing;
+struct LogRecord;
+using RingList = std::vector<std::shared_ptr<LogRing>>;
 
 class LogAnalysis
 {
@@ -133,6 +139,7 @@ public:
   void    SetDoTiming(bool p_doTiming)         { m_doTiming    = p_doTiming; }
   void    SetDoEvents(bool p_doEvents)         { m_doEvents    = p_doEvents; }
   void    SetLogRotation(bool p_rotate)        { m_rotate      = p_rotate;   }
+  void    SetLockFree(bool p_lockFree)         { m_lockFree    = p_lockFree; }
   void    SetKeepfiles(int p_keepfiles);
   void    SetCache   (int  p_cache);
   void    SetInterval(int  p_interval);
@@ -147,6 +154,7 @@ public:
   XString GetLogFileName()                     { return m_logFileName;}
   int     GetInterval()                        { return m_interval;   }
   bool    GetLogRotation()                     { return m_rotate;     }
+  bool    GetLockFree()                        { return m_lockFree;   }
   int     GetKeepfiles()                       { return m_keepfiles;  }
   bool    GetBackgroundWriter()                { return m_useWriter;  }
   HANDLE  GetBackgroundWriterThread()          { return m_logThread;  }
@@ -173,6 +181,19 @@ private:
   // Writing out a log line
   void    Flush(bool p_all);
   void    WriteLog(XString& p_buffer);
+  XString FormatPrefix(LogType p_type,__int64 p_time,LPCTSTR p_function);
+  bool    AppendLogLine(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTSTR p_format,va_list p_args);
+  void    AppendBare(XString& p_lines);
+  // Lock-free logging through the background writer
+  bool    GetUseRings();
+  LogRing* GetThreadRing();
+  bool    PostRecord(LPCTSTR p_function,LogType p_type,bool p_doFormat,LPCTSTR p_format,va_list p_args);
+  bool    PostText(LPCTSTR p_function,LogType p_type,bool p_bare,XString& p_text);
+  bool    PostBuffer(LogBuff* p_buffer);
+  LogRecord* ReserveRecord(LogRing* p_ring,size_t p_payload);
+  bool    CommitRecord(LogRing* p_ring,LogRecord* p_record,LogType p_type);
+  void    DrainRings();
+  bool    GetRingsEmpty();
 
   // Settings
   XString m_name;                               // For WMI Event viewer
@@ -183,6 +204,7 @@ private:
   bool    m_doEvents    { false };              // Also write to WMI event log
   bool    m_rotate      { false };              // Log rotation for server solutions
   bool    m_useWriter   { true  };              // Use thread writer in the background
+  bool    m_lockFree    { true  };              // Log through per-thread rings to the writer
   size_t  m_cacheMaxSize{ LOGWRITE_CACHE     }; // Number of cached lines
   int     m_interval    { LOGWRITE_INTERVAL  }; // Interval between writes (in seconds)
   int     m_keepfiles   { LOGWRITE_KEEPFILES }; // Keep a maximum of n files in a directory
@@ -191,6 +213,9 @@ private:
   bool    m_initialised { false };              // Logging is initialized and ready
   HANDLE  m_logThread   { NULL };               // Async writing threads ID
   HANDLE  m_event       { NULL };               // Event for waking writing thread
+  HANDLE  m_drain       { NULL };               // Event for draining the thread rings
+  long    m_instance    { 0 };                  // Identity for the per-thread rings
+  RingList m_rings;                             // Rings of all logging threads
   HANDLE  m_eventLog    { NULL };               // WMI handle to write event-log to
   XString m_logFileName { "Logfile.txt" };      // Name of the logging file
   LogList m_list;                               // Cached list of logging lines
@@ -198,5 +223,6 @@ private:
 
   // Multi-threading issues
   CRITICAL_SECTION m_lock;
+  CRITICAL_SECTION m_ringLock;                  // Only for adding/removing rings
 };
 
@@ -0,0 +1,539 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: LogRingBuffer.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////
+//
+// LOG RING BUFFER
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "LogRingBuffer.h"
+#include "AutoCritical.h"
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE RING: Single producer, single consumer
+//
+//////////////////////////////////////////////////////////////////////////
+
+LogRing::LogRing(size_t p_size /*= LOGRING_SIZE*/)
+{
+  // Power of two, so positions can be masked
+  m_size = LOGRING_ALIGN * 4;
+  while(m_size < p_size)
+  {
+    m_size <<= 1;
+  }
+  m_mask = m_size - 1;
+  m_data = new BYTE[m_size];
+}
+
+LogRing::~LogRing()
+{
+  delete [] m_data;
+}
+
+// Positions only ever grow. The record always lies contiguous in the ring.
+// If it does not fit before the end, a padding record fills up the end.
+LogRecord*
+LogRing::Reserve(size_t p_payload)
+{
+  size_t size = (sizeof(LogRecord) + p_payload + LOGRING_ALIGN - 1) & ~(size_t)(LOGRING_ALIGN - 1);
+  if(size > m_size / 2)
+  {
+    return nullptr;
+  }
+  size_t head   = m_head.load(std::memory_order_relaxed);
+  size_t tail   = m_tail.load(std::memory_order_acquire);
+  size_t offset = head & m_mask;
+  size_t room   = m_size - offset;
+  size_t needed = (size <= room) ? size : room + size;
+
+  if(m_size - (head - tail) < needed)
+  {
+    return nullptr;
+  }
+  if(size > room)
+  {
+    LogRecord* padding = reinterpret_cast<LogRecord*>(m_data + offset);
+    padding->m_size = static_cast<unsigned>(room);
+    padding->m_kind = LogRecordKind::RK_Padding;
+    head  += room;
+    offset = 0;
+  }
+  m_reserved = head;
+
+  LogRecord* record = reinterpret_cast<LogRecord*>(m_data + offset);
+  record->m_size = static_cast<unsigned>(size);
+  return record;
+}
+
+size_t
+LogRing::Commit(LogRecord* p_record)
+{
+  size_t head = m_reserved + p_record->m_size;
+  m_head.store(head,std::memory_order_release);
+  return head - m_tail.load(std::memory_order_relaxed);
+}
+
+LogRecord*
+LogRing::Peek()
+{
+  size_t tail = m_tail.load(std::memory_order_relaxed);
+  while(tail != m_head.load(std::memory_order_acquire))
+  {
+    LogRecord* record = reinterpret_cast<LogRecord*>(m_data + (tail & m_mask));
+    if(record->m_kind != LogRecordKind::RK_Padding)
+    {
+      return record;
+    }
+    tail += record->m_size;
+    m_tail.store(tail,std::memory_order_release);
+  }
+  return nullptr;
+}
+
+void
+LogRing::Release(LogRecord* p_record)
+{
+  size_t tail = m_tail.load(std::memory_order_relaxed);
+  m_tail.store(tail + p_record->m_size,std::memory_order_release);
+}
+
+bool
+LogRing::GetIsEmpty()
+{
+  return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// INTERNING function names and format strings
+// Most of them are literals, but we cannot be sure of it.
+// So we keep an immortal copy and a per-thread cache by address.
+//
+//////////////////////////////////////////////////////////////////////////
+
+class LogInterner
+{
+public:
+  LogInterner()  { InitializeCriticalSection(&m_lock); }
+ ~LogInterner()  { DeleteCriticalSection(&m_lock);     }
+
+  LPCTSTR Intern(LPCTSTR p_string)
+  {
+    AutoCritSec lock(&m_lock);
+    if(m_strings.size() >= LOGRING_INTERNED)
+    {
+      auto found = m_strings.find(p_string);
+      return found == m_strings.end() ? nullptr : found->c_str();
+    }
+    return m_strings.emplace(p_string).first->c_str();
+  }
+
+private:
+  CRITICAL_SECTION m_lock;
+  // Node based: the strings never move
+  std::unordered_set<std::basic_string<TCHAR>> m_strings;
+};
+
+LPCTSTR
+LogIntern(LPCTSTR p_string)
+{
+  static LogInterner interner;
+  static thread_local std::unordered_map<LPCTSTR,LPCTSTR> t_cache;
+
+  if(p_string == nullptr)
+  {
+    p_string = _T("");
+  }
+  // Same address and still the same contents
+  auto cached = t_cache.find(p_string);
+  if(cached != t_cache.end() && _tcscmp(cached->second,p_string) == 0)
+  {
+    return cached->second;
+  }
+  LPCTSTR interned = interner.Intern(p_string);
+  if(interned)
+  {
+    if(t_cache.size() >= 4096)
+    {
+      t_cache.clear();
+    }
+    t_cache[p_string] = interned;
+  }
+  return interned;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// ARGUMENTS of a printf format
+// Every argument is stored as a tag byte and the value.
+// Strings are copied, as they will not live until the writer formats them.
+//
+//////////////////////////////////////////////////////////////////////////
+
+enum class LogArg : BYTE
+{
+  None     // "%%"
+ ,Int32
+ ,Int64
+ ,Double
+ ,Pointer
+ ,StringA
+ ,StringW
+ ,NullA
+ ,NullW
+};
+
+struct LogSpec
+{
+  LPCTSTR m_begin { nullptr };      // The '%' of the specification
+  LPCTSTR m_end   { nullptr };      // Just after the type character
+  int     m_stars { 0 };            // Width and/or precision as argument
+  int     m_precision { -1 };       // -1 = none, -2 = the last '*' argument
+  LogArg  m_arg   { LogArg::None }; // Type of the argument
+  bool    m_valid { true  };        // Argument can be captured
+};
+
+// Parse one printf specification (MSVC rules)
+// %[flags][width][.precision][length]type
+static LPCTSTR
+ParseSpec(LPCTSTR p_percent,LogSpec& p_spec)
+{
+  LPCTSTR pnt = p_percent + 1;
+  p_spec.m_begin = p_percent;
+
+  if(*pnt == '%')
+  {
+    p_spec.m_end = pnt + 1;
+    return p_spec.m_end;
+  }
+  while(*pnt == '-' || *pnt == '+' || *pnt == ' ' || *pnt == '#' || *pnt == '0')
+  {
+    ++pnt;
+  }
+  // Width
+  if(*pnt == '*')
+  {
+    ++p_spec.m_stars;
+    ++pnt;
+  }
+  while(_istdigit(*pnt))
+  {
+    ++pnt;
+  }
+  // Precision
+  if(*pnt == '.')
+  {
+    if(*++pnt == '*')
+    {
+      ++p_spec.m_stars;
+      p_spec.m_precision = -2;
+      ++pnt;
+    }
+    else
+    {
+      p_spec.m_precision = 0;
+      while(_istdigit(*pnt))
+      {
+        p_spec.m_precision = p_spec.m_precision * 10 + (*pnt++ - '0');
+      }
+    }
+  }
+
+  // Length modifiers
+  bool isShort = false;
+  bool isLong  = false;
+  bool isInt64 = false;
+  switch(*pnt)
+  {
+    case 'h': isShort = true;
+              if(*++pnt == 'h') ++pnt;
+              break;
+    case 'l': if(*++pnt == 'l')
+              {
+                isInt64 = true;
+                ++pnt;
+              }
+              else isLong = true;
+              break;
+    case 'w': isLong = true;
+              ++pnt;
+              break;
+    case 'L': ++pnt;  // long double is a double
+              break;
+    case 'I': ++pnt;
+              if(pnt[0] == '6' && pnt[1] == '4')
+              {
+                isInt64 = true;
+                pnt += 2;
+              }
+              else if(pnt[0] == '3' && pnt[1] == '2')
+              {
+                pnt += 2;
+              }
+              else isInt64 = (sizeof(size_t) == 8);
+              break;
+    case 'z': // Fall through
+    case 't': isInt64 = (sizeof(size_t) == 8);
+              ++pnt;
+              break;
+    case 'j': isInt64 = true;
+              ++pnt;
+              break;
+  }
+
+  TCHAR type = *pnt;
+  if(type == 0)
+  {
+    p_spec.m_valid = false;
+    p_spec.m_end   = pnt;
+    return pnt;
+  }
+  p_spec.m_end = ++pnt;
+
+  switch(type)
+  {
+    case 'd': // Fall through
+    case 'i': // Fall through
+    case 'o': // Fall through
+    case 'u': // Fall through
+    case 'x': // Fall through
+    case 'X': p_spec.m_arg = isInt64 ? LogArg::Int64 : LogArg::Int32;
+              break;
+    case 'c': // Fall through
+    case 'C': p_spec.m_arg = LogArg::Int32;
+              break;
+    case 'e': // Fall through
+    case 'E': // Fall through
+    case 'f': // Fall through
+    case 'F': // Fall through
+    case 'g': // Fall through
+    case 'G': // Fall through
+    case 'a': // Fall through
+    case 'A': p_spec.m_arg = LogArg::Double;
+              break;
+    case 'p': p_spec.m_arg = LogArg::Pointer;
+              break;
+#ifdef _UNICODE
+    case 's': p_spec.m_arg = isShort ? LogArg::StringA : LogArg::StringW; break;
+    case 'S': p_spec.m_arg = isLong  ? LogArg::StringW : LogArg::StringA; break;
+#else
+    case 's': p_spec.m_arg = isLong  ? LogArg::StringW : LogArg::StringA; break;
+    case 'S': p_spec.m_arg = isShort ? LogArg::StringA : LogArg::StringW; break;
+#endif
+    default:  // %n, %Z and unknown types are not captured
+              p_spec.m_valid = false;
+              break;
+  }
+  return pnt;
+}
+
+template<typename T>
+static void
+PutValue(std::vector<BYTE>& p_payload,LogArg p_arg,const T& p_value)
+{
+  p_payload.push_back(static_cast<BYTE>(p_arg));
+  const BYTE* bytes = reinterpret_cast<const BYTE*>(&p_value);
+  p_payload.insert(p_payload.end(),bytes,bytes + sizeof(T));
+}
+
+template<typename C>
+static void
+PutString(std::vector<BYTE>& p_payload,LogArg p_arg,LogArg p_null,const C* p_string,size_t p_length)
+{
+  if(p_string == nullptr)
+  {
+    p_payload.push_back(static_cast<BYTE>(p_null));
+    return;
+  }
+  unsigned length = static_cast<unsigned>(p_length);
+  PutValue(p_payload,p_arg,length);
+  // The string can end beyond the precision: terminate our own copy
+  const BYTE* bytes = reinterpret_cast<const BYTE*>(p_string);
+  p_payload.insert(p_payload.end(),bytes,bytes + p_length * sizeof(C));
+  p_payload.insert(p_payload.end(),sizeof(C),0);
+}
+
+bool
+LogCaptureArguments(LPCTSTR p_format,va_list p_args,std::vector<BYTE>& p_payload)
+{
+  for(LPCTSTR pnt = _tcschr(p_format,'%'); pnt; pnt = _tcschr(pnt,'%'))
+  {
+    LogSpec spec;
+    pnt = ParseSpec(pnt,spec);
+    if(!spec.m_valid)
+    {
+      return false;
+    }
+    int precision = spec.m_precision;
+    for(int star = 0; star < spec.m_stars; ++star)
+    {
+      int value = va_arg(p_args,int);
+      PutValue(p_payload,LogArg::Int32,value);
+      if(star == spec.m_stars - 1 && precision == -2)
+      {
+        // A negative precision argument is taken as omitted
+        precision = value < 0 ? -1 : value;
+      }
+    }
+    // Copy no more than the precision: the string need not be terminated
+    size_t maximum = precision < 0 ? SIZE_MAX : static_cast<size_t>(precision);
+    switch(spec.m_arg)
+    {
+      case LogArg::Int32:   PutValue(p_payload,LogArg::Int32,  va_arg(p_args,int));     break;
+      case LogArg::Int64:   PutValue(p_payload,LogArg::Int64,  va_arg(p_args,__int64)); break;
+      case LogArg::Double:  PutValue(p_payload,LogArg::Double, va_arg(p_args,double));  break;
+      case LogArg::Pointer: PutValue(p_payload,LogArg::Pointer,va_arg(p_args,void*));   break;
+      case LogArg::StringA: { const char* string = va_arg(p_args,const char*);
+                              PutString(p_payload,LogArg::StringA,LogArg::NullA,string,string ? strnlen(string,maximum) : 0);
+                              break;
+                            }
+      case LogArg::StringW: { const wchar_t* string = va_arg(p_args,const wchar_t*);
+                              PutString(p_payload,LogArg::StringW,LogArg::NullW,string,string ? wcsnlen(string,maximum) : 0);
+                              break;
+                            }
+      default:              break;
+    }
+  }
+  return true;
+}
+
+template<typename T>
+static bool
+GetValue(const BYTE*& p_read,const BYTE* p_end,LogArg p_arg,T& p_value)
+{
+  if(p_read + 1 + sizeof(T) > p_end || *p_read != static_cast<BYTE>(p_arg))
+  {
+    return false;
+  }
+  memcpy(&p_value,p_read + 1,sizeof(T));
+  p_read += 1 + sizeof(T);
+  return true;
+}
+
+// Getting a copied string (or a nullptr) from the payload
+template<typename C>
+static bool
+GetString(const BYTE*& p_read,const BYTE* p_end,LogArg p_arg,LogArg p_null,const C*& p_string)
+{
+  if(p_read < p_end && *p_read == static_cast<BYTE>(p_null))
+  {
+    ++p_read;
+    p_string = nullptr;
+    return true;
+  }
+  unsigned length = 0;
+  if(!GetValue(p_read,p_end,p_arg,length) || p_read + (length + 1) * sizeof(C) > p_end)
+  {
+    return false;
+  }
+  p_string = reinterpret_cast<const C*>(p_read);
+  p_read  += (length + 1) * sizeof(C);
+  return true;
+}
+
+void
+LogFormatArguments(LPCTSTR p_format,const BYTE* p_payload,size_t p_length,XString& p_line)
+{
+  const BYTE* read = p_payload;
+  const BYTE* end  = p_payload + p_length;
+  LPCTSTR literal  = p_format;
+
+  for(LPCTSTR pnt = _tcschr(p_format,'%'); pnt; pnt = _tcschr(pnt,'%'))
+  {
+    p_line.Append(literal,static_cast<int>(pnt - literal));
+    LogSpec spec;
+    pnt     = ParseSpec(pnt,spec);
+    literal = pnt;
+    if(spec.m_arg == LogArg::None)
+    {
+      p_line += _T('%');
+      continue;
+    }
+
+    // Rebuild the specification with the captured width and precision
+    XString format;
+    for(LPCTSTR ch = spec.m_begin; ch < spec.m_end; ++ch)
+    {
+      int value = 0;
+      if(*ch == '*' && GetValue(read,end,LogArg::Int32,value))
+      {
+        if(ch[-1] == '.' && value < 0)
+        {
+          // A negative precision is taken as omitted
+          format.Delete(format.GetLength() - 1);
+        }
+        else
+        {
+          format.AppendFormat(_T("%d"),value);
+        }
+      }
+      else
+      {
+        format += *ch;
+      }
+    }
+
+    bool ok = false;
+    switch(spec.m_arg)
+    {
+      case LogArg::Int32:   { int     value = 0;       if((ok = GetValue(read,end,LogArg::Int32,  value))) p_line.AppendFormat(format,value); break; }
+      case LogArg::Int64:   { __int64 value = 0;       if((ok = GetValue(read,end,LogArg::Int64,  value))) p_line.AppendFormat(format,value); break; }
+      case LogArg::Double:  { double  value = 0.0;     if((ok = GetValue(read,end,LogArg::Double, value))) p_line.AppendFormat(format,value); break; }
+      case LogArg::Pointer: { void*   value = nullptr; if((ok = GetValue(read,end,LogArg::Pointer,value))) p_line.AppendFormat(format,value); break; }
+      case LogArg::StringA: { const char*    value = nullptr;
+                              if((ok = GetString(read,end,LogArg::StringA,LogArg::NullA,value))) p_line.AppendFormat(format,value);
+                              break;
+                            }
+      case LogArg::StringW: { const wchar_t* value = nullptr;
+                              if((ok = GetString(read,end,LogArg::StringW,LogArg::NullW,value))) p_line.AppendFormat(format,value);
+                              break;
+                            }
+      default:              break;
+    }
+    if(!ok)
+    {
+      // Payload does not match the format. Show the rest as is
+      break;
+    }
+  }
+  p_line += literal;
+}
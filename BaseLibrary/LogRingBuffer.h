@@ -0,0 +1,114 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: LogRingBuffer.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////
+//
+// LOG RING BUFFER
+//
+// Binary log records of one thread, on their way to the background
+// writer of the LogAnalysis logfile. One producer (the logging thread)
+// and one consumer (the writer thread) per ring, so no locking is needed.
+//
+// A record holds the time of the log call, the interned function name
+// and format string, and the arguments of the format, captured by their
+// printf type. Formatting into a log line is done by the writer thread.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <vector>
+
+constexpr auto LOGRING_SIZE      = (64 * 1024);        // Bytes per thread ring
+constexpr auto LOGRING_ALIGN     = 32;                 // Alignment of all records
+constexpr auto LOGRING_MAXRECORD = (LOGRING_SIZE / 8); // Larger messages go on the heap
+constexpr auto LOGRING_INTERNED  = 10000;              // Max. interned functions and formats
+
+enum class LogRecordKind : unsigned short
+{
+  RK_Padding    // Skip to the start of the ring
+ ,RK_Format     // Format string and the captured arguments
+ ,RK_Text       // Message text in the payload
+ ,RK_Heap       // Message text in a heap allocated XString
+ ,RK_Bare       // Line(s) without date/time/function prefix
+ ,RK_BareHeap   // Bare line(s) in a heap allocated XString
+ ,RK_Buffer     // Binary buffer in a heap allocated LogBuff
+};
+
+struct LogRecord
+{
+  unsigned       m_size;        // Total size, including this header
+  LogRecordKind  m_kind;        // Type of the payload
+  unsigned short m_type;        // LogType of the line
+  __int64        m_time;        // FILETIME of the log call
+  LPCTSTR        m_function;    // Interned function name
+  LPCTSTR        m_format;      // Interned format string
+  // Payload follows the header
+  BYTE*          GetPayload()   { return reinterpret_cast<BYTE*>(this) + sizeof(LogRecord); }
+  size_t         GetLength()    { return m_size - sizeof(LogRecord); }
+};
+
+static_assert(sizeof(LogRecord) <= LOGRING_ALIGN,"Log record header must fit the ring alignment");
+
+class LogRing
+{
+public:
+  explicit LogRing(size_t p_size = LOGRING_SIZE);
+ ~LogRing();
+
+  // PRODUCER: Room for a record with a payload. nullptr if the ring is full
+  LogRecord* Reserve(size_t p_payload);
+  // PRODUCER: Publish the reserved record. Returns the bytes in use
+  size_t     Commit(LogRecord* p_record);
+
+  // CONSUMER: Next record, or nullptr if the ring is empty
+  LogRecord* Peek();
+  // CONSUMER: Done with the record from Peek
+  void       Release(LogRecord* p_record);
+
+  size_t     GetSize()                { return m_size;                }
+  bool       GetIsEmpty();
+  // Owning thread has ended
+  void       SetOrphan()              { m_orphan.store(true);         }
+  bool       GetOrphan()              { return m_orphan.load();       }
+
+private:
+  BYTE*  m_data { nullptr };
+  size_t m_size { 0 };
+  size_t m_mask { 0 };
+  size_t m_reserved { 0 };                      // Producer only: start of the reserved record
+  alignas(64) std::atomic<size_t> m_head { 0 }; // Written by the producer
+  alignas(64) std::atomic<size_t> m_tail { 0 }; // Written by the consumer
+  std::atomic<bool> m_orphan { false };
+};
+
+// Immortal copy of a function name or format string. nullptr if too many
+LPCTSTR LogIntern(LPCTSTR p_string);
+// Capture the arguments of a printf format. False if the format cannot be captured
+bool    LogCaptureArguments(LPCTSTR p_format,va_list p_args,std::vector<BYTE>& p_payload);
+// Format the captured arguments of a printf format, appending to the line
+void    LogFormatArguments(LPCTSTR p_format,const BYTE* p_payload,size_t p_length,XString& p_line);
@@ -0,0 +1,385 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: Metrics.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "pch.h"
+#include "Metrics.h"
+#include "AutoCritical.h"
+#include <intrin.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Threads get their shards round-robin
+static std::atomic<unsigned> g_metricThreads { 0 };
+
+unsigned
+MetricShard()
+{
+  static thread_local unsigned t_shard = g_metricThreads.fetch_add(1,std::memory_order_relaxed) & (METRIC_SHARDS - 1);
+  return t_shard;
+}
+
+// Ticks of the performance counter per microsecond
+static double
+MetricFrequency()
+{
+  static double frequency = []
+  {
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return (double)freq.QuadPart / 1000000.0;
+  }();
+  return frequency;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// COUNTER
+//
+//////////////////////////////////////////////////////////////////////////
+
+__int64
+MetricCounter::GetValue() const
+{
+  __int64 value = 0;
+  for(auto& shard : m_shards)
+  {
+    value += shard.m_value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// HISTOGRAM
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Values below 2 * METRIC_SUBBUCKETS have a bucket of their own.
+// Above that, every power of two is split in METRIC_SUBBUCKETS buckets.
+/*static*/ int
+MetricHistogram::GetBucket(unsigned __int64 p_microseconds)
+{
+  if(p_microseconds < 2 * METRIC_SUBBUCKETS)
+  {
+    return (int)p_microseconds;
+  }
+  unsigned long exponent = 0;
+  _BitScanReverse64(&exponent,p_microseconds);
+  int sub    = (int)(p_microseconds >> (exponent - 3)) & (METRIC_SUBBUCKETS - 1);
+  int bucket = ((int)exponent - 2) * METRIC_SUBBUCKETS + sub;
+  return bucket < METRIC_BUCKETS ? bucket : METRIC_BUCKETS - 1;
+}
+
+/*static*/ __int64
+MetricHistogram::GetBucketUpper(int p_bucket)
+{
+  if(p_bucket >= METRIC_BUCKETS - 1)
+  {
+    return _I64_MAX;
+  }
+  // Lowest value of the next bucket, minus one
+  int next = p_bucket + 1;
+  if(next < 2 * METRIC_SUBBUCKETS)
+  {
+    return next - 1;
+  }
+  int exponent = next / METRIC_SUBBUCKETS + 2;
+  int sub      = next % METRIC_SUBBUCKETS;
+  return (((__int64)METRIC_SUBBUCKETS + sub) << (exponent - 3)) - 1;
+}
+
+__int64
+MetricHistogram::GetCount() const
+{
+  __int64 count = 0;
+  for(auto& shard : m_shards)
+  {
+    count += shard.m_count.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+__int64
+MetricHistogram::GetSum() const
+{
+  __int64 sum = 0;
+  for(auto& shard : m_shards)
+  {
+    sum += shard.m_sum.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void
+MetricHistogram::GetBuckets(__int64* p_buckets) const
+{
+  for(int bucket = 0; bucket < METRIC_BUCKETS; ++bucket)
+  {
+    p_buckets[bucket] = 0;
+    for(auto& shard : m_shards)
+    {
+      p_buckets[bucket] += shard.m_buckets[bucket].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Percentile as in 99.9
+__int64
+MetricHistogram::GetPercentile(double p_percentile) const
+{
+  __int64 buckets[METRIC_BUCKETS];
+  GetBuckets(buckets);
+
+  __int64 total = 0;
+  for(auto count : buckets)
+  {
+    total += count;
+  }
+  if(total == 0)
+  {
+    return 0;
+  }
+  __int64 rank  = (__int64)((p_percentile / 100.0) * (double)total + 0.5);
+  __int64 count = 0;
+  for(int bucket = 0; bucket < METRIC_BUCKETS; ++bucket)
+  {
+    count += buckets[bucket];
+    if(count >= rank && count > 0)
+    {
+      return GetBucketUpper(bucket);
+    }
+  }
+  return GetBucketUpper(METRIC_BUCKETS - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// TIMER
+//
+//////////////////////////////////////////////////////////////////////////
+
+MetricTimer::MetricTimer(MetricHistogram* p_histogram)
+            :m_histogram(p_histogram)
+{
+  if(m_histogram && GetMetricsRegistry().GetEnabled())
+  {
+    QueryPerformanceCounter(&m_start);
+  }
+  else
+  {
+    m_histogram = nullptr;
+  }
+}
+
+MetricTimer::~MetricTimer()
+{
+  Stop();
+}
+
+void
+MetricTimer::Stop()
+{
+  if(m_histogram)
+  {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_histogram->Record((__int64)((double)(now.QuadPart - m_start.QuadPart) / MetricFrequency()));
+    m_histogram = nullptr;
+  }
+}
+
+void
+MetricTimer::Cancel()
+{
+  m_histogram = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// REGISTRY
+//
+//////////////////////////////////////////////////////////////////////////
+
+MetricsRegistry&
+GetMetricsRegistry()
+{
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+  InitializeCriticalSection(&m_lock);
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+  DeleteCriticalSection(&m_lock);
+}
+
+MetricsRegistry::MetricFamily*
+MetricsRegistry::GetFamily(XString& p_name,XString& p_help,bool p_histogram)
+{
+  auto it = m_families.find(p_name);
+  if(it == m_families.end())
+  {
+    MetricFamily& family = m_families[p_name];
+    family.m_help      = p_help;
+    family.m_histogram = p_histogram;
+    return &family;
+  }
+  if(it->second.m_histogram != p_histogram)
+  {
+    XString error;
+    error.Format(_T("Metric [%s] already registered as another type"),p_name.GetString());
+    throw StdException(error);
+  }
+  return &it->second;
+}
+
+MetricCounter*
+MetricsRegistry::GetCounter(XString p_name,XString p_help,XString p_labels /*= _T("")*/)
+{
+  AutoCritSec lock(&m_lock);
+
+  MetricFamily* family = GetFamily(p_name,p_help,false);
+  std::unique_ptr<MetricCounter>& counter = family->m_counters[p_labels];
+  if(!counter)
+  {
+    counter = std::make_unique<MetricCounter>();
+  }
+  return counter.get();
+}
+
+MetricHistogram*
+MetricsRegistry::GetHistogram(XString p_name,XString p_help,XString p_labels /*= _T("")*/)
+{
+  AutoCritSec lock(&m_lock);
+
+  MetricFamily* family = GetFamily(p_name,p_help,true);
+  std::unique_ptr<MetricHistogram>& histogram = family->m_histograms[p_labels];
+  if(!histogram)
+  {
+    histogram = std::make_unique<MetricHistogram>();
+  }
+  return histogram.get();
+}
+
+// Backslash, double quote and newline must be escaped
+/*static*/ XString
+MetricsRegistry::LabelValue(XString p_value)
+{
+  p_value.Replace(_T("\\"),_T("\\\\"));
+  p_value.Replace(_T("\""),_T("\\\""));
+  p_value.Replace(_T("\n"),_T("\\n"));
+  return _T("\"") + p_value + _T("\"");
+}
+
+XString
+MetricsRegistry::ExportPrometheus()
+{
+  AutoCritSec lock(&m_lock);
+  XString result;
+
+  for(auto& fam : m_families)
+  {
+    const XString& name  = fam.first;
+    MetricFamily& family = fam.second;
+    XString line;
+
+    line.Format(_T("# HELP %s %s\n# TYPE %s %s\n"),name.GetString(),family.m_help.GetString()
+                                                  ,name.GetString(),family.m_histogram ? _T("histogram") : _T("counter"));
+    result += line;
+
+    for(auto& counter : family.m_counters)
+    {
+      if(counter.first.IsEmpty())
+      {
+        line.Format(_T("%s %I64d\n"),name.GetString(),counter.second->GetValue());
+      }
+      else
+      {
+        line.Format(_T("%s{%s} %I64d\n"),name.GetString(),counter.first.GetString(),counter.second->GetValue());
+      }
+      result += line;
+    }
+    for(auto& histogram : family.m_histograms)
+    {
+      ExportHistogram(result,name,histogram.first,histogram.second.get());
+    }
+  }
+  return result;
+}
+
+// Cumulative buckets at every power of two of microseconds
+// Values are in seconds, as is the custom for Prometheus
+void
+MetricsRegistry::ExportHistogram(XString& p_result,const XString& p_name,const XString& p_labels,MetricHistogram* p_histogram)
+{
+  __int64 buckets[METRIC_BUCKETS];
+  p_histogram->GetBuckets(buckets);
+
+  XString labels(p_labels);
+  if(!labels.IsEmpty())
+  {
+    labels += _T(",");
+  }
+
+  XString line;
+  __int64 cumulative = 0;
+  int     bucket     = 0;
+  for(int exponent = 0; exponent <= METRIC_EXPONENTS; ++exponent)
+  {
+    // All buckets with values up to and including 2^exponent microseconds
+    // Prometheus "le" bounds are inclusive
+    __int64 bound = (__int64)1 << exponent;
+    while(bucket < METRIC_BUCKETS - 1 && MetricHistogram::GetBucketUpper(bucket) <= bound)
+    {
+      cumulative += buckets[bucket++];
+    }
+    line.Format(_T("%s_bucket{%sle=\"%.6f\"} %I64d\n"),p_name.GetString(),labels.GetString(),(double)bound / 1000000.0,cumulative);
+    p_result += line;
+  }
+  // Totals: the count is the sum of the buckets, so +Inf is consistent
+  while(bucket < METRIC_BUCKETS)
+  {
+    cumulative += buckets[bucket++];
+  }
+  line.Format(_T("%s_bucket{%sle=\"+Inf\"} %I64d\n"),p_name.GetString(),labels.GetString(),cumulative);
+  p_result += line;
+
+  XString braces = p_labels.IsEmpty() ? XString() : _T("{") + p_labels + _T("}");
+  line.Format(_T("%s_sum%s %.6f\n%s_count%s %I64d\n"),p_name.GetString(),braces.GetString(),(double)p_histogram->GetSum() / 1000000.0
+                                                      ,p_name.GetString(),braces.GetString(),cumulative);
+  p_result += line;
+}
@@ -0,0 +1,181 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: Metrics.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////
+//
+// METRICS
+//
+// Counters and latency histograms of the running process, to be read
+// without parsing logfiles. Exported in the Prometheus text format.
+//
+// Counters and histograms are sharded: every thread adds to its own
+// cache line, so hot paths do not contend on one shared counter.
+// Histograms are HDR-style: a bucket for every 1/8 of a power of two
+// of microseconds, giving about 12% precision from 1us up to days.
+//
+// Usage:
+// static MetricHistogram* s_time = GetMetricsRegistry().GetHistogram(_T("my_call_seconds"),_T("Duration of my call"));
+// MetricTimer timer(s_time);   // Records the elapsed time when going out of scope
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+
+#define METRIC_SHARDS        8   // Number of shards (power of two)
+#define METRIC_SUBBUCKETS    8   // Buckets per power of two microseconds
+#define METRIC_EXPONENTS    36   // Powers of two of microseconds
+#define METRIC_BUCKETS      (METRIC_EXPONENTS * METRIC_SUBBUCKETS)
+
+// Shard of the calling thread
+unsigned MetricShard();
+
+// Counter that only goes up
+class MetricCounter
+{
+public:
+  void    Add(__int64 p_value = 1);
+  __int64 GetValue() const;
+
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<__int64> m_value { 0 };
+  };
+  Shard m_shards[METRIC_SHARDS];
+};
+
+// Latency histogram in microseconds
+class MetricHistogram
+{
+public:
+  // Record one observation
+  void    Record(__int64 p_microseconds);
+
+  // GETTERS (sums over all shards)
+  __int64 GetCount() const;
+  __int64 GetSum() const;                         // In microseconds
+  __int64 GetPercentile(double p_percentile) const; // Upper bound in microseconds
+  void    GetBuckets(__int64* p_buckets) const;   // METRIC_BUCKETS counts
+
+  // Bucket of a value, and the highest value in a bucket
+  static int     GetBucket(unsigned __int64 p_microseconds);
+  static __int64 GetBucketUpper(int p_bucket);
+
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<__int64> m_count { 0 };
+    std::atomic<__int64> m_sum   { 0 };
+    std::atomic<__int64> m_buckets[METRIC_BUCKETS] {};
+  };
+  Shard m_shards[METRIC_SHARDS];
+};
+
+// Times a scope and records it in a histogram
+class MetricTimer
+{
+public:
+  explicit MetricTimer(MetricHistogram* p_histogram);
+ ~MetricTimer();
+
+  // Record now, instead of at the end of the scope
+  void Stop();
+  // Do not record at all (e.g. a failed action)
+  void Cancel();
+
+private:
+  MetricHistogram* m_histogram;
+  LARGE_INTEGER    m_start;
+};
+
+// All metrics of the process, by name and labels
+class MetricsRegistry
+{
+public:
+  MetricsRegistry();
+ ~MetricsRegistry();
+
+  // Find or create a metric. Labels as in: site="/MySite/"
+  // Metrics are never removed, so the pointers can be kept by the caller
+  MetricCounter*   GetCounter  (XString p_name,XString p_help,XString p_labels = _T(""));
+  MetricHistogram* GetHistogram(XString p_name,XString p_help,XString p_labels = _T(""));
+
+  // All metrics in the Prometheus text exposition format (version 0.0.4)
+  XString ExportPrometheus();
+
+  // Switching the timers off and on
+  void    SetEnabled(bool p_enabled)  { m_enabled = p_enabled; }
+  bool    GetEnabled() const          { return m_enabled;      }
+
+  // Label value with escaped characters
+  static XString LabelValue(XString p_value);
+
+private:
+  struct MetricFamily
+  {
+    XString m_help;
+    bool    m_histogram { false };
+    std::map<XString,std::unique_ptr<MetricCounter>>   m_counters;
+    std::map<XString,std::unique_ptr<MetricHistogram>> m_histograms;
+  };
+  MetricFamily* GetFamily(XString& p_name,XString& p_help,bool p_histogram);
+  void          ExportHistogram(XString& p_result,const XString& p_name,const XString& p_labels,MetricHistogram* p_histogram);
+
+  std::map<XString,MetricFamily> m_families;
+  std::atomic<bool>              m_enabled { true };
+  CRITICAL_SECTION               m_lock;
+};
+
+// The registry of this process
+MetricsRegistry& GetMetricsRegistry();
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Inline for the hot paths
+//
+//////////////////////////////////////////////////////////////////////////
+
+inline void
+MetricCounter::Add(__int64 p_value /*= 1*/)
+{
+  m_shards[MetricShard()].m_value.fetch_add(p_value,std::memory_order_relaxed);
+}
+
+inline void
+MetricHistogram::Record(__int64 p_microseconds)
+{
+  if(p_microseconds < 0)
+  {
+    p_microseconds = 0;
+  }
+  Shard& shard = m_shards[MetricShard()];
+  shard.m_buckets[GetBucket((unsigned __int64)p_microseconds)].fetch_add(1,std::memory_order_relaxed);
+  shard.m_sum  .fetch_add(p_microseconds,std::memory_order_relaxed);
+  shard.m_count.fetch_add(1,std::memory_order_relaxed);
+}
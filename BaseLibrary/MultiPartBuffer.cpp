@@ -845,9 +845,38 @@ MultiPartBuffer::FindPartBuffer(uchar*& p_finding,size_t& p_remaining,BYTE* p_bo
 // --#BOUNDARY#12345678901234
 void
 MultiPartBuffer::AddRawBufferPart(uchar* p_partialBegin,const uchar* p_partialEnd,bool p_conversion)
+{
+  XString charset;
+  MultiPart* part = ReadPartHeaders(p_partialBegin,p_partialEnd,charset);
+
+  // Getting the contents
+  if(part->GetShortFileName().IsEmpty())
+  {
+    // PART
+    // Buffer is the data component
+    SetPartData(part,p_partialBegin,p_partialEnd,charset,p_conversion);
+  }
+  else
+  {
+    // FILE
+    // Add buffer as my file buffer in one go
+    FileBuffer* buffer = part->GetBuffer();
+    size_t length = p_partialEnd - p_partialBegin;
+
+    // Place in file buffer
+    buffer->SetBuffer(p_partialBegin,length);
+  }
+  // Do not forget to save this part
+  m_parts.push_back(part);
+}
+
+// Reading the header lines of a buffer part into a new MultiPart
+// Positions the begin pointer after the empty line that ends the headers
+MultiPart*
+MultiPartBuffer::ReadPartHeaders(uchar*& p_partialBegin,const uchar* p_partialEnd,XString& p_charset)
 {
   MultiPart* part = new MultiPart();
-  XString charset,boundary;
+  XString boundary;
 
   while(true)
   {
@@ -861,17 +890,17 @@ MultiPartBuffer::AddRawBufferPart(uchar* p_partialBegin,const uchar* p_partialEn
     // Finding the result for the header lines of the buffer part
     if(header.Left(12).CompareNoCase(_T("Content-Type")) == 0)
     {
-      charset  = FindFieldInHTTPHeader(value,_T("charset"));
-      boundary = FindFieldInHTTPHeader(value,_T("boundary"));
+      p_charset = FindFieldInHTTPHeader(value,_T("charset"));
+      boundary  = FindFieldInHTTPHeader(value,_T("boundary"));
       part->SetContentType(value);
-      part->SetCharset(charset);
+      part->SetCharset(p_charset);
       part->SetBoundary(boundary);
 
       // In case we have no charset in the Content-Type and we already
       // saw a incoming MultiPart with the name "_charset_"
-      if(charset.IsEmpty() && !m_incomingCharset.IsEmpty())
+      if(p_charset.IsEmpty() && !m_incomingCharset.IsEmpty())
       {
-        charset = m_incomingCharset;
+        p_charset = m_incomingCharset;
       }
     }
     else if(header.CompareNoCase(_T("Content-Disposition")) == 0)
@@ -890,74 +919,61 @@ MultiPartBuffer::AddRawBufferPart(uchar* p_partialBegin,const uchar* p_partialEn
       part->AddHeader(header,value);
     }
   }
+  return part;
+}
 
+// Setting the raw data of a non-file part as the string data
+void
+MultiPartBuffer::SetPartData(MultiPart* p_part,uchar* p_partialBegin,const uchar* p_partialEnd,XString p_charset,bool p_conversion)
+{
   // RFC 7578: No charset = conversion to UTF-8
   // UTF-8 is the default conversion of the conversion routines
   // so an empty charset means: convert to UTF-8
-  if(charset.CompareNoCase(_T("windows-1252")) != 0)
+  if(p_charset.CompareNoCase(_T("windows-1252")) != 0)
   {
     p_conversion = true;
   }
 
-  // Getting the contents
-  if(part->GetShortFileName().IsEmpty())
-  {
-    // PART
-    // Buffer is the data component
+  XString data;
 
-    XString data;
-
-    if(m_charSize == 1)
-    {
+  if(m_charSize == 1)
+  {
 #ifdef _UNICODE
-      size_t length = (p_partialEnd - p_partialBegin);
-      data = ExplodeString(p_partialBegin,(unsigned)length);
+    size_t length = (p_partialEnd - p_partialBegin);
+    data = ExplodeString(p_partialBegin,(unsigned)length);
 #else
-      size_t length = (p_partialEnd - p_partialBegin);
-      char* pnt = data.GetBufferSetLength((int)length + 1);
-      strncpy_s(pnt,length + 1,(char*)p_partialBegin,length);
-      data.ReleaseBufferSetLength((int)length);
+    size_t length = (p_partialEnd - p_partialBegin);
+    char* pnt = data.GetBufferSetLength((int)length + 1);
+    strncpy_s(pnt,length + 1,(char*)p_partialBegin,length);
+    data.ReleaseBufferSetLength((int)length);
 #endif
-    }
-    else
-    {
+  }
+  else
+  {
 #ifdef _UNICODE
-      size_t length = (p_partialEnd - p_partialBegin) / m_charSize;
-      PTCHAR buffer = data.GetBufferSetLength((int) length + 1);
-      _tcsncpy_s(buffer,length + 1,reinterpret_cast<const PTCHAR>(p_partialBegin),length);
-      buffer[length] = 0;
-      data.ReleaseBuffer((int) length);
+    size_t length = (p_partialEnd - p_partialBegin) / m_charSize;
+    PTCHAR buffer = data.GetBufferSetLength((int) length + 1);
+    _tcsncpy_s(buffer,length + 1,reinterpret_cast<const PTCHAR>(p_partialBegin),length);
+    buffer[length] = 0;
+    data.ReleaseBuffer((int) length);
 #else
-      size_t length = (p_partialEnd - p_partialBegin);
-      data = ImplodeString(p_partialBegin,(unsigned)length);
+    size_t length = (p_partialEnd - p_partialBegin);
+    data = ImplodeString(p_partialBegin,(unsigned)length);
 #endif
-    }
-    // Decoding the string, possible changing the length
-    if(p_conversion)
-    {
-      data = DecodeStringFromTheWire(data,charset);
-    }
-    // Place in MultiPart
-    part->SetData(data);
-
-    // Special charset convention on incoming messages
-    if(part->GetName().CompareNoCase(_T("_charset_")) == 0)
-    {
-      m_incomingCharset = data;
-    }
   }
-  else
+  // Decoding the string, possible changing the length
+  if(p_conversion)
   {
-    // FILE
-    // Add buffer as my file buffer in one go
-    FileBuffer* buffer = part->GetBuffer();
-    size_t length = p_partialEnd - p_partialBegin;
+    data = DecodeStringFromTheWire(data,p_charset);
+  }
+  // Place in MultiPart
+  p_part->SetData(data);
 
-    // Place in file buffer
-    buffer->SetBuffer(p_partialBegin,length);
+  // Special charset convention on incoming messages
+  if(p_part->GetName().CompareNoCase(_T("_charset_")) == 0)
+  {
+    m_incomingCharset = data;
   }
-  // Do not forget to save this part
-  m_parts.push_back(part);
 }
 
 XString
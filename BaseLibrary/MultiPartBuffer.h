@@ -171,6 +171,9 @@ public:
   bool         GetUseCharset()                     { return m_useCharset;         };
 
 private:
+  // The streaming parser builds the parts incrementally
+  friend class MultiPartStream;
+
   // Find which type of formdata we are receiving
   FormDataType FindBufferType(XString p_contentType);
   // Find the boundary in the content-type header
@@ -186,6 +189,8 @@ private:
   void         CalculateBinaryBoundary(XString p_boundary,BYTE*& p_binary,unsigned& p_length);
     // Adding a part from a raw buffer
   void         AddRawBufferPart(uchar* p_partialBegin,const uchar* p_partialEnd,bool p_conversion);
+  MultiPart*   ReadPartHeaders(uchar*& p_partialBegin,const uchar* p_partialEnd,XString& p_charset);
+  void         SetPartData(MultiPart* p_part,uchar* p_partialBegin,const uchar* p_partialEnd,XString p_charset,bool p_conversion);
   // Check that name is in the ASCII range for a data part
   bool         CheckName(XString p_name);
 
@@ -0,0 +1,411 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: MultiPartStream.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "pch.h"
+#include "MultiPartStream.h"
+#include "ConvertWideString.h"
+#include <algorithm>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+MultiPartStream::MultiPartStream(XString p_contentType,XString p_directory /*= ""*/,bool p_conversion /*= false*/)
+                :m_delimiter(MakeDelimiter(p_contentType))
+                ,m_searcher(m_delimiter.cbegin(),m_delimiter.cend())
+                ,m_directory(p_directory)
+                ,m_conversion(p_conversion)
+{
+  if(m_delimiter.empty())
+  {
+    SetError(_T("No boundary in the multipart content type: ") + p_contentType);
+    return;
+  }
+  m_buffer.m_boundary = FindFieldInHTTPHeader(p_contentType,_T("boundary"));
+
+  // The first boundary may be the very start of the body
+  // By starting with a CR/LF, every boundary is a complete delimiter
+  m_pending = "\r\n";
+}
+
+MultiPartStream::~MultiPartStream()
+{
+  if(m_part)
+  {
+    if(m_isFile)
+    {
+      OnFileEnd(m_part,false);
+    }
+    delete m_part;
+    m_part = nullptr;
+  }
+  if(!m_keepFiles)
+  {
+    for(auto& filename : m_tempFiles)
+    {
+      // Could already be moved away by the handler
+      ::DeleteFile(filename.GetString());
+    }
+  }
+}
+
+// The delimiter between the parts is: CR/LF "--" boundary
+// Boundaries are always 7-bit ASCII (RFC 2046)
+/*static*/ std::string
+MultiPartStream::MakeDelimiter(XString p_contentType)
+{
+  std::string delimiter;
+  XString boundary = FindFieldInHTTPHeader(p_contentType,_T("boundary"));
+  if(!boundary.IsEmpty())
+  {
+    delimiter = "\r\n--";
+    for(int ind = 0; ind < boundary.GetLength(); ++ind)
+    {
+      delimiter += static_cast<char>(boundary.GetAt(ind));
+    }
+  }
+  return delimiter;
+}
+
+bool
+MultiPartStream::OnBodyChunk(const uchar* p_data,size_t p_length)
+{
+  m_received += p_length;
+
+  if(m_state == StreamState::Failed)
+  {
+    return false;
+  }
+  if(m_state == StreamState::Epilogue)
+  {
+    // Anything after the closing boundary is ignored
+    return true;
+  }
+  m_pending.append(reinterpret_cast<const char*>(p_data),p_length);
+
+  bool proceed = true;
+  while(proceed)
+  {
+    switch(m_state)
+    {
+      case StreamState::Preamble:  proceed = ProcessPreamble();  break;
+      case StreamState::Delimiter: proceed = ProcessDelimiter(); break;
+      case StreamState::Headers:   proceed = ProcessHeaders();   break;
+      case StreamState::Data:      proceed = ProcessData();      break;
+      case StreamState::Epilogue:  m_position = m_pending.size();
+                                   proceed = false;
+                                   break;
+      case StreamState::Failed:    return false;
+    }
+  }
+
+  // Keep track of the memory we are using for the body
+  m_peakMemory = (std::max)(m_peakMemory,m_pending.size() + m_data.size());
+
+  // Only the unprocessed tail (at most a delimiter or a header block) remains
+  m_pending.erase(0,m_position);
+  m_position = 0;
+
+  return m_state != StreamState::Failed;
+}
+
+bool
+MultiPartStream::OnBodyEnd(bool p_complete)
+{
+  if(m_part)
+  {
+    if(m_isFile)
+    {
+      OnFileEnd(m_part,false);
+    }
+    delete m_part;
+    m_part = nullptr;
+  }
+  if(m_state != StreamState::Failed)
+  {
+    if(!p_complete)
+    {
+      SetError(_T("Incomplete multipart body received"));
+    }
+    else if(!m_complete)
+    {
+      SetError(_T("Closing boundary of the multipart body is missing"));
+    }
+  }
+  m_pending.clear();
+  m_pending.shrink_to_fit();
+  m_position = 0;
+
+  return m_state != StreamState::Failed;
+}
+
+bool
+MultiPartStream::SetError(XString p_error)
+{
+  if(m_error.IsEmpty())
+  {
+    m_error = p_error;
+  }
+  m_state = StreamState::Failed;
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE PARSER STATES
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Skip everything up to the first boundary
+bool
+MultiPartStream::ProcessPreamble()
+{
+  auto found = std::search(m_pending.cbegin() + m_position,m_pending.cend(),m_searcher);
+  if(found == m_pending.cend())
+  {
+    // Keep a possible partial delimiter at the end
+    size_t keep = (std::min)(m_pending.size() - m_position,m_delimiter.size() - 1);
+    m_position  = m_pending.size() - keep;
+    return false;
+  }
+  m_position = (found - m_pending.cbegin()) + m_delimiter.size();
+  m_state    = StreamState::Delimiter;
+  return true;
+}
+
+// After a boundary: "--" for the closing boundary or CR/LF for a next part
+bool
+MultiPartStream::ProcessDelimiter()
+{
+  size_t available = m_pending.size() - m_position;
+  if(available < 2)
+  {
+    return false;
+  }
+  if(m_pending.compare(m_position,2,"--") == 0)
+  {
+    m_position += 2;
+    m_state     = StreamState::Epilogue;
+    m_complete  = true;
+    return true;
+  }
+  size_t endline = m_pending.find("\r\n",m_position);
+  if(endline == std::string::npos)
+  {
+    if(available > m_maxHeaders)
+    {
+      return SetError(_T("Malformed multipart boundary line"));
+    }
+    return false;
+  }
+  // Only transport padding is allowed after the boundary
+  for(size_t ind = m_position; ind < endline; ++ind)
+  {
+    if(m_pending[ind] != ' ' && m_pending[ind] != '\t')
+    {
+      return SetError(_T("Malformed multipart boundary line"));
+    }
+  }
+  m_position = endline + 2;
+  m_state    = StreamState::Headers;
+  return true;
+}
+
+// Reading the header block of a part, up to and including the empty line
+bool
+MultiPartStream::ProcessHeaders()
+{
+  size_t ending = 0;
+  if(m_pending.compare(m_position,2,"\r\n") == 0)
+  {
+    // A part without any headers
+    ending = m_position + 2;
+  }
+  else
+  {
+    size_t found = m_pending.find("\r\n\r\n",m_position);
+    if(found == std::string::npos)
+    {
+      if(m_pending.size() - m_position > m_maxHeaders)
+      {
+        return SetError(_T("Headers of a multipart part are too large"));
+      }
+      return false;
+    }
+    ending = found + 4;
+  }
+  if(ending - m_position > m_maxHeaders)
+  {
+    return SetError(_T("Headers of a multipart part are too large"));
+  }
+
+  // Parse the headers the same way as the complete buffer parser does
+  std::vector<uchar> headers(m_pending.cbegin() + m_position,m_pending.cbegin() + ending);
+  headers.push_back(0);
+  uchar* begin = headers.data();
+  m_charset.Empty();
+  m_part     = m_buffer.ReadPartHeaders(begin,headers.data() + headers.size() - 1,m_charset);
+  m_isFile   = !m_part->GetShortFileName().IsEmpty();
+  m_fileSize = 0;
+  m_data.clear();
+  m_position = ending;
+
+  if(m_isFile && !OnFileBegin(m_part))
+  {
+    return SetError(_T("Cannot store the file part: ") + m_part->GetShortFileName());
+  }
+  m_state = StreamState::Data;
+  return true;
+}
+
+// Passing on the contents of a part, up to the next delimiter
+bool
+MultiPartStream::ProcessData()
+{
+  auto found = std::search(m_pending.cbegin() + m_position,m_pending.cend(),m_searcher);
+  if(found == m_pending.cend())
+  {
+    // Everything but a possible partial delimiter at the end
+    size_t available = m_pending.size() - m_position;
+    size_t keep      = (std::min)(available,m_delimiter.size() - 1);
+    size_t length    = available - keep;
+    if(length && !PartData(m_pending.data() + m_position,length))
+    {
+      return false;
+    }
+    m_position += length;
+    return false;
+  }
+  size_t delimiter = found - m_pending.cbegin();
+  if(!PartData(m_pending.data() + m_position,delimiter - m_position))
+  {
+    return false;
+  }
+  m_position = delimiter + m_delimiter.size();
+  if(!PartEnd())
+  {
+    return false;
+  }
+  m_state = StreamState::Delimiter;
+  return true;
+}
+
+bool
+MultiPartStream::PartData(const char* p_data,size_t p_length)
+{
+  if(p_length == 0)
+  {
+    return true;
+  }
+  if(m_isFile)
+  {
+    m_fileSize += p_length;
+    if(!OnFileData(m_part,reinterpret_cast<const uchar*>(p_data),p_length))
+    {
+      return SetError(_T("Cannot store the file part: ") + m_part->GetShortFileName());
+    }
+    return true;
+  }
+  if(m_data.size() + p_length > m_maxDataPart)
+  {
+    return SetError(_T("Multipart data part is too large: ") + m_part->GetName());
+  }
+  m_data.append(p_data,p_length);
+  return true;
+}
+
+bool
+MultiPartStream::PartEnd()
+{
+  if(m_isFile)
+  {
+    m_part->SetSize(m_fileSize);
+    if(!OnFileEnd(m_part,true))
+    {
+      return SetError(_T("Cannot store the file part: ") + m_part->GetShortFileName());
+    }
+  }
+  else
+  {
+    uchar* begin = reinterpret_cast<uchar*>(m_data.data());
+    m_buffer.SetPartData(m_part,begin,begin + m_data.size(),m_charset,m_conversion);
+    m_data.clear();
+  }
+  m_buffer.m_parts.push_back(m_part);
+  m_part = nullptr;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// FILE PARTS: Default is a temporary file on disk
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+MultiPartStream::OnFileBegin(MultiPart* /*p_part*/)
+{
+  XString directory(m_directory);
+  if(directory.IsEmpty())
+  {
+    // Directory for GetTempFileName cannot be larger than (MAX_PATH-14)
+    TCHAR tempdirectory[MAX_PATH - 14];
+    ::GetTempPath(MAX_PATH - 14,tempdirectory);
+    directory = tempdirectory;
+  }
+  TCHAR tempfilename[MAX_PATH + 1];
+  if(::GetTempFileName(directory.GetString(),_T("MPS"),0,tempfilename) == 0)
+  {
+    return false;
+  }
+  m_tempFiles.push_back(tempfilename);
+
+  m_file.SetFilename(tempfilename);
+  return m_file.Open(winfile_write | open_trans_binary);
+}
+
+bool
+MultiPartStream::OnFileData(MultiPart* /*p_part*/,const uchar* p_data,size_t p_length)
+{
+  return m_file.Write(const_cast<uchar*>(p_data),p_length);
+}
+
+bool
+MultiPartStream::OnFileEnd(MultiPart* p_part,bool p_complete)
+{
+  bool result = m_file.Close();
+  if(p_complete && result)
+  {
+    // The FileBuffer of the part now refers to the file on disk
+    p_part->GetBuffer()->SetFileName(m_file.GetFilename());
+  }
+  return result;
+}
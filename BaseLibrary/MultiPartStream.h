@@ -0,0 +1,130 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: MultiPartStream.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Incremental parser of an incoming "multipart/form-data" body.
+// Gets the body in chunks through the BodySink interface and builds
+// the same MultiPartBuffer as MultiPartBuffer::ParseBuffer does,
+// without ever holding the complete body in memory.
+// - Data parts are collected in memory (up to a maximum size)
+// - File parts are written to a temporary file on disk. The FileBuffer
+//   of the MultiPart refers to that file by its filename.
+//   Derived classes can redirect file data elsewhere by overriding the
+//   OnFileBegin/OnFileData/OnFileEnd functions.
+// Temporary files are removed when the stream is destroyed, unless they
+// have been moved out of the way by the handler (or SetKeepFiles is used)
+//
+#pragma once
+#include "BodySink.h"
+#include "MultiPartBuffer.h"
+#include "WinFile.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+// Default maximum size of a non-file part
+#define MPSTREAM_MAX_DATAPART   (1024 * 1024)
+// Default maximum size of the headers of one part
+#define MPSTREAM_MAX_HEADERS    (16 * 1024)
+
+class MultiPartStream : public BodySink
+{
+public:
+  explicit MultiPartStream(XString p_contentType,XString p_directory = _T(""),bool p_conversion = false);
+  virtual ~MultiPartStream();
+
+  // BodySink interface
+  virtual bool OnBodyChunk(const uchar* p_data,size_t p_length) override;
+  virtual bool OnBodyEnd(bool p_complete) override;
+
+  // SETTERS
+  void    SetMaxDataPart(size_t p_maximum)      { m_maxDataPart = p_maximum; }
+  void    SetMaxHeaders(size_t p_maximum)       { m_maxHeaders  = p_maximum; }
+  void    SetKeepFiles(bool p_keep)             { m_keepFiles   = p_keep;    }
+
+  // GETTERS
+  MultiPartBuffer* GetMultiPartBuffer()         { return &m_buffer;          }
+  bool    GetIsComplete()                       { return m_complete;         }
+  XString GetError()                            { return m_error;            }
+  size_t  GetBytesReceived()                    { return m_received;         }
+  size_t  GetPeakMemory()                       { return m_peakMemory;       }
+
+protected:
+  // Streaming of the contents of a file part. Default is a temporary file
+  virtual bool OnFileBegin(MultiPart* p_part);
+  virtual bool OnFileData (MultiPart* p_part,const uchar* p_data,size_t p_length);
+  virtual bool OnFileEnd  (MultiPart* p_part,bool p_complete);
+
+  // Stop parsing with an error
+  bool    SetError(XString p_error);
+
+private:
+  enum class StreamState
+  {
+     Preamble     // Before the first boundary
+    ,Delimiter    // Just after a boundary: "--" or CR/LF
+    ,Headers      // Reading the headers of a part
+    ,Data         // Reading the contents of a part
+    ,Epilogue     // After the closing boundary
+    ,Failed       // Stopped on an error
+  };
+  using Searcher = std::boyer_moore_horspool_searcher<std::string::const_iterator>;
+
+  static std::string MakeDelimiter(XString p_contentType);
+  // Process the pending input for one state. False if more input is needed
+  bool    ProcessPreamble();
+  bool    ProcessDelimiter();
+  bool    ProcessHeaders();
+  bool    ProcessData();
+  // Contents of the current part
+  bool    PartData(const char* p_data,size_t p_length);
+  bool    PartEnd();
+
+  std::string     m_delimiter;                    // CR/LF "--" boundary
+  Searcher        m_searcher;                     // Searching the delimiter in the input
+  MultiPartBuffer m_buffer { FormDataType::FD_MULTIPART };
+  XString         m_directory;                    // Directory for temporary files
+  bool            m_conversion  { false };        // Convert data parts from the wire
+  StreamState     m_state       { StreamState::Preamble };
+  std::string     m_pending;                      // Input not yet processed
+  size_t          m_position    { 0 };            // Processed up to here in m_pending
+  // Current part
+  MultiPart*      m_part        { nullptr };
+  XString         m_charset;                      // Charset of the current part
+  bool            m_isFile      { false };        // Current part is a file part
+  std::string     m_data;                         // Contents of a data part
+  WinFile         m_file;                         // Temporary file of a file part
+  size_t          m_fileSize    { 0 };
+  std::vector<XString> m_tempFiles;               // All temporary files
+  // Limits and statistics
+  size_t          m_maxDataPart { MPSTREAM_MAX_DATAPART };
+  size_t          m_maxHeaders  { MPSTREAM_MAX_HEADERS  };
+  bool            m_keepFiles   { false };
+  bool            m_complete    { false };
+  size_t          m_received    { 0 };
+  size_t          m_peakMemory  { 0 };
+  XString         m_error;
+};
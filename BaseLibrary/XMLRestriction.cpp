@@ -51,6 +51,29 @@ XMLRestriction::AddEnumeration(XString p_enum,XString p_displayValue /*=""*/)
   if(!HasEnumeration(p_enum))
   {
     m_enums.insert(std::make_pair(p_enum,p_displayValue));
+    XString upper(p_enum);
+    upper.MakeUpper();
+    m_enumsUpper.insert(upper);
+  }
+}
+
+// Pattern is compiled only once, not on every check
+// An invalid pattern is reported by the check itself
+void
+XMLRestriction::AddPattern(XString p_pattern)
+{
+  m_pattern = p_pattern;
+  m_regex.reset();
+  if(!m_pattern.IsEmpty())
+  {
+    try
+    {
+      m_regex = std::make_shared<XmlRegex>(m_pattern.GetString());
+    }
+    catch(std::regex_error&)
+    {
+      m_regex.reset();
+    }
   }
 }
 
@@ -60,6 +83,7 @@ XMLRestriction::AddMaxExclusive(XString p_max)
   m_maxExclusive        = p_max; 
   m_maxExclusiveDouble  = p_max.GetString();
   m_maxExclusiveInteger = _ttoi64(p_max);
+  m_rangeType           = 0;
 }
 
 void
@@ -68,6 +92,7 @@ XMLRestriction::AddMaxInclusive(XString p_max)
   m_maxInclusive        = p_max; 
   m_maxInclusiveDouble  = p_max;
   m_maxInclusiveInteger = _ttoi64(p_max);
+  m_rangeType           = 0;
 }
 
 void
@@ -76,6 +101,7 @@ XMLRestriction::AddMinExclusive(XString p_max)
   m_minExclusive        = p_max; 
   m_minExclusiveDouble  = p_max;
   m_minExclusiveInteger = _ttoi64(p_max);
+  m_rangeType           = 0;
 }
 
 void
@@ -84,6 +110,7 @@ XMLRestriction::AddMinInclusive(XString p_max)
   m_minInclusive        = p_max; 
   m_minInclusiveDouble  = p_max;
   m_minInclusiveInteger = _ttoi64(p_max);
+  m_rangeType           = 0;
 }
 
 void
@@ -417,184 +444,136 @@ XMLRestriction::CheckRangeDecimal(XString p_value)
   return _T("");
 }
 
-XString
-XMLRestriction::CheckRangeTime(XString p_time)
+// Kind of temporal range for a datatype, or zero for non-temporal types
+static XmlDataType
+RangeKind(XmlDataType p_type)
 {
-  if(!m_minInclusive.IsEmpty())
+  switch(p_type)
   {
-    INT64 min = XMLTime(m_minInclusive).GetValue();
-    INT64 val = XMLTime(p_time).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
+    case XDT_Time:              return XDT_Time;
+    case XDT_Date:              return XDT_Date;
+    case XDT_DateTime:          [[fallthrough]];
+    case XDT_DateTimeStamp:     return XDT_DateTime;
+    case XDT_Duration:          [[fallthrough]];
+    case XDT_DayTimeDuration:   [[fallthrough]];
+    case XDT_YearMonthDuration: return XDT_Duration;
+    case XDT_GregYearMonth:     return XDT_GregYearMonth;
+    case XDT_GregMonthDay:      return XDT_GregMonthDay;
+    default:                    return 0;
   }
-  if(!m_minExclusive.IsEmpty())
+}
+
+// Parse the bounds of a temporal range once, so checking a field
+// only has to convert the value of the field itself.
+// Numeric bounds are already converted by the AddMin/AddMax methods.
+// These also reset m_rangeType, so a changed bound is compiled again.
+void
+XMLRestriction::CompileRanges(XmlDataType p_type)
+{
+  XmlDataType kind = RangeKind(p_type);
+  if(kind == 0 || m_rangeType != 0)
   {
-    INT64 min = XMLTime(m_minExclusive).GetValue();
-    INT64 val = XMLTime(p_time).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
+    return;
   }
-  if(!m_maxInclusive.IsEmpty())
+  try
   {
-    INT64 max = XMLTime(m_maxInclusive).GetValue();
-    INT64 val = XMLTime(p_time).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
+    if(!m_minInclusive.IsEmpty()) m_minInclusiveValue = RangeValue(kind,m_minInclusive);
+    if(!m_minExclusive.IsEmpty()) m_minExclusiveValue = RangeValue(kind,m_minExclusive);
+    if(!m_maxInclusive.IsEmpty()) m_maxInclusiveValue = RangeValue(kind,m_maxInclusive);
+    if(!m_maxExclusive.IsEmpty()) m_maxExclusiveValue = RangeValue(kind,m_maxExclusive);
+    m_rangeType = kind;
   }
-  if(!m_maxExclusive.IsEmpty())
+  catch(StdException&)
   {
-    INT64 max = XMLTime(m_maxExclusive).GetValue();
-    INT64 val = XMLTime(p_time).GetValue();
-    if(val > max) return _T("Value too big. >= maxExclusive");
+    // Bounds not of this datatype: leave them to the field check
   }
-  return _T("");
+}
+
+INT64
+XMLRestriction::RangeValue(XmlDataType p_kind,XString p_value)
+{
+  switch(p_kind)
+  {
+    case XDT_Time:          return XMLTime(p_value).GetValue();
+    case XDT_Date:          return XMLDate(p_value).GetValue();
+    case XDT_DateTime:      return XMLTimestamp(p_value).GetValue();
+    case XDT_Duration:      return XMLDuration(p_value).GetValue();
+    case XDT_GregYearMonth: return XMLGregorianYM(p_value).GetValue();
+    case XDT_GregMonthDay:  return XMLGregorianMD(p_value).GetValue();
+    default:                return 0;
+  }
+}
+
+// Bound of a range: precompiled by CompileRanges or converted right now
+INT64
+XMLRestriction::RangeBound(XmlDataType p_kind,XString p_bound,INT64 p_compiled)
+{
+  return m_rangeType == p_kind ? p_compiled : RangeValue(p_kind,p_bound);
 }
 
 XString
-XMLRestriction::CheckRangeDate(XString p_date)
+XMLRestriction::CheckRangeValue(XmlDataType p_kind,XString p_value)
 {
-  if(!m_minInclusive.IsEmpty())
+  if(m_minInclusive.IsEmpty() && m_minExclusive.IsEmpty() &&
+     m_maxInclusive.IsEmpty() && m_maxExclusive.IsEmpty())
   {
-    INT64 min = XMLDate(m_minInclusive).GetValue();
-    INT64 val = XMLDate(p_date).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
+    return _T("");
   }
-  if(!m_minExclusive.IsEmpty())
+  INT64 val = RangeValue(p_kind,p_value);
+
+  if(!m_minInclusive.IsEmpty() && val <  RangeBound(p_kind,m_minInclusive,m_minInclusiveValue))
   {
-    INT64 min = XMLDate(m_minExclusive).GetValue();
-    INT64 val = XMLDate(p_date).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
+    return _T("Value too small. < minInclusive");
   }
-  if(!m_maxInclusive.IsEmpty())
+  if(!m_minExclusive.IsEmpty() && val <= RangeBound(p_kind,m_minExclusive,m_minExclusiveValue))
   {
-    INT64 max = XMLDate(m_maxInclusive).GetValue();
-    INT64 val = XMLDate(p_date).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
+    return _T("Value too small. <= minExclusive");
   }
-  if(!m_maxExclusive.IsEmpty())
+  if(!m_maxInclusive.IsEmpty() && val >  RangeBound(p_kind,m_maxInclusive,m_maxInclusiveValue))
   {
-    INT64 max = XMLDate(m_maxExclusive).GetValue();
-    INT64 val = XMLDate(p_date).GetValue();
-    if(val > max) return _T("Value too big. >= maxExclusive");
+    return _T("Value too big. > maxInclusive");
+  }
+  if(!m_maxExclusive.IsEmpty() && val >= RangeBound(p_kind,m_maxExclusive,m_maxExclusiveValue))
+  {
+    return _T("Value too big. >= maxExclusive");
   }
   return _T("");
 }
 
+XString
+XMLRestriction::CheckRangeTime(XString p_time)
+{
+  return CheckRangeValue(XDT_Time,p_time);
+}
+
+XString
+XMLRestriction::CheckRangeDate(XString p_date)
+{
+  return CheckRangeValue(XDT_Date,p_date);
+}
+
 XString   
 XMLRestriction::CheckRangeStamp(XString p_timestamp)
 {
-  if(!m_minInclusive.IsEmpty())
-  {
-    INT64 min = XMLTimestamp(m_minInclusive).GetValue();
-    INT64 val = XMLTimestamp(p_timestamp).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
-  }
-  if(!m_minExclusive.IsEmpty())
-  {
-    INT64 min = XMLTimestamp(m_minExclusive).GetValue();
-    INT64 val = XMLTimestamp(p_timestamp).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
-  }
-  if(!m_maxInclusive.IsEmpty())
-  {
-    INT64 max = XMLTimestamp(m_maxInclusive).GetValue();
-    INT64 val = XMLTimestamp(p_timestamp).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
-  }
-  if(!m_maxExclusive.IsEmpty())
-  {
-    INT64 max = XMLTimestamp(m_maxExclusive).GetValue();
-    INT64 val = XMLTimestamp(p_timestamp).GetValue();
-    if(val > max) return _T("Value too big. >= maxExclusive");
-  }
-  return _T("");
+  return CheckRangeValue(XDT_DateTime,p_timestamp);
 }
 
 XString
 XMLRestriction::CheckRangeDuration(XString p_duration)
 {
-  if(!m_minInclusive.IsEmpty())
-  {
-    INT64 min = XMLDuration(m_minInclusive).GetValue();
-    INT64 val = XMLDuration(p_duration).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
-  }
-  if(!m_minExclusive.IsEmpty())
-  {
-    INT64 min = XMLDuration(m_minExclusive).GetValue();
-    INT64 val = XMLDuration(p_duration).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
-  }
-  if(!m_maxInclusive.IsEmpty())
-  {
-    INT64 max = XMLDuration(m_maxInclusive).GetValue();
-    INT64 val = XMLDuration(p_duration).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
-  }
-  if(!m_maxExclusive.IsEmpty())
-  {
-    INT64 max = XMLDuration(m_maxExclusive).GetValue();
-    INT64 val = XMLDuration(p_duration).GetValue();
-    if(val > max) return _T("Value too big. >= maxExclusive");
-  }
-  return _T("");
+  return CheckRangeValue(XDT_Duration,p_duration);
 }
 
 XString   
 XMLRestriction::CheckRangeGregYM(XString p_yearmonth)
 {
-  if(!m_minInclusive.IsEmpty())
-  {
-    INT64 min = XMLGregorianYM(m_minInclusive).GetValue();
-    INT64 val = XMLGregorianYM(p_yearmonth).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
-  }
-  if(!m_minExclusive.IsEmpty())
-  {
-    INT64 min = XMLGregorianYM(m_minExclusive).GetValue();
-    INT64 val = XMLGregorianYM(p_yearmonth).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
-  }
-  if(!m_maxInclusive.IsEmpty())
-  {
-    INT64 max = XMLGregorianYM(m_maxInclusive).GetValue();
-    INT64 val = XMLGregorianYM(p_yearmonth).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
-  }
-  if(!m_maxExclusive.IsEmpty())
-  {
-    INT64 max = XMLGregorianYM(m_maxExclusive).GetValue();
-    INT64 val = XMLGregorianYM(p_yearmonth).GetValue();
-    if(val >= max) return _T("Value too big. >= maxExclusive");
-  }
-  return _T("");
+  return CheckRangeValue(XDT_GregYearMonth,p_yearmonth);
 }
 
 XString
 XMLRestriction::CheckRangeGregMD(XString p_monthday)
 {
-  if(!m_minInclusive.IsEmpty())
-  {
-    INT64 min = XMLGregorianMD(m_minInclusive).GetValue();
-    INT64 val = XMLGregorianMD(p_monthday).GetValue();
-    if(val < min) return _T("Value too small. < minInclusive");
-  }
-  if(!m_minExclusive.IsEmpty())
-  {
-    INT64 min = XMLGregorianMD(m_minExclusive).GetValue();
-    INT64 val = XMLGregorianMD(p_monthday).GetValue();
-    if(val <= min) return _T("Value too small. <= minExclusive");
-  }
-  if(!m_maxInclusive.IsEmpty())
-  {
-    INT64 max = XMLGregorianMD(m_maxInclusive).GetValue();
-    INT64 val = XMLGregorianMD(p_monthday).GetValue();
-    if(val > max) return _T("Value too big. > maxInclusive");
-  }
-  if(!m_maxExclusive.IsEmpty())
-  {
-    INT64 max = XMLGregorianMD(m_maxExclusive).GetValue();
-    INT64 val = XMLGregorianMD(p_monthday).GetValue();
-    if(val >= max) return _T("Value too big. >= maxExclusive");
-  }
-  return _T("");
+  return CheckRangeValue(XDT_GregMonthDay,p_monthday);
 }
 
 XString
@@ -1717,12 +1696,20 @@ XMLRestriction::CheckRestriction(XmlDataType p_type,XString p_value)
   {
 #ifdef _UNICODE
     std::wstring str(p_value);
-    std::wregex  reg(m_pattern);
 #else
     std::string str(p_value);
-    std::regex  reg(m_pattern);
 #endif
-    if(std::regex_match(str,reg) == false)
+    bool matched = false;
+    if(m_regex)
+    {
+      matched = std::regex_match(str,*m_regex);
+    }
+    else
+    {
+      XmlRegex reg(m_pattern.GetString());
+      matched = std::regex_match(str,reg);
+    }
+    if(matched == false)
     {
       result.Format(_T("Field value [%s] does not match the pattern: %s"),p_value.GetString(),m_pattern.GetString());
       return result;
@@ -1735,12 +1722,11 @@ XMLRestriction::CheckRestriction(XmlDataType p_type,XString p_value)
     return result;
   }
   // See if the value is one of the stated enum values
-  for(const auto& value : m_enums)
+  XString upper(p_value);
+  upper.MakeUpper();
+  if(m_enumsUpper.find(upper) != m_enumsUpper.end())
   {
-    if(p_value.CompareNoCase(value.first) == 0)
-    {
-      return result;
-    }
+    return result;
   }
   result.Format(_T("Field value [%s] is not in the list of allowed enumeration values."),p_value.GetString());
   return result;
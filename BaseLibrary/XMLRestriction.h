@@ -25,9 +25,18 @@
 //
 #pragma once
 #include <map>
+#include <set>
+#include <regex>
+#include <memory>
 #include "XMLDataType.h"
 
-using XmlEnums = std::map<XString,XString>;
+using XmlEnums   = std::map<XString,XString>;
+using XmlEnumSet = std::set<XString>;
+#ifdef _UNICODE
+using XmlRegex   = std::wregex;
+#else
+using XmlRegex   = std::regex;
+#endif
 
 class XMLRestriction
 {
@@ -37,6 +46,8 @@ public:
   XString CheckRestriction(XmlDataType p_type,XString p_value);
   XString CheckDatatype   (XmlDataType p_type,XString p_value);
   XString HandleWhitespace(XmlDataType p_type,XString p_value);
+  // Precompile the temporal range bounds for the datatype of a field
+  void    CompileRanges(XmlDataType p_type);
 
   // Set restrictions
   void    AddEnumeration(XString p_enum,XString p_displayValue = _T(""));
@@ -46,7 +57,7 @@ public:
   void    AddMaxLength(int p_length)      { m_maxLength      = p_length; }
   void    AddTotalDigits(int p_digits)    { m_totalDigits    = p_digits; }
   void    AddFractionDigits(int p_digits) { m_fractionDigits = p_digits; }
-  void    AddPattern(XString p_pattern)   { m_pattern        = p_pattern;}
+  void    AddPattern(XString p_pattern);
   void    AddWhitespace(int p_white)      { m_whiteSpace     = p_white;  }
   void    AddMaxExclusive(XString p_max);
   void    AddMaxInclusive(XString p_max);
@@ -136,6 +147,9 @@ private:
   XString   CheckRangeDuration (XString p_duration);
   XString   CheckRangeGregYM   (XString p_yearmonth);
   XString   CheckRangeGregMD   (XString p_monthday);
+  XString   CheckRangeValue    (XmlDataType p_kind,XString p_value);
+  INT64     RangeValue         (XmlDataType p_kind,XString p_value);
+  INT64     RangeBound         (XmlDataType p_kind,XString p_bound,INT64 p_compiled);
 
   XString   m_name;                     // Name of the restriction
   XString   m_baseType;                 // Base XSD type of the restriction
@@ -149,6 +163,8 @@ private:
   unsigned  m_minOccurs      { 1   };   // Minimum number of child elements
   unsigned  m_maxOccurs      { 1   };   // Maximum number of child elements
   XString   m_pattern;                  // Pattern for pattern matching
+  std::shared_ptr<XmlRegex> m_regex;    // Pattern compiled once by AddPattern
+  XmlEnumSet m_enumsUpper;              // Uppercase enumerations for case-insensitive lookup
   XString   m_maxExclusive;             // Max value up-to     this value
   XString   m_maxInclusive;             // Max value including this value
   XString   m_minExclusive;             // Min value down-to   this value
@@ -162,6 +178,12 @@ private:
   INT64     m_maxInclusiveInteger { 0   };
   INT64     m_minExclusiveInteger { 0   };
   INT64     m_minInclusiveInteger { 0   };
+  // Temporal bounds, precompiled by CompileRanges
+  XmlDataType m_rangeType       { 0   };   // Kind of the precompiled bounds (0 = none)
+  INT64     m_maxExclusiveValue { 0   };
+  INT64     m_maxInclusiveValue { 0   };
+  INT64     m_minExclusiveValue { 0   };
+  INT64     m_minInclusiveValue { 0   };
 };
 
 using AllRestrictions = std::map<XString,XMLRestriction>;
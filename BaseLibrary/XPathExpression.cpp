@@ -0,0 +1,548 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: XPathExpression.cpp
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "pch.h"
+#include "XPathExpression.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+XPathExpression::XPathExpression(XString p_path)
+{
+  Compile(p_path);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// COMPILING
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+XPathExpression::Compile(XString p_path)
+{
+  m_path     = p_path;
+  m_valid    = false;
+  m_anywhere = false;
+  m_errorInfo.Empty();
+  m_steps.clear();
+
+  if(m_path.IsEmpty())
+  {
+    return SetError(_T("Path must be filled in."));
+  }
+
+  // Special case: Not a path, but a node to find
+  XString path(m_path);
+  if(path.GetAt(0) != '/')
+  {
+    path = _T("//") + path;
+    m_anywhere = true;
+  }
+
+  int pos = 0;
+  while(pos < path.GetLength())
+  {
+    if(!CompileStep(path,pos))
+    {
+      return false;
+    }
+  }
+  m_valid = true;
+  return true;
+}
+
+bool
+XPathExpression::SetError(XString p_error)
+{
+  m_errorInfo = p_error;
+  m_valid     = false;
+  m_steps.clear();
+  return false;
+}
+
+// Step: '/' or '//', optional name, zero or more predicates
+bool
+XPathExpression::CompileStep(const XString& p_path,int& p_pos)
+{
+  if(p_path.GetAt(p_pos) != '/')
+  {
+    return SetError(_T("Expected a '/' at: ") + XString(p_path.Mid(p_pos)));
+  }
+  XPStep step;
+  ++p_pos;
+  if(p_path.GetAt(p_pos) == '/')
+  {
+    step.m_descendant = true;
+    ++p_pos;
+  }
+  if(p_pos >= p_path.GetLength())
+  {
+    // XPath ends on a '/'
+    if(step.m_descendant)
+    {
+      return SetError(_T("Missing element after '//'"));
+    }
+    return true;
+  }
+
+  if(p_path.GetAt(p_pos) == '*')
+  {
+    ++p_pos;
+  }
+  else
+  {
+    step.m_name = GetName(p_path,p_pos);
+    int colon = step.m_name.Find(':');
+    if(colon >= 0)
+    {
+      step.m_namespace = step.m_name.Left(colon);
+      step.m_name      = step.m_name.Mid(colon + 1);
+    }
+  }
+  while(p_pos < p_path.GetLength() && p_path.GetAt(p_pos) == '[')
+  {
+    if(!CompilePredicate(p_path,p_pos,step))
+    {
+      return false;
+    }
+  }
+  if(step.m_name.IsEmpty() && step.m_predicates.empty())
+  {
+    return SetError(_T("Missing element name or predicate at: ") + XString(p_path.Mid(p_pos)));
+  }
+  m_steps.push_back(step);
+  return true;
+}
+
+XString
+XPathExpression::GetName(const XString& p_path,int& p_pos)
+{
+  int start = p_pos;
+  while(p_pos < p_path.GetLength())
+  {
+    TCHAR ch = (TCHAR) p_path.GetAt(p_pos);
+    if(!_istalnum(ch) && ch != '_' && ch != '-' && ch != '.' && ch != ':')
+    {
+      break;
+    }
+    ++p_pos;
+  }
+  return p_path.Mid(start,p_pos - start);
+}
+
+static void
+SkipSpaces(const XString& p_string,int& p_pos)
+{
+  while(p_pos < p_string.GetLength() && _istspace(p_string.GetAt(p_pos)))
+  {
+    ++p_pos;
+  }
+}
+
+bool
+XPathExpression::NeedToken(const XString& p_path,int& p_pos,TCHAR p_token)
+{
+  SkipSpaces(p_path,p_pos);
+  if(p_pos < p_path.GetLength() && p_path.GetAt(p_pos) == p_token)
+  {
+    ++p_pos;
+    return true;
+  }
+  XString error;
+  error.Format(_T("Expected a [%c] token in: %s"),p_token,m_path.GetString());
+  return SetError(error);
+}
+
+// Literal: 'string', "string" or a number
+bool
+XPathExpression::GetLiteral(const XString& p_path,int& p_pos,XPPredicate& p_predicate)
+{
+  SkipSpaces(p_path,p_pos);
+  TCHAR ch = (TCHAR) p_path.GetAt(p_pos);
+  if(ch == '\'' || ch == '\"')
+  {
+    int end = p_path.Find(ch,p_pos + 1);
+    if(end < 0)
+    {
+      return SetError(_T("Missing closing quote in: ") + m_path);
+    }
+    p_predicate.m_string   = p_path.Mid(p_pos + 1,end - p_pos - 1);
+    p_predicate.m_isString = true;
+    p_pos = end + 1;
+    return true;
+  }
+  int start = p_pos;
+  while(p_pos < p_path.GetLength())
+  {
+    ch = (TCHAR) p_path.GetAt(p_pos);
+    if(!_istdigit(ch) && ch != '.' && ch != '-' && ch != '+' && ch != 'e' && ch != 'E')
+    {
+      break;
+    }
+    ++p_pos;
+  }
+  if(p_pos == start)
+  {
+    return SetError(_T("Expected a string or a number in: ") + m_path);
+  }
+  p_predicate.m_string = p_path.Mid(start,p_pos - start);
+  p_predicate.m_number = bcd(p_predicate.m_string.GetString());
+  return true;
+}
+
+bool
+XPathExpression::CompilePredicate(const XString& p_path,int& p_pos,XPStep& p_step)
+{
+  // A position is always the last predicate of a step
+  if(!p_step.m_predicates.empty())
+  {
+    XPPredicateType last = p_step.m_predicates.back().m_type;
+    if(last == XPPredicateType::XPP_Position || last == XPPredicateType::XPP_Last)
+    {
+      return SetError(_T("A position must be the last predicate of a step in: ") + m_path);
+    }
+  }
+  ++p_pos;  // Skip the '['
+  SkipSpaces(p_path,p_pos);
+
+  XPPredicate predicate;
+  TCHAR ch = (TCHAR) p_path.GetAt(p_pos);
+  if(_istdigit(ch))
+  {
+    int start = p_pos;
+    while(_istdigit(p_path.GetAt(p_pos)))
+    {
+      ++p_pos;
+    }
+    predicate.m_type     = XPPredicateType::XPP_Position;
+    predicate.m_position = _ttoi(p_path.Mid(start,p_pos - start));
+    if(predicate.m_position < 1)
+    {
+      return SetError(_T("Index out of bounds in: ") + m_path);
+    }
+  }
+  else
+  {
+    if(ch == '@')
+    {
+      ++p_pos;
+      predicate.m_type = XPPredicateType::XPP_Attribute;
+    }
+    predicate.m_name = GetName(p_path,p_pos);
+    if(predicate.m_name.IsEmpty())
+    {
+      return SetError(_T("Expected a name in the predicate of: ") + m_path);
+    }
+    SkipSpaces(p_path,p_pos);
+
+    if(predicate.m_type == XPPredicateType::XPP_Element && p_path.GetAt(p_pos) == '(')
+    {
+      // Function call
+      XString function = predicate.m_name;
+      if(function.Compare(_T("last")) == 0)
+      {
+        predicate.m_type = XPPredicateType::XPP_Last;
+        predicate.m_name.Empty();
+        if(!NeedToken(p_path,p_pos,'(') || !NeedToken(p_path,p_pos,')'))
+        {
+          return false;
+        }
+      }
+      else if(function.Compare(_T("contains"))    == 0 ||
+              function.Compare(_T("starts-with")) == 0 ||
+              function.Compare(_T("begins-with")) == 0)
+      {
+        predicate.m_type = function.Compare(_T("contains")) == 0 ? XPPredicateType::XPP_Contains
+                                                                 : XPPredicateType::XPP_StartsWith;
+        if(!NeedToken(p_path,p_pos,'('))
+        {
+          return false;
+        }
+        SkipSpaces(p_path,p_pos);
+        predicate.m_name = GetName(p_path,p_pos);
+        if(!NeedToken(p_path,p_pos,',') || !GetLiteral(p_path,p_pos,predicate) || !NeedToken(p_path,p_pos,')'))
+        {
+          return false;
+        }
+      }
+      else
+      {
+        return SetError(_T("Unknown function in XPath: ") + function);
+      }
+    }
+    else
+    {
+      ch = (TCHAR) p_path.GetAt(p_pos);
+      if(ch == '=' || ch == '<' || ch == '>')
+      {
+        ++p_pos;
+        predicate.m_operator = ch;
+        if(!GetLiteral(p_path,p_pos,predicate))
+        {
+          return false;
+        }
+      }
+    }
+  }
+  if(!NeedToken(p_path,p_pos,']'))
+  {
+    return false;
+  }
+  p_step.m_predicates.push_back(predicate);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// EVALUATION
+// Depth first: no intermediate result sets are built
+//
+//////////////////////////////////////////////////////////////////////////
+
+unsigned
+XPathExpression::Evaluate(XMLMessage& p_message,XPResults& p_results) const
+{
+  p_results.clear();
+  if(m_anywhere)
+  {
+    XMLElement* first = EvaluateFirst(p_message);
+    if(first)
+    {
+      p_results.push_back(first);
+    }
+  }
+  else if(m_valid && p_message.GetRoot())
+  {
+    Walk(p_message.GetRoot(),0,&p_results,nullptr);
+  }
+  return (unsigned) p_results.size();
+}
+
+XMLElement*
+XPathExpression::EvaluateFirst(XMLMessage& p_message) const
+{
+  XMLElement* first = nullptr;
+  if(m_valid && p_message.GetRoot())
+  {
+    Walk(p_message.GetRoot(),0,nullptr,&first);
+  }
+  return first;
+}
+
+// Returns true if evaluation can stop (first result found)
+// The first step is matched against the root element itself
+bool
+XPathExpression::Walk(XMLElement* p_element,size_t p_step,XPResults* p_results,XMLElement** p_first) const
+{
+  if(p_step == m_steps.size())
+  {
+    if(p_first)
+    {
+      *p_first = p_element;
+      return true;
+    }
+    p_results->push_back(p_element);
+    return false;
+  }
+
+  const XPStep& step = m_steps[p_step];
+  bool self   = p_step == 0;
+  int  target = 0;
+  if(!step.m_predicates.empty())
+  {
+    const XPPredicate& last = step.m_predicates.back();
+    if(last.m_type == XPPredicateType::XPP_Position)
+    {
+      target = last.m_position;
+    }
+    else if(last.m_type == XPPredicateType::XPP_Last)
+    {
+      target = GetPosition(p_element,p_step,self);
+      if(target == 0)
+      {
+        return false;
+      }
+    }
+  }
+  int position = 0;
+  return Visit(p_element,p_step,self,position,target,p_results,p_first);
+}
+
+// Number of matching elements of a step
+int
+XPathExpression::GetPosition(XMLElement* p_element,size_t p_step,bool p_self) const
+{
+  int position = 0;
+  Visit(p_element,p_step,p_self,position,-1,nullptr,nullptr);
+  return position;
+}
+
+// Candidates of a step in document order
+// Target: 0 = all, n = only the n-th match, -1 = only count the matches
+bool
+XPathExpression::Visit(XMLElement* p_element
+                      ,size_t      p_step
+                      ,bool        p_self
+                      ,int&        p_position
+                      ,int         p_target
+                      ,XPResults*  p_results
+                      ,XMLElement** p_first) const
+{
+  const XPStep& step = m_steps[p_step];
+
+  if(p_self)
+  {
+    if(Matches(p_element,step))
+    {
+      ++p_position;
+      if(p_target == 0 || p_position == p_target)
+      {
+        if(Walk(p_element,p_step + 1,p_results,p_first))
+        {
+          return true;
+        }
+      }
+    }
+    if(!step.m_descendant)
+    {
+      return false;
+    }
+  }
+  for(auto& child : p_element->GetChildren())
+  {
+    if(p_target > 0 && p_position >= p_target)
+    {
+      break;
+    }
+    if(Matches(child,step))
+    {
+      ++p_position;
+      if(p_target == 0 || p_position == p_target)
+      {
+        if(Walk(child,p_step + 1,p_results,p_first))
+        {
+          return true;
+        }
+      }
+    }
+    if(step.m_descendant && Visit(child,p_step,false,p_position,p_target,p_results,p_first))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+XPathExpression::Matches(XMLElement* p_element,const XPStep& p_step) const
+{
+  if(!p_step.m_name.IsEmpty() && p_element->GetName().Compare(p_step.m_name) != 0)
+  {
+    return false;
+  }
+  if(!p_step.m_namespace.IsEmpty() && p_element->GetNamespace().Compare(p_step.m_namespace) != 0)
+  {
+    return false;
+  }
+  for(auto& predicate : p_step.m_predicates)
+  {
+    if(predicate.m_type != XPPredicateType::XPP_Position &&
+       predicate.m_type != XPPredicateType::XPP_Last     &&
+       !Matches(p_element,predicate))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool
+CompareValue(const XString& p_value,const XPPredicate& p_predicate)
+{
+  if(p_predicate.m_operator == 0)
+  {
+    // Existence only
+    return true;
+  }
+  int compare = 0;
+  if(p_predicate.m_isString)
+  {
+    compare = p_value.Compare(p_predicate.m_string);
+  }
+  else
+  {
+    bcd number(p_value.GetString());
+    compare = number < p_predicate.m_number ? -1 : (number > p_predicate.m_number ? 1 : 0);
+  }
+  switch(p_predicate.m_operator)
+  {
+    case '=': return compare == 0;
+    case '<': return compare <  0;
+    case '>': return compare >  0;
+    default:  return true;
+  }
+}
+
+bool
+XPathExpression::Matches(XMLElement* p_element,const XPPredicate& p_predicate) const
+{
+  if(p_predicate.m_type == XPPredicateType::XPP_Attribute)
+  {
+    for(auto& attribute : p_element->GetAttributes())
+    {
+      if(attribute.m_name.Compare(p_predicate.m_name) == 0)
+      {
+        return CompareValue(attribute.m_value,p_predicate);
+      }
+    }
+    return false;
+  }
+
+  // Predicates on a child element
+  for(auto& child : p_element->GetChildren())
+  {
+    if(child->GetName().Compare(p_predicate.m_name) != 0)
+    {
+      continue;
+    }
+    XString value = child->GetValue();
+    switch(p_predicate.m_type)
+    {
+      case XPPredicateType::XPP_Element:    return CompareValue(value,p_predicate);
+      case XPPredicateType::XPP_Contains:   return value.Find(p_predicate.m_string) >= 0;
+      case XPPredicateType::XPP_StartsWith: return value.Find(p_predicate.m_string) == 0;
+      default:                              return false;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,130 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: XPathExpression.h
+//
+// BaseLibrary: Indispensable general objects and functions
+// 
+// Copyright (c) 2014-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//////////////////////////////////////////////////////////////////////////
+//
+// XPathExpression
+//
+// An XPath compiled once into an immutable list of location steps with
+// their predicates already parsed (numbers converted, strings unquoted).
+// The expression holds no state of an evaluation, so one expression can be
+// evaluated by many threads at the same time, against any XMLMessage.
+// Results go into an XPResults vector of the caller, so a re-used vector
+// makes evaluation free of heap allocations.
+//
+// Same syntax as XPath (see XPath.h), with these differences:
+// /name/other        -> The first step must match the root element itself
+// //name             -> ALL 'name' elements below the context
+// house[2]           -> The 2nd 'house' of the matching elements, not the 2nd child
+// house[@a][b>3][1]  -> Predicates can be combined and are applied in order
+// name               -> A path without '/' finds the first 'name' element anywhere
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "XMLMessage.h"
+#include "bcd.h"
+#include <vector>
+
+using XPResults = std::vector<XMLElement*>;
+
+enum class XPPredicateType
+{
+  XPP_Position      // [n]
+ ,XPP_Last          // [last()]
+ ,XPP_Attribute     // [@name] or [@name='value']
+ ,XPP_Element       // [name] or [name>35]
+ ,XPP_Contains      // [contains(name,'text')]
+ ,XPP_StartsWith    // [starts-with(name,'text')]
+};
+
+// One compiled predicate of a step
+struct XPPredicate
+{
+  XPPredicateType m_type     { XPPredicateType::XPP_Element };
+  XString         m_name;                   // Child element or attribute name
+  TCHAR           m_operator { 0 };         // '=', '<', '>' or 0 for existence
+  XString         m_string;                 // Literal as a string
+  bcd             m_number;                 // Literal as a number
+  bool            m_isString { false };     // Literal was quoted
+  int             m_position { 0 };         // Position (one based)
+};
+
+// One compiled location step
+struct XPStep
+{
+  XString         m_name;                   // Element name. Empty = any element
+  XString         m_namespace;              // Optional namespace of 'ns:name'
+  bool            m_descendant { false };   // Step is preceded by '//'
+  std::vector<XPPredicate> m_predicates;
+};
+
+class XPathExpression
+{
+public:
+  XPathExpression() = default;
+  explicit XPathExpression(XString p_path);
+
+  // Compile a path. After this the expression is read-only
+  bool         Compile(XString p_path);
+
+  // Evaluate against a message. Clears and fills the results. Thread safe
+  unsigned     Evaluate(XMLMessage& p_message,XPResults& p_results) const;
+  // Only the first match (no results vector needed)
+  XMLElement*  EvaluateFirst(XMLMessage& p_message) const;
+
+  // GETTERS
+  bool         IsValid()         const { return m_valid;     }
+  XString      GetPath()         const { return m_path;      }
+  XString      GetErrorMessage() const { return m_errorInfo; }
+  size_t       GetNumberOfSteps()const { return m_steps.size(); }
+
+private:
+  // Compiling
+  bool         CompileStep     (const XString& p_path,int& p_pos);
+  bool         CompilePredicate(const XString& p_path,int& p_pos,XPStep& p_step);
+  XString      GetName         (const XString& p_path,int& p_pos);
+  bool         GetLiteral      (const XString& p_path,int& p_pos,XPPredicate& p_predicate);
+  bool         NeedToken       (const XString& p_path,int& p_pos,TCHAR p_token);
+  bool         SetError(XString p_error);
+
+  // Evaluation
+  bool         Walk   (XMLElement* p_element,size_t p_step,XPResults* p_results,XMLElement** p_first) const;
+  bool         Visit  (XMLElement* p_element,size_t p_step,bool p_self,int& p_position,int p_target
+                      ,XPResults* p_results,XMLElement** p_first) const;
+  bool         Matches(XMLElement* p_element,const XPStep& p_step) const;
+  bool         Matches(XMLElement* p_element,const XPPredicate& p_predicate) const;
+  int          GetPosition(XMLElement* p_element,size_t p_step,bool p_self) const;
+
+  // DATA
+  XString      m_path;
+  bool         m_valid    { false };
+  bool         m_anywhere { false };        // Path without '/': find first anywhere
+  XString      m_errorInfo;
+  std::vector<XPStep> m_steps;
+};
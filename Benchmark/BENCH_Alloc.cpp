@@ -0,0 +1,225 @@
+// BENCH_Alloc.cpp
+//
+// Heap allocations per request of the socket based HTTP server
+// One keep-alive loopback connection sends the same GET request over and over
+// - nopool  : a new HTTPMessage for every request
+// - pool    : HTTPMessage objects recycled by the HTTPMessagePool
+// - message : only acquiring and dropping one HTTPMessage, new against pool
+// Reports the CRT heap allocations per request of the whole process and
+// the requests per second. Allocations are counted by the CRT allocation hook,
+// so the counts are only available in a debug build.
+//
+// Options: /port:N /requests:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "HTTPMessagePool.h"
+#include "ErrorReport.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <crtdbg.h>
+#include <atomic>
+#include <string>
+
+static ErrorReport          g_errorReport;
+static std::atomic<bool>    g_counting    { false };
+static std::atomic<__int64> g_allocations { 0 };
+
+#ifdef _DEBUG
+// Called by the debug CRT for every heap operation: must not allocate itself!
+static int __cdecl
+CountingAllocHook(int p_type,void*,size_t,int p_blockType,long,const unsigned char*,int)
+{
+  if(g_counting && p_blockType != _CRT_BLOCK && (p_type == _HOOK_ALLOC || p_type == _HOOK_REALLOC))
+  {
+    ++g_allocations;
+  }
+  return TRUE;
+}
+#endif
+
+// Answer with a fixed body
+class PongHandler : public SiteHandler
+{
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(_T("pong"));
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+};
+
+// Send one request and read the complete response
+// The response buffer is reused, so the client side adds no allocations
+static bool
+AllocRoundTrip(SOCKET p_sock,const std::string& p_request,char* p_buffer,int p_size)
+{
+  if(send(p_sock,p_request.c_str(),(int)p_request.size(),0) == SOCKET_ERROR)
+  {
+    return false;
+  }
+  int total = 0;
+  while(total < p_size - 1)
+  {
+    int received = recv(p_sock,p_buffer + total,p_size - 1 - total,0);
+    if(received <= 0)
+    {
+      return false;
+    }
+    total += received;
+    p_buffer[total] = 0;
+
+    const char* headerEnd = strstr(p_buffer,"\r\n\r\n");
+    if(headerEnd)
+    {
+      const char* length = strstr(p_buffer,"Content-Length:");
+      int complete = (int)(headerEnd - p_buffer) + 4 + (length ? atoi(length + 15) : 0);
+      if(total >= complete)
+      {
+        return strncmp(p_buffer,"HTTP/1.1 200",12) == 0;
+      }
+    }
+  }
+  return false;
+}
+
+// One timed run of keep-alive requests
+static bool
+RunAllocLoad(LPCTSTR p_metric,int p_port,int p_requests)
+{
+  const TCHAR* name = _T("alloc");
+  std::string request("GET /Bench/ping HTTP/1.1\r\nHost: localhost\r\nAccept: text/plain\r\nConnection: keep-alive\r\n\r\n");
+  char buffer[4096];
+
+  SOCKET sock = BenchmarkConnect(p_port);
+  if(sock == INVALID_SOCKET)
+  {
+    _tprintf(_T("ERROR: Cannot connect to port: %d\n"),p_port);
+    return false;
+  }
+
+  // Warming up: fills the buffers of the connection and the message pool
+  unsigned errors = 0;
+  for(int ind = 0; ind < 100; ++ind)
+  {
+    errors += AllocRoundTrip(sock,request,buffer,sizeof(buffer)) ? 0 : 1;
+  }
+
+  __int64 before = g_allocations;
+  g_counting = true;
+  double start = BenchmarkNow();
+  for(int ind = 0; ind < p_requests; ++ind)
+  {
+    errors += AllocRoundTrip(sock,request,buffer,sizeof(buffer)) ? 0 : 1;
+  }
+  double elapsed = BenchmarkNow() - start;
+  g_counting = false;
+  closesocket(sock);
+
+  XString metric;
+  metric.Format(_T("%s_allocs"),p_metric);
+  BenchmarkReport(name,metric,(double)(g_allocations - before) / p_requests,_T("per request"));
+  metric.Format(_T("%s_rate"),p_metric);
+  BenchmarkReport(name,metric,(double)p_requests / elapsed,_T("req/s"));
+  if(errors)
+  {
+    _tprintf(_T("ERROR: %u errors in run: %s\n"),errors,p_metric);
+  }
+  return errors == 0;
+}
+
+// Only the message object: create and drop one, like the server does
+static void
+RunMessageLoop(LPCTSTR p_metric,bool p_pool,int p_requests)
+{
+  HTTPMessagePool::SetEnabled(p_pool);
+
+  __int64 before = g_allocations;
+  g_counting = true;
+  double start = BenchmarkNow();
+  for(int ind = 0; ind < p_requests; ++ind)
+  {
+    HTTPMessage* message = HTTPMessagePool::Acquire(HTTPCommand::http_get,nullptr);
+    message->AddHeader(_T("Accept"),_T("text/plain"));
+    message->DropReference();
+  }
+  double elapsed = BenchmarkNow() - start;
+  g_counting = false;
+
+  XString metric;
+  metric.Format(_T("%s_allocs"),p_metric);
+  BenchmarkReport(_T("alloc"),metric,(double)(g_allocations - before) / p_requests,_T("per message"));
+  metric.Format(_T("%s_time"),p_metric);
+  BenchmarkReport(_T("alloc"),metric,elapsed * 1000000.0 / p_requests,_T("us"));
+}
+
+int
+BENCH_Alloc(BenchmarkOptions& p_options)
+{
+  int port     = p_options.GetOptionInt(_T("port"),    1963);
+  int requests = p_options.GetOptionInt(_T("requests"),10000);
+
+  _tprintf(_T("Requests: %d\n"),requests);
+#ifndef _DEBUG
+  _tprintf(_T("Allocations are only counted in a debug build\n"));
+#endif
+
+  // STEP 1: Start the server
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  site->SetHandler(HTTPCommand::http_get,new PongHandler());
+  if(!site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+#ifdef _DEBUG
+  _CRT_ALLOC_HOOK previous = _CrtSetAllocHook(CountingAllocHook);
+#endif
+
+  // STEP 2: Keep-alive requests, without and with the message pool
+  HTTPMessagePool::SetEnabled(false);
+  bool result = RunAllocLoad(_T("nopool"),port,requests);
+  HTTPMessagePool::SetEnabled(true);
+  result &= RunAllocLoad(_T("pool"),port,requests);
+
+  // STEP 3: Only the message objects
+  RunMessageLoop(_T("message_new"), false,requests);
+  RunMessageLoop(_T("message_pool"),true, requests);
+
+#ifdef _DEBUG
+  _CrtSetAllocHook(previous);
+#endif
+
+  // STEP 4: Stop the server
+  server->StopServer();
+  delete server;
+
+  return result ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// BENCH_ClientPool.cpp
+//
+// HTTP client throughput against the socket based HTTP server over loopback
+// The server answers after a small simulated service time
+// - single : one HTTPClient, one request after the other
+// - pool   : HTTPClientPool, all requests in flight through futures
+// Reports requests per second and the number of connections used
+//
+// Options: /port:N /requests:N /delay:N /connections:N /inflight:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "HTTPClient.h"
+#include "HTTPClientPool.h"
+#include "ErrorReport.h"
+
+static ErrorReport g_errorReport;
+
+// Answer with a fixed body after a simulated service time
+class DelayHandler : public SiteHandler
+{
+public:
+  explicit DelayHandler(int p_delay) : m_delay(p_delay) {}
+
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    if(m_delay > 0)
+    {
+      Sleep(m_delay);
+    }
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(_T("pong"));
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+
+private:
+  int m_delay;
+};
+
+int
+BENCH_ClientPool(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("clientpool");
+  int port        = p_options.GetOptionInt(_T("port"),       1962);
+  int requests    = p_options.GetOptionInt(_T("requests"),   2000);
+  int delay       = p_options.GetOptionInt(_T("delay"),      5);
+  int connections = p_options.GetOptionInt(_T("connections"),8);
+  int inflight    = p_options.GetOptionInt(_T("inflight"),   16);
+
+  _tprintf(_T("Requests: %d Delay: %d ms Connections: %d In-flight: %d\n"),requests,delay,connections,inflight);
+
+  // STEP 1: Start the server
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  site->SetHandler(HTTPCommand::http_get,new DelayHandler(delay));
+  if(!site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  XString url;
+  url.Format(_T("http://localhost:%d/Bench/ping"),port);
+  unsigned errors = 0;
+
+  // STEP 2: One client, one request at a time
+  {
+    HTTPClient client;
+    double start = BenchmarkNow();
+    for(int ind = 0; ind < requests; ++ind)
+    {
+      HTTPMessage msg(HTTPCommand::http_get,url);
+      if(!client.Send(&msg) || msg.GetStatus() != HTTP_STATUS_OK)
+      {
+        ++errors;
+      }
+    }
+    double elapsed = BenchmarkNow() - start;
+    BenchmarkReport(name,_T("single"),(double)requests / elapsed,_T("req/s"));
+  }
+
+  // STEP 3: Connection pool, all requests in flight
+  {
+    HTTPClientPool pool(connections,inflight);
+    std::vector<HTTPMessage*>      messages;
+    std::vector<std::future<bool>> futures;
+    messages.reserve(requests);
+    futures.reserve(requests);
+
+    double start = BenchmarkNow();
+    for(int ind = 0; ind < requests; ++ind)
+    {
+      HTTPMessage* msg = new HTTPMessage(HTTPCommand::http_get,url);
+      messages.push_back(msg);
+      futures.push_back(pool.SendAsync(msg,10000));
+    }
+    for(int ind = 0; ind < requests; ++ind)
+    {
+      if(!futures[ind].get() || messages[ind]->GetStatus() != HTTP_STATUS_OK)
+      {
+        ++errors;
+      }
+    }
+    double elapsed = BenchmarkNow() - start;
+    BenchmarkReport(name,_T("pool"),       (double)requests / elapsed,    _T("req/s"));
+    BenchmarkReport(name,_T("connections"),(double)pool.GetConnections(), _T(""));
+    BenchmarkReport(name,_T("retried"),    (double)pool.GetRetried(),     _T(""));
+
+    for(auto& msg : messages)
+    {
+      msg->DropReference();
+    }
+  }
+  BenchmarkReport(name,_T("errors"),(double)errors,_T(""));
+
+  // STEP 4: Stop the server
+  server->StopServer();
+  delete server;
+
+  return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// BENCH_Columnar.cpp
+//
+// Saving a large in-memory result set in a file.
+// Compares XMLSave/XMLLoad with Apache Arrow IPC (plain and LZ4) and Apache
+// Parquet (plain and GZIP), on write speed, read speed and file size.
+// The columns mix integers, doubles, NUMERIC, timestamps, a low cardinality
+// string (dictionary encoded) and a unique string.
+//
+// Options: /rows:N /path:directory /xml:0 (skip the XML variant)
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "SQLDataSet.h"
+#include "SQLRecord.h"
+#include "SQLVariant.h"
+#include "bcd.h"
+
+static const TCHAR* g_categories[] =
+{
+  _T("Hardware"),_T("Software"),_T("Services"),_T("Licenses"),_T("Support"),_T("Training")
+};
+
+// Fill the result set with 'p_rows' records
+static void
+FillDataSet(SQLDataSet& p_set,int p_rows)
+{
+  for(int row = 0;row < p_rows;++row)
+  {
+    SQLRecord* record = p_set.InsertRecord();
+
+    XString description;
+    description.Format(_T("Invoice line number %d"),row);
+    bcd total((long)row,25L);
+    TIMESTAMP_STRUCT stamp = { 2026,(SQLUSMALLINT)(1 + row % 12),(SQLUSMALLINT)(1 + row % 28),(SQLUSMALLINT)(row % 24),0,0,0 };
+
+    SQLVariant id(row + 1);
+    SQLVariant amount((double)row * 1.5);
+    SQLVariant price(&total);
+    SQLVariant created(&stamp);
+    SQLVariant category(XString(g_categories[row % 6]));
+    SQLVariant descr(description);
+    SQLVariant remark;
+    if(row % 10)
+    {
+      remark.Set(XString(_T("Checked")));
+    }
+    else
+    {
+      remark.ReserveSpace(SQL_C_CHAR,0);
+    }
+
+    if(row == 0)
+    {
+      // First record defines the columns of the set
+      p_set.InsertField(_T("id"),         &id);
+      p_set.InsertField(_T("amount"),     &amount);
+      p_set.InsertField(_T("price"),      &price);
+      p_set.InsertField(_T("created"),    &created);
+      p_set.InsertField(_T("category"),   &category);
+      p_set.InsertField(_T("description"),&descr);
+      p_set.InsertField(_T("remark"),     &remark);
+    }
+    else
+    {
+      record->AddField(&id,      true);
+      record->AddField(&amount,  true);
+      record->AddField(&price,   true);
+      record->AddField(&created, true);
+      record->AddField(&category,true);
+      record->AddField(&descr,   true);
+      record->AddField(&remark,  true);
+    }
+  }
+}
+
+static double
+FileSizeMB(const XString& p_filename)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if(GetFileAttributesEx(p_filename,GetFileExInfoStandard,&data))
+  {
+    ULONGLONG size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return (double)size / (1024.0 * 1024.0);
+  }
+  return 0.0;
+}
+
+// Sum of the 'id' column to check that everything came back
+static __int64
+CheckSum(SQLDataSet& p_set)
+{
+  __int64 sum = 0;
+  for(int row = 0;row < p_set.GetNumberOfRecords();++row)
+  {
+    sum += p_set.GetRecord(row)->GetField(0)->GetAsSLong();
+  }
+  return sum;
+}
+
+// Save and load one variant of the file format
+static bool
+SaveAndLoad(LPCTSTR p_name,SQLDataSet& p_set,__int64 p_check,const XString& p_file,int p_format)
+{
+  const TCHAR* name = _T("columnar");
+  XString metric;
+
+  double start = BenchmarkNow();
+  bool saved = false;
+  switch(p_format)
+  {
+    case 0: saved = p_set.XMLSave(p_file,_T("Benchmark"));  break;
+    case 1: saved = p_set.ArrowSave(p_file,false);        break;
+    case 2: saved = p_set.ArrowSave(p_file,true);         break;
+    case 3: saved = p_set.ParquetSave(p_file,false);      break;
+    case 4: saved = p_set.ParquetSave(p_file,true);       break;
+  }
+  double written = BenchmarkNow() - start;
+  if(!saved)
+  {
+    _tprintf(_T("ERROR: Cannot save the %s file: %s\n"),p_name,p_file.GetString());
+    return false;
+  }
+  double size = FileSizeMB(p_file);
+
+  SQLDataSet loaded;
+  start = BenchmarkNow();
+  bool read = false;
+  switch(p_format)
+  {
+    case 0:  read = loaded.XMLLoad(p_file);     break;
+    case 1:  // Fall through
+    case 2:  read = loaded.ArrowLoad(p_file);   break;
+    default: read = loaded.ParquetLoad(p_file); break;
+  }
+  double elapsed = BenchmarkNow() - start;
+  DeleteFile(p_file);
+
+  metric.Format(_T("%s write"),p_name);
+  BenchmarkReport(name,metric,(double)p_set.GetNumberOfRecords() / written,_T("rows/s"));
+  metric.Format(_T("%s read"),p_name);
+  BenchmarkReport(name,metric,(double)p_set.GetNumberOfRecords() / elapsed,_T("rows/s"));
+  metric.Format(_T("%s size"),p_name);
+  BenchmarkReport(name,metric,size,_T("MB"));
+
+  if(!read || CheckSum(loaded) != p_check)
+  {
+    _tprintf(_T("ERROR: The %s file did not read back the same rows\n"),p_name);
+    return false;
+  }
+  return true;
+}
+
+int
+BENCH_Columnar(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("columnar");
+  int     rows = p_options.GetOptionInt (_T("rows"),1000000);
+  XString path = p_options.GetOption    (_T("path"),_T("."));
+  bool    xml  = p_options.GetOptionBool(_T("xml"), true);
+
+  _tprintf(_T("Rows: %d\n"),rows);
+
+  SQLDataSet set;
+  double start = BenchmarkNow();
+  FillDataSet(set,rows);
+  BenchmarkReport(name,_T("fill result set"),BenchmarkNow() - start,_T("s"));
+  __int64 check = CheckSum(set);
+
+  bool ok = true;
+  if(xml)
+  {
+    ok &= SaveAndLoad(_T("xml"),set,check,path + _T("\\bench_columnar.xml"),0);
+  }
+  ok &= SaveAndLoad(_T("arrow plain"),  set,check,path + _T("\\bench_columnar.arrow"),  1);
+  ok &= SaveAndLoad(_T("arrow lz4"),    set,check,path + _T("\\bench_columnar.arrow"),  2);
+  ok &= SaveAndLoad(_T("parquet plain"),set,check,path + _T("\\bench_columnar.parquet"),3);
+  ok &= SaveAndLoad(_T("parquet gzip"), set,check,path + _T("\\bench_columnar.parquet"),4);
+  return ok ? 0 : 1;
+}
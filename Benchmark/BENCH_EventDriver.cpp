@@ -0,0 +1,285 @@
+// BENCH_EventDriver.cpp
+//
+// End-to-end event latency of the ServerEventDriver
+// Loopback SSE clients, each on its own channel. A poster thread stamps every
+// event with the performance counter. The clients measure the time until arrival.
+//
+// Options: /port:N /clients:N /seconds:N /interval:ms /shards:N /broadcast:1
+// With /broadcast:1 every round is one ServerEventDriver::Broadcast of a
+// single shared frame, instead of one PostEvent per channel.
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "ServerEventDriver.h"
+#include "SocketPoll.h"
+#include "ErrorReport.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <string>
+
+static ErrorReport g_errorReport;
+
+// One SSE client of the load generator
+typedef struct _sseClient
+{
+  SOCKET      m_socket  { INVALID_SOCKET };
+  int         m_channel { 0 };
+  std::string m_input;
+}
+SSEClient;
+
+// All clients, read by one polling thread
+typedef struct _sseReader
+{
+  SocketPoll              m_poll;
+  LatencyRecorder         m_latency;
+  __int64                 m_frequency{ 1 };
+  unsigned                m_received { 0 };
+  unsigned                m_closed   { 0 };
+  volatile bool           m_stop     { false };
+}
+SSEReader;
+
+// Parse all complete "data:<counter>" lines in the input of a client
+static void
+ParseEvents(SSEReader* p_reader,SSEClient& p_client)
+{
+  size_t pos = 0;
+  while(true)
+  {
+    size_t end = p_client.m_input.find('\n',pos);
+    if(end == std::string::npos)
+    {
+      break;
+    }
+    if(p_client.m_input.compare(pos,5,"data:") == 0)
+    {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter(&now);
+      __int64 stamp = _atoi64(p_client.m_input.c_str() + pos + 5);
+      if(stamp > 0)
+      {
+        p_reader->m_latency.Add((double)(now.QuadPart - stamp) * 1000000.0 / (double)p_reader->m_frequency);
+        ++p_reader->m_received;
+      }
+    }
+    pos = end + 1;
+  }
+  p_client.m_input.erase(0,pos);
+}
+
+static unsigned __stdcall
+RunSSEReader(void* p_argument)
+{
+  SSEReader* reader = reinterpret_cast<SSEReader*>(p_argument);
+  PollEvent events[POLL_MAX_EVENTS];
+  char buffer[16 * 1024];
+
+  while(!reader->m_stop)
+  {
+    int number = reader->m_poll.Wait(events,POLL_MAX_EVENTS,100);
+    for(int index = 0;index < number;++index)
+    {
+      SSEClient* client = reinterpret_cast<SSEClient*>(events[index].m_context);
+      if(client == nullptr)
+      {
+        continue;
+      }
+      while(true)
+      {
+        int received = recv(client->m_socket,buffer,sizeof(buffer),0);
+        if(received > 0)
+        {
+          client->m_input.append(buffer,received);
+          continue;
+        }
+        if(received == 0 || !SocketPoll::WouldBlock())
+        {
+          reader->m_poll.Remove(client->m_socket);
+          ++reader->m_closed;
+        }
+        break;
+      }
+      ParseEvents(reader,*client);
+    }
+  }
+  return 0;
+}
+
+static bool
+ConnectClient(SSEClient& p_client,int p_port,int p_number)
+{
+  p_client.m_socket = BenchmarkConnect(p_port);
+  if(p_client.m_socket == INVALID_SOCKET)
+  {
+    return false;
+  }
+
+  // Every client has its own 'desktop', so the driver sees different senders
+  char request[256];
+  sprintf_s(request,256,"GET /Bench/Events/chan%d HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "Accept: text/event-stream\r\n"
+                        "RemoteDesktop: %d\r\n\r\n",p_number,p_number + 1);
+  int length = (int)strlen(request);
+  if(send(p_client.m_socket,request,length,0) != length)
+  {
+    return false;
+  }
+  return SocketPoll::SetNonBlocking(p_client.m_socket);
+}
+
+int
+BENCH_EventDriver(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("eventdriver");
+  int port     = p_options.GetOptionInt(_T("port"),    1961);
+  int clients  = p_options.GetOptionInt(_T("clients"), 256);
+  int seconds  = p_options.GetOptionInt(_T("seconds"), 10);
+  int interval = p_options.GetOptionInt(_T("interval"),10);
+  int shards   = p_options.GetOptionInt(_T("shards"),  0);
+  bool broadcast = p_options.GetOptionBool(_T("broadcast"),false);
+
+  _tprintf(_T("Clients: %d Seconds: %d Interval: %d ms Shards: %d Broadcast: %s\n")
+          ,clients,seconds,interval,shards,broadcast ? _T("yes") : _T("no"));
+
+  // STEP 1: Start the server and the event driver
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("BenchmarkEvents"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr || !site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  ServerEventDriver* driver = new ServerEventDriver();
+  driver->SetSenderShards(shards);
+  if(!driver->RegisterSites(server,site))
+  {
+    _tprintf(_T("ERROR: Cannot register the event driver sites\n"));
+    delete driver;
+    delete server;
+    return 1;
+  }
+  std::vector<int> channels;
+  for(int index = 0;index < clients;++index)
+  {
+    XString session;
+    XString token;
+    session.Format(_T("chan%d"),index);
+    token.Format(_T("%d"),index);
+    channels.push_back(driver->RegisterChannel(session,_T("BENCH"),token));
+  }
+  driver->StartEventDriver();
+  server->Run();
+  server->SetIsProcessing(true);
+
+  // STEP 2: Connect all SSE clients
+  std::vector<SSEClient> sse(clients);
+  SSEReader reader;
+  reader.m_latency.Reserve(1024 * 1024);
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  reader.m_frequency = frequency.QuadPart;
+  reader.m_poll.Open();
+
+  int connected = 0;
+  for(int index = 0;index < clients;++index)
+  {
+    sse[index].m_channel = channels[index];
+    if(ConnectClient(sse[index],port,index))
+    {
+      reader.m_poll.Add(sse[index].m_socket,&sse[index],POLL_READ);
+      ++connected;
+    }
+  }
+  HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunSSEReader,&reader,0,nullptr);
+
+  // Wait for all streams to be registered on their channels
+  double start = BenchmarkNow();
+  int registered = 0;
+  while(BenchmarkNow() - start < 10.0)
+  {
+    registered = 0;
+    for(auto& channel : channels)
+    {
+      registered += driver->GetChannelClientCount(channel) > 0 ? 1 : 0;
+    }
+    if(registered == connected)
+    {
+      break;
+    }
+    Sleep(50);
+  }
+  BenchmarkReport(name,_T("streams"),(double)registered,_T(""));
+
+  // STEP 3: Post stamped events to all channels
+  unsigned posted = 0;
+  start = BenchmarkNow();
+  while(BenchmarkNow() - start < seconds)
+  {
+    if(broadcast)
+    {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter(&now);
+      XString payload;
+      payload.Format(_T("%I64d"),now.QuadPart);
+      posted += driver->Broadcast(payload);
+      Sleep(interval);
+      continue;
+    }
+    for(auto& channel : channels)
+    {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter(&now);
+      XString payload;
+      payload.Format(_T("%I64d"),now.QuadPart);
+      posted += driver->PostEvent(channel,payload) > 0 ? 1 : 0;
+    }
+    Sleep(interval);
+  }
+  double elapsed = BenchmarkNow() - start;
+
+  // Let the last events arrive
+  Sleep(1000);
+  reader.m_stop = true;
+  WaitForSingleObject(thread,INFINITE);
+  CloseHandle(thread);
+
+  // STEP 4: Report
+  BenchmarkReport(name,_T("events posted"),  (double)posted,                    _T(""));
+  BenchmarkReport(name,_T("events received"),(double)reader.m_received,         _T(""));
+  BenchmarkReport(name,_T("throughput"),     (double)reader.m_received / elapsed,_T("events/s"));
+  BenchmarkReportLatency(name,reader.m_latency);
+
+  // STEP 5: Stop everything
+  for(auto& client : sse)
+  {
+    if(client.m_socket != INVALID_SOCKET)
+    {
+      reader.m_poll.Remove(client.m_socket);
+      closesocket(client.m_socket);
+    }
+  }
+  reader.m_poll.Close();
+  driver->StopEventDriver();
+  server->StopServer();
+  delete driver;
+  delete server;
+
+  return reader.m_received > 0 ? 0 : 1;
+}
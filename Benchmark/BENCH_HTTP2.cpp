@@ -0,0 +1,350 @@
+// BENCH_HTTP2.cpp
+//
+// HTTP/1.1 against HTTP/2 (h2c, prior knowledge) on the socket based HTTP server
+// The server answers after a small simulated service time
+// - http1 : browser style, a number of connections with one request at a time
+// - http2 : one connection, many streams in flight at the same time
+// Reports requests per second and the number of connections used
+//
+// Options: /port:N /requests:N /delay:N /connections:N /streams:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "HTTP2Session.h"
+#include "HPACK.h"
+#include "ErrorReport.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <string>
+
+static ErrorReport g_errorReport;
+
+// Answer with a fixed body after a simulated service time
+class ServiceTimeHandler : public SiteHandler
+{
+public:
+  explicit ServiceTimeHandler(int p_delay) : m_delay(p_delay) {}
+
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    if(m_delay > 0)
+    {
+      Sleep(m_delay);
+    }
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(_T("pong"));
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+
+private:
+  int m_delay;
+};
+
+static bool
+SendAll(SOCKET p_sock,const std::string& p_data)
+{
+  size_t position = 0;
+  while(position < p_data.size())
+  {
+    int bytes = send(p_sock,p_data.data() + position,(int)(p_data.size() - position),0);
+    if(bytes <= 0)
+    {
+      return false;
+    }
+    position += bytes;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// HTTP/1.1: one request at a time per connection
+//
+//////////////////////////////////////////////////////////////////////////
+
+typedef struct _http1Client
+{
+  int      m_port     { 0 };
+  int      m_requests { 0 };
+  unsigned m_errors   { 0 };
+}
+HTTP1Client;
+
+static unsigned __stdcall
+RunHTTP1Client(void* p_argument)
+{
+  HTTP1Client* client = reinterpret_cast<HTTP1Client*>(p_argument);
+
+  SOCKET sock = BenchmarkConnect(client->m_port);
+  if(sock == INVALID_SOCKET)
+  {
+    client->m_errors += client->m_requests;
+    return 1;
+  }
+  std::string request("GET /Bench/ping HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  std::string response;
+  char buffer[16 * 1024];
+
+  for(int ind = 0; ind < client->m_requests; ++ind)
+  {
+    if(!SendAll(sock,request))
+    {
+      client->m_errors += client->m_requests - ind;
+      break;
+    }
+    // Wait for the complete response: headers and the Content-Length body
+    size_t total = 0;
+    while(total == 0 || response.size() < total)
+    {
+      int received = recv(sock,buffer,sizeof(buffer),0);
+      if(received <= 0)
+      {
+        break;
+      }
+      response.append(buffer,received);
+      size_t headerEnd = response.find("\r\n\r\n");
+      if(headerEnd != std::string::npos && total == 0)
+      {
+        size_t pos = response.find("Content-Length:");
+        total = headerEnd + 4 + ((pos != std::string::npos && pos < headerEnd) ? (size_t)atol(response.c_str() + pos + 15) : 0);
+      }
+    }
+    if(total == 0 || response.size() < total || response.compare(0,12,"HTTP/1.1 200") != 0)
+    {
+      client->m_errors += client->m_requests - ind;
+      break;
+    }
+    response.erase(0,total);
+  }
+  closesocket(sock);
+  return 0;
+}
+
+static double
+RunHTTP1(int p_port,int p_requests,int p_connections,unsigned& p_errors)
+{
+  std::vector<HTTP1Client> clients(p_connections);
+  std::vector<HANDLE>      threads;
+
+  double start = BenchmarkNow();
+  for(int ind = 0; ind < p_connections; ++ind)
+  {
+    clients[ind].m_port     = p_port;
+    clients[ind].m_requests = p_requests / p_connections + (ind < p_requests % p_connections ? 1 : 0);
+    HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunHTTP1Client,&clients[ind],0,nullptr);
+    if(thread)
+    {
+      threads.push_back(thread);
+    }
+  }
+  for(auto& thread : threads)
+  {
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+  }
+  double elapsed = BenchmarkNow() - start;
+  for(auto& client : clients)
+  {
+    p_errors += client.m_errors;
+  }
+  return (double)p_requests / elapsed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// HTTP/2: all streams on one connection
+//
+//////////////////////////////////////////////////////////////////////////
+
+static double
+RunHTTP2(int p_port,int p_requests,int p_streams,unsigned& p_errors)
+{
+  SOCKET sock = BenchmarkConnect(p_port);
+  if(sock == INVALID_SOCKET)
+  {
+    p_errors += p_requests;
+    return 0.0;
+  }
+  HPACKEncoder encoder;
+  HPACKDecoder decoder;
+  std::string  output(HTTP2_PREFACE);
+  std::string  input;
+  char         buffer[64 * 1024];
+
+  // Our SETTINGS: no push, a large stream window. And a large connection window
+  std::string settings;
+  const unsigned char entries[12] = { 0,HTTP2_SETTINGS_ENABLE_PUSH,0,0,0,0
+                                     ,0,HTTP2_SETTINGS_INITIAL_WINDOW_SIZE,0,0x40,0,0 };
+  settings.append(reinterpret_cast<const char*>(entries),sizeof(entries));
+  HTTP2Session::WriteFrame(output,HTTP2_SETTINGS,0,0,settings.data(),settings.size());
+  HTTP2Session::WriteWindowUpdate(output,0,HTTP2_CONNECTION_WINDOW);
+
+  double   start     = BenchmarkNow();
+  int      sent      = 0;
+  int      completed = 0;
+  int      open      = 0;
+  unsigned stream    = 1;
+  size_t   consumed  = 0;
+
+  while(completed < p_requests)
+  {
+    // Keep the streams in flight
+    while(open < p_streams && sent < p_requests)
+    {
+      HPACKHeaders headers;
+      headers.push_back(HPACKHeader(":method",   "GET"));
+      headers.push_back(HPACKHeader(":scheme",   "http"));
+      headers.push_back(HPACKHeader(":path",     "/Bench/ping"));
+      headers.push_back(HPACKHeader(":authority","localhost"));
+      std::string block;
+      encoder.Encode(headers,block);
+      HTTP2Session::WriteFrame(output,HTTP2_HEADERS,HTTP2_FLAG_END_HEADERS | HTTP2_FLAG_END_STREAM,stream,block.data(),block.size());
+      stream += 2;
+      ++sent;
+      ++open;
+    }
+    if(!output.empty())
+    {
+      if(!SendAll(sock,output))
+      {
+        break;
+      }
+      output.clear();
+    }
+
+    int received = recv(sock,buffer,sizeof(buffer),0);
+    if(received <= 0)
+    {
+      break;
+    }
+    input.append(buffer,received);
+
+    // All complete frames of the server
+    size_t     position = 0;
+    HTTP2Frame frame;
+    bool       failed   = false;
+    while(HTTP2Session::ReadFrame(input,position,frame) && input.size() - position >= HTTP2_FRAME_HEADER + frame.m_length)
+    {
+      const unsigned char* payload = reinterpret_cast<const unsigned char*>(input.data()) + position + HTTP2_FRAME_HEADER;
+      position += HTTP2_FRAME_HEADER + frame.m_length;
+      switch(frame.m_type)
+      {
+        case HTTP2_SETTINGS:      if((frame.m_flags & HTTP2_FLAG_ACK) == 0)
+                                  {
+                                    HTTP2Session::WriteFrame(output,HTTP2_SETTINGS,HTTP2_FLAG_ACK,0,nullptr,0);
+                                  }
+                                  break;
+        case HTTP2_PING:          if((frame.m_flags & HTTP2_FLAG_ACK) == 0)
+                                  {
+                                    HTTP2Session::WriteFrame(output,HTTP2_PING,HTTP2_FLAG_ACK,0,reinterpret_cast<const char*>(payload),frame.m_length);
+                                  }
+                                  break;
+        case HTTP2_HEADERS:       {
+                                    HPACKHeaders headers;
+                                    if(!decoder.Decode(payload,frame.m_length,headers) || headers.empty() || headers[0].second != "200")
+                                    {
+                                      ++p_errors;
+                                    }
+                                  }
+                                  break;
+        case HTTP2_DATA:          consumed += frame.m_length;
+                                  break;
+        case HTTP2_RST_STREAM:    ++p_errors;
+                                  --open;
+                                  ++completed;
+                                  break;
+        case HTTP2_GOAWAY:        failed = true;
+                                  break;
+      }
+      if((frame.m_type == HTTP2_DATA || frame.m_type == HTTP2_HEADERS) && (frame.m_flags & HTTP2_FLAG_END_STREAM))
+      {
+        --open;
+        ++completed;
+      }
+    }
+    input.erase(0,position);
+    if(failed)
+    {
+      break;
+    }
+    // Give the connection window back
+    if(consumed > HTTP2_CONNECTION_WINDOW / 2)
+    {
+      HTTP2Session::WriteWindowUpdate(output,0,(unsigned)consumed);
+      consumed = 0;
+    }
+  }
+  double elapsed = BenchmarkNow() - start;
+  closesocket(sock);
+
+  p_errors += p_requests - completed;
+  return (double)completed / elapsed;
+}
+
+int
+BENCH_HTTP2(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("http2");
+  int port        = p_options.GetOptionInt(_T("port"),       1963);
+  int requests    = p_options.GetOptionInt(_T("requests"),   5000);
+  int delay       = p_options.GetOptionInt(_T("delay"),      5);
+  int connections = p_options.GetOptionInt(_T("connections"),6);
+  int streams     = p_options.GetOptionInt(_T("streams"),    HTTP2_MAX_STREAMS / 2);
+
+  if(streams > HTTP2_MAX_STREAMS)
+  {
+    streams = HTTP2_MAX_STREAMS;
+  }
+  _tprintf(_T("Requests: %d Delay: %d ms HTTP/1.1 connections: %d HTTP/2 streams: %d\n"),requests,delay,connections,streams);
+
+  // STEP 1: Start the server
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  server->SetHTTP2(true);
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  site->SetHandler(HTTPCommand::http_get,new ServiceTimeHandler(delay));
+  if(!site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  // STEP 2: Both protocols with the same number of requests
+  unsigned errors = 0;
+  BenchmarkReport(name,_T("http1"),            RunHTTP1(port,requests,connections,errors),_T("req/s"));
+  BenchmarkReport(name,_T("http1_connections"),(double)connections,                       _T(""));
+  BenchmarkReport(name,_T("http2"),            RunHTTP2(port,requests,streams,errors),    _T("req/s"));
+  BenchmarkReport(name,_T("http2_connections"),1.0,                                       _T(""));
+  BenchmarkReport(name,_T("errors"),           (double)errors,                            _T(""));
+
+  // STEP 3: Stop the server
+  server->StopServer();
+  delete server;
+
+  return errors > 0 ? 1 : 0;
+}
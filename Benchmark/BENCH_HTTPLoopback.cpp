@@ -0,0 +1,245 @@
+// BENCH_HTTPLoopback.cpp
+//
+// Load generator in the style of 'wrk' against the socket based HTTP server
+// Keep-alive connections, each with a number of pipelined GET requests in flight
+// Reports requests per second and the latency percentiles
+//
+// Options: /port:N /connections:N /pipeline:N /seconds:N /body:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "ErrorReport.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <string>
+#include <deque>
+
+static ErrorReport g_errorReport;
+
+// Minimal handler: answer with a fixed plain text body
+class BenchmarkHandler : public SiteHandler
+{
+public:
+  explicit BenchmarkHandler(XString p_body) : m_body(p_body) {}
+
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(m_body);
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+
+private:
+  XString m_body;
+};
+
+// One client connection of the load generator
+typedef struct _loadClient
+{
+  int             m_port      { 0 };
+  int             m_pipeline  { 1 };
+  double          m_stopTime  { 0.0 };
+  unsigned        m_requests  { 0 };
+  unsigned        m_errors    { 0 };
+  LatencyRecorder m_latency;
+}
+LoadClient;
+
+// Find the end of one complete response in the input buffer
+// Returns the total length of the response or zero if not yet complete
+static size_t
+CompleteResponse(std::string& p_input,bool& p_error)
+{
+  size_t headerEnd = p_input.find("\r\n\r\n");
+  if(headerEnd == std::string::npos)
+  {
+    return 0;
+  }
+  if(p_input.compare(0,12,"HTTP/1.1 200") != 0)
+  {
+    p_error = true;
+  }
+  size_t length = 0;
+  size_t pos = p_input.find("Content-Length:");
+  if(pos != std::string::npos && pos < headerEnd)
+  {
+    length = (size_t)atol(p_input.c_str() + pos + 15);
+  }
+  size_t total = headerEnd + 4 + length;
+  return p_input.size() >= total ? total : 0;
+}
+
+static unsigned __stdcall
+RunLoadClient(void* p_argument)
+{
+  LoadClient* client = reinterpret_cast<LoadClient*>(p_argument);
+
+  SOCKET sock = BenchmarkConnect(client->m_port);
+  if(sock == INVALID_SOCKET)
+  {
+    ++client->m_errors;
+    return 1;
+  }
+
+  const char* request = "GET /Bench/hello HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+  const int   reqlen  = (int)strlen(request);
+
+  std::deque<double> sendTimes;
+  std::string input;
+  char buffer[16 * 1024];
+  bool stopping = false;
+
+  while(true)
+  {
+    // Fill the pipeline
+    if(!stopping)
+    {
+      std::string output;
+      while((int)sendTimes.size() < client->m_pipeline)
+      {
+        output.append(request,reqlen);
+        sendTimes.push_back(BenchmarkNow());
+      }
+      if(!output.empty() && send(sock,output.c_str(),(int)output.size(),0) == SOCKET_ERROR)
+      {
+        ++client->m_errors;
+        break;
+      }
+    }
+    if(sendTimes.empty())
+    {
+      break;
+    }
+    // Read what is available
+    int received = recv(sock,buffer,sizeof(buffer),0);
+    if(received <= 0)
+    {
+      ++client->m_errors;
+      break;
+    }
+    input.append(buffer,received);
+
+    // Consume all complete responses
+    size_t length = 0;
+    bool   error  = false;
+    while(!sendTimes.empty() && (length = CompleteResponse(input,error)) > 0)
+    {
+      double now = BenchmarkNow();
+      client->m_latency.Add((now - sendTimes.front()) * 1000000.0);
+      sendTimes.pop_front();
+      input.erase(0,length);
+      if(error)
+      {
+        ++client->m_errors;
+        error = false;
+      }
+      else
+      {
+        ++client->m_requests;
+      }
+    }
+    // Drain the pipeline at the end of the run
+    if(BenchmarkNow() >= client->m_stopTime)
+    {
+      stopping = true;
+    }
+  }
+  closesocket(sock);
+  return 0;
+}
+
+int
+BENCH_HTTPLoopback(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("httploopback");
+  int port        = p_options.GetOptionInt(_T("port"),       1960);
+  int connections = p_options.GetOptionInt(_T("connections"),64);
+  int pipeline    = p_options.GetOptionInt(_T("pipeline"),   16);
+  int seconds     = p_options.GetOptionInt(_T("seconds"),    10);
+  int bodysize    = p_options.GetOptionInt(_T("body"),       13);
+
+  _tprintf(_T("Connections: %d Pipeline: %d Seconds: %d Body: %d bytes\n"),connections,pipeline,seconds,bodysize);
+
+  // STEP 1: Start the server
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  XString body(_T('x'),bodysize);
+  site->SetHandler(HTTPCommand::http_get,new BenchmarkHandler(body));
+  if(!site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  // STEP 2: Start all load clients
+  double start = BenchmarkNow();
+  std::vector<LoadClient> clients(connections);
+  std::vector<HANDLE>     threads;
+  for(auto& client : clients)
+  {
+    client.m_port     = port;
+    client.m_pipeline = pipeline;
+    client.m_stopTime = start + seconds;
+    client.m_latency.Reserve(1024 * 1024);
+    HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunLoadClient,&client,0,nullptr);
+    if(thread)
+    {
+      threads.push_back(thread);
+    }
+  }
+
+  // STEP 3: Wait for all clients
+  for(auto& thread : threads)
+  {
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+  }
+  double elapsed = BenchmarkNow() - start;
+
+  // STEP 4: Report
+  LatencyRecorder latency;
+  unsigned requests = 0;
+  unsigned errors   = 0;
+  for(auto& client : clients)
+  {
+    requests += client.m_requests;
+    errors   += client.m_errors;
+    latency.Merge(client.m_latency);
+  }
+  BenchmarkReport(name,_T("requests"),   (double)requests,           _T(""));
+  BenchmarkReport(name,_T("errors"),     (double)errors,             _T(""));
+  BenchmarkReport(name,_T("throughput"), (double)requests / elapsed, _T("req/s"));
+  BenchmarkReportLatency(name,latency);
+
+  // STEP 5: Stop the server
+  server->StopServer();
+  delete server;
+
+  return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// BENCH_Logging.cpp
+//
+// Throughput of the LogAnalysis logfile with many threads logging at the same time
+// Each thread writes formatted log lines with a string and two numbers
+// - locked   : every line formatted by the caller under the lock of the logfile
+// - lockfree : binary records in per-thread rings, formatted by the background writer
+// Reports log lines per second and checks that every line is in the logfile
+//
+// Options: /threads:N /lines:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include <LogAnalysis.h>
+#include <process.h>
+#include <string>
+
+// One logging thread
+typedef struct _logClient
+{
+  LogAnalysis* m_log    { nullptr };
+  int          m_thread { 0 };
+  int          m_lines  { 0 };
+  HANDLE       m_start  { NULL };
+}
+LogClient;
+
+static unsigned __stdcall
+RunLogClient(void* p_argument)
+{
+  LogClient* client = reinterpret_cast<LogClient*>(p_argument);
+  XString name;
+  name.Format(_T("Client%d"),client->m_thread);
+
+  WaitForSingleObject(client->m_start,INFINITE);
+  for(int ind = 0; ind < client->m_lines; ++ind)
+  {
+    client->m_log->AnalysisLog(_T("RunLogClient"),LogType::LOG_INFO,true,_T("BenchLine %s request: %d status: %d"),name.GetString(),ind,200 + (ind % 5));
+  }
+  return 0;
+}
+
+// Count the benchmark lines that made it to the logfile
+static int
+CountLogLines(XString p_filename)
+{
+  FILE* file = nullptr;
+  if(_tfopen_s(&file,p_filename,_T("r")) != 0 || file == nullptr)
+  {
+    return 0;
+  }
+  int  count = 0;
+  char buffer[1024];
+  while(fgets(buffer,sizeof(buffer),file))
+  {
+    if(strstr(buffer,"BenchLine"))
+    {
+      ++count;
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+// One timed run of all threads on a fresh logfile
+static bool
+RunLogLoad(const TCHAR* p_metric,XString p_filename,bool p_lockFree,int p_threads,int p_lines)
+{
+  DeleteFile(p_filename);
+
+  LogAnalysis* log = LogAnalysis::CreateLogfile(_T("Benchmark"));
+  log->SetLogFilename(p_filename);
+  log->SetLogLevel(HLL_LOGGING);
+  log->SetLockFree(p_lockFree);
+  log->AnalysisLog(_T("RunLogLoad"),LogType::LOG_INFO,true,_T("Logging benchmark: %s"),p_metric);
+
+  HANDLE start = CreateEvent(NULL,TRUE,FALSE,NULL);
+  std::vector<LogClient> clients(p_threads);
+  std::vector<HANDLE>    threads;
+  for(int ind = 0; ind < p_threads; ++ind)
+  {
+    clients[ind].m_log    = log;
+    clients[ind].m_thread = ind;
+    clients[ind].m_lines  = p_lines;
+    clients[ind].m_start  = start;
+    HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunLogClient,&clients[ind],0,nullptr);
+    if(thread)
+    {
+      threads.push_back(thread);
+    }
+  }
+
+  double begin = BenchmarkNow();
+  SetEvent(start);
+  for(auto& thread : threads)
+  {
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+  }
+  double elapsed = BenchmarkNow() - begin;
+  // Writing the rest of the lines is not part of the timing
+  LogAnalysis::DeleteLogfile(log);
+  CloseHandle(start);
+
+  int total = p_threads * p_lines;
+  BenchmarkReport(_T("logging"),p_metric,(double)total / elapsed,_T("lines/s"));
+
+  int found = CountLogLines(p_filename);
+  if(found != total)
+  {
+    _tprintf(_T("ERROR: %d of %d lines in the logfile of run: %s\n"),found,total,p_metric);
+    return false;
+  }
+  return true;
+}
+
+int
+BENCH_Logging(BenchmarkOptions& p_options)
+{
+  int threads = p_options.GetOptionInt(_T("threads"),32);
+  int lines   = p_options.GetOptionInt(_T("lines"),  20000);
+
+  _tprintf(_T("Threads: %d Lines per thread: %d\n"),threads,lines);
+
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+  XString filename = XString(tempdir) + _T("BenchLogging.txt");
+
+  bool result = true;
+  result &= RunLogLoad(_T("locked"),  filename,false,threads,lines);
+  result &= RunLogLoad(_T("lockfree"),filename,true, threads,lines);
+
+  DeleteFile(filename);
+  return result ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// BENCH_Metrics.cpp
+//
+// Overhead of the metrics registry on the hot paths
+// - timer    : nanoseconds for one MetricTimer into a histogram
+// - counter  : nanoseconds for one counter add, with all threads on the same counter
+// - off / on : requests per second over loopback, with the metrics switched off and on
+// - overhead : percentage of request throughput lost by the metrics (must stay below 1%)
+// The exported metrics are read through the SiteHandlerMetrics and checked
+//
+// Options: /port:N /requests:N /threads:N /rounds:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "SiteHandlerMetrics.h"
+#include "HTTPClient.h"
+#include "ErrorReport.h"
+#include <Metrics.h>
+#include <process.h>
+
+static ErrorReport g_errorReport;
+
+// Answer with a fixed body
+class PingHandler : public SiteHandler
+{
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(_T("pong"));
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+};
+
+// Threads adding to one counter
+typedef struct _counterClient
+{
+  MetricCounter* m_counter { nullptr };
+  int            m_count   { 0 };
+}
+CounterClient;
+
+static unsigned __stdcall
+RunCounterClient(void* p_argument)
+{
+  CounterClient* client = reinterpret_cast<CounterClient*>(p_argument);
+  for(int ind = 0; ind < client->m_count; ++ind)
+  {
+    client->m_counter->Add();
+  }
+  return 0;
+}
+
+// Requests per second of one client
+static double
+RunRequests(XString p_url,int p_requests,unsigned& p_errors)
+{
+  HTTPClient client;
+  double start = BenchmarkNow();
+  for(int ind = 0; ind < p_requests; ++ind)
+  {
+    HTTPMessage msg(HTTPCommand::http_get,p_url);
+    if(!client.Send(&msg) || msg.GetStatus() != HTTP_STATUS_OK)
+    {
+      ++p_errors;
+    }
+  }
+  return (double)p_requests / (BenchmarkNow() - start);
+}
+
+int
+BENCH_Metrics(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("metrics");
+  int port     = p_options.GetOptionInt(_T("port"),    1963);
+  int requests = p_options.GetOptionInt(_T("requests"),2000);
+  int threads  = p_options.GetOptionInt(_T("threads"), 32);
+  int rounds   = p_options.GetOptionInt(_T("rounds"),  5);
+  const int loops = 10000000;
+
+  _tprintf(_T("Requests: %d Threads: %d Rounds: %d\n"),requests,threads,rounds);
+  MetricsRegistry& registry = GetMetricsRegistry();
+  unsigned errors = 0;
+
+  // STEP 1: One timer, without any contention
+  {
+    MetricHistogram* histogram = registry.GetHistogram(_T("bench_timer_seconds"),_T("Benchmark timer"));
+    double start = BenchmarkNow();
+    for(int ind = 0; ind < loops; ++ind)
+    {
+      MetricTimer timer(histogram);
+    }
+    double elapsed = BenchmarkNow() - start;
+    BenchmarkReport(name,_T("timer"),elapsed * 1.0e9 / loops,_T("ns"));
+    BenchmarkReport(name,_T("timer_p99"),(double)histogram->GetPercentile(99.0),_T("us"));
+  }
+
+  // STEP 2: All threads on one sharded counter
+  {
+    MetricCounter* counter = registry.GetCounter(_T("bench_counter_total"),_T("Benchmark counter"));
+    std::vector<CounterClient> clients(threads);
+    std::vector<HANDLE>        handles;
+    double start = BenchmarkNow();
+    for(auto& client : clients)
+    {
+      client.m_counter = counter;
+      client.m_count   = loops / threads;
+      HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunCounterClient,&client,0,nullptr);
+      if(thread)
+      {
+        handles.push_back(thread);
+      }
+    }
+    for(auto& thread : handles)
+    {
+      WaitForSingleObject(thread,INFINITE);
+      CloseHandle(thread);
+    }
+    double elapsed = BenchmarkNow() - start;
+    __int64 total = (__int64)(loops / threads) * threads;
+    BenchmarkReport(name,_T("counter"),elapsed * 1.0e9 / (double)total,_T("ns"));
+    if(counter->GetValue() != total)
+    {
+      _tprintf(_T("ERROR: Counter is %I64d instead of %I64d\n"),counter->GetValue(),total);
+      ++errors;
+    }
+  }
+
+  // STEP 3: Start the server with the metrics endpoint
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(XString(tempdir) + _T("Benchmark"));
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site    = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  HTTPSite* metrics = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Metrics/"));
+  if(site == nullptr || metrics == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark sites on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  site   ->SetHandler(HTTPCommand::http_get,new PingHandler());
+  metrics->SetHandler(HTTPCommand::http_get,new SiteHandlerMetrics());
+  if(!site->StartSite() || !metrics->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark sites on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  // STEP 4: Request throughput with metrics off and on, in alternating rounds
+  XString url;
+  url.Format(_T("http://localhost:%d/Bench/ping"),port);
+  RunRequests(url,requests / 10,errors);    // Warming up
+
+  double off = 0.0;
+  double on  = 0.0;
+  for(int round = 0; round < rounds; ++round)
+  {
+    registry.SetEnabled(false);
+    off += RunRequests(url,requests,errors);
+    registry.SetEnabled(true);
+    on  += RunRequests(url,requests,errors);
+  }
+  off /= rounds;
+  on  /= rounds;
+  BenchmarkReport(name,_T("off"),     off,_T("req/s"));
+  BenchmarkReport(name,_T("on"),      on, _T("req/s"));
+  BenchmarkReport(name,_T("overhead"),(off - on) * 100.0 / off,_T("%"));
+
+  // STEP 5: Read the export. The requests of the site must be in it
+  XString metricsUrl;
+  metricsUrl.Format(_T("http://localhost:%d/Metrics/"),port);
+  HTTPClient  client;
+  HTTPMessage msg(HTTPCommand::http_get,metricsUrl);
+  if(!client.Send(&msg) || msg.GetStatus() != HTTP_STATUS_OK)
+  {
+    _tprintf(_T("ERROR: Cannot read the metrics from: %s\n"),metricsUrl.GetString());
+    ++errors;
+  }
+  else
+  {
+    XString body = msg.GetBody();
+    if(body.Find(_T("marlin_request_seconds_count{site=\"/Bench/\"")) < 0)
+    {
+      _tprintf(_T("ERROR: Request latency of the site not in the metrics\n"));
+      ++errors;
+    }
+  }
+  BenchmarkReport(name,_T("errors"),(double)errors,_T(""));
+
+  // STEP 6: Stop the server
+  server->StopServer();
+  delete server;
+
+  return errors > 0 ? 1 : 0;
+}
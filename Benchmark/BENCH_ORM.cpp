@@ -0,0 +1,679 @@
+// BENCH_ORM.cpp
+//
+// The hot paths of the ORM against a real database through ODBC
+// The Master/Detail and the Animal hierarchy models of the unit test are used
+// in all three mapping strategies: standalone, one_table and sub_table.
+// A scaled dataset is generated in 'bench_' tables for each strategy.
+//
+// Micro benchmarks (per strategy)
+// - load cold      : CXSession::Load of masters by primary key, empty cache
+// - load cached    : the same objects again, from the session cache
+// - select         : details by a filter (SelectObjectsFromDatabase)
+// - follow         : FollowAssociation from a master to its details
+// - animals        : Load of cats, dogs and kittens through the hierarchy
+// Macro benchmarks (per strategy)
+// - invoices       : load a master, follow its details, total them and save the master
+// - synchronize    : change all cached masters, write back with CXSession::Synchronize
+// - dataset        : change all details in a SQLDataSet and write back with Synchronize
+//
+// Use /results:file.csv and /label:commit to collect results for comparisons
+// Options: /dsn:name /user:name /password:word /schema:name /strategy:name
+//          /masters:N /details:N /animals:N /keep
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include <CXSession.h>
+#include <CXClass.h>
+#include <SQLDatabase.h>
+#include <SQLQuery.h>
+#include <SQLTransaction.h>
+#include <SQLDataSet.h>
+#include <SQLRecord.h>
+#include <SQLVariant.h>
+#include <SQLFilter.h>
+#include <WinFile.h>
+#include "../UnitTest/Master.h"
+#include "../UnitTest/Detail.h"
+#include "../UnitTest/Animal.h"
+#include "../UnitTest/Cat.h"
+#include "../UnitTest/Dog.h"
+#include "../UnitTest/Kitten.h"
+
+// Columns of the parts of the Animal hierarchy
+static LPCTSTR s_animalDDL = _T("id integer not null,animalName varchar(200),has_claws smallint,has_hair smallint,has_wings smallint,numberOfLegs integer");
+static LPCTSTR s_catDDL    = _T("color varchar(50),catdoor smallint,likesWhiskas smallint");
+static LPCTSTR s_dogDDL    = _T("subrace varchar(200),walksPerDay integer,hunting smallint,waterdog smallint");
+static LPCTSTR s_kittenDDL = _T("kit_color varchar(50),immuun smallint,inLitter smallint");
+
+static LPCTSTR s_animalColumns = _T("id,animalName,has_claws,has_hair,has_wings,numberOfLegs");
+static LPCTSTR s_catColumns    = _T("color,catdoor,likesWhiskas");
+static LPCTSTR s_dogColumns    = _T("subrace,walksPerDay,hunting,waterdog");
+static LPCTSTR s_kittenColumns = _T("kit_color,immuun,inLitter");
+
+// Kinds of animals in the dataset: id % 4
+enum class AnimalKind { AK_Animal, AK_Cat, AK_Dog, AK_Kitten };
+
+// Settings of one run
+typedef struct _ormBench
+{
+  XString     m_dsn;
+  XString     m_user;
+  XString     m_password;
+  XString     m_schema;
+  MapStrategy m_strategy { Strategy_standalone };
+  XString     m_strategyName;
+  int         m_masters  { 0 };
+  int         m_details  { 0 };
+  int         m_animals  { 0 };
+}
+ORMBench;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// CONFIGURATION
+//
+//////////////////////////////////////////////////////////////////////////
+
+static XString
+ConfigClass(LPCTSTR p_name,LPCTSTR p_table,LPCTSTR p_discriminator,LPCTSTR p_super,LPCTSTR p_subclasses,LPCTSTR p_attributes,LPCTSTR p_extra)
+{
+  XString xml;
+  xml.Format(_T("  <class>\n")
+             _T("    <name>%s</name>\n")
+             _T("    <table>%s</table>\n")
+             _T("    <discriminator>%s</discriminator>\n"),p_name,p_table,p_discriminator);
+  if(p_super && *p_super)
+  {
+    xml.AppendFormat(_T("    <super>%s</super>\n"),p_super);
+  }
+  if(p_subclasses && *p_subclasses)
+  {
+    xml.AppendFormat(_T("    <subclasses>\n%s    </subclasses>\n"),p_subclasses);
+  }
+  xml.AppendFormat(_T("    <attributes>\n%s    </attributes>\n%s  </class>\n"),p_attributes,p_extra);
+  return xml;
+}
+
+// Configuration of the models in the strategy of the run
+static bool
+WriteConfiguration(ORMBench& p_bench,XString p_filename,XString p_logfile)
+{
+  XString xml;
+  xml.Format(_T("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n")
+             _T("<hibernate>\n")
+             _T("  <default_catalog />\n")
+             _T("  <default_schema>%s</default_schema>\n")
+             _T("  <strategy>%s</strategy>\n")
+             _T("  <logfile>%s</logfile>\n")
+             _T("  <loglevel>0</loglevel>\n")
+             _T("  <session_role>database_role</session_role>\n")
+             _T("  <database_use>use</database_use>\n")
+            ,p_bench.m_schema.GetString(),p_bench.m_strategyName.GetString(),p_logfile.GetString());
+
+  xml += ConfigClass(_T("Master"),_T("bench_master"),_T("mas"),nullptr,nullptr
+                    ,_T("      <attribute name=\"id\" datatype=\"int\" isprimary=\"true\"/>\n")
+                     _T("      <attribute name=\"invoice\" datatype=\"int\"/>\n")
+                     _T("      <attribute name=\"description\" datatype=\"string\" maxlength=\"250\"/>\n")
+                     _T("      <attribute name=\"total\" datatype=\"bcd\"/>\n")
+                    ,_T("    <identity name=\"pk_bench_master\">\n")
+                     _T("      <attribute name=\"id\" />\n")
+                     _T("    </identity>\n")
+                     _T("    <associations>\n")
+                     _T("      <association name=\"fk_bench_detail\" type=\"one-to-many\">\n")
+                     _T("        <association_class>detail</association_class>\n")
+                     _T("        <attribute name=\"mast_id\" />\n")
+                     _T("      </association>\n")
+                     _T("    </associations>\n"));
+  xml += ConfigClass(_T("Detail"),_T("bench_detail"),_T("det"),nullptr,nullptr
+                    ,_T("      <attribute name=\"id\" datatype=\"int\" isprimary=\"true\"/>\n")
+                     _T("      <attribute name=\"mast_id\" datatype=\"int\" isforeign=\"true\"/>\n")
+                     _T("      <attribute name=\"line\" datatype=\"int\"/>\n")
+                     _T("      <attribute name=\"description\" datatype=\"string\" maxlength=\"250\"/>\n")
+                     _T("      <attribute name=\"amount\" datatype=\"bcd\"/>\n")
+                    ,_T("    <identity name=\"pk_bench_detail\">\n")
+                     _T("      <attribute name=\"id\" />\n")
+                     _T("    </identity>\n")
+                     _T("    <associations>\n")
+                     _T("      <association name=\"fk_bench_detail\" type=\"many-to-one\">\n")
+                     _T("        <association_class>master</association_class>\n")
+                     _T("        <attribute name=\"mast_id\" />\n")
+                     _T("      </association>\n")
+                     _T("    </associations>\n"));
+
+  xml += ConfigClass(_T("Animal"),_T("bench_animal"),_T("ani"),nullptr
+                    ,_T("      <subclass>Cat</subclass>\n")
+                     _T("      <subclass>Dog</subclass>\n")
+                    ,_T("      <attribute name=\"id\" datatype=\"int\" isprimary=\"true\"/>\n")
+                     _T("      <attribute name=\"animalName\" datatype=\"string\" maxlength=\"200\"/>\n")
+                     _T("      <attribute name=\"has_claws\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"has_hair\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"has_wings\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"numberOfLegs\" datatype=\"int\"/>\n")
+                    ,_T("    <identity name=\"pk_bench_animal\">\n")
+                     _T("      <attribute name=\"id\" />\n")
+                     _T("    </identity>\n"));
+  xml += ConfigClass(_T("Cat"),_T("bench_cat"),_T("cat"),_T("Animal")
+                    ,_T("      <subclass>Kitten</subclass>\n")
+                    ,_T("      <attribute name=\"color\" datatype=\"string\" maxlength=\"50\"/>\n")
+                     _T("      <attribute name=\"catdoor\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"likesWhiskas\" datatype=\"bool\"/>\n")
+                    ,_T(""));
+  xml += ConfigClass(_T("Dog"),_T("bench_dog"),_T("dog"),_T("Animal"),nullptr
+                    ,_T("      <attribute name=\"subrace\" datatype=\"string\" maxlength=\"200\"/>\n")
+                     _T("      <attribute name=\"walksPerDay\" datatype=\"int\"/>\n")
+                     _T("      <attribute name=\"hunting\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"waterdog\" datatype=\"bool\"/>\n")
+                    ,_T(""));
+  xml += ConfigClass(_T("Kitten"),_T("bench_kitten"),_T("kit"),_T("Cat"),nullptr
+                    ,_T("      <attribute name=\"kit_color\" datatype=\"string\" maxlength=\"50\"/>\n")
+                     _T("      <attribute name=\"immuun\" datatype=\"bool\"/>\n")
+                     _T("      <attribute name=\"inLitter\" datatype=\"bool\"/>\n")
+                    ,_T(""));
+  xml += _T("</hibernate>\n");
+
+  WinFile file(p_filename);
+  if(!file.Open(winfile_write | open_trans_text))
+  {
+    return false;
+  }
+  bool result = file.Write(xml);
+  return file.Close() && result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// DATASET
+//
+//////////////////////////////////////////////////////////////////////////
+
+static XString
+TableName(ORMBench& p_bench,LPCTSTR p_table)
+{
+  return p_bench.m_schema.IsEmpty() ? XString(p_table) : p_bench.m_schema + _T(".") + p_table;
+}
+
+static void
+CreateTable(SQLDatabase& p_database,ORMBench& p_bench,LPCTSTR p_table,XString p_columns)
+{
+  SQLQuery query(&p_database);
+  query.TryDoSQLStatement(_T("DROP TABLE ") + TableName(p_bench,p_table));
+  query.DoSQLStatement(_T("CREATE TABLE ") + TableName(p_bench,p_table) + _T("\n(") + p_columns + _T("\n,PRIMARY KEY(id))"));
+}
+
+// Tables of the strategy. Booleans are 'smallint' for all databases.
+static void
+CreateTables(SQLDatabase& p_database,ORMBench& p_bench)
+{
+  XString animal(s_animalDDL);
+  XString cat   (s_catDDL);
+  XString dog   (s_dogDDL);
+  XString kitten(s_kittenDDL);
+  XString disc  (_T(",discriminator varchar(5)"));
+
+  CreateTable(p_database,p_bench,_T("bench_master"),_T("id integer not null,invoice integer,description varchar(250),total decimal(18,2)"));
+  CreateTable(p_database,p_bench,_T("bench_detail"),_T("id integer not null,mast_id integer,line integer,description varchar(250),amount decimal(18,2)"));
+
+  SQLQuery query(&p_database);
+  query.DoSQLStatement(_T("CREATE INDEX bench_detail_master ON ") + TableName(p_bench,_T("bench_detail")) + _T("(mast_id)"));
+
+  switch(p_bench.m_strategy)
+  {
+    case Strategy_standalone: CreateTable(p_database,p_bench,_T("bench_animal"),animal);
+                              CreateTable(p_database,p_bench,_T("bench_cat"),   animal + _T(",") + cat);
+                              CreateTable(p_database,p_bench,_T("bench_dog"),   animal + _T(",") + dog);
+                              CreateTable(p_database,p_bench,_T("bench_kitten"),animal + _T(",") + cat + _T(",") + kitten);
+                              break;
+    case Strategy_one_table:  CreateTable(p_database,p_bench,_T("bench_animal"),animal + disc + _T(",") + cat + _T(",") + dog + _T(",") + kitten);
+                              break;
+    case Strategy_sub_table:  CreateTable(p_database,p_bench,_T("bench_animal"),animal + disc);
+                              CreateTable(p_database,p_bench,_T("bench_cat"),   _T("id integer not null,") + cat);
+                              CreateTable(p_database,p_bench,_T("bench_dog"),   _T("id integer not null,") + dog);
+                              CreateTable(p_database,p_bench,_T("bench_kitten"),_T("id integer not null,") + kitten);
+                              break;
+  }
+}
+
+static void
+DropTables(SQLDatabase& p_database,ORMBench& p_bench)
+{
+  LPCTSTR tables[] = { _T("bench_master"),_T("bench_detail"),_T("bench_animal"),_T("bench_cat"),_T("bench_dog"),_T("bench_kitten") };
+  SQLQuery query(&p_database);
+  for(auto& table : tables)
+  {
+    query.TryDoSQLStatement(_T("DROP TABLE ") + TableName(p_bench,table));
+  }
+}
+
+// Prepared INSERT statements, one per table and column list
+class BenchInserts
+{
+public:
+  BenchInserts(SQLDatabase* p_database,ORMBench& p_bench) : m_database(p_database),m_bench(p_bench) {}
+ ~BenchInserts()
+  {
+    for(auto& insert : m_inserts)
+    {
+      delete insert.second.m_query;
+    }
+  }
+
+  // Insert the values of the columns in the table
+  void Insert(LPCTSTR p_table,XString p_columns,std::map<XString,SQLVariant>& p_values)
+  {
+    XString key = XString(p_table) + _T(":") + p_columns;
+    Prepared& prepared = m_inserts[key];
+    if(prepared.m_query == nullptr)
+    {
+      XString markers;
+      int pos = 0;
+      XString column = p_columns.Tokenize(_T(","),pos);
+      while(!column.IsEmpty())
+      {
+        prepared.m_columns.push_back(column);
+        markers += markers.IsEmpty() ? _T("?") : _T(",?");
+        column = p_columns.Tokenize(_T(","),pos);
+      }
+      prepared.m_query = new SQLQuery(m_database);
+      prepared.m_query->DoSQLPrepare(_T("INSERT INTO ") + TableName(m_bench,p_table) + _T("(") + p_columns + _T(") VALUES (") + markers + _T(")"));
+    }
+    int number = 1;
+    for(auto& column : prepared.m_columns)
+    {
+      prepared.m_query->SetParameter(number++,&p_values[column]);
+    }
+    prepared.m_query->DoSQLExecute(true);
+  }
+
+private:
+  struct Prepared
+  {
+    SQLQuery*            m_query { nullptr };
+    std::vector<XString> m_columns;
+  };
+  SQLDatabase*                 m_database;
+  ORMBench&                    m_bench;
+  std::map<XString,Prepared>   m_inserts;
+};
+
+static AnimalKind
+KindOfAnimal(int p_id)
+{
+  return (AnimalKind)(p_id % 4);
+}
+
+static void
+InsertAnimal(BenchInserts& p_inserts,ORMBench& p_bench,int p_id)
+{
+  AnimalKind kind = KindOfAnimal(p_id);
+  LPCTSTR    discriminator[] = { _T("ani"),_T("cat"),_T("dog"),_T("kit") };
+  LPCTSTR    table[]         = { _T("bench_animal"),_T("bench_cat"),_T("bench_dog"),_T("bench_kitten") };
+  XString    name;
+  name.Format(_T("Animal number %d"),p_id);
+
+  std::map<XString,SQLVariant> values;
+  values[_T("id")]            = SQLVariant(p_id);
+  values[_T("discriminator")] = SQLVariant(discriminator[(int)kind]);
+  values[_T("animalName")]    = SQLVariant(name);
+  values[_T("has_claws")]     = SQLVariant((short)(kind != AnimalKind::AK_Dog));
+  values[_T("has_hair")]      = SQLVariant((short)1);
+  values[_T("has_wings")]     = SQLVariant((short)(kind == AnimalKind::AK_Animal));
+  values[_T("numberOfLegs")]  = SQLVariant(kind == AnimalKind::AK_Animal ? 2 : 4);
+  values[_T("color")]         = SQLVariant(_T("tabby"));
+  values[_T("catdoor")]       = SQLVariant((short)(p_id % 2));
+  values[_T("likesWhiskas")]  = SQLVariant((short)1);
+  values[_T("subrace")]       = SQLVariant(_T("labrador"));
+  values[_T("walksPerDay")]   = SQLVariant(p_id % 5);
+  values[_T("hunting")]       = SQLVariant((short)0);
+  values[_T("waterdog")]      = SQLVariant((short)1);
+  values[_T("kit_color")]     = SQLVariant(_T("grey"));
+  values[_T("immuun")]        = SQLVariant((short)1);
+  values[_T("inLitter")]      = SQLVariant((short)(p_id % 3 == 0));
+
+  // All columns of the kind of animal
+  XString columns(s_animalColumns);
+  if(kind == AnimalKind::AK_Cat || kind == AnimalKind::AK_Kitten)
+  {
+    columns += XString(_T(",")) + s_catColumns;
+  }
+  if(kind == AnimalKind::AK_Dog)
+  {
+    columns += XString(_T(",")) + s_dogColumns;
+  }
+  if(kind == AnimalKind::AK_Kitten)
+  {
+    columns += XString(_T(",")) + s_kittenColumns;
+  }
+
+  switch(p_bench.m_strategy)
+  {
+    case Strategy_standalone: p_inserts.Insert(table[(int)kind],columns,values);
+                              break;
+    case Strategy_one_table:  p_inserts.Insert(_T("bench_animal"),_T("discriminator,") + columns,values);
+                              break;
+    case Strategy_sub_table:  p_inserts.Insert(_T("bench_animal"),XString(_T("discriminator,")) + s_animalColumns,values);
+                              if(kind == AnimalKind::AK_Cat || kind == AnimalKind::AK_Kitten)
+                              {
+                                p_inserts.Insert(_T("bench_cat"),XString(_T("id,")) + s_catColumns,values);
+                              }
+                              if(kind == AnimalKind::AK_Dog)
+                              {
+                                p_inserts.Insert(_T("bench_dog"),XString(_T("id,")) + s_dogColumns,values);
+                              }
+                              if(kind == AnimalKind::AK_Kitten)
+                              {
+                                p_inserts.Insert(_T("bench_kitten"),XString(_T("id,")) + s_kittenColumns,values);
+                              }
+                              break;
+  }
+}
+
+// Generate the scaled dataset. Returns the number of rows
+static int
+GenerateDataset(SQLDatabase& p_database,ORMBench& p_bench)
+{
+  int rows = 0;
+  SQLTransaction trans(&p_database,_T("generate"));
+  BenchInserts   inserts(&p_database,p_bench);
+
+  for(int master = 1; master <= p_bench.m_masters; ++master)
+  {
+    XString description;
+    description.Format(_T("Invoice number %d"),master);
+
+    std::map<XString,SQLVariant> values;
+    bcd total;
+    values[_T("id")]          = SQLVariant(master);
+    values[_T("invoice")]     = SQLVariant(100000 + master);
+    values[_T("description")] = SQLVariant(description);
+    values[_T("total")]       = SQLVariant(&total);
+    inserts.Insert(_T("bench_master"),_T("id,invoice,description,total"),values);
+    ++rows;
+
+    for(int line = 1; line <= p_bench.m_details; ++line)
+    {
+      description.Format(_T("Line %d of invoice %d"),line,master);
+      bcd amount((double)line + 0.5);
+      values.clear();
+      values[_T("id")]          = SQLVariant((master - 1) * p_bench.m_details + line);
+      values[_T("mast_id")]     = SQLVariant(master);
+      values[_T("line")]        = SQLVariant(line);
+      values[_T("description")] = SQLVariant(description);
+      values[_T("amount")]      = SQLVariant(&amount);
+      inserts.Insert(_T("bench_detail"),_T("id,mast_id,line,description,amount"),values);
+      ++rows;
+    }
+  }
+  for(int animal = 1; animal <= p_bench.m_animals; ++animal)
+  {
+    InsertAnimal(inserts,p_bench,animal);
+    ++rows;
+  }
+  trans.Commit();
+  return rows;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// BENCHMARKS
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void
+Report(ORMBench& p_bench,LPCTSTR p_metric,double p_value,LPCTSTR p_unit)
+{
+  XString metric;
+  metric.Format(_T("%s %s"),p_bench.m_strategyName.GetString(),p_metric);
+  BenchmarkReport(_T("orm"),metric,p_value,p_unit);
+}
+
+static int
+RunMicroBenchmarks(CXSession* p_session,ORMBench& p_bench)
+{
+  int errors = 0;
+
+  // Load by primary key from the database
+  p_session->ClearCache();
+  double start = BenchmarkNow();
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    if(p_session->Load(Master::ClassName(),id) == nullptr)
+    {
+      ++errors;
+    }
+  }
+  Report(p_bench,_T("load cold"),p_bench.m_masters / (BenchmarkNow() - start),_T("obj/s"));
+
+  // The same objects from the session cache
+  start = BenchmarkNow();
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    if(p_session->Load(Master::ClassName(),id) == nullptr)
+    {
+      ++errors;
+    }
+  }
+  Report(p_bench,_T("load cached"),p_bench.m_masters / (BenchmarkNow() - start),_T("obj/s"));
+
+  // Details by a filter
+  p_session->ClearCache();
+  int objects = 0;
+  start = BenchmarkNow();
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    SQLFilter filter(_T("mast_id"),SQLOperator::OP_Equal,id);
+    CXResultSet set = p_session->Load(Detail::ClassName(),&filter);
+    objects += (int)set.size();
+  }
+  Report(p_bench,_T("select"),objects / (BenchmarkNow() - start),_T("obj/s"));
+  if(objects != p_bench.m_masters * p_bench.m_details)
+  {
+    ++errors;
+  }
+
+  // Following the association of the masters
+  p_session->ClearCache();
+  std::vector<Master*> masters;
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    masters.push_back(reinterpret_cast<Master*>(p_session->Load(Master::ClassName(),id)));
+  }
+  objects = 0;
+  start = BenchmarkNow();
+  for(auto& master : masters)
+  {
+    if(master)
+    {
+      objects += (int)master->GetDetailsOfMaster(p_session).size();
+    }
+  }
+  Report(p_bench,_T("follow"),masters.size() / (BenchmarkNow() - start),_T("assoc/s"));
+
+  // Polymorphic loads through the hierarchy
+  p_session->ClearCache();
+  CString classes[] = { Animal::ClassName(),Cat::ClassName(),Dog::ClassName(),Kitten::ClassName() };
+  start = BenchmarkNow();
+  for(int id = 1; id <= p_bench.m_animals; ++id)
+  {
+    if(p_session->Load(classes[(int)KindOfAnimal(id)],id) == nullptr)
+    {
+      ++errors;
+    }
+  }
+  Report(p_bench,_T("animals"),p_bench.m_animals / (BenchmarkNow() - start),_T("obj/s"));
+
+  return errors;
+}
+
+static int
+RunMacroBenchmarks(CXSession* p_session,SQLDatabase& p_database,ORMBench& p_bench)
+{
+  int errors = 0;
+
+  // Invoice run: master, details, total and save
+  p_session->ClearCache();
+  double start = BenchmarkNow();
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    Master* master = reinterpret_cast<Master*>(p_session->Load(Master::ClassName(),id));
+    if(master == nullptr)
+    {
+      ++errors;
+      continue;
+    }
+    bcd total;
+    for(auto& object : master->GetDetailsOfMaster(p_session))
+    {
+      total += reinterpret_cast<Detail*>(object)->GetAmount();
+    }
+    master->SetTotal(total);
+    if(!p_session->Save(master))
+    {
+      ++errors;
+    }
+  }
+  Report(p_bench,_T("invoices"),p_bench.m_masters / (BenchmarkNow() - start),_T("inv/s"));
+
+  // Change all cached masters and synchronize the cache
+  int changed = 0;
+  for(int id = 1; id <= p_bench.m_masters; ++id)
+  {
+    Master* master = reinterpret_cast<Master*>(p_session->Load(Master::ClassName(),id));
+    if(master && master->GetDatabaseRecord())
+    {
+      bcd total = master->GetTotal() + 1;
+      master->SetTotal(total);
+      master->GetDatabaseRecord()->ModifyField(_T("total"),total);
+      ++changed;
+    }
+  }
+  start = BenchmarkNow();
+  if(!p_session->Synchronize())
+  {
+    ++errors;
+  }
+  Report(p_bench,_T("synchronize"),changed / (BenchmarkNow() - start),_T("obj/s"));
+
+  // SQLDataSet write-back of all details
+  SQLDataSet details(_T("bench_detail"),&p_database);
+  details.SetPrimaryTable(p_bench.m_schema,_T("bench_detail"));
+  details.SetPrimaryKeyColumn(_T("id"));
+  details.SetSelection(_T("*"));
+  start = BenchmarkNow();
+  if(details.Open())
+  {
+    for(int index = 0; index < details.GetNumberOfRecords(); ++index)
+    {
+      SQLRecord* record = details.GetRecord(index);
+      bcd amount = record->GetField(_T("amount"))->GetAsBCD() + 1;
+      record->ModifyField(_T("amount"),amount);
+    }
+    if(!details.Synchronize())
+    {
+      ++errors;
+    }
+    Report(p_bench,_T("dataset"),details.GetNumberOfRecords() / (BenchmarkNow() - start),_T("rows/s"));
+  }
+  else
+  {
+    ++errors;
+  }
+  return errors;
+}
+
+// All benchmarks of one mapping strategy
+static int
+RunStrategy(ORMBench& p_bench,bool p_keep)
+{
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+  XString config  = XString(tempdir) + _T("bench_") + p_bench.m_strategyName + _T(".cfg.xml");
+  XString logfile = XString(tempdir) + _T("bench_orm_log.txt");
+  int     errors  = 0;
+
+  _tprintf(_T("Strategy: %s\n"),p_bench.m_strategyName.GetString());
+  if(!WriteConfiguration(p_bench,config,logfile))
+  {
+    _tprintf(_T("ERROR: Cannot write the configuration: %s\n"),config.GetString());
+    return 1;
+  }
+
+  SQLDatabase database;
+  try
+  {
+    if(!database.Open(p_bench.m_dsn,p_bench.m_user,p_bench.m_password))
+    {
+      _tprintf(_T("ERROR: Cannot open the database: %s\n"),p_bench.m_dsn.GetString());
+      return 1;
+    }
+    CreateTables(database,p_bench);
+
+    double start = BenchmarkNow();
+    int rows = GenerateDataset(database,p_bench);
+    Report(p_bench,_T("generate"),rows / (BenchmarkNow() - start),_T("rows/s"));
+
+    CXSession* session = hibernate.CreateSession(_T("bench_") + p_bench.m_strategyName,config);
+    if(session == nullptr)
+    {
+      _tprintf(_T("ERROR: Cannot create a session with: %s\n"),config.GetString());
+      return 1;
+    }
+    session->SetDatabaseConnection(p_bench.m_dsn,p_bench.m_user,p_bench.m_password);
+
+    errors += RunMicroBenchmarks(session,p_bench);
+    errors += RunMacroBenchmarks(session,database,p_bench);
+
+    session->CloseSession();
+    if(!p_keep)
+    {
+      DropTables(database,p_bench);
+    }
+  }
+  catch(StdException& ex)
+  {
+    _tprintf(_T("ERROR: %s\n"),ex.GetErrorMessage().GetString());
+    ++errors;
+  }
+  database.Close();
+  DeleteFile(config);
+
+  if(errors)
+  {
+    _tprintf(_T("ERROR: %d errors in strategy: %s\n"),errors,p_bench.m_strategyName.GetString());
+  }
+  return errors;
+}
+
+int
+BENCH_ORM(BenchmarkOptions& p_options)
+{
+  ORMBench bench;
+  bench.m_dsn      = p_options.GetOption(_T("dsn"),     _T("hibtest"));
+  bench.m_user     = p_options.GetOption(_T("user"),    _T("sysdba"));
+  bench.m_password = p_options.GetOption(_T("password"),_T("altijd"));
+  bench.m_schema   = p_options.GetOption(_T("schema"),  _T(""));
+  bench.m_masters  = p_options.GetOptionInt(_T("masters"),1000);
+  bench.m_details  = p_options.GetOptionInt(_T("details"),10);
+  bench.m_animals  = p_options.GetOptionInt(_T("animals"),1000);
+  XString strategy = p_options.GetOption(_T("strategy"),_T("all"));
+  bool    keep     = p_options.GetOptionBool(_T("keep"));
+
+  _tprintf(_T("Database: %s Masters: %d Details per master: %d Animals: %d\n")
+          ,bench.m_dsn.GetString(),bench.m_masters,bench.m_details,bench.m_animals);
+
+  InitSQLComponents(LN_ENGLISH);
+
+  int errors = 0;
+  MapStrategy strategies[] = { Strategy_standalone,Strategy_one_table,Strategy_sub_table };
+  LPCTSTR     names[]      = { _T("standalone"),   _T("one_table"),   _T("sub_table")   };
+  for(int ind = 0; ind < 3; ++ind)
+  {
+    bench.m_strategy     = strategies[ind];
+    bench.m_strategyName = names[ind];
+    if(strategy.CompareNoCase(_T("all")) == 0 || strategy.CompareNoCase(bench.m_strategyName) == 0)
+    {
+      errors += RunStrategy(bench,keep);
+    }
+  }
+  hibernate.CloseAllSessions();
+  return errors > 0 ? 1 : 0;
+}
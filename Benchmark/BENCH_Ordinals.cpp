@@ -0,0 +1,146 @@
+// BENCH_Ordinals.cpp
+//
+// De-serialization of a large in-memory result set into CXObjects.
+// Compares the name based codec (BEGIN_DBS_DESERIALIZE) with the ordinal
+// bound codec (BEGIN_DBS_ORDINALS) as generated by cfg2cpp.
+// The result set has the columns of the 'master' table of the unit test,
+// preceded by a number of filler columns as in a wider table.
+//
+// Options: /rows:N /filler:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "CXObject.h"
+#include "CXObjectFactory.h"
+#include "SQLDataSet.h"
+#include "SQLRecord.h"
+#include "SQLVariant.h"
+#include "bcd.h"
+
+// Same attributes as the 'Master' class of the unit test
+class BenchMaster : public CXObject
+{
+public:
+  virtual void DeSerialize(SQLRecord& p_record);
+  DECLARE_CXO_ORDINALS(BenchMaster);
+
+  int     m_id      { 0 };
+  int     m_invoice { 0 };
+  CString m_description;
+  bcd     m_total;
+
+protected:
+  // No CXClass: only measure the codec itself
+  virtual void PreDeSerialize (SQLRecord& p_record) {}
+  virtual void PostDeSerialize(SQLRecord& p_record) {}
+};
+
+BEGIN_DBS_DESERIALIZE(BenchMaster,CXObject)
+  CXO_DBS_DESERIALIZE(m_id,         _T("id"));
+  CXO_DBS_DESERIALIZE(m_invoice,    _T("invoice"));
+  CXO_DBS_DESERIALIZE(m_description,_T("description"));
+  CXO_DBS_DESERIALIZE(m_total,      _T("total"));
+END_DBS_DESERIALIZE
+
+BEGIN_DBS_ORDINALS(BenchMaster,CXObject)
+  CXO_DBS_ORDINAL(m_id,         _T("id"));
+  CXO_DBS_ORDINAL(m_invoice,    _T("invoice"));
+  CXO_DBS_ORDINAL(m_description,_T("description"));
+  CXO_DBS_ORDINAL(m_total,      _T("total"));
+END_DBS_ORDINALS
+
+// Fill the result set with 'p_rows' records
+static void
+FillDataSet(SQLDataSet& p_set,int p_rows,int p_filler)
+{
+  for(int row = 0;row < p_rows;++row)
+  {
+    SQLRecord* record = p_set.InsertRecord();
+
+    XString description;
+    description.Format(_T("Invoice line number %d"),row);
+    bcd total((long)row,25L);
+
+    SQLVariant filler(row);
+    SQLVariant id(row + 1);
+    SQLVariant invoice(1000 + row);
+    SQLVariant descr(description);
+    SQLVariant amount(&total);
+
+    if(row == 0)
+    {
+      // First record defines the columns of the set
+      for(int index = 0;index < p_filler;++index)
+      {
+        XString name;
+        name.Format(_T("filler_%d"),index);
+        p_set.InsertField(name,&filler);
+      }
+      p_set.InsertField(_T("id"),         &id);
+      p_set.InsertField(_T("invoice"),    &invoice);
+      p_set.InsertField(_T("description"),&descr);
+      p_set.InsertField(_T("total"),      &amount);
+    }
+    else
+    {
+      for(int index = 0;index < p_filler;++index)
+      {
+        record->AddField(&filler,true);
+      }
+      record->AddField(&id,     true);
+      record->AddField(&invoice,true);
+      record->AddField(&descr,  true);
+      record->AddField(&amount, true);
+    }
+  }
+}
+
+int
+BENCH_Ordinals(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("ordinals");
+  int rows   = p_options.GetOptionInt(_T("rows"),  1000000);
+  int filler = p_options.GetOptionInt(_T("filler"),8);
+
+  _tprintf(_T("Rows: %d Filler columns: %d\n"),rows,filler);
+
+  SQLDataSet set;
+  double start = BenchmarkNow();
+  FillDataSet(set,rows,filler);
+  BenchmarkReport(name,_T("fill result set"),BenchmarkNow() - start,_T("s"));
+
+  BenchMaster object;
+  __int64 checkByName = 0;
+  __int64 checkByOrdinal = 0;
+
+  // Name based: every column is searched in every record
+  start = BenchmarkNow();
+  for(int row = 0;row < rows;++row)
+  {
+    object.DeSerialize(*set.GetRecord(row));
+    checkByName += object.m_id + object.m_invoice + object.m_description.GetLength();
+  }
+  double elapsed = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("by name"),(double)rows / elapsed,_T("rows/s"));
+
+  // Ordinal bound: columns are searched in the first record only
+  CXOrdinals ordinals;
+  start = BenchmarkNow();
+  for(int row = 0;row < rows;++row)
+  {
+    SQLRecord* record = set.GetRecord(row);
+    ordinals.Start(*record);
+    object.DeSerializeOrdinals(*record,ordinals);
+    checkByOrdinal += object.m_id + object.m_invoice + object.m_description.GetLength();
+  }
+  double ordinal = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("by ordinal"),(double)rows / ordinal,_T("rows/s"));
+  BenchmarkReport(name,_T("speedup"),elapsed / ordinal,_T("x"));
+
+  if(checkByName != checkByOrdinal)
+  {
+    _tprintf(_T("ERROR: Codecs read different values: %I64d <> %I64d\n"),checkByName,checkByOrdinal);
+    return 1;
+  }
+  return 0;
+}
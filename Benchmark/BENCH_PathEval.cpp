@@ -0,0 +1,212 @@
+// BENCH_PathEval.cpp
+//
+// Evaluating the same dozen paths against a message, as a message router does.
+// Compares JSONPath/XPath (parsing the path on every evaluation) with the
+// compiled JSONPathExpression/XPathExpression, single threaded and with
+// all threads sharing the same compiled expressions.
+//
+// Options: /rounds:N /lines:N /threads:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "JSONMessage.h"
+#include "JSONPath.h"
+#include "JSONPathExpression.h"
+#include "XMLMessage.h"
+#include "XPath.h"
+#include "XPathExpression.h"
+#include <thread>
+#include <atomic>
+
+static const TCHAR* g_jsonPaths[] =
+{
+  _T("$.header.type")
+ ,_T("$.header.id")
+ ,_T("$.header.customer.name")
+ ,_T("$.lines[0].sku")
+ ,_T("$.lines[-1].price")
+ ,_T("$.lines[2].qty")
+ ,_T("$.lines[1:9:2]")
+ ,_T("$.lines[1,3,5]")
+ ,_T("$.lines[?(@.qty > 2)]")
+ ,_T("$.lines[?(@.sku == 'SKU7')]")
+ ,_T("$..priority")
+ ,_T("$.header.*")
+};
+
+static const TCHAR* g_xmlPaths[] =
+{
+  _T("/order/header/type")
+ ,_T("/order/header/id")
+ ,_T("/order/header/customer/name")
+ ,_T("/order/lines/line[1]")
+ ,_T("/order/lines/line[last()]")
+ ,_T("/order/lines//price")
+ ,_T("/order/lines/line[@sku='SKU7']")
+ ,_T("/order/lines/line[qty>2]")
+ ,_T("/order/lines/line[contains(text,'special')]")
+ ,_T("//priority")
+ ,_T("/order/header")
+ ,_T("priority")
+};
+
+static XString
+MakeJSON(int p_lines)
+{
+  XString json(_T("{\"header\":{\"type\":\"order\",\"id\":12345,\"priority\":\"high\",\"customer\":{\"name\":\"Acme\"}},\"lines\":["));
+  for(int line = 0;line < p_lines;++line)
+  {
+    XString one;
+    one.Format(_T("%s{\"sku\":\"SKU%d\",\"qty\":%d,\"price\":%d.25}"),line ? _T(",") : _T(""),line,line % 5,10 + line);
+    json += one;
+  }
+  return json + _T("]}");
+}
+
+static XString
+MakeXML(int p_lines)
+{
+  XString xml(_T("<order><header><type>order</type><id>12345</id><priority>high</priority><customer><name>Acme</name></customer></header><lines>"));
+  for(int line = 0;line < p_lines;++line)
+  {
+    XString one;
+    one.Format(_T("<line sku=\"SKU%d\"><qty>%d</qty><price>%d.25</price><text>%s</text></line>")
+              ,line,line % 5,10 + line,line % 4 ? _T("normal") : _T("special offer"));
+    xml += one;
+  }
+  return xml + _T("</lines></order>");
+}
+
+int
+BENCH_PathEval(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("patheval");
+  int rounds  = p_options.GetOptionInt(_T("rounds"), 20000);
+  int lines   = p_options.GetOptionInt(_T("lines"),  20);
+  int threads = p_options.GetOptionInt(_T("threads"),4);
+  const int jsonPaths = sizeof(g_jsonPaths) / sizeof(g_jsonPaths[0]);
+  const int xmlPaths  = sizeof(g_xmlPaths)  / sizeof(g_xmlPaths[0]);
+
+  _tprintf(_T("Rounds: %d Lines: %d Threads: %d\n"),rounds,lines,threads);
+
+  JSONMessage* json = new JSONMessage(MakeJSON(lines));
+  json->AddReference();
+  XMLMessage xml;
+  XString xmlText = MakeXML(lines);
+  xml.ParseMessage(xmlText);
+
+  // Compile once
+  std::vector<JSONPathExpression> jsonCompiled;
+  std::vector<XPathExpression>    xmlCompiled;
+  for(auto& path : g_jsonPaths)
+  {
+    jsonCompiled.emplace_back(path);
+    if(!jsonCompiled.back().IsValid())
+    {
+      _tprintf(_T("ERROR: %s : %s\n"),path,jsonCompiled.back().GetErrorMessage().GetString());
+      json->DropReference();
+      return 1;
+    }
+  }
+  for(auto& path : g_xmlPaths)
+  {
+    xmlCompiled.emplace_back(path);
+    if(!xmlCompiled.back().IsValid())
+    {
+      _tprintf(_T("ERROR: %s : %s\n"),path,xmlCompiled.back().GetErrorMessage().GetString());
+      json->DropReference();
+      return 1;
+    }
+  }
+
+  // JSONPath: parse on every evaluation
+  __int64 matches = 0;
+  double start = BenchmarkNow();
+  for(int round = 0;round < rounds;++round)
+  {
+    for(auto& path : g_jsonPaths)
+    {
+      JSONPath evaluate(json,path);
+      matches += evaluate.GetNumberOfMatches();
+    }
+  }
+  double parsed = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("JSONPath"),(double)rounds * jsonPaths / parsed,_T("evals/s"));
+
+  // JSONPathExpression: compiled, re-used results vector
+  JPResults jsonResults;
+  matches = 0;
+  start = BenchmarkNow();
+  for(int round = 0;round < rounds;++round)
+  {
+    for(auto& path : jsonCompiled)
+    {
+      matches += path.Evaluate(*json,jsonResults);
+    }
+  }
+  double compiled = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("JSONPathExpression"),(double)rounds * jsonPaths / compiled,_T("evals/s"));
+  BenchmarkReport(name,_T("JSON speedup"),parsed / compiled,_T("x"));
+
+  // XPath: parse on every evaluation
+  start = BenchmarkNow();
+  for(int round = 0;round < rounds;++round)
+  {
+    for(auto& path : g_xmlPaths)
+    {
+      XPath evaluate(&xml,path);
+      matches += evaluate.GetNumberOfMatches();
+    }
+  }
+  parsed = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("XPath"),(double)rounds * xmlPaths / parsed,_T("evals/s"));
+
+  // XPathExpression: compiled, re-used results vector
+  XPResults xmlResults;
+  start = BenchmarkNow();
+  for(int round = 0;round < rounds;++round)
+  {
+    for(auto& path : xmlCompiled)
+    {
+      matches += path.Evaluate(xml,xmlResults);
+    }
+  }
+  compiled = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("XPathExpression"),(double)rounds * xmlPaths / compiled,_T("evals/s"));
+  BenchmarkReport(name,_T("XML speedup"),parsed / compiled,_T("x"));
+
+  // All threads share the same compiled expressions and messages
+  std::atomic<__int64> total(0);
+  std::vector<std::thread> workers;
+  start = BenchmarkNow();
+  for(int thread = 0;thread < threads;++thread)
+  {
+    workers.emplace_back([&]()
+    {
+      JPResults jsonLocal;
+      XPResults xmlLocal;
+      __int64 count = 0;
+      for(int round = 0;round < rounds;++round)
+      {
+        for(auto& path : jsonCompiled)
+        {
+          count += path.Evaluate(*json,jsonLocal);
+        }
+        for(auto& path : xmlCompiled)
+        {
+          count += path.Evaluate(xml,xmlLocal);
+        }
+      }
+      total += count;
+    });
+  }
+  for(auto& worker : workers)
+  {
+    worker.join();
+  }
+  double shared = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("compiled shared"),(double)threads * rounds * (jsonPaths + xmlPaths) / shared,_T("evals/s"));
+
+  json->DropReference();
+  return matches > 0 && total > 0 ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+// BENCH_Prefork.cpp
+//
+// Multi-process scaling of the socket based HTTP server with the ServerSupervisor
+// The Benchmark program itself is started as the worker processes,
+// all serving the same loopback port. The requests are CPU bound.
+// - workers N  : requests per second with 1, 2, 4 ... N worker processes
+// - scaling N  : throughput relative to one worker process
+// - restart    : a rolling restart of all workers under load (failed requests)
+// Reports requests per second and the scaling for each number of workers
+//
+// Options: /port:N /control:N /workers:N /connections:N /seconds:N /work:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandler.h"
+#include "ServerSupervisor.h"
+#include "ErrorReport.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <string>
+
+static ErrorReport g_errorReport;
+
+// CPU bound request: a number of hashing rounds
+class WorkHandler : public SiteHandler
+{
+public:
+  explicit WorkHandler(int p_work) : m_work(p_work) {}
+
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    unsigned hash = 2166136261U;
+    for(int round = 0; round < m_work; ++round)
+    {
+      hash = (hash ^ (unsigned)round) * 16777619U;
+    }
+    XString body;
+    body.Format(_T("%08X"),hash);
+    p_message->SetContentType(_T("text/plain"));
+    p_message->SetBody(body);
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+
+private:
+  int m_work;
+};
+
+// One client connection of the load generator
+typedef struct _preforkClient
+{
+  int         m_port     { 0 };
+  double      m_stopTime { 0.0 };
+  unsigned    m_requests { 0 };
+  unsigned    m_errors   { 0 };
+}
+PreforkClient;
+
+// Send one request and read the complete response
+// A draining worker answers with 'Connection: close'
+static bool
+PreforkRoundTrip(SOCKET p_sock,bool& p_close)
+{
+  static const char request[] = "GET /Bench/work HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+  char buffer[4096];
+  std::string response;
+
+  if(send(p_sock,request,(int)strlen(request),0) == SOCKET_ERROR)
+  {
+    return false;
+  }
+  while(true)
+  {
+    size_t headerEnd = response.find("\r\n\r\n");
+    if(headerEnd != std::string::npos)
+    {
+      size_t length = 0;
+      size_t pos = response.find("Content-Length:");
+      if(pos != std::string::npos && pos < headerEnd)
+      {
+        length = (size_t)atol(response.c_str() + pos + 15);
+      }
+      if(response.size() >= headerEnd + 4 + length)
+      {
+        p_close = response.find("Connection: close") < headerEnd;
+        return response.compare(0,12,"HTTP/1.1 200") == 0;
+      }
+    }
+    int received = recv(p_sock,buffer,sizeof(buffer),0);
+    if(received <= 0)
+    {
+      return false;
+    }
+    response.append(buffer,received);
+  }
+}
+
+static unsigned __stdcall
+RunPreforkClient(void* p_argument)
+{
+  PreforkClient* client = reinterpret_cast<PreforkClient*>(p_argument);
+  SOCKET sock = INVALID_SOCKET;
+
+  while(BenchmarkNow() < client->m_stopTime)
+  {
+    if(sock == INVALID_SOCKET)
+    {
+      sock = BenchmarkConnect(client->m_port);
+      if(sock == INVALID_SOCKET)
+      {
+        ++client->m_errors;
+        Sleep(10);
+        continue;
+      }
+    }
+    bool close = false;
+    if(PreforkRoundTrip(sock,close))
+    {
+      ++client->m_requests;
+    }
+    else
+    {
+      ++client->m_errors;
+      close = true;
+    }
+    if(close)
+    {
+      closesocket(sock);
+      sock = INVALID_SOCKET;
+    }
+  }
+  if(sock != INVALID_SOCKET)
+  {
+    closesocket(sock);
+  }
+  return 0;
+}
+
+// One timed run of all connections. Returns requests per second
+static double
+RunPreforkLoad(int p_port,int p_connections,int p_seconds,unsigned& p_errors)
+{
+  double start = BenchmarkNow();
+  std::vector<PreforkClient> clients(p_connections);
+  std::vector<HANDLE>        threads;
+  for(auto& client : clients)
+  {
+    client.m_port     = p_port;
+    client.m_stopTime = start + p_seconds;
+    HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunPreforkClient,&client,0,nullptr);
+    if(thread)
+    {
+      threads.push_back(thread);
+    }
+  }
+  for(auto& thread : threads)
+  {
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+  }
+  double elapsed = BenchmarkNow() - start;
+
+  unsigned requests = 0;
+  for(auto& client : clients)
+  {
+    requests += client.m_requests;
+    p_errors += client.m_errors;
+  }
+  return (double)requests / elapsed;
+}
+
+// Rolling restart in the background of a load run
+static unsigned __stdcall
+RunRollingRestart(void* p_argument)
+{
+  ServerSupervisor* supervisor = reinterpret_cast<ServerSupervisor*>(p_argument);
+  Sleep(500);
+  return supervisor->RollingRestart() ? 0 : 1;
+}
+
+// The worker process, started by the supervisor of the benchmark
+int
+BENCH_PreforkWorker(BenchmarkOptions& p_options)
+{
+  int port = p_options.GetOptionInt(_T("port"),1963);
+  int work = p_options.GetOptionInt(_T("work"),20000);
+
+  HTTPServerSocket* server = new HTTPServerSocket(_T("BenchmarkWorker"));
+  server->SetErrorReport(&g_errorReport);
+  ServerWorker worker;
+  if(!worker.Initialise(server))
+  {
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    delete server;
+    return 1;
+  }
+  site->SetHandler(HTTPCommand::http_get,new WorkHandler(work));
+  if(!site->StartSite())
+  {
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  worker.WaitForStop();
+
+  server->StopServer();
+  delete server;
+  return 0;
+}
+
+int
+BENCH_Prefork(BenchmarkOptions& p_options)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+
+  int port        = p_options.GetOptionInt(_T("port"),       1963);
+  int control     = p_options.GetOptionInt(_T("control"),    1400);
+  int maxWorkers  = p_options.GetOptionInt(_T("workers"),    (int)info.dwNumberOfProcessors);
+  int connections = p_options.GetOptionInt(_T("connections"),64);
+  int seconds     = p_options.GetOptionInt(_T("seconds"),    5);
+  int work        = p_options.GetOptionInt(_T("work"),       20000);
+
+  _tprintf(_T("Workers: 1..%d Connections: %d Seconds: %d Work: %d rounds\n"),maxWorkers,connections,seconds,work);
+
+  XString arguments;
+  arguments.Format(_T("/port:%d /work:%d"),port,work);
+
+  double   single = 0.0;
+  unsigned errors = 0;
+  for(int workers = 1; workers <= maxWorkers; workers = (workers == maxWorkers) ? workers + 1 : min(workers * 2,maxWorkers))
+  {
+    ServerSupervisor supervisor(_T("Benchmark"));
+    supervisor.SetWorkers(workers);
+    supervisor.AddPort(port);
+    supervisor.SetControlPort(control);
+    supervisor.SetArguments(arguments);
+    if(!supervisor.Start())
+    {
+      _tprintf(_T("ERROR: Cannot start %d worker processes on port: %d\n"),workers,port);
+      return 1;
+    }
+
+    XString metric;
+    double rate = RunPreforkLoad(port,connections,seconds,errors);
+    single = (workers == 1) ? rate : single;
+    metric.Format(_T("workers %d"),workers);
+    BenchmarkReport(_T("prefork"),metric,rate,_T("req/s"));
+    metric.Format(_T("scaling %d"),workers);
+    BenchmarkReport(_T("prefork"),metric,single > 0.0 ? rate / single : 0.0,_T("x"));
+
+    // Rolling restart of the largest configuration, under load
+    if(workers == maxWorkers)
+    {
+      unsigned failed  = 0;
+      HANDLE   restart = (HANDLE)_beginthreadex(nullptr,0,RunRollingRestart,&supervisor,0,nullptr);
+      RunPreforkLoad(port,connections,seconds,failed);
+      DWORD result = 1;
+      if(restart)
+      {
+        WaitForSingleObject(restart,INFINITE);
+        GetExitCodeThread(restart,&result);
+        CloseHandle(restart);
+      }
+      if(result != 0)
+      {
+        _tprintf(_T("ERROR: Rolling restart failed\n"));
+        ++errors;
+      }
+      BenchmarkReport(_T("prefork"),_T("restart failed"),(double)failed,_T("req"));
+      BenchmarkReport(_T("prefork"),_T("restart healthy"),(double)supervisor.GetHealthyWorkers(),_T("workers"));
+    }
+    supervisor.Stop();
+  }
+  if(errors)
+  {
+    _tprintf(_T("ERROR: %u failed requests\n"),errors);
+  }
+  return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+// BENCH_StaticFiles.cpp
+//
+// Static file serving by the SiteHandlerGet of the socket based HTTP server
+// A small and a large asset are requested over keep-alive loopback connections
+// - file      : no cache, the file is opened and read for each request
+// - cache     : from the static content cache of the site (identity)
+// - gzip      : from the cache, precompressed variant
+// - notmod    : conditional GET with If-None-Match, answered with 304
+// Reports requests per second for each combination
+//
+// Options: /port:N /connections:N /seconds:N /small:N /large:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "SiteHandlerGet.h"
+#include "ErrorReport.h"
+#include <WinFile.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <string>
+
+static ErrorReport g_errorReport;
+
+// One client connection of the load generator
+typedef struct _staticClient
+{
+  int         m_port     { 0 };
+  double      m_stopTime { 0.0 };
+  std::string m_request;
+  unsigned    m_requests { 0 };
+  unsigned    m_errors   { 0 };
+}
+StaticClient;
+
+// Find the end of one complete response in the input buffer
+// Returns the total length of the response or zero if not yet complete
+static size_t
+CompleteStaticResponse(std::string& p_input,bool& p_error)
+{
+  size_t headerEnd = p_input.find("\r\n\r\n");
+  if(headerEnd == std::string::npos)
+  {
+    return 0;
+  }
+  if(p_input.compare(0,12,"HTTP/1.1 200") != 0 &&
+     p_input.compare(0,12,"HTTP/1.1 304") != 0)
+  {
+    p_error = true;
+  }
+  size_t length = 0;
+  size_t pos = p_input.find("Content-Length:");
+  if(pos != std::string::npos && pos < headerEnd)
+  {
+    length = (size_t)atol(p_input.c_str() + pos + 15);
+  }
+  size_t total = headerEnd + 4 + length;
+  return p_input.size() >= total ? total : 0;
+}
+
+// Send one request and wait for the complete response
+static bool
+RoundTrip(SOCKET p_sock,const std::string& p_request,std::string& p_response)
+{
+  char buffer[64 * 1024];
+  bool error = false;
+  p_response.clear();
+
+  if(send(p_sock,p_request.c_str(),(int)p_request.size(),0) == SOCKET_ERROR)
+  {
+    return false;
+  }
+  while(CompleteStaticResponse(p_response,error) == 0)
+  {
+    int received = recv(p_sock,buffer,sizeof(buffer),0);
+    if(received <= 0)
+    {
+      return false;
+    }
+    p_response.append(buffer,received);
+  }
+  return !error;
+}
+
+static unsigned __stdcall
+RunStaticClient(void* p_argument)
+{
+  StaticClient* client = reinterpret_cast<StaticClient*>(p_argument);
+
+  SOCKET sock = BenchmarkConnect(client->m_port);
+  if(sock == INVALID_SOCKET)
+  {
+    ++client->m_errors;
+    return 1;
+  }
+  std::string response;
+  while(BenchmarkNow() < client->m_stopTime)
+  {
+    if(RoundTrip(sock,client->m_request,response))
+    {
+      ++client->m_requests;
+    }
+    else
+    {
+      ++client->m_errors;
+      break;
+    }
+  }
+  closesocket(sock);
+  return 0;
+}
+
+static std::string
+MakeRequest(const char* p_resource,const char* p_extraHeader)
+{
+  std::string request("GET ");
+  request += p_resource;
+  request += " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n";
+  request += p_extraHeader;
+  request += "\r\n";
+  return request;
+}
+
+// Getting the entity tag of a resource, for the conditional requests
+static std::string
+FetchETag(int p_port,const char* p_resource)
+{
+  std::string etag;
+  SOCKET sock = BenchmarkConnect(p_port);
+  if(sock == INVALID_SOCKET)
+  {
+    return etag;
+  }
+  std::string response;
+  if(RoundTrip(sock,MakeRequest(p_resource,""),response))
+  {
+    size_t pos = response.find("ETag:");
+    if(pos != std::string::npos)
+    {
+      size_t end = response.find("\r\n",pos);
+      etag = response.substr(pos + 5,end - pos - 5);
+      while(!etag.empty() && etag[0] == ' ')
+      {
+        etag.erase(0,1);
+      }
+    }
+  }
+  closesocket(sock);
+  return etag;
+}
+
+// One timed run of all connections with the same request
+static bool
+RunStaticLoad(const TCHAR* p_metric,int p_port,int p_connections,int p_seconds,const std::string& p_request)
+{
+  double start = BenchmarkNow();
+  std::vector<StaticClient> clients(p_connections);
+  std::vector<HANDLE>       threads;
+  for(auto& client : clients)
+  {
+    client.m_port     = p_port;
+    client.m_stopTime = start + p_seconds;
+    client.m_request  = p_request;
+    HANDLE thread = (HANDLE)_beginthreadex(nullptr,0,RunStaticClient,&client,0,nullptr);
+    if(thread)
+    {
+      threads.push_back(thread);
+    }
+  }
+  for(auto& thread : threads)
+  {
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+  }
+  double elapsed = BenchmarkNow() - start;
+
+  unsigned requests = 0;
+  unsigned errors   = 0;
+  for(auto& client : clients)
+  {
+    requests += client.m_requests;
+    errors   += client.m_errors;
+  }
+  BenchmarkReport(_T("staticfiles"),p_metric,(double)requests / elapsed,_T("req/s"));
+  if(errors)
+  {
+    _tprintf(_T("ERROR: %u errors in run: %s\n"),errors,p_metric);
+  }
+  return errors == 0;
+}
+
+// Text asset that compresses like a real stylesheet or script
+static bool
+WriteAsset(XString p_filename,int p_size)
+{
+  std::string content;
+  content.reserve(p_size + 64);
+  int line = 0;
+  while((int)content.size() < p_size)
+  {
+    char buffer[64];
+    sprintf_s(buffer,64,".rule%d { margin: %dpx; padding: %dpx; }\n",line,line % 17,line % 5);
+    content += buffer;
+    ++line;
+  }
+  content.resize(p_size);
+
+  WinFile file(p_filename);
+  if(!file.Open(winfile_write | open_trans_binary))
+  {
+    return false;
+  }
+  bool result = file.Write((void*)content.c_str(),content.size());
+  return file.Close() && result;
+}
+
+int
+BENCH_StaticFiles(BenchmarkOptions& p_options)
+{
+  int port        = p_options.GetOptionInt(_T("port"),       1961);
+  int connections = p_options.GetOptionInt(_T("connections"),16);
+  int seconds     = p_options.GetOptionInt(_T("seconds"),    5);
+  int smallSize   = p_options.GetOptionInt(_T("small"),      2 * 1024);
+  int largeSize   = p_options.GetOptionInt(_T("large"),      512 * 1024);
+
+  _tprintf(_T("Connections: %d Seconds: %d Small: %d bytes Large: %d bytes\n"),connections,seconds,smallSize,largeSize);
+
+  // STEP 1: Create the assets in the webroot
+  TCHAR tempdir[MAX_PATH + 1] = _T("");
+  GetTempPath(MAX_PATH,tempdir);
+  XString webroot = XString(tempdir) + _T("BenchStatic");
+  WinFile dir(webroot + _T("\\Bench\\"));
+  dir.CreateDirectory();
+  if(!WriteAsset(webroot + _T("\\Bench\\small.css"),smallSize) ||
+     !WriteAsset(webroot + _T("\\Bench\\large.css"),largeSize))
+  {
+    _tprintf(_T("ERROR: Cannot write the assets in: %s\n"),webroot.GetString());
+    return 1;
+  }
+
+  // STEP 2: Start the server with the standard GET handler
+  HTTPServerSocket* server = new HTTPServerSocket(_T("Benchmark"));
+  server->SetWebroot(webroot);
+  server->SetErrorReport(&g_errorReport);
+  if(!server->Initialise())
+  {
+    _tprintf(_T("ERROR: Cannot initialise the socket server\n"));
+    delete server;
+    return 1;
+  }
+  HTTPSite* site = server->CreateSite(PrefixType::URLPRE_Weak,false,port,_T("/Bench/"));
+  if(site == nullptr)
+  {
+    _tprintf(_T("ERROR: Cannot create the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  site->SetHTTPCompression(true);
+  site->SetHandler(HTTPCommand::http_get,new SiteHandlerGet());
+  if(!site->StartSite())
+  {
+    _tprintf(_T("ERROR: Cannot start the benchmark site on port: %d\n"),port);
+    delete server;
+    return 1;
+  }
+  server->Run();
+  server->SetIsProcessing(true);
+
+  // STEP 3: All runs for both assets
+  bool result = true;
+  const char* resources[2] = { "/Bench/small.css", "/Bench/large.css" };
+  const TCHAR* names[2]    = { _T("small"),        _T("large")        };
+  for(int ind = 0; ind < 2; ++ind)
+  {
+    XString metric;
+
+    site->SetStaticContentCache(false);
+    metric.Format(_T("%s_file"),names[ind]);
+    result &= RunStaticLoad(metric,port,connections,seconds,MakeRequest(resources[ind],""));
+
+    site->SetStaticContentCache(true);
+    metric.Format(_T("%s_cache"),names[ind]);
+    result &= RunStaticLoad(metric,port,connections,seconds,MakeRequest(resources[ind],""));
+
+    metric.Format(_T("%s_gzip"),names[ind]);
+    result &= RunStaticLoad(metric,port,connections,seconds,MakeRequest(resources[ind],"Accept-Encoding: gzip\r\n"));
+
+    std::string match = "If-None-Match: " + FetchETag(port,resources[ind]) + "\r\n";
+    metric.Format(_T("%s_notmod"),names[ind]);
+    result &= RunStaticLoad(metric,port,connections,seconds,MakeRequest(resources[ind],match.c_str()));
+  }
+
+  // STEP 4: Stop the server
+  server->StopServer();
+  delete server;
+
+  return result ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// BENCH_ThreadPool.cpp
+//
+// Many tiny tasks through the Marlin ThreadPool
+// Compares the I/O completion port scheduler with the work-stealing scheduler
+//
+// Scenarios:
+// - external: one thread outside the pool submits all tasks
+// - fanout  : seed tasks inside the pool each submit a number of child tasks
+//
+// Options: /tasks:N /seeds:N /affinity
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "ThreadPool.h"
+#include <atomic>
+
+// State of one benchmark run
+typedef struct _tinyRun
+{
+  ThreadPool*       m_pool     { nullptr };
+  long              m_total    { 0 };
+  long              m_children { 0 };
+  std::atomic<long> m_done     { 0 };
+  HANDLE            m_event    { NULL };
+}
+TinyRun;
+
+// The tiny task itself: just count
+static void
+TinyTask(void* p_argument)
+{
+  TinyRun* run = reinterpret_cast<TinyRun*>(p_argument);
+  if(++run->m_done == run->m_total)
+  {
+    SetEvent(run->m_event);
+  }
+}
+
+// Seed task: submit the children from inside the pool
+static void
+SeedTask(void* p_argument)
+{
+  TinyRun* run = reinterpret_cast<TinyRun*>(p_argument);
+  for(long index = 0; index < run->m_children; ++index)
+  {
+    run->m_pool->SubmitWork(TinyTask,run);
+  }
+  TinyTask(p_argument);
+}
+
+static void
+RunScenario(LPCTSTR p_name,PoolScheduler p_scheduler,bool p_fanout,long p_tasks,long p_seeds,bool p_affinity)
+{
+  ThreadPool pool;
+  pool.SetScheduler(p_scheduler);
+  pool.SetThreadAffinity(p_affinity);
+  pool.Run();
+
+  TinyRun run;
+  run.m_pool  = &pool;
+  run.m_event = CreateEvent(NULL,TRUE,FALSE,NULL);
+
+  // Warming up: all threads started
+  Sleep(200);
+  pool.ResetStatistics();
+
+  double start = BenchmarkNow();
+  if(p_fanout)
+  {
+    run.m_children = p_tasks / p_seeds;
+    run.m_total    = p_seeds * (run.m_children + 1);
+    for(long seed = 0; seed < p_seeds; ++seed)
+    {
+      pool.SubmitWork(SeedTask,&run);
+    }
+  }
+  else
+  {
+    run.m_total = p_tasks;
+    for(long task = 0; task < p_tasks; ++task)
+    {
+      pool.SubmitWork(TinyTask,&run);
+    }
+  }
+  WaitForSingleObject(run.m_event,INFINITE);
+  double elapsed = BenchmarkNow() - start;
+
+  ThreadPoolStatistics stats;
+  pool.GetStatistics(stats);
+
+  BenchmarkReport(p_name,_T("threads"),         (double)pool.GetCurrentThreads(),  _T(""));
+  BenchmarkReport(p_name,_T("throughput"),      (double)run.m_total / elapsed,     _T("tasks/s"));
+  BenchmarkReport(p_name,_T("queue latency avg"),stats.m_queueTimeAvg,             _T("us"));
+  BenchmarkReport(p_name,_T("queue latency max"),stats.m_queueTimeMax,             _T("us"));
+  BenchmarkReport(p_name,_T("stolen"),          (double)stats.m_stolen,            _T(""));
+  BenchmarkReport(p_name,_T("shared queue"),    (double)stats.m_overflow,          _T(""));
+
+  CloseHandle(run.m_event);
+}
+
+int
+BENCH_ThreadPool(BenchmarkOptions& p_options)
+{
+  long tasks    = p_options.GetOptionInt (_T("tasks"),1000000);
+  long seeds    = p_options.GetOptionInt (_T("seeds"),64);
+  bool affinity = p_options.GetOptionBool(_T("affinity"));
+
+  if(seeds < 1)
+  {
+    seeds = 1;
+  }
+  _tprintf(_T("Tasks: %ld Seeds: %ld Affinity: %s\n"),tasks,seeds,affinity ? _T("yes") : _T("no"));
+
+  RunScenario(_T("completion/external"),PoolScheduler::PS_Completion,  false,tasks,seeds,affinity);
+  RunScenario(_T("stealing/external"),  PoolScheduler::PS_WorkStealing,false,tasks,seeds,affinity);
+  RunScenario(_T("completion/fanout"),  PoolScheduler::PS_Completion,  true, tasks,seeds,affinity);
+  RunScenario(_T("stealing/fanout"),    PoolScheduler::PS_WorkStealing,true, tasks,seeds,affinity);
+  return 0;
+}
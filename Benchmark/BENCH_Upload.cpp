@@ -0,0 +1,138 @@
+// BENCH_Upload.cpp
+//
+// Receiving a large multipart/form-data upload with one data part and one file part
+// - buffered : the complete body in a FileBuffer, parsed by MultiPartBuffer::ParseBuffer
+// - stream   : the body in network sized chunks through the MultiPartStream body sink
+//              the file part is written to a temporary file
+// Reports megabytes per second and the peak memory of the stream parser
+//
+// Options: /megabytes:N /chunk:N /rounds:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "MultiPartBuffer.h"
+#include "MultiPartStream.h"
+#include <string>
+
+static const char* g_boundary = "----BenchUploadBoundary7MA4YWxkTrZu0gW";
+
+static std::string
+UploadHead()
+{
+  std::string head;
+  head += "--"; head += g_boundary; head += "\r\n";
+  head += "Content-Disposition: form-data; name=\"description\"\r\n\r\n";
+  head += "Benchmark upload of a large file\r\n";
+  head += "--"; head += g_boundary; head += "\r\n";
+  head += "Content-Disposition: form-data; name=\"file\"; filename=\"upload.bin\"\r\n";
+  head += "Content-Type: application/octet-stream\r\n\r\n";
+  return head;
+}
+
+static std::string
+UploadTail()
+{
+  std::string tail("\r\n--");
+  tail += g_boundary;
+  tail += "--\r\n";
+  return tail;
+}
+
+// File contents in chunks, with a pattern that contains CR/LF and dashes
+static void
+FillPattern(std::string& p_chunk,size_t p_offset,size_t p_length)
+{
+  static const char pattern[] = "0123456789\r\n--abcdefghijklmnopqrstuvwxyz-\r\n";
+  p_chunk.resize(p_length);
+  for(size_t ind = 0; ind < p_length; ++ind)
+  {
+    p_chunk[ind] = pattern[(p_offset + ind) % (sizeof(pattern) - 1)];
+  }
+}
+
+// The buffered parser leaves the CR/LF before the next boundary in the part
+static bool
+CheckFilePart(MultiPartBuffer* p_buffer,size_t p_size)
+{
+  MultiPart* part = p_buffer->GetPart(_T("file"));
+  MultiPart* data = p_buffer->GetPart(_T("description"));
+  if(p_buffer->GetParts() != 2 || part == nullptr || data == nullptr)
+  {
+    return false;
+  }
+  size_t length = part->GetBuffer()->GetLength();
+  return length == p_size || length == p_size + 2;
+}
+
+int
+BENCH_Upload(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("upload");
+  int megabytes = p_options.GetOptionInt(_T("megabytes"),64);
+  int chunk     = p_options.GetOptionInt(_T("chunk"),    64 * 1024);
+  int rounds    = p_options.GetOptionInt(_T("rounds"),   3);
+
+  _tprintf(_T("File part: %d MB Chunk: %d bytes Rounds: %d\n"),megabytes,chunk,rounds);
+
+  size_t fileSize = (size_t)megabytes * 1024 * 1024;
+  std::string head  = UploadHead();
+  std::string tail  = UploadTail();
+  XString contentType = XString(_T("multipart/form-data; boundary=")) + XString(g_boundary);
+  unsigned errors = 0;
+
+  // STEP 1: Complete body in memory, parsed in one go
+  {
+    std::string body(head);
+    std::string content;
+    FillPattern(content,0,fileSize);
+    body += content;
+    body += tail;
+    content.clear();
+    content.shrink_to_fit();
+
+    double start = BenchmarkNow();
+    for(int round = 0; round < rounds; ++round)
+    {
+      FileBuffer buffer;
+      buffer.SetBuffer(reinterpret_cast<uchar*>(body.data()),body.size());
+      MultiPartBuffer multi(FormDataType::FD_UNKNOWN);
+      if(!multi.ParseBuffer(contentType,&buffer) || !CheckFilePart(&multi,fileSize))
+      {
+        ++errors;
+      }
+    }
+    double elapsed = BenchmarkNow() - start;
+    BenchmarkReport(name,_T("buffered"),(double)megabytes * rounds / elapsed,_T("MB/s"));
+    BenchmarkReport(name,_T("buffered_body"),(double)body.size() / 1024.0,_T("KB"));
+  }
+
+  // STEP 2: Body in chunks through the streaming parser
+  {
+    size_t peak = 0;
+    std::string content;
+    double start = BenchmarkNow();
+    for(int round = 0; round < rounds; ++round)
+    {
+      MultiPartStream stream(contentType);
+      bool result = stream.OnBodyChunk(reinterpret_cast<const uchar*>(head.data()),head.size());
+      for(size_t offset = 0; result && offset < fileSize; offset += chunk)
+      {
+        FillPattern(content,offset,(std::min)((size_t)chunk,fileSize - offset));
+        result = stream.OnBodyChunk(reinterpret_cast<const uchar*>(content.data()),content.size());
+      }
+      result = result && stream.OnBodyChunk(reinterpret_cast<const uchar*>(tail.data()),tail.size());
+      if(!stream.OnBodyEnd(result) || !CheckFilePart(stream.GetMultiPartBuffer(),fileSize))
+      {
+        _tprintf(_T("ERROR: %s\n"),stream.GetError().GetString());
+        ++errors;
+      }
+      peak = (std::max)(peak,stream.GetPeakMemory());
+    }
+    double elapsed = BenchmarkNow() - start;
+    BenchmarkReport(name,_T("stream"),     (double)megabytes * rounds / elapsed,_T("MB/s"));
+    BenchmarkReport(name,_T("stream_peak"),(double)peak / 1024.0,               _T("KB"));
+  }
+  BenchmarkReport(name,_T("errors"),(double)errors,_T(""));
+
+  return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// BENCH_WSDLCheck.cpp
+//
+// WSDL checking of SOAP messages with field checking switched on.
+// Uses the same operation templates as CXServer (CXH_Select and its response)
+// and a request with a number of filters. The Column and Operator fields of
+// the request carry a pattern and an enumeration restriction.
+//
+// Options: /filters:N /checks:N
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "WSDLCache.h"
+#include "SOAPMessage.h"
+#include "XMLRestriction.h"
+
+static const TCHAR* g_namespace = _T("http://cxhibernate.org/benchmark");
+
+// Same templates as CXServer::RegisterSelectOperation
+static void
+RegisterSelect(WSDLCache& p_cache)
+{
+  XString space(g_namespace);
+  XString request(_T("CXH_Select"));
+  XString response = request + _T("Response");
+
+  SOAPMessage input (space,request);
+  SOAPMessage output(space,response);
+
+  XMLElement* entity  = input.AddElement(NULL,   _T("Entity"), WSDL_Mandatory|XDT_String,_T(""));
+  XMLElement* filters = input.AddElement(entity, _T("Filters"),WSDL_Mandatory|WSDL_OneMany|XDT_String,_T(""));
+  XMLElement* filter  = input.AddElement(filters,_T("Filter"), WSDL_Mandatory|WSDL_OneMany|XDT_String,_T(""));
+  input.AddElement(filter,_T("Column"),  WSDL_Mandatory|XDT_String,_T("string"));
+  input.AddElement(filter,_T("Operator"),WSDL_Mandatory|XDT_String,_T("string"));
+  input.AddElement(filter,_T("Value"),   WSDL_Optional |XDT_Integer,_T("int"));
+
+  output.AddElement(NULL,_T("Entity"),WSDL_Optional|WSDL_ZeroMany|XDT_String,_T("string"));
+
+  p_cache.AddOperation(1,request,&input,&output);
+}
+
+// A select request with 'p_filters' filters
+static SOAPMessage*
+MakeRequest(int p_filters,XMLRestrictions& p_restrictions)
+{
+  XMLRestriction* column   = p_restrictions.FindRestriction(_T("column"));
+  XMLRestriction* operands = p_restrictions.FindRestriction(_T("operator"));
+
+  XString space(g_namespace);
+  XString action(_T("CXH_Select"));
+  SOAPMessage* msg = new SOAPMessage(space,action);
+  XMLElement* entity  = msg->AddElement(NULL,   _T("Entity"), XDT_String,_T(""));
+  XMLElement* filters = msg->AddElement(entity, _T("Filters"),XDT_String,_T(""));
+  for(int index = 0;index < p_filters;++index)
+  {
+    XString name;
+    name.Format(_T("column_%d"),index);
+    XMLElement* filter = msg->AddElement(filters,_T("Filter"),XDT_String,_T(""));
+    msg->AddElement(filter,_T("Column"),  XDT_String,name)->SetRestriction(column);
+    msg->AddElement(filter,_T("Operator"),XDT_String,_T("="))->SetRestriction(operands);
+    msg->AddElement(filter,_T("Value"),   XDT_Integer,_T("42"));
+  }
+  return msg;
+}
+
+// A response with 'p_entities' entities
+static SOAPMessage*
+MakeResponse(int p_entities)
+{
+  XString space(g_namespace);
+  XString action(_T("CXH_Select"));
+  SOAPMessage* msg = new SOAPMessage(space,action);
+  msg->SetParameterObject(_T("CXH_SelectResponse"));
+  for(int index = 0;index < p_entities;++index)
+  {
+    msg->AddElement(NULL,_T("Entity"),XDT_String,_T("entity"));
+  }
+  return msg;
+}
+
+int
+BENCH_WSDLCheck(BenchmarkOptions& p_options)
+{
+  const TCHAR* name = _T("wsdlcheck");
+  int filters = p_options.GetOptionInt(_T("filters"),20);
+  int checks  = p_options.GetOptionInt(_T("checks"), 100000);
+
+  _tprintf(_T("Filters: %d Checks: %d\n"),filters,checks);
+
+  XMLRestrictions restrictions;
+  restrictions.AddRestriction(_T("column"))->AddPattern(_T("[A-Za-z_][A-Za-z0-9_]*"));
+  XMLRestriction* operands = restrictions.AddRestriction(_T("operator"));
+  operands->AddEnumeration(_T("="));
+  operands->AddEnumeration(_T("<>"));
+  operands->AddEnumeration(_T("<"));
+  operands->AddEnumeration(_T(">"));
+  operands->AddEnumeration(_T("LIKE"));
+  operands->AddEnumeration(_T("IN"));
+
+  WSDLCache cache(true);
+  RegisterSelect(cache);
+
+  SOAPMessage* request  = MakeRequest(filters,restrictions);
+  SOAPMessage* response = MakeResponse(filters);
+
+  // Incoming requests
+  double start = BenchmarkNow();
+  for(int index = 0;index < checks;++index)
+  {
+    if(!cache.CheckIncomingMessage(request,true))
+    {
+      _tprintf(_T("ERROR: Request check failed: %s\n"),request->GetFault().GetString());
+      delete request;
+      delete response;
+      return 1;
+    }
+  }
+  double elapsed = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("request checks"),(double)checks / elapsed,_T("msg/s"));
+  BenchmarkReport(name,_T("request check"), elapsed * 1000000.0 / checks,_T("us"));
+
+  // Outgoing responses
+  start = BenchmarkNow();
+  for(int index = 0;index < checks;++index)
+  {
+    if(!cache.CheckOutgoingMessage(response,true))
+    {
+      _tprintf(_T("ERROR: Response check failed: %s\n"),response->GetFault().GetString());
+      delete request;
+      delete response;
+      return 1;
+    }
+  }
+  elapsed = BenchmarkNow() - start;
+  BenchmarkReport(name,_T("response checks"),(double)checks / elapsed,_T("msg/s"));
+  BenchmarkReport(name,_T("response check"), elapsed * 1000000.0 / checks,_T("us"));
+
+  delete request;
+  delete response;
+  return 0;
+}
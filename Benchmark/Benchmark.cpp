@@ -0,0 +1,305 @@
+// Benchmark.cpp : Defines the entry point for the console application.
+// Runs one or more of the performance benchmarks of the libraries
+//
+// Usage: Benchmark [name ...] [/option:value ...]
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "ServerSupervisor.h"
+#include <algorithm>
+
+typedef int (*BenchmarkFunction)(BenchmarkOptions& p_options);
+
+typedef struct _benchmark
+{
+  LPCTSTR           m_name;
+  LPCTSTR           m_description;
+  BenchmarkFunction m_function;
+}
+BenchmarkEntry;
+
+// All benchmarks. Add new benchmarks at the end
+static BenchmarkEntry g_benchmarks[] =
+{
+  { _T("httploopback"), _T("HTTP keep-alive/pipelined load on the socket server over loopback"), BENCH_HTTPLoopback }
+ ,{ _T("threadpool"),   _T("Many tiny tasks: completion port versus work-stealing scheduler"),    BENCH_ThreadPool   }
+ ,{ _T("eventdriver"),  _T("End-to-end SSE event latency through the ServerEventDriver"),         BENCH_EventDriver  }
+ ,{ _T("wsdlcheck"),    _T("WSDL checking of CXServer operations with field checking on"),       BENCH_WSDLCheck    }
+ ,{ _T("ordinals"),     _T("De-serialize 1M result set rows: by column name versus by ordinal"), BENCH_Ordinals     }
+ ,{ _T("columnar"),     _T("Save 1M result set rows: XMLSave versus Arrow and Parquet files"),   BENCH_Columnar     }
+ ,{ _T("patheval"),     _T("Evaluate a dozen JSON/XML paths: parse each time versus compiled"), BENCH_PathEval     }
+ ,{ _T("staticfiles"),  _T("Static files by the GET handler: disk, cache, gzip and 304"),        BENCH_StaticFiles  }
+ ,{ _T("clientpool"),   _T("HTTP client over loopback: one connection versus connection pool"),  BENCH_ClientPool   }
+ ,{ _T("upload"),       _T("Large multipart upload: complete body versus streaming parser"),     BENCH_Upload       }
+ ,{ _T("logging"),      _T("32 threads logging: locked logfile versus lock-free thread rings"),   BENCH_Logging      }
+ ,{ _T("metrics"),      _T("Metrics overhead: timers, sharded counters and request throughput"), BENCH_Metrics      }
+ ,{ _T("orm"),          _T("ORM hot paths in all mapping strategies against an ODBC database"),  BENCH_ORM          }
+ ,{ _T("prefork"),      _T("Worker processes on a shared port: scaling and rolling restart"),    BENCH_Prefork      }
+ ,{ _T("http2"),        _T("HTTP/1.1 on 6 connections versus HTTP/2 streams on 1 connection"),  BENCH_HTTP2        }
+ ,{ _T("alloc"),        _T("Heap allocations per keep-alive request, with the message pool"),   BENCH_Alloc        }
+};
+
+// Machine readable results (/results:file.csv) and the label of this run (/label:text)
+static FILE*   g_results { nullptr };
+static XString g_label;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Options
+//
+//////////////////////////////////////////////////////////////////////////
+
+void
+BenchmarkOptions::SetOption(XString p_name,XString p_value)
+{
+  p_name.MakeLower();
+  m_options[p_name] = p_value;
+}
+
+XString
+BenchmarkOptions::GetOption(XString p_name,XString p_default /*= _T("")*/)
+{
+  p_name.MakeLower();
+  std::map<XString,XString>::iterator it = m_options.find(p_name);
+  return it == m_options.end() ? p_default : it->second;
+}
+
+int
+BenchmarkOptions::GetOptionInt(XString p_name,int p_default)
+{
+  XString value = GetOption(p_name);
+  return value.IsEmpty() ? p_default : _ttoi(value);
+}
+
+bool
+BenchmarkOptions::GetOptionBool(XString p_name,bool p_default /*= false*/)
+{
+  XString value = GetOption(p_name);
+  if(value.IsEmpty())
+  {
+    return p_default;
+  }
+  return value.CompareNoCase(_T("true")) == 0 || value.CompareNoCase(_T("yes")) == 0 || value == _T("1");
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Timing and reporting
+//
+//////////////////////////////////////////////////////////////////////////
+
+double
+BenchmarkNow()
+{
+  static LARGE_INTEGER frequency = { 0 };
+  if(frequency.QuadPart == 0)
+  {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+void
+LatencyRecorder::Merge(LatencyRecorder& p_other)
+{
+  m_samples.insert(m_samples.end(),p_other.m_samples.begin(),p_other.m_samples.end());
+  m_sorted = false;
+}
+
+double
+LatencyRecorder::Percentile(double p_percentile)
+{
+  if(m_samples.empty())
+  {
+    return 0.0;
+  }
+  if(!m_sorted)
+  {
+    std::sort(m_samples.begin(),m_samples.end());
+    m_sorted = true;
+  }
+  size_t index = (size_t)((p_percentile / 100.0) * (double)(m_samples.size() - 1) + 0.5);
+  return m_samples[min(index,m_samples.size() - 1)];
+}
+
+double
+LatencyRecorder::Average()
+{
+  if(m_samples.empty())
+  {
+    return 0.0;
+  }
+  double total = 0.0;
+  for(auto& sample : m_samples)
+  {
+    total += sample;
+  }
+  return total / (double)m_samples.size();
+}
+
+void
+BenchmarkReport(LPCTSTR p_benchmark,LPCTSTR p_metric,double p_value,LPCTSTR p_unit)
+{
+  _tprintf(_T("%-20s %-28s %14.2f %s\n"),p_benchmark,p_metric,p_value,p_unit);
+  if(g_results)
+  {
+    _ftprintf(g_results,_T("%s,%s,%s,%.4f,%s\n"),g_label.GetString(),p_benchmark,p_metric,p_value,p_unit);
+    fflush(g_results);
+  }
+}
+
+void
+BenchmarkReportLatency(LPCTSTR p_benchmark,LatencyRecorder& p_latency)
+{
+  BenchmarkReport(p_benchmark,_T("latency average"),p_latency.Average(),       _T("us"));
+  BenchmarkReport(p_benchmark,_T("latency p50"),    p_latency.Percentile(50.0),_T("us"));
+  BenchmarkReport(p_benchmark,_T("latency p90"),    p_latency.Percentile(90.0),_T("us"));
+  BenchmarkReport(p_benchmark,_T("latency p99"),    p_latency.Percentile(99.0),_T("us"));
+  BenchmarkReport(p_benchmark,_T("latency p99.9"),  p_latency.Percentile(99.9),_T("us"));
+  BenchmarkReport(p_benchmark,_T("latency max"),    p_latency.Percentile(100.0),_T("us"));
+}
+
+SOCKET
+BenchmarkConnect(int p_port)
+{
+  SOCKET sock = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+  if(sock == INVALID_SOCKET)
+  {
+    return sock;
+  }
+  BOOL nodelay = TRUE;
+  setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,(const char*)&nodelay,sizeof(BOOL));
+
+  sockaddr_in address;
+  memset(&address,0,sizeof(address));
+  address.sin_family      = AF_INET;
+  address.sin_port        = htons((u_short)p_port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(connect(sock,(sockaddr*)&address,sizeof(address)) == SOCKET_ERROR)
+  {
+    closesocket(sock);
+    return INVALID_SOCKET;
+  }
+  return sock;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// MAIN
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void
+PrintUsage()
+{
+  _tprintf(_T("Usage: Benchmark [name ...] [/option:value ...]\n\n"));
+  _tprintf(_T("Benchmarks:\n"));
+  for(auto& bench : g_benchmarks)
+  {
+    _tprintf(_T("  %-18s %s\n"),bench.m_name,bench.m_description);
+  }
+  _tprintf(_T("\nWithout a name all benchmarks are run\n"));
+  _tprintf(_T("Use /results:file.csv /label:text to append the results for comparisons\n"));
+}
+
+int _tmain(int argc,TCHAR* argv[])
+{
+  // initialize MFC and print and error on failure
+  if(!AfxWinInit(::GetModuleHandle(NULL),NULL,::GetCommandLine(), 0))
+  {
+    CString command = ::GetCommandLine();
+    CString message = _T("Fatal Error in Benchmark: MFC initialization failed ") + command;
+    _ftprintf(stderr, message + _T("\n"));
+    return -3;
+  }
+
+  // Print who we are
+  _tprintf(_T("CXHibernate benchmark program\n"));
+  _tprintf(_T("=============================\n"));
+
+  // Gather names and options
+  BenchmarkOptions    options;
+  std::vector<XString> names;
+  for(int index = 1;index < argc;++index)
+  {
+    XString argument(argv[index]);
+    if(argument.GetAt(0) == '/' || argument.GetAt(0) == '-')
+    {
+      argument = argument.Mid(1);
+      if(argument.CompareNoCase(_T("?")) == 0 || argument.CompareNoCase(_T("help")) == 0)
+      {
+        PrintUsage();
+        return 0;
+      }
+      int pos = argument.Find(':');
+      if(pos > 0)
+      {
+        options.SetOption(argument.Left(pos),argument.Mid(pos + 1));
+      }
+      else
+      {
+        options.SetOption(argument,_T("true"));
+      }
+    }
+    else
+    {
+      names.push_back(argument);
+    }
+  }
+
+  // Started as a worker process by the 'prefork' benchmark
+  if(ServerWorker::IsWorker())
+  {
+    return BENCH_PreforkWorker(options);
+  }
+
+  // Results are appended, so runs of different commits can be compared
+  XString results = options.GetOption(_T("results"));
+  g_label = options.GetOption(_T("label"),_T("run"));
+  if(!results.IsEmpty())
+  {
+    if(_tfopen_s(&g_results,results,_T("a")) != 0 || g_results == nullptr)
+    {
+      _tprintf(_T("ERROR: Cannot open the results file: %s\n"),results.GetString());
+      return -2;
+    }
+    fseek(g_results,0,SEEK_END);
+    if(ftell(g_results) == 0)
+    {
+      _ftprintf(g_results,_T("label,benchmark,metric,value,unit\n"));
+    }
+  }
+
+  int result = 0;
+  int number = 0;
+  for(auto& bench : g_benchmarks)
+  {
+    bool run = names.empty();
+    for(auto& name : names)
+    {
+      if(name.CompareNoCase(bench.m_name) == 0)
+      {
+        run = true;
+      }
+    }
+    if(run)
+    {
+      _tprintf(_T("\nBenchmark: %s\n"),bench.m_description);
+      result += (*bench.m_function)(options);
+      ++number;
+    }
+  }
+  if(g_results)
+  {
+    fclose(g_results);
+    g_results = nullptr;
+  }
+  if(number == 0)
+  {
+    PrintUsage();
+    return -1;
+  }
+  return result;
+}
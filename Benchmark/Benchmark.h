@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: Benchmark.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number:  0.0.1
+//
+#pragma once
+#include <winsock2.h>
+#include <vector>
+#include <map>
+
+// Options from the command line: /name:value
+class BenchmarkOptions
+{
+public:
+  void    SetOption(XString p_name,XString p_value);
+  XString GetOption(XString p_name,XString p_default = _T(""));
+  int     GetOptionInt(XString p_name,int p_default);
+  bool    GetOptionBool(XString p_name,bool p_default = false);
+
+private:
+  std::map<XString,XString> m_options;
+};
+
+// High resolution clock in seconds
+double BenchmarkNow();
+
+// Collecting latency samples (in microseconds)
+class LatencyRecorder
+{
+public:
+  void   Reserve(size_t p_size)        { m_samples.reserve(p_size); }
+  void   Add(double p_microseconds)    { m_samples.push_back(p_microseconds); }
+  void   Merge(LatencyRecorder& p_other);
+  size_t GetCount()                    { return m_samples.size(); }
+  // Percentile between 0.0 and 100.0. Sorts the samples
+  double Percentile(double p_percentile);
+  double Average();
+
+private:
+  std::vector<double> m_samples;
+  bool                m_sorted { false };
+};
+
+// Print one result line of a benchmark
+void BenchmarkReport(LPCTSTR p_benchmark,LPCTSTR p_metric,double p_value,LPCTSTR p_unit);
+// Print the percentiles of a latency recorder
+void BenchmarkReportLatency(LPCTSTR p_benchmark,LatencyRecorder& p_latency);
+
+// TCP connection to our own server on the loopback address (without Nagle)
+// INVALID_SOCKET if the connection could not be made
+SOCKET BenchmarkConnect(int p_port);
+
+// ALL BENCHMARKS
+int BENCH_HTTPLoopback(BenchmarkOptions& p_options);
+int BENCH_ThreadPool  (BenchmarkOptions& p_options);
+int BENCH_EventDriver (BenchmarkOptions& p_options);
+int BENCH_WSDLCheck   (BenchmarkOptions& p_options);
+int BENCH_Ordinals    (BenchmarkOptions& p_options);
+int BENCH_Columnar    (BenchmarkOptions& p_options);
+int BENCH_PathEval    (BenchmarkOptions& p_options);
+int BENCH_StaticFiles (BenchmarkOptions& p_options);
+int BENCH_ClientPool  (BenchmarkOptions& p_options);
+int BENCH_Upload      (BenchmarkOptions& p_options);
+int BENCH_Logging     (BenchmarkOptions& p_options);
+int BENCH_Metrics     (BenchmarkOptions& p_options);
+int BENCH_ORM         (BenchmarkOptions& p_options);
+int BENCH_Prefork     (BenchmarkOptions& p_options);
+int BENCH_HTTP2       (BenchmarkOptions& p_options);
+int BENCH_Alloc       (BenchmarkOptions& p_options);
+
+// Worker process of the 'prefork' benchmark
+int BENCH_PreforkWorker(BenchmarkOptions& p_options);
@@ -0,0 +1,562 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXBulkLoader.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include "CXBulkLoader.h"
+#include "CXSession.h"
+#include "CXClass.h"
+#include "CXAttribute.h"
+#include <SQLAutoDBS.h>
+#include <SQLTransaction.h>
+#include <SQLInfoDB.h>
+#include <AutoCritical.h>
+#include <process.h>
+#include <algorithm>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CXBulkLoader::CXBulkLoader(CXSession* p_session,CXBulkOptions* p_options /*= nullptr*/)
+             :m_session(p_session)
+{
+  if(p_options)
+  {
+    m_options = *p_options;
+  }
+  m_options.m_workers        = std::min(std::max(m_options.m_workers,1),CXBULK_MAX_WORKERS);
+  m_options.m_commitInterval = std::max(m_options.m_commitInterval,1);
+  m_options.m_keyBlock       = std::max(m_options.m_keyBlock,0);
+
+  InitializeCriticalSection(&m_lock);
+}
+
+CXBulkLoader::~CXBulkLoader()
+{
+  DeleteCriticalSection(&m_lock);
+}
+
+// Insert all objects. Throws if one of the connections failed
+bool
+CXBulkLoader::Load(CXResultSet& p_objects,CXBulkReport* p_report /*= nullptr*/)
+{
+  m_start = GetTickCount64();
+  m_report.m_objects = (int)p_objects.size();
+
+  try
+  {
+    // Group the objects by class
+    std::map<CXClass*,CXResultSet> groups;
+    for(auto& object : p_objects)
+    {
+      CXClass* theClass = object->GetClass();
+      if(theClass == nullptr)
+      {
+        throw StdException(_T("Object without a connected class. Did you call CXSession::CreateObject(<classname>)??"));
+      }
+      groups[theClass].push_back(object);
+    }
+
+    // Objects that are already in the database would be inserted twice
+    for(auto& group : groups)
+    {
+      bool generated = group.first->GetRootClass()->FindGenerator() != nullptr;
+      for(auto& object : group.second)
+      {
+        if(object->IsDetached() || (generated && !object->IsTransient()))
+        {
+          throw StdException(_T("Bulk insert of an object that is already persistent. Class: ") + group.first->GetName());
+        }
+      }
+    }
+
+    // Masters before details
+    std::vector<CXClass*> order;
+    OrderClasses(groups,order);
+
+    for(auto& theClass : order)
+    {
+      CXResultSet& objects = groups[theClass];
+      {
+        // Generated keys are allocated before we go parallel
+        SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+        AllocateKeys(theClass,objects,dbs);
+      }
+      LoadClass(theClass,objects);
+
+      if(!m_report.m_errors.IsEmpty())
+      {
+        break;
+      }
+    }
+  }
+  catch(StdException& ex)
+  {
+    // The caller still gets the report of what has been loaded so far
+    m_report.m_errors += ex.GetErrorMessage() + _T("\n");
+  }
+
+  m_report.m_seconds   = (double)(GetTickCount64() - m_start) / 1000.0;
+  m_report.m_perSecond = m_report.m_seconds > 0.0 ? (double)m_report.m_inserted / m_report.m_seconds : 0.0;
+  hibernate.Log(CXH_LOG_ACTIONS,true,_T("Bulk insert of %d objects (%d records) in %.3f seconds: %.0f objects/sec")
+               ,m_report.m_inserted,m_report.m_records,m_report.m_seconds,m_report.m_perSecond);
+
+  if(p_report)
+  {
+    *p_report = m_report;
+  }
+  if(!m_report.m_errors.IsEmpty())
+  {
+    throw StdException(_T("Bulk insert failed: ") + m_report.m_errors);
+  }
+  return m_report.m_inserted == (int)p_objects.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PREPARING THE LOAD
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Order the classes by their associations (masters first)
+// Classes in a cycle of associations are loaded in the order given
+void
+CXBulkLoader::OrderClasses(std::map<CXClass*,CXResultSet>& p_groups,std::vector<CXClass*>& p_order)
+{
+  std::map<CXClass*,std::vector<CXClass*>> masters;
+  for(auto& group : p_groups)
+  {
+    CXClass* theClass = group.first;
+    for(CXClass* cl = theClass;cl;cl = cl->GetSuperClass())
+    {
+      CXAssociation* assoc = nullptr;
+      for(int index = 0;(assoc = cl->FindAssociation(index)) != nullptr;++index)
+      {
+        if(assoc->m_assocType != ASSOC_MANY_TO_ONE)
+        {
+          continue;
+        }
+        CXClass* master = m_session->FindClass(assoc->m_primaryTable);
+        if(master && master != theClass && p_groups.find(master) != p_groups.end())
+        {
+          masters[theClass].push_back(master);
+        }
+      }
+    }
+  }
+
+  std::map<CXClass*,bool> done;
+  while(p_order.size() < p_groups.size())
+  {
+    bool progress = false;
+    for(auto& group : p_groups)
+    {
+      CXClass* theClass = group.first;
+      if(done[theClass])
+      {
+        continue;
+      }
+      bool ready = true;
+      for(auto& master : masters[theClass])
+      {
+        ready &= done[master];
+      }
+      if(ready)
+      {
+        p_order.push_back(theClass);
+        done[theClass] = true;
+        progress = true;
+      }
+    }
+    if(!progress)
+    {
+      // Cycle in the associations: take the rest as-is
+      for(auto& group : p_groups)
+      {
+        if(!done[group.first])
+        {
+          hibernate.Log(CXH_LOG_ERRORS,true,_T("Bulk insert: class [%s] is in a cycle of associations"),group.first->GetName().GetString());
+          p_order.push_back(group.first);
+          done[group.first] = true;
+        }
+      }
+    }
+  }
+}
+
+// Allocate all generated keys for one class in advance
+// A generator with a strategy (see CXGenerator) gives the keys from its blocks
+// Otherwise without a key block this is one sequence call per object (but never in the INSERT)
+// With a key block of <n> one sequence value <v> gives the keys <v> ... <v+n-1>.
+// That is only safe for a sequence with "INCREMENT BY <n>" (or more): other
+// sessions then never get a value inside our block. See SequenceBlock.
+void
+CXBulkLoader::AllocateKeys(CXClass* p_class,CXResultSet& p_objects,SQLDatabase* p_database)
+{
+  CXClass*     root = p_class->GetRootClass();
+  CXAttribute* gen  = root->FindGenerator();
+  if(gen == nullptr)
+  {
+    return;
+  }
+  CXTable* table    = root->GetTable();
+  CString  sequence = root->GetGenerator();
+
+  // Scratch record with the columns of the root table
+  SQLDataSet shape;
+  SQLVariant empty;
+  shape.InsertRecord();
+  for(auto& column : table->GetColumnInfo())
+  {
+    shape.InsertField(column.m_column,&empty);
+  }
+  int field = shape.GetFieldNumber(gen->GetName());
+
+  // Generators of another strategy hand out keys from their own blocks
+  CXGenerator* keygen = root->GetKeyGenerator();
+  if(keygen && !keygen->IsClientSide())
+  {
+    keygen = nullptr;
+  }
+
+  int     block = keygen ? 1 : SequenceBlock(p_database,table,sequence);
+  __int64 key   = 0;
+  __int64 last  = 0;
+  for(auto& object : p_objects)
+  {
+    if(!object->IsTransient())
+    {
+      continue;
+    }
+    SQLVariant value;
+    if(keygen)
+    {
+      value = keygen->NextKey();
+    }
+    else if(key >= last)
+    {
+      __int64 hi = _ttoi64(p_database->GetSQL_GenerateSerial(table->GetTableName(),sequence));
+      ++m_report.m_keyCalls;
+      if(hi <= 0)
+      {
+        throw StdException(_T("Bulk insert needs a sequence for the generator of class: ") + p_class->GetName());
+      }
+      key  = hi;
+      last = hi + block;
+    }
+
+    if(value.IsNULL())
+    {
+      // Same datatype as the keys of CXGenerator::NextKey
+      __int64 next = key++;
+      value = next <= INT_MAX ? SQLVariant((int)next) : SQLVariant(next);
+    }
+
+    // Let the object take its new key
+    SQLRecord  record(&shape,true);
+    for(int ind = 0;ind < shape.GetNumberOfFields();++ind)
+    {
+      record.AddField(&empty);
+    }
+    record.SetField(field,&value);
+
+    SQLRecord* own = object->TempReplaceRecord(&record);
+    object->ResetPrimaryKey();
+    object->DeSerializeGenerator(record);
+    object->TempReplaceRecord(own);
+  }
+}
+
+// Number of keys we may take from one value of the sequence.
+// That is the key block, but never more than the increment of the sequence.
+// If the catalog cannot tell us the increment, we take one key per value.
+int
+CXBulkLoader::SequenceBlock(SQLDatabase* p_database,CXTable* p_table,CString p_sequence)
+{
+  if(m_options.m_keyBlock <= 1)
+  {
+    return 1;
+  }
+  XString schema = p_table->GetSchemaName();
+  XString name   = p_sequence;
+  int pos = name.Find('.');
+  if(pos > 0)
+  {
+    schema = name.Left(pos);
+    name   = name.Mid(pos + 1);
+  }
+
+  MSequenceMap sequences;
+  XString      errors;
+  try
+  {
+    p_database->GetSQLInfoDB()->MakeInfoTableSequences(sequences,errors,schema,name);
+  }
+  catch(StdException& ex)
+  {
+    errors = ex.GetErrorMessage();
+  }
+  for(auto& seq : sequences)
+  {
+    if(seq.m_sequenceName.CompareNoCase(name) == 0 && seq.m_increment > 1)
+    {
+      return std::min(m_options.m_keyBlock,(int)seq.m_increment);
+    }
+  }
+  hibernate.Log(CXH_LOG_ERRORS,true,_T("Bulk insert: sequence [%s] has no increment of %d. Taking one key per sequence call.")
+               ,p_sequence.GetString(),m_options.m_keyBlock);
+  return 1;
+}
+
+// Load one class on all connections
+void
+CXBulkLoader::LoadClass(CXClass* p_class,CXResultSet& p_objects)
+{
+  // No use in a connection for less than a few hundred objects
+  int workers = std::min(m_options.m_workers,std::max(1,(int)p_objects.size() / 250));
+  size_t chunk = (p_objects.size() + workers - 1) / workers;
+
+  // Lazy initialization of the classes must be done before we go parallel
+  p_class->GetShapeDataSet();
+  std::vector<CXClass*> levels;
+  p_class->FindTableClasses(levels);
+  for(auto& level : levels)
+  {
+    level->GetTableDataSet();
+  }
+
+  std::vector<BulkWorker> pool(workers);
+  HANDLE handles[CXBULK_MAX_WORKERS];
+  int running = 0;
+
+  for(int ind = 0;ind < workers;++ind)
+  {
+    BulkWorker& worker = pool[ind];
+    worker.m_loader = this;
+    worker.m_class  = p_class;
+    size_t begin = ind * chunk;
+    size_t end   = std::min(begin + chunk,p_objects.size());
+    if(begin >= end)
+    {
+      break;
+    }
+    worker.m_objects.assign(p_objects.begin() + begin,p_objects.begin() + end);
+
+    unsigned threadID = 0;
+    worker.m_thread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr,0,RunWorker,reinterpret_cast<void*>(&worker),0,&threadID));
+    if(worker.m_thread == NULL)
+    {
+      // Do it on this thread then
+      WorkerLoad(&worker);
+      continue;
+    }
+    handles[running++] = worker.m_thread;
+  }
+  if(running)
+  {
+    WaitForMultipleObjects(running,handles,TRUE,INFINITE);
+  }
+
+  for(auto& worker : pool)
+  {
+    if(worker.m_thread)
+    {
+      CloseHandle(worker.m_thread);
+    }
+    m_report.m_records += worker.m_records;
+    m_report.m_commits += worker.m_commits;
+    if(!worker.m_error.IsEmpty())
+    {
+      m_report.m_errors += worker.m_error + _T("\n");
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WORKER THREADS
+//
+//////////////////////////////////////////////////////////////////////////
+
+/*static*/ unsigned __stdcall
+CXBulkLoader::RunWorker(void* p_worker)
+{
+  BulkWorker* worker = reinterpret_cast<BulkWorker*>(p_worker);
+  worker->m_loader->WorkerLoad(worker);
+  return 0;
+}
+
+// Insert the objects of one worker on its own pooled connection
+// A failing transaction is rolled back. Earlier commits stay in the database
+void
+CXBulkLoader::WorkerLoad(BulkWorker* p_worker)
+{
+  std::vector<CXClass*> levels;
+  p_worker->m_class->FindTableClasses(levels);
+
+  SQLTransaction* trans = nullptr;
+  int count = 0;
+  try
+  {
+    // The connection is held until the rollback is done and the
+    // prepared statements are freed. Only then it goes back to the pool
+    SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+    try
+    {
+      dbs->RegisterLogContext(hibernate.GetLogLevel(),m_session->m_levelCallback,m_session->m_printCallback,m_session->m_callbkContext);
+
+      // Objects are only detached when their batch is committed.
+      // After a rollback they stay attached: they are not in the database
+      std::vector<CXObject*>& objects = p_worker->m_objects;
+      int batch = 0;
+      for(auto& object : objects)
+      {
+        if(trans == nullptr)
+        {
+          trans = new SQLTransaction(dbs,_T("bulk"));
+        }
+        for(auto& level : levels)
+        {
+          WorkerInsert(p_worker,dbs,level,object,level == levels.front());
+        }
+
+        if(++count % m_options.m_commitInterval == 0)
+        {
+          trans->Commit();
+          delete trans;
+          trans = nullptr;
+          ++p_worker->m_commits;
+          CountProgress(m_options.m_commitInterval);
+          while(batch < count)
+          {
+            objects[batch++]->Detach();
+          }
+        }
+      }
+      if(trans)
+      {
+        trans->Commit();
+        delete trans;
+        trans = nullptr;
+        ++p_worker->m_commits;
+        CountProgress(count % m_options.m_commitInterval);
+        while(batch < count)
+        {
+          objects[batch++]->Detach();
+        }
+      }
+    }
+    catch(StdException& ex)
+    {
+      // Destructor does the rollback
+      delete trans;
+      trans = nullptr;
+      p_worker->m_error = ex.GetErrorMessage();
+    }
+    WorkerCleanup(p_worker);
+  }
+  catch(StdException& ex)
+  {
+    // No connection to work on
+    p_worker->m_error = ex.GetErrorMessage();
+  }
+}
+
+// Insert the part of an object in the table of one class level
+void
+CXBulkLoader::WorkerInsert(BulkWorker* p_worker,SQLDatabase* p_database,CXClass* p_level,CXObject* p_object,bool p_root)
+{
+  CXTable* table = p_level->GetTable();
+
+  // Serialize the object into a scratch record (shape made by LoadClass)
+  SQLDataSet* shape = p_level->GetTableDataSet();
+  SQLRecord   record(shape,true);
+  p_level->SerializeTableRecord(p_object,record,p_root);
+
+  // Statement for the filled columns. Mostly the same for all objects
+  WordList columns;
+  XString  key = table->GetTableName() + _T(":");
+  for(int ind = 0;ind < shape->GetNumberOfFields();++ind)
+  {
+    SQLVariant* value = record.GetField(ind);
+    if(value && !value->IsNULL())
+    {
+      columns.push_back(shape->GetFieldName(ind));
+      key += shape->GetFieldName(ind) + _T(",");
+    }
+  }
+
+  SQLQuery*& query = p_worker->m_queries[key];
+  if(query == nullptr)
+  {
+    query = new SQLQuery(p_database);
+    query->DoSQLPrepare(CXClass::MakeInsertStatement(table->GetDMLTableName(p_database->GetSQLInfoDB()),columns));
+  }
+
+  // Bind this object and go
+  int parameter = 1;
+  query->ResetParameters();
+  for(int ind = 0;ind < shape->GetNumberOfFields();++ind)
+  {
+    SQLVariant* value = record.GetField(ind);
+    if(value && !value->IsNULL())
+    {
+      query->SetParameter(parameter++,value);
+    }
+  }
+  query->DoSQLExecute(true);
+  ++p_worker->m_records;
+}
+
+// Free the prepared statements. Must be done while the connection is still held
+void
+CXBulkLoader::WorkerCleanup(BulkWorker* p_worker)
+{
+  for(auto& query : p_worker->m_queries)
+  {
+    delete query.second;
+  }
+  p_worker->m_queries.clear();
+}
+
+// Count inserted objects and log the throughput now and then
+void
+CXBulkLoader::CountProgress(int p_objects)
+{
+  AutoCritSec lock(&m_lock);
+
+  m_report.m_inserted += p_objects;
+  if(m_options.m_reportInterval > 0 && m_report.m_inserted - m_reported >= m_options.m_reportInterval)
+  {
+    m_reported = m_report.m_inserted;
+    double seconds = (double)(GetTickCount64() - m_start) / 1000.0;
+    hibernate.Log(CXH_LOG_ACTIONS,true,_T("Bulk insert: %d objects, %.0f objects/sec")
+                 ,m_report.m_inserted
+                 ,seconds > 0.0 ? (double)m_report.m_inserted / seconds : 0.0);
+  }
+}
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXBulkLoader.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#pragma once
+#include "CXHibernate.h"
+#include "CXObject.h"
+#include <SQLDatabase.h>
+#include <SQLDataSet.h>
+#include <SQLQuery.h>
+#include <vector>
+#include <map>
+
+using namespace SQLComponents;
+
+class CXSession;
+class CXClass;
+class CXTable;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PARALLEL BULK LOADER
+//
+// Inserts large batches of new objects through CXSession::BulkInsert
+// - Classes are loaded in the order of their (many-to-one) associations
+//   so that a master is always in the database before its details
+// - Generated keys are allocated in advance. With a key block of <n>
+//   one sequence call gives <n> keys. The sequence must be created with
+//   "INCREMENT BY <n>", so ordinary inserts never take a key in our block.
+//   With a smaller increment the block is cut down to that increment
+// - The objects of one class are spread over several pooled connections
+//   Each connection prepares one INSERT per table and re-executes it
+// - Every connection commits after a configurable number of objects
+//
+// Inserted objects stay the property of the caller. They are detached
+// from any database record and are NOT put in the session cache.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#define CXBULK_MAX_WORKERS  16
+
+typedef struct _cxBulkOptions
+{
+  int     m_workers        { 4     };   // Parallel database connections
+  int     m_commitInterval { 1000  };   // Objects per transaction on a connection
+  int     m_keyBlock       { 0     };   // Keys per sequence call, at most its increment (0 = one call per object)
+  int     m_reportInterval { 10000 };   // Log the throughput every <n> objects (0 = only at the end)
+  bool    m_triggers       { true  };   // Fire the OnInsert trigger of the objects
+}
+CXBulkOptions;
+
+typedef struct _cxBulkReport
+{
+  int     m_objects        { 0 };       // Objects offered for insertion
+  int     m_inserted       { 0 };       // Objects inserted in the database
+  int     m_skipped        { 0 };       // Objects refused by the OnInsert trigger
+  int     m_records        { 0 };       // Records inserted (sub-tables included)
+  int     m_commits        { 0 };       // Transactions committed
+  int     m_keyCalls       { 0 };       // Round trips to allocate generated keys
+  double  m_seconds        { 0.0 };     // Total running time
+  double  m_perSecond      { 0.0 };     // Objects per second
+  XString m_errors;                     // Errors of all connections
+}
+CXBulkReport;
+
+class CXBulkLoader
+{
+public:
+  CXBulkLoader(CXSession* p_session,CXBulkOptions* p_options = nullptr);
+ ~CXBulkLoader();
+
+  // Insert all objects. Throws if one of the connections failed
+  bool  Load(CXResultSet& p_objects,CXBulkReport* p_report = nullptr);
+
+private:
+  // One connection with its own prepared statements
+  typedef struct _bulkWorker
+  {
+    CXBulkLoader*                 m_loader    { nullptr };
+    CXClass*                      m_class     { nullptr };
+    std::vector<CXObject*>        m_objects;
+    std::map<XString,SQLQuery*>   m_queries;    // Prepared INSERT per table/columns
+    int                           m_records   { 0 };
+    int                           m_commits   { 0 };
+    XString                       m_error;
+    HANDLE                        m_thread    { NULL };
+  }
+  BulkWorker;
+
+  // Order the classes by their associations
+  void  OrderClasses(std::map<CXClass*,CXResultSet>& p_groups,std::vector<CXClass*>& p_order);
+  // Allocate all generated keys for one class
+  void  AllocateKeys(CXClass* p_class,CXResultSet& p_objects,SQLDatabase* p_database);
+  // Keys to take from one sequence value
+  int   SequenceBlock(SQLDatabase* p_database,CXTable* p_table,CString p_sequence);
+  // Load one class on all connections
+  void  LoadClass(CXClass* p_class,CXResultSet& p_objects);
+
+  // Worker threads
+  static unsigned __stdcall RunWorker(void* p_worker);
+  void  WorkerLoad(BulkWorker* p_worker);
+  void  WorkerInsert(BulkWorker* p_worker,SQLDatabase* p_database,CXClass* p_level,CXObject* p_object,bool p_root);
+  void  WorkerCleanup(BulkWorker* p_worker);
+  void  CountProgress(int p_objects);
+
+  CXSession*      m_session { nullptr };
+  CXBulkOptions   m_options;
+  CXBulkReport    m_report;
+  int             m_reported { 0 };
+  ULONGLONG       m_start    { 0 };
+  CRITICAL_SECTION m_lock;
+};
@@ -92,12 +92,29 @@ CXClass::~CXClass()
     delete index;
   }
 
+  // Our key generator
+  if(m_keyGenerator)
+  {
+    delete m_keyGenerator;
+    m_keyGenerator = nullptr;
+  }
+
   // Destroy our dataset
   if(m_dataSet)
   {
     delete m_dataSet;
     m_dataSet = nullptr;
   }
+  if(m_shape)
+  {
+    delete m_shape;
+    m_shape = nullptr;
+  }
+  if(m_tableShape)
+  {
+    delete m_tableShape;
+    m_tableShape = nullptr;
+  }
 }
 
 // The name of the game
@@ -184,6 +201,53 @@ CXClass::GetDataSet()
   return m_dataSet;
 }
 
+// Data set with only the columns of all attributes (for object snapshots)
+// Has one empty record to define the columns
+SQLDataSet*
+CXClass::GetShapeDataSet()
+{
+  if(m_shape == nullptr)
+  {
+    m_shape = new SQLDataSet();
+    m_shape->InsertRecord();
+
+    SQLVariant empty;
+    WordList columns = FindAllDBSAttributes(true);
+    for(auto& column : columns)
+    {
+      m_shape->InsertField(column,&empty);
+    }
+  }
+  return m_shape;
+}
+
+// Data set with only the columns of our table (for scratch records)
+// Has one empty record to define the columns
+// Create it before using it on more than one thread
+SQLDataSet*
+CXClass::GetTableDataSet()
+{
+  if(m_tableShape == nullptr)
+  {
+    m_tableShape = new SQLDataSet();
+    m_tableShape->InsertRecord();
+
+    SQLVariant empty;
+    for(auto& column : m_table->GetColumnInfo())
+    {
+      m_tableShape->InsertField(column.m_column,&empty);
+    }
+  }
+  return m_tableShape;
+}
+
+// Objects of this class are detached from their records after loading
+bool
+CXClass::GetDetached()
+{
+  return m_detached;
+}
+
 // Add an attribute to the class
 void
 CXClass::AddAttribute(CXAttribute* p_attribute)
@@ -220,10 +284,21 @@ CXClass::AddIndex(CXIndex* p_index)
 }
 
 void
-CXClass::AddGenerator(CString p_generator, int p_start)
+CXClass::AddGenerator(CString p_generator,int p_start,CXGenStrategy p_strategy /*= GEN_NATIVE*/,int p_block /*= 0*/,CString p_table /*= ""*/)
 {
   m_generator = p_generator;
   m_gen_value = p_start;
+
+  if(m_keyGenerator)
+  {
+    delete m_keyGenerator;
+    m_keyGenerator = nullptr;
+  }
+  if(p_strategy != GEN_NATIVE)
+  {
+    m_keyGenerator = new CXGenerator(p_generator,p_strategy,p_start,p_block);
+    m_keyGenerator->SetTable(p_table);
+  }
 }
 
 void
@@ -328,6 +403,40 @@ CXClass::FindGenerator()
   return nullptr;
 }
 
+// Name of the generator sequence (if any)
+CString
+CXClass::GetGenerator()
+{
+  return m_generator;
+}
+
+// Key generator of another strategy than a native sequence (if any)
+CXGenerator*
+CXClass::GetKeyGenerator()
+{
+  return m_keyGenerator;
+}
+
+// Cache of rendered SELECT statements for this class
+SQLStatementCache*
+CXClass::GetStatementCache()
+{
+  return &m_statements;
+}
+
+// Find the version attribute for optimistic locking (if any)
+// The version is always defined on the root class of an hierarchy
+CXAttribute*
+CXClass::FindVersion()
+{
+  CXClass* root = GetRootClass();
+  if(root->m_version.IsEmpty())
+  {
+    return nullptr;
+  }
+  return root->FindAttribute(root->m_version);
+}
+
 // Find an association
 CXAssociation* 
 CXClass::FindAssociation(CString p_toClass,CString p_associationName)
@@ -378,6 +487,23 @@ CXClass::GetCalcHashcode()
   return m_calcHashcode;
 }
 
+// Detach objects of this class from their records after loading
+void
+CXClass::SetDetached(bool p_detached)
+{
+  m_detached = p_detached;
+}
+
+// Optimistic locking on a version attribute (number or timestamp)
+// UPDATE and DELETE only succeed if the version in the database is still
+// the version that was read. Refresh re-reads the object on a conflict.
+void
+CXClass::SetVersion(CString p_attribute,bool p_refresh /*= false*/)
+{
+  m_version        = p_attribute;
+  m_versionRefresh = p_refresh;
+}
+
 // Serialize to a configuration XML file
 bool
 CXClass::SaveMetaInfo(XMLMessage& p_message,XMLElement* p_elem)
@@ -398,6 +524,18 @@ CXClass::SaveMetaInfo(XMLMessage& p_message,XMLElement* p_elem)
   {
     p_message.AddElement(theclass,_T("table"),XDT_String,m_table->GetTableName());
   }
+  if(m_detached)
+  {
+    p_message.AddElement(theclass,_T("detached"),XDT_Boolean,_T("true"));
+  }
+  if(!m_version.IsEmpty())
+  {
+    p_message.AddElement(theclass,_T("version"),XDT_String,m_version);
+    if(m_versionRefresh)
+    {
+      p_message.AddElement(theclass,_T("version_refresh"),XDT_Boolean,_T("true"));
+    }
+  }
 
   // Add subclass references
   SaveMetaInfoSubClasses(p_message,theclass);
@@ -424,6 +562,12 @@ CXClass::LoadMetaInfo(CXSession* p_session,XMLMessage& p_message,XMLElement* p_e
     CString tableName  = p_message.GetElement(p_elem,_T("table"));
     m_table->SetSchemaTableType(schemaName,tableName,_T("TABLE"));
   }
+  // Objects released from their records after loading
+  m_detached = p_message.GetElementBoolean(p_elem,_T("detached"));
+  // Optimistic locking
+  m_version        = p_message.GetElement(p_elem,_T("version"));
+  m_versionRefresh = p_message.GetElementBoolean(p_elem,_T("version_refresh"));
+
   // Load subclasses
   LoadMetaInfoSubClasses(p_message,p_elem);
 
@@ -442,23 +586,33 @@ CXClass::LoadMetaInfo(CXSession* p_session,XMLMessage& p_message,XMLElement* p_e
 }
 
 // Build default SELECT query
+// The query only depends on the mapping strategy and the type of database,
+// so it is built once and taken from our statement cache thereafter.
 void
 CXClass::BuildDefaultSelectQuery(SQLDataSet* p_dataset,SQLInfoDB* p_info,CString p_orderBy /*=_T("")*/)
 {
   CString query;
+  CString mapping;
+  mapping.Format(_T("%s:%d:%d"),m_name.GetString(),(int)hibernate.GetStrategy(),(int)p_info->GetRDBMSDatabaseType());
 
-  // Calculate our query
-  switch(hibernate.GetStrategy())
+  if(!m_statements.FindStatement(mapping,query))
   {
-    case MapStrategy::Strategy_standalone:  // Fall through
-    case MapStrategy::Strategy_one_table:   query = BuildSelectQueryOneTable(p_info); break;
-    case MapStrategy::Strategy_sub_table:   query = BuildSelectQuerySubTable(p_info); break;
-    case MapStrategy::Strategy_classtable:  query = BuildSelectQuerySubclass(p_info); break;
+    // Calculate our query
+    switch(hibernate.GetStrategy())
+    {
+      case MapStrategy::Strategy_standalone:  // Fall through
+      case MapStrategy::Strategy_one_table:   query = BuildSelectQueryOneTable(p_info); break;
+      case MapStrategy::Strategy_sub_table:   query = BuildSelectQuerySubTable(p_info); break;
+      case MapStrategy::Strategy_classtable:  query = BuildSelectQuerySubclass(p_info); break;
+    }
+    m_statements.StoreStatement(mapping,query);
   }
 
   // Set query on the dataset
+  // Complete statements (filters and order) are cached under the same mapping key
   p_dataset->SetQuery(query);
   p_dataset->AddOrderBy(p_orderBy);
+  p_dataset->SetStatementCache(&m_statements,mapping);
 
   WordList list = GetPrimaryKeyAsList();
   p_dataset->SetPrimaryKeyColumn(list);
@@ -555,6 +709,15 @@ CXClass::BuildClassTable(CXSession* p_session)
     }
   }
 
+  // Key blocks are taken on connections of the session
+  if(m_keyGenerator)
+  {
+    m_keyGenerator->SetSession(p_session);
+  }
+
+  // Earlier rendered statements belong to the previous mapping
+  m_statements.Reset();
+
   // Fill in the table info
   FillTableInfoFromClassInfo();
 }
@@ -635,11 +798,73 @@ CXClass::InsertObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataset,CX
   return false;
 }
 
+// The tables to write an object of this class into (super-tables first)
+// Follows the same mapping rules as InsertObjectInDatabase
+void
+CXClass::FindTableClasses(std::vector<CXClass*>& p_levels)
+{
+  MapStrategy strategy = hibernate.GetStrategy();
+
+  if(m_table == nullptr && strategy == MapStrategy::Strategy_one_table && m_super)
+  {
+    p_levels.push_back(GetRootClass());
+  }
+  else if(strategy == MapStrategy::Strategy_sub_table)
+  {
+    for(CXClass* cl = this;cl;cl = cl->GetSuperClass())
+    {
+      p_levels.insert(p_levels.begin(),cl);
+    }
+  }
+  else
+  {
+    p_levels.push_back(this);
+  }
+}
+
+// Serialize the part of an object in our table into a scratch record
+// The record is made on GetTableDataSet() and has no fields yet
+void
+CXClass::SerializeTableRecord(CXObject* p_object,SQLRecord& p_record,bool p_root)
+{
+  SQLVariant empty;
+  int fields = GetTableDataSet()->GetNumberOfFields();
+  for(int ind = 0;ind < fields;++ind)
+  {
+    p_record.AddField(&empty);
+  }
+  if(p_root && hibernate.GetStrategy() != MapStrategy::Strategy_standalone)
+  {
+    SQLVariant disc(p_object->GetDiscriminator());
+    p_record.SetField(_T("discriminator"),&disc);
+  }
+  SQLRecord* own = p_object->TempReplaceRecord(&p_record);
+  p_object->Serialize(p_record,0);
+  p_object->TempReplaceRecord(own);
+}
+
+XString
+CXClass::MakeInsertStatement(XString p_table,const WordList& p_columns)
+{
+  XString columns;
+  XString params;
+  for(auto& column : p_columns)
+  {
+    columns += column + _T(",");
+    params  += _T("?,");
+  }
+  columns.TrimRight(',');
+  params .TrimRight(',');
+  return _T("INSERT INTO ") + p_table + _T("\n(") + columns + _T(")\nVALUES (") + params + _T(")");
+}
+
 bool
 CXClass::REALInsertObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataset,CXObject* p_object,int p_mutation,bool p_root)
 {
   SQLRecord* record = p_dataset->InsertRecord();
   SQLVariant zero;
+  SQLVariant key;
+  int generator = -1;
 
   // Connect our database
   p_dataset->SetDatabase(p_database);
@@ -667,17 +892,31 @@ CXClass::REALInsertObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_datase
     SerializeDiscriminator(p_object, record, p_mutation);
 
     // Check if we must generate our primary key
-    CXAttribute* gen = p_object->GetClass()->GetRootClass()->FindGenerator();
+    CXClass*     root = p_object->GetClass()->GetRootClass();
+    CXAttribute* gen  = root->FindGenerator();
     if (gen && p_object->IsTransient())
     {
       // -1: not found, 0 -> (n-1) is the field number of the generator
-      int generator = p_dataset->GetFieldNumber(gen->GetName());
-      record->SetGenerator(generator);
+      generator = p_dataset->GetFieldNumber(gen->GetName());
+      CXGenerator* keygen = root->GetKeyGenerator();
+      if(keygen && keygen->IsClientSide())
+      {
+        // Key comes from a block of this thread, not from the INSERT
+        key = keygen->NextKey();
+      }
+      else
+      {
+        record->SetGenerator(generator);
+      }
     }
   }
 
   // Now serialize our object with the 'real' values
   p_object->Serialize(*record, p_mutation);
+  if(!key.IsNULL())
+  {
+    record->SetField(generator,&key,p_mutation);
+  }
   // Set the record to 'insert-only'
   record->Inserted();
 
@@ -698,6 +937,20 @@ CXClass::REALInsertObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_datase
 bool
 CXClass::UpdateObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataset,CXObject* p_object,int p_mutation)
 {
+  // Detached objects have no record: select a fresh one first
+  if(p_object->IsDetached() && p_object->GetDatabaseRecord() == nullptr)
+  {
+    SQLDataSet dataset;
+    InitDataSet(&dataset);
+    SQLRecord* record = SelectObjectInDatabase(p_database,&dataset,p_object->GetPrimaryKey());
+    if(record == nullptr)
+    {
+      return false;
+    }
+    AutoObjectRecord temprecord(p_object,record);
+    return UpdateObjectInDatabase(p_database,&dataset,p_object,p_mutation);
+  }
+
   // Check that we have a dataset
   if(p_dataset == nullptr)
   {
@@ -738,6 +991,11 @@ CXClass::UpdateObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataset,CX
         hibernate.Log(LOGLEVEL_ERROR,true,_T("Error updating in super table: %s. Error: %s")
                       ,m_super->GetName().GetString()
                       ,ex.GetErrorMessage().GetString());
+        // Another writer was first: never continue with the other tables
+        if(FindVersion())
+        {
+          throw;
+        }
       }
     }
   }
@@ -762,15 +1020,41 @@ CXClass::REALUpdateObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_datase
 
   // Connect our database
   p_dataset->SetDatabase(p_database);
+  p_dataset->SetVersionColumn(GetVersionColumn());
 
   // Serialize object to database record
   p_object->Serialize(*record, p_mutation);
-  return p_dataset->Synchronize(p_mutation);
+  bool saved = p_dataset->Synchronize(p_mutation);
+
+  if(p_dataset->GetVersionConflict())
+  {
+    HandleVersionConflict(p_database,p_object);
+  }
+  // The record now has the new version: bring it to the object
+  if(saved && p_dataset->GetFieldNumber(p_dataset->GetVersionColumn()) >= 0)
+  {
+    p_object->DeSerialize(*record);
+  }
+  return saved;
 }
 
 bool
 CXClass::DeleteObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataset,CXObject* p_object,int p_mutation)
 {
+  // Detached objects have no record: select a fresh one first
+  if(p_object->IsDetached() && p_object->GetDatabaseRecord() == nullptr)
+  {
+    SQLDataSet dataset;
+    InitDataSet(&dataset);
+    SQLRecord* record = SelectObjectInDatabase(p_database,&dataset,p_object->GetPrimaryKey());
+    if(record == nullptr)
+    {
+      return false;
+    }
+    AutoObjectRecord temprecord(p_object,record);
+    return DeleteObjectInDatabase(p_database,&dataset,p_object,p_mutation);
+  }
+
   // Be sure we have a dataset
   if(p_dataset == nullptr)
   {
@@ -836,6 +1120,13 @@ CXClass::REALDeleteObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataSe
     return false;
   }
 
+  // Optimistic locking: the version of the object is the one to check
+  p_dataSet->SetVersionColumn(GetVersionColumn());
+  if(p_dataSet->GetFieldNumber(p_dataSet->GetVersionColumn()) >= 0)
+  {
+    p_object->Serialize(*record,p_mutation);
+  }
+
   // Set the record to the delete status
   record->Delete();
 
@@ -843,7 +1134,12 @@ CXClass::REALDeleteObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataSe
   // We take the assumption that the primary key is "immutable"
 
   // Go delete the record
-  return p_dataSet->Synchronize(p_mutation);
+  bool deleted = p_dataSet->Synchronize(p_mutation);
+  if(p_dataSet->GetVersionConflict())
+  {
+    HandleVersionConflict(p_database,p_object);
+  }
+  return deleted;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -852,6 +1148,38 @@ CXClass::REALDeleteObjectInDatabase(SQLDatabase* p_database,SQLDataSet* p_dataSe
 //
 //////////////////////////////////////////////////////////////////////////
 
+// Database column of the version attribute (empty if not versioned)
+CString
+CXClass::GetVersionColumn()
+{
+  CXAttribute* version = FindVersion();
+  return version ? version->GetDatabaseColumn() : CString();
+}
+
+// Another writer changed the record since we read it
+// Optionally bring the object to the state of the database, so the caller can retry
+void
+CXClass::HandleVersionConflict(SQLDatabase* p_database,CXObject* p_object)
+{
+  if(GetRootClass()->m_versionRefresh)
+  {
+    CXClass*   theClass = p_object->GetClass();
+    SQLDataSet dataset;
+    theClass->InitDataSet(&dataset);
+    SQLRecord* record = theClass->SelectObjectInDatabase(p_database,&dataset,p_object->GetPrimaryKey());
+    if(record)
+    {
+      AutoObjectRecord temprecord(p_object,record);
+      p_object->DeSerialize(*record);
+    }
+    if(p_object->IsDetached())
+    {
+      p_object->TakeSnapshot();
+    }
+  }
+  throw StdException(_T("Optimistic locking conflict. Object changed by another user. Class: ") + p_object->GetClass()->GetName());
+}
+
 // Adding a sub-class
 void
 CXClass::AddSubClass(CXClass* p_subclass)
@@ -1046,6 +1374,15 @@ CXClass::SaveMetaInfoGenerator(XMLMessage& p_message,XMLElement* p_theClass)
     XMLElement* generator = p_message.AddElement(p_theClass, _T("generator"), XDT_String, _T(""));
     p_message.SetAttribute(generator,_T("name"), m_generator);
     p_message.SetAttribute(generator,_T("start"),m_gen_value);
+    if(m_keyGenerator)
+    {
+      p_message.SetAttribute(generator,_T("strategy"),CXGenStrategyToString(m_keyGenerator->GetStrategy()));
+      p_message.SetAttribute(generator,_T("block"),   m_keyGenerator->GetBlock());
+      if(m_keyGenerator->GetStrategy() == GEN_TABLE)
+      {
+        p_message.SetAttribute(generator,_T("table"),m_keyGenerator->GetTable());
+      }
+    }
   }
 }
 
@@ -1230,8 +1567,13 @@ CXClass::LoadMetaInfoGenerator(XMLMessage& p_message,XMLElement* p_theClass)
   XMLElement* generator = p_message.FindElement(p_theClass,_T("generator"));
   if(generator)
   {
-    m_generator = p_message.GetAttribute(generator,_T("name"));
-    m_gen_value = p_message.GetAttributeInteger(generator,_T("start"));
+    CString name     = p_message.GetAttribute(generator,_T("name"));
+    int     start    = p_message.GetAttributeInteger(generator,_T("start"));
+    CString strategy = p_message.GetAttribute(generator,_T("strategy"));
+    int     block    = p_message.GetAttributeInteger(generator,_T("block"));
+    CString table    = p_message.GetAttribute(generator,_T("table"));
+
+    AddGenerator(name,start,CXStringToGenStrategy(strategy),block,table);
   }
 }
 
@@ -1363,13 +1705,19 @@ CXClass::FillTableInfoFromClassInfo()
     }
   }
 
-  // Add generator / sequence
-  if(!m_generator.IsEmpty())
+  // Add generator / sequence (table and UUID generators have none)
+  CXGenStrategy strategy = m_keyGenerator ? m_keyGenerator->GetStrategy() : GEN_NATIVE;
+  if(!m_generator.IsEmpty() && strategy != GEN_TABLE && strategy != GEN_UUIDV7)
   {
     MetaSequence seq;
     seq.m_schemaName   = GetTable()->GetSchemaName();
     seq.m_sequenceName = m_generator;
     seq.m_currentValue = m_gen_value;
+    if(strategy == GEN_POOLED)
+    {
+      // The pooled optimizer takes a block per sequence value
+      seq.m_increment = m_keyGenerator->GetBlock();
+    }
 
     GetTable()->AddSequence(seq);
   }
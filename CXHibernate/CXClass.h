@@ -29,6 +29,8 @@
 #include "CXAttribute.h"
 #include "CXTable.h"
 #include "CXObject.h"
+#include "CXGenerator.h"
+#include <SQLStatementCache.h>
 #include <vector>
 
 // A vector with all our subclasses
@@ -66,6 +68,12 @@ public:
   bool        GetIsRootClass();
   // Primary data set
   SQLDataSet* GetDataSet();
+  // Data set with only the columns of all attributes (for object snapshots)
+  SQLDataSet* GetShapeDataSet();
+  // Data set with only the columns of our table (for scratch records)
+  SQLDataSet* GetTableDataSet();
+  // Objects of this class are detached from their records after loading
+  bool        GetDetached();
   // Our function to calculate an override of a hash code for an object
   CalcHash    GetCalcHashcode();
 
@@ -74,10 +82,14 @@ public:
   void        AddIdentity   (CXIdentity&  p_primary);
   void        AddAssociation(CXAssociation* p_key);
   void        AddIndex      (CXIndex*       p_index);
-  void        AddGenerator  (CString        p_generator,int p_start);
+  void        AddGenerator  (CString        p_generator,int p_start,CXGenStrategy p_strategy = GEN_NATIVE,int p_block = 0,CString p_table = _T(""));
   void        AddPrivilege  (CXAccess&      p_access);
   // Register a CalcHashcode function
   void        RegisterCalcHash(CalcHash p_calcHashcode);
+  // Detach objects of this class from their records after loading
+  void        SetDetached(bool p_detached);
+  // Optimistic locking on a version attribute (number or timestamp)
+  void        SetVersion(CString p_attribute,bool p_refresh = false);
   // Find an attribute
   CXAttribute*   FindAttribute(CString p_name);
   CXAttribute*   FindAttribute(int     p_index);
@@ -88,6 +100,14 @@ public:
   CXAssociation* FindAssociation(int index);
   // Find the generator attribute (if any)
   CXAttribute*   FindGenerator();
+  // Name of the generator sequence (if any)
+  CString        GetGenerator();
+  // Key generator of another strategy than a native sequence (if any)
+  CXGenerator*   GetKeyGenerator();
+  // Cache of rendered SELECT statements for this class
+  SQLStatementCache* GetStatementCache();
+  // Find the version attribute for optimistic locking (if any)
+  CXAttribute*   FindVersion();
 
   // Serialize to a configuration XML file
   bool        SaveMetaInfo(XMLMessage& p_message,XMLElement* p_elem);
@@ -100,10 +120,20 @@ public:
 
   // Build default SELECT query
   void        BuildDefaultSelectQuery(SQLDataSet* p_dataset,SQLInfoDB* p_info,CString p_orderBy = _T(""));
+
+  // Writing objects without the datasets (bulk loads and the write-behind queue)
+  // The classes with the tables of an object of this class (super-tables first)
+  void        FindTableClasses(std::vector<CXClass*>& p_levels);
+  // Serialize the part of an object in our table into a record of GetTableDataSet()
+  void        SerializeTableRecord(CXObject* p_object,SQLRecord& p_record,bool p_root);
+  // INSERT statement with a parameter for each column
+  static XString MakeInsertStatement(XString p_table,const WordList& p_columns);
   // Load filters in message for an internet selection
   void        BuildPrimaryKeyFilter(SOAPMessage& p_message,XMLElement* p_entity,VariantSet& p_primary);
   // Build filter for primary key or association selection
   void        BuildFilter(CXAttribMap& p_attributes,VariantSet& p_values,SQLFilterSet& p_filters);
+  // Initialize a dataset for the class/table
+  void        InitDataSet(SQLDataSet* p_dataSet);
 
   // THE DATABASE INTERFACE
 
@@ -125,10 +155,11 @@ protected:
   void        AddSubClass(CXClass* p_subclass);
   // Fill in our underlying table
   void        FillTableInfoFromClassInfo();
-  // Initialize a dataset for the class/table
-  void        InitDataSet(SQLDataSet* p_dataSet);
   // Serialize the discriminator value to the database record for this object
   void        SerializeDiscriminator(CXObject* p_object,SQLRecord* p_record,int p_mutation);
+  // Optimistic locking
+  CString     GetVersionColumn();
+  void        HandleVersionConflict(SQLDatabase* p_database,CXObject* p_object);
 
   // SAVING CONFIGURATION INFO
   void SaveMetaInfoSubClasses  (XMLMessage& p_message,XMLElement* p_theClass);
@@ -174,6 +205,15 @@ private:
   CXTable*        m_table;
   // Standard data set for selected objects
   SQLDataSet*     m_dataSet { nullptr };
+  // Shape of the records for object snapshots
+  SQLDataSet*     m_shape   { nullptr };
+  // Shape of the records of our table
+  SQLDataSet*     m_tableShape { nullptr };
+  // Release the records of loaded objects
+  bool            m_detached { false };
+  // Optimistic locking on this attribute. Refresh the object on a conflict
+  CString         m_version;
+  bool            m_versionRefresh { false };
   // All attributes of this class
   CXAttribMap     m_attributes;       // Column attributes
   CXIdentity      m_identity;         // Our candidate primary key
@@ -181,5 +221,7 @@ private:
   CXIndices       m_indices;          // Constraints and performance speed-ups
   CString         m_generator;        // Generator name
   int             m_gen_value { 0 };  // Initial generator value
+  CXGenerator*    m_keyGenerator { nullptr }; // Generator of another strategy
   CXPrivileges    m_privileges;       // All access rights
+  SQLStatementCache m_statements;     // Rendered SELECT statements per mapping and shape
 };
@@ -0,0 +1,335 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXGenerator.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include "CXGenerator.h"
+#include "CXSession.h"
+#include <SQLAutoDBS.h>
+#include <SQLTransaction.h>
+#include <SQLQuery.h>
+#include <random>
+#include <atomic>
+#include <map>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CXGenStrategy CXStringToGenStrategy(CString p_strategy)
+{
+  if(p_strategy.CompareNoCase(_T("hilo"))   == 0) return GEN_HILO;
+  if(p_strategy.CompareNoCase(_T("pooled")) == 0) return GEN_POOLED;
+  if(p_strategy.CompareNoCase(_T("table"))  == 0) return GEN_TABLE;
+  if(p_strategy.CompareNoCase(_T("uuidv7")) == 0) return GEN_UUIDV7;
+
+  return GEN_NATIVE;
+}
+
+CString CXGenStrategyToString(CXGenStrategy p_strategy)
+{
+  switch(p_strategy)
+  {
+    case GEN_HILO:   return _T("hilo");
+    case GEN_POOLED: return _T("pooled");
+    case GEN_TABLE:  return _T("table");
+    case GEN_UUIDV7: return _T("uuidv7");
+  }
+  return _T("native");
+}
+
+// Block of keys of one generator in one thread
+typedef struct _keyBlock
+{
+  __int64 m_next { 0 };
+  __int64 m_last { 0 };
+}
+KeyBlock;
+
+static std::atomic<unsigned>                   g_generators { 0 };
+static thread_local std::map<unsigned,KeyBlock> t_blocks;
+
+CXGenerator::CXGenerator(CString p_name,CXGenStrategy p_strategy,int p_start /*= 1*/,int p_block /*= CXGEN_DEFAULT_BLOCK*/)
+            :m_name(p_name)
+            ,m_strategy(p_strategy)
+            ,m_start(p_start)
+            ,m_block(p_block > 0 ? p_block : CXGEN_DEFAULT_BLOCK)
+{
+  m_id = ++g_generators;
+}
+
+void
+CXGenerator::SetSession(CXSession* p_session)
+{
+  m_session = p_session;
+}
+
+void
+CXGenerator::SetTable(CString p_table)
+{
+  if(!p_table.IsEmpty())
+  {
+    m_table = p_table;
+  }
+}
+
+bool
+CXGenerator::IsClientSide() const
+{
+  return m_strategy != GEN_NATIVE;
+}
+
+// Getting the next key for a new object
+// Only takes the database when the block of this thread is used up
+SQLVariant
+CXGenerator::NextKey()
+{
+  if(m_strategy == GEN_UUIDV7)
+  {
+    return SQLVariant(CreateUUIDv7());
+  }
+  if(m_strategy == GEN_NATIVE)
+  {
+    throw StdException(_T("Native generator keys are taken by the database: ") + m_name);
+  }
+
+  KeyBlock& block = t_blocks[m_id];
+  if(block.m_next >= block.m_last)
+  {
+    AllocateBlock(block.m_next,block.m_last);
+  }
+  __int64 key = block.m_next++;
+  if(key <= INT_MAX)
+  {
+    return SQLVariant((int)key);
+  }
+  return SQLVariant(key);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// GETTERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+CString
+CXGenerator::GetName() const
+{
+  return m_name;
+}
+
+CXGenStrategy
+CXGenerator::GetStrategy() const
+{
+  return m_strategy;
+}
+
+int
+CXGenerator::GetStart() const
+{
+  return m_start;
+}
+
+int
+CXGenerator::GetBlock() const
+{
+  return m_block;
+}
+
+CString
+CXGenerator::GetTable() const
+{
+  return m_table;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PRIVATE
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Allocate a new block of keys [first,last)
+void
+CXGenerator::AllocateBlock(__int64& p_first,__int64& p_last)
+{
+  if(m_session == nullptr)
+  {
+    throw StdException(_T("Generator is not connected to a session: ") + m_name);
+  }
+  switch(m_strategy)
+  {
+    case GEN_HILO:   // Sequence value 1 gives the first block from 'start'
+                     p_first = m_start + (AllocateFromSequence() - 1) * m_block;
+                     p_last  = p_first + m_block;
+                     break;
+    case GEN_POOLED: // Keys below 'start' are never handed out
+                     do
+                     {
+                       p_first = AllocateFromSequence();
+                       p_last  = p_first + m_block;
+                     }
+                     while(p_last <= m_start);
+                     if(p_first < m_start)
+                     {
+                       p_first = m_start;
+                     }
+                     break;
+    case GEN_TABLE:  p_first = AllocateFromTable();
+                     p_last  = p_first + m_block;
+                     break;
+  }
+}
+
+// One value of the sequence. On its own connection, so we never
+// interfere with the transaction of the caller
+__int64
+CXGenerator::AllocateFromSequence()
+{
+  SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+  XString value = dbs->GetSQL_GenerateSerial(_T(""),m_name);
+
+  __int64 result = _ttoi64(value);
+  if(result <= 0)
+  {
+    throw StdException(_T("Generator needs a database sequence: ") + m_name);
+  }
+  return result;
+}
+
+// Take a block from the keys table in a transaction of its own
+// The UPDATE locks the row of the generator until the commit, so no two
+// processes can get the same block. Only the very first block needs an
+// INSERT. If another process inserts the row at the same time, our INSERT
+// fails on the primary key and we take the block with the UPDATE after all.
+__int64
+CXGenerator::AllocateFromTable()
+{
+  SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+
+  XString update;
+  update.Format(_T("UPDATE %s\n   SET next_value = next_value + ?\n WHERE name = ?"),m_table.GetString());
+  XString select;
+  select.Format(_T("SELECT next_value\n  FROM %s\n WHERE name = ?"),m_table.GetString());
+  XString insert;
+  insert.Format(_T("INSERT INTO %s (name,next_value) VALUES (?,?)"),m_table.GetString());
+
+  SQLVariant block((__int64)m_block);
+  SQLVariant next((__int64)m_start + m_block);
+  SQLVariant name(m_name.GetString());
+
+  __int64 first = 0;
+  for(int attempt = 0;attempt < 2;++attempt)
+  {
+    SQLTransaction trans(dbs,_T("keys"));
+    SQLQuery query(dbs);
+    query.SetParameter(1,&block);
+    query.SetParameter(2,&name);
+    if(query.DoSQLStatementNonQuery(update) > 0)
+    {
+      query.ResetParameters();
+      query.SetParameter(1,&name);
+      SQLVariant* last = query.DoSQLStatementScalar(select);
+      first = last ? last->GetAsSBigInt() - m_block : 0;
+      trans.Commit();
+      break;
+    }
+    try
+    {
+      // First block ever for this generator
+      query.ResetParameters();
+      query.SetParameter(1,&name);
+      query.SetParameter(2,&next);
+      query.DoSQLStatementNonQuery(insert);
+      trans.Commit();
+      first = m_start;
+      break;
+    }
+    catch(StdException&)
+    {
+      // Row inserted by another process in the mean time
+      // The transaction is rolled back, go try the UPDATE again
+      if(attempt > 0)
+      {
+        throw;
+      }
+    }
+  }
+
+  if(first <= 0)
+  {
+    throw StdException(_T("Cannot allocate keys from table: ") + m_table + _T(" for: ") + m_name);
+  }
+  return first;
+}
+
+// Create a new UUID version 7 (RFC 9562)
+// 48 bits milliseconds since 1970, then 12 bits that count up within the
+// same millisecond in this thread (so keys stay ordered), then random bits
+CString
+CXGenerator::CreateUUIDv7()
+{
+  static thread_local std::mt19937_64 random(std::random_device{}() ^ GetCurrentThreadId());
+  static thread_local unsigned __int64 lastms  = 0;
+  static thread_local unsigned         counter = 0;
+
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  unsigned __int64 ticks = ((unsigned __int64)now.dwHighDateTime << 32) | now.dwLowDateTime;
+  unsigned __int64 ms    = (ticks - 116444736000000000ULL) / 10000ULL;
+
+  if(ms > lastms)
+  {
+    lastms  = ms;
+    counter = (unsigned)(random() & 0x7FF);
+  }
+  else if(++counter > 0xFFF)
+  {
+    // Borrow from the next millisecond
+    counter = 0;
+    ++lastms;
+  }
+  unsigned __int64 tail = random();
+
+  BYTE uuid[16];
+  for(int ind = 0;ind < 6;++ind)
+  {
+    uuid[ind] = (BYTE)(lastms >> (8 * (5 - ind)));
+  }
+  uuid[6] = (BYTE)(0x70 | ((counter >> 8) & 0x0F));
+  uuid[7] = (BYTE)(counter & 0xFF);
+  uuid[8] = (BYTE)(0x80 | ((tail >> 56) & 0x3F));
+  for(int ind = 9;ind < 16;++ind)
+  {
+    uuid[ind] = (BYTE)(tail >> (8 * (15 - ind)));
+  }
+
+  CString result;
+  result.Format(_T("%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x")
+               ,uuid[0],uuid[1],uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7]
+               ,uuid[8],uuid[9],uuid[10],uuid[11],uuid[12],uuid[13],uuid[14],uuid[15]);
+  return result;
+}
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXGenerator.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#pragma once
+#include "CXHibernate.h"
+#include <SQLVariant.h>
+
+using namespace SQLComponents;
+
+class CXSession;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// IDENTITY GENERATORS
+//
+// Strategy of the <generator> of a class in the configuration:
+//
+//   <generator name="animal_seq" start="1" strategy="hilo" block="100"/>
+//
+// native : Sequence or identity in the INSERT (one round trip per object)
+// hilo   : One sequence value <hi> gives the keys start + (<hi> - 1) * block + <0...block-1>
+// pooled : Sequence with "START WITH <start> INCREMENT BY <block>". The value is
+//          the lowest key. Keys below 'start' are never handed out
+// table  : Block of keys from the "next_value" column in a keys table
+//          <generator name="animal" strategy="table" table="cxh_keys" block="50"/>
+//          Table has columns "name" (varchar, primary key) and "next_value" (bigint)
+// uuidv7 : Client side, time ordered UUID (RFC 9562). No database at all
+//
+// Each thread draws its keys from a block of its own, so no locking is
+// needed until the block is used up. A new block is taken in a separate
+// transaction on a pooled connection of the session.
+//
+//////////////////////////////////////////////////////////////////////////
+
+typedef enum _genStrategy
+{
+  GEN_NATIVE      // Database sequence in the INSERT statement
+ ,GEN_HILO        // hi/lo algorithm on a sequence
+ ,GEN_POOLED      // Pooled optimizer on an 'increment by <n>' sequence
+ ,GEN_TABLE       // Block allocation in a table
+ ,GEN_UUIDV7      // Client side UUID version 7
+}
+CXGenStrategy;
+
+CXGenStrategy CXStringToGenStrategy(CString p_strategy);
+CString       CXGenStrategyToString(CXGenStrategy p_strategy);
+
+#define CXGEN_DEFAULT_BLOCK  100
+#define CXGEN_DEFAULT_TABLE  _T("cxh_keys")
+
+class CXGenerator
+{
+public:
+  CXGenerator(CString p_name,CXGenStrategy p_strategy,int p_start = 1,int p_block = CXGEN_DEFAULT_BLOCK);
+
+  // Blocks are taken on a connection of the session
+  void          SetSession(CXSession* p_session);
+  // Name of the keys table (table strategy)
+  void          SetTable(CString p_table);
+
+  // Keys are drawn by the client, not by the INSERT statement
+  bool          IsClientSide() const;
+  // Getting the next key for a new object
+  SQLVariant    NextKey();
+
+  // GETTERS
+  CString       GetName() const;
+  CXGenStrategy GetStrategy() const;
+  int           GetStart() const;
+  int           GetBlock() const;
+  CString       GetTable() const;
+
+private:
+  // Allocate a new block of keys [first,last)
+  void          AllocateBlock(__int64& p_first,__int64& p_last);
+  __int64       AllocateFromSequence();
+  __int64       AllocateFromTable();
+  // Create a new UUID version 7
+  CString       CreateUUIDv7();
+
+  unsigned      m_id       { 0 };           // Unique id of this generator (for the thread blocks)
+  CString       m_name;                     // Sequence name or name in the keys table
+  CXGenStrategy m_strategy { GEN_NATIVE };
+  int           m_start    { 1 };           // First key
+  int           m_block    { CXGEN_DEFAULT_BLOCK };
+  CString       m_table    { CXGEN_DEFAULT_TABLE };
+  CXSession*    m_session  { nullptr };
+};
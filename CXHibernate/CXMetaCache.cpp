@@ -0,0 +1,652 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXMetaCache.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include "CXMetaCache.h"
+#include "CXTable.h"
+#include <SOAPMessage.h>
+#include <ConvertWideString.h>
+#include <SQLInfoDB.h>
+#include <AutoCritical.h>
+#include <process.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CXMetaCache::CXMetaCache(XString p_filename)
+            :m_filename(p_filename)
+{
+  InitializeCriticalSection(&m_lock);
+}
+
+CXMetaCache::~CXMetaCache()
+{
+  WaitForRefresh();
+  UnmapSnapshot();
+  DeleteCriticalSection(&m_lock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// OPENING THE SNAPSHOT
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Open the snapshot and validate it against the database
+// Returns false if the snapshot could not be used (cache starts empty)
+bool
+CXMetaCache::Open(SQLDatabase* p_database)
+{
+  AutoCritSec lock(&m_lock);
+
+  m_connection = p_database->GetDatasource() + _T("|") + p_database->GetUserName();
+  m_connection.MakeLower();
+
+  if(!MapSnapshot())
+  {
+    return false;
+  }
+
+  // Validate the fingerprint of each schema in the snapshot
+  bool valid = true;
+  for(auto& schema : m_fingerprints)
+  {
+    XString current = GetFingerprint(p_database,schema.first);
+    if(current.IsEmpty())
+    {
+      // RDBMS cannot tell us: use the snapshot, but refresh it
+      m_refresh = true;
+      continue;
+    }
+    if(current.Compare(schema.second) == 0)
+    {
+      continue;
+    }
+    // Drop all tables of a changed schema
+    XString prefix = schema.first + _T(".");
+    for(auto it = m_tables.begin(); it != m_tables.end();)
+    {
+      if(it->first.Left(prefix.GetLength()).Compare(prefix) == 0)
+      {
+        it = m_tables.erase(it);
+      }
+      else ++it;
+    }
+    schema.second = current;
+    m_changed = true;
+    valid = false;
+  }
+  return valid;
+}
+
+// Fill the meta info of a table from the snapshot
+// An entry without all the kinds of info asked for is a miss
+bool
+CXMetaCache::FindTable(CXTable* p_table,unsigned p_kinds /*= 0*/)
+{
+  XString xml;
+  {
+    AutoCritSec lock(&m_lock);
+
+    CXMetaEntries::iterator it = m_tables.find(TableKey(p_table->GetSchemaName(),p_table->GetTableName()));
+    if(it == m_tables.end() || (it->second.m_kinds & p_kinds) != p_kinds)
+    {
+      return false;
+    }
+    // Parse lazily from the mapped snapshot
+    xml = it->second.m_xml.IsEmpty() ? LPCSTRToString(it->second.m_mapped,true) : it->second.m_xml;
+  }
+
+  SOAPMessage msg(xml.GetString());
+  if(msg.GetErrorState())
+  {
+    return false;
+  }
+  p_table->LoadMetaInfo(msg);
+  return !p_table->GetColumnInfo().empty();
+}
+
+// Keep the meta info of a table in the snapshot
+// With a database we can record the fingerprint of a new schema
+void
+CXMetaCache::StoreTable(CXTable* p_table,SQLDatabase* p_database /*= nullptr*/,unsigned p_kinds /*= 0*/)
+{
+  SOAPMessage msg(_T("http://cxhibernate.org/metainfo"),_T("Table"));
+  p_table->SaveMetaInfo(msg);
+
+  XString schema(p_table->GetSchemaName());
+  XString fingerprint;
+  if(p_database && m_fingerprints.find(schema) == m_fingerprints.end())
+  {
+    fingerprint = GetFingerprint(p_database,schema);
+  }
+
+  AutoCritSec lock(&m_lock);
+
+  if(m_fingerprints.find(schema) == m_fingerprints.end())
+  {
+    // An empty fingerprint will be dropped at the next 'Open'
+    // unless the RDBMS does not support fingerprints at all
+    m_fingerprints[schema] = fingerprint;
+  }
+  XString key = TableKey(p_table->GetSchemaName(),p_table->GetTableName());
+  CXMetaEntry& entry = m_tables[key];
+  entry.m_mapped = nullptr;
+  entry.m_xml    = msg.GetSoapMessage();
+  entry.m_kinds  = p_kinds;
+  m_changed = true;
+}
+
+/*static*/ unsigned
+CXMetaCache::InfoKinds(bool p_foreigns,bool p_indices,bool p_privileges)
+{
+  return (p_foreigns   ? CXMETA_FOREIGNS   : 0) |
+         (p_indices    ? CXMETA_INDICES    : 0) |
+         (p_privileges ? CXMETA_PRIVILEGES : 0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// BATCHED CATALOG QUERIES
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Get info of many tables with one catalog query per kind of info.
+// All tables of one schema are fetched together if the RDBMS has its own
+// catalog queries. Otherwise we fall back to the ODBC catalog per table.
+// Returns the number of tables that where found in the snapshot.
+int
+CXMetaCache::FetchTables(SQLDatabase* p_database
+                        ,CXTables&    p_tables
+                        ,bool         p_getForeigns   /*= false*/
+                        ,bool         p_getIndices    /*= false*/
+                        ,bool         p_getPrivileges /*= false*/)
+{
+  SQLInfoDB* info = p_database->GetSQLInfoDB();
+  unsigned   kinds = InfoKinds(p_getForeigns,p_getIndices,p_getPrivileges);
+  std::map<XString,CXTables> schemas;
+  int found = 0;
+
+  // Take everything we can from the snapshot
+  for(auto& table : p_tables)
+  {
+    if(FindTable(table,kinds))
+    {
+      ++found;
+      continue;
+    }
+    schemas[table->GetSchemaName()].push_back(table);
+  }
+
+  for(auto& schema : schemas)
+  {
+    CXTables& tables = schema.second;
+    XString   name   = tables.front()->GetSchemaName();
+    XString   empty;
+
+    // Fingerprint before the catalog scan, so we never miss a change
+    if(m_fingerprints.find(schema.first) == m_fingerprints.end())
+    {
+      XString fingerprint = GetFingerprint(p_database,name);
+      AutoCritSec lock(&m_lock);
+      m_fingerprints[schema.first] = fingerprint;
+    }
+
+    // One or two tables: not worth a catalog scan of the schema
+    if(tables.size() < 3 || info->GetPreferODBC() || info->GetCATALOGColumnAttributes(name,empty,empty).IsEmpty())
+    {
+      for(auto& table : tables)
+      {
+        table->GetMetaInfoFromDatabase(*p_database,p_getForeigns,p_getIndices,p_getPrivileges,this);
+      }
+      continue;
+    }
+
+    MTableMap     tabinfo;
+    MColumnMap    columns;
+    MPrimaryMap   primary;
+    MForeignMap   foreigns;
+    MIndicesMap   indices;
+    MPrivilegeMap privileges;
+    XString       errors;
+
+    info->MakeInfoTableObject(tabinfo,errors,name,_T(""));
+    info->MakeInfoTableColumns(columns,errors,name,_T(""));
+    info->MakeInfoTablePrimary(primary,errors,name,_T(""));
+    if(p_getForeigns)   info->MakeInfoTableForeign(foreigns,errors,name,_T(""));
+    if(p_getIndices)    info->MakeInfoTableStatistics(indices,errors,name,_T(""),nullptr);
+    if(p_getPrivileges) info->MakeInfoTablePrivileges(privileges,errors,name,_T(""));
+
+    if(!errors.IsEmpty())
+    {
+      // Batch not supported by this RDBMS version. Do it the slow way
+      for(auto& table : tables)
+      {
+        table->GetMetaInfoFromDatabase(*p_database,p_getForeigns,p_getIndices,p_getPrivileges,this);
+      }
+      continue;
+    }
+    DistributeInfo(tables,tabinfo,columns,primary,foreigns,indices,privileges);
+
+    for(auto& table : tables)
+    {
+      if(table->GetColumnInfo().empty())
+      {
+        // Not in the schema scan (synonym or another owner)
+        table->GetMetaInfoFromDatabase(*p_database,p_getForeigns,p_getIndices,p_getPrivileges,this);
+      }
+      else
+      {
+        StoreTable(table,p_database,kinds);
+      }
+    }
+  }
+  return found;
+}
+
+// Fill tables from the batched catalog results
+void
+CXMetaCache::DistributeInfo(CXTables&      p_tables
+                           ,MTableMap&     p_info
+                           ,MColumnMap&    p_columns
+                           ,MPrimaryMap&   p_primary
+                           ,MForeignMap&   p_foreigns
+                           ,MIndicesMap&   p_indices
+                           ,MPrivilegeMap& p_privileges)
+{
+  std::map<XString,CXTable*> names;
+  for(auto& table : p_tables)
+  {
+    XString name(table->GetTableName());
+    name.MakeLower();
+    names[name] = table;
+    table->ResetMetaInfo();
+  }
+  auto lookup = [&names](XString p_name) -> CXTable*
+  {
+    p_name.MakeLower();
+    p_name.Trim();
+    auto it = names.find(p_name);
+    return it == names.end() ? nullptr : it->second;
+  };
+
+  for(auto& tab : p_info)       if(CXTable* t = lookup(tab.m_table))       t->SetInfoTable(tab);
+  for(auto& col : p_columns)    if(CXTable* t = lookup(col.m_table))       t->AddInfoColumn(col);
+  for(auto& key : p_primary)    if(CXTable* t = lookup(key.m_table))       t->AddPrimaryKey(key);
+  for(auto& frn : p_foreigns)   if(CXTable* t = lookup(frn.m_fkTableName)) t->AddForeignKey(frn);
+  for(auto& ind : p_indices)    if(CXTable* t = lookup(ind.m_tableName))   t->AddIndex(ind);
+  for(auto& pri : p_privileges) if(CXTable* t = lookup(pri.m_tableName))   t->AddPrivilege(pri);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WRITING THE SNAPSHOT
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void
+WriteString(FILE* p_file,XString p_string)
+{
+  AutoCSTR str(p_string,true);
+  UINT32 length = str.cstr() ? (UINT32)strlen(str.cstr()) + 1 : 1;
+  fwrite(&length,sizeof(UINT32),1,p_file);
+  fwrite(str.cstr() ? str.cstr() : "",1,length,p_file);
+}
+
+// Write the snapshot to disk (only if changed)
+// Written to a temporary file first, so readers never see half a snapshot
+bool
+CXMetaCache::Save()
+{
+  AutoCritSec lock(&m_lock);
+
+  if(!m_changed)
+  {
+    return true;
+  }
+
+  // Make sure all entries are in memory before we loose the mapping
+  for(auto& entry : m_tables)
+  {
+    if(entry.second.m_xml.IsEmpty())
+    {
+      entry.second.m_xml = LPCSTRToString(entry.second.m_mapped,true);
+      entry.second.m_mapped = nullptr;
+    }
+  }
+  UnmapSnapshot();
+
+  XString temp = m_filename + _T(".tmp");
+  FILE* file = nullptr;
+  if(_tfopen_s(&file,temp,_T("wb")) || file == nullptr)
+  {
+    return false;
+  }
+  UINT32 version = CXMETA_VERSION;
+  fwrite(CXMETA_MAGIC,1,4,file);
+  fwrite(&version,sizeof(UINT32),1,file);
+  WriteString(file,m_connection);
+
+  UINT32 count = (UINT32)m_fingerprints.size();
+  fwrite(&count,sizeof(UINT32),1,file);
+  for(auto& schema : m_fingerprints)
+  {
+    WriteString(file,schema.first);
+    WriteString(file,schema.second);
+  }
+  count = (UINT32)m_tables.size();
+  fwrite(&count,sizeof(UINT32),1,file);
+  for(auto& table : m_tables)
+  {
+    UINT32 kinds = table.second.m_kinds;
+    WriteString(file,table.first);
+    fwrite(&kinds,sizeof(UINT32),1,file);
+    WriteString(file,table.second.m_xml);
+  }
+  bool result = ferror(file) == 0;
+  fclose(file);
+
+  if(!result || !MoveFileEx(temp,m_filename,MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+  {
+    DeleteFile(temp);
+    return false;
+  }
+  m_changed = false;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// BACKGROUND REFRESH
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Refresh all tables of the snapshot on a background thread
+bool
+CXMetaCache::RefreshInBackground(SQLDatabasePool* p_pool,XString p_connection)
+{
+  AutoCritSec lock(&m_lock);
+
+  if(m_thread)
+  {
+    return false;
+  }
+  m_pool           = p_pool;
+  m_poolConnection = p_connection;
+
+  unsigned threadID = 0;
+  m_thread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr,0,RunRefresh,reinterpret_cast<void*>(this),0,&threadID));
+  return m_thread != NULL;
+}
+
+// Wait for a background refresh to end
+void
+CXMetaCache::WaitForRefresh()
+{
+  if(m_thread)
+  {
+    WaitForSingleObject(m_thread,INFINITE);
+    CloseHandle(m_thread);
+    m_thread = NULL;
+  }
+}
+
+/*static*/ unsigned __stdcall
+CXMetaCache::RunRefresh(void* p_cache)
+{
+  reinterpret_cast<CXMetaCache*>(p_cache)->Refresh();
+  return 0;
+}
+
+// Read all tables of the snapshot again from the catalog
+// with the same kinds of info as they were stored with.
+// Works on temporary tables, so running sessions are never disturbed
+void
+CXMetaCache::Refresh()
+{
+  SQLDatabase* database = nullptr;
+  std::vector<CXTable*> tables;
+  std::vector<unsigned> kinds;
+  try
+  {
+    database = m_pool->GetDatabase(m_poolConnection);
+    {
+      AutoCritSec lock(&m_lock);
+      for(auto& entry : m_tables)
+      {
+        int pos = entry.first.Find('.');
+        CXTable* table = new CXTable(entry.first.Mid(pos + 1));
+        table->SetSchema(entry.first.Left(pos));
+        tables.push_back(table);
+        kinds.push_back(entry.second.m_kinds);
+      }
+    }
+    for(size_t index = 0; index < tables.size(); ++index)
+    {
+      CXTable* table = tables[index];
+      unsigned kind  = kinds[index];
+      table->GetMetaInfoFromDatabase(*database
+                                    ,(kind & CXMETA_FOREIGNS)   != 0
+                                    ,(kind & CXMETA_INDICES)    != 0
+                                    ,(kind & CXMETA_PRIVILEGES) != 0);
+      StoreTable(table,database,kind);
+    }
+    Save();
+    m_refresh = false;
+  }
+  catch(StdException&)
+  {
+    // Keep the old snapshot
+  }
+  for(auto& table : tables)
+  {
+    delete table;
+  }
+  if(database)
+  {
+    m_pool->GiveUp(database);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// GETTERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+XString
+CXMetaCache::GetFilename()
+{
+  return m_filename;
+}
+
+int
+CXMetaCache::GetNumberOfTables()
+{
+  AutoCritSec lock(&m_lock);
+  return (int)m_tables.size();
+}
+
+bool
+CXMetaCache::GetNeedsRefresh()
+{
+  return m_refresh;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PRIVATE
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Key of a table in the snapshot.
+// Not folded to one case: case-sensitive catalogs can have both
+XString
+CXMetaCache::TableKey(XString p_schema,XString p_table)
+{
+  return p_schema + _T(".") + p_table;
+}
+
+// Fingerprint of a schema (empty if not supported)
+XString
+CXMetaCache::GetFingerprint(SQLDatabase* p_database,XString p_schema)
+{
+  XString fingerprint;
+  XString errors;
+  if(!p_database->GetSQLInfoDB()->MakeInfoSchemaFingerprint(fingerprint,errors,p_schema))
+  {
+    fingerprint.Empty();
+  }
+  return fingerprint;
+}
+
+// Map the snapshot file read-only into memory
+bool
+CXMetaCache::MapSnapshot()
+{
+  UnmapSnapshot();
+
+  m_file = CreateFile(m_filename,GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_DELETE,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+  if(m_file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(m_file,&size) || size.QuadPart < 12)
+  {
+    UnmapSnapshot();
+    return false;
+  }
+  m_mapping = CreateFileMapping(m_file,nullptr,PAGE_READONLY,0,0,nullptr);
+  if(m_mapping)
+  {
+    m_view = reinterpret_cast<const BYTE*>(MapViewOfFile(m_mapping,FILE_MAP_READ,0,0,0));
+  }
+  if(m_view == nullptr || !ReadSnapshot(m_view,(size_t)size.QuadPart))
+  {
+    m_fingerprints.clear();
+    m_tables.clear();
+    UnmapSnapshot();
+    return false;
+  }
+  return true;
+}
+
+void
+CXMetaCache::UnmapSnapshot()
+{
+  if(m_view)
+  {
+    UnmapViewOfFile(m_view);
+    m_view = nullptr;
+  }
+  if(m_mapping)
+  {
+    CloseHandle(m_mapping);
+    m_mapping = NULL;
+  }
+  if(m_file != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+  }
+}
+
+// Read the index of the snapshot. The XML of the tables stays in the view.
+bool
+CXMetaCache::ReadSnapshot(const BYTE* p_view,size_t p_size)
+{
+  size_t pos = 0;
+  auto readInt = [&](UINT32& p_value) -> bool
+  {
+    if(pos + sizeof(UINT32) > p_size) return false;
+    memcpy(&p_value,p_view + pos,sizeof(UINT32));
+    pos += sizeof(UINT32);
+    return true;
+  };
+  auto readString = [&](const char*& p_string) -> bool
+  {
+    UINT32 length = 0;
+    if(!readInt(length) || length == 0 || pos + length > p_size || p_view[pos + length - 1] != 0) return false;
+    p_string = reinterpret_cast<const char*>(p_view + pos);
+    pos += length;
+    return true;
+  };
+
+  UINT32 version = 0;
+  if(memcmp(p_view,CXMETA_MAGIC,4) != 0)
+  {
+    return false;
+  }
+  pos = 4;
+  const char* connection = nullptr;
+  if(!readInt(version) || version != CXMETA_VERSION || !readString(connection))
+  {
+    return false;
+  }
+  // Snapshot of another database connection: start all over
+  if(m_connection.CompareNoCase(LPCSTRToString(connection,true)) != 0)
+  {
+    return false;
+  }
+
+  UINT32 count = 0;
+  if(!readInt(count))
+  {
+    return false;
+  }
+  for(UINT32 ind = 0; ind < count; ++ind)
+  {
+    const char* schema = nullptr;
+    const char* finger = nullptr;
+    if(!readString(schema) || !readString(finger))
+    {
+      return false;
+    }
+    m_fingerprints[LPCSTRToString(schema,true)] = LPCSTRToString(finger,true);
+  }
+  if(!readInt(count))
+  {
+    return false;
+  }
+  for(UINT32 ind = 0; ind < count; ++ind)
+  {
+    const char* key   = nullptr;
+    const char* xml   = nullptr;
+    UINT32      kinds = 0;
+    if(!readString(key) || !readInt(kinds) || !readString(xml))
+    {
+      return false;
+    }
+    CXMetaEntry& entry = m_tables[LPCSTRToString(key,true)];
+    entry.m_mapped = xml;
+    entry.m_kinds  = kinds;
+  }
+  return true;
+}
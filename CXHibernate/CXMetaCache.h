@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXMetaCache.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#pragma once
+#include "CXHibernate.h"
+#include <SQLDatabase.h>
+#include <SQLDatabasePool.h>
+#include <map>
+#include <vector>
+
+using namespace SQLComponents;
+
+class CXTable;
+using CXTables = std::vector<CXTable*>;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PERSISTENT SCHEMA-METADATA CACHE
+//
+// A versioned snapshot file with the meta info of all tables that a
+// session has asked for. The file is mapped read-only into memory.
+// The table info is only parsed when a table is asked for.
+//
+// The snapshot is keyed by the connection and holds one fingerprint per
+// schema (SQLInfoDB::GetCATALOGSchemaFingerprint). At 'Open' the
+// fingerprints are checked against the database. Tables of a schema with
+// another fingerprint are dropped from the cache. For RDBMS'es without a
+// fingerprint the snapshot is used and refreshed in the background.
+//
+// File layout (all strings as UTF-8 with a length and a closing zero):
+//   "CXMC" <version> <connection>
+//   <count> { <schema> <fingerprint> }
+//   <count> { <schema.table> <kinds> <XML of CXTable::SaveMetaInfo> }
+//
+// Schema and table names are kept in the case of the catalog.
+// Each table records the optional kinds of info it holds. A table
+// with less info than asked for is a miss and is read again.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#define CXMETA_MAGIC    "CXMC"
+#define CXMETA_VERSION  2
+
+// Optional kinds of meta info of a table
+#define CXMETA_FOREIGNS   0x01
+#define CXMETA_INDICES    0x02
+#define CXMETA_PRIVILEGES 0x04
+
+// One table in the cache: in the mapped file, or refreshed in memory
+typedef struct _cxmetaEntry
+{
+  const char* m_mapped { nullptr };  // UTF-8 XML in the mapped snapshot
+  XString     m_xml;                 // XML after a store or refresh
+  unsigned    m_kinds  { 0       };  // Optional info kinds in the XML (CXMETA_*)
+}
+CXMetaEntry;
+
+using CXMetaEntries      = std::map<XString,CXMetaEntry>;
+using CXMetaFingerprints = std::map<XString,XString>;
+
+class CXMetaCache
+{
+public:
+  explicit CXMetaCache(XString p_filename);
+ ~CXMetaCache();
+
+  // Open the snapshot and validate it against the database
+  bool    Open(SQLDatabase* p_database);
+  // Fill the meta info of a table from the snapshot, if it has all kinds asked for
+  bool    FindTable(CXTable* p_table,unsigned p_kinds = 0);
+  // Keep the meta info of a table in the snapshot, with the kinds it holds
+  void    StoreTable(CXTable* p_table,SQLDatabase* p_database = nullptr,unsigned p_kinds = 0);
+  // Kinds of info for the flags of CXTable::GetMetaInfoFromDatabase
+  static unsigned InfoKinds(bool p_foreigns,bool p_indices,bool p_privileges);
+  // Get info of many tables with one catalog query per kind of info (where possible)
+  int     FetchTables(SQLDatabase* p_database
+                     ,CXTables&    p_tables
+                     ,bool         p_getForeigns   = false
+                     ,bool         p_getIndices    = false
+                     ,bool         p_getPrivileges = false);
+  // Write the snapshot to disk (only if changed)
+  bool    Save();
+  // Refresh all tables of the snapshot on a background thread
+  bool    RefreshInBackground(SQLDatabasePool* p_pool,XString p_connection);
+  // Wait for a background refresh to end
+  void    WaitForRefresh();
+
+  // GETTERS
+  XString GetFilename();
+  int     GetNumberOfTables();
+  bool    GetNeedsRefresh();
+
+private:
+  // Mapping of the snapshot file
+  bool    MapSnapshot();
+  void    UnmapSnapshot();
+  bool    ReadSnapshot(const BYTE* p_view,size_t p_size);
+  // Key of a table in the snapshot
+  XString TableKey(XString p_schema,XString p_table);
+  // Fingerprint of a schema (empty if not supported)
+  XString GetFingerprint(SQLDatabase* p_database,XString p_schema);
+  // Fill tables from the batched catalog results
+  void    DistributeInfo(CXTables& p_tables,MTableMap& p_info,MColumnMap& p_columns,MPrimaryMap& p_primary,
+                         MForeignMap& p_foreigns,MIndicesMap& p_indices,MPrivilegeMap& p_privileges);
+  // Running the background refresh
+  static unsigned __stdcall RunRefresh(void* p_cache);
+  void    Refresh();
+
+  XString             m_filename;                   // Snapshot file
+  XString             m_connection;                 // Key of the database connection
+  CXMetaFingerprints  m_fingerprints;               // Fingerprint of all schemas
+  CXMetaEntries       m_tables;                     // Meta info of all tables
+  bool                m_changed      { false   };   // Must write a new snapshot
+  bool                m_refresh      { false   };   // Unchecked snapshot: refresh in background
+  // Mapped snapshot
+  HANDLE              m_file         { INVALID_HANDLE_VALUE };
+  HANDLE              m_mapping      { NULL    };
+  const BYTE*         m_view         { nullptr };
+  // Background refresh
+  HANDLE              m_thread       { NULL    };
+  SQLDatabasePool*    m_pool         { nullptr };
+  XString             m_poolConnection;
+  CRITICAL_SECTION    m_lock;
+};
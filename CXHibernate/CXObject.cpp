@@ -238,6 +238,34 @@ CXObject::MakeTransient()
   ResetPrimaryKey();
 }
 
+// Release the database record (called by CXSession only!)
+// Changes are detected by the snapshot from now on
+void
+CXObject::Detach()
+{
+  m_record   = nullptr;
+  m_detached = true;
+  TakeSnapshot();
+}
+
+bool
+CXObject::IsDetached()
+{
+  return m_detached;
+}
+
+void
+CXObject::TakeSnapshot()
+{
+  m_snapshot = ComputeSnapshot();
+}
+
+bool
+CXObject::IsChangedSinceSnapshot()
+{
+  return ComputeSnapshot() != m_snapshot;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 // PROTECTED INTERFACE
@@ -306,6 +334,10 @@ void CXObject::Serialize  (SQLRecord&   p_record,int p_mutation) {}
 void CXObject::DeSerialize(SOAPMessage& p_message,XMLElement* p_entity) {}
 void CXObject::DeSerialize(SQLRecord&   p_record) {}
 
+// Does nothing here. Only classes with a generated ordinal codec
+void CXObject::DeSerializeOrdinals(SQLRecord& p_record,CXOrdinals& p_ordinals) {}
+bool CXObject::HasOrdinalCodec() { return false; }
+
 // Re-synchronize the value of the generator after an 'INSERT'
 void
 CXObject::DeSerializeGenerator(SQLRecord& p_record)
@@ -790,3 +822,52 @@ CXObject::LogClassAttributes(CXClass* p_class)
     attribute = p_class->FindAttribute(++index);
   }
 }
+
+// Hash of all persistent attributes as serialized to a record
+// The object is serialized to a scratch record in the shape of the class,
+// so the same conversions are used as for the real database record
+unsigned __int64
+CXObject::ComputeSnapshot()
+{
+  if(m_class == nullptr)
+  {
+    return 0;
+  }
+  SQLDataSet* shape = m_class->GetShapeDataSet();
+  SQLRecord record(shape,true);
+  SQLVariant empty;
+  for(int ind = 0;ind < shape->GetNumberOfFields();++ind)
+  {
+    record.AddField(&empty);
+  }
+
+  // Serialize without touching our own (detached) record
+  SQLRecord* own = TempReplaceRecord(&record);
+  Serialize(record);
+  TempReplaceRecord(own);
+
+  // FNV-1a over all values, including the NULL status
+  unsigned __int64 hash = 14695981039346656037ULL;
+  for(int ind = 0;ind < record.GetNumberOfFields();++ind)
+  {
+    SQLVariant* field = record.GetField(ind);
+    XString value;
+    if(field && !field->IsNULL())
+    {
+      field->GetAsString(value);
+      value += _T('\x1E');
+    }
+    else
+    {
+      value = _T('\x1F');
+    }
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(value.GetString());
+    size_t length = value.GetLength() * sizeof(TCHAR);
+    for(size_t pos = 0;pos < length;++pos)
+    {
+      hash ^= bytes[pos];
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
@@ -37,6 +37,7 @@ class CXTable;
 class CXClass;
 class CXSession;
 class CXObject;
+class CXOrdinals;
 
 using CXResultSet = std::vector<CXObject*>;
 
@@ -46,6 +47,9 @@ public:
   CXObject();
   virtual ~CXObject();
 
+  // Class that implements the ordinal codec (see DECLARE_CXO_ORDINALS)
+  using CXOrdinalOwner = CXObject;
+
   // Setting the class is a mandatory action
   // Regularly only called by the CX-Hibernate framework
   void            SetClass(CXClass* p_class);
@@ -66,6 +70,10 @@ public:
   virtual void    DeSerialize(SOAPMessage& p_message,XMLElement* p_entity);
   virtual void    DeSerialize(SQLRecord&   p_record);
 
+  // Read the contents of an object by bound ordinals (generated codec)
+  virtual void    DeSerializeOrdinals(SQLRecord& p_record,CXOrdinals& p_ordinals);
+  virtual bool    HasOrdinalCodec();
+
   // Re-synchronize the value of the generator after an 'INSERT'
   virtual void    DeSerializeGenerator(SQLRecord& p_record);
 
@@ -100,6 +108,13 @@ public:
   // Getting the complete primary key
   VariantSet&     GetPrimaryKey();
 
+  // Detached mode: the database record is released after the load
+  void            Detach();
+  bool            IsDetached();
+  // Snapshot of the persistent attributes to detect changes
+  void            TakeSnapshot();
+  bool            IsChangedSinceSnapshot();
+
 protected:
   // Bring the contents of the class to a SOAPMessage or a SQLRecord
   virtual void    PreSerialize (SOAPMessage& p_msg,XMLElement* p_entity);
@@ -179,11 +194,17 @@ protected:
   // Object is read-only? (View or duplicate recod)
   bool       m_readOnly { false };
 
+  // Detached from its database record, with a hash of the attributes
+  bool       m_detached { false };
+  unsigned __int64 m_snapshot { 0 };
+
 private:
   // Fill in the primary key of the object
   void FillPrimaryKey(SOAPMessage& p_message, XMLElement* p_entity);
   void FillPrimaryKey(SQLRecord&   p_record);
   // Log all attributes of a class (if any)
   void LogClassAttributes(CXClass* p_class);
+  // Hash of all persistent attributes as serialized to a record
+  unsigned __int64 ComputeSnapshot();
 };
 
@@ -26,7 +26,10 @@
 //
 #pragma once
 #include "CXStaticInitialization.h"
+#include "CXOrdinals.h"
 #include <bcd.h>
+#include <typeinfo>
+#include <type_traits>
 
 //////////////////////////////////////////////////////////////////////////
 //
@@ -103,6 +106,22 @@ CXOReg##classname _register##classname;
                                                 super::DeSerialize(p_message,p_entity);
 #define END_XML_DESERIALIZE                     PostDeSerialize(p_message,p_entity);}
 
+// Ordinal bound de-serialization (generated by cfg2cpp)
+// The codec is only used for the exact class that declares it, so that a
+// derived class without a codec still uses its name based DeSerialize.
+#define DECLARE_CXO_ORDINALS(Classname) virtual void DeSerializeOrdinals(SQLRecord& p_record,CXOrdinals& p_ordinals);\
+                                        virtual bool HasOrdinalCodec() { return typeid(*this) == typeid(Classname); }\
+                                        using CXOrdinalOwner = Classname
+
+#define CXO_DBS_ORDINAL(property,column)  CXOrdinalRead(p_ordinals,column,property);
+
+#define BEGIN_DBS_ORDINALS(Classname,super)    void Classname::DeSerializeOrdinals(SQLRecord& p_record,CXOrdinals& p_ordinals)\
+                                               {static_assert(std::is_same<super::CXOrdinalOwner,super>::value,\
+                                                              "Super class of " #Classname " has no ordinal codec");\
+                                                PreDeSerialize(p_record);\
+                                                super::DeSerializeOrdinals(p_record,p_ordinals);
+#define END_DBS_ORDINALS                        PostDeSerialize(p_record);}
+
 #define BEGIN_DESERIALIZE_GENERATOR(Classname) void Classname::DeSerializeGenerator(SQLRecord& p_record)\
                                                {PreDeSerialize(p_record);
 #define END_DESERIALIZE_GENERATOR              }
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXOrdinals.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#pragma once
+#include <SQLRecord.h>
+#include <SQLVariant.h>
+#include <SQLDataSet.h>
+#include <SQLDate.h>
+#include <SQLTime.h>
+#include <SQLTimestamp.h>
+#include <SQLInterval.h>
+#include <SQLGuid.h>
+#include <bcd.h>
+#include <vector>
+
+using namespace SQLComponents;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// ORDINAL BOUND DE-SERIALIZATION
+//
+// The ordinal codec of a class (generated by cfg2cpp with the
+// BEGIN_DBS_ORDINALS macros) reads its columns in a fixed sequence.
+// The first record of a result set binds each column name to its
+// ordinal in the set. All following records of the same result set
+// (same shape) read the columns by ordinal without a name lookup.
+//
+// Use one CXOrdinals per class per result set. Not thread safe.
+//
+//////////////////////////////////////////////////////////////////////////
+
+class CXOrdinals
+{
+public:
+  // Start the next record. Rebinds if the shape of the result set changed
+  void Start(const SQLRecord& p_record)
+  {
+    SQLDataSet* shape  = p_record.GetDataSet();
+    int         fields = p_record.GetNumberOfFields();
+    if(shape != m_shape || fields != m_fields)
+    {
+      m_shape  = shape;
+      m_fields = fields;
+      m_ordinals.clear();
+    }
+    m_record   = &p_record;
+    m_position = 0;
+  }
+
+  // Ordinal of the next column in the sequence of the codec
+  int Next(const TCHAR* p_column)
+  {
+    if(m_position < m_ordinals.size())
+    {
+      return m_ordinals[m_position++];
+    }
+    // First record of this shape: bind by name
+    int ordinal = m_shape ? m_shape->GetFieldNumber(p_column) : -1;
+    m_ordinals.push_back(ordinal);
+    ++m_position;
+    return ordinal;
+  }
+
+  // Field of the current record at this ordinal
+  const SQLVariant* Field(int p_ordinal) const
+  {
+    return m_record ? m_record->GetField(p_ordinal) : nullptr;
+  }
+
+  // Number of bound columns
+  size_t GetBoundColumns() const { return m_ordinals.size(); }
+
+private:
+  const SQLRecord*  m_record   { nullptr };
+  SQLDataSet*       m_shape    { nullptr };   // Result set we are bound to
+  int               m_fields   { 0 };         // Number of fields in the result set
+  std::vector<int>  m_ordinals;               // Bound ordinals in codec sequence
+  size_t            m_position { 0 };         // Position in the codec sequence
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Type specialized reads
+// CXNative<T>::type is the ODBC C type that holds a T as-is.
+// If the field has that type, the value is copied from the buffer of
+// the variant. Otherwise the same SQLVariant conversion is used as in
+// the name based CXO_DBS_DESERIALIZE (SQLRecord::GetFieldXXX)
+//
+//////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+struct CXNative
+{
+  static constexpr int type = 0;    // No direct buffer copy
+};
+
+template<> struct CXNative<short>            { static constexpr int type = SQL_C_SSHORT;  };
+template<> struct CXNative<unsigned short>   { static constexpr int type = SQL_C_USHORT;  };
+template<> struct CXNative<int>              { static constexpr int type = SQL_C_SLONG;   };
+template<> struct CXNative<unsigned int>     { static constexpr int type = SQL_C_ULONG;   };
+template<> struct CXNative<float>            { static constexpr int type = SQL_C_FLOAT;   };
+template<> struct CXNative<double>           { static constexpr int type = SQL_C_DOUBLE;  };
+template<> struct CXNative<__int64>          { static constexpr int type = SQL_C_SBIGINT; };
+template<> struct CXNative<unsigned __int64> { static constexpr int type = SQL_C_UBIGINT; };
+
+// Conversions for a non-native field type
+inline void CXConvert(const SQLVariant* p_var,bool&             p_value) { p_value = p_var->GetAsBoolean();           }
+inline void CXConvert(const SQLVariant* p_var,TCHAR&            p_value) { p_value = (TCHAR)p_var->GetAsUShort();      }
+inline void CXConvert(const SQLVariant* p_var,short&            p_value) { p_value = p_var->GetAsSShort();            }
+inline void CXConvert(const SQLVariant* p_var,unsigned short&   p_value) { p_value = p_var->GetAsUShort();            }
+inline void CXConvert(const SQLVariant* p_var,int&              p_value) { p_value = p_var->GetAsSLong();             }
+inline void CXConvert(const SQLVariant* p_var,unsigned int&     p_value) { p_value = p_var->GetAsULong();             }
+inline void CXConvert(const SQLVariant* p_var,float&            p_value) { p_value = p_var->GetAsFloat();             }
+inline void CXConvert(const SQLVariant* p_var,double&           p_value) { p_value = p_var->GetAsDouble();            }
+inline void CXConvert(const SQLVariant* p_var,__int64&          p_value) { p_value = p_var->GetAsSBigInt();           }
+inline void CXConvert(const SQLVariant* p_var,unsigned __int64& p_value) { p_value = p_var->GetAsUBigInt();           }
+inline void CXConvert(const SQLVariant* p_var,SQLDate&          p_value) { p_value = p_var->GetAsSQLDate();           }
+inline void CXConvert(const SQLVariant* p_var,SQLTime&          p_value) { p_value = p_var->GetAsSQLTime();           }
+inline void CXConvert(const SQLVariant* p_var,SQLTimestamp&     p_value) { p_value = p_var->GetAsSQLTimestamp();      }
+inline void CXConvert(const SQLVariant* p_var,SQLInterval&      p_value) { p_value = p_var->GetAsSQLInterval();       }
+inline void CXConvert(const SQLVariant* p_var,SQLGuid&          p_value) { p_value = p_var->GetAsSQLGuid();           }
+inline void CXConvert(const SQLVariant* p_var,XString&          p_value) { p_var->GetAsString(p_value);               }
+inline void CXConvert(const SQLVariant* p_var,bcd&              p_value) { p_value = p_var->GetAsBCD();               }
+
+// Read one property from the field at the next ordinal
+template<typename T>
+inline void CXOrdinalRead(CXOrdinals& p_ordinals,const TCHAR* p_column,T& p_property)
+{
+  const SQLVariant* var = p_ordinals.Field(p_ordinals.Next(p_column));
+  if(var == nullptr)
+  {
+    // Same as the name based reading of a missing column
+    p_property = T();
+    return;
+  }
+  if constexpr (CXNative<T>::type != 0)
+  {
+    if(var->GetDataType() == CXNative<T>::type && !var->IsNULL())
+    {
+      p_property = *reinterpret_cast<const T*>(var->GetDataPointer());
+      return;
+    }
+  }
+  CXConvert(var,p_property);
+}
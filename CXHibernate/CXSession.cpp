@@ -29,6 +29,7 @@
 #include "CXClass.h"
 #include "CXPrimaryHash.h"
 #include "CXRole.h"
+#include "CXOrdinals.h"
 #include <AutoCritical.h>
 #include <SQLQuery.h>
 #include <SQLTransaction.h>
@@ -36,6 +37,7 @@
 #include <SOAPMessage.h>
 #include <HTTPClient.h>
 #include <ServiceReporting.h>
+#include <Metrics.h>
 #include <io.h>
 
 #ifdef _DEBUG
@@ -44,6 +46,15 @@
 static char THIS_FILE[] = __FILE__;
 #endif
 
+//////////////////////////////////////////////////////////////////////////
+// Metrics of all sessions
+
+static MetricHistogram* s_loadTime    = GetMetricsRegistry().GetHistogram(_T("cxh_session_load_seconds"),       _T("Loading of objects by a CXSession"));
+static MetricHistogram* s_saveTime    = GetMetricsRegistry().GetHistogram(_T("cxh_session_save_seconds"),       _T("Saving of objects by a CXSession"));
+static MetricHistogram* s_syncTime    = GetMetricsRegistry().GetHistogram(_T("cxh_session_synchronize_seconds"),_T("Synchronizing the cache of a CXSession"));
+static MetricCounter*   s_cacheHits   = GetMetricsRegistry().GetCounter  (_T("cxh_session_cache_hits_total"),   _T("Objects found in the session cache"));
+static MetricCounter*   s_cacheMisses = GetMetricsRegistry().GetCounter  (_T("cxh_session_cache_misses_total"), _T("Objects not found in the session cache"));
+
 //////////////////////////////////////////////////////////////////////////
 // Static functions for logging of the SQLDatbase
 
@@ -96,6 +107,13 @@ CXSession::CXSession(CString p_sessionKey,CString p_database,CString p_user,CStr
 // DTOR: Free all tables and records
 CXSession::~CXSession()
 {
+  // Stop the write-behind queue (flushes the queue)
+  if(m_writeBehind)
+  {
+    delete m_writeBehind;
+    m_writeBehind = nullptr;
+  }
+
   // Destroy the caches
   ClearCache();
   ClearClasses();
@@ -260,6 +278,76 @@ CXSession::SetInternet(CString p_url)
   m_url = p_url;
 }
 
+// Detach all loaded objects from their database records
+// Saves memory for large caches. Changes are found by object snapshots
+void
+CXSession::SetDetachedObjects(bool p_detached)
+{
+  m_detached = p_detached;
+}
+
+bool
+CXSession::GetDetachedObjects()
+{
+  return m_detached;
+}
+
+// Opt-in read replicas: selects go to the replicas of our connection (round-robin)
+// All DML stays on the primary. After a write of this session we keep reading
+// from the primary for 'p_sticky' milliseconds, so we read our own writes.
+void
+CXSession::SetReadReplicas(bool p_replicas,unsigned p_sticky /*= CXH_REPLICA_STICKY*/)
+{
+  m_readReplicas  = p_replicas;
+  m_replicaSticky = p_sticky;
+}
+
+bool
+CXSession::GetReadReplicas()
+{
+  return m_readReplicas;
+}
+
+// Opt-in write-behind mode: INSERT/UPDATE/DELETE are queued and flushed
+// in the background. Loaded objects are detached in this mode, as the
+// database records would not follow the queued mutations.
+// Calling with a nullptr flushes the queue and stops the write-behind mode.
+// The detached setting from before the write-behind mode is then restored.
+void
+CXSession::SetWriteBehind(CXWriteBehindOptions* p_options)
+{
+  if(m_writeBehind)
+  {
+    CXWriteBehind* writer = m_writeBehind;
+    m_writeBehind = nullptr;
+    m_detached    = m_wbDetached;
+    try
+    {
+      writer->Close();
+    }
+    catch(StdException&)
+    {
+      delete writer;
+      throw;
+    }
+    delete writer;
+  }
+  if(p_options)
+  {
+    m_writeBehind = new CXWriteBehind(this,p_options);
+    m_writeBehind->Start();
+    m_wbDetached  = m_detached;
+    m_detached    = true;
+  }
+}
+
+// Getting the write-behind queue (if any) for metrics and flushing
+CXWriteBehind*
+CXSession::GetWriteBehind()
+{
+  return m_writeBehind;
+}
+
 // Add a class to the session
 bool
 CXSession::AddClass(CXClass* p_class)
@@ -460,12 +548,16 @@ CXSession::Load(CString p_className,SQLVariant* p_primary)
 CXObject*
 CXSession::Load(CString p_className,VariantSet& p_primary)
 {
+  MetricTimer timer(s_loadTime);
+
   // Search in cache
   CXObject* object = FindObjectInCache(p_className,p_primary);
   if(object)
   {
+    s_cacheHits->Add();
     return object;
   }
+  s_cacheMisses->Add();
 
   // If not found, search in database / SOAP connection
   if(m_role == CXH_Database_role)
@@ -520,6 +612,7 @@ CXSession::Load(CString p_tableName,SQLFilter* p_filter, CString p_orderBy /*= _
 CXResultSet
 CXSession::Load(CString p_className,SQLFilterSet& p_filters, CString p_orderBy /*= _T("")*/)
 {
+  MetricTimer timer(s_loadTime);
   CXResultSet set;
 
   if(m_role == CXH_Database_role)
@@ -572,6 +665,8 @@ CXSession::CheckReadOnly(CXObject* p_object)
 bool
 CXSession::Save(CXObject* p_object)
 {
+  MetricTimer timer(s_saveTime);
+
   CheckReadOnly(p_object);
   if(p_object->IsTransient())
   {
@@ -671,6 +766,59 @@ CXSession::Insert(CXObject* p_object)
   return result;
 }
 
+// Insert large batches of new objects on parallel connections
+// The OnInsert triggers are fired here, before the loader goes parallel
+bool
+CXSession::BulkInsert(CXResultSet& p_objects,CXBulkOptions* p_options /*= nullptr*/,CXBulkReport* p_report /*= nullptr*/)
+{
+  if(m_role != CXH_Database_role)
+  {
+    throw StdException(_T("Bulk insert is only possible in the database role of a session"));
+  }
+
+  CXResultSet objects;
+  bool triggers = p_options ? p_options->m_triggers : true;
+  for(auto& object : p_objects)
+  {
+    CheckReadOnly(object);
+    if(triggers && !CallOnInsert(object))
+    {
+      continue;
+    }
+    objects.push_back(object);
+  }
+
+  MarkWritten();
+  CXBulkReport report;
+  bool result = false;
+
+  // The report is also handed over when the load fails
+  auto finish = [&]()
+  {
+    report.m_skipped = (int)(p_objects.size() - objects.size());
+    report.m_objects = (int)p_objects.size();
+    if(p_report)
+    {
+      *p_report = report;
+    }
+  };
+  try
+  {
+    CXBulkLoader loader(this,p_options);
+    result = loader.Load(objects,&report);
+  }
+  catch(StdException&)
+  {
+    // Batches committed before the error are written as well
+    MarkWritten();
+    finish();
+    throw;
+  }
+  MarkWritten();
+  finish();
+  return result && report.m_skipped == 0;
+}
+
 bool
 CXSession::Delete(CXObject* p_object)
 {
@@ -782,7 +930,9 @@ CXSession::Synchronize()
     return false;
   }
 
+  MetricTimer timer(s_syncTime);
   AutoCritSec lock(&m_lock);
+  MarkWritten();
 
   // Getting a new mutation
   SQLAutoDBS dbs(*m_databasePool,m_dbsConnection);
@@ -799,8 +949,17 @@ CXSession::Synchronize()
       if(!object->GetReadOnly())
       {
         SQLRecord* record = object->GetDatabaseRecord();
+        if(record == nullptr && object->IsDetached())
+        {
+          // Detached objects are only saved if changed since loading
+          if(object->IsChangedSinceSnapshot() && Update(object) == false)
+          {
+            // Implicit rollback transaction
+            return false;
+          }
+        }
         // Only relevant status is 'Updated'. Cannot be otherwise!
-        if(record && (record->GetStatus() & SQL_Record_Updated))
+        else if(record && (record->GetStatus() & SQL_Record_Updated))
         {
           SerializeDiscriminator(object,record);
           object->Serialize(*record);
@@ -816,6 +975,13 @@ CXSession::Synchronize()
 
   // Commit in the database
   trans.Commit();
+
+  // Queued mutations must be in the database as well
+  if(m_writeBehind)
+  {
+    m_writeBehind->Flush();
+  }
+  MarkWritten();
   return true;
 }
 
@@ -828,7 +994,9 @@ CXSession::Synchronize(CString p_className)
     return false;
   }
 
+  MetricTimer timer(s_syncTime);
   AutoCritSec lock(&m_lock);
+  MarkWritten();
 
   // Getting a new mutation
   SQLAutoDBS dbs(*m_databasePool,m_dbsConnection);
@@ -847,8 +1015,17 @@ CXSession::Synchronize(CString p_className)
       if(!object->GetReadOnly())
       {
         SQLRecord* record = object->GetDatabaseRecord();
+        if(record == nullptr && object->IsDetached())
+        {
+          // Detached objects are only saved if changed since loading
+          if(object->IsChangedSinceSnapshot() && Update(object) == false)
+          {
+            // Implicit rollback transaction
+            return false;
+          }
+        }
         // Only relevant status is 'Updated'. Cannot be otherwise!
-        if(record && (record->GetStatus() & SQL_Record_Updated))
+        else if(record && (record->GetStatus() & SQL_Record_Updated))
         {
           SerializeDiscriminator(object,record);
           object->Serialize(*record);
@@ -864,6 +1041,13 @@ CXSession::Synchronize(CString p_className)
 
   // Commit in the database
   trans.Commit();
+
+  // Queued mutations must be in the database as well
+  if(m_writeBehind)
+  {
+    m_writeBehind->Flush();
+  }
+  MarkWritten();
   return true;
 }
 
@@ -1187,6 +1371,33 @@ CXSession::RemoveObjectFromCache(CXObject* p_object)
   return false;
 }
 
+// Objects of this class are detached after loading (session or class)
+bool
+CXSession::UseDetachedObjects(CXClass* p_class)
+{
+  return m_detached || p_class->GetDetached();
+}
+
+// Select from a read replica, unless we have written lately
+bool
+CXSession::UseReadReplica()
+{
+  if(!m_readReplicas)
+  {
+    return false;
+  }
+  return (GetTickCount64() - m_lastWrite) > (ULONGLONG)m_replicaSticky;
+}
+
+// Remember the moment of our last DML operation
+// Called before the DML (reads in between go to the primary) and again
+// when it is committed: the sticky period starts at the commit
+void
+CXSession::MarkWritten()
+{
+  m_lastWrite = GetTickCount64();
+}
+
 // Try to find an object in the cache
 // It's a double map lookup (table, object)
 CXObject*
@@ -1226,10 +1437,20 @@ CXSession::FindObjectInDatabase(CString p_className,VariantSet& p_primary)
   // Find the class of the object
   CXClass* theClass = FindClass(p_className);
 
-  SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection());
+  SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection(),UseReadReplica());
   dbs->RegisterLogContext(hibernate.GetLogLevel(),m_levelCallback,m_printCallback,m_callbkContext);
 
-  SQLRecord* record = theClass->SelectObjectInDatabase(dbs,nullptr,p_primary);
+  // Detached objects are read in a dataset of their own
+  SQLDataSet  detached;
+  SQLDataSet* dataset = nullptr;
+  bool        detach  = UseDetachedObjects(theClass);
+  if(detach)
+  {
+    theClass->InitDataSet(&detached);
+    dataset = &detached;
+  }
+
+  SQLRecord* record = theClass->SelectObjectInDatabase(dbs,dataset,p_primary);
   if(record)
   {
     // Create our object by the creation factory
@@ -1239,6 +1460,10 @@ CXSession::FindObjectInDatabase(CString p_className,VariantSet& p_primary)
 
     // De-serialize the SQL Record to an CXObject derived object
     object->DeSerialize(*record);
+    if(detach)
+    {
+      object->Detach();
+    }
 
     return object;
   }
@@ -1349,14 +1574,22 @@ CXSession::SelectObjectsFromDatabase(CString p_className,SQLFilterSet& p_filters
   CXTable* table = theClass->GetTable();
 
   // See if we have a data set
-  SQLDataSet* dset = theClass->GetDataSet();
+  // Detached objects are read in a dataset of their own
+  SQLDataSet  detached;
+  SQLDataSet* dset   = theClass->GetDataSet();
+  bool        detach = UseDetachedObjects(theClass);
+  if(detach)
+  {
+    theClass->InitDataSet(&detached);
+    dset = &detached;
+  }
   if (dset == nullptr)
   {
     return set;
   }
 
   // Connect our database
-  SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection());
+  SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection(),UseReadReplica());
   dbs->RegisterLogContext(hibernate.GetLogLevel(),m_levelCallback,m_printCallback,m_callbkContext);
   dset->SetDatabase(dbs);
 
@@ -1380,6 +1613,8 @@ CXSession::SelectObjectsFromDatabase(CString p_className,SQLFilterSet& p_filters
   }
   if(selected)
   {
+    // Columns are bound to ordinals on the first record of the set
+    CXOrdinals ordinals;
     int recnum = startreading;
     while(recnum >= 0)
     {
@@ -1395,7 +1630,19 @@ CXSession::SelectObjectsFromDatabase(CString p_className,SQLFilterSet& p_filters
       object->SetClass(theClass);
 
       // De-serialize the SQL Record to an CXObject derived object
-      object->DeSerialize(*record);
+      if(object->HasOrdinalCodec())
+      {
+        ordinals.Start(*record);
+        object->DeSerializeOrdinals(*record,ordinals);
+      }
+      else
+      {
+        object->DeSerialize(*record);
+      }
+      if(detach)
+      {
+        object->Detach();
+      }
 
       // Add object to the cache
       if(object->IsPersistent())
@@ -1493,9 +1740,23 @@ CXSession::UpdateObjectInDatabase(CXObject* p_object,SQLDatabase* p_dbs /*=nullp
   {
     throw StdException(_T("Missing class on UPDATE of an object. Did you tinkle with the PrimaryKey?"));
   }
+  MarkWritten();
+
+  // Nothing to do for an unchanged detached object
+  if(p_object->IsDetached() && !p_object->IsChangedSinceSnapshot())
+  {
+    return true;
+  }
 
   bool result(false);
-  if(p_dbs)
+  // Versioned objects must see their conflicts: never queued
+  if(m_writeBehind && p_dbs == nullptr && theClass->FindVersion() == nullptr)
+  {
+    // Queued: the state of the object is taken right now
+    m_writeBehind->Update(p_object);
+    result = true;
+  }
+  else if(p_dbs)
   {
     result = theClass->UpdateObjectInDatabase(p_dbs,nullptr,p_object,0);
   }
@@ -1512,8 +1773,14 @@ CXSession::UpdateObjectInDatabase(CXObject* p_object,SQLDatabase* p_dbs /*=nullp
     {
       // Commit our transaction in the database
       trans.Commit();
+      MarkWritten();
     }
   }
+  // New baseline for the next update
+  if(result && p_object->IsDetached())
+  {
+    p_object->TakeSnapshot();
+  }
   return result;
 }
 
@@ -1561,6 +1828,15 @@ CXSession::InsertObjectInDatabase(CXObject* p_object)
   {
     throw StdException(_T("Object without a connected class. Did you call CXSession::CreateObject(<classname>)??"));
   }
+  MarkWritten();
+
+  // Write-behind: queue the insert if the key is known in advance
+  if(m_writeBehind && m_writeBehind->CanInsert(p_object))
+  {
+    m_writeBehind->Insert(p_object);
+    p_object->Detach();
+    return true;
+  }
 
   // New mutation ID for this update action
   SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection());
@@ -1572,6 +1848,28 @@ CXSession::InsertObjectInDatabase(CXObject* p_object)
   {
     // Commit in the database
     trans.Commit();
+    MarkWritten();
+
+    // Release the inserted record(s) of a detached object
+    // Sub-table mapping: every level has its own record in its own dataset
+    if(UseDetachedObjects(theClass))
+    {
+      SQLRecord*  record  = p_object->GetDatabaseRecord();
+      VariantSet& primary = p_object->GetPrimaryKey();
+      for(CXClass* cl = theClass;cl;cl = cl->GetSuperClass())
+      {
+        SQLDataSet* dataset = cl->GetDataSet();
+        if(!dataset->ForgetRecord(record,true))
+        {
+          SQLRecord* level = dataset->SearchObjectRecord(primary);
+          if(level)
+          {
+            dataset->ForgetRecord(level,true);
+          }
+        }
+      }
+      p_object->Detach();
+    }
   }
   return saved;
 }
@@ -1628,6 +1926,19 @@ CXSession::DeleteObjectInDatabase(CXObject* p_object)
   {
     return true;
   }
+  MarkWritten();
+
+  // Write-behind: queue the delete (the key is copied)
+  // Versioned objects must see their conflicts: never queued
+  if(m_writeBehind && theClass->FindVersion() == nullptr)
+  {
+    m_writeBehind->Delete(p_object);
+    if(RemoveObjectFromCache(p_object) == false)
+    {
+      p_object->MakeTransient();
+    }
+    return true;
+  }
 
   // New mutation ID for this update action
   SQLAutoDBS dbs(*GetDatabasePool(),GetDatabaseConnection());
@@ -1640,6 +1951,7 @@ CXSession::DeleteObjectInDatabase(CXObject* p_object)
   {
     // Commit in the database first
     trans.Commit();
+    MarkWritten();
 
     // Remove the object from the cache, and make it transient
     if(RemoveObjectFromCache(p_object) == false)
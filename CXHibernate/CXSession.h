@@ -29,21 +29,30 @@
 #include "CXObject.h"
 #include "CXRole.h"
 #include "CXSessionUse.h"
+#include "CXBulkLoader.h"
+#include "CXWriteBehind.h"
 #include <SQLDatabasePool.h>
 #include <SQLDataSet.h>
 #include <SQLMetaInfo.h>
 #include <map>
+#include <atomic>
 
 class CXClass;
 class HTTPClient;
 using namespace SQLComponents;
 
+// Milliseconds after a write in which we keep reading from the primary database
+#define CXH_REPLICA_STICKY 5000
+
 using ClassMap    = std::map<CString,CXClass*>;
 using ObjectCache = std::map<CString,CXObject*>;
 using CXCache     = std::map<CString,ObjectCache*>;
 
 class CXSession
 {
+  // The bulk loader logs on its own connections
+  friend CXBulkLoader;
+  friend CXWriteBehind;
 public:
   // Construct as a internet slave
   CXSession(CString p_sessionKey);
@@ -77,6 +86,12 @@ public:
   void          SetFilestore(CString p_directory);
   // Setting an alternate internet location
   void          SetInternet(CString p_url);
+  // Detach all loaded objects from their database records
+  void          SetDetachedObjects(bool p_detached);
+  // Queue all mutations and flush them in the background (nullptr = stop)
+  void          SetWriteBehind(CXWriteBehindOptions* p_options);
+  // Selects from the read replicas of our connection (see "ReplicaOf" in database.xml)
+  void          SetReadReplicas(bool p_replicas,unsigned p_sticky = CXH_REPLICA_STICKY);
 
   // GETTERS
 
@@ -90,6 +105,12 @@ public:
   ClassMap&     GetClasses();
   // Finding a class
   CXClass*      FindClass(CString p_name);
+  // Are all loaded objects detached from their records?
+  bool          GetDetachedObjects();
+  // Getting the write-behind queue (if any)
+  CXWriteBehind* GetWriteBehind();
+  // Are selects done on the read replicas?
+  bool          GetReadReplicas();
 
   // FILESTORE & SOAP interface
 
@@ -115,6 +136,8 @@ public:
   bool          Update(CXObject* p_object,SQLDatabase* p_dbs = nullptr);
   bool          Insert(CXObject* p_object);
   bool          Delete(CXObject* p_object);
+  // Insert large batches of new objects on parallel connections (see CXBulkLoader)
+  bool          BulkInsert(CXResultSet& p_objects,CXBulkOptions* p_options = nullptr,CXBulkReport* p_report = nullptr);
   // Remove object from the result cache without any database/internet actions
   bool          RemoveObject(CXObject* p_object);
   bool          RemoveObjects(CXResultSet& p_resultSet);
@@ -146,6 +169,11 @@ private:
   bool          RemoveObjectFromCache(CXObject* p_object);
   // Create a filters set for a DataSet
   void          BuildFilter(SOAPMessage& p_message,XMLElement* p_entity,SQLFilterSet& p_filters);
+  // Objects of this class are detached after loading (session or class)
+  bool          UseDetachedObjects(CXClass* p_class);
+  // Read replicas: read-your-writes after a DML operation of this session
+  bool          UseReadReplica();
+  void          MarkWritten();
 
   // Try to find an object in the cache
   CXObject*     FindObjectInCache    (CString p_className,VariantSet& p_primary);
@@ -193,6 +221,7 @@ private:
   CString           m_baseDirectory;               // Base directory for filestore role
   CString           m_url;                         // Internet URL where we get our data
   bool              m_ownPool       { false   };   // We own / destroy this database
+  bool              m_detached      { false   };   // Detach all objects from their records
   SQLDatabasePool*  m_databasePool  { nullptr };   // Database connection pool
   XString           m_dbsConnection;               // Database connection name
   CString           m_dbsCatalog;                  // Database to connect to
@@ -202,6 +231,11 @@ private:
   CXCache           m_cache;                       // All cached objects of all known tables
   MetaSession       m_metaInfo;                    // Database meta-session info
   HTTPClient*       m_client        { nullptr };   // Client for internet role
+  CXWriteBehind*    m_writeBehind   { nullptr };   // Write-behind queue (opt-in)
+  bool              m_wbDetached    { false   };   // Detached setting before the write-behind mode
+  bool              m_readReplicas  { false   };   // Select from read replicas (opt-in)
+  unsigned          m_replicaSticky { CXH_REPLICA_STICKY }; // Stay on the primary after a write (ms)
+  std::atomic<ULONGLONG> m_lastWrite { 0 };      // Tickcount of our last DML operation (also by the write-behind)
 
   LOGPRINT          m_printCallback { nullptr };   // Printing a line to the logger
   LOGLEVEL          m_levelCallback { nullptr };   // Getting the log level
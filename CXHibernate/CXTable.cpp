@@ -30,6 +30,7 @@
 #include "CXAttribute.h"
 #include "CXObject.h"
 #include "CXClass.h"
+#include "CXMetaCache.h"
 #include <SOAPMessage.h>
 
 #ifdef _DEBUG
@@ -232,7 +233,8 @@ bool
 CXTable::GetMetaInfoFromDatabase(SQLDatabase& p_database
                                 ,bool p_getForeigns   /*= false*/
                                 ,bool p_getIndices    /*= false*/
-                                ,bool p_getPrivileges /*= false*/)
+                                ,bool p_getPrivileges /*= false*/
+                                ,CXMetaCache* p_cache /*= nullptr*/)
 {
   // See if we have something to go on...
   if(m_table.m_table.IsEmpty())
@@ -240,6 +242,14 @@ CXTable::GetMetaInfoFromDatabase(SQLDatabase& p_database
     return false;
   }
 
+  // Try the snapshot of the metadata cache first
+  // It must hold at least the kinds of info we ask for
+  unsigned kinds = CXMetaCache::InfoKinds(p_getForeigns,p_getIndices,p_getPrivileges);
+  if(p_cache && p_cache->FindTable(this,kinds))
+  {
+    return true;
+  }
+
   // Getting the info object
   SQLInfoDB* info = p_database.GetSQLInfoDB();
 
@@ -261,9 +271,26 @@ CXTable::GetMetaInfoFromDatabase(SQLDatabase& p_database
   {
     GetPrivilegeInfo(info);
   }
+
+  // Keep for the next time
+  if(p_cache)
+  {
+    p_cache->StoreTable(this,&p_database,kinds);
+  }
   return true;
 }
 
+// Forget all meta info (except for the names)
+void
+CXTable::ResetMetaInfo()
+{
+  m_columns.clear();
+  m_primary.clear();
+  m_foreigns.clear();
+  m_indices.clear();
+  m_privileges.clear();
+}
+
 // Serialize the info of the table
 bool
 CXTable::SaveMetaInfo(CXSession* p_session,CString p_filename)
@@ -274,12 +301,7 @@ CXTable::SaveMetaInfo(CXSession* p_session,CString p_filename)
   SOAPMessage msg(namesp,action);
 
   // Saving table info to the XML message
-  SaveTableInfo(msg);
-  SaveColumnInfo(msg);
-  SavePrimaryKey(msg);
-  SaveForeignKey(msg);
-  SaveIndices(msg);
-  SavePrivileges(msg);
+  SaveMetaInfo(msg);
 
   // Storing the info on the file system
   CString filename = p_filename.IsEmpty() ? p_session->CreateFilestoreName(this) : p_filename;
@@ -299,24 +321,37 @@ CXTable::LoadMetaInfo(CXSession* p_session,CString p_filename)
     return false;
   }
 
-  // Forget previous info
-  m_columns.clear();
-  m_primary.clear();
-  m_foreigns.clear();
-  m_indices.clear();
-  m_privileges.clear();
-
   // Loading info from the XML message
-  LoadTableInfo(msg);
-  LoadColumnInfo(msg);
-  LoadPrimaryKey(msg);
-  LoadForeignKey(msg);
-  LoadIndices(msg);
-  LoadPrivileges(msg);
-
+  LoadMetaInfo(msg);
   return true;
 }
 
+// Saving table info to a XML message
+void
+CXTable::SaveMetaInfo(SOAPMessage& p_msg)
+{
+  SaveTableInfo (p_msg);
+  SaveColumnInfo(p_msg);
+  SavePrimaryKey(p_msg);
+  SaveForeignKey(p_msg);
+  SaveIndices   (p_msg);
+  SavePrivileges(p_msg);
+}
+
+// Loading info from a XML message, forgetting the previous info
+void
+CXTable::LoadMetaInfo(SOAPMessage& p_msg)
+{
+  ResetMetaInfo();
+
+  LoadTableInfo (p_msg);
+  LoadColumnInfo(p_msg);
+  LoadPrimaryKey(p_msg);
+  LoadForeignKey(p_msg);
+  LoadIndices   (p_msg);
+  LoadPrivileges(p_msg);
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 //
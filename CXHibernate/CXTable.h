@@ -36,6 +36,7 @@
 using namespace SQLComponents;
 class XMLMessage;
 class CXSession;
+class CXMetaCache;
 
 class CXTable
 {
@@ -83,15 +84,20 @@ public:
   void      AddSequence  (MetaSequence&  p_metaSequence);
   void      AddPrivilege (MetaPrivilege& p_metaPrivilege);
 
-  // Get info from ODBC out of the database.
+  // Get info from ODBC out of the database. (Or from the metadata cache)
   bool      GetMetaInfoFromDatabase(SQLDatabase& p_database
                                    ,bool p_getForeigns   = false
                                    ,bool p_getIndices    = false
-                                   ,bool p_getPrivileges = false);
+                                   ,bool p_getPrivileges = false
+                                   ,CXMetaCache* p_cache = nullptr);
+  // Forget all meta info (except for the names)
+  void      ResetMetaInfo();
 
   // Serialize the info of the table
   bool      SaveMetaInfo(CXSession* p_session,CString p_filename = _T(""));
   bool      LoadMetaInfo(CXSession* p_session,CString p_filename = _T(""));
+  void      SaveMetaInfo(SOAPMessage& p_msg);
+  void      LoadMetaInfo(SOAPMessage& p_msg);
 
 private:
   // Getting table info from the ODBC database
@@ -0,0 +1,690 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXWriteBehind.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include "CXWriteBehind.h"
+#include "CXSession.h"
+#include "CXClass.h"
+#include "CXAttribute.h"
+#include "CXGenerator.h"
+#include <SQLAutoDBS.h>
+#include <SQLTransaction.h>
+#include <SQLQuery.h>
+#include <SQLInfoDB.h>
+#include <AutoCritical.h>
+#include <process.h>
+#include <algorithm>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CXWriteBehind::CXWriteBehind(CXSession* p_session,CXWriteBehindOptions* p_options /*= nullptr*/)
+              :m_session(p_session)
+{
+  if(p_options)
+  {
+    m_options = *p_options;
+  }
+  m_options.m_workers     = std::min(std::max(m_options.m_workers,1),CXWB_MAX_WORKERS);
+  m_options.m_maxQueue    = std::max(m_options.m_maxQueue,1);
+  m_options.m_batchSize   = std::max(m_options.m_batchSize,1);
+  m_options.m_groupCommit = std::max(m_options.m_groupCommit,0);
+  m_options.m_retries     = std::max(m_options.m_retries,1);
+
+  InitializeCriticalSection(&m_lock);
+  InitializeConditionVariable(&m_notEmpty);
+  InitializeConditionVariable(&m_notFull);
+  InitializeConditionVariable(&m_committed);
+}
+
+CXWriteBehind::~CXWriteBehind()
+{
+  try
+  {
+    Close();
+  }
+  catch(StdException& ex)
+  {
+    hibernate.Log(CXH_LOG_ERRORS,true,_T("Write-behind queue lost mutations: %s"),ex.GetErrorMessage().GetString());
+  }
+  DeleteCriticalSection(&m_lock);
+}
+
+// Start the workers
+void
+CXWriteBehind::Start()
+{
+  AutoCritSec lock(&m_lock);
+
+  if(m_running)
+  {
+    return;
+  }
+  m_running = true;
+  for(int ind = 0;ind < m_options.m_workers;++ind)
+  {
+    unsigned threadID = 0;
+    HANDLE thread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr,0,RunWorker,reinterpret_cast<void*>(this),0,&threadID));
+    if(thread)
+    {
+      m_threads[m_numThreads++] = thread;
+    }
+  }
+  if(m_numThreads == 0)
+  {
+    m_running = false;
+    throw StdException(_T("Cannot start the write-behind workers"));
+  }
+}
+
+// Flush the queue and stop the workers
+void
+CXWriteBehind::Close()
+{
+  if(!m_running)
+  {
+    return;
+  }
+  XString errors;
+  try
+  {
+    Flush();
+  }
+  catch(StdException& ex)
+  {
+    errors = ex.GetErrorMessage();
+  }
+  {
+    AutoCritSec lock(&m_lock);
+    m_running = false;
+    WakeAllConditionVariable(&m_notEmpty);
+  }
+  WaitForMultipleObjects(m_numThreads,m_threads,TRUE,INFINITE);
+  for(int ind = 0;ind < m_numThreads;++ind)
+  {
+    CloseHandle(m_threads[ind]);
+  }
+  m_numThreads = 0;
+
+  if(!errors.IsEmpty())
+  {
+    throw StdException(errors);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// QUEUEING MUTATIONS
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Inserts can only be queued if the key is known in advance
+bool
+CXWriteBehind::CanInsert(CXObject* p_object)
+{
+  CXClass* root = p_object->GetClass()->GetRootClass();
+  if(root->FindGenerator() == nullptr)
+  {
+    return p_object->IsPersistent();
+  }
+  CXGenerator* keygen = root->GetKeyGenerator();
+  return p_object->IsPersistent() || (keygen && keygen->IsClientSide());
+}
+
+void
+CXWriteBehind::Insert(CXObject* p_object)
+{
+  CXClass*     root = p_object->GetClass()->GetRootClass();
+  CXAttribute* gen  = root->FindGenerator();
+  if(gen && p_object->IsTransient())
+  {
+    // Take the key now from the block of this thread
+    SQLDataSet* shape = root->GetShapeDataSet();
+    SQLRecord   record(shape,true);
+    SQLVariant  empty;
+    for(int ind = 0;ind < shape->GetNumberOfFields();++ind)
+    {
+      record.AddField(&empty);
+    }
+    SQLVariant key = root->GetKeyGenerator()->NextKey();
+    record.SetField(gen->GetDatabaseColumn(),&key);
+
+    SQLRecord* own = p_object->TempReplaceRecord(&record);
+    p_object->ResetPrimaryKey();
+    p_object->DeSerializeGenerator(record);
+    p_object->TempReplaceRecord(own);
+  }
+  Enqueue(Serialize(p_object,WB_INSERT));
+}
+
+void
+CXWriteBehind::Update(CXObject* p_object)
+{
+  Enqueue(Serialize(p_object,WB_UPDATE));
+}
+
+void
+CXWriteBehind::Delete(CXObject* p_object)
+{
+  Enqueue(Serialize(p_object,WB_DELETE));
+}
+
+// Serialize an object into a new mutation
+CXWriteBehind::WBMutationPtr
+CXWriteBehind::Serialize(CXObject* p_object,WBAction p_action)
+{
+  CXClass* theClass = p_object->GetClass();
+  if(theClass == nullptr)
+  {
+    throw StdException(_T("Object without a connected class. Did you call CXSession::CreateObject(<classname>)??"));
+  }
+
+  // The tables of the object
+  std::vector<CXClass*> levels;
+  theClass->FindTableClasses(levels);
+
+  WBMutationPtr mutation = std::make_shared<WBMutation>();
+  mutation->m_action = p_action;
+  mutation->m_key    = theClass->GetRootClass()->GetName() + _T(":") + p_object->Hashcode();
+  mutation->m_tables.resize(levels.size());
+
+  // Names can take a pooled connection: never while holding the lock
+  for(size_t ind = 0;ind < levels.size();++ind)
+  {
+    mutation->m_tables[ind].m_table = DMLTableName(levels[ind]);
+  }
+
+  AutoCritSec lock(&m_lock);
+  for(size_t ind = 0;ind < levels.size();++ind)
+  {
+    SerializeTable(theClass,levels[ind],p_object,ind == 0,mutation->m_tables[ind]);
+  }
+  return mutation;
+}
+
+// DML name of the table of a class level. Found once on a pooled connection
+XString
+CXWriteBehind::DMLTableName(CXClass* p_level)
+{
+  {
+    AutoCritSec lock(&m_lock);
+    auto it = m_names.find(p_level);
+    if(it != m_names.end())
+    {
+      return it->second;
+    }
+  }
+  XString name;
+  {
+    SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+    name = p_level->GetTable()->GetDMLTableName(dbs->GetSQLInfoDB());
+  }
+  AutoCritSec lock(&m_lock);
+  m_names[p_level] = name;
+  return name;
+}
+
+// Serialize the part of the object in the table of one class level
+// The DML name of the table is already in 'p_table'
+void
+CXWriteBehind::SerializeTable(CXClass* p_class,CXClass* p_level,CXObject* p_object,bool p_root,WBTable& p_table)
+{
+  CXTable* table = p_level->GetTable();
+  p_table.m_primary = table->GetPrimaryKeyAsList();
+  if(p_table.m_primary.empty())
+  {
+    p_table.m_primary = p_class->GetPrimaryKeyAsList();
+  }
+
+  // Columns of this table
+  SQLDataSet* shape = p_level->GetTableDataSet();
+  SQLRecord   record(shape,true);
+  p_level->SerializeTableRecord(p_object,record,p_root);
+
+  // An UPDATE only sets the attributes of the class (never the key)
+  bool sub = hibernate.GetStrategy() == MapStrategy::Strategy_sub_table;
+  WordList attributes = sub ? p_level->FindAllDBSAttributes(false) : p_class->FindAllDBSAttributes(true);
+
+  for(int ind = 0;ind < shape->GetNumberOfFields();++ind)
+  {
+    XString column = shape->GetFieldName(ind);
+    bool key = std::find_if(p_table.m_primary.begin(),p_table.m_primary.end(),
+                            [&column](const XString& p_col) { return p_col.CompareNoCase(column) == 0; }) != p_table.m_primary.end();
+    bool att = std::find_if(attributes.begin(),attributes.end(),
+                            [&column](const XString& p_col) { return p_col.CompareNoCase(column) == 0; }) != attributes.end();
+    p_table.m_columns.push_back(column);
+    p_table.m_values.push_back(SQLVariant(record.GetField(ind)));
+    p_table.m_updatable.push_back(att && !key);
+  }
+}
+
+// Put in the queue, or coalesce with a waiting mutation of the same object
+void
+CXWriteBehind::Enqueue(WBMutationPtr p_mutation)
+{
+  AutoCritSec lock(&m_lock);
+
+  if(!m_running)
+  {
+    throw StdException(_T("Write-behind queue is not running"));
+  }
+  ++m_metrics.m_queued;
+
+  WBMutationPtr waiting;
+  auto it = m_pending.find(p_mutation->m_key);
+  if(it != m_pending.end())
+  {
+    waiting = it->second;
+    ++m_metrics.m_coalesced;
+
+    if(waiting->m_action == WB_INSERT && p_mutation->m_action == WB_DELETE)
+    {
+      // Never reached the database
+      waiting->m_action = WB_CANCELLED;
+      waiting->m_done   = true;
+      m_pending.erase(it);
+      --m_metrics.m_depth;
+      WakeAllConditionVariable(&m_committed);
+      WakeConditionVariable(&m_notFull);
+      return;
+    }
+    if(waiting->m_action == WB_DELETE && p_mutation->m_action == WB_INSERT)
+    {
+      // Row still exists in the database: overwrite it
+      waiting->m_action = WB_UPDATE;
+    }
+    else if(p_mutation->m_action == WB_DELETE)
+    {
+      waiting->m_action = WB_DELETE;
+    }
+    // Last writer wins
+    waiting->m_tables = p_mutation->m_tables;
+  }
+  else
+  {
+    // Backpressure on a full queue
+    while(m_metrics.m_depth >= m_options.m_maxQueue)
+    {
+      if(!m_options.m_blockWhenFull)
+      {
+        throw StdException(_T("Write-behind queue is full"));
+      }
+      ++m_metrics.m_waits;
+      SleepConditionVariableCS(&m_notFull,&m_lock,INFINITE);
+    }
+    waiting = p_mutation;
+    waiting->m_queued = GetTickCount64();
+    m_queue.push_back(waiting);
+    m_pending[waiting->m_key] = waiting;
+    m_metrics.m_maxDepth = std::max(m_metrics.m_maxDepth,++m_metrics.m_depth);
+    WakeConditionVariable(&m_notEmpty);
+  }
+
+  // Durable mode: wait for our commit
+  if(m_options.m_flushOnCommit)
+  {
+    while(!waiting->m_done)
+    {
+      SleepConditionVariableCS(&m_committed,&m_lock,INFINITE);
+    }
+    if(!waiting->m_error.IsEmpty())
+    {
+      throw StdException(_T("Write-behind mutation failed: ") + waiting->m_error);
+    }
+  }
+}
+
+// Wait until everything is committed. Throws on earlier failures
+void
+CXWriteBehind::Flush()
+{
+  AutoCritSec lock(&m_lock);
+
+  m_flushing = true;
+  WakeAllConditionVariable(&m_notEmpty);
+  while(m_metrics.m_depth > 0 || !m_inflight.empty())
+  {
+    SleepConditionVariableCS(&m_committed,&m_lock,INFINITE);
+  }
+  m_flushing = false;
+
+  if(!m_errors.IsEmpty())
+  {
+    XString errors(m_errors);
+    m_errors.Empty();
+    throw StdException(_T("Write-behind queue failed: ") + errors);
+  }
+}
+
+CXWriteBehindMetrics
+CXWriteBehind::GetMetrics()
+{
+  AutoCritSec lock(&m_lock);
+  CXWriteBehindMetrics metrics(m_metrics);
+  metrics.m_avgLatencyMs = m_metrics.m_flushed ? m_latency / (double)m_metrics.m_flushed : 0.0;
+  return metrics;
+}
+
+CXWriteBehindOptions&
+CXWriteBehind::GetOptions()
+{
+  return m_options;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WORKERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+/*static*/ unsigned __stdcall
+CXWriteBehind::RunWorker(void* p_writer)
+{
+  reinterpret_cast<CXWriteBehind*>(p_writer)->Worker();
+  return 0;
+}
+
+void
+CXWriteBehind::Worker()
+{
+  AutoCritSec lock(&m_lock);
+
+  while(m_running || m_metrics.m_depth > 0)
+  {
+    if(m_metrics.m_depth == 0)
+    {
+      SleepConditionVariableCS(&m_notEmpty,&m_lock,INFINITE);
+      continue;
+    }
+    // Group commit: gather a batch, unless somebody waits for us
+    if(m_running && !m_flushing && !m_options.m_flushOnCommit && m_metrics.m_depth < m_options.m_batchSize)
+    {
+      ULONGLONG age = GetTickCount64() - m_queue.front()->m_queued;
+      if(age < (ULONGLONG)m_options.m_groupCommit)
+      {
+        SleepConditionVariableCS(&m_notEmpty,&m_lock,(DWORD)(m_options.m_groupCommit - age));
+        continue;
+      }
+    }
+    std::vector<WBMutationPtr> batch;
+    TakeBatch(batch);
+    if(batch.empty())
+    {
+      // All waiting objects are in a batch of another worker
+      SleepConditionVariableCS(&m_committed,&m_lock,m_options.m_groupCommit + 1);
+      continue;
+    }
+
+    LeaveCriticalSection(&m_lock);
+    ULONGLONG start = GetTickCount64();
+    XString error;
+    try
+    {
+      FlushBatch(batch);
+    }
+    catch(StdException& ex)
+    {
+      error = ex.GetErrorMessage();
+    }
+    ULONGLONG now = GetTickCount64();
+    EnterCriticalSection(&m_lock);
+
+    // Book keeping
+    double duration = (double)(now - start);
+    m_metrics.m_lastFlushMs = duration;
+    m_metrics.m_maxFlushMs  = std::max(m_metrics.m_maxFlushMs,duration);
+    if(error.IsEmpty())
+    {
+      ++m_metrics.m_batches;
+      m_metrics.m_flushed += batch.size();
+      for(auto& mutation : batch)
+      {
+        m_latency += (double)(now - mutation->m_queued);
+        mutation->m_done = true;
+        m_inflight.erase(mutation->m_key);
+      }
+    }
+    else
+    {
+      FailedBatch(batch,error);
+    }
+    WakeAllConditionVariable(&m_committed);
+  }
+}
+
+// Mutations of a failed batch go back to the front of the queue.
+// After the last attempt a mutation is given up and reported by Flush.
+// Called with the lock held
+void
+CXWriteBehind::FailedBatch(std::vector<WBMutationPtr>& p_batch,XString p_error)
+{
+  hibernate.Log(CXH_LOG_ERRORS,true,_T("Write-behind batch of %d mutations failed: %s"),(int)p_batch.size(),p_error.GetString());
+
+  // Backwards, so the queue keeps the order of the batch
+  for(auto it = p_batch.rbegin();it != p_batch.rend();++it)
+  {
+    WBMutationPtr& mutation = *it;
+    m_inflight.erase(mutation->m_key);
+
+    if(++mutation->m_attempts >= m_options.m_retries)
+    {
+      ++m_metrics.m_failed;
+      m_errors += mutation->m_key + _T(": ") + p_error + _T("\n");
+      mutation->m_error = p_error;
+      mutation->m_done  = true;
+      continue;
+    }
+    ++m_metrics.m_retried;
+    ++m_metrics.m_depth;
+    m_queue.push_front(mutation);
+    // New mutations of the object coalesce with the retried one,
+    // unless a newer one is already waiting behind it
+    if(m_pending.find(mutation->m_key) == m_pending.end())
+    {
+      m_pending[mutation->m_key] = mutation;
+    }
+  }
+  m_metrics.m_maxDepth = std::max(m_metrics.m_maxDepth,m_metrics.m_depth);
+}
+
+// Take the oldest mutations of objects that are not in a running batch
+// A mutation that failed before goes in a batch of its own
+void
+CXWriteBehind::TakeBatch(std::vector<WBMutationPtr>& p_batch)
+{
+  std::deque<WBMutationPtr> rest;
+  bool single = false;
+  while(!m_queue.empty())
+  {
+    WBMutationPtr mutation = m_queue.front();
+    m_queue.pop_front();
+
+    if(mutation->m_action == WB_CANCELLED)
+    {
+      continue;
+    }
+    if(single || (int)p_batch.size() >= m_options.m_batchSize || m_inflight.count(mutation->m_key) ||
+       (mutation->m_attempts > 0 && !p_batch.empty()))
+    {
+      rest.push_back(mutation);
+      continue;
+    }
+    single = mutation->m_attempts > 0;
+    p_batch.push_back(mutation);
+    m_inflight.insert(mutation->m_key);
+    // A newer mutation of the object can be waiting behind a retried one
+    auto pending = m_pending.find(mutation->m_key);
+    if(pending != m_pending.end() && pending->second == mutation)
+    {
+      m_pending.erase(pending);
+    }
+    --m_metrics.m_depth;
+  }
+  m_queue.swap(rest);
+  if(!p_batch.empty())
+  {
+    WakeAllConditionVariable(&m_notFull);
+  }
+}
+
+// Flush one batch in one transaction on a pooled connection.
+// The rollback and freeing the statements are done before the
+// connection goes back to the pool.
+void
+CXWriteBehind::FlushBatch(std::vector<WBMutationPtr>& p_batch)
+{
+  SQLAutoDBS dbs(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+  std::map<XString,SQLQuery*> queries;
+  try
+  {
+    dbs->RegisterLogContext(hibernate.GetLogLevel(),m_session->m_levelCallback,m_session->m_printCallback,m_session->m_callbkContext);
+    SQLTransaction trans(dbs,_T("writebehind"));
+
+    for(auto& mutation : p_batch)
+    {
+      if(mutation->m_action == WB_DELETE)
+      {
+        // Sub-tables first
+        for(auto it = mutation->m_tables.rbegin();it != mutation->m_tables.rend();++it)
+        {
+          FlushTable(dbs,queries,WB_DELETE,*it);
+        }
+      }
+      else for(auto& table : mutation->m_tables)
+      {
+        FlushTable(dbs,queries,mutation->m_action,table);
+      }
+    }
+    trans.Commit();
+    // Reads of the session stay on the primary until the replicas have it
+    m_session->MarkWritten();
+  }
+  catch(StdException&)
+  {
+    for(auto& query : queries)
+    {
+      delete query.second;
+    }
+    throw;
+  }
+  for(auto& query : queries)
+  {
+    delete query.second;
+  }
+}
+
+// One statement for one table. Statements are prepared once per batch
+void
+CXWriteBehind::FlushTable(SQLDatabase* p_database,std::map<XString,SQLQuery*>& p_queries,WBAction p_action,WBTable& p_table)
+{
+  std::vector<SQLVariant*> parameters;
+  XString sql;
+
+  auto isKey = [&p_table](const XString& p_column) -> bool
+  {
+    for(auto& key : p_table.m_primary)
+    {
+      if(key.CompareNoCase(p_column) == 0) return true;
+    }
+    return false;
+  };
+  auto where = [&]() -> XString
+  {
+    XString clause(_T("\n WHERE "));
+    bool more = false;
+    for(size_t ind = 0;ind < p_table.m_columns.size();++ind)
+    {
+      if(isKey(p_table.m_columns[ind]))
+      {
+        clause += (more ? _T("\n   AND ") : _T("")) + p_table.m_columns[ind] + _T(" = ?");
+        parameters.push_back(&p_table.m_values[ind]);
+        more = true;
+      }
+    }
+    return clause;
+  };
+
+  switch(p_action)
+  {
+    case WB_INSERT: { WordList columns;
+                      for(size_t ind = 0;ind < p_table.m_columns.size();++ind)
+                      {
+                        if(!p_table.m_values[ind].IsNULL())
+                        {
+                          columns.push_back(p_table.m_columns[ind]);
+                          parameters.push_back(&p_table.m_values[ind]);
+                        }
+                      }
+                      sql = CXClass::MakeInsertStatement(p_table.m_table,columns);
+                      break;
+                    }
+    case WB_UPDATE: { XString set;
+                      for(size_t ind = 0;ind < p_table.m_columns.size();++ind)
+                      {
+                        if(p_table.m_updatable[ind])
+                        {
+                          if(p_table.m_values[ind].IsNULL())
+                          {
+                            set += p_table.m_columns[ind] + _T(" = NULL,");
+                          }
+                          else
+                          {
+                            set += p_table.m_columns[ind] + _T(" = ?,");
+                            parameters.push_back(&p_table.m_values[ind]);
+                          }
+                        }
+                      }
+                      if(set.IsEmpty())
+                      {
+                        // Nothing to do in this table
+                        return;
+                      }
+                      set.TrimRight(',');
+                      sql = _T("UPDATE ") + p_table.m_table + _T("\n   SET ") + set + where();
+                      break;
+                    }
+    case WB_DELETE: sql = _T("DELETE FROM ") + p_table.m_table + where();
+                    break;
+    default:        return;
+  }
+
+  SQLQuery*& query = p_queries[sql];
+  if(query == nullptr)
+  {
+    query = new SQLQuery(p_database);
+    query->DoSQLPrepare(sql);
+  }
+  query->ResetParameters();
+  int number = 1;
+  for(auto& parameter : parameters)
+  {
+    query->SetParameter(number++,parameter);
+  }
+  query->DoSQLExecute(true);
+}
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: CXWriteBehind.h
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#pragma once
+#include "CXHibernate.h"
+#include "CXObject.h"
+#include <SQLDatabase.h>
+#include <SQLDataSet.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <map>
+#include <set>
+
+using namespace SQLComponents;
+
+class CXSession;
+class CXClass;
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WRITE-BEHIND QUEUE
+//
+// Opt-in mode of a session (CXSession::SetWriteBehind) in which the
+// INSERT/UPDATE/DELETE of objects do not wait for the database.
+// - The object is serialized into a mutation the moment it is queued.
+//   The background workers never touch the objects themselves
+// - Mutations are coalesced per object: the last state wins.
+//   insert+update = insert, insert+delete = nothing, update+delete = delete
+// - Workers flush a batch of mutations in one transaction, after the
+//   group-commit interval or as soon as a batch is full
+// - The queue is bounded: callers wait (or get an error) when it is full
+// - With 'flush-on-commit' every call waits until its mutation is committed
+//
+// Inserts are only queued if the key is known in advance: a key without
+// a generator, or a generator with a client side strategy (CXGenerator).
+// The ordering between different objects is only kept with one worker.
+//
+// The mutations of a failed batch are queued again, each in a transaction
+// of its own, so one bad mutation cannot take the others with it. After
+// 'm_retries' failed attempts a mutation is reported by Flush (and Close).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#define CXWB_MAX_WORKERS  8
+
+typedef struct _cxWriteBehindOptions
+{
+  int     m_workers        { 1     };   // Flushing threads, each on a pooled connection
+  int     m_maxQueue       { 10000 };   // Maximum mutations waiting in the queue
+  int     m_batchSize      { 500   };   // Mutations per transaction
+  int     m_groupCommit    { 50    };   // Milliseconds to gather a batch
+  bool    m_flushOnCommit  { false };   // Callers wait until their mutation is committed
+  bool    m_blockWhenFull  { true  };   // Wait on a full queue (false = throw)
+  int     m_retries        { 3     };   // Attempts for a mutation of a failed batch
+}
+CXWriteBehindOptions;
+
+typedef struct _cxWriteBehindMetrics
+{
+  int     m_depth          { 0 };       // Mutations in the queue right now
+  int     m_maxDepth       { 0 };       // Highest depth of the queue
+  INT64   m_queued         { 0 };       // Mutations offered
+  INT64   m_coalesced      { 0 };       // Mutations merged with a waiting one
+  INT64   m_flushed        { 0 };       // Mutations committed
+  INT64   m_retried        { 0 };       // Mutations queued again after a failed batch
+  INT64   m_failed         { 0 };       // Mutations given up after all attempts
+  INT64   m_batches        { 0 };       // Transactions committed
+  INT64   m_waits          { 0 };       // Callers that had to wait for a full queue
+  double  m_lastFlushMs    { 0.0 };     // Duration of the last batch
+  double  m_maxFlushMs     { 0.0 };     // Longest batch
+  double  m_avgLatencyMs   { 0.0 };     // Average time from queue to commit
+}
+CXWriteBehindMetrics;
+
+class CXWriteBehind
+{
+public:
+  CXWriteBehind(CXSession* p_session,CXWriteBehindOptions* p_options = nullptr);
+ ~CXWriteBehind();
+
+  // Start and stop the workers. Close flushes the queue first
+  void  Start();
+  void  Close();
+
+  // Queue the mutation of an object
+  bool  CanInsert(CXObject* p_object);
+  void  Insert(CXObject* p_object);
+  void  Update(CXObject* p_object);
+  void  Delete(CXObject* p_object);
+
+  // Wait until everything is committed. Throws on earlier failures
+  void  Flush();
+
+  // GETTERS
+  CXWriteBehindMetrics  GetMetrics();
+  CXWriteBehindOptions& GetOptions();
+
+private:
+  typedef enum _wbAction
+  {
+    WB_INSERT
+   ,WB_UPDATE
+   ,WB_DELETE
+   ,WB_CANCELLED
+  }
+  WBAction;
+
+  // One table of the mutation
+  typedef struct _wbTable
+  {
+    XString                 m_table;        // DML name of the table
+    WordList                m_primary;      // Primary key columns
+    std::vector<XString>    m_columns;      // Columns of the table
+    std::vector<SQLVariant> m_values;       // Values of the object
+    std::vector<bool>       m_updatable;    // Set by an UPDATE
+  }
+  WBTable;
+
+  typedef struct _wbMutation
+  {
+    XString                 m_key;          // Class and primary key
+    WBAction                m_action  { WB_INSERT };
+    std::vector<WBTable>    m_tables;       // Super-tables first
+    ULONGLONG               m_queued  { 0 };
+    int                     m_attempts{ 0 };        // Failed attempts so far
+    bool                    m_done    { false };
+    XString                 m_error;
+  }
+  WBMutation;
+  using WBMutationPtr = std::shared_ptr<WBMutation>;
+
+  // Serialize an object into a new mutation
+  WBMutationPtr Serialize(CXObject* p_object,WBAction p_action);
+  void          SerializeTable(CXClass* p_class,CXClass* p_level,CXObject* p_object,bool p_root,WBTable& p_table);
+  XString       DMLTableName(CXClass* p_level);
+  // Put in the queue, or coalesce with a waiting mutation
+  void          Enqueue(WBMutationPtr p_mutation);
+  // Worker threads
+  static unsigned __stdcall RunWorker(void* p_writer);
+  void          Worker();
+  void          TakeBatch(std::vector<WBMutationPtr>& p_batch);
+  void          FlushBatch(std::vector<WBMutationPtr>& p_batch);
+  void          FailedBatch(std::vector<WBMutationPtr>& p_batch,XString p_error);
+  void          FlushTable(SQLDatabase* p_database,std::map<XString,SQLQuery*>& p_queries,WBAction p_action,WBTable& p_table);
+
+  CXSession*                    m_session  { nullptr };
+  CXWriteBehindOptions          m_options;
+  CXWriteBehindMetrics          m_metrics;
+  std::deque<WBMutationPtr>     m_queue;              // Mutations in order
+  std::map<XString,WBMutationPtr> m_pending;          // Waiting mutation per object
+  std::set<XString>             m_inflight;           // Objects in a running batch
+  std::map<CXClass*,XString>    m_names;              // DML name of each table
+  XString                       m_errors;             // Failures since the last flush
+  double                        m_latency  { 0.0 };   // Total latency of all flushed mutations
+  bool                          m_running  { false };
+  bool                          m_flushing { false };
+  HANDLE                        m_threads[CXWB_MAX_WORKERS];
+  int                           m_numThreads { 0 };
+  CRITICAL_SECTION              m_lock;
+  CONDITION_VARIABLE            m_notEmpty;
+  CONDITION_VARIABLE            m_notFull;
+  CONDITION_VARIABLE            m_committed;
+};
@@ -0,0 +1,618 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HPACK.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "HPACK.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// The static table of RFC 7541 Appendix A
+static const char* s_staticTable[HPACK_STATIC_ENTRIES][2] =
+{
+  { ":authority",                 ""               },  // 1
+  { ":method",                    "GET"            },  // 2
+  { ":method",                    "POST"           },  // 3
+  { ":path",                      "/"              },  // 4
+  { ":path",                      "/index.html"    },  // 5
+  { ":scheme",                    "http"           },  // 6
+  { ":scheme",                    "https"          },  // 7
+  { ":status",                    "200"            },  // 8
+  { ":status",                    "204"            },  // 9
+  { ":status",                    "206"            },  // 10
+  { ":status",                    "304"            },  // 11
+  { ":status",                    "400"            },  // 12
+  { ":status",                    "404"            },  // 13
+  { ":status",                    "500"            },  // 14
+  { "accept-charset",             ""               },  // 15
+  { "accept-encoding",            "gzip, deflate"  },  // 16
+  { "accept-language",            ""               },  // 17
+  { "accept-ranges",              ""               },  // 18
+  { "accept",                     ""               },  // 19
+  { "access-control-allow-origin",""               },  // 20
+  { "age",                        ""               },  // 21
+  { "allow",                      ""               },  // 22
+  { "authorization",              ""               },  // 23
+  { "cache-control",              ""               },  // 24
+  { "content-disposition",        ""               },  // 25
+  { "content-encoding",           ""               },  // 26
+  { "content-language",           ""               },  // 27
+  { "content-length",             ""               },  // 28
+  { "content-location",           ""               },  // 29
+  { "content-range",              ""               },  // 30
+  { "content-type",               ""               },  // 31
+  { "cookie",                     ""               },  // 32
+  { "date",                       ""               },  // 33
+  { "etag",                       ""               },  // 34
+  { "expect",                     ""               },  // 35
+  { "expires",                    ""               },  // 36
+  { "from",                       ""               },  // 37
+  { "host",                       ""               },  // 38
+  { "if-match",                   ""               },  // 39
+  { "if-modified-since",          ""               },  // 40
+  { "if-none-match",              ""               },  // 41
+  { "if-range",                   ""               },  // 42
+  { "if-unmodified-since",        ""               },  // 43
+  { "last-modified",              ""               },  // 44
+  { "link",                       ""               },  // 45
+  { "location",                   ""               },  // 46
+  { "max-forwards",               ""               },  // 47
+  { "proxy-authenticate",         ""               },  // 48
+  { "proxy-authorization",        ""               },  // 49
+  { "range",                      ""               },  // 50
+  { "referer",                    ""               },  // 51
+  { "refresh",                    ""               },  // 52
+  { "retry-after",                ""               },  // 53
+  { "server",                     ""               },  // 54
+  { "set-cookie",                 ""               },  // 55
+  { "strict-transport-security",  ""               },  // 56
+  { "transfer-encoding",          ""               },  // 57
+  { "user-agent",                 ""               },  // 58
+  { "vary",                       ""               },  // 59
+  { "via",                        ""               },  // 60
+  { "www-authenticate",           ""               }   // 61
+};
+
+// The Huffman code of RFC 7541 Appendix B: code and length in bits
+// The last entry is the End-Of-String symbol
+typedef struct _huffmanCode
+{
+  unsigned m_code;
+  int      m_bits;
+}
+HuffmanCode;
+
+static const HuffmanCode s_huffman[257] =
+{
+  {0x00001ff8,13},{0x007fffd8,23},{0x0fffffe2,28},{0x0fffffe3,28},{0x0fffffe4,28},{0x0fffffe5,28},{0x0fffffe6,28},{0x0fffffe7,28},
+  {0x0fffffe8,28},{0x00ffffea,24},{0x3ffffffc,30},{0x0fffffe9,28},{0x0fffffea,28},{0x3ffffffd,30},{0x0fffffeb,28},{0x0fffffec,28},
+  {0x0fffffed,28},{0x0fffffee,28},{0x0fffffef,28},{0x0ffffff0,28},{0x0ffffff1,28},{0x0ffffff2,28},{0x3ffffffe,30},{0x0ffffff3,28},
+  {0x0ffffff4,28},{0x0ffffff5,28},{0x0ffffff6,28},{0x0ffffff7,28},{0x0ffffff8,28},{0x0ffffff9,28},{0x0ffffffa,28},{0x0ffffffb,28},
+  {0x00000014, 6},{0x000003f8,10},{0x000003f9,10},{0x00000ffa,12},{0x00001ff9,13},{0x00000015, 6},{0x000000f8, 8},{0x000007fa,11},
+  {0x000003fa,10},{0x000003fb,10},{0x000000f9, 8},{0x000007fb,11},{0x000000fa, 8},{0x00000016, 6},{0x00000017, 6},{0x00000018, 6},
+  {0x00000000, 5},{0x00000001, 5},{0x00000002, 5},{0x00000019, 6},{0x0000001a, 6},{0x0000001b, 6},{0x0000001c, 6},{0x0000001d, 6},
+  {0x0000001e, 6},{0x0000001f, 6},{0x0000005c, 7},{0x000000fb, 8},{0x00007ffc,15},{0x00000020, 6},{0x00000ffb,12},{0x000003fc,10},
+  {0x00001ffa,13},{0x00000021, 6},{0x0000005d, 7},{0x0000005e, 7},{0x0000005f, 7},{0x00000060, 7},{0x00000061, 7},{0x00000062, 7},
+  {0x00000063, 7},{0x00000064, 7},{0x00000065, 7},{0x00000066, 7},{0x00000067, 7},{0x00000068, 7},{0x00000069, 7},{0x0000006a, 7},
+  {0x0000006b, 7},{0x0000006c, 7},{0x0000006d, 7},{0x0000006e, 7},{0x0000006f, 7},{0x00000070, 7},{0x00000071, 7},{0x00000072, 7},
+  {0x000000fc, 8},{0x00000073, 7},{0x000000fd, 8},{0x00001ffb,13},{0x0007fff0,19},{0x00001ffc,13},{0x00003ffc,14},{0x00000022, 6},
+  {0x00007ffd,15},{0x00000003, 5},{0x00000023, 6},{0x00000004, 5},{0x00000024, 6},{0x00000005, 5},{0x00000025, 6},{0x00000026, 6},
+  {0x00000027, 6},{0x00000006, 5},{0x00000074, 7},{0x00000075, 7},{0x00000028, 6},{0x00000029, 6},{0x0000002a, 6},{0x00000007, 5},
+  {0x0000002b, 6},{0x00000076, 7},{0x0000002c, 6},{0x00000008, 5},{0x00000009, 5},{0x0000002d, 6},{0x00000077, 7},{0x00000078, 7},
+  {0x00000079, 7},{0x0000007a, 7},{0x0000007b, 7},{0x00007ffe,15},{0x000007fc,11},{0x00003ffd,14},{0x00001ffd,13},{0x0ffffffc,28},
+  {0x000fffe6,20},{0x003fffd2,22},{0x000fffe7,20},{0x000fffe8,20},{0x003fffd3,22},{0x003fffd4,22},{0x003fffd5,22},{0x007fffd9,23},
+  {0x003fffd6,22},{0x007fffda,23},{0x007fffdb,23},{0x007fffdc,23},{0x007fffdd,23},{0x007fffde,23},{0x00ffffeb,24},{0x007fffdf,23},
+  {0x00ffffec,24},{0x00ffffed,24},{0x003fffd7,22},{0x007fffe0,23},{0x00ffffee,24},{0x007fffe1,23},{0x007fffe2,23},{0x007fffe3,23},
+  {0x007fffe4,23},{0x001fffdc,21},{0x003fffd8,22},{0x007fffe5,23},{0x003fffd9,22},{0x007fffe6,23},{0x007fffe7,23},{0x00ffffef,24},
+  {0x003fffda,22},{0x001fffdd,21},{0x000fffe9,20},{0x003fffdb,22},{0x003fffdc,22},{0x007fffe8,23},{0x007fffe9,23},{0x001fffde,21},
+  {0x007fffea,23},{0x003fffdd,22},{0x003fffde,22},{0x00fffff0,24},{0x001fffdf,21},{0x003fffdf,22},{0x007fffeb,23},{0x007fffec,23},
+  {0x001fffe0,21},{0x001fffe1,21},{0x003fffe0,22},{0x001fffe2,21},{0x007fffed,23},{0x003fffe1,22},{0x007fffee,23},{0x007fffef,23},
+  {0x000fffea,20},{0x003fffe2,22},{0x003fffe3,22},{0x003fffe4,22},{0x007ffff0,23},{0x003fffe5,22},{0x003fffe6,22},{0x007ffff1,23},
+  {0x03ffffe0,26},{0x03ffffe1,26},{0x000fffeb,20},{0x0007fff1,19},{0x003fffe7,22},{0x007ffff2,23},{0x003fffe8,22},{0x01ffffec,25},
+  {0x03ffffe2,26},{0x03ffffe3,26},{0x03ffffe4,26},{0x07ffffde,27},{0x07ffffdf,27},{0x03ffffe5,26},{0x00fffff1,24},{0x01ffffed,25},
+  {0x0007fff2,19},{0x001fffe3,21},{0x03ffffe6,26},{0x07ffffe0,27},{0x07ffffe1,27},{0x03ffffe7,26},{0x07ffffe2,27},{0x00fffff2,24},
+  {0x001fffe4,21},{0x001fffe5,21},{0x03ffffe8,26},{0x03ffffe9,26},{0x0ffffffd,28},{0x07ffffe3,27},{0x07ffffe4,27},{0x07ffffe5,27},
+  {0x000fffec,20},{0x00fffff3,24},{0x000fffed,20},{0x001fffe6,21},{0x003fffe9,22},{0x001fffe7,21},{0x001fffe8,21},{0x007ffff3,23},
+  {0x003fffea,22},{0x003fffeb,22},{0x01ffffee,25},{0x01ffffef,25},{0x00fffff4,24},{0x00fffff5,24},{0x03ffffea,26},{0x007ffff4,23},
+  {0x03ffffeb,26},{0x07ffffe6,27},{0x03ffffec,26},{0x03ffffed,26},{0x07ffffe7,27},{0x07ffffe8,27},{0x07ffffe9,27},{0x07ffffea,27},
+  {0x07ffffeb,27},{0x0ffffffe,28},{0x07ffffec,27},{0x07ffffed,27},{0x07ffffee,27},{0x07ffffef,27},{0x07fffff0,27},{0x03ffffee,26},
+  {0x3fffffff,30}
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PRIMITIVES
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Integer with an N-bit prefix (RFC 7541 5.1)
+bool
+HPACKDecodeInteger(const unsigned char*& p_pos,const unsigned char* p_end,int p_prefix,size_t& p_value)
+{
+  if(p_pos >= p_end)
+  {
+    return false;
+  }
+  size_t mask = ((size_t)1 << p_prefix) - 1;
+  p_value = *p_pos++ & mask;
+  if(p_value < mask)
+  {
+    return true;
+  }
+  int shift = 0;
+  while(p_pos < p_end)
+  {
+    unsigned char byte = *p_pos++;
+    if(shift > 28)
+    {
+      // Larger than any sane header or table
+      return false;
+    }
+    p_value += (size_t)(byte & 0x7F) << shift;
+    shift   += 7;
+    if((byte & 0x80) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+HPACKEncodeInteger(std::string& p_block,unsigned char p_first,int p_prefix,size_t p_value)
+{
+  size_t mask = ((size_t)1 << p_prefix) - 1;
+  if(p_value < mask)
+  {
+    p_block += (char)(p_first | (unsigned char)p_value);
+    return;
+  }
+  p_block += (char)(p_first | (unsigned char)mask);
+  p_value -= mask;
+  while(p_value >= 0x80)
+  {
+    p_block += (char)((p_value & 0x7F) | 0x80);
+    p_value >>= 7;
+  }
+  p_block += (char)p_value;
+}
+
+// Binary decoding tree of the Huffman code, built once
+class HuffmanTree
+{
+public:
+  HuffmanTree()
+  {
+    memset(m_next,0,sizeof(m_next));
+    for(int node = 0; node < HUFFMAN_NODES; ++node)
+    {
+      m_symbol[node] = -1;
+    }
+    for(int symbol = 0; symbol < 257; ++symbol)
+    {
+      int node = 0;
+      for(int bit = s_huffman[symbol].m_bits - 1; bit >= 0; --bit)
+      {
+        int branch = (s_huffman[symbol].m_code >> bit) & 1;
+        if(m_next[node][branch] == 0)
+        {
+          m_next[node][branch] = (short)m_nodes++;
+        }
+        node = m_next[node][branch];
+      }
+      m_symbol[node] = (short)symbol;
+    }
+  }
+  static const int HUFFMAN_NODES = 513;
+
+  short m_next[HUFFMAN_NODES][2];   // Zero is 'no branch': the root is never a child
+  short m_symbol[HUFFMAN_NODES];
+  int   m_nodes { 1 };
+};
+
+bool
+HPACKHuffmanDecode(const unsigned char* p_data,size_t p_length,std::string& p_string)
+{
+  static const HuffmanTree tree;
+
+  int  node    = 0;
+  int  padding = 0;       // Bits since the last symbol
+  bool ones    = true;    // Padding must be the most significant bits of EOS
+  for(size_t index = 0; index < p_length; ++index)
+  {
+    for(int bit = 7; bit >= 0; --bit)
+    {
+      int branch = (p_data[index] >> bit) & 1;
+      node = tree.m_next[node][branch];
+      if(node == 0)
+      {
+        return false;
+      }
+      ++padding;
+      ones &= (branch == 1);
+      short symbol = tree.m_symbol[node];
+      if(symbol >= 0)
+      {
+        if(symbol == 256)
+        {
+          // EOS in a string is an error
+          return false;
+        }
+        p_string += (char)symbol;
+        node    = 0;
+        padding = 0;
+        ones    = true;
+      }
+    }
+  }
+  return padding < 8 && ones;
+}
+
+size_t
+HPACKHuffmanLength(const std::string& p_string)
+{
+  size_t bits = 0;
+  for(auto& ch : p_string)
+  {
+    bits += s_huffman[(unsigned char)ch].m_bits;
+  }
+  return (bits + 7) / 8;
+}
+
+void
+HPACKHuffmanEncode(const std::string& p_string,std::string& p_block)
+{
+  unsigned long long buffer = 0;
+  int bits = 0;
+  for(auto& ch : p_string)
+  {
+    const HuffmanCode& code = s_huffman[(unsigned char)ch];
+    buffer = (buffer << code.m_bits) | code.m_code;
+    bits  += code.m_bits;
+    while(bits >= 8)
+    {
+      bits -= 8;
+      p_block += (char)(buffer >> bits);
+    }
+  }
+  if(bits > 0)
+  {
+    // Pad with the most significant bits of EOS (all ones)
+    p_block += (char)((buffer << (8 - bits)) | (0xFF >> bits));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE TABLE
+//
+//////////////////////////////////////////////////////////////////////////
+
+size_t
+HPACKTable::Find(const std::string& p_name,const std::string& p_value,bool& p_exact) const
+{
+  size_t nameIndex = 0;
+  p_exact = false;
+  for(size_t index = 0; index < HPACK_STATIC_ENTRIES; ++index)
+  {
+    if(p_name == s_staticTable[index][0])
+    {
+      if(p_value == s_staticTable[index][1])
+      {
+        p_exact = true;
+        return index + 1;
+      }
+      if(nameIndex == 0)
+      {
+        nameIndex = index + 1;
+      }
+    }
+  }
+  for(size_t index = 0; index < m_entries.size(); ++index)
+  {
+    if(p_name == m_entries[index].first)
+    {
+      if(p_value == m_entries[index].second)
+      {
+        p_exact = true;
+        return index + HPACK_STATIC_ENTRIES + 1;
+      }
+      if(nameIndex == 0)
+      {
+        nameIndex = index + HPACK_STATIC_ENTRIES + 1;
+      }
+    }
+  }
+  return nameIndex;
+}
+
+bool
+HPACKTable::Get(size_t p_index,HPACKHeader& p_header) const
+{
+  if(p_index == 0)
+  {
+    return false;
+  }
+  if(p_index <= HPACK_STATIC_ENTRIES)
+  {
+    p_header.first  = s_staticTable[p_index - 1][0];
+    p_header.second = s_staticTable[p_index - 1][1];
+    return true;
+  }
+  p_index -= HPACK_STATIC_ENTRIES + 1;
+  if(p_index >= m_entries.size())
+  {
+    return false;
+  }
+  p_header = m_entries[p_index];
+  return true;
+}
+
+void
+HPACKTable::Add(const std::string& p_name,const std::string& p_value)
+{
+  size_t size = p_name.size() + p_value.size() + HPACK_ENTRY_OVERHEAD;
+  if(size > m_maxSize)
+  {
+    // Larger than the table: the table becomes empty (RFC 7541 4.4)
+    m_entries.clear();
+    m_size = 0;
+    return;
+  }
+  m_entries.push_front(HPACKHeader(p_name,p_value));
+  m_size += size;
+  Evict();
+}
+
+void
+HPACKTable::SetMaximumSize(size_t p_size)
+{
+  m_maxSize = p_size;
+  Evict();
+}
+
+void
+HPACKTable::Evict()
+{
+  while(m_size > m_maxSize && !m_entries.empty())
+  {
+    HPACKHeader& last = m_entries.back();
+    m_size -= last.first.size() + last.second.size() + HPACK_ENTRY_OVERHEAD;
+    m_entries.pop_back();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE DECODER
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+HPACKDecoder::Decode(const unsigned char* p_data,size_t p_length,HPACKHeaders& p_headers)
+{
+  const unsigned char* pos = p_data;
+  const unsigned char* end = p_data + p_length;
+  size_t index    = 0;
+  size_t listSize = 0;
+  m_tooLarge      = false;
+
+  while(pos < end)
+  {
+    unsigned char first = *pos;
+    if(first & 0x80)
+    {
+      // Indexed header field
+      HPACKHeader header;
+      if(!HPACKDecodeInteger(pos,end,7,index) || !m_table.Get(index,header) ||
+         !AddHeader(p_headers,header,listSize))
+      {
+        return false;
+      }
+      continue;
+    }
+    if((first & 0xE0) == 0x20)
+    {
+      // Dynamic table size update
+      if(!HPACKDecodeInteger(pos,end,5,index) || index > m_settingsSize)
+      {
+        return false;
+      }
+      m_table.SetMaximumSize(index);
+      continue;
+    }
+    // Literal: with incremental indexing (6 bits), without or never indexed (4 bits)
+    bool incremental = (first & 0xC0) == 0x40;
+    HPACKHeader header;
+    if(!HPACKDecodeInteger(pos,end,incremental ? 6 : 4,index))
+    {
+      return false;
+    }
+    if(index)
+    {
+      if(!m_table.Get(index,header))
+      {
+        return false;
+      }
+    }
+    else if(!DecodeString(pos,end,header.first))
+    {
+      return false;
+    }
+    header.second.clear();
+    if(!DecodeString(pos,end,header.second))
+    {
+      return false;
+    }
+    if(incremental)
+    {
+      m_table.Add(header.first,header.second);
+    }
+    if(!AddHeader(p_headers,header,listSize))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Count the size of the list while decoding. A small block of indexed
+// references to a large table entry would otherwise expand to a huge list.
+bool
+HPACKDecoder::AddHeader(HPACKHeaders& p_headers,HPACKHeader& p_header,size_t& p_listSize)
+{
+  p_listSize += p_header.first.size() + p_header.second.size() + HPACK_ENTRY_OVERHEAD;
+  if(m_maxListSize && p_listSize > m_maxListSize)
+  {
+    m_tooLarge = true;
+    return false;
+  }
+  p_headers.push_back(std::move(p_header));
+  return true;
+}
+
+bool
+HPACKDecoder::DecodeString(const unsigned char*& p_pos,const unsigned char* p_end,std::string& p_string)
+{
+  if(p_pos >= p_end)
+  {
+    return false;
+  }
+  bool   huffman = (*p_pos & 0x80) != 0;
+  size_t length  = 0;
+  if(!HPACKDecodeInteger(p_pos,p_end,7,length) || length > (size_t)(p_end - p_pos))
+  {
+    return false;
+  }
+  bool result = true;
+  if(huffman)
+  {
+    result = HPACKHuffmanDecode(p_pos,length,p_string);
+  }
+  else
+  {
+    p_string.assign((const char*)p_pos,length);
+  }
+  p_pos += length;
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE ENCODER
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Headers that change with every message are not worth a table entry
+static bool
+HPACKVolatile(const std::string& p_name)
+{
+  return p_name == "date"           ||
+         p_name == "content-length" ||
+         p_name == "etag"           ||
+         p_name == "last-modified"  ||
+         p_name == ":path";
+}
+
+// Secrets must never be indexed by an intermediary (RFC 7541 7.1.3)
+static bool
+HPACKSensitive(const std::string& p_name)
+{
+  return p_name == "authorization"       ||
+         p_name == "proxy-authorization" ||
+         p_name == "cookie"              ||
+         p_name == "set-cookie";
+}
+
+void
+HPACKEncoder::SetSettingsSize(size_t p_size)
+{
+  // Keep our table within the limit of the peer
+  m_pendingSize = p_size < HPACK_DEFAULT_TABLESIZE ? p_size : HPACK_DEFAULT_TABLESIZE;
+  m_sizeUpdate  = m_pendingSize != m_table.GetMaximumSize();
+}
+
+void
+HPACKEncoder::Encode(const HPACKHeaders& p_headers,std::string& p_block)
+{
+  if(m_sizeUpdate)
+  {
+    HPACKEncodeInteger(p_block,0x20,5,m_pendingSize);
+    m_table.SetMaximumSize(m_pendingSize);
+    m_sizeUpdate = false;
+  }
+  for(auto& header : p_headers)
+  {
+    bool   exact = false;
+    size_t index = m_table.Find(header.first,header.second,exact);
+    if(exact && !HPACKSensitive(header.first))
+    {
+      HPACKEncodeInteger(p_block,0x80,7,index);
+      continue;
+    }
+    if(HPACKSensitive(header.first))
+    {
+      HPACKEncodeInteger(p_block,0x10,4,index);
+    }
+    else if(HPACKVolatile(header.first))
+    {
+      HPACKEncodeInteger(p_block,0x00,4,index);
+    }
+    else
+    {
+      HPACKEncodeInteger(p_block,0x40,6,index);
+      m_table.Add(header.first,header.second);
+    }
+    if(index == 0)
+    {
+      EncodeString(header.first,p_block);
+    }
+    EncodeString(header.second,p_block);
+  }
+}
+
+// Huffman coded if that is shorter
+void
+HPACKEncoder::EncodeString(const std::string& p_string,std::string& p_block)
+{
+  size_t huffman = HPACKHuffmanLength(p_string);
+  if(huffman < p_string.size())
+  {
+    HPACKEncodeInteger(p_block,0x80,7,huffman);
+    HPACKHuffmanEncode(p_string,p_block);
+  }
+  else
+  {
+    HPACKEncodeInteger(p_block,0x00,7,p_string.size());
+    p_block += p_string;
+  }
+}
@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HPACK.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+
+// HPACK: Header compression for HTTP/2 (RFC 7541)
+// The static table, the dynamic table and the Huffman code.
+// One encoder and one decoder per direction of a HTTP/2 connection.
+// Both are NOT thread safe: the HTTP/2 session serializes their use.
+
+#define HPACK_DEFAULT_TABLESIZE  4096   // SETTINGS_HEADER_TABLE_SIZE default
+#define HPACK_ENTRY_OVERHEAD       32   // Per entry in the dynamic table
+#define HPACK_STATIC_ENTRIES       61   // Entries of the static table
+
+using HPACKHeader  = std::pair<std::string,std::string>;
+using HPACKHeaders = std::vector<HPACKHeader>;
+
+// The dynamic table, newest entry first
+class HPACKTable
+{
+public:
+  // Find an entry. Returns the HPACK index (0 = not found) and if the value matched
+  size_t Find(const std::string& p_name,const std::string& p_value,bool& p_exact) const;
+  // Getting an entry by HPACK index (static + dynamic)
+  bool   Get(size_t p_index,HPACKHeader& p_header) const;
+  // Add a new entry, evicting the oldest
+  void   Add(const std::string& p_name,const std::string& p_value);
+  // New maximum size, evicting as needed
+  void   SetMaximumSize(size_t p_size);
+
+  size_t GetSize()          { return m_size;    }
+  size_t GetMaximumSize()   { return m_maxSize; }
+
+private:
+  void   Evict();
+
+  std::deque<HPACKHeader> m_entries;
+  size_t                  m_size    { 0 };
+  size_t                  m_maxSize { HPACK_DEFAULT_TABLESIZE };
+};
+
+class HPACKDecoder
+{
+public:
+  // Decode a complete header block. False on a compression error
+  // or as soon as the header list grows larger than the maximum list size.
+  bool Decode(const unsigned char* p_data,size_t p_length,HPACKHeaders& p_headers);
+  // Our SETTINGS_HEADER_TABLE_SIZE: upper limit for size updates of the peer
+  void SetSettingsSize(size_t p_size) { m_settingsSize = p_size; }
+  // Our SETTINGS_MAX_HEADER_LIST_SIZE: name + value + 32 per header (0 = no limit)
+  void SetMaximumListSize(size_t p_size) { m_maxListSize = p_size; }
+  // Last Decode failed on the maximum list size
+  bool GetListTooLarge()               { return m_tooLarge;     }
+
+private:
+  bool DecodeString(const unsigned char*& p_pos,const unsigned char* p_end,std::string& p_string);
+  bool AddHeader(HPACKHeaders& p_headers,HPACKHeader& p_header,size_t& p_listSize);
+
+  HPACKTable m_table;
+  size_t     m_settingsSize { HPACK_DEFAULT_TABLESIZE };
+  size_t     m_maxListSize  { 0 };
+  bool       m_tooLarge     { false };
+};
+
+class HPACKEncoder
+{
+public:
+  // Encode a header block. Names must be in lower case
+  void Encode(const HPACKHeaders& p_headers,std::string& p_block);
+  // SETTINGS_HEADER_TABLE_SIZE of the peer
+  void SetSettingsSize(size_t p_size);
+
+private:
+  void EncodeString(const std::string& p_string,std::string& p_block);
+
+  HPACKTable m_table;
+  size_t     m_pendingSize { 0 };     // Size update for the next header block
+  bool       m_sizeUpdate  { false };
+};
+
+// Integer and Huffman primitives, also used by the HTTP/2 client
+bool   HPACKDecodeInteger(const unsigned char*& p_pos,const unsigned char* p_end,int p_prefix,size_t& p_value);
+void   HPACKEncodeInteger(std::string& p_block,unsigned char p_first,int p_prefix,size_t p_value);
+bool   HPACKHuffmanDecode(const unsigned char* p_data,size_t p_length,std::string& p_string);
+void   HPACKHuffmanEncode(const std::string& p_string,std::string& p_block);
+size_t HPACKHuffmanLength(const std::string& p_string);
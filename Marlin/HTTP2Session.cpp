@@ -0,0 +1,1043 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTP2Session.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "HTTP2Session.h"
+#include "HTTPError.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Network byte order helpers
+static void
+Put16(std::string& p_output,unsigned p_value)
+{
+  p_output += (char)((p_value >>  8) & 0xFF);
+  p_output += (char)( p_value        & 0xFF);
+}
+
+static void
+Put32(std::string& p_output,unsigned p_value)
+{
+  p_output += (char)((p_value >> 24) & 0xFF);
+  p_output += (char)((p_value >> 16) & 0xFF);
+  p_output += (char)((p_value >>  8) & 0xFF);
+  p_output += (char)( p_value        & 0xFF);
+}
+
+static unsigned
+Get16(const unsigned char* p_data)
+{
+  return ((unsigned)p_data[0] << 8) | p_data[1];
+}
+
+static unsigned
+Get32(const unsigned char* p_data)
+{
+  return ((unsigned)p_data[0] << 24) | ((unsigned)p_data[1] << 16) | ((unsigned)p_data[2] << 8) | p_data[3];
+}
+
+// Connection specific headers do not exist in HTTP/2 (RFC 9113 8.2.2)
+static bool
+ConnectionHeader(const std::string& p_name)
+{
+  return p_name == "connection"       ||
+         p_name == "keep-alive"       ||
+         p_name == "proxy-connection" ||
+         p_name == "transfer-encoding"||
+         p_name == "upgrade";
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// FRAMES
+//
+//////////////////////////////////////////////////////////////////////////
+
+void
+HTTP2Session::WriteFrame(std::string&  p_output
+                        ,unsigned char p_type
+                        ,unsigned char p_flags
+                        ,unsigned      p_stream
+                        ,const char*   p_payload
+                        ,size_t        p_length)
+{
+  p_output += (char)((p_length >> 16) & 0xFF);
+  p_output += (char)((p_length >>  8) & 0xFF);
+  p_output += (char)( p_length        & 0xFF);
+  p_output += (char)p_type;
+  p_output += (char)p_flags;
+  Put32(p_output,p_stream & 0x7FFFFFFF);
+  if(p_length)
+  {
+    p_output.append(p_payload,p_length);
+  }
+}
+
+// Read the frame header at a position. False if not yet complete
+bool
+HTTP2Session::ReadFrame(const std::string& p_input,size_t p_position,HTTP2Frame& p_frame)
+{
+  if(p_input.size() < p_position + HTTP2_FRAME_HEADER)
+  {
+    return false;
+  }
+  const unsigned char* header = reinterpret_cast<const unsigned char*>(p_input.data()) + p_position;
+  p_frame.m_length = ((unsigned)header[0] << 16) | ((unsigned)header[1] << 8) | header[2];
+  p_frame.m_type   = header[3];
+  p_frame.m_flags  = header[4];
+  p_frame.m_stream = Get32(header + 5) & 0x7FFFFFFF;
+  return true;
+}
+
+void
+HTTP2Session::WriteWindowUpdate(std::string& p_output,unsigned p_stream,unsigned p_increment)
+{
+  std::string payload;
+  Put32(payload,p_increment & 0x7FFFFFFF);
+  WriteFrame(p_output,HTTP2_WINDOW_UPDATE,0,p_stream,payload.data(),payload.size());
+}
+
+void
+HTTP2Session::WriteRstStream(std::string& p_output,unsigned p_stream,unsigned p_error)
+{
+  std::string payload;
+  Put32(payload,p_error);
+  WriteFrame(p_output,HTTP2_RST_STREAM,0,p_stream,payload.data(),payload.size());
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE SESSION
+//
+//////////////////////////////////////////////////////////////////////////
+
+HTTP2Session::HTTP2Session()
+{
+  m_decoder.SetSettingsSize(HPACK_DEFAULT_TABLESIZE);
+  m_decoder.SetMaximumListSize(HTTPCONNECTION_MAXHEADER);
+}
+
+void
+HTTP2Session::Start(std::string& p_output)
+{
+  std::string settings;
+  Put16(settings,HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+  Put32(settings,HTTP2_MAX_STREAMS);
+  Put16(settings,HTTP2_SETTINGS_INITIAL_WINDOW_SIZE);
+  Put32(settings,HTTP2_STREAM_WINDOW);
+  Put16(settings,HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE);
+  Put32(settings,HTTPCONNECTION_MAXHEADER);
+  WriteFrame(p_output,HTTP2_SETTINGS,0,0,settings.data(),settings.size());
+
+  // The connection window can only be changed by a WINDOW_UPDATE
+  WriteWindowUpdate(p_output,0,HTTP2_CONNECTION_WINDOW - HTTP2_DEFAULT_WINDOW);
+}
+
+bool
+HTTP2Session::ProcessInput(std::string& p_input,HTTP2Requests& p_requests,std::string& p_output)
+{
+  size_t position = 0;
+  if(!m_prefaceSeen)
+  {
+    if(p_input.size() < HTTP2_PREFACE_LENGTH)
+    {
+      return true;
+    }
+    if(p_input.compare(0,HTTP2_PREFACE_LENGTH,HTTP2_PREFACE) != 0)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    m_prefaceSeen = true;
+    position = HTTP2_PREFACE_LENGTH;
+  }
+
+  bool result = true;
+  HTTP2Frame frame;
+  while(result && ReadFrame(p_input,position,frame))
+  {
+    // We never announce a larger SETTINGS_MAX_FRAME_SIZE
+    if(frame.m_length > HTTP2_DEFAULT_FRAMESIZE)
+    {
+      result = Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+      break;
+    }
+    if(p_input.size() - position < HTTP2_FRAME_HEADER + frame.m_length)
+    {
+      break;
+    }
+    const unsigned char* payload = reinterpret_cast<const unsigned char*>(p_input.data()) + position + HTTP2_FRAME_HEADER;
+    position += HTTP2_FRAME_HEADER + frame.m_length;
+
+    // A header block cannot be interrupted. The first frame must be our SETTINGS
+    if((m_headerStream && frame.m_type != HTTP2_CONTINUATION) ||
+       (!m_settingsSeen && frame.m_type != HTTP2_SETTINGS))
+    {
+      result = Fail(HTTP2_PROTOCOL_ERROR,p_output);
+      break;
+    }
+    switch(frame.m_type)
+    {
+      case HTTP2_SETTINGS:      result = OnSettings    (frame,payload,p_output);            break;
+      case HTTP2_PING:          result = OnPing        (frame,payload,p_output);            break;
+      case HTTP2_HEADERS:       result = OnHeaders     (frame,payload,p_requests,p_output); break;
+      case HTTP2_CONTINUATION:  result = OnContinuation(frame,payload,p_requests,p_output); break;
+      case HTTP2_DATA:          result = OnData        (frame,payload,p_requests,p_output); break;
+      case HTTP2_RST_STREAM:    result = OnRstStream   (frame,payload,p_output);            break;
+      case HTTP2_WINDOW_UPDATE: result = OnWindowUpdate(frame,payload,p_output);            break;
+      case HTTP2_PRIORITY:      // Priority signals are ignored. Streams are answered when ready
+                                if(frame.m_length != 5)
+                                {
+                                  result = Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+                                }
+                                break;
+      case HTTP2_PUSH_PROMISE:  // Only a server can push
+                                result = Fail(HTTP2_PROTOCOL_ERROR,p_output);
+                                break;
+      case HTTP2_GOAWAY:        // Client opens no more streams. Ours get finished
+      default:                  // Unknown frame types must be ignored
+                                break;
+    }
+  }
+  p_input.erase(0,position);
+  return result;
+}
+
+void
+HTTP2Session::GoAway(unsigned p_error,std::string& p_output)
+{
+  if(!m_goingAway)
+  {
+    m_goingAway    = true;
+    m_goAwayStream = m_lastStream;
+  }
+  std::string payload;
+  Put32(payload,m_goAwayStream);
+  Put32(payload,p_error);
+  WriteFrame(p_output,HTTP2_GOAWAY,0,0,payload.data(),payload.size());
+}
+
+// Response bytes of all streams that wait for translation or the flow control window
+size_t
+HTTP2Session::GetPendingBytes()
+{
+  size_t pending = 0;
+  for(auto& stream : m_streams)
+  {
+    pending += stream.second.m_response.size();
+    pending += stream.second.m_pending.size() - stream.second.m_pendingPos;
+  }
+  return pending;
+}
+
+bool
+HTTP2Session::Fail(unsigned p_error,std::string& p_output)
+{
+  GoAway(p_error,p_output);
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// INCOMING FRAMES
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+HTTP2Session::OnSettings(const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output)
+{
+  if(p_frame.m_stream != 0)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  if(p_frame.m_flags & HTTP2_FLAG_ACK)
+  {
+    return p_frame.m_length == 0 ? true : Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+  }
+  if(p_frame.m_length % 6)
+  {
+    return Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+  }
+  for(unsigned index = 0; index < p_frame.m_length; index += 6)
+  {
+    unsigned setting = Get16(p_payload + index);
+    unsigned value   = Get32(p_payload + index + 2);
+    switch(setting)
+    {
+      case HTTP2_SETTINGS_HEADER_TABLE_SIZE:
+        m_encoder.SetSettingsSize(value);
+        break;
+      case HTTP2_SETTINGS_ENABLE_PUSH:
+        if(value > 1)
+        {
+          return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+        }
+        break;
+      case HTTP2_SETTINGS_INITIAL_WINDOW_SIZE:
+        if(value > HTTP2_MAX_WINDOW)
+        {
+          return Fail(HTTP2_FLOW_CONTROL_ERROR,p_output);
+        }
+        // Applies to the windows of all open streams (RFC 9113 6.9.2)
+        for(auto& stream : m_streams)
+        {
+          stream.second.m_sendWindow += (long long)value - m_initialWindow;
+          if(stream.second.m_sendWindow > HTTP2_MAX_WINDOW)
+          {
+            return Fail(HTTP2_FLOW_CONTROL_ERROR,p_output);
+          }
+        }
+        m_initialWindow = value;
+        break;
+      case HTTP2_SETTINGS_MAX_FRAME_SIZE:
+        if(value < HTTP2_DEFAULT_FRAMESIZE || value > HTTP2_MAX_FRAMESIZE)
+        {
+          return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+        }
+        m_maxFrameSize = value;
+        break;
+      default:
+        // MAX_CONCURRENT_STREAMS: we never push
+        // MAX_HEADER_LIST_SIZE:   advisory only
+        break;
+    }
+  }
+  m_settingsSeen = true;
+  WriteFrame(p_output,HTTP2_SETTINGS,HTTP2_FLAG_ACK,0,nullptr,0);
+
+  // Windows could have grown
+  FlushAll(p_output);
+  return true;
+}
+
+bool
+HTTP2Session::OnPing(const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output)
+{
+  if(p_frame.m_length != 8)
+  {
+    return Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+  }
+  if(p_frame.m_stream != 0)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  if((p_frame.m_flags & HTTP2_FLAG_ACK) == 0)
+  {
+    WriteFrame(p_output,HTTP2_PING,HTTP2_FLAG_ACK,0,reinterpret_cast<const char*>(p_payload),8);
+  }
+  return true;
+}
+
+bool
+HTTP2Session::OnHeaders(const HTTP2Frame&    p_frame
+                       ,const unsigned char* p_payload
+                       ,HTTP2Requests&       p_requests
+                       ,std::string&         p_output)
+{
+  if(p_frame.m_stream == 0)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  const unsigned char* data   = p_payload;
+  size_t               length = p_frame.m_length;
+  size_t               padding = 0;
+  if(p_frame.m_flags & HTTP2_FLAG_PADDED)
+  {
+    if(length < 1)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    padding = *data++;
+    --length;
+  }
+  if(p_frame.m_flags & HTTP2_FLAG_PRIORITY)
+  {
+    if(length < 5)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    data   += 5;
+    length -= 5;
+  }
+  if(padding > length)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  length -= padding;
+
+  // A new stream must have a higher odd id. An open stream gets its trailers
+  if(m_streams.find(p_frame.m_stream) == m_streams.end())
+  {
+    if((p_frame.m_stream & 1) == 0 || p_frame.m_stream <= m_lastStream)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    m_lastStream = p_frame.m_stream;
+  }
+  m_headerStream = p_frame.m_stream;
+  m_headerEnd    = (p_frame.m_flags & HTTP2_FLAG_END_STREAM) != 0;
+  m_headerBlock.assign(reinterpret_cast<const char*>(data),length);
+
+  if(p_frame.m_flags & HTTP2_FLAG_END_HEADERS)
+  {
+    return CompleteHeaders(p_requests,p_output);
+  }
+  return true;
+}
+
+bool
+HTTP2Session::OnContinuation(const HTTP2Frame&    p_frame
+                            ,const unsigned char* p_payload
+                            ,HTTP2Requests&       p_requests
+                            ,std::string&         p_output)
+{
+  if(m_headerStream == 0 || p_frame.m_stream != m_headerStream)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  m_headerBlock.append(reinterpret_cast<const char*>(p_payload),p_frame.m_length);
+  if(m_headerBlock.size() > 4 * HTTPCONNECTION_MAXHEADER)
+  {
+    return Fail(HTTP2_ENHANCE_YOUR_CALM,p_output);
+  }
+  if(p_frame.m_flags & HTTP2_FLAG_END_HEADERS)
+  {
+    return CompleteHeaders(p_requests,p_output);
+  }
+  return true;
+}
+
+bool
+HTTP2Session::CompleteHeaders(HTTP2Requests& p_requests,std::string& p_output)
+{
+  unsigned stream = m_headerStream;
+  m_headerStream  = 0;
+
+  // Always decode: the dynamic table must stay in sync with the client
+  HPACKHeaders headers;
+  bool decoded = m_decoder.Decode(reinterpret_cast<const unsigned char*>(m_headerBlock.data()),m_headerBlock.size(),headers);
+  m_headerBlock.clear();
+  if(!decoded)
+  {
+    // Decoding stopped halfway: the dynamic table is out of sync with the client
+    return Fail(m_decoder.GetListTooLarge() ? HTTP2_ENHANCE_YOUR_CALM : HTTP2_COMPRESSION_ERROR,p_output);
+  }
+
+  // Trailers of a request: they end the stream and are not used
+  HTTP2Streams::iterator it = m_streams.find(stream);
+  if(it != m_streams.end())
+  {
+    if(it->second.m_received || !m_headerEnd)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    it->second.m_received = true;
+    p_requests.push_back(std::move(it->second.m_request));
+    return true;
+  }
+
+  // New streams after our GOAWAY are not processed
+  if(m_goingAway && stream > m_goAwayStream)
+  {
+    return true;
+  }
+  ++m_opened;
+  if(m_streams.size() >= HTTP2_MAX_STREAMS)
+  {
+    WriteRstStream(p_output,stream,HTTP2_REFUSED_STREAM);
+    return true;
+  }
+  RawRequest request;
+  if(!MakeRequest(headers,request))
+  {
+    // Malformed request is a stream error (RFC 9113 8.1.1)
+    WriteRstStream(p_output,stream,HTTP2_PROTOCOL_ERROR);
+    return true;
+  }
+  request.m_sequence = stream;
+
+  HTTP2Stream& state = m_streams[stream];
+  state.m_isHead     = request.m_verb == "HEAD";
+  state.m_sendWindow = m_initialWindow;
+  if(m_headerEnd)
+  {
+    state.m_received = true;
+    p_requests.push_back(std::move(request));
+  }
+  else
+  {
+    state.m_request = std::move(request);
+  }
+  return true;
+}
+
+// Pseudo headers to the request line, regular headers as on HTTP/1.1
+bool
+HTTP2Session::MakeRequest(const HPACKHeaders& p_headers,RawRequest& p_request)
+{
+  std::string authority;
+  std::string cookie;
+  bool regular = false;
+
+  for(auto& header : p_headers)
+  {
+    const std::string& name = header.first;
+    if(!name.empty() && name[0] == ':')
+    {
+      // Pseudo headers come first
+      if(regular)
+      {
+        return false;
+      }
+      if(name == ":method")
+      {
+        p_request.m_verb = header.second;
+      }
+      else if(name == ":path")
+      {
+        p_request.m_url = header.second;
+      }
+      else if(name == ":authority")
+      {
+        authority = header.second;
+      }
+      else if(name != ":scheme")
+      {
+        return false;
+      }
+      continue;
+    }
+    regular = true;
+    for(auto& ch : name)
+    {
+      if(isupper((unsigned char)ch))
+      {
+        return false;
+      }
+    }
+    if(ConnectionHeader(name))
+    {
+      return false;
+    }
+    // Cookies may be split into separate fields (RFC 9113 8.2.3)
+    if(name == "cookie")
+    {
+      if(!cookie.empty())
+      {
+        cookie += "; ";
+      }
+      cookie += header.second;
+      continue;
+    }
+    p_request.AddHeader(name.c_str(),name.size(),header.second.c_str(),header.second.size());
+  }
+  // CONNECT is not supported: method and path are required
+  if(p_request.m_verb.empty() || p_request.m_url.empty())
+  {
+    return false;
+  }
+  if(!authority.empty() && *p_request.FindHeader(RawHeaderID::RH_Host) == 0)
+  {
+    p_request.AddHeader("host",4,authority.c_str(),authority.size());
+  }
+  if(!cookie.empty())
+  {
+    p_request.AddHeader("cookie",6,cookie.c_str(),cookie.size());
+  }
+  p_request.m_minor     = 1;
+  p_request.m_keepAlive = true;
+  return true;
+}
+
+bool
+HTTP2Session::OnData(const HTTP2Frame&    p_frame
+                    ,const unsigned char* p_payload
+                    ,HTTP2Requests&       p_requests
+                    ,std::string&         p_output)
+{
+  if(p_frame.m_stream == 0)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  const unsigned char* data   = p_payload;
+  size_t               length = p_frame.m_length;
+  if(p_frame.m_flags & HTTP2_FLAG_PADDED)
+  {
+    if(length < 1 || p_payload[0] >= length)
+    {
+      return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    length -= (size_t)p_payload[0] + 1;
+    ++data;
+  }
+
+  // The connection window counts every frame, including the padding
+  m_recvWindow -= p_frame.m_length;
+  m_consumed   += p_frame.m_length;
+  if(m_recvWindow < 0)
+  {
+    return Fail(HTTP2_FLOW_CONTROL_ERROR,p_output);
+  }
+  if(m_consumed >= HTTP2_CONNECTION_WINDOW / 2)
+  {
+    WriteWindowUpdate(p_output,0,(unsigned)m_consumed);
+    m_recvWindow += m_consumed;
+    m_consumed    = 0;
+  }
+
+  HTTP2Streams::iterator it = m_streams.find(p_frame.m_stream);
+  if(it == m_streams.end())
+  {
+    // Data for a refused or reset stream is ignored. Not for an idle stream
+    return p_frame.m_stream <= m_lastStream ? true : Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  HTTP2Stream& state = it->second;
+  if(state.m_reset)
+  {
+    return true;
+  }
+  if(state.m_received)
+  {
+    // Client has already ended the stream (half-closed remote)
+    WriteRstStream(p_output,p_frame.m_stream,HTTP2_STREAM_CLOSED);
+    m_streams.erase(it);
+    return true;
+  }
+  state.m_recvWindow -= p_frame.m_length;
+  if(state.m_recvWindow < 0)
+  {
+    WriteRstStream(p_output,p_frame.m_stream,HTTP2_FLOW_CONTROL_ERROR);
+    m_streams.erase(it);
+    return true;
+  }
+  if(state.m_request.m_body.size() + length > HTTPCONNECTION_MAXBODY)
+  {
+    m_streams.erase(it);
+    Refuse(p_frame.m_stream,HTTP_STATUS_REQUEST_TOO_LARGE,(p_frame.m_flags & HTTP2_FLAG_END_STREAM) == 0,p_output);
+    return true;
+  }
+  state.m_request.m_body.append(reinterpret_cast<const char*>(data),length);
+
+  if(p_frame.m_flags & HTTP2_FLAG_END_STREAM)
+  {
+    state.m_received = true;
+    p_requests.push_back(std::move(state.m_request));
+    return true;
+  }
+  // Give the window back to the client
+  state.m_consumed += p_frame.m_length;
+  if(state.m_consumed >= HTTP2_STREAM_WINDOW / 2)
+  {
+    WriteWindowUpdate(p_output,p_frame.m_stream,(unsigned)state.m_consumed);
+    state.m_recvWindow += state.m_consumed;
+    state.m_consumed    = 0;
+  }
+  return true;
+}
+
+bool
+HTTP2Session::OnRstStream(const HTTP2Frame& p_frame,const unsigned char* /*p_payload*/,std::string& p_output)
+{
+  if(p_frame.m_length != 4)
+  {
+    return Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+  }
+  if(p_frame.m_stream == 0 || p_frame.m_stream > m_lastStream)
+  {
+    return Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  // Opening streams and resetting them right away lets a client start
+  // handlers without limit (rapid reset). Stop a client that mostly resets.
+  if(++m_resets > HTTP2_MAX_RESETS && m_resets > m_opened / 2)
+  {
+    return Fail(HTTP2_ENHANCE_YOUR_CALM,p_output);
+  }
+  HTTP2Streams::iterator it = m_streams.find(p_frame.m_stream);
+  if(it == m_streams.end() || it->second.m_reset)
+  {
+    return true;
+  }
+  HTTP2Stream& state = it->second;
+  if(state.m_received && !state.m_ended)
+  {
+    // The handler still runs: the stream keeps counting against
+    // HTTP2_MAX_STREAMS until the handler ends. Its response is discarded.
+    state.m_reset = true;
+    state.m_response.clear();
+    state.m_pending.clear();
+    state.m_pendingPos = 0;
+    return true;
+  }
+  m_streams.erase(it);
+  return true;
+}
+
+bool
+HTTP2Session::OnWindowUpdate(const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output)
+{
+  if(p_frame.m_length != 4)
+  {
+    return Fail(HTTP2_FRAME_SIZE_ERROR,p_output);
+  }
+  unsigned increment = Get32(p_payload) & 0x7FFFFFFF;
+  if(p_frame.m_stream == 0)
+  {
+    m_sendWindow += increment;
+    if(increment == 0 || m_sendWindow > HTTP2_MAX_WINDOW)
+    {
+      return Fail(increment ? HTTP2_FLOW_CONTROL_ERROR : HTTP2_PROTOCOL_ERROR,p_output);
+    }
+    FlushAll(p_output);
+    return true;
+  }
+  HTTP2Streams::iterator it = m_streams.find(p_frame.m_stream);
+  if(it == m_streams.end())
+  {
+    return p_frame.m_stream <= m_lastStream ? true : Fail(HTTP2_PROTOCOL_ERROR,p_output);
+  }
+  HTTP2Stream& state = it->second;
+  if(state.m_reset)
+  {
+    return true;
+  }
+  state.m_sendWindow += increment;
+  if(increment == 0 || state.m_sendWindow > HTTP2_MAX_WINDOW)
+  {
+    WriteRstStream(p_output,p_frame.m_stream,increment ? HTTP2_FLOW_CONTROL_ERROR : HTTP2_PROTOCOL_ERROR);
+    m_streams.erase(it);
+    return true;
+  }
+  if(Flush(p_frame.m_stream,state,p_output))
+  {
+    m_streams.erase(it);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// RESPONSES
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+HTTP2Session::QueueResponse(unsigned    p_stream
+                           ,const char* p_data
+                           ,size_t      p_length
+                           ,bool        p_complete
+                           ,std::string& p_output)
+{
+  HTTP2Streams::iterator it = m_streams.find(p_stream);
+  if(it == m_streams.end())
+  {
+    // Reset by us
+    return false;
+  }
+  HTTP2Stream& state = it->second;
+  if(state.m_reset)
+  {
+    // Reset by the client: the slot is free when the handler is done
+    if(p_complete)
+    {
+      m_streams.erase(it);
+    }
+    return false;
+  }
+  state.m_response.append(p_data,p_length);
+  if(!state.m_headersSent && !TranslateHeaders(p_stream,state,p_output))
+  {
+    if(p_complete)
+    {
+      // Response without a complete header block
+      WriteRstStream(p_output,p_stream,HTTP2_INTERNAL_ERROR);
+      m_streams.erase(it);
+    }
+    return true;
+  }
+  TranslateBody(state);
+  if(p_complete)
+  {
+    state.m_ended = true;
+  }
+  if(Flush(p_stream,state,p_output))
+  {
+    m_streams.erase(it);
+  }
+  return true;
+}
+
+void
+HTTP2Session::ResetStream(unsigned p_stream,unsigned p_error,std::string& p_output)
+{
+  HTTP2Streams::iterator it = m_streams.find(p_stream);
+  if(it != m_streams.end())
+  {
+    // A stream reset by the client needs no RST_STREAM of ours
+    if(!it->second.m_reset)
+    {
+      WriteRstStream(p_output,p_stream,p_error);
+    }
+    m_streams.erase(it);
+  }
+}
+
+// Status line and headers to a HEADERS frame. False if not yet complete
+bool
+HTTP2Session::TranslateHeaders(unsigned p_stream,HTTP2Stream& p_state,std::string& p_output)
+{
+  std::string& response = p_state.m_response;
+  int status = 0;
+  size_t headerEnd = 0;
+  do
+  {
+    headerEnd = response.find("\r\n\r\n");
+    if(headerEnd == std::string::npos)
+    {
+      return false;
+    }
+    // "HTTP/1.1 200 OK"
+    size_t space = response.find(' ');
+    status = (space < headerEnd) ? atoi(response.c_str() + space + 1) : HTTP_STATUS_SERVER_ERROR;
+    if(status < HTTP_STATUS_OK)
+    {
+      // Interim response (100 Continue) has no meaning to a HTTP/2 client
+      response.erase(0,headerEnd + 4);
+    }
+  }
+  while(status < HTTP_STATUS_OK);
+
+  HPACKHeaders headers;
+  headers.push_back(HPACKHeader(":status",std::to_string(status)));
+
+  size_t position = response.find("\r\n") + 2;
+  while(position < headerEnd + 2)
+  {
+    size_t end   = response.find("\r\n",position);
+    size_t colon = response.find(':',position);
+    if(colon < end)
+    {
+      std::string name  = response.substr(position,colon - position);
+      size_t valueBegin = colon + 1;
+      while(valueBegin < end && (response[valueBegin] == ' ' || response[valueBegin] == '\t')) ++valueBegin;
+      std::string value = response.substr(valueBegin,end - valueBegin);
+      for(auto& ch : name)
+      {
+        ch = (char) tolower((unsigned char)ch);
+      }
+      if(name == "transfer-encoding")
+      {
+        p_state.m_chunked = value.find("chunked") != std::string::npos;
+      }
+      else if(!ConnectionHeader(name))
+      {
+        if(name == "content-length")
+        {
+          p_state.m_hasLength = true;
+          p_state.m_remaining = (size_t)strtoull(value.c_str(),nullptr,10);
+        }
+        headers.push_back(HPACKHeader(name,value));
+      }
+    }
+    position = end + 2;
+  }
+  response.erase(0,headerEnd + 4);
+
+  p_state.m_noBody = p_state.m_isHead || status == HTTP_STATUS_NO_CONTENT || status == HTTP_STATUS_NOT_MODIFIED;
+  bool endStream   = p_state.m_noBody || (p_state.m_hasLength && !p_state.m_chunked && p_state.m_remaining == 0);
+  WriteHeaders(p_stream,headers,endStream,p_output);
+  p_state.m_headersSent = true;
+  p_state.m_ended       = endStream;
+  p_state.m_endSent     = endStream;
+  return true;
+}
+
+// Body bytes of the HTTP/1.1 response to the pending DATA
+void
+HTTP2Session::TranslateBody(HTTP2Stream& p_state)
+{
+  std::string& response = p_state.m_response;
+  if(p_state.m_endSent || p_state.m_ended)
+  {
+    response.clear();
+    return;
+  }
+  if(p_state.m_chunked)
+  {
+    size_t position = 0;
+    while(true)
+    {
+      size_t lineEnd = response.find("\r\n",position);
+      if(lineEnd == std::string::npos)
+      {
+        break;
+      }
+      size_t size = (size_t)strtoull(response.c_str() + position,nullptr,16);
+      if(size == 0)
+      {
+        // Last chunk and optional trailers up to an empty line
+        if(response.compare(lineEnd + 2,2,"\r\n") == 0 || response.find("\r\n\r\n",lineEnd + 2) != std::string::npos)
+        {
+          p_state.m_ended = true;
+          position = response.size();
+        }
+        break;
+      }
+      if(response.size() < lineEnd + 2 + size + 2)
+      {
+        break;
+      }
+      p_state.m_pending.append(response,lineEnd + 2,size);
+      position = lineEnd + 2 + size + 2;
+    }
+    response.erase(0,position);
+  }
+  else if(p_state.m_hasLength)
+  {
+    size_t take = response.size() < p_state.m_remaining ? response.size() : p_state.m_remaining;
+    p_state.m_pending.append(response,0,take);
+    p_state.m_remaining -= take;
+    p_state.m_ended = p_state.m_remaining == 0;
+    response.clear();
+  }
+  else
+  {
+    p_state.m_pending.append(response);
+    response.clear();
+  }
+}
+
+// Header block in a HEADERS frame and as many CONTINUATION frames as needed
+void
+HTTP2Session::WriteHeaders(unsigned p_stream,const HPACKHeaders& p_headers,bool p_endStream,std::string& p_output)
+{
+  std::string block;
+  m_encoder.Encode(p_headers,block);
+
+  size_t position = 0;
+  bool   first    = true;
+  do
+  {
+    size_t length = block.size() - position;
+    if(length > m_maxFrameSize)
+    {
+      length = m_maxFrameSize;
+    }
+    unsigned char flags = 0;
+    if(position + length == block.size())
+    {
+      flags |= HTTP2_FLAG_END_HEADERS;
+    }
+    if(first && p_endStream)
+    {
+      flags |= HTTP2_FLAG_END_STREAM;
+    }
+    WriteFrame(p_output,first ? HTTP2_HEADERS : HTTP2_CONTINUATION,flags,p_stream,block.data() + position,length);
+    position += length;
+    first     = false;
+  }
+  while(position < block.size());
+}
+
+// Answer a stream without dispatching it to a site
+void
+HTTP2Session::Refuse(unsigned p_stream,int p_status,bool p_reset,std::string& p_output)
+{
+  HPACKHeaders headers;
+  headers.push_back(HPACKHeader(":status",std::to_string(p_status)));
+  headers.push_back(HPACKHeader("content-length","0"));
+  WriteHeaders(p_stream,headers,true,p_output);
+  if(p_reset)
+  {
+    // Client need not send the rest of the request (RFC 9113 8.1)
+    WriteRstStream(p_output,p_stream,HTTP2_NO_ERROR);
+  }
+}
+
+// Send as much DATA as the flow control windows allow
+bool
+HTTP2Session::Flush(unsigned p_stream,HTTP2Stream& p_state,std::string& p_output)
+{
+  while(p_state.m_headersSent && !p_state.m_endSent && !p_state.m_reset)
+  {
+    size_t rest   = p_state.m_pending.size() - p_state.m_pendingPos;
+    size_t length = rest;
+    if(rest > 0)
+    {
+      long long window = p_state.m_sendWindow < m_sendWindow ? p_state.m_sendWindow : m_sendWindow;
+      if(window <= 0)
+      {
+        break;
+      }
+      if((long long)length > window)
+      {
+        length = (size_t)window;
+      }
+      if(length > m_maxFrameSize)
+      {
+        length = m_maxFrameSize;
+      }
+    }
+    else if(!p_state.m_ended)
+    {
+      break;
+    }
+    bool last = p_state.m_ended && length == rest;
+    WriteFrame(p_output,HTTP2_DATA,last ? HTTP2_FLAG_END_STREAM : 0,p_stream,p_state.m_pending.data() + p_state.m_pendingPos,length);
+    p_state.m_pendingPos += length;
+    p_state.m_sendWindow -= length;
+    m_sendWindow         -= length;
+    p_state.m_endSent     = last;
+  }
+  if(p_state.m_pendingPos >= p_state.m_pending.size())
+  {
+    p_state.m_pending.clear();
+    p_state.m_pendingPos = 0;
+  }
+  return p_state.m_endSent && p_state.m_received;
+}
+
+void
+HTTP2Session::FlushAll(std::string& p_output)
+{
+  HTTP2Streams::iterator it = m_streams.begin();
+  while(it != m_streams.end() && m_sendWindow > 0)
+  {
+    if(Flush(it->first,it->second,p_output))
+    {
+      it = m_streams.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,208 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTP2Session.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "HTTPConnection.h"
+#include "HPACK.h"
+#include <string>
+#include <deque>
+#include <map>
+
+// HTTP/2 (RFC 9113) on one connection of the HTTPServerSocket.
+// Started by the client with the connection preface ("prior knowledge" h2c).
+// The frames of the client are translated to RawRequests, one for each stream,
+// that go through the same dispatching as HTTP/1.1 requests. The stream id is
+// the sequence number of the request. The responses of the server are produced
+// as HTTP/1.1 bytes, and are translated to HEADERS and DATA frames here.
+// Streams are answered in any order: no head-of-line blocking.
+//
+// All methods must be called with the lock of the HTTPConnection held.
+
+#define HTTP2_PREFACE             "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define HTTP2_PREFACE_LENGTH      24
+#define HTTP2_FRAME_HEADER        9
+#define HTTP2_DEFAULT_WINDOW      65535               // Initial window of a stream and the connection
+#define HTTP2_DEFAULT_FRAMESIZE   16384               // SETTINGS_MAX_FRAME_SIZE default
+#define HTTP2_MAX_FRAMESIZE       0xFFFFFF            // Largest frame size a peer may set
+#define HTTP2_MAX_WINDOW          0x7FFFFFFF          // Largest flow control window
+#define HTTP2_MAX_STREAMS         100                 // Our SETTINGS_MAX_CONCURRENT_STREAMS
+#define HTTP2_STREAM_WINDOW       (1024 * 1024)       // Our receive window per stream
+#define HTTP2_CONNECTION_WINDOW   (16 * 1024 * 1024)  // Our receive window of the connection
+#define HTTP2_MAX_RESETS          200                 // Client resets before the reset ratio is checked
+
+// Frame types
+#define HTTP2_DATA                0x0
+#define HTTP2_HEADERS             0x1
+#define HTTP2_PRIORITY            0x2
+#define HTTP2_RST_STREAM          0x3
+#define HTTP2_SETTINGS            0x4
+#define HTTP2_PUSH_PROMISE        0x5
+#define HTTP2_PING                0x6
+#define HTTP2_GOAWAY              0x7
+#define HTTP2_WINDOW_UPDATE       0x8
+#define HTTP2_CONTINUATION        0x9
+
+// Frame flags
+#define HTTP2_FLAG_END_STREAM     0x01
+#define HTTP2_FLAG_ACK            0x01
+#define HTTP2_FLAG_END_HEADERS    0x04
+#define HTTP2_FLAG_PADDED         0x08
+#define HTTP2_FLAG_PRIORITY       0x20
+
+// Settings
+#define HTTP2_SETTINGS_HEADER_TABLE_SIZE      0x1
+#define HTTP2_SETTINGS_ENABLE_PUSH            0x2
+#define HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define HTTP2_SETTINGS_INITIAL_WINDOW_SIZE    0x4
+#define HTTP2_SETTINGS_MAX_FRAME_SIZE         0x5
+#define HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE   0x6
+
+// Error codes
+#define HTTP2_NO_ERROR            0x0
+#define HTTP2_PROTOCOL_ERROR      0x1
+#define HTTP2_INTERNAL_ERROR      0x2
+#define HTTP2_FLOW_CONTROL_ERROR  0x3
+#define HTTP2_STREAM_CLOSED       0x5
+#define HTTP2_FRAME_SIZE_ERROR    0x6
+#define HTTP2_REFUSED_STREAM      0x7
+#define HTTP2_CANCEL              0x8
+#define HTTP2_COMPRESSION_ERROR   0x9
+#define HTTP2_ENHANCE_YOUR_CALM   0xB
+
+// The 9 bytes in front of every frame
+typedef struct _http2Frame
+{
+  unsigned      m_length { 0 };
+  unsigned char m_type   { 0 };
+  unsigned char m_flags  { 0 };
+  unsigned      m_stream { 0 };
+}
+HTTP2Frame;
+
+// One stream: a request and its response
+typedef struct _http2Stream
+{
+  RawRequest    m_request;                  // Request being received
+  bool          m_received    { false };    // END_STREAM from the client: request is dispatched
+  bool          m_isHead      { false };    // HEAD request: no body in the response
+  long long     m_sendWindow  { HTTP2_DEFAULT_WINDOW };
+  long long     m_recvWindow  { HTTP2_STREAM_WINDOW  };
+  size_t        m_consumed    { 0 };        // Received DATA not yet given back in a WINDOW_UPDATE
+  // Translation of the HTTP/1.1 response
+  std::string   m_response;                 // Response bytes not yet translated
+  bool          m_headersSent { false };    // HEADERS frame is on the wire
+  bool          m_chunked     { false };    // Body in chunked transfer-encoding
+  bool          m_noBody      { false };    // HEAD, 1xx, 204 or 304
+  bool          m_hasLength   { false };    // Content-Length was given
+  size_t        m_remaining   { 0 };        // Rest of the Content-Length
+  std::string   m_pending;                  // Body bytes waiting for the flow control window
+  size_t        m_pendingPos  { 0 };        // Already sent of m_pending
+  bool          m_ended       { false };    // All of the body is in m_pending
+  bool          m_endSent     { false };    // END_STREAM is on the wire
+  bool          m_reset       { false };    // Reset by the client while its handler still runs
+}
+HTTP2Stream;
+
+using HTTP2Streams  = std::map<unsigned,HTTP2Stream>;
+using HTTP2Requests = std::deque<RawRequest>;
+
+class HTTP2Session
+{
+public:
+  HTTP2Session();
+
+  // Our SETTINGS and the connection window: first bytes to the client
+  void Start(std::string& p_output);
+  // Process all complete frames of the input. Complete requests go to p_requests
+  // Returns false on a connection error: GOAWAY is in the output and the connection must close
+  bool ProcessInput(std::string& p_input,HTTP2Requests& p_requests,std::string& p_output);
+  // Add response bytes (HTTP/1.1 serialized) for a stream
+  // Returns false if the client does not want the response any more
+  bool QueueResponse(unsigned p_stream,const char* p_data,size_t p_length,bool p_complete,std::string& p_output);
+  // The server cancels a stream (e.g. an event stream)
+  void ResetStream(unsigned p_stream,unsigned p_error,std::string& p_output);
+  // No more new streams. Streams in progress are finished
+  void GoAway(unsigned p_error,std::string& p_output);
+
+  // GETTERS
+  bool GetIsIdle()          { return m_streams.empty(); }
+  size_t GetPendingBytes();   // Response bytes not yet on the wire
+  bool GetGoingAway()       { return m_goingAway;       }
+  unsigned GetLastStream()  { return m_lastStream;      }
+
+  // Frame primitives, also used by the HTTP/2 test client
+  static void WriteFrame(std::string& p_output,unsigned char p_type,unsigned char p_flags,unsigned p_stream,const char* p_payload,size_t p_length);
+  static bool ReadFrame (const std::string& p_input,size_t p_position,HTTP2Frame& p_frame);
+  static void WriteWindowUpdate(std::string& p_output,unsigned p_stream,unsigned p_increment);
+  static void WriteRstStream   (std::string& p_output,unsigned p_stream,unsigned p_error);
+
+private:
+  // Handling of the frame types. False on a connection error
+  bool OnSettings    (const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output);
+  bool OnPing        (const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output);
+  bool OnHeaders     (const HTTP2Frame& p_frame,const unsigned char* p_payload,HTTP2Requests& p_requests,std::string& p_output);
+  bool OnContinuation(const HTTP2Frame& p_frame,const unsigned char* p_payload,HTTP2Requests& p_requests,std::string& p_output);
+  bool OnData        (const HTTP2Frame& p_frame,const unsigned char* p_payload,HTTP2Requests& p_requests,std::string& p_output);
+  bool OnRstStream   (const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output);
+  bool OnWindowUpdate(const HTTP2Frame& p_frame,const unsigned char* p_payload,std::string& p_output);
+  // A complete header block has been received
+  bool CompleteHeaders(HTTP2Requests& p_requests,std::string& p_output);
+  bool MakeRequest(const HPACKHeaders& p_headers,RawRequest& p_request);
+  // Immediate answer without dispatching (413, 431) and reset of the stream
+  void Refuse(unsigned p_stream,int p_status,bool p_reset,std::string& p_output);
+  // Response translation
+  bool TranslateHeaders(unsigned p_stream,HTTP2Stream& p_state,std::string& p_output);
+  void TranslateBody(HTTP2Stream& p_state);
+  void WriteHeaders(unsigned p_stream,const HPACKHeaders& p_headers,bool p_endStream,std::string& p_output);
+  // Flow controlled sending of DATA frames. True if the stream is done in both directions
+  bool Flush(unsigned p_stream,HTTP2Stream& p_state,std::string& p_output);
+  void FlushAll(std::string& p_output);
+  // Connection error
+  bool Fail(unsigned p_error,std::string& p_output);
+
+  HTTP2Streams  m_streams;
+  HPACKDecoder  m_decoder;
+  HPACKEncoder  m_encoder;
+  bool          m_prefaceSeen   { false };
+  bool          m_settingsSeen  { false };      // First frame of the client must be SETTINGS
+  bool          m_goingAway     { false };      // GOAWAY has been sent
+  unsigned      m_goAwayStream  { 0 };          // Last stream id we promised to handle
+  unsigned      m_lastStream    { 0 };          // Highest stream id of the client
+  // Header block in HEADERS + CONTINUATION frames
+  unsigned      m_headerStream  { 0 };          // Stream of the CONTINUATION frames (0 = none)
+  bool          m_headerEnd     { false };      // END_STREAM was on the HEADERS frame
+  std::string   m_headerBlock;
+  // Flow control
+  long long     m_sendWindow    { HTTP2_DEFAULT_WINDOW };
+  long long     m_recvWindow    { HTTP2_CONNECTION_WINDOW };
+  size_t        m_consumed      { 0 };          // Received DATA not yet given back
+  long long     m_initialWindow { HTTP2_DEFAULT_WINDOW };   // SETTINGS_INITIAL_WINDOW_SIZE of the client
+  size_t        m_maxFrameSize  { HTTP2_DEFAULT_FRAMESIZE }; // SETTINGS_MAX_FRAME_SIZE of the client
+  // Rapid reset protection
+  unsigned      m_opened        { 0 };          // Streams opened by the client
+  unsigned      m_resets        { 0 };          // RST_STREAM frames of the client
+};
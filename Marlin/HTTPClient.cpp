@@ -155,6 +155,7 @@ HTTPClient::Reset()
   m_timeoutConnect  = DEF_TIMEOUT_CONNECT;
   m_timeoutSend     = DEF_TIMEOUT_SEND;
   m_timeoutReceive  = DEF_TIMEOUT_RECEIVE;
+  m_timeoutRequest  = 0;
 
   if(m_request)
   {
@@ -412,6 +413,21 @@ HTTPClient::Initialize()
   }
   DETAILLOG(_T("HTTP Timeouts set [%d/%d/%d/%d]"),m_timeoutResolve,m_timeoutConnect,m_timeoutSend,m_timeoutReceive);
 
+  // HTTP/2 is negotiated through TLS-ALPN. Plain HTTP connections stay on HTTP/1.1
+  if(m_http2)
+  {
+    DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+    if(WinHttpSetOption(m_session,WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL,&protocols,sizeof(DWORD)))
+    {
+      DETAILLOG(_T("HTTP/2 enabled for secure connections"));
+    }
+    else
+    {
+      // Older MS-Windows versions: no harm done, stay on HTTP/1.1
+      DETAILLOG(_T("HTTP/2 not available on this system. Error [%d]"),GetLastError());
+    }
+  }
+
   // Prepare a tracing agent
   if(MUSTLOG(HLL_LOGBODY) && !m_trace && m_log)
   {
@@ -560,6 +576,7 @@ HTTPClient::InitSettings()
   m_soapCompress   =             m_marlinConfig.GetParameterBoolean(_T("Client"),_T("SOAPCompress"),     m_soapCompress);
   m_httpCompression=             m_marlinConfig.GetParameterBoolean(_T("Client"),_T("HTTPCompression"),  m_httpCompression);
   m_verbTunneling  =             m_marlinConfig.GetParameterBoolean(_T("Client"),_T("VerbTunneling"),    m_verbTunneling);
+  m_http2          =             m_marlinConfig.GetParameterBoolean(_T("Client"),_T("HTTP2"),            m_http2);
   m_certPreset     =             m_marlinConfig.GetParameterBoolean(_T("Client"),_T("CertificatePreset"),m_certPreset);
   m_certStore      =             m_marlinConfig.GetParameterString (_T("Client"),_T("CertificateStore"), m_certStore);
   m_certName       =             m_marlinConfig.GetParameterString (_T("Client"),_T("CertificateName"),  m_certName);
@@ -673,6 +690,7 @@ HTTPClient::InitSettings()
   }
   DETAILLOG(_T("Client single-sign-on NT-LanManager  : %s"),m_sso           ? _T("yes") : _T("no"));
   DETAILLOG(_T("Client forces HTTP VERB Tunneling    : %s"),m_verbTunneling ? _T("yes") : _T("no"));
+  DETAILLOG(_T("Client negotiates HTTP/2             : %s"),m_http2         ? _T("yes") : _T("no"));
   DETAILLOG(_T("Client will use CORS origin header   : %s"),m_corsOrigin.GetString());
 }
 
@@ -2848,6 +2866,14 @@ HTTPClient::Send()
     ErrorLog(_T(__FUNCTION__),msg);
     return false;
   }
+  // Per-request timeout overrides the send/receive timeouts of the session
+  if(m_timeoutRequest)
+  {
+    if(!WinHttpSetTimeouts(m_request,m_timeoutResolve,m_timeoutConnect,m_timeoutRequest,m_timeoutRequest))
+    {
+      ErrorLog(_T(__FUNCTION__),_T("Cannot set HTTP request timeout. Error [%d] %s"));
+    }
+  }
   // Prepare a fresh response buffer
   if(m_response)
   {
@@ -220,6 +220,7 @@ public:
   void SetTimeoutConnect(int p_timeout)                 { m_timeoutConnect    = p_timeout;  };
   void SetTimeoutSend   (int p_timeout)                 { m_timeoutSend       = p_timeout;  };
   void SetTimeoutReceive(int p_timeout)                 { m_timeoutReceive    = p_timeout;  };
+  void SetTimeoutRequest(int p_timeout)                 { m_timeoutRequest    = p_timeout;  };
   void SetQueueRetention(int p_wait)                    { m_queueRetention    = p_wait;     };
   void SetRelaxOptions(DWORD p_options)                 { m_relax             = p_options;  };
   void SetPreEmptiveAuthorization(DWORD p_pre)          { m_preemtive         = p_pre;      };
@@ -230,6 +231,7 @@ public:
   void SetSoapCompress(bool p_compress)                 { m_soapCompress      = p_compress; };
   void SetSslTlsSettings(unsigned p_ssltls)             { m_ssltls            = p_ssltls;   }; // WINHTTP_FLAG_SECURE_PROTOCOL_ALL
   void SetVerbTunneling(bool p_tunnel)                  { m_verbTunneling     = p_tunnel;   };
+  void SetHTTP2(bool p_http2)                           { m_http2             = p_http2;    };
   void SetClientCertificatePreset(bool p_preset)        { m_certPreset        = p_preset;   };
   void SetClientCertificateName(const XString& p_name)  { m_certName          = p_name;     };
   void SetClientCertificateStore(const XString& p_store){ m_certStore         = p_store;    };
@@ -266,6 +268,7 @@ public:
   int           GetTimeoutConnect()         { return m_timeoutConnect;    };
   int           GetTimeoutSend()            { return m_timeoutSend;       };
   int           GetTimeoutReceive()         { return m_timeoutReceive;    };
+  int           GetTimeoutRequest()         { return m_timeoutRequest;    };
   int           GetStatus()                 { return m_status;            };
   unsigned      GetQueueRetention()         { return m_queueRetention;    };
   bool          GetQueueIsRunning()         { return m_queueThread!=NULL; };
@@ -280,6 +283,7 @@ public:
   LogAnalysis*  GetLogging()                { return m_log;               };
   unsigned      GetSslTlsSettings()         { return m_ssltls;            }; 
   bool          GetVerbTunneling()          { return m_verbTunneling;     };
+  bool          GetHTTP2()                  { return m_http2;             };
   bool          GetClientCertificatePreset(){ return m_certPreset;        };
   XString       GetClientCertificateName()  { return m_certName;          };
   XString       GetClientCertificateStore() { return m_certStore;         };
@@ -409,6 +413,7 @@ private:
   bool          m_soapCompress    { false   };                    // Compress SOAP webservices
   FindProxy     m_proxyFinder;                                    // For finding our proxy
   bool          m_verbTunneling   { false   };                    // Use HTTP VERB-Tunneling
+  bool          m_http2           { true    };                    // Negotiate HTTP/2 on secure connections
   bool          m_httpCompression { false   };                    // Accepts HTTP compression (gzip!)
   // URL
   XString       m_url;                                            // Full URL
@@ -453,6 +458,7 @@ private:
   unsigned      m_timeoutConnect  { DEF_TIMEOUT_CONNECT };        // Timeout in connecting to URL
   unsigned      m_timeoutSend     { DEF_TIMEOUT_SEND    };        // Timeout in sending 
   unsigned      m_timeoutReceive  { DEF_TIMEOUT_RECEIVE };        // Timeout in receiving
+  unsigned      m_timeoutRequest  { 0 };                          // Send/receive timeout of the next request only (0 = session)
   // Extra headers / Cookie
   HeaderMap     m_requestHeaders;                                 // All request headers to the call
   HeaderMap     m_responseHeaders;                                // All response headers from the call
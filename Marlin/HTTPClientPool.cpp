@@ -0,0 +1,488 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPClientPool.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "HTTPClientPool.h"
+#include "HTTPMessage.h"
+#include "CrackURL.h"
+#include "AutoCritical.h"
+#include <process.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+HTTPClientPool::HTTPClientPool(int p_maxPerOrigin /*= POOL_MAX_PER_ORIGIN*/,int p_maxInFlight /*= POOL_MAX_INFLIGHT*/)
+               :m_maxPerOrigin(p_maxPerOrigin > 0 ? p_maxPerOrigin : 1)
+               ,m_maxInFlight (p_maxInFlight  > 0 ? p_maxInFlight  : 1)
+{
+  InitializeCriticalSection(&m_lock);
+}
+
+HTTPClientPool::~HTTPClientPool()
+{
+  Shutdown();
+  CloseIdle();
+
+  for(auto& origin : m_origins)
+  {
+    CloseHandle(origin.second->m_slots);
+    delete origin.second;
+  }
+  m_origins.clear();
+
+  if(m_queueSlots)
+  {
+    CloseHandle(m_queueSlots);
+    m_queueSlots = NULL;
+  }
+  DeleteCriticalSection(&m_lock);
+}
+
+// Send and wait for the answer on the current thread
+bool
+HTTPClientPool::Send(HTTPMessage* p_message,unsigned p_timeout /*= 0*/)
+{
+  return DoSend(p_message,p_timeout);
+}
+
+// Send asynchronously. The future becomes ready with the result
+std::future<bool>
+HTTPClientPool::SendAsync(HTTPMessage* p_message,unsigned p_timeout /*= 0*/)
+{
+  PoolRequest* request = new PoolRequest();
+  request->m_message = p_message;
+  request->m_timeout = p_timeout;
+  std::future<bool> future = request->m_promise.get_future();
+
+  if(!Enqueue(request))
+  {
+    request->m_promise.set_value(false);
+    delete request;
+  }
+  return future;
+}
+
+// Send asynchronously. The callback is called from a worker thread
+bool
+HTTPClientPool::SendAsync(HTTPMessage* p_message,LPFN_POOLDONE p_done,void* p_context,unsigned p_timeout /*= 0*/)
+{
+  PoolRequest* request = new PoolRequest();
+  request->m_message = p_message;
+  request->m_timeout = p_timeout;
+  request->m_done    = p_done;
+  request->m_context = p_context;
+
+  if(!Enqueue(request))
+  {
+    delete request;
+    return false;
+  }
+  return true;
+}
+
+// Close all connections that are not in use
+void
+HTTPClientPool::CloseIdle()
+{
+  std::vector<HTTPClient*> idle;
+  {
+    AutoCritSec lock(&m_lock);
+    for(auto& origin : m_origins)
+    {
+      PoolOrigin* pool = origin.second;
+      pool->m_total -= (int)pool->m_idle.size();
+      idle.insert(idle.end(),pool->m_idle.begin(),pool->m_idle.end());
+      pool->m_idle.clear();
+    }
+  }
+  for(auto& client : idle)
+  {
+    delete client;
+  }
+}
+
+// Stop the workers. Queued requests complete with 'false'
+void
+HTTPClientPool::Shutdown()
+{
+  PoolQueue queued;
+  std::vector<HANDLE> workers;
+  {
+    AutoCritSec lock(&m_lock);
+    if(!m_running)
+    {
+      return;
+    }
+    m_running = false;
+    queued.swap(m_queue);
+    workers.swap(m_workers);
+  }
+  for(auto& request : queued)
+  {
+    Complete(request,false);
+  }
+  // Wake up all workers, so they see that we are stopping
+  ReleaseSemaphore(m_queueSlots,(LONG)workers.size(),NULL);
+  for(auto& worker : workers)
+  {
+    WaitForSingleObject(worker,INFINITE);
+    CloseHandle(worker);
+  }
+}
+
+int
+HTTPClientPool::GetConnections()
+{
+  AutoCritSec lock(&m_lock);
+  int total = 0;
+  for(auto& origin : m_origins)
+  {
+    total += origin.second->m_total;
+  }
+  return total;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// ASYNCHRONOUS WORKERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+HTTPClientPool::Enqueue(PoolRequest* p_request)
+{
+  AutoCritSec lock(&m_lock);
+  if(!m_running)
+  {
+    StartWorkers();
+    if(!m_running)
+    {
+      return false;
+    }
+  }
+  m_queue.push_back(p_request);
+  InterlockedIncrement(&m_inFlight);
+  ReleaseSemaphore(m_queueSlots,1,NULL);
+  return true;
+}
+
+// Lock must be held by the caller
+void
+HTTPClientPool::StartWorkers()
+{
+  if(m_queueSlots == NULL)
+  {
+    m_queueSlots = CreateSemaphore(NULL,0,LONG_MAX,NULL);
+    if(m_queueSlots == NULL)
+    {
+      return;
+    }
+  }
+  m_running = true;
+  for(int ind = 0; ind < m_maxInFlight; ++ind)
+  {
+    HANDLE worker = (HANDLE)_beginthreadex(nullptr,0,StartWorker,this,0,nullptr);
+    if(worker)
+    {
+      m_workers.push_back(worker);
+    }
+  }
+  if(m_workers.empty())
+  {
+    m_running = false;
+  }
+}
+
+unsigned __stdcall
+HTTPClientPool::StartWorker(void* p_pool)
+{
+  reinterpret_cast<HTTPClientPool*>(p_pool)->RunWorker();
+  return 0;
+}
+
+void
+HTTPClientPool::RunWorker()
+{
+  while(true)
+  {
+    WaitForSingleObject(m_queueSlots,INFINITE);
+
+    PoolRequest* request = nullptr;
+    {
+      AutoCritSec lock(&m_lock);
+      if(!m_running)
+      {
+        return;
+      }
+      if(m_queue.empty())
+      {
+        continue;
+      }
+      request = m_queue.front();
+      m_queue.pop_front();
+    }
+    Complete(request,DoSend(request->m_message,request->m_timeout));
+  }
+}
+
+void
+HTTPClientPool::Complete(PoolRequest* p_request,bool p_result)
+{
+  if(p_request->m_done)
+  {
+    (*p_request->m_done)(p_request->m_message,p_result,p_request->m_context);
+  }
+  else
+  {
+    p_request->m_promise.set_value(p_result);
+  }
+  delete p_request;
+  InterlockedDecrement(&m_inFlight);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// SENDING
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Sending one message. Idempotent requests are retried with backoff
+// after a transport error or a 502/503/504 answer of a gateway.
+// Every attempt but the last sends a copy, so the request is not lost.
+// The timeout is for the request as a whole: all attempts and the backoff
+// sleeps between them must fit in it.
+bool
+HTTPClientPool::DoSend(HTTPMessage* p_message,unsigned p_timeout)
+{
+  XString   origin   = MakeOrigin(p_message);
+  int       retries  = IsIdempotent(p_message) ? m_retries : 0;
+  unsigned  backoff  = m_backoff;
+  ULONGLONG deadline = p_timeout ? GetTickCount64() + p_timeout : 0;
+
+  for(int attempt = 0; attempt < retries; ++attempt)
+  {
+    HTTPMessage copy(p_message,true);
+    bool retry  = false;
+    bool result = SendAttempt(&copy,origin,deadline,retry);
+
+    // No retry if we would wake up after the deadline
+    unsigned left = 0;
+    if(retry && (!TimeLeft(deadline,left) || (deadline && left <= backoff)))
+    {
+      retry = false;
+    }
+    if(!retry)
+    {
+      // Take the answer as HTTPClient::Send would have done
+      p_message->Reset();
+      p_message->SetContentType(copy.GetContentType());
+      *p_message->GetFileBuffer() = *copy.GetFileBuffer();
+      p_message->SetCookies(copy.GetCookies());
+      for(auto& header : *copy.GetHeaderMap())
+      {
+        p_message->AddHeader(header.first,header.second);
+      }
+      p_message->SetStatus(copy.GetStatus());
+      return result;
+    }
+    InterlockedIncrement(&m_retried);
+    Sleep(backoff);
+    backoff = (backoff * 2 > m_backoffMax) ? m_backoffMax : backoff * 2;
+  }
+  bool retry = false;
+  return SendAttempt(p_message,origin,deadline,retry);
+}
+
+// One attempt gets the time that is left until the deadline (0 = none)
+bool
+HTTPClientPool::SendAttempt(HTTPMessage* p_message,const XString& p_origin,ULONGLONG p_deadline,bool& p_retry)
+{
+  p_retry = false;
+
+  unsigned timeout = 0;
+  if(!TimeLeft(p_deadline,timeout))
+  {
+    return false;
+  }
+  PoolOrigin* origin = FindOrigin(p_origin);
+  HTTPClient* client = Acquire(origin,timeout);
+  if(client == nullptr)
+  {
+    // No connection became free in time
+    return false;
+  }
+  // Waiting for the connection took part of our time
+  if(!TimeLeft(p_deadline,timeout))
+  {
+    Release(origin,client,true);
+    return false;
+  }
+  client->SetTimeoutRequest(timeout);
+  bool     result = client->Send(p_message);
+  unsigned status = p_message->GetStatus();
+
+  p_retry = (status == 0)                          ||
+            (status == HTTP_STATUS_BAD_GATEWAY)    ||
+            (status == HTTP_STATUS_SERVICE_UNAVAIL)||
+            (status == HTTP_STATUS_GATEWAY_TIMEOUT);
+
+  // A connection without any answer is not used again
+  Release(origin,client,status != 0);
+  return result;
+}
+
+// Milliseconds left until the deadline. False if it has passed.
+// Without a deadline there is always time, and the timeout stays 0.
+bool
+HTTPClientPool::TimeLeft(ULONGLONG p_deadline,unsigned& p_timeout)
+{
+  p_timeout = 0;
+  if(p_deadline)
+  {
+    ULONGLONG now = GetTickCount64();
+    if(now >= p_deadline)
+    {
+      return false;
+    }
+    p_timeout = static_cast<unsigned>(p_deadline - now);
+  }
+  return true;
+}
+
+bool
+HTTPClientPool::IsIdempotent(HTTPMessage* p_message)
+{
+  XString verb = p_message->GetVerb();
+  return verb.CompareNoCase(_T("GET"))     == 0 ||
+         verb.CompareNoCase(_T("HEAD"))    == 0 ||
+         verb.CompareNoCase(_T("PUT"))     == 0 ||
+         verb.CompareNoCase(_T("DELETE"))  == 0 ||
+         verb.CompareNoCase(_T("OPTIONS")) == 0;
+}
+
+// Origin is the combination of scheme, host and port
+XString
+HTTPClientPool::MakeOrigin(HTTPMessage* p_message)
+{
+  XString  host   = p_message->GetServer();
+  unsigned port   = p_message->GetPort();
+  bool     secure = p_message->GetSecure();
+  if(host.IsEmpty())
+  {
+    CrackedURL url(p_message->GetURL());
+    host   = url.m_host;
+    port   = url.m_port;
+    secure = url.m_secure;
+  }
+  XString origin;
+  origin.Format(_T("%s://%s:%u"),secure ? _T("https") : _T("http"),host.GetString(),port);
+  origin.MakeLower();
+  return origin;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// CONNECTIONS PER ORIGIN
+//
+//////////////////////////////////////////////////////////////////////////
+
+PoolOrigin*
+HTTPClientPool::FindOrigin(const XString& p_origin)
+{
+  AutoCritSec lock(&m_lock);
+
+  OriginMap::iterator it = m_origins.find(p_origin);
+  if(it != m_origins.end())
+  {
+    return it->second;
+  }
+  PoolOrigin* origin = new PoolOrigin();
+  origin->m_slots = CreateSemaphore(NULL,m_maxPerOrigin,m_maxPerOrigin,NULL);
+  m_origins[p_origin] = origin;
+  return origin;
+}
+
+// Wait for a free connection slot, then reuse an idle connection or make a new one
+HTTPClient*
+HTTPClientPool::Acquire(PoolOrigin* p_origin,unsigned p_timeout)
+{
+  if(WaitForSingleObject(p_origin->m_slots,p_timeout ? p_timeout : INFINITE) != WAIT_OBJECT_0)
+  {
+    return nullptr;
+  }
+  {
+    AutoCritSec lock(&m_lock);
+    if(!p_origin->m_idle.empty())
+    {
+      HTTPClient* client = p_origin->m_idle.back();
+      p_origin->m_idle.pop_back();
+      return client;
+    }
+    ++p_origin->m_total;
+  }
+  HTTPClient* client = new HTTPClient();
+  if(!m_agent.IsEmpty())
+  {
+    client->SetAgent(m_agent);
+  }
+  if(m_logfile)
+  {
+    client->SetLogging(m_logfile);
+    client->SetLogLevel(m_logLevel);
+  }
+  if(m_init)
+  {
+    (*m_init)(client,m_initContext);
+  }
+  return client;
+}
+
+void
+HTTPClientPool::Release(PoolOrigin* p_origin,HTTPClient* p_client,bool p_keep)
+{
+  {
+    AutoCritSec lock(&m_lock);
+    if(p_keep)
+    {
+      p_origin->m_idle.push_back(p_client);
+    }
+    else
+    {
+      --p_origin->m_total;
+    }
+  }
+  if(!p_keep)
+  {
+    delete p_client;
+  }
+  ReleaseSemaphore(p_origin->m_slots,1,NULL);
+}
@@ -0,0 +1,146 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPClientPool.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "HTTPClient.h"
+#include <map>
+#include <vector>
+#include <deque>
+#include <future>
+
+// Defaults for the client pool
+constexpr int POOL_MAX_PER_ORIGIN = 8;      // Keep-alive connections to one origin
+constexpr int POOL_MAX_INFLIGHT   = 16;     // Concurrent asynchronous requests
+constexpr int POOL_RETRIES        = 2;      // Retries of idempotent requests
+constexpr int POOL_BACKOFF        = 100;    // First retry after 100 ms, doubling each time
+constexpr int POOL_BACKOFF_MAX    = 5000;   // But never wait longer than 5 seconds
+
+// Completion callback of an asynchronous request
+typedef void (*LPFN_POOLDONE)(HTTPMessage* p_message,bool p_result,void* p_context);
+// Extra settings for every new client (connection) in the pool
+typedef void (*LPFN_POOLCLIENT)(HTTPClient* p_client,void* p_context);
+
+// Keep-alive connections to one origin (scheme, host and port)
+typedef struct _poolOrigin
+{
+  std::vector<HTTPClient*> m_idle;              // Connected clients, not in use
+  HANDLE                   m_slots { NULL };    // Semaphore: free connection slots
+  int                      m_total { 0 };       // Number of clients created
+}
+PoolOrigin;
+
+// One asynchronous request in the queue
+typedef struct _poolRequest
+{
+  HTTPMessage*        m_message { nullptr };
+  unsigned            m_timeout { 0 };
+  LPFN_POOLDONE       m_done    { nullptr };
+  void*               m_context { nullptr };
+  std::promise<bool>  m_promise;
+}
+PoolRequest;
+
+using OriginMap = std::map<XString,PoolOrigin*>;
+using PoolQueue = std::deque<PoolRequest*>;
+
+// Connection-pooled HTTP client engine
+// - Each origin gets at most 'maxPerOrigin' keep-alive connections (HTTPClients)
+// - At most 'maxInFlight' asynchronous requests are sent concurrently
+// - Idempotent requests are retried with exponential backoff
+// The HTTPMessage must stay alive until the request has completed
+class HTTPClientPool
+{
+public:
+  explicit HTTPClientPool(int p_maxPerOrigin = POOL_MAX_PER_ORIGIN,int p_maxInFlight = POOL_MAX_INFLIGHT);
+ ~HTTPClientPool();
+
+  // Send and wait for the answer. Timeout in milliseconds for all attempts (0 = client default)
+  bool              Send(HTTPMessage* p_message,unsigned p_timeout = 0);
+  // Send asynchronously. The future becomes ready with the result
+  std::future<bool> SendAsync(HTTPMessage* p_message,unsigned p_timeout = 0);
+  // Send asynchronously. The callback is called from a worker thread
+  bool              SendAsync(HTTPMessage* p_message,LPFN_POOLDONE p_done,void* p_context,unsigned p_timeout = 0);
+  // Close all connections that are not in use
+  void              CloseIdle();
+  // Stop the workers. Queued requests complete with 'false'
+  void              Shutdown();
+
+  // SETTERS
+  void  SetRetries(int p_retries)                         { m_retries    = p_retries; }
+  void  SetBackoff(unsigned p_first,unsigned p_maximum)   { m_backoff    = p_first; m_backoffMax = p_maximum; }
+  void  SetAgent(XString p_agent)                         { m_agent      = p_agent;   }
+  void  SetLogging(LogAnalysis* p_log,int p_logLevel)     { m_logfile    = p_log; m_logLevel = p_logLevel; }
+  void  SetClientInit(LPFN_POOLCLIENT p_init,void* p_context) { m_init = p_init; m_initContext = p_context; }
+
+  // GETTERS
+  int   GetMaxPerOrigin()   { return m_maxPerOrigin; }
+  int   GetMaxInFlight()    { return m_maxInFlight;  }
+  int   GetRetries()        { return m_retries;      }
+  long  GetInFlight()       { return m_inFlight;     }
+  long  GetRetried()        { return m_retried;      }
+  int   GetConnections();
+
+private:
+  // Queue one asynchronous request
+  bool          Enqueue(PoolRequest* p_request);
+  // Worker threads draining the queue
+  static unsigned __stdcall StartWorker(void* p_pool);
+  void          RunWorker();
+  void          StartWorkers();
+  void          Complete(PoolRequest* p_request,bool p_result);
+  // Sending one message with retries
+  bool          DoSend(HTTPMessage* p_message,unsigned p_timeout);
+  bool          SendAttempt(HTTPMessage* p_message,const XString& p_origin,ULONGLONG p_deadline,bool& p_retry);
+  static bool   TimeLeft(ULONGLONG p_deadline,unsigned& p_timeout);
+  bool          IsIdempotent(HTTPMessage* p_message);
+  XString       MakeOrigin(HTTPMessage* p_message);
+  // Connections per origin
+  PoolOrigin*   FindOrigin(const XString& p_origin);
+  HTTPClient*   Acquire(PoolOrigin* p_origin,unsigned p_timeout);
+  void          Release(PoolOrigin* p_origin,HTTPClient* p_client,bool p_keep);
+
+  // Settings
+  int           m_maxPerOrigin { POOL_MAX_PER_ORIGIN };
+  int           m_maxInFlight  { POOL_MAX_INFLIGHT   };
+  int           m_retries      { POOL_RETRIES        };
+  unsigned      m_backoff      { POOL_BACKOFF        };
+  unsigned      m_backoffMax   { POOL_BACKOFF_MAX    };
+  XString       m_agent;
+  LogAnalysis*  m_logfile      { nullptr };
+  int           m_logLevel     { HLL_NOLOG };
+  LPFN_POOLCLIENT m_init       { nullptr };
+  void*         m_initContext  { nullptr };
+  // Status
+  OriginMap     m_origins;                        // Connections per origin
+  PoolQueue     m_queue;                          // Waiting asynchronous requests
+  std::vector<HANDLE> m_workers;                  // Worker threads
+  HANDLE        m_queueSlots   { NULL    };       // Semaphore: requests in the queue
+  bool          m_running      { false   };       // Workers are running
+  long          m_inFlight     { 0       };       // Asynchronous requests not completed
+  long          m_retried      { 0       };       // Statistics: number of retries
+  CRITICAL_SECTION m_lock;                        // Locking origins and queue
+};
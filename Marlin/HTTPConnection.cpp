@@ -0,0 +1,866 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPConnection.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "HTTPConnection.h"
+#include "HTTPServerSocket.h"
+#include "HTTP2Session.h"
+#include "AutoCritical.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Case insensitive search for a token in a header value (e.g. "keep-alive, Upgrade")
+static bool
+HeaderHasToken(const char* p_value,const char* p_token)
+{
+  size_t length = strlen(p_token);
+  for(; *p_value; ++p_value)
+  {
+    if(_strnicmp(p_value,p_token,length) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE RAW REQUEST
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Names of the indexed headers, in the order of RawHeaderID
+static const struct
+{
+  const char* m_name;
+  size_t      m_length;
+}
+g_rawHeaders[(int)RawHeaderID::RH_Count] =
+{
+  { "Host",               4 }
+ ,{ "Connection",        10 }
+ ,{ "Content-Length",    14 }
+ ,{ "Transfer-Encoding", 17 }
+ ,{ "Expect",             6 }
+ ,{ "Content-Type",      12 }
+ ,{ "Accept",             6 }
+ ,{ "Accept-Encoding",   15 }
+ ,{ "Cookie",             6 }
+ ,{ "Authorization",     13 }
+ ,{ "If-Modified-Since", 17 }
+ ,{ "Referer",            7 }
+ ,{ "RemoteDesktop",     13 }
+};
+
+// Index of an indexed header, or -1 for all other headers
+static int
+FindRawHeaderID(const char* p_name,size_t p_length)
+{
+  for(int ind = 0; ind < (int)RawHeaderID::RH_Count; ++ind)
+  {
+    if(g_rawHeaders[ind].m_length == p_length && _strnicmp(g_rawHeaders[ind].m_name,p_name,p_length) == 0)
+    {
+      return ind;
+    }
+  }
+  return -1;
+}
+
+RawRequest::RawRequest()
+{
+  for(auto& known : m_known)
+  {
+    known = -1;
+  }
+}
+
+// Empty the request for the next one, keeping the allocated storage
+// Only a large body is given back, so one upload does not stay resident
+void
+RawRequest::Reset()
+{
+  m_verb.clear();
+  m_url.clear();
+  m_minor     = 1;
+  m_keepAlive = true;
+  m_sequence  = 0;
+  if(m_body.capacity() > HTTPCONNECTION_KEEPBODY)
+  {
+    std::string().swap(m_body);
+  }
+  else
+  {
+    m_body.clear();
+  }
+  m_block.clear();
+  m_headers.clear();
+  for(auto& known : m_known)
+  {
+    known = -1;
+  }
+}
+
+// Add a header as found on the wire
+void
+RawRequest::AddHeader(const char* p_name,size_t p_nameLength,const char* p_value,size_t p_valueLength)
+{
+  int id = FindRawHeaderID(p_name,p_nameLength);
+  if(id >= 0 && m_known[id] < 0)
+  {
+    m_known[id] = (int)m_headers.size();
+  }
+  RawHeader header;
+  header.m_name = (unsigned)m_block.size();
+  m_block.append(p_name,p_nameLength);
+  m_block.push_back(0);
+  header.m_value = (unsigned)m_block.size();
+  m_block.append(p_value,p_valueLength);
+  m_block.push_back(0);
+  m_headers.push_back(header);
+}
+
+const char*
+RawRequest::FindHeader(RawHeaderID p_id) const
+{
+  int index = m_known[(int)p_id];
+  return index < 0 ? "" : GetHeaderValue(index);
+}
+
+const char*
+RawRequest::FindHeader(const char* p_name) const
+{
+  int id = FindRawHeaderID(p_name,strlen(p_name));
+  if(id >= 0)
+  {
+    return FindHeader((RawHeaderID)id);
+  }
+  for(const auto& header : m_headers)
+  {
+    if(_stricmp(m_block.c_str() + header.m_name,p_name) == 0)
+    {
+      return m_block.c_str() + header.m_value;
+    }
+  }
+  return "";
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE CONNECTION
+//
+//////////////////////////////////////////////////////////////////////////
+
+HTTPConnection::HTTPConnection(HTTPServerSocket* p_server
+                              ,PollSocket        p_socket
+                              ,PSOCKADDR_IN6     p_sender
+                              ,int               p_port)
+               :m_server(p_server)
+               ,m_socket(p_socket)
+               ,m_port(p_port)
+{
+  InitializeCriticalSection(&m_lock);
+  m_drained = CreateEvent(NULL,TRUE,FALSE,NULL);
+  memset(&m_sender,0,sizeof(SOCKADDR_IN6));
+  if(p_sender)
+  {
+    memcpy(&m_sender,p_sender,sizeof(SOCKADDR_IN6));
+  }
+  m_activity = GetTickCount64();
+}
+
+HTTPConnection::~HTTPConnection()
+{
+  // Socket gets closed by the last owner only, so no other thread
+  // can ever write to a recycled socket handle
+  if(m_socket != POLL_INVALID_SOCKET)
+  {
+    SocketPoll::CloseSocket(m_socket);
+    m_socket = POLL_INVALID_SOCKET;
+  }
+  if(m_http2)
+  {
+    delete m_http2;
+    m_http2 = nullptr;
+  }
+  if(m_drained)
+  {
+    CloseHandle(m_drained);
+    m_drained = NULL;
+  }
+  m_ident = 0;
+  DeleteCriticalSection(&m_lock);
+}
+
+void
+HTTPConnection::AddReference()
+{
+  InterlockedIncrement(&m_references);
+}
+
+void
+HTTPConnection::DropReference()
+{
+  if(InterlockedDecrement(&m_references) <= 0)
+  {
+    delete this;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// INPUT SIDE: POLLING THREAD ONLY
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Drain the socket until it would block (needed for edge triggering)
+bool
+HTTPConnection::ReadInput()
+{
+  char buffer[HTTPCONNECTION_READSIZE];
+
+  while(!m_closing)
+  {
+    int bytes = recv(m_socket,buffer,HTTPCONNECTION_READSIZE,0);
+    if(bytes > 0)
+    {
+      // After a 'Connection: close' request the rest is ignored
+      if(!m_stopReading)
+      {
+        m_input.append(buffer,bytes);
+      }
+      m_activity = GetTickCount64();
+      continue;
+    }
+    if(bytes == 0)
+    {
+      // Orderly shutdown by the client
+      return false;
+    }
+    return SocketPoll::WouldBlock();
+  }
+  return false;
+}
+
+// Parse one request from the beginning of the input buffer
+ParseResult
+HTTPConnection::ParseRequest(RawRequest& p_request)
+{
+  // HTTP/2 with prior knowledge (RFC 9113 3.3): the preface instead of a request line
+  if(m_http2 == nullptr && m_nextRequest == 0 && m_server->GetHTTP2() && !m_input.empty() && m_input[0] == 'P')
+  {
+    size_t length = m_input.size() < HTTP2_PREFACE_LENGTH ? m_input.size() : HTTP2_PREFACE_LENGTH;
+    if(m_input.compare(0,length,HTTP2_PREFACE,length) == 0)
+    {
+      if(length < HTTP2_PREFACE_LENGTH)
+      {
+        return ParseResult::PR_Incomplete;
+      }
+      AutoCritSec lock(&m_lock);
+      m_http2 = new HTTP2Session();
+      m_http2->Start(m_output);
+    }
+  }
+  if(m_http2)
+  {
+    return ParseHTTP2(p_request);
+  }
+
+  // Robustness (RFC 9112 2.2): skip empty lines before a request line
+  size_t skip = 0;
+  while(skip + 1 < m_input.size() && m_input[skip] == '\r' && m_input[skip + 1] == '\n')
+  {
+    skip += 2;
+  }
+  if(skip)
+  {
+    m_input.erase(0,skip);
+  }
+  if(m_input.empty())
+  {
+    return ParseResult::PR_Incomplete;
+  }
+
+  // STEP 1: Find the end of the header block
+  size_t headerEnd = m_input.find("\r\n\r\n");
+  if(headerEnd == std::string::npos)
+  {
+    return m_input.size() > HTTPCONNECTION_MAXHEADER ? ParseResult::PR_HeaderTooLarge 
+                                                     : ParseResult::PR_Incomplete;
+  }
+  if(headerEnd > HTTPCONNECTION_MAXHEADER)
+  {
+    return ParseResult::PR_HeaderTooLarge;
+  }
+
+  // STEP 2: Request line and headers
+  p_request.Reset();
+  if(!ParseHeaders(p_request,headerEnd))
+  {
+    return ParseResult::PR_BadRequest;
+  }
+
+  // STEP 3: The body
+  size_t position = headerEnd + 4;
+  ParseResult result   = ParseResult::PR_Request;
+  const char* transfer = p_request.FindHeader(RawHeaderID::RH_TransferEncoding);
+  const char* length   = p_request.FindHeader(RawHeaderID::RH_ContentLength);
+  if(*transfer)
+  {
+    if(!HeaderHasToken(transfer,"chunked"))
+    {
+      return ParseResult::PR_BadRequest;
+    }
+    result = ParseChunkedBody(p_request,position);
+  }
+  else if(*length)
+  {
+    char* end = nullptr;
+    unsigned long long contentLength = strtoull(length,&end,10);
+    if(end == length || *end)
+    {
+      return ParseResult::PR_BadRequest;
+    }
+    if(contentLength > HTTPCONNECTION_MAXBODY)
+    {
+      return ParseResult::PR_BodyTooLarge;
+    }
+    if(m_input.size() - position < contentLength)
+    {
+      result = ParseResult::PR_Incomplete;
+    }
+    else
+    {
+      p_request.m_body.assign(m_input,position,(size_t)contentLength);
+      position += (size_t)contentLength;
+    }
+  }
+
+  // Client waits for our consent before sending the body (RFC 9110 10.1.1)
+  if(result == ParseResult::PR_Incomplete && !m_continueSent &&
+     HeaderHasToken(p_request.FindHeader(RawHeaderID::RH_Expect),"100-continue"))
+  {
+    const char* interim = "HTTP/1.1 100 Continue\r\n\r\n";
+    QueueResponse(m_nextRequest,interim,strlen(interim),false);
+    m_continueSent = true;
+  }
+  if(result != ParseResult::PR_Request)
+  {
+    return result;
+  }
+
+  // STEP 4: Request is complete. Consume it and number it
+  m_input.erase(0,position);
+  m_continueSent = false;
+  p_request.m_sequence = m_nextRequest++;
+  if(!p_request.m_keepAlive)
+  {
+    m_stopReading = true;
+    m_input.clear();
+  }
+  return ParseResult::PR_Request;
+}
+
+bool
+HTTPConnection::ParseHeaders(RawRequest& p_request,size_t p_headerEnd)
+{
+  // Request line: VERB SP request-target SP HTTP/1.x
+  size_t lineEnd = m_input.find("\r\n");
+  size_t space1  = m_input.find(' ');
+  size_t space2  = (space1 == std::string::npos) ? space1 : m_input.find(' ',space1 + 1);
+  if(space1 == std::string::npos || space2 == std::string::npos || space2 > lineEnd || space1 == 0)
+  {
+    return false;
+  }
+  p_request.m_verb.assign(m_input,0,space1);
+  p_request.m_url .assign(m_input,space1 + 1,space2 - space1 - 1);
+  const char* version = m_input.c_str() + space2 + 1;
+  if(lineEnd - space2 - 1 != 8 || strncmp(version,"HTTP/1.",7) != 0 || !isdigit((unsigned char)version[7]))
+  {
+    return false;
+  }
+  p_request.m_minor = version[7] - '0';
+  if(p_request.m_url.empty())
+  {
+    return false;
+  }
+
+  // All header lines
+  size_t position = lineEnd + 2;
+  while(position < p_headerEnd + 2)
+  {
+    size_t end = m_input.find("\r\n",position);
+    if(end == std::string::npos || end > p_headerEnd)
+    {
+      break;
+    }
+    // Obsolete line folding is not accepted (RFC 9112 5.2)
+    if(m_input[position] == ' ' || m_input[position] == '\t')
+    {
+      return false;
+    }
+    size_t colon = m_input.find(':',position);
+    if(colon == std::string::npos || colon > end || colon == position)
+    {
+      return false;
+    }
+    size_t valueBegin = colon + 1;
+    size_t valueEnd   = end;
+    while(valueBegin < valueEnd && (m_input[valueBegin]   == ' ' || m_input[valueBegin]   == '\t')) ++valueBegin;
+    while(valueEnd > valueBegin && (m_input[valueEnd - 1] == ' ' || m_input[valueEnd - 1] == '\t')) --valueEnd;
+    p_request.AddHeader(m_input.c_str() + position,colon - position,m_input.c_str() + valueBegin,valueEnd - valueBegin);
+    position = end + 2;
+  }
+
+  // Persistence of the connection (RFC 9112 9.3)
+  const char* connection = p_request.FindHeader(RawHeaderID::RH_Connection);
+  if(p_request.m_minor >= 1)
+  {
+    p_request.m_keepAlive = !HeaderHasToken(connection,"close");
+  }
+  else
+  {
+    p_request.m_keepAlive = HeaderHasToken(connection,"keep-alive");
+  }
+  return true;
+}
+
+ParseResult
+HTTPConnection::ParseChunkedBody(RawRequest& p_request,size_t& p_position)
+{
+  size_t position = p_position;
+  while(true)
+  {
+    size_t lineEnd = m_input.find("\r\n",position);
+    if(lineEnd == std::string::npos)
+    {
+      return ParseResult::PR_Incomplete;
+    }
+    char* end = nullptr;
+    unsigned long long size = strtoull(m_input.c_str() + position,&end,16);
+    if(end == m_input.c_str() + position)
+    {
+      return ParseResult::PR_BadRequest;
+    }
+    if(p_request.m_body.size() + size > HTTPCONNECTION_MAXBODY)
+    {
+      return ParseResult::PR_BodyTooLarge;
+    }
+    position = lineEnd + 2;
+    if(size == 0)
+    {
+      // Last chunk: optional trailers up to an empty line
+      if(m_input.compare(position,2,"\r\n") == 0)
+      {
+        p_position = position + 2;
+        return ParseResult::PR_Request;
+      }
+      size_t trailerEnd = m_input.find("\r\n\r\n",position);
+      if(trailerEnd == std::string::npos)
+      {
+        return ParseResult::PR_Incomplete;
+      }
+      p_position = trailerEnd + 4;
+      return ParseResult::PR_Request;
+    }
+    if(m_input.size() < position + size + 2)
+    {
+      return ParseResult::PR_Incomplete;
+    }
+    if(m_input.compare(position + (size_t)size,2,"\r\n") != 0)
+    {
+      return ParseResult::PR_BadRequest;
+    }
+    p_request.m_body.append(m_input,position,(size_t)size);
+    position += (size_t)size + 2;
+  }
+}
+
+// All complete frames of the input. Streams are handed out one by one
+ParseResult
+HTTPConnection::ParseHTTP2(RawRequest& p_request)
+{
+  ParseResult result = ParseResult::PR_Incomplete;
+  bool close = false;
+  bool write = false;
+  {
+    AutoCritSec lock(&m_lock);
+
+    if(m_http2Requests.empty() && !m_input.empty())
+    {
+      if(!m_http2->ProcessInput(m_input,m_http2Requests,m_output))
+      {
+        // Connection error: GOAWAY is in the output. Nothing more to read
+        m_stopReading = true;
+        m_closeAfter  = true;
+        m_input.clear();
+        m_http2Requests.clear();
+      }
+      // SETTINGS, PING and WINDOW_UPDATE answers and flow controlled DATA
+      if(!SendPending())
+      {
+        m_closing = true;
+        close     = true;
+      }
+      else if(m_outputPos < m_output.size())
+      {
+        write = true;
+      }
+      else if(m_closeAfter)
+      {
+        close = true;
+      }
+    }
+    if(!m_http2Requests.empty())
+    {
+      p_request = std::move(m_http2Requests.front());
+      m_http2Requests.pop_front();
+      ++m_nextRequest;
+      result = ParseResult::PR_Request;
+    }
+  }
+  // Outside our lock: the server locks its own administration
+  if(close)
+  {
+    m_server->RequestClose(this);
+  }
+  else if(write)
+  {
+    m_server->RequestWrite(this);
+  }
+  return result;
+}
+
+// After a protocol error, the rest of the input cannot be trusted
+unsigned
+HTTPConnection::RejectRequest()
+{
+  m_stopReading = true;
+  m_input.clear();
+  return m_nextRequest++;
+}
+
+// Client has half-closed the connection. Answer what we have, then close
+bool
+HTTPConnection::ShutdownInput()
+{
+  AutoCritSec lock(&m_lock);
+
+  m_stopReading   = true;
+  m_closeWhenDone = true;
+  m_input.clear();
+  return m_nextResponse == m_nextRequest && m_output.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// OUTPUT SIDE: ANY THREAD
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+HTTPConnection::QueueResponse(unsigned    p_sequence
+                             ,const char* p_data
+                             ,size_t      p_length
+                             ,bool        p_complete
+                             ,bool        p_close /*=false*/)
+{
+  bool result = true;
+  bool close  = false;
+  bool write  = false;
+  {
+    AutoCritSec lock(&m_lock);
+
+    if(m_closing || (m_http2 == nullptr && p_sequence < m_nextResponse))
+    {
+      return false;
+    }
+    if(m_http2)
+    {
+      // A handler of a stream that is gone can stop producing its response
+      result = QueueHTTP2(p_sequence,p_data,p_length,p_complete,p_close) || p_complete;
+    }
+    else
+    {
+      ResponseSlot& slot = m_slots[p_sequence];
+      slot.m_data.append(p_data,p_length);
+      slot.m_complete |= p_complete;
+      slot.m_close    |= p_close;
+
+      // Put everything that is in order on the wire
+      MoveReadySlots();
+    }
+    if(!SendPending())
+    {
+      m_closing = true;
+      result    = false;
+      close     = true;
+    }
+    else if(m_outputPos < m_output.size())
+    {
+      write = true;
+    }
+    else if(m_closeAfter)
+    {
+      close = true;
+    }
+  }
+  // Outside our lock: the server locks its own administration
+  if(close)
+  {
+    m_server->RequestClose(this);
+  }
+  else if(write)
+  {
+    m_server->RequestWrite(this);
+  }
+  return result;
+}
+
+// Streams go on the wire as soon as they are produced (lock held)
+// Returns false if the stream was reset
+bool
+HTTPConnection::QueueHTTP2(unsigned    p_stream
+                          ,const char* p_data
+                          ,size_t      p_length
+                          ,bool        p_complete
+                          ,bool        p_close)
+{
+  bool wanted = m_http2->QueueResponse(p_stream,p_data,p_length,p_complete,m_output);
+  if(p_complete)
+  {
+    ++m_nextResponse;
+  }
+  // Closing one request closes the connection gracefully: no new streams
+  if(p_close && !m_http2->GetGoingAway())
+  {
+    m_http2->GoAway(HTTP2_NO_ERROR,m_output);
+    m_closeWhenDone = true;
+  }
+  if(m_closeWhenDone && m_nextResponse == m_nextRequest && m_http2->GetIsIdle())
+  {
+    m_closeAfter = true;
+  }
+  return wanted;
+}
+
+// POLLING THREAD: send the rest. Return false if connection must close
+bool
+HTTPConnection::OnWritable()
+{
+  AutoCritSec lock(&m_lock);
+
+  if(!SendPending())
+  {
+    m_closing = true;
+    return false;
+  }
+  if(m_outputPos >= m_output.size() && m_closeAfter)
+  {
+    return false;
+  }
+  return true;
+}
+
+void
+HTTPConnection::Abort()
+{
+  AutoCritSec lock(&m_lock);
+  if(!m_closing)
+  {
+    m_closing = true;
+    shutdown(m_socket,SD_BOTH);
+  }
+}
+
+bool
+HTTPConnection::ResetStream(unsigned p_sequence)
+{
+  bool write = false;
+  {
+    AutoCritSec lock(&m_lock);
+    if(m_http2 == nullptr || m_closing)
+    {
+      return false;
+    }
+    m_http2->ResetStream(p_sequence,HTTP2_CANCEL,m_output);
+    ++m_nextResponse;
+    if(!SendPending())
+    {
+      m_closing = true;
+    }
+    write = m_outputPos < m_output.size();
+  }
+  if(write)
+  {
+    m_server->RequestWrite(this);
+  }
+  return true;
+}
+
+bool
+HTTPConnection::GetWantsWrite()
+{
+  AutoCritSec lock(&m_lock);
+  return m_outputPos < m_output.size();
+}
+
+bool
+HTTPConnection::GetIsIdle()
+{
+  AutoCritSec lock(&m_lock);
+  return m_nextResponse == m_nextRequest && m_output.empty() && m_input.empty() &&
+        (m_http2 == nullptr || m_http2->GetIsIdle());
+}
+
+// A streaming response waits here while the client is slower than the producer
+// Returns false if the connection closes or the client does not read in time
+bool
+HTTPConnection::WaitForOutput(size_t p_maximum,DWORD p_timeoutMS)
+{
+  ULONGLONG end = GetTickCount64() + p_timeoutMS;
+  while(true)
+  {
+    {
+      AutoCritSec lock(&m_lock);
+      if(m_closing)
+      {
+        return false;
+      }
+      size_t pending = m_output.size() - m_outputPos;
+      for(auto& slot : m_slots)
+      {
+        pending += slot.second.m_data.size();
+      }
+      if(m_http2)
+      {
+        pending += m_http2->GetPendingBytes();
+      }
+      if(pending <= p_maximum)
+      {
+        return true;
+      }
+      ResetEvent(m_drained);
+    }
+    ULONGLONG now = GetTickCount64();
+    if(now >= end)
+    {
+      return false;
+    }
+    // Short slices, so a connection that closes is noticed
+    DWORD wait = (end - now) > 250 ? 250 : (DWORD)(end - now);
+    WaitForSingleObject(m_drained,wait);
+  }
+}
+
+unsigned
+HTTPConnection::GetInFlight()
+{
+  AutoCritSec lock(&m_lock);
+  return m_nextRequest - m_nextResponse;
+}
+
+// Move the slots that are next in line to the output (lock held)
+void
+HTTPConnection::MoveReadySlots()
+{
+  while(!m_closeAfter)
+  {
+    ResponseSlots::iterator it = m_slots.find(m_nextResponse);
+    if(it == m_slots.end())
+    {
+      break;
+    }
+    ResponseSlot& slot = it->second;
+    if(m_outputPos >= m_output.size())
+    {
+      m_output.swap(slot.m_data);
+      m_outputPos = 0;
+      slot.m_data.clear();
+    }
+    else
+    {
+      m_output.append(slot.m_data);
+      slot.m_data.clear();
+    }
+    if(!slot.m_complete)
+    {
+      // Chunked or event stream response still running.
+      // Responses of later requests must wait for this one
+      break;
+    }
+    m_closeAfter = slot.m_close;
+    m_slots.erase(it);
+    ++m_nextResponse;
+  }
+  // Client has gone: close after the last answer
+  if(m_closeWhenDone && m_nextResponse == m_nextRequest)
+  {
+    m_closeAfter = true;
+  }
+}
+
+// Non-blocking send of the output (lock held). False on a socket error
+bool
+HTTPConnection::SendPending()
+{
+  while(m_outputPos < m_output.size())
+  {
+    size_t rest  = m_output.size() - m_outputPos;
+    int    chunk = rest > INT_MAX ? INT_MAX : (int) rest;
+    int    bytes = send(m_socket,m_output.data() + m_outputPos,chunk,0);
+    if(bytes > 0)
+    {
+      m_outputPos += bytes;
+      m_activity   = GetTickCount64();
+      SetEvent(m_drained);
+      continue;
+    }
+    if(SocketPoll::WouldBlock())
+    {
+      return true;
+    }
+    return false;
+  }
+  // All sent: release the memory of large responses
+  if(m_output.capacity() > (4 * HTTPCONNECTION_READSIZE))
+  {
+    std::string().swap(m_output);
+  }
+  else
+  {
+    m_output.clear();
+  }
+  m_outputPos = 0;
+  return true;
+}
@@ -0,0 +1,211 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPConnection.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "SocketPoll.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+// One TCP connection of the HTTPServerSocket.
+// The polling thread reads the raw input and parses it incrementally
+// into complete HTTP/1.1 requests. Because of HTTP pipelining, more than
+// one request can be in progress on one connection. Responses are produced
+// by the threadpool in any order, so each request gets a sequence number and
+// the responses are put on the wire strictly in the order of the requests.
+// A connection that starts with the HTTP/2 preface is handed to a HTTP2Session:
+// the requests are then streams and are answered in any order.
+
+#define HTTPCONNECTION_IDENT     0x66C0DE66
+#define HTTPCONNECTION_READSIZE  (16 * 1024)          // Bytes per 'recv'
+#define HTTPCONNECTION_MAXHEADER (32 * 1024)          // Limit on request line + headers
+#define HTTPCONNECTION_MAXBODY   (64 * 1024 * 1024)   // Limit on a request body
+#define HTTPCONNECTION_KEEPBODY  (64 * 1024)          // Body capacity kept by a reused request
+#define HTTPCONNECTION_MAXPENDING (256 * 1024)        // Output a streaming response may have waiting
+#define HTTPCONNECTION_SENDWAIT  (60 * 1000)          // Milliseconds a streaming response waits for the client
+
+class HTTPServerSocket;
+class HTTP2Session;
+
+// Result of parsing the input buffer
+enum class ParseResult
+{
+  PR_Incomplete       // Need more input
+ ,PR_Request          // One complete request parsed
+ ,PR_BadRequest       // Protocol error:   400
+ ,PR_HeaderTooLarge   // Header too large: 431
+ ,PR_BodyTooLarge     // Body too large:   413
+};
+
+// Headers the server looks up for every request
+enum class RawHeaderID
+{
+  RH_Host
+ ,RH_Connection
+ ,RH_ContentLength
+ ,RH_TransferEncoding
+ ,RH_Expect
+ ,RH_ContentType
+ ,RH_Accept
+ ,RH_AcceptEncoding
+ ,RH_Cookie
+ ,RH_Authorization
+ ,RH_IfModifiedSince
+ ,RH_Referer
+ ,RH_RemoteDesktop
+ ,RH_Count
+};
+
+// A completely parsed request from the wire
+// Names and values of the headers are kept in one block of zero terminated
+// strings, that keeps its capacity when the request object is reused.
+// The headers of RawHeaderID are indexed, finding them costs no compares.
+class RawRequest
+{
+public:
+  RawRequest();
+
+  // Empty the request for the next one, keeping the allocated storage
+  void        Reset();
+  // Add a header as found on the wire
+  void        AddHeader(const char* p_name,size_t p_nameLength,const char* p_value,size_t p_valueLength);
+  // Finding the (first) value of a header. Empty string if not present
+  const char* FindHeader(RawHeaderID p_id) const;
+  const char* FindHeader(const char* p_name) const;
+
+  // All headers in order of the wire
+  size_t      GetHeaderCount() const                { return m_headers.size();                          }
+  const char* GetHeaderName (size_t p_index) const  { return m_block.c_str() + m_headers[p_index].m_name;  }
+  const char* GetHeaderValue(size_t p_index) const  { return m_block.c_str() + m_headers[p_index].m_value; }
+
+  std::string m_verb;                     // GET, POST, etc
+  std::string m_url;                      // Absolute path and query
+  int         m_minor     { 1 };          // HTTP/1.<minor>
+  std::string m_body;                     // De-chunked body
+  bool        m_keepAlive { true };       // Connection stays open after the response
+  unsigned    m_sequence  { 0 };          // Order of the request on the connection
+
+private:
+  // Offsets of a name and a value in the block
+  struct RawHeader
+  {
+    unsigned m_name;
+    unsigned m_value;
+  };
+  std::string            m_block;         // Header names and values, zero terminated
+  std::vector<RawHeader> m_headers;       // All headers in order of the wire
+  int                    m_known[(int)RawHeaderID::RH_Count];  // Index in m_headers or -1
+};
+
+// Response bytes for one request, waiting for its turn
+typedef struct _responseSlot
+{
+  std::string m_data;                     // Serialized response part(s)
+  bool        m_complete { false };       // Last part has been given
+  bool        m_close    { false };       // Close connection after this response
+}
+ResponseSlot;
+
+using ResponseSlots = std::map<unsigned,ResponseSlot>;
+
+class HTTPConnection
+{
+public:
+  HTTPConnection(HTTPServerSocket* p_server,PollSocket p_socket,PSOCKADDR_IN6 p_sender,int p_port);
+ ~HTTPConnection();
+
+  // Reference counting: polling thread + every request in flight
+  void AddReference();
+  void DropReference();
+
+  // POLLING THREAD: Read everything the socket has for us. False on EOF/error
+  bool ReadInput();
+  // POLLING THREAD: Parse one request from the input buffer
+  ParseResult ParseRequest(RawRequest& p_request);
+  // POLLING THREAD: Reserve a sequence for an error response. Stop reading
+  unsigned RejectRequest();
+  // POLLING THREAD: Client closed its side. True if we can close right away
+  bool ShutdownInput();
+  // POLLING THREAD: Socket became writable. Flush pending output
+  bool OnWritable();
+
+  // ANY THREAD: Add response bytes for a request
+  bool QueueResponse(unsigned p_sequence,const char* p_data,size_t p_length,bool p_complete,bool p_close = false);
+  // ANY THREAD: Wait until the output waiting for the client is below a maximum
+  bool WaitForOutput(size_t p_maximum,DWORD p_timeoutMS);
+  // ANY THREAD: Shutdown the connection, no more requests/responses
+  void Abort();
+  // ANY THREAD: Cancel one request. Only possible for a HTTP/2 stream
+  bool ResetStream(unsigned p_sequence);
+
+  // GETTERS
+  bool          GetIsValid()      { return m_ident == HTTPCONNECTION_IDENT; }
+  PollSocket    GetSocket()       { return m_socket;      }
+  PSOCKADDR_IN6 GetSender()       { return &m_sender;     }
+  int           GetPort()         { return m_port;        }
+  bool          GetIsClosing()    { return m_closing;     }
+  bool          GetIsReading()    { return !m_stopReading; }
+  bool          GetIsHTTP2()      { return m_http2 != nullptr; }
+  bool          GetWantsWrite();
+  bool          GetIsIdle();
+  ULONGLONG     GetLastActivity() { return m_activity;    }
+  unsigned      GetInFlight();
+
+private:
+  bool        ParseHeaders    (RawRequest& p_request,size_t p_headerEnd);
+  ParseResult ParseChunkedBody(RawRequest& p_request,size_t& p_position);
+  ParseResult ParseHTTP2      (RawRequest& p_request);
+  bool        QueueHTTP2      (unsigned p_stream,const char* p_data,size_t p_length,bool p_complete,bool p_close);
+  void        MoveReadySlots();
+  bool        SendPending();
+
+  unsigned          m_ident    { HTTPCONNECTION_IDENT };
+  HTTPServerSocket* m_server   { nullptr };
+  PollSocket        m_socket   { POLL_INVALID_SOCKET };
+  SOCKADDR_IN6      m_sender;                         // Address of the client
+  int               m_port     { 0 };                 // Port we accepted on
+  long              m_references { 1 };               // Polling thread is the first owner
+  CRITICAL_SECTION  m_lock;                           // Locking the output
+  // Input side (polling thread only)
+  std::string       m_input;                          // Unparsed input bytes
+  unsigned          m_nextRequest { 0 };              // Sequence of next parsed request
+  bool              m_stopReading { false };          // 'Connection: close' seen
+  bool              m_continueSent{ false };          // '100 Continue' sent for current request
+  HTTP2Session*     m_http2    { nullptr };           // Connection has been upgraded to HTTP/2
+  std::deque<RawRequest> m_http2Requests;             // Complete streams, not yet dispatched
+  // Output side
+  ResponseSlots     m_slots;                          // Responses waiting for their turn
+  unsigned          m_nextResponse { 0 };             // Sequence that goes on the wire next
+  std::string       m_output;                         // Bytes ready for the wire
+  size_t            m_outputPos { 0 };                // Already sent of m_output
+  HANDLE            m_drained   { NULL };             // Set when output went out to the client
+  bool              m_closeAfter { false };           // Close when m_output is sent
+  bool              m_closeWhenDone { false };        // Close when all requests are answered
+  bool              m_closing   { false };            // Connection is being closed
+  ULONGLONG         m_activity  { 0 };                // Last moment of I/O (GetTickCount64)
+};
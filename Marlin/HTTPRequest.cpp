@@ -28,6 +28,7 @@
 #include "stdafx.h"
 #include "HTTPRequest.h"
 #include "HTTPMessage.h"
+#include "HTTPMessagePool.h"
 #include "HTTPServer.h"
 #include "HTTPSite.h"
 #include "HTTPError.h"
@@ -440,7 +441,7 @@ HTTPRequest::ReceivedRequest()
   {
     m_message->DropReference();
   }
-  m_message = new HTTPMessage(type,m_site);
+  m_message = HTTPMessagePool::Acquire(type,m_site);
   m_message->SetRequestHandle((HTTP_OPAQUE_ID)this);
   // Enter our primary information from the request
   m_message->SetURL(rawUrl);
@@ -456,7 +457,6 @@ HTTPRequest::ReceivedRequest()
   m_message->SetCookiePairs(cookie);
   m_message->SetAcceptEncoding(acceptEncoding);
   m_message->SetAllHeaders(&m_request->Headers);
-  m_message->SetUnknownHeaders(&m_request->Headers);
   m_message->SetEncoding(encoding);
 
   // Handle modified-since 
@@ -502,6 +502,8 @@ HTTPRequest::ReceivedRequest()
   // Remember the fact that we should read the rest of the message
   if((m_request->Flags & HTTP_REQUEST_FLAG_MORE_ENTITY_BODY_EXISTS) && contentLen > 0)
   {
+    // Handlers that opt in get the body while it is being read
+    m_site->StartBodyStreaming(m_message);
     // Read the body of the message, before we handle it
     StartReceiveRequest();
   }
@@ -561,11 +563,12 @@ HTTPRequest::ReceivedBodyPart()
     if(bytes)
     {
       m_readBuffer[bytes] = 0;
-      m_message->GetFileBuffer()->AddBuffer(m_readBuffer,bytes);
+      m_message->AddBody(m_readBuffer,bytes);
     }
 
     // See how far we have come, so we do not read past EOF
-    size_t readSofar = m_message->GetFileBuffer()->GetLength();
+    size_t readSofar = m_message->GetBodySink() ? m_message->GetBodyStreamed()
+                                                : m_message->GetFileBuffer()->GetLength();
     size_t mustRead  = m_message->GetContentLength();
 
     if(result == NO_ERROR && readSofar < mustRead)
@@ -594,7 +597,8 @@ HTTPRequest::PostReceive()
   m_server->LogTraceRequestBody(m_message);
 
   // In case of a POST, try to convert character set before submitting to site
-  if(m_message->GetCommand() == HTTPCommand::http_post)
+  // Not for a body that was streamed to the site handler
+  if(m_message->GetCommand() == HTTPCommand::http_post && m_message->GetBodySink() == nullptr)
   {
     if(m_message->GetContentType().Find(_T("multipart")) <= 0)
     {
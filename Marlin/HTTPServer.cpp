@@ -217,12 +217,26 @@ HTTPServer::InitLogging()
 void
 HTTPServer::InitThreadPool()
 {
-  int minThreads = m_marlinConfig->GetParameterInteger(_T("Server"),_T("MinThreads"),NUM_THREADS_MINIMUM);
-  int maxThreads = m_marlinConfig->GetParameterInteger(_T("Server"),_T("MaxThreads"),NUM_THREADS_MAXIMUM);
+  // Zero means: not configured, let the pool choose for its scheduler
+  int minThreads = m_marlinConfig->GetParameterInteger(_T("Server"),_T("MinThreads"),0);
+  int maxThreads = m_marlinConfig->GetParameterInteger(_T("Server"),_T("MaxThreads"),0);
   int stackSize  = m_marlinConfig->GetParameterInteger(_T("Server"),_T("StackSize"), THREAD_STACKSIZE);
+  XString sched  = m_marlinConfig->GetParameterString (_T("Server"),_T("Scheduler"),_T("Completion"));
+  bool affinity  = m_marlinConfig->GetParameterBoolean(_T("Server"),_T("ThreadAffinity"),false);
 
-  m_pool.TrySetMinimum(minThreads);
-  m_pool.TrySetMaximum(maxThreads);
+  if(sched.CompareNoCase(_T("WorkStealing")) == 0)
+  {
+    m_pool.SetScheduler(PoolScheduler::PS_WorkStealing);
+    m_pool.SetThreadAffinity(affinity);
+  }
+  if(minThreads > 0)
+  {
+    m_pool.TrySetMinimum(minThreads);
+  }
+  if(maxThreads > 0)
+  {
+    m_pool.TrySetMaximum(maxThreads);
+  }
   m_pool.SetStackSize(stackSize);
 }
 
@@ -1338,7 +1352,33 @@ HTTPServer::SendEvent(EventStream* p_stream
   EventToStringBuffer(p_event,&buffer,length);
 
   // Send the event to the client. This can take an I/O wait time
-  bool alive = SendResponseEventBuffer(p_stream->m_requestID,&p_stream->m_lock,&buffer,length,p_continue);
+  bool result = SendEventFrame(p_stream,buffer,length,p_continue);
+
+  // Ready with the event
+  delete[] buffer;
+  delete p_event;
+
+  return result;
+}
+
+// Send an already encoded SSE frame to a server push event stream
+// The buffer is only read, so one frame can be shared by many streams
+bool
+HTTPServer::SendEventFrame(EventStream* p_stream
+                          ,const BYTE*  p_buffer
+                          ,int          p_length
+                          ,bool         p_continue /*=true*/)
+{
+  // But we must now make sure the event stream still does exist
+  // and has not been closed by the event monitor
+  if(p_stream == nullptr || p_buffer == nullptr || !HasEventStream(p_stream))
+  {
+    return false;
+  }
+
+  // Send the event to the client. This can take an I/O wait time
+  BYTE* buffer = const_cast<BYTE*>(p_buffer);
+  bool  alive  = SendResponseEventBuffer(p_stream->m_requestID,&p_stream->m_lock,&buffer,p_length,p_continue);
 
   // Lock server as short as possible to register the return status
   // But we must now make sure the event stream still does exist
@@ -1350,19 +1390,9 @@ HTTPServer::SendEvent(EventStream* p_stream
   // Remember the time we sent the event pulse
   _time64(&(p_stream->m_lastPulse));
 
-  // Remember the highest last ID
-  if(p_event->m_id > p_stream->m_lastID)
-  {
-    p_stream->m_lastID = p_event->m_id;
-  }
-
   // Increment the chunk counter
   ++p_stream->m_chunks;
 
-  // Ready with the event
-  delete[] buffer;
-  delete p_event;
-
   // Stream not alive, or stopping
   if(!p_stream->m_alive || !p_continue)
   {
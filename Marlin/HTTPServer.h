@@ -350,6 +350,10 @@ public:
   bool       SendEvent(int p_port,XString p_site,ServerEvent* p_event,XString p_user = _T(""));
   // Send to a server push event stream on EventStream basis
   bool       SendEvent(EventStream* p_stream,ServerEvent* p_event,bool p_continue = true);
+  // Send an already encoded (shared) SSE frame to a push event stream
+  bool       SendEventFrame(EventStream* p_stream,const BYTE* p_buffer,int p_length,bool p_continue = true);
+  // Form event to a stream string (UTF-8). Caller must delete[] the buffer
+  void       EventToStringBuffer(ServerEvent* p_event,BYTE** p_buffer,int& p_length);
   // Close an event stream for one stream only
   bool       CloseEventStream(const EventStream* p_stream);
   // Close and abort an event stream for whatever reason
@@ -440,8 +444,6 @@ protected:
   void      CheckSitesStarted();
   // Make a "port:url" registration name
   XString   MakeSiteRegistrationName(int p_port,XString p_url);
-    // Form event to a stream string
-  void      EventToStringBuffer(ServerEvent* p_event,BYTE** p_buffer,int& p_length);
   // Try to start the even heartbeat monitor
   void      TryStartEventHeartbeat();
   // Check all event streams for the heartbeat monitor
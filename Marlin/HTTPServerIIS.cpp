@@ -549,7 +549,6 @@ HTTPServerIIS::GetHTTPMessageFromRequest(IHttpContext* p_context
   message->SetContentType(contentType);
   message->SetContentLength((size_t)_ttoll(contentLength));
   message->SetAllHeaders(&p_request->Headers);
-  message->SetUnknownHeaders(&p_request->Headers);
   message->SetEncoding(encoding);
 
   // Finding the impersonation access token (if any)
@@ -656,17 +655,18 @@ HTTPServerIIS::ReceiveIncomingRequest(HTTPMessage* p_message,Encoding p_encoding
       ERRORLOG(HRESULT_FROM_WIN32(hr),_T("Cannot read incoming HTTP buffer"));
       return false;
     }
-    // Add to file buffer
+    // Add to file buffer (or to the streaming body sink)
     if(received > 0)
     {
-      fbuffer->AddBuffer(bytebuffer,received);
+      p_message->AddBody(bytebuffer,received);
     }
   }
   delete[] bytebuffer;
 
     // Check if we received the total predicted message
   // This includes all blocks from initial chunk and extra reads
-  if(fbuffer->GetLength() < contentLength)
+  size_t totalRead = p_message->GetBodySink() ? p_message->GetBodyStreamed() : fbuffer->GetLength();
+  if(totalRead < contentLength)
   {
       ERRORLOG(ERROR_INVALID_DATA,_T("Total received message shorter dan 'ContentLength' header."));
   }
@@ -0,0 +1,1570 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPServerSocket.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "HTTPServerSocket.h"
+#include "HTTPServerSync.h"
+#include "HTTPSiteSocket.h"
+#include "AutoCritical.h"
+#include "WebServiceServer.h"
+#include "HTTPError.h"
+#include "HTTPTime.h"
+#include "HTTPMessagePool.h"
+#include "ConvertWideString.h"
+#include "WinSocket.h"
+#include <assert.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Logging macro's
+#define DETAILLOG1(text)          if(MUSTLOG(HLL_LOGGING) && m_log) { DetailLog (_T(__FUNCTION__),LogType::LOG_INFO,text); }
+#define DETAILLOGS(text,extra)    if(MUSTLOG(HLL_LOGGING) && m_log) { DetailLogS(_T(__FUNCTION__),LogType::LOG_INFO,text,extra); }
+#define DETAILLOGV(text,...)      if(MUSTLOG(HLL_LOGGING) && m_log) { DetailLogV(_T(__FUNCTION__),LogType::LOG_INFO,text,__VA_ARGS__); }
+#define WARNINGLOG(text,...)      if(MUSTLOG(HLL_LOGGING) && m_log) { DetailLogV(_T(__FUNCTION__),LogType::LOG_WARN,text,__VA_ARGS__); }
+#define ERRORLOG(code,text)       ErrorLog (_T(__FUNCTION__),code,text)
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Threadpool callbacks
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Handle a message and make sure it gets answered.
+// On a pipelined connection an unanswered request would block
+// all responses of the requests after it.
+static void 
+HTTPSiteCallbackSocket(void* p_argument)
+{
+  HTTPMessage* message = reinterpret_cast<HTTPMessage*>(p_argument);
+  HTTPSite*    site    = message->GetHTTPSite();
+
+  // Keep the message for the check after the handlers
+  message->AddReference();
+
+  LPFN_CALLBACK callback = site->GetCallback();
+  if(callback)
+  {
+    (*callback)(message);
+  }
+  else
+  {
+    site->HandleHTTPMessage(message);
+  }
+  if(!message->GetHasBeenAnswered() && message->GetChunkNumber() == 0)
+  {
+    message->Reset();
+    message->GetFileBuffer()->Reset();
+    message->SetStatus(HTTP_STATUS_SERVER_ERROR);
+    site->GetHTTPServer()->SendResponse(message);
+  }
+  message->DropReference();
+}
+
+static unsigned int
+__stdcall StartingThePollingLoop(void* pParam)
+{
+  HTTPServerSocket* server = reinterpret_cast<HTTPServerSocket*>(pParam);
+  server->RunPollingLoop();
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The Server
+//
+//////////////////////////////////////////////////////////////////////////
+
+HTTPServerSocket::HTTPServerSocket(XString p_name)
+                 :HTTPServer(p_name)
+{
+  // Default Marlin.config
+  m_marlinConfig = new MarlinConfig();
+
+  InitializeCriticalSection(&m_queueLock);
+}
+
+HTTPServerSocket::~HTTPServerSocket()
+{
+  // Cleanup the server objects
+  HTTPServerSocket::Cleanup();
+
+  DeleteCriticalSection(&m_queueLock);
+}
+
+XString
+HTTPServerSocket::GetVersion()
+{
+  return XString(_T(MARLIN_SERVER_VERSION) _T(" on sockets"));
+}
+
+// Initialise a HTTP server
+bool
+HTTPServerSocket::Initialise()
+{
+  AutoCritSec lock(&m_sitesLock);
+
+  // See if there is something to do!
+  if(m_initialized)
+  {
+    return true;
+  }
+
+  // STEP 1: LOGGING
+  // Init logging, so we can complain about errors
+  InitLogging();
+
+  // STEP 2: CHECKING OF SETTINGS
+  if(GeneralChecks() == false)
+  {
+    return false;
+  }
+
+  // STEP 3: INIT THE SOCKET LIBRARY
+  if(!MarlinStartupWinsocket())
+  {
+    ERRORLOG(WSAGetLastError(),_T("Cannot start the WinSock library"));
+    return false;
+  }
+
+  // STEP 4: CREATE THE POLLING SET
+  if(!m_poll.Open())
+  {
+    ERRORLOG(ERROR_INVALID_HANDLE,_T("Cannot create the socket polling set"));
+    return false;
+  }
+  DETAILLOG1(_T("Socket polling set created"));
+
+  // STEP 5: CONNECTION LIMITS
+  m_keepAliveTimeout = m_marlinConfig->GetParameterInteger(_T("Server"),_T("KeepAliveTimeout"),m_keepAliveTimeout);
+  m_maxConnections   = m_marlinConfig->GetParameterInteger(_T("Server"),_T("MaxConnections"),  m_maxConnections);
+  m_sharedListeners  = m_marlinConfig->GetParameterBoolean(_T("Server"),_T("SharedListeners"), m_sharedListeners);
+  m_http2            = m_marlinConfig->GetParameterBoolean(_T("Server"),_T("HTTP2"),           m_http2);
+  DETAILLOGV(_T("Keep-alive timeout: %d seconds. Maximum connections: %d"),m_keepAliveTimeout,m_maxConnections);
+  DETAILLOGS(_T("HTTP/2 (h2c) on the connections: "),m_http2 ? _T("yes") : _T("no"));
+
+  // STEP 6: SET UP THE HARD LIMITS
+  InitHardLimits();
+
+  // STEP 7: Init the response headers to send
+  InitEventstreamKeepalive();
+
+  // STEP 8: Init the response headers to send
+  InitHeaders();
+
+  // STEP 9: Init the threadpool
+  InitThreadPool();
+
+  // We are airborne!
+  return (m_initialized = true);
+}
+
+// Cleanup the server
+void
+HTTPServerSocket::Cleanup()
+{
+  AutoCritSec lock1(&m_sitesLock);
+  AutoCritSec lock2(&m_eventLock);
+
+  // Remove all event streams within the scope of the eventLock
+  for(const auto& it : m_eventStreams)
+  {
+    delete it.second;
+  }
+  m_eventStreams.clear();
+
+  // Remove all services
+  while(!m_allServices.empty())
+  {
+    ServiceMap::iterator it = m_allServices.begin();
+    it->second->Stop();
+  }
+
+  // Remove all URL's in the sites map
+  while(!m_allsites.empty())
+  {
+    SiteMap::iterator it = m_allsites.begin();
+    it->second->StopSite(true);
+  }
+
+  // No more connections, when the polling loop has ended
+  if(m_pollThread == NULL)
+  {
+    CloseAllConnections();
+    CloseListeners();
+    m_poll.Close();
+  }
+  m_initialized = false;
+
+  // Closing the logging file
+  if(m_log && m_logOwner)
+  {
+    HANDLE writer = m_log->GetBackgroundWriterThread();
+    LogAnalysis::DeleteLogfile(m_log);
+    m_log = nullptr;
+
+    if(writer)
+    {
+      WaitForSingleObject(writer,10 * CLOCKS_PER_SEC);
+    }
+  }
+}
+
+// Initialise general server header settings
+void
+HTTPServerSocket::InitHeaders()
+{
+  XString name = m_marlinConfig->GetParameterString(_T("Server"),_T("ServerName"),    _T(""));
+  XString type = m_marlinConfig->GetParameterString(_T("Server"),_T("TypeServerName"),_T("Hide"));
+
+  // Server name combo. There is no driver to add a 'Microsoft' server header
+  if(type.CompareNoCase(_T("Microsoft"))   == 0) m_sendHeader = SendHeader::HTTP_SH_MARLIN;
+  if(type.CompareNoCase(_T("Marlin"))      == 0) m_sendHeader = SendHeader::HTTP_SH_MARLIN;
+  if(type.CompareNoCase(_T("Application")) == 0) m_sendHeader = SendHeader::HTTP_SH_APPLICATION;
+  if(type.CompareNoCase(_T("Configured"))  == 0) m_sendHeader = SendHeader::HTTP_SH_WEBCONFIG;
+  if(type.CompareNoCase(_T("Hide"))        == 0) m_sendHeader = SendHeader::HTTP_SH_HIDESERVER;
+
+  if(m_sendHeader == SendHeader::HTTP_SH_WEBCONFIG)
+  {
+    m_configServerName = name;
+    DETAILLOGS(_T("Server sends 'server' response header of type: "),name);
+  }
+  else
+  {
+    DETAILLOGS(_T("Server sends 'server' response header: "),type);
+  }
+}
+
+// Create a site to bind the traffic to
+HTTPSite*
+HTTPServerSocket::CreateSite(PrefixType    p_type
+                            ,bool          p_secure
+                            ,int           p_port
+                            ,XString       p_baseURL
+                            ,bool          p_subsite  /* = false */
+                            ,LPFN_CALLBACK p_callback /* = NULL  */)
+{
+  // Getting the settings from the Marlin.config, use parameters as defaults
+  int     chanPort = m_marlinConfig->GetParameterInteger(_T("Server"),_T("Port"),   p_port);
+  XString chanBase = m_marlinConfig->GetParameterString (_T("Server"),_T("BaseURL"),p_baseURL);
+
+  // No TLS on the socket server (yet)
+  if(p_secure || m_marlinConfig->GetParameterBoolean(_T("Server"),_T("Secure"),false))
+  {
+    ERRORLOG(ERROR_INVALID_PARAMETER,_T("Secure sites (HTTPS) not supported by the socket server. Use a TLS terminating proxy."));
+    return nullptr;
+  }
+
+  // Only ports out of IANA/IETF range permitted!
+  if(chanPort >= 1024 || chanPort == INTERNET_DEFAULT_HTTP_PORT)
+  {
+    p_port = chanPort;
+  }
+  // Only use other URL if one specified
+  if(!chanBase.IsEmpty())
+  {
+    p_baseURL = chanBase;
+  }
+
+  // Create our URL prefix. A socket listens on all addresses of the machine
+  XString prefix = CreateURLPrefix(PrefixType::URLPRE_Weak,false,p_port,p_baseURL);
+  if(!prefix.IsEmpty())
+  {
+    HTTPSite* mainSite = nullptr;
+    if(p_subsite)
+    {
+      // Do sub-site lookup on receiving messages
+      m_hasSubsites = true;
+      // Finding the main site of this sub-site
+      mainSite = FindHTTPSite(p_port,p_baseURL);
+      if(mainSite == nullptr)
+      {
+        // No luck: No main site to register against
+        XString message;
+        message.Format(_T("Tried to register a sub-site, without a main-site: %s"),p_baseURL.GetString());
+        ERRORLOG(ERROR_NOT_FOUND,message);
+        return nullptr;
+      }
+      mainSite->SetHasSubSites(true);
+    }
+    // Create and register a URL
+    HTTPSiteSocket* registeredSite = new HTTPSiteSocket(this,p_port,p_baseURL,prefix,mainSite,p_callback);
+    if(RegisterSite(registeredSite,prefix))
+    {
+      // Site created and registered
+      return registeredSite;
+    }
+    delete registeredSite;
+  }
+  // No luck
+  return nullptr;
+}
+
+// Delete a site from the remembered set of sites
+bool
+HTTPServerSocket::DeleteSite(int p_port,XString p_baseURL,bool /*p_force = false*/)
+{
+  AutoCritSec lock(&m_sitesLock);
+  bool result = false;
+
+  // Use counter
+  m_counter.Start();
+
+  XString search(MakeSiteRegistrationName(p_port,p_baseURL));
+  SiteMap::iterator it = m_allsites.find(search);
+  if(it != m_allsites.end())
+  {
+    // Finding our site
+    HTTPSite* site = it->second;
+
+    // See if other sites are dependent on this one
+    if(site->GetHasSubSites())
+    {
+      // Walk all sites, to see if sub-sites still dependent on this main site
+      for(SiteMap::iterator fit = m_allsites.begin(); fit != m_allsites.end(); ++fit)
+      {
+        if(fit->second->GetMainSite() == site)
+        {
+          fit->second->StopSite(true);
+          fit = m_allsites.begin();
+        }
+      }
+    }
+    // No URL groups: just remove from the site map
+    // Listeners stay open until the server stops
+    delete site;
+    m_allsites.erase(it);
+    result = true;
+  }
+  // Use counter
+  m_counter.Stop();
+
+  return result;
+}
+
+// Open a listening socket for a port (once per port)
+bool
+HTTPServerSocket::StartListener(int p_port)
+{
+  AutoCritSec lock(&m_sitesLock);
+
+  if(m_listeners.find(p_port) != m_listeners.end())
+  {
+    return true;
+  }
+  if(!Initialise())
+  {
+    return false;
+  }
+
+  // Dual stack socket: IPv6 and IPv4 mapped addresses
+  PollSocket listener = socket(AF_INET6,SOCK_STREAM,IPPROTO_TCP);
+  if(listener == POLL_INVALID_SOCKET)
+  {
+    ERRORLOG(ERROR_INVALID_HANDLE,_T("Cannot create a listening socket"));
+    return false;
+  }
+  int off = 0;
+  setsockopt(listener,IPPROTO_IPV6,IPV6_V6ONLY,(const char*)&off,sizeof(int));
+  // Shared listeners are inherited from the ServerSupervisor (see AdoptListener)
+  BOOL exclusive = TRUE;
+  setsockopt(listener,SOL_SOCKET,SO_EXCLUSIVEADDRUSE,(const char*)&exclusive,sizeof(BOOL));
+
+  sockaddr_in6 address;
+  memset(&address,0,sizeof(sockaddr_in6));
+  address.sin6_family = AF_INET6;
+  address.sin6_addr   = in6addr_any;
+  address.sin6_port   = htons((unsigned short)p_port);
+
+  if(bind(listener,(sockaddr*)&address,sizeof(sockaddr_in6)) != 0 ||
+     listen(listener,SOCKET_LISTEN_BACKLOG) != 0 ||
+     !SocketPoll::SetNonBlocking(listener))
+  {
+    XString error;
+    error.Format(_T("Cannot listen on port: %d"),p_port);
+    ERRORLOG(ERROR_ADDRESS_ALREADY_ASSOCIATED,error);
+    SocketPoll::CloseSocket(listener);
+    return false;
+  }
+  RegisterListener(listener,p_port);
+  return true;
+}
+
+// Take over a listening socket, created by another process (ServerSupervisor)
+bool
+HTTPServerSocket::AdoptListener(int p_port,PollSocket p_socket)
+{
+  AutoCritSec lock(&m_sitesLock);
+
+  if(m_listeners.find(p_port) != m_listeners.end() || !Initialise())
+  {
+    return false;
+  }
+  if(!SocketPoll::SetNonBlocking(p_socket))
+  {
+    ERRORLOG(ERROR_INVALID_HANDLE,_T("Cannot take over a listening socket"));
+    return false;
+  }
+  RegisterListener(p_socket,p_port);
+  return true;
+}
+
+// Stop accepting connections and finish the current ones (any thread)
+// Other processes on the same port will take over the new connections
+void
+HTTPServerSocket::StopListening()
+{
+  DETAILLOG1(_T("Draining: no more new connections"));
+  m_draining = true;
+  m_poll.WakeUp();
+}
+
+// Register a listener in the polling set
+void
+HTTPServerSocket::RegisterListener(PollSocket p_socket,int p_port)
+{
+  SocketListener* socketListener = new SocketListener();
+  socketListener->m_socket = p_socket;
+  socketListener->m_port   = p_port;
+  m_listeners[p_port] = socketListener;
+  m_poll.Add(p_socket,socketListener,POLL_READ);
+
+  DETAILLOGV(_T("Listening on port: %d"),p_port);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// RUNNING THE SERVER
+//
+//////////////////////////////////////////////////////////////////////////
+
+void
+HTTPServerSocket::Run()
+{
+  // Do all initialization
+  Initialise();
+
+  // See if we are in a state to receive requests
+  if(!m_initialized)
+  {
+    ERRORLOG(ERROR_INVALID_PARAMETER,_T("RunHTTPServer called too early"));
+    return;
+  }
+  DETAILLOG1(_T("HTTPServer initialised and ready to go!"));
+
+  // Check if all sites were properly started
+  // Catches programmers who forget to call HTTPSite::StartSite()
+  CheckSitesStarted();
+
+  // Start the workers for the requests
+  m_pool.Run();
+
+  if(m_pollThread == NULL)
+  {
+    // Base thread of the server
+    unsigned int threadID;
+    if((m_pollThread = reinterpret_cast<HANDLE>(_beginthreadex(NULL,0,StartingThePollingLoop,reinterpret_cast<void *>(this),0,&threadID))) == INVALID_HANDLE_VALUE)
+    {
+      m_pollThread = NULL;
+      ERRORLOG(::GetLastError(),_T("Cannot create a thread for the socket server."));
+    }
+  }
+}
+
+// Running the polling loop of the server
+void
+HTTPServerSocket::RunPollingLoop()
+{
+  // Install SEH to regular exception translator
+  _set_se_translator(SeTranslator);
+
+  PollEvent* events = new PollEvent[POLL_MAX_EVENTS];
+  ULONGLONG lastCheck = GetTickCount64();
+
+  // START OUR MAIN LOOP
+  m_running = true;
+  DETAILLOG1(_T("HTTPServer entering polling loop"));
+
+  while(m_running)
+  {
+    int number = m_poll.Wait(events,POLL_MAX_EVENTS,1000);
+    if(number < 0)
+    {
+      ERRORLOG(ERROR_INVALID_HANDLE,_T("Polling the sockets failed"));
+      break;
+    }
+    m_counter.Start();
+
+    for(int index = 0;index < number;++index)
+    {
+      PollEvent& event = events[index];
+
+      // Readiness of a connection, or else an incoming connection on one of our ports
+      HTTPConnection* connection = reinterpret_cast<HTTPConnection*>(event.m_context);
+      if(m_connections.find(connection) == m_connections.end())
+      {
+        SocketListener* listener = FindListener(event.m_context);
+        if(listener)
+        {
+          AcceptConnections(listener);
+        }
+        continue;
+      }
+      if(event.m_events & POLL_READ)
+      {
+        HandleInput(connection);
+        if(m_connections.find(connection) == m_connections.end())
+        {
+          continue;
+        }
+      }
+      if(event.m_events & POLL_WRITE)
+      {
+        if(!connection->OnWritable())
+        {
+          CloseConnection(connection);
+          continue;
+        }
+        if(!connection->GetWantsWrite())
+        {
+          m_poll.Modify(connection->GetSocket(),connection,connection->GetIsReading() ? POLL_READ : 0);
+        }
+      }
+      if((event.m_events & POLL_CLOSED) && !(event.m_events & POLL_READ))
+      {
+        CloseConnection(connection);
+      }
+    }
+
+    // Requests from the worker threads
+    HandleQueues();
+
+    // Draining: the listeners are closed in the polling thread
+    if(m_draining && !m_listeners.empty())
+    {
+      CloseListeners();
+    }
+
+    // Once per second: remove idle keep-alive connections
+    if((GetTickCount64() - lastCheck) > 1000)
+    {
+      CheckIdleConnections();
+      lastCheck = GetTickCount64();
+    }
+    m_counter.Stop();
+  }
+  delete [] events;
+
+  // Last actions in the polling thread
+  CloseAllConnections();
+  CloseListeners();
+  m_pollThread = NULL;
+
+  // Cleaning up the thread
+  _endthreadex(0);
+}
+
+// Find the listener of a polling context. Sites can start while we are polling
+SocketListener*
+HTTPServerSocket::FindListener(void* p_context)
+{
+  AutoCritSec lock(&m_sitesLock);
+
+  for(auto& listener : m_listeners)
+  {
+    if(listener.second == p_context)
+    {
+      return listener.second;
+    }
+  }
+  return nullptr;
+}
+
+// Accept all waiting connections of a listener
+void
+HTTPServerSocket::AcceptConnections(SocketListener* p_listener)
+{
+  while(true)
+  {
+    sockaddr_in6 address;
+    memset(&address,0,sizeof(sockaddr_in6));
+    int length = sizeof(sockaddr_in6);
+    PollSocket socket = accept(p_listener->m_socket,(sockaddr*)&address,&length);
+    if(socket == POLL_INVALID_SOCKET)
+    {
+      // Would block or error. Both: wait for the next readiness
+      break;
+    }
+    if(m_connectionCount >= m_maxConnections || !m_running)
+    {
+      WARNINGLOG(_T("Maximum number of connections reached: %d"),m_maxConnections);
+      SocketPoll::CloseSocket(socket);
+      continue;
+    }
+    SocketPoll::SetNonBlocking(socket);
+    SocketPoll::SetNoDelay(socket);
+
+    HTTPConnection* connection = new HTTPConnection(this,socket,(PSOCKADDR_IN6)&address,p_listener->m_port);
+    m_connections.insert(connection);
+    InterlockedIncrement(&m_connectionCount);
+
+    if(!m_poll.Add(socket,connection,POLL_READ))
+    {
+      CloseConnection(connection);
+    }
+  }
+}
+
+// Read and parse all input of a connection
+void
+HTTPServerSocket::HandleInput(HTTPConnection* p_connection)
+{
+  bool alive = p_connection->ReadInput();
+
+  // Dispatch all complete requests (pipelining)
+  ParseResult result;
+  while(p_connection->GetIsReading())
+  {
+    result = p_connection->ParseRequest(m_rawRequest);
+    if(result == ParseResult::PR_Request)
+    {
+      DispatchRequest(p_connection,m_rawRequest);
+      continue;
+    }
+    if(result != ParseResult::PR_Incomplete)
+    {
+      int status = HTTP_STATUS_BAD_REQUEST;
+      if(result == ParseResult::PR_HeaderTooLarge) status = HTTP_STATUS_HEADERS_TOO_LARGE;
+      if(result == ParseResult::PR_BodyTooLarge)   status = HTTP_STATUS_REQUEST_TOO_LARGE;
+      SendProtocolError(p_connection,p_connection->RejectRequest(),status);
+    }
+    break;
+  }
+
+  if(!alive)
+  {
+    // Client has closed its side. Answer the requests in flight first
+    if(p_connection->ShutdownInput() || p_connection->GetIsClosing())
+    {
+      CloseConnection(p_connection);
+    }
+    else
+    {
+      // Stop the level triggered end-of-file from firing
+      m_poll.Modify(p_connection->GetSocket(),p_connection,p_connection->GetWantsWrite() ? POLL_WRITE : 0);
+    }
+  }
+}
+
+// Translate a raw request to a HTTPMessage and dispatch it
+void
+HTTPServerSocket::DispatchRequest(HTTPConnection* p_connection,RawRequest& p_request)
+{
+  InterlockedIncrement(&m_requestCount);
+
+  // Host is mandatory in HTTP/1.1 (RFC 9112 3.2)
+  XString host = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_Host));
+  if(host.IsEmpty())
+  {
+    if(p_request.m_minor >= 1)
+    {
+      SendProtocolError(p_connection,p_request.m_sequence,HTTP_STATUS_BAD_REQUEST,!p_request.m_keepAlive);
+      return;
+    }
+    host.Format(_T("%s:%d"),m_hostName.GetString(),p_connection->GetPort());
+  }
+  XString absPath = LPCSTRToString(p_request.m_url.c_str());
+  XString rawUrl  = absPath;
+  if(absPath.Left(7).CompareNoCase(_T("http://")) == 0)
+  {
+    // Absolute form of the request target
+    int pos = absPath.Find('/',7);
+    absPath = pos > 0 ? absPath.Mid(pos) : XString(_T("/"));
+  }
+  else
+  {
+    rawUrl = _T("http://") + host + absPath;
+  }
+
+  // Find the site by longest match
+  HTTPSite* site = FindHTTPSite(p_connection->GetPort(),absPath);
+  if(site == nullptr)
+  {
+    SendProtocolError(p_connection,p_request.m_sequence,HTTP_STATUS_NOT_FOUND,!p_request.m_keepAlive);
+    return;
+  }
+  LPFN_CALLBACK callback    = site->GetCallback();
+  bool          eventStream = site->GetIsEventStream();
+
+  // Log earliest as possible
+  DETAILLOGV(_T("Received HTTP %s call from [%s] with length: %I64u for: %s")
+            ,LPCSTRToString(p_request.m_verb.c_str()).GetString()
+            ,SocketToServer(p_connection->GetSender()).GetString()
+            ,(unsigned __int64)p_request.m_body.size()
+            ,rawUrl.GetString());
+
+  // Translate the verb
+  HTTPMessage* message = HTTPMessagePool::Acquire(HTTPCommand::http_no_command,site);
+  if(!message->SetVerb(LPCSTRToString(p_request.m_verb.c_str())))
+  {
+    message->DropReference();
+    SendProtocolError(p_connection,p_request.m_sequence,HTTP_STATUS_NOT_SUPPORTED,!p_request.m_keepAlive);
+    return;
+  }
+  HTTPCommand type = message->GetCommand();
+
+  // Our request identity for the response
+  SocketRequest* request = new SocketRequest();
+  request->m_connection  = p_connection;
+  request->m_sequence    = p_request.m_sequence;
+  request->m_keepAlive   = p_request.m_keepAlive && !m_draining;
+  request->m_isHead      = (type == HTTPCommand::http_head);
+  p_connection->AddReference();
+
+  // Grab the senders content
+  XString acceptTypes    = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_Accept));
+  XString contentType    = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_ContentType));
+  XString acceptEncoding = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_AcceptEncoding));
+  XString cookie         = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_Cookie));
+  XString authorize      = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_Authorization));
+  XString modified       = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_IfModifiedSince));
+  XString referrer       = LPCSTRToString(p_request.FindHeader(RawHeaderID::RH_Referer));
+  int     remDesktop     = atoi(p_request.FindHeader(RawHeaderID::RH_RemoteDesktop));
+
+  // Find our charset
+  Encoding encoding = Encoding::EN_ACP;
+  XString  charset  = FindCharsetInContentType(contentType);
+  if(!charset.IsEmpty())
+  {
+    encoding = (Encoding)CharsetToCodepage(charset);
+  }
+
+  // Receiving the initiation of an event stream for the server
+  acceptTypes.Trim();
+  EventStream* stream = nullptr;
+  if((type == HTTPCommand::http_get) && (eventStream || acceptTypes.Left(17).CompareNoCase(_T("text/event-stream")) == 0))
+  {
+    if(CheckUnderDDOSAttack(p_connection->GetSender(),absPath))
+    {
+      message->DropReference();
+      ReleaseRequest(request);
+      SendProtocolError(p_connection,p_request.m_sequence,HTTP_STATUS_SERVICE_UNAVAIL,true);
+      return;
+    }
+    stream = SubscribeEventStream(p_connection->GetSender()
+                                 ,remDesktop
+                                 ,site
+                                 ,site->GetSite()
+                                 ,absPath
+                                 ,(HTTP_OPAQUE_ID)request
+                                 ,NULL);
+    if(stream == nullptr)
+    {
+      message->DropReference();
+      ReleaseRequest(request);
+      SendProtocolError(p_connection,p_request.m_sequence,HTTP_STATUS_SERVER_ERROR,true);
+      return;
+    }
+  }
+
+  // For all types of requests: Create the HTTPMessage
+  message->SetURL(rawUrl);
+  message->SetReferrer(referrer);
+  message->SetAuthorization(authorize);
+  message->SetRequestHandle((HTTP_OPAQUE_ID)request);
+  message->SetConnectionID((HTTP_CONNECTION_ID)p_connection);
+  message->SetSender(p_connection->GetSender());
+  message->SetRemoteDesktop(remDesktop);
+  message->SetCookiePairs(cookie);
+  message->SetAcceptEncoding(acceptEncoding);
+  message->SetContentType(contentType);
+  message->SetContentLength(p_request.m_body.size());
+  message->SetEncoding(encoding);
+  for(size_t ind = 0; ind < p_request.GetHeaderCount(); ++ind)
+  {
+    message->AddHeader(LPCSTRToString(p_request.GetHeaderName(ind)),LPCSTRToString(p_request.GetHeaderValue(ind)));
+  }
+
+  // Handle modified-since 
+  // Rest of the request is then not needed any more
+  if(type == HTTPCommand::http_get && !modified.IsEmpty() && stream == nullptr)
+  {
+    message->SetHTTPTime(modified);
+    if(DoIsModifiedSince(message))
+    {
+      // Answer already sent, go on to the next request
+      message->DropReference();
+      return;
+    }
+  }
+
+  // Find routing information within the site
+  CalculateRouting(site,message);
+
+  // Find X-HTTP-Method VERB Tunneling
+  if(type == HTTPCommand::http_post && site->GetVerbTunneling())
+  {
+    if(message->FindVerbTunneling())
+    {
+      DETAILLOGV(_T("Request VERB changed to: %s"),message->GetVerb().GetString());
+    }
+  }
+
+  if(stream)
+  {
+    // Remember our URL
+    stream->m_baseURL = rawUrl;
+    // Create callback structure
+    MsgStream* dispatch = new MsgStream();
+    dispatch->m_message = message;
+    dispatch->m_stream  = stream;
+    // Check for a correct callback
+    callback = callback ? callback : HTTPSiteCallbackEvent;
+    m_pool.SubmitWork(callback,reinterpret_cast<void*>(dispatch));
+    return;
+  }
+
+  // The body is already complete. Convert it on the worker thread
+  if(!p_request.m_body.empty())
+  {
+    message->AddBody((void*)p_request.m_body.data(),(unsigned)p_request.m_body.size());
+  }
+  message->SetReadBuffer(true);
+
+  // Hit the thread pool with this message
+  m_pool.SubmitWork(HTTPSiteCallbackSocket,reinterpret_cast<void*>(message));
+}
+
+// The body has been read by the polling thread already
+bool
+HTTPServerSocket::ReceiveIncomingRequest(HTTPMessage* p_message,Encoding p_encoding)
+{
+  // In case of a POST, try to convert character set before submitting to site
+  if(p_message->GetCommand() == HTTPCommand::http_post)
+  {
+    if(p_message->GetContentType().Find(_T("multipart")) <= 0)
+    {
+      HandleTextContent(p_message);
+    }
+  }
+  DETAILLOGV(_T("Received %s message from: %s Size: %lu")
+            ,headers[static_cast<unsigned>(p_message->GetCommand())]
+            ,SocketToServer(p_message->GetSender()).GetString()
+            ,p_message->GetBodyLength());
+
+  // This message is read!
+  p_message->SetReadBuffer(false);
+
+  // Now also trace the request body of the message
+  LogTraceRequestBody(p_message,p_encoding);
+
+  return true;
+}
+
+// Respond directly from the polling thread on a protocol error
+void
+HTTPServerSocket::SendProtocolError(HTTPConnection* p_connection
+                                   ,unsigned        p_sequence
+                                   ,int             p_status
+                                   ,bool            p_close /*=true*/)
+{
+  char response[256];
+  AutoCSTR reason(GetHTTPStatusText(p_status));
+  int length = sprintf_s(response,256,"HTTP/1.1 %d %s\r\nContent-Length: 0\r\n%s\r\n"
+                        ,p_status
+                        ,reason.cstr()
+                        ,p_close ? "Connection: close\r\n" : "");
+  p_connection->QueueResponse(p_sequence,response,length,true,p_close);
+  DETAILLOGV(_T("Protocol error on connection: HTTP %d"),p_status);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// RESPONSES
+//
+//////////////////////////////////////////////////////////////////////////
+
+SocketRequest*
+HTTPServerSocket::GetSocketRequest(HTTP_OPAQUE_ID p_request)
+{
+  SocketRequest* request = reinterpret_cast<SocketRequest*>(p_request);
+  if(request && request->m_ident == SOCKETREQUEST_IDENT)
+  {
+    return request;
+  }
+  return nullptr;
+}
+
+// Response is complete: release the request
+void
+HTTPServerSocket::ReleaseRequest(SocketRequest* p_request)
+{
+  p_request->m_ident = 0;
+  p_request->m_connection->DropReference();
+  delete p_request;
+}
+
+// Serialize the status line and headers of a response
+void
+HTTPServerSocket::SerializeHeaders(HTTPMessage*   p_message
+                                  ,SocketRequest* p_request
+                                  ,std::string&   p_output
+                                  ,size_t         p_length
+                                  ,bool           p_chunked)
+{
+  int       status = p_message->GetStatus();
+  HTTPSite* site   = p_message->GetHTTPSite();
+  XString   headers;
+
+  // Status line
+  headers.Format(_T("HTTP/1.1 %d %s\r\n"),status,GetHTTPStatusText(status));
+  headers += _T("Date: ") + HTTPGetSystemTime() + _T("\r\n");
+
+  // Add content type (octet-stream or the message content type)
+  XString contentType(_T("application/octet-stream"));
+  if(!p_message->GetContentType().IsEmpty())
+  {
+    contentType = p_message->GetContentType();
+  }
+  else
+  {
+    XString cttype = p_message->GetHeader(_T("Content-type"));
+    if(!cttype.IsEmpty())
+    {
+      contentType = cttype;
+    }
+  }
+  headers += _T("Content-Type: ") + contentType + _T("\r\n");
+
+  // In case of a 401, we challenge to the client to identify itself
+  if(status == HTTP_STATUS_DENIED && !p_message->GetXMLHttpRequest() && site)
+  {
+    XString challenge = p_message->GetHeader(_T("AuthenticationScheme"));
+    if(challenge.IsEmpty())
+    {
+      challenge = BuildAuthenticationChallenge(site->GetAuthenticationScheme(),site->GetAuthenticationRealm());
+      headers += _T("WWW-Authenticate: ") + challenge + _T("\r\n");
+    }
+  }
+
+  // Add the server header or suppress it
+  switch(m_sendHeader)
+  {
+    case SendHeader::HTTP_SH_MICROSOFT:   // Fall through: no driver to do it for us
+    case SendHeader::HTTP_SH_MARLIN:      headers += _T("Server: ") _T(MARLIN_SERVER_VERSION) _T("\r\n");
+                                          break;
+    case SendHeader::HTTP_SH_APPLICATION: headers += _T("Server: ") + m_name + _T("\r\n");
+                                          break;
+    case SendHeader::HTTP_SH_WEBCONFIG:   headers += _T("Server: ") + m_configServerName + _T("\r\n");
+                                          break;
+    case SendHeader::HTTP_SH_HIDESERVER:  break;
+  }
+
+  // Add cookies, applying the cookie settings of the site
+  UKHeaders ukheaders;
+  Cookies& cookies = p_message->GetCookies();
+  if(cookies.GetCookies().empty())
+  {
+    XString cookie = p_message->GetHeader(_T("Set-Cookie"));
+    if(!cookie.IsEmpty())
+    {
+      ukheaders.push_back(UKHeader(_T("Set-Cookie"),cookie));
+    }
+  }
+  else if(site)
+  {
+    for(auto& cookie : cookies.GetCookies())
+    {
+      if(site->GetCookieHasSecure())    cookie.SetSecure  (site->GetCookiesSecure());
+      if(site->GetCookieHasHttpOnly())  cookie.SetHttpOnly(site->GetCookiesHttpOnly());
+      if(site->GetCookieHasSameSite())  cookie.SetSameSite(site->GetCookiesSameSite());
+      if(site->GetCookieHasPath())      cookie.SetPath    (site->GetCookiesPath());
+      if(site->GetCookieHasDomain())    cookie.SetDomain  (site->GetCookiesDomain());
+      if(site->GetCookieHasMaxAge())    cookie.SetMaxAge  (site->GetCookiesMaxAge());
+      if(site->GetCookieHasExpires() && site->GetCookiesExpires() > 0)
+      {
+        SYSTEMTIME current;
+        GetSystemTime(&current);
+        AddSecondsToSystemTime(&current,&current,60 * (double)site->GetCookiesExpires());
+        cookie.SetExpires(&current);
+      }
+      ukheaders.push_back(UKHeader(_T("Set-Cookie"),cookie.GetSetCookieText()));
+    }
+  }
+
+  // Headers we generate ourselves
+  p_message->DelHeader(_T("Content-Type"));
+  p_message->DelHeader(_T("Content-Length"));
+  p_message->DelHeader(_T("Transfer-Encoding"));
+  p_message->DelHeader(_T("Connection"));
+  p_message->DelHeader(_T("Server"));
+  p_message->DelHeader(_T("Set-Cookie"));
+  p_message->DelHeader(_T("Date"));
+
+  // Add extra headers from the message
+  for(auto& header : *p_message->GetHeaderMap())
+  {
+    ukheaders.push_back(UKHeader(header.first,header.second));
+  }
+  // Add other optional security headers like CORS etc.
+  if(site)
+  {
+    site->AddSiteOptionalHeaders(ukheaders);
+  }
+  for(auto& header : ukheaders)
+  {
+    headers += header.m_name + _T(": ") + header.m_value + _T("\r\n");
+  }
+
+  // Framing of the body
+  if(p_chunked)
+  {
+    headers += _T("Transfer-Encoding: chunked\r\n");
+  }
+  else
+  {
+    XString length;
+    length.Format(_T("Content-Length: %I64u\r\n"),(unsigned __int64)p_length);
+    headers += length;
+  }
+  if(!p_request->m_keepAlive)
+  {
+    headers += _T("Connection: close\r\n");
+  }
+  headers += _T("\r\n");
+
+  AutoCSTR block(headers);
+  p_output.append(block.cstr(),block.size());
+}
+
+// Sending response for an incoming message
+void
+HTTPServerSocket::SendResponse(HTTPMessage* p_message)
+{
+  SocketRequest* request = GetSocketRequest(p_message->GetRequestHandle());
+  if(request == nullptr)
+  {
+    return;
+  }
+  // Chunked responses continue with the same request handle
+  bool chunked = p_message->GetChunkNumber() > 0;
+  if(!chunked)
+  {
+    p_message->SetHasBeenAnswered();
+  }
+
+  // Possible zip the contents, and add content-encoding header
+  FileBuffer* buffer = p_message->GetFileBuffer();
+  HTTPSite*   site   = p_message->GetHTTPSite();
+  if(!chunked && site && site->GetHTTPCompression() && buffer->GetFileName().IsEmpty())
+  {
+    // But only if the client side requested it
+    if(p_message->GetAcceptEncoding().Find(_T("gzip")) >= 0)
+    {
+      if(buffer->ZipBuffer())
+      {
+        DETAILLOGV(_T("GZIP the buffer to size: %lu"),buffer->GetLength());
+        p_message->AddHeader(_T("Content-Encoding"),_T("gzip"));
+      }
+    }
+  }
+
+  // A file is streamed, it is never read into memory as a whole
+  if(!chunked && !buffer->GetFileName().IsEmpty())
+  {
+    SendFileResponse(p_message,request);
+    ReleaseRequest(request);
+    return;
+  }
+
+  // Gather the body from the buffer parts
+  std::string body;
+  if(buffer->GetHasBufferParts())
+  {
+    uchar* part   = nullptr;
+    size_t length = 0;
+    for(unsigned index = 0;buffer->GetBufferPart(index,part,length);++index)
+    {
+      body.append(reinterpret_cast<char*>(part),length);
+    }
+  }
+  else
+  {
+    uchar* bytes  = nullptr;
+    size_t length = 0;
+    buffer->GetBuffer(bytes,length);
+    if(bytes && length)
+    {
+      body.append(reinterpret_cast<char*>(bytes),length);
+    }
+  }
+
+  // Status line, headers and body in one write
+  std::string output;
+  output.reserve(1024 + body.size());
+  SerializeHeaders(p_message,request,output,body.size(),chunked);
+  int status = p_message->GetStatus();
+  if(!request->m_isHead && status != HTTP_STATUS_NO_CONTENT && status != HTTP_STATUS_NOT_MODIFIED)
+  {
+    output.append(body);
+  }
+  DETAILLOGV(_T("HTTP Response %d %s"),status,GetHTTPStatusText(status));
+
+  if(chunked)
+  {
+    // First chunk is already in the body. Next ones come through SendAsChunk
+    request->m_started = true;
+    request->m_connection->QueueResponse(request->m_sequence,output.data(),output.size(),false);
+    return;
+  }
+  request->m_connection->QueueResponse(request->m_sequence,output.data(),output.size(),true,!request->m_keepAlive);
+  ReleaseRequest(request);
+}
+
+// Stream a file as the body of a response
+// The file is read in parts. While the client is slower than the disk, the
+// worker thread waits, so at most HTTPCONNECTION_MAXPENDING bytes are in memory.
+void
+HTTPServerSocket::SendFileResponse(HTTPMessage* p_message,SocketRequest* p_request)
+{
+  FileBuffer*     buffer     = p_message->GetFileBuffer();
+  HTTPConnection* connection = p_request->m_connection;
+  LARGE_INTEGER   size;
+  size.QuadPart = 0;
+
+  bool opened = buffer->OpenFile();
+  if(!opened || !GetFileSizeEx(buffer->GetFileHandle(),&size))
+  {
+    ERRORLOG(GetLastError(),_T("OpenFile for sending a HTTP 'GET' response"));
+    if(opened)
+    {
+      buffer->CloseFile();
+      opened = false;
+    }
+    p_message->SetStatus(HTTP_STATUS_NOT_FOUND);
+    size.QuadPart = 0;
+  }
+  int  status = p_message->GetStatus();
+  bool body   = opened && size.QuadPart > 0 && !p_request->m_isHead &&
+                status != HTTP_STATUS_NO_CONTENT && status != HTTP_STATUS_NOT_MODIFIED;
+
+  // Status line and headers go first
+  std::string output;
+  output.reserve(1024);
+  SerializeHeaders(p_message,p_request,output,(size_t)size.QuadPart,false);
+  DETAILLOGV(_T("HTTP Response %d %s"),status,GetHTTPStatusText(status));
+  if(!body)
+  {
+    if(opened)
+    {
+      buffer->CloseFile();
+    }
+    connection->QueueResponse(p_request->m_sequence,output.data(),output.size(),true,!p_request->m_keepAlive);
+    return;
+  }
+  bool result = connection->QueueResponse(p_request->m_sequence,output.data(),output.size(),false);
+
+  // Then the file in parts
+  HANDLE    file = buffer->GetFileHandle();
+  LONGLONG  rest = size.QuadPart;
+  output.resize(HTTPCONNECTION_READSIZE);
+  while(result && rest > 0)
+  {
+    DWORD bytes = 0;
+    DWORD part  = rest < HTTPCONNECTION_READSIZE ? (DWORD)rest : HTTPCONNECTION_READSIZE;
+    if(!::ReadFile(file,&output[0],part,&bytes,nullptr) || bytes == 0)
+    {
+      ERRORLOG(GetLastError(),_T("Reading file for a HTTP 'GET' response"));
+      result = false;
+      break;
+    }
+    rest  -= bytes;
+    result = connection->WaitForOutput(HTTPCONNECTION_MAXPENDING,HTTPCONNECTION_SENDWAIT) &&
+             connection->QueueResponse(p_request->m_sequence,output.data(),bytes,rest <= 0,rest <= 0 && !p_request->m_keepAlive);
+  }
+  buffer->CloseFile();
+
+  // The Content-Length is promised: an incomplete body ends the stream or connection
+  if(!result && !connection->ResetStream(p_request->m_sequence))
+  {
+    connection->Abort();
+    RequestClose(connection);
+  }
+}
+
+// Sending a response as a chunk
+void
+HTTPServerSocket::SendAsChunk(HTTPMessage* p_message,bool p_final /*= false*/)
+{
+  // Check if multi-part buffer or file
+  FileBuffer* buffer = p_message->GetFileBuffer();
+  if(!buffer->GetFileName().IsEmpty())
+  {
+    ERRORLOG(ERROR_INVALID_PARAMETER,_T("Send as chunk cannot send a file!"));
+    return;
+  }
+  // Chunk encode the file buffer
+  if(!buffer->ChunkedEncoding(p_final))
+  {
+    ERRORLOG(ERROR_NOT_ENOUGH_MEMORY,_T("Cannot chunk-encode the message for transfer-encoding!"));
+    return;
+  }
+  // If we want to send a (g)zipped buffer, that should have been done already by now
+  p_message->SetAcceptEncoding(_T(""));
+
+  // Get the chunk number (first->next)
+  unsigned chunk = p_message->GetChunkNumber();
+  p_message->SetChunkNumber(++chunk);
+  DETAILLOGV(_T("Transfer-encoding [Chunked] Sending chunk [%d]"),chunk);
+
+  SocketRequest* request = GetSocketRequest(p_message->GetRequestHandle());
+  if(!request)
+  {
+    ERRORLOG(ERROR_INVALID_PARAMETER,_T("Cannot chunk-encode the message for transfer-encoding! Message already handled!"));
+    return;
+  }
+
+  if(chunk == 1)
+  {
+    // Send the response headers and first body part
+    SendResponse(p_message);
+  }
+  else
+  {
+    // Next chunks go directly on the connection
+    uchar* bytes  = nullptr;
+    size_t length = 0;
+    buffer->GetBuffer(bytes,length);
+    request->m_connection->QueueResponse(request->m_sequence,reinterpret_cast<char*>(bytes),length,false);
+  }
+  if(p_final)
+  {
+    // Closes the slot of this request. Do **NOT** send an another chunk
+    request->m_connection->QueueResponse(request->m_sequence,"",0,true,!request->m_keepAlive);
+    p_message->SetHasBeenAnswered();
+    ReleaseRequest(request);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// EVENT STREAMS
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Init the stream response
+bool
+HTTPServerSocket::InitEventStream(EventStream& p_stream)
+{
+  SocketRequest* request = GetSocketRequest(p_stream.m_requestID);
+  if(request == nullptr)
+  {
+    return false;
+  }
+  // First comment to push to the stream (not an event!)
+  // The stream is sent with chunked transfer-encoding, so the connection
+  // can stay alive after the stream has been closed by the server.
+  const char* init = "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/event-stream\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Transfer-Encoding: chunked\r\n"
+                     "\r\n"
+                     "16\r\n"
+                     ":init event-stream\r\n\r\n"
+                     "\r\n";
+  request->m_started = true;
+  return request->m_connection->QueueResponse(request->m_sequence,init,strlen(init),false);
+}
+
+// Sending a chunk to an event stream
+bool
+HTTPServerSocket::SendResponseEventBuffer(HTTP_OPAQUE_ID    p_requestID
+                                         ,CRITICAL_SECTION* p_lock
+                                         ,BYTE**            p_buffer
+                                         ,size_t            p_length
+                                         ,bool              p_continue /*=true*/)
+{
+  AutoCritSec lockme(p_lock);
+
+  SocketRequest* request = GetSocketRequest(p_requestID);
+  if(request == nullptr)
+  {
+    return false;
+  }
+  // Frame as a chunk of the chunked transfer-encoding
+  std::string chunk;
+  if(p_length)
+  {
+    char size[20];
+    sprintf_s(size,20,"%zX\r\n",p_length);
+    chunk.reserve(p_length + 32);
+    chunk.append(size);
+    chunk.append(reinterpret_cast<char*>(*p_buffer),p_length);
+    chunk.append("\r\n");
+  }
+  if(!p_continue)
+  {
+    chunk.append("0\r\n\r\n");
+  }
+  bool result = request->m_connection->QueueResponse(request->m_sequence,chunk.data(),chunk.size(),!p_continue);
+  if(!p_continue)
+  {
+    ReleaseRequest(request);
+  }
+  return result;
+}
+
+// Used for canceling an event stream
+void
+HTTPServerSocket::CancelRequestStream(HTTP_OPAQUE_ID p_response,bool /*p_reset*/)
+{
+  SocketRequest* request = GetSocketRequest(p_response);
+  if(request)
+  {
+    // A HTTP/2 stream can be reset on its own. Otherwise the stream
+    // was never finished: the connection cannot be reused
+    if(!request->m_connection->ResetStream(request->m_sequence))
+    {
+      request->m_connection->Abort();
+      RequestClose(request->m_connection);
+    }
+    ReleaseRequest(request);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WEBSOCKETS: NOT SUPPORTED
+//
+//////////////////////////////////////////////////////////////////////////
+
+WebSocket*
+HTTPServerSocket::CreateWebSocket(XString /*p_uri*/)
+{
+  ERRORLOG(ERROR_NOT_SUPPORTED,_T("WebSockets are not supported by the socket server"));
+  return nullptr;
+}
+
+void
+HTTPServerSocket::ReceiveWebSocket(WebSocket* /*p_socket*/,HTTP_OPAQUE_ID /*p_request*/)
+{
+  ERRORLOG(ERROR_NOT_SUPPORTED,_T("WebSockets are not supported by the socket server"));
+}
+
+bool
+HTTPServerSocket::FlushSocket(HTTP_OPAQUE_ID /*p_request*/,XString /*p_prefix*/)
+{
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// CONNECTION ADMINISTRATION
+//
+//////////////////////////////////////////////////////////////////////////
+
+// A connection has pending output (any thread)
+void
+HTTPServerSocket::RequestWrite(HTTPConnection* p_connection)
+{
+  {
+    AutoCritSec lock(&m_queueLock);
+    p_connection->AddReference();
+    m_writeQueue.push_back(p_connection);
+  }
+  m_poll.WakeUp();
+}
+
+// A connection must be closed (any thread)
+void
+HTTPServerSocket::RequestClose(HTTPConnection* p_connection)
+{
+  {
+    AutoCritSec lock(&m_queueLock);
+    p_connection->AddReference();
+    m_closeQueue.push_back(p_connection);
+  }
+  m_poll.WakeUp();
+}
+
+// Requests from the worker threads (polling thread)
+void
+HTTPServerSocket::HandleQueues()
+{
+  ConnectionQueue writes;
+  ConnectionQueue closes;
+  {
+    AutoCritSec lock(&m_queueLock);
+    writes.swap(m_writeQueue);
+    closes.swap(m_closeQueue);
+  }
+  for(auto& connection : writes)
+  {
+    if(m_connections.find(connection) != m_connections.end() && connection->GetWantsWrite())
+    {
+      unsigned interest = POLL_WRITE | (connection->GetIsReading() ? POLL_READ : 0);
+      m_poll.Modify(connection->GetSocket(),connection,interest);
+    }
+    connection->DropReference();
+  }
+  for(auto& connection : closes)
+  {
+    CloseConnection(connection);
+    connection->DropReference();
+  }
+}
+
+// Remove idle keep-alive connections
+void
+HTTPServerSocket::CheckIdleConnections()
+{
+  ULONGLONG now = GetTickCount64();
+  ConnectionQueue idle;
+  for(auto& connection : m_connections)
+  {
+    if(connection->GetIsIdle() &&
+      (m_draining || (now - connection->GetLastActivity()) > (ULONGLONG)m_keepAliveTimeout * 1000))
+    {
+      idle.push_back(connection);
+    }
+  }
+  for(auto& connection : idle)
+  {
+    CloseConnection(connection);
+  }
+}
+
+// Close a connection on the polling thread
+void
+HTTPServerSocket::CloseConnection(HTTPConnection* p_connection)
+{
+  SocketConnections::iterator it = m_connections.find(p_connection);
+  if(it == m_connections.end())
+  {
+    // Already closed
+    return;
+  }
+  m_connections.erase(it);
+  m_poll.Remove(p_connection->GetSocket());
+  p_connection->Abort();
+  InterlockedDecrement(&m_connectionCount);
+
+  // Drop the reference of the polling thread
+  // Requests in flight keep the connection alive until they are answered
+  p_connection->DropReference();
+}
+
+void
+HTTPServerSocket::CloseAllConnections()
+{
+  while(!m_connections.empty())
+  {
+    CloseConnection(*m_connections.begin());
+  }
+  HandleQueues();
+}
+
+void
+HTTPServerSocket::CloseListeners()
+{
+  AutoCritSec lock(&m_sitesLock);
+
+  for(auto& listener : m_listeners)
+  {
+    m_poll.Remove(listener.second->m_socket);
+    SocketPoll::CloseSocket(listener.second->m_socket);
+    delete listener.second;
+  }
+  m_listeners.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// STOPPING THE SERVER
+//
+//////////////////////////////////////////////////////////////////////////
+
+void
+HTTPServerSocket::StopServer()
+{
+  AutoCritSec lock(&m_eventLock);
+  DETAILLOG1(_T("Received a StopServer request"));
+
+  // See if we are running at all
+  if(m_running == false)
+  {
+    return;
+  }
+
+  // Try to remove all event streams
+  for(auto& it : m_eventStreams)
+  {
+    // SEND OnClose event
+    ServerEvent* event = new ServerEvent(_T("close"));
+    SendEvent(it.second->m_port,it.second->m_baseURL,event);
+  }
+  // Try to remove all event streams
+  while(!m_eventStreams.empty())
+  {
+    const EventStream* stream = m_eventStreams.begin()->second;
+    CloseEventStream(stream);
+  }
+
+  // See if we have a running server-push-event heartbeat monitor
+  if(m_eventEvent)
+  {
+    // Explicitly pulse the event heartbeat monitor
+    // this abandons the monitor in one go!
+    DETAILLOG1(_T("Abandon the server-push-events heartbeat monitor"));
+    SetEvent(m_eventEvent);
+  }
+
+  // Polling loop will stop on next iteration
+  m_running = false;
+  HANDLE close = m_pollThread;
+  if(close)
+  {
+    m_poll.WakeUp();
+    // Wait for the polling loop to end
+    for(int ind = 0; ind < 10 && m_pollThread; ++ind)
+    {
+      DWORD res = WaitForSingleObject(close,100);
+      if(res == WAIT_OBJECT_0)
+      {
+        break;
+      }
+    }
+  }
+
+  // Cleanup the sites and connections
+  Cleanup();
+}
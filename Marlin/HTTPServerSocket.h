@@ -0,0 +1,197 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPServerSocket.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "HTTPServer.h"
+#include "HTTPConnection.h"
+#include "SocketPoll.h"
+#include <atomic>
+#include <set>
+
+// HTTPServer on plain non-blocking sockets, without the HTTP.sys driver
+// All connections are multiplexed on one polling thread (WSAPoll).
+// Complete requests are handed to the threadpool and go through the
+// same HTTPSite / SiteHandler chain as the other servers.
+// HTTP/1.1 keep-alive and pipelining are supported. HTTP/2 over plain TCP
+// with prior knowledge (h2c) on the same ports is opt-in: SetHTTP2 or the
+// "HTTP2" setting of the "Server" section. Authentication through
+// the SSPI schemes and WebSockets are **NOT** supported by this server.
+
+#define SOCKETREQUEST_IDENT         0x66A5C566
+#define SOCKET_KEEPALIVE_TIMEOUT    120           // Seconds of idle keep-alive
+#define SOCKET_MAX_CONNECTIONS      10000         // Maximum of simultaneous connections
+#define SOCKET_LISTEN_BACKLOG       SOMAXCONN     // Backlog queue of a listener
+
+class HTTPSiteSocket;
+
+// The HTTP_OPAQUE_ID of a request in this server
+typedef struct _socketRequest
+{
+  unsigned        m_ident      { SOCKETREQUEST_IDENT };
+  HTTPConnection* m_connection { nullptr };     // Connection (holds a reference)
+  unsigned        m_sequence   { 0 };           // Pipelining sequence number
+  bool            m_keepAlive  { true };        // Keep connection after response
+  bool            m_isHead     { false };       // HEAD request: no body in response
+  bool            m_started    { false };       // Headers sent (chunked/event stream)
+}
+SocketRequest;
+
+// A listening socket on a port
+typedef struct _socketListener
+{
+  PollSocket      m_socket { POLL_INVALID_SOCKET };
+  int             m_port   { 0 };
+}
+SocketListener;
+
+using SocketListeners   = std::map<int,SocketListener*>;
+using SocketConnections = std::set<HTTPConnection*>;
+using ConnectionQueue   = std::vector<HTTPConnection*>;
+
+class HTTPServerSocket : public HTTPServer
+{
+public:
+  explicit HTTPServerSocket(XString p_name);
+  virtual ~HTTPServerSocket();
+
+  // Running the server 
+  virtual void       Run() override;
+  // Stop the server
+  virtual void       StopServer() override;
+  // Initialise a HTTP server
+  virtual bool       Initialise() override;
+  // Return a version string
+  virtual XString    GetVersion() override;
+  // Create a site to bind the traffic to
+  virtual HTTPSite*  CreateSite(PrefixType    p_type
+                               ,bool          p_secure
+                               ,int           p_port
+                               ,XString       p_baseURL
+                               ,bool          p_subsite  = false
+                               ,LPFN_CALLBACK p_callback = nullptr) override;
+  // Delete a site from the remembered set of sites
+  virtual bool       DeleteSite(int p_port,XString p_baseURL,bool p_force = false) override;
+  // Receive (the rest of the) incoming HTTP request
+  virtual bool       ReceiveIncomingRequest(HTTPMessage* p_message,Encoding p_encoding) override;
+  // Create a new WebSocket in the subclass of our server
+  virtual WebSocket* CreateWebSocket(XString p_uri) override;
+  // Receive the WebSocket stream and pass on the the WebSocket
+  virtual void       ReceiveWebSocket(WebSocket* p_socket,HTTP_OPAQUE_ID p_request) override;
+  // Flushing a WebSocket intermediate
+  virtual bool       FlushSocket(HTTP_OPAQUE_ID p_request,XString p_prefix) override;
+  // Sending response for an incoming message
+  virtual void       SendResponse(HTTPMessage* p_message) override;
+  // Sending a response as a chunk
+  virtual void       SendAsChunk(HTTPMessage* p_message,bool p_final = false) override;
+
+  // FUNCTIONS FOR THE SOCKET SERVER
+
+  // Open a listening socket for a port (once per port)
+  bool          StartListener(int p_port);
+  // Take over a listening socket, created by another process (ServerSupervisor)
+  bool          AdoptListener(int p_port,PollSocket p_socket);
+  // Stop accepting connections and finish the current ones (any thread)
+  void          StopListening();
+  // Running the polling loop of the server
+  void          RunPollingLoop();
+  // A connection has pending output (any thread)
+  void          RequestWrite(HTTPConnection* p_connection);
+  // A connection must be closed (any thread)
+  void          RequestClose(HTTPConnection* p_connection);
+
+  // GETTERS
+  int           GetKeepAliveTimeout()   { return m_keepAliveTimeout;   }
+  int           GetMaxConnections()     { return m_maxConnections;     }
+  unsigned      GetConnectionCount()    { return (unsigned)m_connectionCount; }
+  unsigned      GetRequestCount()       { return (unsigned)m_requestCount;    }
+  bool          GetSharedListeners()    { return m_sharedListeners;    }
+  bool          GetIsDraining()         { return m_draining;           }
+  bool          GetHTTP2()              { return m_http2;              }
+
+  // SETTERS
+  // Listening ports are shared by multiple worker processes (see AdoptListener)
+  void          SetSharedListeners(bool p_shared) { m_sharedListeners = p_shared; }
+  // Accept the HTTP/2 connection preface (h2c with prior knowledge)
+  void          SetHTTP2(bool p_http2)            { m_http2 = p_http2; }
+
+protected:
+  // Cleanup the server
+  virtual void  Cleanup() override;
+  // Initialise general server header settings
+  virtual void  InitHeaders() override;
+  // Init the stream response
+  virtual bool  InitEventStream(EventStream& p_stream) override;
+  // Used for canceling a WebSocket for an event stream
+  virtual void  CancelRequestStream(HTTP_OPAQUE_ID p_response,bool p_reset = false) override;
+
+private:
+  // For the handling of the event streams: Sending a chunk to an event stream
+  virtual bool  SendResponseEventBuffer(HTTP_OPAQUE_ID     p_request
+                                       ,CRITICAL_SECTION*  p_lock
+                                       ,BYTE**             p_buffer
+                                       ,size_t             p_totalLength
+                                       ,bool               p_continue = true) override;
+  // Polling thread functions
+  SocketListener* FindListener(void* p_context);
+  void          RegisterListener(PollSocket p_socket,int p_port);
+  void          AcceptConnections(SocketListener* p_listener);
+  void          HandleInput(HTTPConnection* p_connection);
+  void          HandleQueues();
+  void          CheckIdleConnections();
+  void          CloseConnection(HTTPConnection* p_connection);
+  void          CloseAllConnections();
+  void          CloseListeners();
+  // Translate a raw request to a HTTPMessage and dispatch it
+  void          DispatchRequest(HTTPConnection* p_connection,RawRequest& p_request);
+  // Respond directly from the polling thread on a protocol error
+  void          SendProtocolError(HTTPConnection* p_connection,unsigned p_sequence,int p_status,bool p_close = true);
+  // Serialize the status line and headers of a response
+  void          SerializeHeaders(HTTPMessage* p_message,SocketRequest* p_request,std::string& p_output,size_t p_length,bool p_chunked);
+  // Stream a file as the body of a response
+  void          SendFileResponse(HTTPMessage* p_message,SocketRequest* p_request);
+  // Getting the request of a message
+  SocketRequest* GetSocketRequest(HTTP_OPAQUE_ID p_request);
+  // Response is complete: release the request
+  void          ReleaseRequest(SocketRequest* p_request);
+
+  // PRIVATE DATA of the socket HTTPServer
+  SocketPoll        m_poll;                       // Readiness notification
+  SocketListeners   m_listeners;                  // Listening sockets per port
+  SocketConnections m_connections;                // All connections (polling thread only)
+  RawRequest        m_rawRequest;                 // Request being parsed (polling thread only)
+  ConnectionQueue   m_writeQueue;                 // Connections waiting for a write interest
+  ConnectionQueue   m_closeQueue;                 // Connections waiting to be closed
+  CRITICAL_SECTION  m_queueLock;                  // Locking the write and close queues
+  HANDLE            m_pollThread       { NULL };  // Thread running the polling loop
+  int               m_keepAliveTimeout { SOCKET_KEEPALIVE_TIMEOUT };
+  int               m_maxConnections   { SOCKET_MAX_CONNECTIONS   };
+  long              m_connectionCount  { 0 };     // Currently open connections
+  long              m_requestCount     { 0 };     // Total number of requests served
+  bool              m_sharedListeners  { false }; // Ports shared with other worker processes
+  std::atomic<bool> m_draining         { false }; // Stopped listening, finishing connections (set by another thread)
+  bool              m_http2            { false }; // Connections may start with the HTTP/2 preface
+};
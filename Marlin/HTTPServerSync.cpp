@@ -579,7 +579,6 @@ HTTPServerSync::RunHTTPServer()
       message->SetContentType(contentType);
       message->SetContentLength((size_t)_ttoll(contentLength));
       message->SetAllHeaders(&request->Headers);
-      message->SetUnknownHeaders(&request->Headers);
       message->SetEncoding(encoding);
 
       // Handle modified-since 
@@ -894,7 +893,8 @@ HTTPServerSync::ReceiveIncomingRequest(HTTPMessage* p_message,Encoding p_encodin
   entityBuffer = nullptr;
 
   // In case of a POST, try to convert character set before submitting to site
-  if(p_message->GetCommand() == HTTPCommand::http_post)
+  // Not for a body that was streamed to the site handler
+  if(p_message->GetCommand() == HTTPCommand::http_post && p_message->GetBodySink() == nullptr)
   {
     if(p_message->GetContentType().Find(_T("multipart")) <= 0)
     {
@@ -35,6 +35,8 @@
 #include "WinINETError.h"
 #include "ErrorReport.h"
 #include "ConvertWideString.h"
+#include "StaticContentCache.h"
+#include <Metrics.h>
 #include <WinFile.h>
 #include <winerror.h>
 #include <sddl.h>
@@ -83,6 +85,11 @@ HTTPSite::HTTPSite(HTTPServer*   p_server
   }
   InitializeCriticalSection(&m_filterLock);
   InitializeCriticalSection(&m_sessionLock);
+
+  // Request latency of this site
+  XString labels;
+  labels.Format(_T("site=%s,port=\"%d\""),MetricsRegistry::LabelValue(m_site).GetString(),m_port);
+  m_requestTime = GetMetricsRegistry().GetHistogram(_T("marlin_request_seconds"),_T("Handling of HTTP requests by a Marlin site"),labels);
 }
 
 HTTPSite::~HTTPSite()
@@ -90,6 +97,7 @@ HTTPSite::~HTTPSite()
   CleanupFilters();
   CleanupHandlers();
   CleanupThrotteling();
+  SetStaticContentCache(false);
   DeleteCriticalSection(&m_filterLock);
   DeleteCriticalSection(&m_sessionLock);
 }
@@ -400,6 +408,14 @@ HTTPSite::InitSite(MarlinConfig& p_config)
   m_compression   = p_config.GetParameterBoolean(_T("Server"),_T("HTTPCompression"),m_compression);
   m_throttling    = p_config.GetParameterBoolean(_T("Server"),_T("HTTPThrotteling"),m_throttling);
 
+  // Static content caching
+  if(p_config.HasParameter(_T("Server"),_T("StaticCache")))
+  {
+    bool     staticCache = p_config.GetParameterBoolean(_T("Server"),_T("StaticCache"),false);
+    unsigned staticSize  = (unsigned) p_config.GetParameterInteger(_T("Server"),_T("StaticCacheSize"),64);
+    SetStaticContentCache(staticCache,staticSize);
+  }
+
   // Getting cookie settings
   m_cookieHasSecure = p_config.HasParameter(_T("Cookies"),_T("Secure"));
   m_cookieHasHttp   = p_config.HasParameter(_T("Cookies"),_T("HttpOnly"));
@@ -528,6 +544,7 @@ HTTPSite::LogSettings()
   DETAILLOGS(_T("Site accepting Server-Sent-Events  : "),       m_isEventStream ? _T("ON") : _T("OFF"));
   DETAILLOGS(_T("Site allows for HTTP-VERB Tunneling: "),       m_verbTunneling ? _T("ON") : _T("OFF"));
   DETAILLOGS(_T("Site uses HTTP Throtteling         : "),       m_throttling    ? _T("ON") : _T("OFF"));
+  DETAILLOGS(_T("Site caches static content         : "),       m_staticCache   ? _T("ON") : _T("OFF"));
   DETAILLOGS(_T("Site forces response to UTF-16     : "),       m_sendUnicode   ? _T("ON") : _T("OFF"));
   DETAILLOGS(_T("Site forces SOAP response UTF BOM  : "),       m_sendSoapBOM   ? _T("ON") : _T("OFF"));
   DETAILLOGS(_T("Site forces JSON response UTF BOM  : "),       m_sendJsonBOM   ? _T("ON") : _T("OFF"));
@@ -635,6 +652,55 @@ HTTPSite::GetAuthenticationDomain()
   return m_domain; 
 };
 
+// Let the handler receive the body while it is being read
+// Whatever part of the body was already read, is passed on to the sink first
+// Returns true if the body is now streaming to the handler's sink
+bool
+HTTPSite::StartBodyStreaming(HTTPMessage* p_message)
+{
+  if(p_message->GetBodySink())
+  {
+    // Already streaming (asynchronous server)
+    return true;
+  }
+  SiteHandler* handler = GetSiteHandler(p_message->GetCommand());
+  if(handler == nullptr)
+  {
+    return false;
+  }
+  BodySink* sink = handler->GetBodySink(p_message);
+  if(sink == nullptr)
+  {
+    return false;
+  }
+
+  // From now on the body goes to the sink. Pass on the body read thus far
+  // and release it from the file buffer of the message
+  p_message->SetBodySink(sink);
+
+  FileBuffer* buffer = p_message->GetFileBuffer();
+  uchar* part   = nullptr;
+  size_t length = 0;
+  if(buffer->GetHasBufferParts())
+  {
+    for(unsigned index = 0; buffer->GetBufferPart(index,part,length); ++index)
+    {
+      p_message->AddBody(part,(unsigned)length);
+    }
+  }
+  else
+  {
+    buffer->GetBuffer(part,length);
+    if(part && length)
+    {
+      p_message->AddBody(part,(unsigned)length);
+    }
+  }
+  buffer->Reset();
+  DETAILLOGS(_T("Streaming the body of the message to the site handler: "),p_message->GetURL());
+  return true;
+}
+
 // Come here to handle our HTTP message gotten from the server
 // through the HTTPThreadpool
 // This is the MAIN entry point for all traffic to this site.
@@ -649,6 +715,9 @@ HTTPSite::HandleHTTPMessage(HTTPMessage* p_message)
   // type of exception handling!
   _set_se_translator(SeTranslator);
 
+  // Request latency, from reading the body until the handlers are done
+  MetricTimer timer(m_requestTime);
+
   try
   {
     // HTTP Throttling is one call per calling address at the time
@@ -657,12 +726,16 @@ HTTPSite::HandleHTTPMessage(HTTPMessage* p_message)
       g_throttle = StartThrottling(p_message);
     }
 
+    // Handlers that opt in get the body while it is being read
+    StartBodyStreaming(p_message);
+
     // Try to read the body / rest of the message
     // This is now done by the threadpool thread, so the central
     // server has more time to handle the incoming requests.
     if(p_message->GetReadBuffer() && m_server->ReceiveIncomingRequest(p_message,p_message->GetEncoding()) == false)
     {
       // Error already report to log, EOF or stream not read
+      p_message->EndBodySink(false);
       p_message->Reset();
       p_message->SetStatus(HTTP_STATUS_GONE);
       SendResponse(p_message);
@@ -670,6 +743,17 @@ HTTPSite::HandleHTTPMessage(HTTPMessage* p_message)
       return;
     }
 
+    // Body is completely read. The streaming handler must have accepted it
+    if(!p_message->EndBodySink(true))
+    {
+      ERRORLOG(ERROR_INVALID_DATA,_T("Streaming body of the message not accepted by the site handler"));
+      p_message->Reset();
+      p_message->SetStatus(HTTP_STATUS_BAD_REQUEST);
+      SendResponse(p_message);
+      p_message->DropReference();
+      return;
+    }
+
     // See if the total server is already up-and-running and we can go about
     // processing the 'normal' requests.
     // Blocks processing before all sites and functions are started
@@ -1855,6 +1939,23 @@ HTTPSite::SetBlockCacheControl(bool p_block)
   m_blockCache = p_block;
 }
 
+// In-memory caching of static content for the GET handler
+// Set this before the site is started. The gzip variants are only
+// created if HTTP compression was already set for this site.
+void
+HTTPSite::SetStaticContentCache(bool p_cache,unsigned p_megabytes /*= 64*/)
+{
+  if(m_staticCache)
+  {
+    delete m_staticCache;
+    m_staticCache = nullptr;
+  }
+  if(p_cache)
+  {
+    m_staticCache = new StaticContentCache(GetWebroot(),(size_t)p_megabytes * 1024 * 1024,m_compression);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 // Standard headers added by call responses from this site
@@ -102,6 +102,8 @@ class HTTPURLGroup;
 class MarlinConfig;
 class SiteFilter;
 class SiteHandler;
+class StaticContentCache;
+class MetricHistogram;
 
 // Keeping a mapping of all the site handlers
 typedef struct _regHandler
@@ -193,6 +195,8 @@ public:
   void            SetHTTPCompression(bool p_compression);
   // OPTIONAL: Set HTTP throttling per address
   void            SetHTTPThrotteling(bool p_throttel);
+  // OPTIONAL: Set in-memory caching of static content (size in megabytes)
+  void            SetStaticContentCache(bool p_cache,unsigned p_megabytes = 64);
   // OPTIONAL: Set use CORS (Cross Origin Resource Sharing)
   void            SetUseCORS(bool p_use);
   // OPTIONAL: Set use this origin for CORS (otherwise all = '*')
@@ -240,6 +244,7 @@ public:
   bool            GetVerbTunneling()                { return m_verbTunneling; }
   bool            GetHTTPCompression()              { return m_compression;   }
   bool            GetHTTPThrotteling()              { return m_throttling;    }
+  StaticContentCache* GetStaticContentCache()       { return m_staticCache;   }
   bool            GetUseCORS()                      { return m_useCORS;       }
   XString         GetCORSOrigin()                   { return m_allowOrigin;   }
   XString         GetCORSHeaders()                  { return m_allowHeaders;  }
@@ -280,6 +285,8 @@ public:
   bool RemoveFilter(unsigned p_priority);
   // Call the correct HTTP handler!
   void HandleHTTPMessage(HTTPMessage* p_message);
+  // Let the handler receive the body while it is being read
+  bool StartBodyStreaming(HTTPMessage* p_message);
   // Call the correct EventStream handler
   bool HandleEventStream(HTTPMessage* p_message,EventStream* p_stream);
   // Check WS-ReliableMessaging protocol
@@ -374,6 +381,8 @@ protected:
   bool              m_sendJsonBOM     { false   };        // Prepend UTF-16 JSON message with BOM
   bool              m_compression     { false   };        // Allows for HTTP gzip compression
   bool              m_throttling      { false   };        // Perform throttling per address
+  StaticContentCache* m_staticCache   { nullptr };        // In-memory cache of static content
+  MetricHistogram*  m_requestTime     { nullptr };        // Request latency of this site (metrics)
   // CORS Cross Origin Resource Sharing
   bool              m_useCORS         { false   };        // Use CORS header methods
   XString           m_allowOrigin;                        // Client that can call us or '*' for everyone
@@ -0,0 +1,198 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: HTTPSiteSocket.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "AutoCritical.h"
+#include "HTTPSiteSocket.h"
+#include "HTTPServerSocket.h"
+#include <WinFile.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Logging via the server
+#define DETAILLOG1(text)        m_server->DetailLog (_T(__FUNCTION__),LogType::LOG_INFO,text)
+#define DETAILLOGS(text,extra)  m_server->DetailLogS(_T(__FUNCTION__),LogType::LOG_INFO,text,extra)
+#define DETAILLOGV(text,...)    m_server->DetailLogV(_T(__FUNCTION__),LogType::LOG_INFO,text,__VA_ARGS__)
+#define WARNINGLOG(text,...)    m_server->DetailLogV(_T(__FUNCTION__),LogType::LOG_WARN,text,__VA_ARGS__)
+#define ERRORLOG(code,text)     m_server->ErrorLog  (_T(__FUNCTION__),code,text)
+
+HTTPSiteSocket::HTTPSiteSocket(HTTPServerSocket* p_server
+                              ,int               p_port
+                              ,XString           p_site
+                              ,XString           p_prefix
+                              ,HTTPSite*         p_mainSite /*=nullptr*/
+                              ,LPFN_CALLBACK     p_callback /*=nullptr*/)
+               :HTTPSite(p_server,p_port,p_site,p_prefix,p_mainSite,p_callback)
+{
+}
+
+// Explicitly starting after configuration of the site
+bool
+HTTPSiteSocket::StartSite()
+{
+  DETAILLOGS(_T("Starting website. URL: "),m_site);
+
+  // Getting the global settings
+  InitSite(m_server->GetWebConfig());
+
+  // If we have a site Marlin.config file: read it
+  // Overrides the programmatical settings between HTTPServer::CreateSite and HTTPSite::StartSite
+  XString siteConfigFile = MarlinConfig::GetSiteConfig(m_prefixURL);
+  if(!siteConfigFile.IsEmpty())
+  {
+    MarlinConfig config(siteConfigFile);
+    if(config.IsFilled())
+    {
+      InitSite(config);
+    }
+  }
+
+  // Now log the settings, once we read all Marlin.config files
+  LogSettings();
+
+  // See if we have a reliable messaging WITH authentication
+  CheckReliable();
+
+  // Checking our webroot
+  if(!SetWebroot(m_webroot))
+  {
+    ERRORLOG(ERROR_INVALID_NAME,_T("Cannot start site: invalid webroot"));
+    return false;
+  }
+
+  // Call all filters 'OnStartSite' methods
+  for(auto& filter : m_filters)
+  {
+    filter.second->OnStartSite();
+  }
+
+  // Call all site handlers 'OnStartSite' methods
+  for(auto& handler : m_handlers)
+  {
+    SiteHandler* shand = handler.second.m_handler;
+    while(shand)
+    {
+      shand->OnStartSite();
+      shand = shand->GetNextHandler();
+    }
+  }
+
+  // Lock for the initialization of the site
+  AutoCritSec lock(m_server->AcquireSitesLockObject());
+
+  // Sub-sites share the listener of the main site
+  // otherwise we make sure there is a listener for our port
+  HTTPServerSocket* server = reinterpret_cast<HTTPServerSocket*>(m_server);
+  bool result = m_mainSite ? true : server->StartListener(m_port);
+  if(result)
+  {
+    DETAILLOGS(_T("Site listening on the socket server: "),m_prefixURL);
+  }
+  else
+  {
+    ERRORLOG(ERROR_INVALID_PARAMETER,_T("Cannot listen on the port of the site: ") + m_prefixURL);
+  }
+  // Return the fact that we started successfully or not
+  return (m_isStarted = result);
+}
+
+// Set the webroot of the site
+bool
+HTTPSiteSocket::SetWebroot(XString p_webroot)
+{
+  // Cleaning the webroot is simple
+  if(p_webroot.IsEmpty())
+  {
+    m_webroot = m_server->GetWebroot();
+    return true;
+  }
+
+  // Check the directory
+  XString siteWebroot;
+  if(m_virtualDirectory)
+  {
+    // Check already done by setting virtual directory
+    return true;
+  }
+  else if(p_webroot.Left(10).CompareNoCase(_T("virtual://")) == 0)
+  {
+    // It's a HTTP virtual directory outside of the server's webroot
+    siteWebroot = p_webroot.Mid(10);
+    m_virtualDirectory = true;
+  }
+  else
+  {
+    siteWebroot = p_webroot;
+
+    // Checking the webroot of the site against the webroot of the server
+    XString serverWebroot = m_server->GetWebroot();
+    serverWebroot.MakeLower();
+    siteWebroot  .MakeLower();
+    serverWebroot.Replace(_T("/"),_T("\\"));
+    siteWebroot  .Replace(_T("/"),_T("\\"));
+    if(siteWebroot.Find(serverWebroot) != 0)
+    {
+      ERRORLOG(ERROR_INVALID_PARAMETER,_T("Site webroot is not within the server webroot: ") + siteWebroot);
+      return false;
+    }
+  }
+
+  // Make sure the directory is there
+  WinFile ensure(siteWebroot);
+  if(!ensure.CreateDirectory())
+  {
+    ERRORLOG(ensure.GetLastError(),_T("Website's root directory does not exist and cannot create it"));
+  }
+
+  // Acceptable webroot of a site
+  m_webroot = siteWebroot;
+  return true;
+}
+
+void
+HTTPSiteSocket::InitSite(MarlinConfig& p_config)
+{
+  // Call our main class InitSite
+  HTTPSite::InitSite(p_config);
+
+  // AUTHENTICATION
+  // The socket server has no SSPI authentication. The 'Authorization' header
+  // is passed on to the site, so filters or handlers can use 'Basic' or tokens.
+  XString scheme = p_config.GetParameterString(_T("Authentication"),_T("Scheme"),m_scheme);
+  if(!scheme.IsEmpty() && scheme.CompareNoCase(_T("Anonymous")) != 0)
+  {
+    WARNINGLOG(_T("Authentication scheme [%s] not supported by the socket server. Site is anonymous!"),scheme.GetString());
+  }
+  m_authScheme = 0;
+  m_scheme.Empty();
+}
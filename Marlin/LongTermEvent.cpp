@@ -27,6 +27,7 @@
 //
 #include "stdafx.h"
 #include "LongTermEvent.h"
+#include "SharedEvent.h"
 
 #ifdef _AFX
 #ifdef _DEBUG
@@ -48,6 +49,22 @@ LTEvent::LTEvent(EvtType p_type)
 {
 }
 
+// DTOR: Release our part of a broadcasted event
+LTEvent::~LTEvent()
+{
+  if(m_shared)
+  {
+    m_shared->DropReference();
+    m_shared = nullptr;
+  }
+}
+
+const XString&
+LTEvent::GetPayload() const
+{
+  return m_shared ? m_shared->GetPayload() : m_payload;
+}
+
 EvtType
 LTEvent::StringToEventType(XString p_type)
 {
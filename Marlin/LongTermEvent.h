@@ -58,12 +58,14 @@ enum class EVChannelPolicy
 
 #define SENDER_RANDOM_NUMBER 0xADF74FF6
 
+class SharedEvent;
+
 class LTEvent
 {
 public:
   LTEvent();
   LTEvent(EvtType p_type);
- ~LTEvent() = default;
+ ~LTEvent();
 
   static EvtType StringToEventType(XString p_type);
   static XString EventTypeToString(EvtType p_type);
@@ -71,12 +73,16 @@ public:
   static EVChannelPolicy StringToChannelPolicy(XString p_policy);
   static XString ChannelPolicyToString(EVChannelPolicy p_policy);
 
+  // Payload of a broadcast is only kept in the shared event
+  const XString& GetPayload() const;
+
   // DATA
   int      m_number { 0  };
   UINT64   m_sent   { 0L };
   EvtType  m_type;
   XString  m_typeName;
   XString  m_payload;
+  SharedEvent* m_shared { nullptr };  // Pre-encoded broadcast (one reference)
 };
 
 // Application callback to handle our dissipated events
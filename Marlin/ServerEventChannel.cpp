@@ -29,6 +29,7 @@
 #include "ServerEventChannel.h"
 #include "ServerEventDriver.h"
 #include "LongTermEvent.h"
+#include "SharedEvent.h"
 #include "ConvertWideString.h"
 #include "WebSocketMain.h"
 #include "AutoCritical.h"
@@ -189,6 +190,34 @@ ServerEventChannel::PostEvent(XString p_payload
   return m_maxNumber;
 }
 
+// Register a broadcast event that has been encoded beforehand
+// Called from the ServerEventDriver. The event takes a reference
+int
+ServerEventChannel::PostBroadcast(SharedEvent* p_shared)
+{
+  p_shared->AddReference();
+
+  LTEvent* ltevent    = new LTEvent();
+  ltevent->m_sent     = 0; // Send to all clients
+  ltevent->m_type     = p_shared->GetType();
+  ltevent->m_typeName = p_shared->GetTypeName();
+  ltevent->m_shared   = p_shared;
+
+  // Place in the queue (Shortest possible lock)
+  int number = 0;
+  {
+    AutoCritSec lock(&m_lock);
+    number = ltevent->m_number = ++m_maxNumber;
+    m_outQueue.push_back(ltevent);
+  }
+  if(m_driver->GetActive() == false)
+  {
+    // Directly send all pending events for this channel
+    SendChannel();
+  }
+  return number;
+}
+
 void 
 ServerEventChannel::PlaceInLongPollingQueue(LTEvent* p_event)
 {
@@ -599,7 +628,7 @@ ServerEventChannel::HandleLongPolling(SOAPMessage* p_message,bool p_check /*=fal
   if(ltevent)
   {
     p_message->SetParameter(_T("Number"), ltevent->m_number);
-    p_message->SetParameter(_T("Message"),ltevent->m_payload);
+    p_message->SetParameter(_T("Message"),ltevent->GetPayload());
     p_message->SetParameter(_T("Type"), LTEvent::EventTypeToString(ltevent->m_type));
 
     delete ltevent;
@@ -716,7 +745,10 @@ ServerEventChannel::SendEventToSockets(LTEvent* p_event)
         {
           OnOpen(_T(""));
         }
-        if(it->m_socket->WriteString(p_event->m_payload))
+        bool written = p_event->m_shared ? it->m_socket->WriteUTF8(p_event->m_shared->GetSocketFrame()
+                                                                   ,p_event->m_shared->GetSocketLength())
+                                         : it->m_socket->WriteString(p_event->GetPayload());
+        if(written)
         {
           ++sent;
         }
@@ -788,33 +820,43 @@ ServerEventChannel::SendEventToStreams(LTEvent* p_event)
         continue;
       }
 
-      // Create SSE ServerEvent
-      XString type = LTEvent::EventTypeToString(p_event->m_type);
-      ServerEvent* event = new ServerEvent(type);
-      event->m_id = p_event->m_number;
-      if(p_event->m_type == EvtType::EV_Binary)
+      // Make sure channel is now open on the server side and 'in-use'
+      if(!m_openSeen)
+      {
+        OnOpen(_T(""));
+      }
+
+      bool delivered = false;
+      if(p_event->m_shared)
       {
-        Base64 base;
-        event->m_data = base.Encrypt(p_event->m_payload);
+        // Broadcasted events are encoded only once: send the shared frame
+        delivered = m_server->SendEventFrame(it->m_stream,p_event->m_shared->GetSSEFrame(),p_event->m_shared->GetSSELength());
       }
       else
       {
-        // Simply send the payload text
-        event->m_data = p_event->m_payload;
-        if(p_event->m_type == EvtType::EV_Message && !p_event->m_typeName.IsEmpty())
+        // Create SSE ServerEvent
+        XString type = LTEvent::EventTypeToString(p_event->m_type);
+        ServerEvent* event = new ServerEvent(type);
+        event->m_id = p_event->m_number;
+        if(p_event->m_type == EvtType::EV_Binary)
         {
-          event->m_event = p_event->m_typeName;
+          Base64 base;
+          event->m_data = base.Encrypt(p_event->GetPayload());
         }
+        else
+        {
+          // Simply send the payload text
+          event->m_data = p_event->GetPayload();
+          if(p_event->m_type == EvtType::EV_Message && !p_event->m_typeName.IsEmpty())
+          {
+            event->m_event = p_event->m_typeName;
+          }
+        }
+        delivered = m_server->SendEvent(it->m_stream,event);
       }
 
-      // Make sure channel is now open on the server side and 'in-use'
-      if(!m_openSeen)
-      {
-        OnOpen(_T(""));
-      }
-
-      // Send the event
-      if(m_server->SendEvent(it->m_stream, event))
+      // Register the result of the send
+      if(delivered)
       {
         ++sent;
       }
@@ -1031,7 +1073,7 @@ ServerEventChannel::OnOpen(XString p_message)
   }
   if(m_driver->GetActive())
   {
-  	m_driver->IncomingEvent();
+  	m_driver->IncomingEvent(this);
   }
   else
   {
@@ -1054,7 +1096,7 @@ ServerEventChannel::OnMessage(XString p_message)
   }
   if(m_driver->GetActive())
   {
-  	m_driver->IncomingEvent();
+  	m_driver->IncomingEvent(this);
   }
   else
   {
@@ -1076,7 +1118,7 @@ ServerEventChannel::OnError(XString p_message)
   }
   if(m_driver->GetActive())
   {
-  	m_driver->IncomingEvent();
+  	m_driver->IncomingEvent(this);
   }
   else
   {
@@ -1098,7 +1140,7 @@ ServerEventChannel::OnClose(XString p_message)
   }
   if(m_driver->GetActive())
   {
-  	m_driver->IncomingEvent();
+  	m_driver->IncomingEvent(this);
   }
   else
   {
@@ -1127,7 +1169,7 @@ ServerEventChannel::OnBinary(void* p_data,DWORD p_length)
   }
   if(m_driver->GetActive())
   {
-  	m_driver->IncomingEvent();
+  	m_driver->IncomingEvent(this);
   }
   else
   {
@@ -30,6 +30,7 @@
 #include "LongTermEvent.h"
 #include <deque>
 #include <vector>
+#include <atomic>
 
 class HTTPServer;
 class HTTPMessage;
@@ -37,6 +38,7 @@ class SOAPMessage;
 class WebSocket;
 class EventStream;
 class ServerEventDriver;
+class SharedEvent;
 
 // Types of channel connections
 // Each channel can have multiple types
@@ -89,6 +91,8 @@ public:
   bool CheckChannelPolicy();
   // Post a new event, giving a new event numerator
   int  PostEvent(XString p_payload,XString p_sender,EvtType p_type = EvtType::EV_Message,XString p_typeName = _T(""));
+  // Post a pre-encoded broadcast event, giving a new event numerator
+  int  PostBroadcast(SharedEvent* p_shared);
   // Flushing a channel directly
   bool FlushChannel();
   // Closing an event channel
@@ -110,6 +114,10 @@ public:
   XString GetCookieToken();
   int     GetQueueCount();
   int     GetClientCount();
+  // Scheduling in the ready-queue of the driver
+  // MarkScheduled returns false if the channel was already scheduled
+  bool    MarkScheduled()   { return !m_scheduled.exchange(true); }
+  void    ClearScheduled()  { m_scheduled = false; }
   // Current active type
   EventDriverType GetDriverType() { return m_current; }
 
@@ -157,6 +165,7 @@ private:
   EventQueue          m_inQueue;
   bool                m_openSeen    { false };
   bool                m_closeSeen   { false };
+  std::atomic<bool>   m_scheduled   { false };
   // We belong to this driver
   ServerEventDriver*  m_driver      { nullptr };
   HTTPServer*         m_server      { nullptr };
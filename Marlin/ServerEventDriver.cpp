@@ -30,6 +30,7 @@
 #include "SiteHandlerOptions.h"
 #include "HTTPServer.h"
 #include "WebSocketMain.h"
+#include "SharedEvent.h"
 #include "AutoCritical.h"
 
 #ifdef _AFX
@@ -79,11 +80,15 @@ SiteHandlerPolling::Handle(SOAPMessage* p_message)
 ServerEventDriver::ServerEventDriver()
 {
   InitializeCriticalSection(&m_lock);
+  // Shards are never reallocated while the channels are posting
+  m_shards.reserve(EVENT_SHARDS_MAX);
 }
 
 ServerEventDriver::~ServerEventDriver()
 {
+  StopEventDriver();
   Reset();
+  FreeShards();
   DeleteCriticalSection(&m_lock);
 }
 
@@ -237,6 +242,19 @@ ServerEventDriver::SetCookieTimeout(int p_minutes)
   }
 }
 
+// Number of sender shards (threads). Before starting the driver
+// Zero (the default) means: one shard per logical processor
+bool
+ServerEventDriver::SetSenderShards(int p_shards)
+{
+  if(m_active || p_shards < 0 || p_shards > EVENT_SHARDS_MAX)
+  {
+    return false;
+  }
+  m_shardCount = p_shards;
+  return true;
+}
+
 // Set or change the policy for a channel
 // To be called after 'RegisterChannel' or on a later moment to change the policy
 bool
@@ -325,13 +343,18 @@ ServerEventDriver::UnRegisterChannel(int p_channel,bool p_flush /*=true*/)
     }
   }
 
-  // Go on and lock the channels
-  AutoCritSec lock(&m_lock);
+  ServerEventChannel* channel = nullptr;
 
-  ChannelMap::iterator it = m_channels.find(p_channel);
-  if(it != m_channels.end())
+  // Go on and lock the channels
   {
-    ServerEventChannel* channel = it->second;
+    AutoCritSec lock(&m_lock);
+
+    ChannelMap::iterator it = m_channels.find(p_channel);
+    if(it == m_channels.end())
+    {
+      return false;
+    }
+    channel = it->second;
 
     // Erase from names speedup
     ChanNameMap::iterator nm = m_names.find(channel->GetChannelName());
@@ -345,16 +368,24 @@ ServerEventDriver::UnRegisterChannel(int p_channel,bool p_flush /*=true*/)
     {
       m_cookies.erase(ck);
     }
-
-    // Now go close the channel
-    channel->CloseChannel();
-
-    // Delete the channel completely
-    delete channel;
+    // Erase from all topics
+    for(auto& topic : m_topics)
+    {
+      topic.second.erase(p_channel);
+    }
     m_channels.erase(it);
-    return true;
   }
-  return false;
+
+  // No shard can find the channel anymore,
+  // but one could still be sending to it.
+  WaitForChannelIdle(p_channel);
+
+  // Now go close the channel
+  channel->CloseChannel();
+
+  // Delete the channel completely
+  delete channel;
+  return true;
 }
 
 // Start the event driver. Open for business if returned true
@@ -384,19 +415,22 @@ ServerEventDriver::StopEventDriver()
   // No more new postings from now on
   m_active = false;
   // Try to clear the queues one more time
-  SetEvent(m_event);
+  for(auto& shard : m_shards)
+  {
+    SetEvent(shard->m_event);
+  }
 
   for(int index = 0;index < MONITOR_END_LOOPS;++index)
   {
-    // See if monitor is already stopped sending
-    if(m_thread == NULL)
+    // See if all shards have already stopped sending
+    if(m_running == 0)
     {
       break;
     }
     Sleep(MONITOR_END_WAITMS);
   }
-  DETAILLOG1((m_thread == NULL) ? _T("EventDriver stopped") : _T("EventDriver still running!!"));
-  return (m_thread == NULL);
+  DETAILLOG1((m_running == 0) ? _T("EventDriver stopped") : _T("EventDriver still running!!"));
+  return (m_running == 0);
 }
 
 // Incoming new WebSocket
@@ -435,7 +469,7 @@ ServerEventDriver::IncomingNewStream(HTTPMessage* p_message,EventStream* p_strea
   // Possibly sent messages to newfound channel right away
   if(m_active)
   {
-    SetEvent(m_event);
+    ScheduleAllChannels();
   }
   return true;
 }
@@ -478,19 +512,145 @@ ServerEventDriver::PostEvent(int     p_session
     number = session->PostEvent(p_payload,p_returnToSender,p_type,p_typeName);
     if(m_active)
     {
-      // Kick the worker bee to start sending
-      ::SetEvent(m_event);
+      // Kick the worker bee of this channel to start sending
+      ScheduleChannel(session);
     }
   }
   return number;
 }
 
+// Broadcast one event to all channels
+// The event is encoded only once (SSE frame and WebSocket payload)
+// and shared between all channels, streams and sockets.
+// Returns the number of channels the event was posted to
+int
+ServerEventDriver::Broadcast(XString p_payload
+                            ,EvtType p_type     /*= EvtType::EV_Message */
+                            ,XString p_typeName /*= "" */)
+{
+  std::vector<ServerEventChannel*> channels;
+  {
+    AutoCritSec lock(&m_lock);
+    channels.reserve(m_channels.size());
+    for(const auto& chan : m_channels)
+    {
+      channels.push_back(chan.second);
+    }
+  }
+  return PostShared(channels,p_payload,p_type,p_typeName);
+}
+
+// Post one event to all channels subscribed to a topic
+// Returns the number of channels the event was posted to
+int
+ServerEventDriver::PostTopic(XString p_topic
+                            ,XString p_payload
+                            ,EvtType p_type     /*= EvtType::EV_Message */
+                            ,XString p_typeName /*= "" */)
+{
+  std::vector<ServerEventChannel*> channels;
+  {
+    AutoCritSec lock(&m_lock);
+    TopicMap::iterator it = m_topics.find(p_topic);
+    if(it == m_topics.end())
+    {
+      return 0;
+    }
+    channels.reserve(it->second.size());
+    for(const auto& number : it->second)
+    {
+      ChannelMap::iterator ch = m_channels.find(number);
+      if(ch != m_channels.end())
+      {
+        channels.push_back(ch->second);
+      }
+    }
+  }
+  return PostShared(channels,p_payload,p_type,p_typeName);
+}
+
+// Subscribe a channel to a topic
+bool
+ServerEventDriver::SubscribeTopic(int p_channel,XString p_topic)
+{
+  AutoCritSec lock(&m_lock);
+
+  if(p_topic.IsEmpty() || m_channels.find(p_channel) == m_channels.end())
+  {
+    return false;
+  }
+  m_topics[p_topic].insert(p_channel);
+  return true;
+}
+
+// Remove a channel from a topic
+bool
+ServerEventDriver::UnsubscribeTopic(int p_channel,XString p_topic)
+{
+  AutoCritSec lock(&m_lock);
+
+  TopicMap::iterator it = m_topics.find(p_topic);
+  if(it == m_topics.end() || it->second.erase(p_channel) == 0)
+  {
+    return false;
+  }
+  if(it->second.empty())
+  {
+    m_topics.erase(it);
+  }
+  return true;
+}
+
+// Number of channels subscribed to a topic
+int
+ServerEventDriver::GetTopicCount(XString p_topic)
+{
+  AutoCritSec lock(&m_lock);
+
+  TopicMap::iterator it = m_topics.find(p_topic);
+  if(it != m_topics.end())
+  {
+    return (int)it->second.size();
+  }
+  return 0;
+}
+
+// Encode the event once and post it to all the channels
+int
+ServerEventDriver::PostShared(std::vector<ServerEventChannel*>& p_channels
+                             ,XString p_payload
+                             ,EvtType p_type
+                             ,XString p_typeName)
+{
+  if(p_channels.empty())
+  {
+    return 0;
+  }
+
+  // Creator holds the first reference
+  SharedEvent* shared = new SharedEvent(m_server,p_type,p_typeName,p_payload);
+
+  for(auto& channel : p_channels)
+  {
+    channel->PostBroadcast(shared);
+    if(m_active)
+    {
+      // Kick the worker bee of this channel to start sending
+      ScheduleChannel(channel);
+    }
+  }
+  // Each queued event now holds its own reference
+  shared->DropReference();
+
+  return (int)p_channels.size();
+}
+
 // Incoming event. Called by the ServerEventChannel
 void
-ServerEventDriver::IncomingEvent()
+ServerEventDriver::IncomingEvent(ServerEventChannel* p_channel)
 {
-  // Kick the worker bee to start receiving
-  ::SetEvent(m_event);
+  // Kick the worker bee of this channel to start receiving
+  ScheduleChannel(p_channel);
 }
 
 // Returns the number of messages in the queue
@@ -575,6 +735,7 @@ ServerEventDriver::Reset()
   m_channels.clear();
   m_cookies.clear();
   m_names.clear();
+  m_topics.clear();
 }
 
 // Find an event session
@@ -782,147 +943,261 @@ ServerEventDriver::CheckBruteForceAttack(unsigned p_sender)
 
 static unsigned int __stdcall StartingTheDriverThread(void* p_context)
 {
-  ServerEventDriver* driver = reinterpret_cast<ServerEventDriver*>(p_context);
-  if(driver)
+  EventShard* shard = reinterpret_cast<EventShard*>(p_context);
+  if(shard && shard->m_driver)
   {
-    driver->EventThreadRunning();
+    shard->m_driver->EventThreadRunning(shard);
   }
   return 0;
 }
 
-// Start a thread for the streaming websocket/server-push event interface
+// Start the sender shards for the streaming websocket/server-push event interface
 bool
 ServerEventDriver::StartEventThread()
 {
-  // Create an event for the monitor
-  if(!m_event)
+  if(m_running > 0)
+  {
+    return false;
+  }
+  // Posting threads find the shards under the lock
+  AutoCritSec lock(&m_lock);
+  FreeShards();
+
+  // Default is one shard per logical processor
+  int shards = m_shardCount;
+  if(shards <= 0)
   {
-    m_event = CreateEvent(NULL,FALSE,FALSE,NULL);
+    SYSTEM_INFO info;
+    GetNativeSystemInfo(&info);
+    shards = min((int)info.dwNumberOfProcessors,EVENT_SHARDS_MAX);
+    shards = max(shards,1);
   }
 
-  if(m_thread == NULL || m_active == false)
+  for(int index = 0;index < shards;++index)
+  {
+    EventShard* shard = new EventShard();
+    shard->m_driver = this;
+    shard->m_index  = index;
+    shard->m_event  = CreateEvent(NULL,FALSE,FALSE,NULL);
+    InitializeCriticalSection(&shard->m_lock);
+    m_shards.push_back(shard);
+  }
+  m_shardCount = shards;
+
+  // Threads for the client queues
+  int started = 0;
+  for(auto& shard : m_shards)
   {
-    // Thread for the client queue
     unsigned int threadID = 0;
-    if((m_thread = reinterpret_cast<HANDLE>(_beginthreadex(NULL,0,StartingTheDriverThread,reinterpret_cast<void*>(this),0,&threadID))) == INVALID_HANDLE_VALUE)
+    ++m_running;
+    if((shard->m_thread = reinterpret_cast<HANDLE>(_beginthreadex(NULL,0,StartingTheDriverThread,reinterpret_cast<void*>(shard),0,&threadID))) == NULL)
     {
-      m_thread = NULL;
-      threadID = 0;
+      --m_running;
       ERRORLOG(ERROR_SERVICE_NOT_ACTIVE,_T("Cannot start a thread for an ServerEventDriver."));
     }
     else
     {
-      DETAILLOGV(_T("Thread started with threadID [%d] for ServerEventDriver."),threadID);
-      return true;
+      DETAILLOGV(_T("Thread started with threadID [%d] for ServerEventDriver shard [%d]."),threadID,shard->m_index);
+      ++started;
     }
   }
-  return false;
+  return started == shards;
+}
+
+// Free the shards. All shard threads must have been stopped
+void
+ServerEventDriver::FreeShards()
+{
+  AutoCritSec lock(&m_lock);
+
+  for(auto& shard : m_shards)
+  {
+    if(shard->m_thread)
+    {
+      // Thread has left its loop: wait for it to end before freeing its shard
+      WaitForSingleObject(shard->m_thread,MONITOR_END_LOOPS * MONITOR_END_WAITMS);
+      CloseHandle(shard->m_thread);
+    }
+    if(shard->m_event)
+    {
+      CloseHandle(shard->m_event);
+    }
+    DeleteCriticalSection(&shard->m_lock);
+    delete shard;
+  }
+  m_shards.clear();
+}
+
+// Place a channel in the ready-queue of its shard and wake the shard.
+// A channel is only placed once, until the shard starts sending it
+void
+ServerEventDriver::ScheduleChannel(ServerEventChannel* p_channel)
+{
+  // Shards can be renewed by StartEventThread
+  AutoCritSec lock(&m_lock);
+
+  size_t shards = m_shards.size();
+  if(shards == 0 || !p_channel->MarkScheduled())
+  {
+    return;
+  }
+  int number = p_channel->GetChannel();
+  EventShard* shard = m_shards[number % shards];
+  {
+    AutoCritSec lock(&shard->m_lock);
+    shard->m_ready.push_back(number);
+  }
+  SetEvent(shard->m_event);
+}
+
+// Schedule all channels with pending events (of one shard or all shards)
+void
+ServerEventDriver::ScheduleAllChannels(EventShard* p_shard /*= nullptr*/)
+{
+  AutoCritSec lock(&m_lock);
+
+  size_t shards = m_shards.size();
+  for(auto& chan : m_channels)
+  {
+    if(p_shard && (chan.first % shards) != (size_t)p_shard->m_index)
+    {
+      continue;
+    }
+    if(chan.second->GetQueueCount())
+    {
+      ScheduleChannel(chan.second);
+    }
+  }
+}
+
+// Wait until no shard is sending to this channel
+void
+ServerEventDriver::WaitForChannelIdle(int p_channel)
+{
+  while(true)
+  {
+    {
+      AutoCritSec lock(&m_lock);
+      if(m_shards.empty() || m_shards[p_channel % m_shards.size()]->m_busy != p_channel)
+      {
+        return;
+      }
+    }
+    Sleep(1);
+  }
 }
 
-// Main loop of the event runner
+// Main loop of a sender shard
 void
-ServerEventDriver::EventThreadRunning()
+ServerEventDriver::EventThreadRunning(EventShard* p_shard)
 {
   // Installing our SEH to exception translator
   _set_se_translator(SeTranslator);
 
   // Tell we are running
-  m_active   = true;
-  m_interval = MONITOR_INTERVAL_MIN;
+  m_active = true;
+  p_shard->m_interval = MONITOR_INTERVAL_MIN;
 
-  DETAILLOG1(_T("ServerEventDriver monitor started."));
+  DETAILLOGV(_T("ServerEventDriver shard [%d] started."),p_shard->m_index);
   do
   {
-    DWORD waited = WaitForSingleObjectEx(m_event,m_interval,true);
+    DWORD waited = WaitForSingleObjectEx(p_shard->m_event,p_shard->m_interval,true);
     switch(waited)
     {
-      case WAIT_TIMEOUT:        // Wake up once-in-a-while to be sure
+      case WAIT_TIMEOUT:        // Wake up once-in-a-while to be sure we did not miss an event
+                                ScheduleAllChannels(p_shard);
+                                [[fallthrough]];
       case WAIT_OBJECT_0:       // Explicit wake up by posting an event
-                                SendChannels();
+                                SendChannels(p_shard);
                                 break;
       case WAIT_IO_COMPLETION:  // Some I/O completed
       case WAIT_FAILED:         // Failed for some reason
       case WAIT_ABANDONED:      // Interrupted for some reason
       default:                  // Start a new monitor / new event
                                 break;
-    }                   
+    }
   }
   while(m_active);
 
-  // Reset the monitor
-  CloseHandle(m_event);
-  // Thread is now ready
-  m_thread = NULL;
+  // Try to clear the queues one more time
+  ScheduleAllChannels(p_shard);
+  SendChannels(p_shard);
+
+  // Shard is now ready
+  DETAILLOGV(_T("ServerEventDriver shard [%d] stopped."),p_shard->m_index);
+  --m_running;
 }
 
 void 
-ServerEventDriver::RecalculateInterval(int p_sent)
+ServerEventDriver::RecalculateInterval(EventShard* p_shard,int p_sent)
 {
   if(p_sent)
   {
-    m_interval = MONITOR_INTERVAL_MIN;
+    p_shard->m_interval = MONITOR_INTERVAL_MIN;
   }
   else
   {
-    m_interval *= 2;
-    if(m_interval > MONITOR_INTERVAL_MAX)
+    p_shard->m_interval *= 2;
+    if(p_shard->m_interval > MONITOR_INTERVAL_MAX)
     {
-      m_interval = MONITOR_INTERVAL_MAX;
+      p_shard->m_interval = MONITOR_INTERVAL_MAX;
     }
   }
-  DETAILLOGV(_T("ServerEventDriver monitor going to sleep. Back in [%d] milliseconds"),m_interval);
 }
 
+// Send and receive all channels in the ready-queue of a shard
 void
-ServerEventDriver::SendChannels()
+ServerEventDriver::SendChannels(EventShard* p_shard)
 {
-  DETAILLOG1(_T("ServerEventDriver monitor waking up. Sending/Receiving client channels."));
   int sent = 0;
 
-  ChannelMap channels;
-  // Create copy of the channels to be sending to.
-  // This makes it possible to halfway through let channels be added or removed.
-  // Added channels will be processed next time through (and if filled)
+  // Take the ready-queue in one go.
+  // Channels scheduled from here on, are processed next time through
+  ReadyQueue ready;
   {
-    AutoCritSec lock(&m_lock);
-    for(auto& chan : m_channels)
+    AutoCritSec lock(&p_shard->m_lock);
+    ready.swap(p_shard->m_ready);
+  }
+
+  for(auto& number : ready)
+  {
+    ServerEventChannel* channel = nullptr;
     {
-      if(chan.second->GetQueueCount())
+      // Channel could have been removed in the mean time
+      AutoCritSec lock(&m_lock);
+      ChannelMap::iterator it = m_channels.find(number);
+      if(it == m_channels.end())
       {
-        channels[chan.first] = chan.second;
+        continue;
       }
+      channel = it->second;
+      p_shard->m_busy = number;
     }
-  }
+    // Events posted from here on schedule the channel again
+    channel->ClearScheduled();
 
-  try
-  {
-    // All outbound traffic
-    for(auto& channel : channels)
+    try
     {
-      sent += channel.second->SendChannel();
+      // All outbound traffic
+      sent += channel->SendChannel();
+    }
+    catch(StdException& ex)
+    {
+      ERRORLOG(ERROR_UNHANDLED_EXCEPTION, _T("ServerEventDriver error while sending to channels: ") + ex.GetErrorMessage());
     }
-  }
-  catch(StdException& ex)
-  {
-    ERRORLOG(ERROR_UNHANDLED_EXCEPTION, _T("ServerEventDriver error while sending to channels: ") + ex.GetErrorMessage());
-  }
 
-  try
-  {
-    // All inbound traffic
-    for(auto& channel : channels)
+    try
     {
-      sent += channel.second->Receiving();
+      // All inbound traffic
+      sent += channel->Receiving();
     }
-  }
-  catch(StdException& ex)
-  {
-    ERRORLOG(ERROR_UNHANDLED_EXCEPTION, _T("ServerEventDriver error while receiving from channels: ") + ex.GetErrorMessage());
+    catch(StdException& ex)
+    {
+      ERRORLOG(ERROR_UNHANDLED_EXCEPTION, _T("ServerEventDriver error while receiving from channels: ") + ex.GetErrorMessage());
+    }
+    p_shard->m_busy = EVENT_SHARD_IDLE;
   }
 
   // When will we be back?
-  RecalculateInterval(sent);
-
-  // Yield time to other processing
-  Sleep(MONITOR_INTERVAL_MIN);
+  RecalculateInterval(p_shard,sent);
 }
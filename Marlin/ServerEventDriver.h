@@ -31,6 +31,10 @@
 #include "SiteHandlerWebSocket.h"
 #include "SiteHandlerSoap.h"
 #include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <atomic>
 
 //////////////////////////////////////////////////////////////////////////
 //
@@ -66,6 +70,10 @@ class ServerEventChannel;
 // Monitor wakes up every x milliseconds, to be sure if we missed an event
 #define MONITOR_INTERVAL_MIN      500
 #define MONITOR_INTERVAL_MAX     (10 * CLOCKS_PER_SEC)
+// Maximum number of sender shards (threads) of the driver
+#define EVENT_SHARDS_MAX          32
+// Shard is not sending to any channel (channel numbers can be 0)
+#define EVENT_SHARD_IDLE          -1
 // Minimum seconds for a brute-force attack vector
 #define BRUTEFORCE_INTERVAL_MIN  (3  * CLOCKS_PER_SEC)
 #define BRUTEFORCE_INTERVAL_MAX  (60 * CLOCKS_PER_SEC)
@@ -112,6 +120,27 @@ private:
 using ChannelMap  = std::map<int,     ServerEventChannel*>;
 using ChanNameMap = std::map<XString, ServerEventChannel*>;
 using SenderMap   = std::map<unsigned,clock_t>;
+using ReadyQueue  = std::deque<int>;
+using TopicMap    = std::map<XString,std::set<int>>;
+
+// One sender shard of the driver: a thread with a ready-queue.
+// Only channels with pending events are placed in the ready-queue.
+// A channel always goes to the same shard (channel number modulo shards)
+// so the events of one channel are never sent by two threads at once.
+class EventShard
+{
+public:
+  ServerEventDriver* m_driver   { nullptr };
+  int                m_index    { 0       };             // Index in the shards of the driver
+  HANDLE             m_thread   { NULL    };             // Sending thread
+  HANDLE             m_event    { NULL    };             // Wake-up for the ready-queue
+  int                m_interval { MONITOR_INTERVAL_MIN }; // Safety sweep interval
+  ReadyQueue         m_ready;                            // Channel numbers ready to be sent
+  std::atomic<int>   m_busy     { EVENT_SHARD_IDLE };    // Channel being sent right now
+  CRITICAL_SECTION   m_lock;                             // Locking the ready-queue
+};
+
+using EventShards = std::vector<EventShard*>;
 
 class ServerEventDriver
 {
@@ -138,6 +167,8 @@ public:
   bool  CheckChannelPolicy(int m_channel);
   // Cookie timout in minutes
   void  SetCookieTimeout(int p_minutes);
+  // Number of sender shards (threads). Before starting the driver
+  bool  SetSenderShards(int p_shards);
 
   // Flush messages as much as possible for a channel
   bool  FlushChannel(XString p_cookie,XString p_token);
@@ -157,6 +188,7 @@ public:
   bool        GetForceAuthentication()  { return m_force;     }
   size_t      GetNumberOfChannels()     { return m_channels.size(); }
   int         GetBruteForceInterval()   { return m_interval;  }
+  int         GetSenderShards()         { return m_shardCount;}
   int         GetChannelQueueCount (int     p_channel);
   int         GetChannelQueueCount (XString p_session);
   int         GetChannelClientCount(int     p_channel);
@@ -165,19 +197,28 @@ public:
   // OUR WORKHORSE: Post an event to the client
   // If 'returnToSender' is filled, only this client will receive the message
   int   PostEvent(int p_session,XString p_payload,XString p_returnToSender = _T(""),EvtType p_type = EvtType::EV_Message,XString p_typeName = _T(""));
+  // Post one event to ALL channels. Encoded only once for all streams/sockets
+  int   Broadcast(XString p_payload,EvtType p_type = EvtType::EV_Message,XString p_typeName = _T(""));
+  // Post one event to all channels subscribed to a topic
+  int   PostTopic(XString p_topic,XString p_payload,EvtType p_type = EvtType::EV_Message,XString p_typeName = _T(""));
+  // Topic subscriptions of the channels
+  bool  SubscribeTopic  (int p_channel,XString p_topic);
+  bool  UnsubscribeTopic(int p_channel,XString p_topic);
+  int   GetTopicCount(XString p_topic);
 
-  // Main loop of the event runner. DO NOT CALL!
-  void  EventThreadRunning();
+  // Main loop of a sender shard. DO NOT CALL!
+  void  EventThreadRunning(EventShard* p_shard);
   // Brute force attack detection. Called by the ServerEventChannel
   bool  CheckBruteForceAttack(unsigned p_sender);
   // Incoming event. Called by the ServerEventChannel
-  void  IncomingEvent();
+  void  IncomingEvent(ServerEventChannel* p_channel);
 
 private:
   // Reset the driver
   void  Reset();
-  // Start a thread for the streaming WebSocket/server-push event interface
+  // Start the sender shards for the streaming WebSocket/server-push event interface
   bool  StartEventThread();
+  void  FreeShards();
   // Find a channel from the routing information
   XString FindChannel(const Routing& p_routing,XString p_base);
 
@@ -194,8 +235,13 @@ private:
   bool HandlePollingByRouting (SOAPMessage* p_message);
 
   // Working on the channels
-  void SendChannels();
-  void RecalculateInterval(int p_sent);
+  void ScheduleChannel(ServerEventChannel* p_channel);
+  void ScheduleAllChannels(EventShard* p_shard = nullptr);
+  void SendChannels(EventShard* p_shard);
+  void RecalculateInterval(EventShard* p_shard,int p_sent);
+  void WaitForChannelIdle(int p_channel);
+  // Post a shared event to a set of channels
+  int  PostShared(std::vector<ServerEventChannel*>& p_channels,XString p_payload,EvtType p_type,XString p_typeName);
 
   // DATA
   HTTPServer*     m_server { nullptr };     // Our HTTP server
@@ -207,13 +253,15 @@ private:
   ChannelMap      m_channels;               // All channels (by channel number)
   ChanNameMap     m_names;                  // Extra redundant lookup in the channels for speed by session-name
   ChanNameMap     m_cookies;                // Extra redundant lookup in the channels for speed by cookie:value
+  TopicMap        m_topics;                 // Channel numbers subscribed to a topic
   int             m_cookieTimeout { 0 };    // Timeout for cookies in minutes
   // Brute force attack on the event channels
   SenderMap       m_senders;                // Last time of sender attach
   int             m_interval { 10 * CLOCKS_PER_SEC };
-  // The worker bee
-  HANDLE          m_thread { NULL };
-  HANDLE          m_event  { NULL };
+  // The worker bees
+  EventShards     m_shards;                 // Sender shards with their ready-queues
+  int             m_shardCount { 0 };       // Number of shards (0 = number of processors)
+  std::atomic<int> m_running   { 0 };       // Number of running shard threads
   // Metadata for secure cookie encryption
   // Requires that the metadata for all cookies are the same
   XString         m_metadata;
@@ -0,0 +1,852 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: ServerSupervisor.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "ServerSupervisor.h"
+#include "HTTPServerSocket.h"
+#include "HTTPSite.h"
+#include "HTTPClient.h"
+#include "SiteHandler.h"
+#include "AutoCritical.h"
+#include "WinSocket.h"
+#include <Metrics.h>
+#include <set>
+#include <process.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// Health checks and metrics must be quick, or the worker is unhealthy
+#define SUPERVISOR_CONTROL_TIMEOUT   2000
+
+static LPCTSTR
+WorkerStateToString(WorkerState p_state)
+{
+  switch(p_state)
+  {
+    case WorkerState::WS_Stopped:  return _T("stopped");
+    case WorkerState::WS_Starting: return _T("starting");
+    case WorkerState::WS_Running:  return _T("running");
+    case WorkerState::WS_Draining: return _T("draining");
+  }
+  return _T("");
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE SUPERVISOR
+//
+//////////////////////////////////////////////////////////////////////////
+
+ServerSupervisor::ServerSupervisor(XString p_name)
+                 :m_name(p_name)
+{
+  InitializeCriticalSection(&m_lock);
+  InitializeCriticalSection(&m_manage);
+  SetWorkers(0);
+}
+
+ServerSupervisor::~ServerSupervisor()
+{
+  Stop();
+  DeleteCriticalSection(&m_manage);
+  DeleteCriticalSection(&m_lock);
+}
+
+void
+ServerSupervisor::ReadConfig(MarlinConfig& p_config)
+{
+  SetWorkers(p_config.GetParameterInteger(_T("Supervisor"),_T("Workers"),m_workers));
+  m_controlPort    = p_config.GetParameterInteger(_T("Supervisor"),_T("ControlPort"),   m_controlPort);
+  m_program        = p_config.GetParameterString (_T("Supervisor"),_T("Program"),       m_program);
+  m_arguments      = p_config.GetParameterString (_T("Supervisor"),_T("Arguments"),     m_arguments);
+  m_startTimeout   = p_config.GetParameterInteger(_T("Supervisor"),_T("StartTimeout"),  m_startTimeout);
+  m_stopTimeout    = p_config.GetParameterInteger(_T("Supervisor"),_T("StopTimeout"),   m_stopTimeout);
+  m_healthInterval = p_config.GetParameterInteger(_T("Supervisor"),_T("HealthInterval"),m_healthInterval);
+
+  XString ports = p_config.GetParameterString(_T("Supervisor"),_T("Ports"),_T(""));
+  int pos = 0;
+  XString port = ports.Tokenize(_T(",; "),pos);
+  while(!port.IsEmpty())
+  {
+    AddPort(_ttoi(port));
+    port = ports.Tokenize(_T(",; "),pos);
+  }
+}
+
+// Default is one worker per processor
+void
+ServerSupervisor::SetWorkers(int p_workers)
+{
+  if(p_workers <= 0)
+  {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    p_workers = (int)info.dwNumberOfProcessors;
+  }
+  m_workers = min(p_workers,SUPERVISOR_MAXIMUM_WORKERS);
+}
+
+static unsigned int
+__stdcall StartingTheMonitor(void* p_context)
+{
+  ServerSupervisor* supervisor = reinterpret_cast<ServerSupervisor*>(p_context);
+  supervisor->RunMonitor();
+  return 0;
+}
+
+bool
+ServerSupervisor::Start()
+{
+  AutoCritSec manage(&m_manage);
+  AutoCritSec lock(&m_lock);
+
+  if(m_running)
+  {
+    return true;
+  }
+  if(m_program.IsEmpty())
+  {
+    TCHAR program[MAX_PATH + 1] = _T("");
+    GetModuleFileName(NULL,program,MAX_PATH);
+    m_program = program;
+  }
+  if(!OpenListeners())
+  {
+    return false;
+  }
+
+  // Start all workers at once, then wait for all of them
+  bool result = true;
+  for(int index = 0; index < m_workers; ++index)
+  {
+    WorkerProcess* worker = new WorkerProcess();
+    worker->m_index       = index;
+    worker->m_controlPort = m_controlPort + index;
+    m_processes.push_back(worker);
+    result &= StartWorker(worker);
+  }
+  for(auto& worker : m_processes)
+  {
+    result &= WaitHealthy(worker);
+  }
+  m_running = true;
+
+  m_wakeup = CreateEvent(NULL,TRUE,FALSE,NULL);
+  unsigned int threadID = 0;
+  m_monitor = reinterpret_cast<HANDLE>(_beginthreadex(NULL,0,StartingTheMonitor,reinterpret_cast<void*>(this),0,&threadID));
+  return result;
+}
+
+// Every worker is replaced by a new one. The new worker must be healthy
+// before the old one drains, so the shared ports keep being served.
+// The new worker uses the alternate control port (ControlPort + Workers + index)
+bool
+ServerSupervisor::RollingRestart()
+{
+  for(int index = 0; index < m_workers; ++index)
+  {
+    // One worker at the time. The monitor waits in between
+    AutoCritSec manage(&m_manage);
+    if(!m_running || index >= (int)m_processes.size())
+    {
+      return false;
+    }
+    WorkerProcess* old = m_processes[index];
+    WorkerProcess* worker = new WorkerProcess();
+    worker->m_index       = index;
+    worker->m_restarts    = old->m_restarts + 1;
+    worker->m_controlPort = old->m_controlPort < m_controlPort + m_workers
+                          ? old->m_controlPort + m_workers
+                          : old->m_controlPort - m_workers;
+    if(!StartWorker(worker) || !WaitHealthy(worker))
+    {
+      // Keep the old worker serving
+      StopWorker(worker);
+      CloseWorker(worker);
+      delete worker;
+      return false;
+    }
+    {
+      AutoCritSec lock(&m_lock);
+      m_processes[index] = worker;
+    }
+    StopWorker(old);
+    CloseWorker(old);
+    delete old;
+  }
+  return true;
+}
+
+void
+ServerSupervisor::Stop()
+{
+  if(m_monitor)
+  {
+    SetEvent(m_wakeup);
+    WaitForSingleObject(m_monitor,INFINITE);
+    CloseHandle(m_monitor);
+    m_monitor = NULL;
+  }
+  if(m_wakeup)
+  {
+    CloseHandle(m_wakeup);
+    m_wakeup = NULL;
+  }
+
+  // Take the workers away, so waiting for them does not block the readers
+  AutoCritSec manage(&m_manage);
+  WorkerProcesses workers;
+  {
+    AutoCritSec lock(&m_lock);
+    workers.swap(m_processes);
+    m_running = false;
+  }
+
+  // Signal all workers at once, so they drain in parallel
+  for(auto& worker : workers)
+  {
+    if(worker->m_stopEvent)
+    {
+      worker->m_state = WorkerState::WS_Draining;
+      SetEvent(worker->m_stopEvent);
+    }
+  }
+  for(auto& worker : workers)
+  {
+    StopWorker(worker);
+    CloseWorker(worker);
+    delete worker;
+  }
+  CloseListeners();
+}
+
+// The health checks and restarts are done outside the lock of the workers,
+// so GetHealth and GetHealthyWorkers never wait for a worker.
+// Holding 'm_manage' keeps the workers from being replaced or deleted meanwhile.
+void
+ServerSupervisor::RunMonitor()
+{
+  while(WaitForSingleObject(m_wakeup,m_healthInterval) == WAIT_TIMEOUT)
+  {
+    AutoCritSec manage(&m_manage);
+
+    WorkerProcesses workers;
+    {
+      AutoCritSec lock(&m_lock);
+      workers = m_processes;
+    }
+    for(int index = 0; index < (int)workers.size(); ++index)
+    {
+      WorkerProcess* worker = workers[index];
+      if(worker->m_state == WorkerState::WS_Draining)
+      {
+        continue;
+      }
+      if(worker->m_process == NULL || WaitForSingleObject(worker->m_process,0) == WAIT_OBJECT_0)
+      {
+        // Crashed or never started: start a new process in its place
+        WorkerProcess* restart = new WorkerProcess();
+        restart->m_index       = worker->m_index;
+        restart->m_controlPort = worker->m_controlPort;
+        restart->m_restarts    = worker->m_restarts + 1;
+        StartWorker(restart);
+        {
+          AutoCritSec lock(&m_lock);
+          m_processes[index] = restart;
+        }
+        CloseWorker(worker);
+        delete worker;
+        continue;
+      }
+      XString health;
+      bool healthy = GetControl(worker->m_controlPort,_T("health"),health);
+
+      AutoCritSec lock(&m_lock);
+      worker->m_healthy = healthy;
+      if(healthy)
+      {
+        worker->m_state = WorkerState::WS_Running;
+      }
+    }
+  }
+}
+
+int
+ServerSupervisor::GetHealthyWorkers()
+{
+  AutoCritSec lock(&m_lock);
+
+  int healthy = 0;
+  for(auto& worker : m_processes)
+  {
+    if(worker->m_healthy)
+    {
+      ++healthy;
+    }
+  }
+  return healthy;
+}
+
+XString
+ServerSupervisor::GetHealth()
+{
+  AutoCritSec lock(&m_lock);
+
+  int healthy = 0;
+  XString processes;
+  for(auto& worker : m_processes)
+  {
+    healthy += worker->m_healthy ? 1 : 0;
+    processes.AppendFormat(_T("%s{\"worker\":%d,\"pid\":%u,\"control\":%d,\"state\":\"%s\",\"healthy\":%s,\"restarts\":%d}")
+                          ,processes.IsEmpty() ? _T("") : _T(",")
+                          ,worker->m_index
+                          ,worker->m_pid
+                          ,worker->m_controlPort
+                          ,WorkerStateToString(worker->m_state)
+                          ,worker->m_healthy ? _T("true") : _T("false")
+                          ,worker->m_restarts);
+  }
+  XString health;
+  health.Format(_T("{\"supervisor\":\"%s\",\"workers\":%d,\"healthy\":%d,\"processes\":[%s]}")
+               ,m_name.GetString(),(int)m_processes.size(),healthy,processes.GetString());
+  return health;
+}
+
+// All samples get a 'worker' label. HELP and TYPE lines are shown once.
+// The samples of all workers are grouped by metric family, as the
+// exposition format requires all lines of one family to be together.
+// The workers are asked outside the lock of the workers.
+XString
+ServerSupervisor::GetMetrics()
+{
+  std::vector<std::pair<int,int>> workers;  // Index and control port
+  int healthy  = 0;
+  int restarts = 0;
+  {
+    AutoCritSec lock(&m_lock);
+    for(auto& worker : m_processes)
+    {
+      healthy  += worker->m_healthy ? 1 : 0;
+      restarts += worker->m_restarts;
+      workers.push_back(std::make_pair(worker->m_index,worker->m_controlPort));
+    }
+  }
+
+  std::vector<XString>      families;       // In order of appearance
+  std::map<XString,XString> lines;          // Comments and samples per family
+  std::set<XString>         comments;
+
+  for(auto& worker : workers)
+  {
+    XString metrics;
+    if(!GetControl(worker.second,_T("metrics"),metrics))
+    {
+      continue;
+    }
+    XString label;
+    label.Format(_T("worker=\"%d\""),worker.first);
+
+    XString family;
+    int pos = 0;
+    XString line = metrics.Tokenize(_T("\n"),pos);
+    while(!line.IsEmpty())
+    {
+      line.TrimRight('\r');
+      if(line.GetAt(0) == '#')
+      {
+        // "# HELP <family> ..." or "# TYPE <family> ..."
+        int tokenpos = 0;
+        line.Tokenize(_T(" "),tokenpos);
+        line.Tokenize(_T(" "),tokenpos);
+        family = line.Tokenize(_T(" "),tokenpos);
+        if(lines.find(family) == lines.end())
+        {
+          families.push_back(family);
+        }
+        if(comments.insert(line).second)
+        {
+          lines[family] += line + _T("\n");
+        }
+      }
+      else
+      {
+        // Samples of a histogram or summary have a suffix to the family name
+        XString name = line.SpanExcluding(_T("{ "));
+        if(family.IsEmpty() || name.Find(family) != 0)
+        {
+          family = name;
+          if(lines.find(family) == lines.end())
+          {
+            families.push_back(family);
+          }
+        }
+        int brace = line.Find('{');
+        if(brace > 0)
+        {
+          line.Insert(brace + 1,label + _T(","));
+        }
+        else
+        {
+          int space = line.Find(' ');
+          if(space > 0)
+          {
+            line.Insert(space,_T("{") + label + _T("}"));
+          }
+        }
+        lines[family] += line + _T("\n");
+      }
+      line = metrics.Tokenize(_T("\n"),pos);
+    }
+  }
+
+  XString result;
+  for(auto& family : families)
+  {
+    result += lines[family];
+  }
+  result.AppendFormat(_T("# HELP marlin_supervisor_workers Configured worker processes\n")
+                      _T("# TYPE marlin_supervisor_workers gauge\n")
+                      _T("marlin_supervisor_workers %d\n")
+                      _T("# HELP marlin_supervisor_healthy Healthy worker processes\n")
+                      _T("# TYPE marlin_supervisor_healthy gauge\n")
+                      _T("marlin_supervisor_healthy %d\n")
+                      _T("# HELP marlin_supervisor_restarts_total Restarted worker processes\n")
+                      _T("# TYPE marlin_supervisor_restarts_total counter\n")
+                      _T("marlin_supervisor_restarts_total %d\n")
+                     ,m_workers,healthy,restarts);
+  return result;
+}
+
+// The supervisor owns the shared listening sockets
+bool
+ServerSupervisor::OpenListeners()
+{
+  if(!MarlinStartupWinsocket())
+  {
+    return false;
+  }
+  for(auto& port : m_ports)
+  {
+    if(m_listeners.find(port) != m_listeners.end())
+    {
+      continue;
+    }
+    SOCKET listener = socket(AF_INET6,SOCK_STREAM,IPPROTO_TCP);
+    if(listener == INVALID_SOCKET)
+    {
+      return false;
+    }
+    int  off       = 0;
+    BOOL exclusive = TRUE;
+    setsockopt(listener,IPPROTO_IPV6,IPV6_V6ONLY,(const char*)&off,sizeof(int));
+    setsockopt(listener,SOL_SOCKET,SO_EXCLUSIVEADDRUSE,(const char*)&exclusive,sizeof(BOOL));
+
+    sockaddr_in6 address;
+    memset(&address,0,sizeof(sockaddr_in6));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr   = in6addr_any;
+    address.sin6_port   = htons((unsigned short)port);
+
+    if(bind(listener,(sockaddr*)&address,sizeof(sockaddr_in6)) != 0 ||
+       listen(listener,SOCKET_LISTEN_BACKLOG) != 0)
+    {
+      closesocket(listener);
+      return false;
+    }
+    m_listeners[port] = listener;
+  }
+  return true;
+}
+
+void
+ServerSupervisor::CloseListeners()
+{
+  for(auto& listener : m_listeners)
+  {
+    SocketPoll::CloseSocket(listener.second);
+  }
+  m_listeners.clear();
+}
+
+// Start the process suspended, so the shared sockets can be duplicated
+// into it before it starts. They are passed through an anonymous pipe.
+bool
+ServerSupervisor::StartWorker(WorkerProcess* p_worker)
+{
+  SECURITY_ATTRIBUTES attributes;
+  attributes.nLength              = sizeof(SECURITY_ATTRIBUTES);
+  attributes.lpSecurityDescriptor = NULL;
+  attributes.bInheritHandle       = TRUE;
+
+  HANDLE readPipe  = NULL;
+  HANDLE writePipe = NULL;
+  if(!CreatePipe(&readPipe,&writePipe,&attributes,0))
+  {
+    return false;
+  }
+  SetHandleInformation(writePipe,HANDLE_FLAG_INHERIT,0);
+
+  XString command;
+  command.Format(_T("\"%s\" %s%d,%d,%I64u,%d,%u %s")
+                ,m_program.GetString()
+                ,SUPERVISOR_WORKER_ARGUMENT
+                ,p_worker->m_index
+                ,p_worker->m_controlPort
+                ,(unsigned __int64)readPipe
+                ,m_stopTimeout
+                ,GetCurrentProcessId()
+                ,m_arguments.GetString());
+
+  STARTUPINFO startup;
+  PROCESS_INFORMATION process;
+  memset(&startup,0,sizeof(STARTUPINFO));
+  memset(&process,0,sizeof(PROCESS_INFORMATION));
+  startup.cb = sizeof(STARTUPINFO);
+
+  BOOL created = CreateProcess(NULL,command.GetBuffer(),NULL,NULL,TRUE,CREATE_SUSPENDED,NULL,NULL,&startup,&process);
+  command.ReleaseBuffer();
+  CloseHandle(readPipe);
+  if(!created)
+  {
+    CloseHandle(writePipe);
+    return false;
+  }
+  p_worker->m_pid       = process.dwProcessId;
+  p_worker->m_process   = process.hProcess;
+  p_worker->m_state     = WorkerState::WS_Starting;
+  p_worker->m_healthy   = false;
+
+  XString eventName;
+  eventName.Format(SUPERVISOR_STOP_EVENT,p_worker->m_pid);
+  p_worker->m_stopEvent = CreateEvent(NULL,TRUE,FALSE,eventName);
+
+  bool result = PassListeners(p_worker,writePipe);
+  CloseHandle(writePipe);
+
+  ResumeThread(process.hThread);
+  CloseHandle(process.hThread);
+  return result;
+}
+
+// Per shared port: the port number and the protocol info of the duplicate
+// A port number of zero ends the list
+bool
+ServerSupervisor::PassListeners(WorkerProcess* p_worker,HANDLE p_pipe)
+{
+  bool  result  = true;
+  DWORD written = 0;
+  for(auto& listener : m_listeners)
+  {
+    WSAPROTOCOL_INFO info;
+    if(WSADuplicateSocket(listener.second,p_worker->m_pid,&info) != 0)
+    {
+      result = false;
+      continue;
+    }
+    int port = listener.first;
+    result &= WriteFile(p_pipe,&port,sizeof(int),&written,NULL) &&
+              WriteFile(p_pipe,&info,sizeof(WSAPROTOCOL_INFO),&written,NULL);
+  }
+  int end = 0;
+  result &= (WriteFile(p_pipe,&end,sizeof(int),&written,NULL) == TRUE);
+  return result;
+}
+
+bool
+ServerSupervisor::WaitHealthy(WorkerProcess* p_worker)
+{
+  ULONGLONG end = GetTickCount64() + m_startTimeout;
+  while(GetTickCount64() < end)
+  {
+    if(p_worker->m_process == NULL || WaitForSingleObject(p_worker->m_process,0) == WAIT_OBJECT_0)
+    {
+      return false;
+    }
+    if(CheckHealth(p_worker))
+    {
+      p_worker->m_state = WorkerState::WS_Running;
+      return true;
+    }
+    Sleep(100);
+  }
+  return false;
+}
+
+// Drain the worker. Kill it if it cannot make it in time
+void
+ServerSupervisor::StopWorker(WorkerProcess* p_worker)
+{
+  if(p_worker->m_process == NULL)
+  {
+    return;
+  }
+  p_worker->m_state   = WorkerState::WS_Draining;
+  p_worker->m_healthy = false;
+  if(p_worker->m_stopEvent)
+  {
+    SetEvent(p_worker->m_stopEvent);
+  }
+  if(WaitForSingleObject(p_worker->m_process,m_stopTimeout) != WAIT_OBJECT_0)
+  {
+    TerminateProcess(p_worker->m_process,ERROR_TIMEOUT);
+    WaitForSingleObject(p_worker->m_process,INFINITE);
+  }
+}
+
+void
+ServerSupervisor::CloseWorker(WorkerProcess* p_worker)
+{
+  if(p_worker->m_process)
+  {
+    CloseHandle(p_worker->m_process);
+    p_worker->m_process = NULL;
+  }
+  if(p_worker->m_stopEvent)
+  {
+    CloseHandle(p_worker->m_stopEvent);
+    p_worker->m_stopEvent = NULL;
+  }
+  p_worker->m_pid     = 0;
+  p_worker->m_healthy = false;
+  p_worker->m_state   = WorkerState::WS_Stopped;
+}
+
+bool
+ServerSupervisor::CheckHealth(WorkerProcess* p_worker)
+{
+  XString health;
+  p_worker->m_healthy = GetControl(p_worker->m_controlPort,_T("health"),health);
+  return p_worker->m_healthy;
+}
+
+bool
+ServerSupervisor::GetControl(int p_controlPort,LPCTSTR p_resource,XString& p_body)
+{
+  XString url;
+  url.Format(_T("http://localhost:%d%s%s"),p_controlPort,SUPERVISOR_CONTROL_URL,p_resource);
+
+  HTTPClient client;
+  client.SetTimeoutConnect(SUPERVISOR_CONTROL_TIMEOUT);
+  client.SetTimeoutSend   (SUPERVISOR_CONTROL_TIMEOUT);
+  client.SetTimeoutReceive(SUPERVISOR_CONTROL_TIMEOUT);
+
+  HTTPMessage msg(HTTPCommand::http_get,url);
+  if(!client.Send(&msg) || msg.GetStatus() != HTTP_STATUS_OK)
+  {
+    return false;
+  }
+  p_body = msg.GetBody();
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THE WORKER
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Health and metrics of a worker on its private control port
+class SiteHandlerControl : public SiteHandler
+{
+public:
+  SiteHandlerControl(HTTPServerSocket* p_server,int p_index) : m_server(p_server),m_index(p_index) {}
+
+protected:
+  virtual bool Handle(HTTPMessage* p_message) override
+  {
+    XString resource = p_message->GetAbsoluteResource();
+    XString body;
+    XString type(_T("application/json"));
+
+    if(resource.Right(6).CompareNoCase(_T("health")) == 0)
+    {
+      body.Format(_T("{\"worker\":%d,\"pid\":%u,\"connections\":%u,\"requests\":%u,\"draining\":%s}")
+                 ,m_index
+                 ,GetCurrentProcessId()
+                 ,m_server->GetConnectionCount()
+                 ,m_server->GetRequestCount()
+                 ,m_server->GetIsDraining() ? _T("true") : _T("false"));
+    }
+    else if(resource.Right(7).CompareNoCase(_T("metrics")) == 0)
+    {
+      body = GetMetricsRegistry().ExportPrometheus();
+      type = _T("text/plain; version=0.0.4; charset=utf-8");
+    }
+    p_message->Reset();
+    p_message->GetFileBuffer()->Reset();
+    p_message->SetCommand(HTTPCommand::http_response);
+    if(body.IsEmpty())
+    {
+      p_message->SetStatus(HTTP_STATUS_NOT_FOUND);
+      return true;
+    }
+    p_message->SetContentType(type);
+    p_message->SetBody(body,_T("utf-8"));
+    p_message->SetStatus(HTTP_STATUS_OK);
+    return true;
+  }
+
+private:
+  HTTPServerSocket* m_server;
+  int               m_index;
+};
+
+ServerWorker::ServerWorker()
+{
+}
+
+ServerWorker::~ServerWorker()
+{
+  if(m_stopEvent)
+  {
+    CloseHandle(m_stopEvent);
+  }
+  if(m_supervisor)
+  {
+    CloseHandle(m_supervisor);
+  }
+}
+
+// static
+bool
+ServerWorker::IsWorker()
+{
+  XString command(GetCommandLine());
+  return command.Find(SUPERVISOR_WORKER_ARGUMENT) >= 0;
+}
+
+bool
+ServerWorker::Initialise(HTTPServerSocket* p_server)
+{
+  m_server = p_server;
+
+  HANDLE pipe = NULL;
+  if(!ParseArguments(pipe))
+  {
+    return false;
+  }
+  // Ports of the sites will be shared with the other workers
+  m_server->SetSharedListeners(true);
+  bool result = AdoptListeners(pipe);
+  CloseHandle(pipe);
+  if(!result)
+  {
+    return false;
+  }
+
+  // Our private control site
+  HTTPSite* site = m_server->CreateSite(PrefixType::URLPRE_Strong,false,m_controlPort,SUPERVISOR_CONTROL_URL);
+  if(site == nullptr)
+  {
+    return false;
+  }
+  site->SetHandler(HTTPCommand::http_get,new SiteHandlerControl(m_server,m_index));
+  return site->StartSite();
+}
+
+// Returns with all connections finished (or the drain time passed)
+// when the supervisor stops us, or the supervisor is gone.
+bool
+ServerWorker::WaitForStop(DWORD p_timeout /*= INFINITE*/)
+{
+  if(m_stopEvent == NULL || m_server == nullptr)
+  {
+    return false;
+  }
+  HANDLE events[2] = { m_stopEvent,m_supervisor };
+  DWORD  count     = m_supervisor ? 2 : 1;
+  if(WaitForMultipleObjects(count,events,FALSE,p_timeout) == WAIT_TIMEOUT)
+  {
+    return false;
+  }
+  m_server->StopListening();
+
+  ULONGLONG end = GetTickCount64() + m_drainTime;
+  while(m_server->GetConnectionCount() > 0 && GetTickCount64() < end)
+  {
+    Sleep(100);
+  }
+  return true;
+}
+
+// Format: /marlinworker:<index>,<control port>,<pipe>,<drain time>,<supervisor process>
+bool
+ServerWorker::ParseArguments(HANDLE& p_pipe)
+{
+  XString command(GetCommandLine());
+  int pos = command.Find(SUPERVISOR_WORKER_ARGUMENT);
+  if(pos < 0)
+  {
+    return false;
+  }
+  XString arguments = command.Mid(pos + (int)_tcslen(SUPERVISOR_WORKER_ARGUMENT));
+  unsigned __int64 pipe = 0;
+  unsigned supervisor   = 0;
+  if(_stscanf_s(arguments,_T("%d,%d,%I64u,%d,%u"),&m_index,&m_controlPort,&pipe,&m_drainTime,&supervisor) != 5)
+  {
+    return false;
+  }
+  p_pipe = (HANDLE)pipe;
+
+  XString eventName;
+  eventName.Format(SUPERVISOR_STOP_EVENT,GetCurrentProcessId());
+  m_stopEvent  = OpenEvent(SYNCHRONIZE,FALSE,eventName);
+  m_supervisor = OpenProcess(SYNCHRONIZE,FALSE,supervisor);
+  return m_stopEvent != NULL;
+}
+
+bool
+ServerWorker::AdoptListeners(HANDLE p_pipe)
+{
+  bool  result = true;
+  DWORD read   = 0;
+  int   port   = 0;
+  if(!MarlinStartupWinsocket())
+  {
+    return false;
+  }
+  while(ReadFile(p_pipe,&port,sizeof(int),&read,NULL) && read == sizeof(int) && port > 0)
+  {
+    WSAPROTOCOL_INFO info;
+    if(!ReadFile(p_pipe,&info,sizeof(WSAPROTOCOL_INFO),&read,NULL) || read != sizeof(WSAPROTOCOL_INFO))
+    {
+      return false;
+    }
+    SOCKET listener = WSASocket(FROM_PROTOCOL_INFO,FROM_PROTOCOL_INFO,FROM_PROTOCOL_INFO,&info,0,WSA_FLAG_OVERLAPPED);
+    if(listener == INVALID_SOCKET || !m_server->AdoptListener(port,listener))
+    {
+      result = false;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,199 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: ServerSupervisor.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "MarlinConfig.h"
+#include "SocketPoll.h"
+#include <vector>
+#include <map>
+
+// Multi-process serving with the socket based HTTPServer
+//
+// The ServerSupervisor starts <n> worker processes of the same program that
+// all serve the same listening ports. The supervisor owns the listening
+// sockets and hands them to the workers (CreateProcess and WSADuplicateSocket).
+// Each worker has a private control port for its health and metrics.
+//
+// The supervisor restarts crashed workers, can do a rolling restart
+// (new worker first, then drain the old one) and aggregates the health
+// and the metrics of all workers.
+//
+// Configuration in the "Supervisor" section of the Marlin.config:
+// - Workers        : Number of worker processes (default the number of processors)
+// - Ports          : Comma separated list of the shared listening ports
+// - ControlPort    : Private port of the first worker. Next worker is one higher.
+// - Program        : Worker program (default: the supervisor program itself)
+// - Arguments      : Extra command line arguments for the workers
+// - StartTimeout   : Milliseconds for a worker to become healthy
+// - StopTimeout    : Milliseconds for a worker to drain its connections
+// - HealthInterval : Milliseconds between the health checks
+//
+// The sites of the workers must use the shared 'Ports'. Do not use the "Server"
+// section 'Port' setting: it would also move the private control site.
+// A rolling restart uses the alternate control ports (ControlPort + Workers + n).
+//
+// A worker program uses the ServerWorker:
+//
+//   if(ServerWorker::IsWorker())
+//   {
+//     ServerWorker worker;
+//     worker.Initialise(server);   // Before the sites are started
+//     ... create and start the sites, server->Run() ...
+//     worker.WaitForStop();        // Returns drained, on request of the supervisor
+//     server->StopServer();
+//   }
+
+#define SUPERVISOR_DEFAULT_CONTROLPORT  1300          // First private control port
+#define SUPERVISOR_DEFAULT_STARTTIMEOUT 30000         // Worker must be healthy within 30 seconds
+#define SUPERVISOR_DEFAULT_STOPTIMEOUT  30000         // Worker must be drained within 30 seconds
+#define SUPERVISOR_DEFAULT_INTERVAL     5000          // Health check every 5 seconds
+#define SUPERVISOR_MAXIMUM_WORKERS      256           // No more processes than this
+#define SUPERVISOR_CONTROL_URL          _T("/MarlinControl/")
+#define SUPERVISOR_WORKER_ARGUMENT      _T("/marlinworker:")
+#define SUPERVISOR_STOP_EVENT           _T("Local\\MarlinWorkerStop_%u")
+
+class HTTPServerSocket;
+
+enum class WorkerState
+{
+  WS_Stopped
+ ,WS_Starting
+ ,WS_Running
+ ,WS_Draining
+};
+
+// One worker process of the supervisor
+typedef struct _workerProcess
+{
+  int         m_index       { 0 };
+  int         m_controlPort { 0 };
+  DWORD       m_pid         { 0 };
+  HANDLE      m_process     { NULL };
+  HANDLE      m_stopEvent   { NULL };             // Named event: drain and stop
+  WorkerState m_state       { WorkerState::WS_Stopped };
+  bool        m_healthy     { false };
+  int         m_restarts    { 0 };
+}
+WorkerProcess;
+
+using WorkerProcesses = std::vector<WorkerProcess*>;
+using SharedListeners = std::map<int,PollSocket>;
+
+class ServerSupervisor
+{
+public:
+  explicit ServerSupervisor(XString p_name);
+ ~ServerSupervisor();
+
+  // Read the "Supervisor" section
+  void    ReadConfig(MarlinConfig& p_config);
+  // Open the shared ports and start all workers
+  bool    Start();
+  // Replace all workers one-by-one without dropping connections
+  bool    RollingRestart();
+  // Drain and stop all workers
+  void    Stop();
+  // Health of all workers as a JSON object
+  XString GetHealth();
+  // Metrics of all workers, labeled with the worker number (Prometheus text format)
+  XString GetMetrics();
+  // Monitoring thread: restarts crashed workers, checks the health
+  void    RunMonitor();
+
+  // SETTERS
+  void    SetWorkers(int p_workers);
+  void    AddPort(int p_port)                 { m_ports.push_back(p_port);      }
+  void    SetControlPort(int p_port)          { m_controlPort    = p_port;      }
+  void    SetProgram(XString p_program)       { m_program        = p_program;   }
+  void    SetArguments(XString p_arguments)   { m_arguments      = p_arguments; }
+  void    SetStartTimeout(int p_timeout)      { m_startTimeout   = p_timeout;   }
+  void    SetStopTimeout(int p_timeout)       { m_stopTimeout    = p_timeout;   }
+  void    SetHealthInterval(int p_interval)   { m_healthInterval = p_interval;  }
+
+  // GETTERS
+  int     GetWorkers()                        { return m_workers;               }
+  int     GetHealthyWorkers();
+  bool    GetIsRunning()                      { return m_running;               }
+
+private:
+  bool    OpenListeners();
+  void    CloseListeners();
+  bool    StartWorker(WorkerProcess* p_worker);
+  bool    PassListeners(WorkerProcess* p_worker,HANDLE p_pipe);
+  bool    WaitHealthy(WorkerProcess* p_worker);
+  void    StopWorker(WorkerProcess* p_worker);
+  void    CloseWorker(WorkerProcess* p_worker);
+  bool    CheckHealth(WorkerProcess* p_worker);
+  bool    GetControl(int p_controlPort,LPCTSTR p_resource,XString& p_body);
+
+  XString           m_name;
+  XString           m_program;
+  XString           m_arguments;
+  std::vector<int>  m_ports;
+  SharedListeners   m_listeners;
+  WorkerProcesses   m_processes;
+  int               m_workers        { 0 };
+  int               m_controlPort    { SUPERVISOR_DEFAULT_CONTROLPORT  };
+  int               m_startTimeout   { SUPERVISOR_DEFAULT_STARTTIMEOUT };
+  int               m_stopTimeout    { SUPERVISOR_DEFAULT_STOPTIMEOUT  };
+  int               m_healthInterval { SUPERVISOR_DEFAULT_INTERVAL     };
+  bool              m_running        { false };
+  HANDLE            m_monitor        { NULL };    // Monitoring thread
+  HANDLE            m_wakeup         { NULL };    // Stops the monitor
+  CRITICAL_SECTION  m_lock;                       // Locking the workers
+  CRITICAL_SECTION  m_manage;                     // Starting, replacing and stopping workers
+};
+
+// The worker side of the supervisor
+class ServerWorker
+{
+public:
+  ServerWorker();
+ ~ServerWorker();
+
+  // Started by a ServerSupervisor?
+  static bool IsWorker();
+  // Take over the shared ports and create the control site
+  bool    Initialise(HTTPServerSocket* p_server);
+  // Wait for the supervisor to stop us, then drain the connections
+  bool    WaitForStop(DWORD p_timeout = INFINITE);
+
+  // GETTERS
+  int     GetIndex()        { return m_index;       }
+  int     GetControlPort()  { return m_controlPort; }
+
+private:
+  bool    ParseArguments(HANDLE& p_pipe);
+  bool    AdoptListeners(HANDLE p_pipe);
+
+  HTTPServerSocket* m_server      { nullptr };
+  int               m_index       { 0 };
+  int               m_controlPort { 0 };
+  int               m_drainTime   { SUPERVISOR_DEFAULT_STOPTIMEOUT };
+  HANDLE            m_stopEvent   { NULL };
+  HANDLE            m_supervisor  { NULL };     // Supervisor process
+};
@@ -0,0 +1,120 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: SharedEvent.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "SharedEvent.h"
+#include "HTTPServer.h"
+#include "ServerEvent.h"
+#include "ConvertWideString.h"
+#include "Base64.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// CTOR: Encode the event once for all streams and sockets
+SharedEvent::SharedEvent(HTTPServer* p_server
+                        ,EvtType     p_type
+                        ,XString     p_typeName
+                        ,XString     p_payload)
+            :m_type(p_type)
+            ,m_typeName(p_typeName)
+            ,m_payload(p_payload)
+{
+  EncodeSSEFrame(p_server);
+  EncodeSocketFrame();
+}
+
+// DTOR: Only called when the last reference was dropped
+SharedEvent::~SharedEvent()
+{
+  delete[] m_sseFrame;
+  delete[] m_sockFrame;
+}
+
+void
+SharedEvent::AddReference()
+{
+  InterlockedIncrement(&m_references);
+}
+
+void
+SharedEvent::DropReference()
+{
+  if(InterlockedDecrement(&m_references) <= 0)
+  {
+    delete this;
+  }
+}
+
+// Same formatting as ServerEventChannel::SendEventToStreams
+// but without an event id, as that differs per stream
+void
+SharedEvent::EncodeSSEFrame(HTTPServer* p_server)
+{
+  if(p_server == nullptr)
+  {
+    return;
+  }
+  ServerEvent event(LTEvent::EventTypeToString(m_type));
+  if(m_type == EvtType::EV_Binary)
+  {
+    Base64 base;
+    event.m_data = base.Encrypt(m_payload);
+  }
+  else
+  {
+    event.m_data = m_payload;
+    if(m_type == EvtType::EV_Message && !m_typeName.IsEmpty())
+    {
+      event.m_event = m_typeName;
+    }
+  }
+  p_server->EventToStringBuffer(&event,&m_sseFrame,m_sseLength);
+}
+
+// WebSockets get the plain payload as an UTF-8 text frame
+void
+SharedEvent::EncodeSocketFrame()
+{
+#ifdef _UNICODE
+  AutoCSTR string(m_payload);
+  m_sockLength = (DWORD) string.size();
+  m_sockFrame  = new BYTE[(size_t)m_sockLength + 1];
+  memcpy_s(m_sockFrame,(size_t)m_sockLength + 1,string.cstr(),m_sockLength);
+#else
+  XString encoded = EncodeStringForTheWire(m_payload);
+  m_sockLength = (DWORD) encoded.GetLength();
+  m_sockFrame  = new BYTE[(size_t)m_sockLength + 1];
+  memcpy_s(m_sockFrame,(size_t)m_sockLength + 1,encoded.GetString(),m_sockLength);
+#endif
+  m_sockFrame[m_sockLength] = 0;
+}
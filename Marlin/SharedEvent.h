@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: SharedEvent.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "LongTermEvent.h"
+
+class HTTPServer;
+
+// A broadcast event that is encoded only once and then shared
+// between all the channels (and all the SSE streams and WebSockets)
+// it is posted to. The object is immutable after construction and
+// reference counted: every LTEvent in a channel queue holds one
+// reference, the poster holds the initial one.
+//
+// The SSE frame carries no 'id:' line, as the id of an event
+// is different in each and every stream.
+//
+class SharedEvent
+{
+public:
+  SharedEvent(HTTPServer* p_server,EvtType p_type,XString p_typeName,XString p_payload);
+
+  // Reference counting
+  void    AddReference();
+  void    DropReference();
+
+  // GETTERS
+  EvtType     GetType()         const { return m_type;      }
+  XString     GetTypeName()     const { return m_typeName;  }
+  const XString& GetPayload()   const { return m_payload;   }
+  // Pre-encoded SSE frame (UTF-8)
+  const BYTE* GetSSEFrame()     const { return m_sseFrame;  }
+  int         GetSSELength()    const { return m_sseLength; }
+  // Pre-encoded WebSocket payload (UTF-8)
+  const BYTE* GetSocketFrame()  const { return m_sockFrame; }
+  DWORD       GetSocketLength() const { return m_sockLength;}
+
+private:
+  // Only through DropReference
+ ~SharedEvent();
+
+  void    EncodeSSEFrame(HTTPServer* p_server);
+  void    EncodeSocketFrame();
+
+  // DATA
+  EvtType m_type;
+  XString m_typeName;
+  XString m_payload;
+  BYTE*   m_sseFrame   { nullptr };   // SSE "event:/data:" frame
+  int     m_sseLength  { 0       };   // Length of the SSE frame
+  BYTE*   m_sockFrame  { nullptr };   // UTF-8 payload for WebSockets
+  DWORD   m_sockLength { 0       };   // Length of the WebSocket payload
+  long    m_references { 1       };   // Creator holds the first reference
+};
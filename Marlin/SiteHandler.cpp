@@ -124,6 +124,13 @@ SiteHandler::PostHandle(HTTPMessage* p_message)
   }
 }
 
+// Default: the body is received completely in the FileBuffer of the message
+BodySink*
+SiteHandler::GetBodySink(HTTPMessage* /*p_message*/)
+{
+  return nullptr;
+}
+
 void
 SiteHandler::CleanUp(HTTPMessage* p_message)
 {
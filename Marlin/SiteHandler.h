@@ -53,6 +53,10 @@ public:
   // When starting the site
   virtual void OnStartSite();
 
+  // Opt in to receive the body of large messages while it is being read
+  // Return a new sink (owned by the message) or nullptr for a complete body
+  virtual BodySink* GetBodySink(HTTPMessage* p_message);
+
   // Go handle this message
   virtual void HandleMessage(HTTPMessage* p_message);
   virtual bool HandleStream (HTTPMessage* p_message,EventStream* p_stream);
@@ -27,6 +27,7 @@
 //
 #include "stdafx.h"
 #include "SiteHandlerFormData.h"
+#include "MultiPartStream.h"
 #include "HTTPMessage.h"
 #include "HTTPSite.h"
 #include "HTTPServer.h"
@@ -40,6 +41,24 @@ static char THIS_FILE[] = __FILE__;
 #endif
 #endif
 
+void
+SiteHandlerFormData::SetStreaming(bool p_streaming,XString p_directory /*= ""*/)
+{
+  m_streaming = p_streaming;
+  m_directory = p_directory;
+}
+
+// Only a real multipart/form-data body can be parsed while receiving it
+BodySink*
+SiteHandlerFormData::GetBodySink(HTTPMessage* p_message)
+{
+  if(m_streaming && p_message->GetContentType().Find(_T("multipart/form-data")) >= 0)
+  {
+    return new MultiPartStream(p_message->GetContentType(),m_directory);
+  }
+  return nullptr;
+}
+
 bool
 SiteHandlerFormData::Handle(HTTPMessage* p_message)
 {
@@ -48,44 +67,26 @@ SiteHandlerFormData::Handle(HTTPMessage* p_message)
 
   XString contentType = p_message->GetContentType();
   FileBuffer* buffer  = p_message->GetFileBuffer();
-  MultiPartBuffer multi(FormDataType::FD_UNKNOWN);
+  MultiPartBuffer  multi(FormDataType::FD_UNKNOWN);
+  MultiPartBuffer* parts = nullptr;
 
-  if(buffer && !contentType.IsEmpty())
+  // Body already parsed while it was being received?
+  // Take the stream over: resetting the message for the answer would destroy it
+  MultiPartStream* stream = dynamic_cast<MultiPartStream*>(p_message->GetBodySink());
+  if(stream)
+  {
+    p_message->DetachBodySink();
+    parts = stream->GetMultiPartBuffer();
+    SITE_DETAILLOGV(_T("Form-data received as stream. Bytes: %I64u Peak memory: %I64u")
+                   ,(unsigned __int64)stream->GetBytesReceived()
+                   ,(unsigned __int64)stream->GetPeakMemory());
+  }
+  else if(buffer && !contentType.IsEmpty())
   {
     // Getting all parts from the HTTPMessage
     if(multi.ParseBuffer(contentType,buffer))
     {
-      // Clear the message for an answer
-      p_message->Reset();
-      p_message->SetStatus(HTTP_STATUS_OK);
-
-      // Do Pre-handling first
-      PreHandleBuffer(p_message,&multi);
-
-      // Cycle through all the parts
-      size_t parts = multi.GetParts();
-      for(size_t ind = 0; ind < parts; ++ind)
-      {
-        MultiPart* part = multi.GetPart((int)ind);
-        if(part)
-        {
-          if(part->GetShortFileName().IsEmpty())
-          {
-            errors += HandleData(p_message,part);
-          }
-          else
-          {
-            errors += HandleFile(p_message,part);
-          }
-        }
-        else
-        {
-          ++errors;
-          SITE_ERRORLOG(ERROR_NO_DATA,_T("Internal error in form-data MultiPartBuffer"));
-        }
-      }
-      // Now ready with all the parts. Do the post-handling
-      PostHandleBuffer(p_message,&multi);
+      parts = &multi;
     }
     else
     {
@@ -99,6 +100,43 @@ SiteHandlerFormData::Handle(HTTPMessage* p_message)
     SITE_ERRORLOG(ERROR_NO_DATA,_T("NO legal multi-part buffer, or no multi-part content-type"));
   }
 
+  if(parts)
+  {
+    // Clear the message for an answer
+    p_message->Reset();
+    p_message->SetStatus(HTTP_STATUS_OK);
+
+    // Do Pre-handling first
+    PreHandleBuffer(p_message,parts);
+
+    // Cycle through all the parts
+    size_t number = parts->GetParts();
+    for(size_t ind = 0; ind < number; ++ind)
+    {
+      MultiPart* part = parts->GetPart((int)ind);
+      if(part)
+      {
+        if(part->GetShortFileName().IsEmpty())
+        {
+          errors += HandleData(p_message,part);
+        }
+        else
+        {
+          errors += HandleFile(p_message,part);
+        }
+      }
+      else
+      {
+        ++errors;
+        SITE_ERRORLOG(ERROR_NO_DATA,_T("Internal error in form-data MultiPartBuffer"));
+      }
+    }
+    // Now ready with all the parts. Do the post-handling
+    PostHandleBuffer(p_message,parts);
+  }
+  // Done with the streamed parts
+  delete stream;
+
   if(errors)
   {
     // Setting HTTP status "409 Resource Conflict"
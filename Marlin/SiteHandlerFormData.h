@@ -32,6 +32,17 @@
 
 class SiteHandlerFormData: public SiteHandlerPost
 {
+public:
+  // Parse large uploads while they are being received.
+  // File parts are written to temporary files in the directory (default: TEMP)
+  // The FileBuffer of these parts then refers to the file by its filename.
+  // Move the file in HandleFile to keep it: it is removed afterwards.
+  void SetStreaming(bool p_streaming,XString p_directory = _T(""));
+  bool GetStreaming()                               { return m_streaming; }
+
+  // Opt in to receive the body while it is being read
+  virtual BodySink* GetBodySink(HTTPMessage* p_message) override;
+
 protected:
   // Handlers: Override and return 'true' if handling is ready
   virtual bool Handle(HTTPMessage* p_message) override;
@@ -46,4 +57,7 @@ protected:
   virtual int HandleData      (HTTPMessage* p_message,MultiPart*       p_part);
   virtual int HandleFile      (HTTPMessage* p_message,MultiPart*       p_part);
   virtual int PostHandleBuffer(HTTPMessage* p_message,MultiPartBuffer* p_buffer);
+
+  bool    m_streaming { false };  // Parse the body while receiving it
+  XString m_directory;            // Directory for the file parts
 };
@@ -29,6 +29,8 @@
 #include "SiteHandlerGet.h"
 #include "HTTPMessage.h"
 #include "HTTPSite.h"
+#include "HTTPTime.h"
+#include "StaticContentCache.h"
 #include <WinFile.h>
 #include <winhttp.h>
 #include <io.h>
@@ -83,8 +85,11 @@ SiteHandlerGet::Handle(HTTPMessage* p_message)
     // Check for read access
     if(_taccess(pathname,4) == 0 || FileNameRestrictions(pathname))
     {
-      p_message->GetFileBuffer()->SetFileName(pathname);
-      p_message->SetStatus(HTTP_STATUS_OK);
+      if(!HandleStaticCache(p_message,pathname))
+      {
+        p_message->GetFileBuffer()->SetFileName(pathname);
+        p_message->SetStatus(HTTP_STATUS_OK);
+      }
       SITE_DETAILLOGS(_T("HTTP GET: "),pathname);
     }
     else 
@@ -104,6 +109,70 @@ SiteHandlerGet::Handle(HTTPMessage* p_message)
   return true;
 }
 
+// Answer from the static content cache of the site (if any)
+// Handles the conditional GET (304) and the precompressed gzip variant
+// The cached content is sent from the shared buffer without copying
+bool
+SiteHandlerGet::HandleStaticCache(HTTPMessage* p_message,const XString& p_pathname)
+{
+  StaticContentCache* cache = m_site->GetStaticContentCache();
+  if(cache == nullptr)
+  {
+    return false;
+  }
+  StaticEntry entry = cache->Lookup(p_pathname);
+  if(!entry)
+  {
+    return false;
+  }
+
+  // Take the conditional headers from the request
+  // If-None-Match has precedence over If-Modified-Since (RFC 7232)
+  bool    notModified = false;
+  XString noneMatch   = p_message->GetHeader(_T("If-None-Match"));
+  XString modified    = p_message->GetHeader(_T("If-Modified-Since"));
+  if(!noneMatch.IsEmpty())
+  {
+    notModified = entry->GetMatchesETag(noneMatch);
+  }
+  else if(!modified.IsEmpty())
+  {
+    SYSTEMTIME since;
+    if(HTTPTimeToSystemTime(modified,&since))
+    {
+      notModified = entry->GetIsNotModifiedSince(&since);
+    }
+  }
+  bool gzip = entry->m_gzip && m_site->GetHTTPCompression() &&
+              p_message->GetAcceptEncoding().Find(_T("gzip")) >= 0;
+
+  if(notModified)
+  {
+    p_message->Reset();
+    p_message->GetFileBuffer()->Reset();
+    p_message->SetStatus(HTTP_STATUS_NOT_MODIFIED);
+    SITE_DETAILLOGS(_T("HTTP GET not modified: "),p_pathname);
+  }
+  else
+  {
+    p_message->DelHeader(_T("If-None-Match"));
+    p_message->DelHeader(_T("If-Modified-Since"));
+    p_message->GetFileBuffer()->SetSharedBuffer(gzip ? entry->m_gzip : entry->m_identity);
+    p_message->SetStatus(HTTP_STATUS_OK);
+    if(gzip)
+    {
+      p_message->AddHeader(_T("Content-Encoding"),_T("gzip"));
+    }
+  }
+  p_message->AddHeader(_T("ETag"),entry->GetETag(gzip));
+  p_message->AddHeader(_T("Last-Modified"),entry->m_lastModified);
+  if(entry->m_gzip)
+  {
+    p_message->AddHeader(_T("Vary"),_T("Accept-Encoding"));
+  }
+  return true;
+}
+
 void
 SiteHandlerGet::PostHandle(HTTPMessage* p_message)
 {
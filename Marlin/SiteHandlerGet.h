@@ -42,4 +42,6 @@ protected:
   // Filename handlers
   virtual bool FileNameTransformations(XString& p_filename);
   virtual bool FileNameRestrictions   (XString& p_filename);
+  // Answer from the static content cache of the site
+  bool         HandleStaticCache      (HTTPMessage* p_message,const XString& p_pathname);
 };
\ No newline at end of file
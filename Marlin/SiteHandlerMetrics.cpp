@@ -0,0 +1,54 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: SiteHandlerMetrics.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "SiteHandlerMetrics.h"
+#include "HTTPMessage.h"
+#include "HTTPSite.h"
+#include <Metrics.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+bool
+SiteHandlerMetrics::Handle(HTTPMessage* p_message)
+{
+  XString metrics = GetMetricsRegistry().ExportPrometheus();
+
+  p_message->Reset();
+  p_message->GetFileBuffer()->Reset();
+  p_message->SetCommand(HTTPCommand::http_response);
+  p_message->SetContentType(_T("text/plain; version=0.0.4; charset=utf-8"));
+  p_message->SetBody(metrics,_T("utf-8"));
+  p_message->SetStatus(HTTP_STATUS_OK);
+  return true;
+}
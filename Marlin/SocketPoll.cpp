@@ -0,0 +1,261 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: SocketPoll.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "SocketPoll.h"
+#include "AutoCritical.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+SocketPoll::SocketPoll()
+{
+  InitializeCriticalSection(&m_lock);
+  memset(&m_wakeAddress,0,sizeof(sockaddr_in));
+}
+
+SocketPoll::~SocketPoll()
+{
+  Close();
+  DeleteCriticalSection(&m_lock);
+}
+
+bool
+SocketPoll::Open()
+{
+  if(m_isOpen)
+  {
+    return true;
+  }
+  // Loopback UDP socket, sending a datagram to itself to wake up the poll
+  m_wakeup = socket(AF_INET,SOCK_DGRAM,IPPROTO_UDP);
+  if(m_wakeup == INVALID_SOCKET)
+  {
+    return false;
+  }
+  m_wakeAddress.sin_family      = AF_INET;
+  m_wakeAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  m_wakeAddress.sin_port        = 0;
+  int length = sizeof(sockaddr_in);
+  if(bind(m_wakeup,(sockaddr*)&m_wakeAddress,length) == SOCKET_ERROR ||
+     getsockname(m_wakeup,(sockaddr*)&m_wakeAddress,&length) == SOCKET_ERROR)
+  {
+    closesocket(m_wakeup);
+    m_wakeup = INVALID_SOCKET;
+    return false;
+  }
+  SetNonBlocking(m_wakeup);
+
+  AutoCritSec lock(&m_lock);
+  WSAPOLLFD wake { m_wakeup, POLLRDNORM, 0 };
+  m_fds.assign(1,wake);
+  m_contexts.assign(1,nullptr);
+  m_positions.clear();
+  m_changed = true;
+  return (m_isOpen = true);
+}
+
+void
+SocketPoll::Close()
+{
+  AutoCritSec lock(&m_lock);
+
+  if(m_wakeup != INVALID_SOCKET)
+  {
+    closesocket(m_wakeup);
+    m_wakeup = INVALID_SOCKET;
+  }
+  m_fds.clear();
+  m_contexts.clear();
+  m_positions.clear();
+  m_changed = true;
+  m_isOpen  = false;
+}
+
+// The polling set is kept as the array that WSAPoll needs.
+// Removing a socket moves the last socket into its place.
+bool
+SocketPoll::Add(PollSocket p_socket,void* p_context,unsigned p_interest)
+{
+  AutoCritSec lock(&m_lock);
+  if(!m_positions.insert(std::make_pair(p_socket,m_fds.size())).second)
+  {
+    return false;
+  }
+  WSAPOLLFD fd { p_socket, PollFlags(p_interest), 0 };
+  m_fds.push_back(fd);
+  m_contexts.push_back(p_context);
+  m_changed = true;
+  return true;
+}
+
+bool
+SocketPoll::Modify(PollSocket p_socket,void* p_context,unsigned p_interest)
+{
+  AutoCritSec lock(&m_lock);
+  PollPositions::iterator it = m_positions.find(p_socket);
+  if(it == m_positions.end())
+  {
+    return false;
+  }
+  SHORT flags = PollFlags(p_interest);
+  if(m_fds[it->second].events != flags || m_contexts[it->second] != p_context)
+  {
+    m_fds[it->second].events = flags;
+    m_contexts[it->second]   = p_context;
+    m_changed = true;
+  }
+  return true;
+}
+
+bool
+SocketPoll::Remove(PollSocket p_socket)
+{
+  AutoCritSec lock(&m_lock);
+  PollPositions::iterator it = m_positions.find(p_socket);
+  if(it == m_positions.end())
+  {
+    return false;
+  }
+  size_t position = it->second;
+  size_t last     = m_fds.size() - 1;
+  if(position != last)
+  {
+    m_fds[position]      = m_fds[last];
+    m_contexts[position] = m_contexts[last];
+    m_positions[m_fds[position].fd] = position;
+  }
+  m_fds.pop_back();
+  m_contexts.pop_back();
+  m_positions.erase(it);
+  m_changed = true;
+  return true;
+}
+
+SHORT
+SocketPoll::PollFlags(unsigned p_interest)
+{
+  SHORT flags = 0;
+  if(p_interest & POLL_READ)  flags |= POLLRDNORM;
+  if(p_interest & POLL_WRITE) flags |= POLLWRNORM;
+  return flags;
+}
+
+int
+SocketPoll::Wait(PollEvent* p_events,int p_maximum,int p_timeoutMS)
+{
+  // Registrations may change on other threads while we are waiting.
+  // So WSAPoll gets its own copy, only taken when the set has changed.
+  // The copy reuses its memory: no allocations in a steady state.
+  {
+    AutoCritSec lock(&m_lock);
+    if(m_changed)
+    {
+      m_pollFds      = m_fds;
+      m_pollContexts = m_contexts;
+      m_changed      = false;
+    }
+  }
+  std::vector<WSAPOLLFD>& fds      = m_pollFds;
+  std::vector<void*>&     contexts = m_pollContexts;
+
+  int number = WSAPoll(fds.data(),(ULONG)fds.size(),p_timeoutMS);
+  if(number == SOCKET_ERROR)
+  {
+    return -1;
+  }
+  int result = 0;
+  for(size_t index = 0;index < fds.size() && number > 0 && result < p_maximum;++index)
+  {
+    if(fds[index].revents == 0)
+    {
+      continue;
+    }
+    --number;
+    if(contexts[index] == nullptr)
+    {
+      DrainWakeUp();
+      continue;
+    }
+    PollEvent& event = p_events[result++];
+    event.m_socket  = fds[index].fd;
+    event.m_context = contexts[index];
+    event.m_events  = 0;
+    if(fds[index].revents & POLLRDNORM) event.m_events |= POLL_READ;
+    if(fds[index].revents & POLLWRNORM) event.m_events |= POLL_WRITE;
+    if(fds[index].revents & (POLLHUP | POLLERR | POLLNVAL))
+    {
+      event.m_events |= POLL_CLOSED;
+    }
+  }
+  return result;
+}
+
+void
+SocketPoll::WakeUp()
+{
+  char one = 1;
+  sendto(m_wakeup,&one,1,0,(sockaddr*)&m_wakeAddress,sizeof(sockaddr_in));
+}
+
+void
+SocketPoll::DrainWakeUp()
+{
+  char buffer[64];
+  while(recv(m_wakeup,buffer,sizeof(buffer),0) > 0);
+}
+
+bool
+SocketPoll::SetNonBlocking(PollSocket p_socket)
+{
+  u_long on = 1;
+  return ioctlsocket(p_socket,FIONBIO,&on) == 0;
+}
+
+bool
+SocketPoll::SetNoDelay(PollSocket p_socket)
+{
+  BOOL on = TRUE;
+  return setsockopt(p_socket,IPPROTO_TCP,TCP_NODELAY,(const char*)&on,sizeof(BOOL)) == 0;
+}
+
+void
+SocketPoll::CloseSocket(PollSocket p_socket)
+{
+  closesocket(p_socket);
+}
+
+bool
+SocketPoll::WouldBlock()
+{
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+}
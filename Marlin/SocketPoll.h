@@ -0,0 +1,109 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: SocketPoll.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include <vector>
+#include <map>
+
+// Readiness notification for non-blocking sockets
+// A level-triggered layer over 'WSAPoll', where the write interest is
+// only registered while there is pending output.
+// The HTTPServerSocket will use this to multiplex all its connections
+// on a single polling thread.
+// Marlin is a MS-Windows library (MFC/Win32), so there is no epoll variant.
+
+using PollSocket = SOCKET;
+#define POLL_INVALID_SOCKET  INVALID_SOCKET
+
+// Readiness bits for a socket
+#define POLL_READ     0x01    // Data (or an incoming connection) to be read
+#define POLL_WRITE    0x02    // Room in the socket send buffer
+#define POLL_CLOSED   0x04    // Peer has closed or the socket is in error
+
+// Maximum number of events handled by one 'Wait'
+#define POLL_MAX_EVENTS  256
+
+typedef struct _pollEvent
+{
+  PollSocket m_socket;        // Socket that is ready
+  void*      m_context;       // Context as registered with 'Add'
+  unsigned   m_events;        // Bitwise POLL_READ/POLL_WRITE/POLL_CLOSED
+}
+PollEvent;
+
+// Position of a registered socket in the polling set
+using PollPositions = std::map<PollSocket,size_t>;
+
+class SocketPoll
+{
+public:
+  SocketPoll();
+ ~SocketPoll();
+
+  // Create the polling set and its wake-up channel
+  bool Open();
+  // Close the polling set
+  void Close();
+  // Add a socket with its context and interest
+  bool Add   (PollSocket p_socket,void* p_context,unsigned p_interest);
+  // Change the interest of a socket
+  bool Modify(PollSocket p_socket,void* p_context,unsigned p_interest);
+  // Remove a socket from the polling set
+  bool Remove(PollSocket p_socket);
+  // Wait for readiness. Returns the number of events, or -1 on error
+  int  Wait(PollEvent* p_events,int p_maximum,int p_timeoutMS);
+  // Wake the thread that is waiting in 'Wait'
+  void WakeUp();
+
+  // GETTERS
+  bool GetIsOpen()        { return m_isOpen; }
+
+  // Make a socket non-blocking
+  static bool SetNonBlocking(PollSocket p_socket);
+  // Disable the Nagle algorithm on a connection
+  static bool SetNoDelay(PollSocket p_socket);
+  // Close a socket handle
+  static void CloseSocket(PollSocket p_socket);
+  // Last socket operation would block
+  static bool WouldBlock();
+
+private:
+  void DrainWakeUp();
+
+  static SHORT PollFlags(unsigned p_interest);
+
+  bool                   m_isOpen  { false };
+  CRITICAL_SECTION       m_lock;                      // Locking the registrations
+  std::vector<WSAPOLLFD> m_fds;                       // All sockets in the set. [0] is the wake-up socket
+  std::vector<void*>     m_contexts;                  // Context of each socket in m_fds
+  PollPositions          m_positions;                 // Socket to position in m_fds
+  bool                   m_changed { false };         // m_fds changed since the last 'Wait'
+  std::vector<WSAPOLLFD> m_pollFds;                   // Copy of m_fds for WSAPoll (polling thread)
+  std::vector<void*>     m_pollContexts;
+  SOCKET                 m_wakeup  { INVALID_SOCKET }; // Loopback UDP self-socket
+  sockaddr_in            m_wakeAddress;               // Address of the self-socket
+};
@@ -0,0 +1,395 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: StaticContentCache.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "StaticContentCache.h"
+#include "AutoCritical.h"
+#include "HTTPTime.h"
+#include <ZIP\gzip.h>
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//
+// StaticContent: one cached file
+//
+//////////////////////////////////////////////////////////////////////////
+
+size_t
+StaticContent::GetMemorySize() const
+{
+  size_t size = sizeof(StaticContent);
+  if(m_identity)
+  {
+    size += m_identity->size();
+  }
+  if(m_gzip)
+  {
+    size += m_gzip->size();
+  }
+  return size;
+}
+
+// Entity tag of one of the variants.
+// Strong entity tags must differ for each content-encoding
+XString
+StaticContent::GetETag(bool p_gzip) const
+{
+  if(p_gzip)
+  {
+    return m_etag.Left(m_etag.GetLength() - 1) + _T("-gz\"");
+  }
+  return m_etag;
+}
+
+// HTTP times only have a resolution of whole seconds
+bool
+StaticContent::GetIsNotModifiedSince(const SYSTEMTIME* p_since) const
+{
+  FILETIME since;
+  if(!SystemTimeToFileTime(p_since,&since))
+  {
+    return false;
+  }
+  ULARGE_INTEGER sinceTime;
+  ULARGE_INTEGER writeTime;
+  sinceTime.LowPart  = since.dwLowDateTime;
+  sinceTime.HighPart = since.dwHighDateTime;
+  writeTime.LowPart  = m_lastWrite.dwLowDateTime;
+  writeTime.HighPart = m_lastWrite.dwHighDateTime;
+
+  return (writeTime.QuadPart / 10000000) <= (sinceTime.QuadPart / 10000000);
+}
+
+// If-None-Match uses the weak comparison function (RFC 7232)
+// So a "W/" prefix on the tags of the client is ignored
+bool
+StaticContent::GetMatchesETag(const XString& p_ifNoneMatch) const
+{
+  XString gzipTag = GetETag(true);
+  int pos = 0;
+  XString tag = p_ifNoneMatch.Tokenize(_T(","),pos);
+  while(!tag.IsEmpty())
+  {
+    tag.Trim();
+    if(tag == _T("*"))
+    {
+      return true;
+    }
+    if(tag.Left(2).CompareNoCase(_T("W/")) == 0)
+    {
+      tag = tag.Mid(2);
+    }
+    if(tag == m_etag || tag == gzipTag)
+    {
+      return true;
+    }
+    tag = p_ifNoneMatch.Tokenize(_T(","),pos);
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// StaticContentCache
+//
+//////////////////////////////////////////////////////////////////////////
+
+StaticContentCache::StaticContentCache(XString p_webroot
+                                      ,size_t  p_maxBytes /*= STATICCACHE_MAXBYTES*/
+                                      ,bool    p_compress /*= true*/)
+                   :m_webroot(p_webroot)
+                   ,m_maxBytes(p_maxBytes)
+                   ,m_compress(p_compress)
+{
+  InitializeCriticalSection(&m_lock);
+
+  // Getting notified of all changes in the webroot
+  // If this fails (e.g. for some network shares) we rely on polling alone
+  if(!m_webroot.IsEmpty())
+  {
+    m_notify = FindFirstChangeNotification(m_webroot
+                                          ,TRUE
+                                          ,FILE_NOTIFY_CHANGE_FILE_NAME  |
+                                           FILE_NOTIFY_CHANGE_DIR_NAME   |
+                                           FILE_NOTIFY_CHANGE_SIZE       |
+                                           FILE_NOTIFY_CHANGE_LAST_WRITE);
+  }
+}
+
+StaticContentCache::~StaticContentCache()
+{
+  Flush();
+  if(m_notify != INVALID_HANDLE_VALUE)
+  {
+    FindCloseChangeNotification(m_notify);
+    m_notify = INVALID_HANDLE_VALUE;
+  }
+  DeleteCriticalSection(&m_lock);
+}
+
+// Find (or read in) the content of a file
+// Returns a nullptr if the file does not exist or is not cacheable
+// The caller then falls back to the normal file sending path
+StaticEntry
+StaticContentCache::Lookup(const XString& p_pathname)
+{
+  // MS-Windows filesystems are case-insensitive
+  XString key(p_pathname);
+  key.MakeLower();
+
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  ULONGLONG now = GetTickCount64();
+  {
+    AutoCritSec lock(&m_lock);
+    CheckNotification();
+
+    StaticMap::iterator it = m_cache.find(key);
+    if(it != m_cache.end())
+    {
+      StaticSlot& slot = it->second;
+      if(slot.m_checked && (now - slot.m_checked) < m_interval)
+      {
+        m_lru.splice(m_lru.begin(),m_lru,slot.m_lru);
+        ++m_hits;
+        return slot.m_entry;
+      }
+      // Time to see if the file is still the same
+      if(GetFileAttributesEx(p_pathname,GetFileExInfoStandard,&data))
+      {
+        const StaticContent* content = slot.m_entry.get();
+        ULONGLONG size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        if(CompareFileTime(&data.ftLastWriteTime,&content->m_lastWrite) == 0 && size == content->m_fileSize)
+        {
+          slot.m_checked = now;
+          m_lru.splice(m_lru.begin(),m_lru,slot.m_lru);
+          ++m_hits;
+          return slot.m_entry;
+        }
+      }
+      // Changed or removed: read it again
+      Remove(it);
+    }
+  }
+
+  // Cache miss. Read the file outside the lock
+  if(!GetFileAttributesEx(p_pathname,GetFileExInfoStandard,&data))
+  {
+    return nullptr;
+  }
+  if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+  {
+    return nullptr;
+  }
+  ULONGLONG size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+  if(size > m_maxFile || size > m_maxBytes)
+  {
+    return nullptr;
+  }
+  StaticEntry entry = ReadContent(p_pathname,data);
+  if(!entry)
+  {
+    return nullptr;
+  }
+
+  AutoCritSec lock(&m_lock);
+  ++m_misses;
+
+  // Another thread might have read the same file in the mean time
+  StaticMap::iterator it = m_cache.find(key);
+  if(it != m_cache.end())
+  {
+    Remove(it);
+  }
+  size_t needed = entry->GetMemorySize();
+  Evict(needed);
+
+  m_lru.push_front(key);
+  StaticSlot slot;
+  slot.m_entry   = entry;
+  slot.m_lru     = m_lru.begin();
+  slot.m_checked = now;
+  m_cache[key]   = slot;
+  m_bytes       += needed;
+
+  return entry;
+}
+
+// Remove one file from the cache
+void
+StaticContentCache::Invalidate(const XString& p_pathname)
+{
+  XString key(p_pathname);
+  key.MakeLower();
+
+  AutoCritSec lock(&m_lock);
+  StaticMap::iterator it = m_cache.find(key);
+  if(it != m_cache.end())
+  {
+    Remove(it);
+  }
+}
+
+// Remove all files from the cache
+// Entries still being sent are kept alive by their shared pointers
+void
+StaticContentCache::Flush()
+{
+  AutoCritSec lock(&m_lock);
+  m_cache.clear();
+  m_lru.clear();
+  m_bytes = 0;
+}
+
+size_t
+StaticContentCache::GetCurrentBytes()
+{
+  AutoCritSec lock(&m_lock);
+  return m_bytes;
+}
+
+size_t
+StaticContentCache::GetEntries()
+{
+  AutoCritSec lock(&m_lock);
+  return m_cache.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PRIVATE
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Read a file and calculate all variants
+StaticEntry
+StaticContentCache::ReadContent(const XString& p_pathname,const WIN32_FILE_ATTRIBUTE_DATA& p_data)
+{
+  HANDLE file = CreateFile(p_pathname
+                          ,GENERIC_READ
+                          ,FILE_SHARE_READ | FILE_SHARE_WRITE
+                          ,NULL
+                          ,OPEN_EXISTING
+                          ,FILE_FLAG_SEQUENTIAL_SCAN
+                          ,NULL);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    return nullptr;
+  }
+  size_t size = (size_t)(((ULONGLONG)p_data.nFileSizeHigh << 32) | p_data.nFileSizeLow);
+  std::vector<uchar> identity(size);
+  DWORD readBytes = 0;
+  bool  result    = (size == 0) || (::ReadFile(file,identity.data(),(DWORD)size,&readBytes,NULL) && readBytes == (DWORD)size);
+  CloseHandle(file);
+  if(!result)
+  {
+    return nullptr;
+  }
+
+  std::shared_ptr<StaticContent> content = std::make_shared<StaticContent>();
+  content->m_pathname  = p_pathname;
+  content->m_lastWrite = p_data.ftLastWriteTime;
+  content->m_fileSize  = size;
+
+  // Strong entity tag: the size and a FNV-1a hash of the contents
+  ULONGLONG hash = 14695981039346656037ULL;
+  for(size_t ind = 0; ind < size; ++ind)
+  {
+    hash ^= identity[ind];
+    hash *= 1099511628211ULL;
+  }
+  content->m_etag.Format(_T("\"%I64x-%016I64x\""),(ULONGLONG)size,hash);
+
+  // Last modified as a HTTP date
+  SYSTEMTIME lastWrite;
+  FileTimeToSystemTime(&p_data.ftLastWriteTime,&lastWrite);
+  HTTPTimeFromSystemTime(&lastWrite,content->m_lastModified);
+
+  // Compress only once. Keep it only if it gains something
+  if(m_compress && size >= STATICCACHE_MINZIP)
+  {
+    std::vector<uint8_t> zipped;
+    if(gzip_compress_memory(identity.data(),size,zipped) && zipped.size() < (size / 10) * 9)
+    {
+      content->m_gzip = std::make_shared<const std::vector<uchar>>(std::move(zipped));
+    }
+  }
+  content->m_identity = std::make_shared<const std::vector<uchar>>(std::move(identity));
+  return content;
+}
+
+// See if the webroot has changed since the last lookup
+// All entries will then check their file time on the next lookup
+// Lock must be held by the caller
+void
+StaticContentCache::CheckNotification()
+{
+  if(m_notify == INVALID_HANDLE_VALUE)
+  {
+    return;
+  }
+  if(WaitForSingleObject(m_notify,0) == WAIT_OBJECT_0)
+  {
+    for(auto& slot : m_cache)
+    {
+      slot.second.m_checked = 0;
+    }
+    FindNextChangeNotification(m_notify);
+  }
+}
+
+// Remove least recently used entries until the new size fits
+// Lock must be held by the caller
+void
+StaticContentCache::Evict(size_t p_needed)
+{
+  while(!m_lru.empty() && (m_bytes + p_needed) > m_maxBytes)
+  {
+    StaticMap::iterator it = m_cache.find(m_lru.back());
+    if(it == m_cache.end())
+    {
+      m_lru.pop_back();
+      continue;
+    }
+    Remove(it);
+  }
+}
+
+// Remove one slot. Lock must be held by the caller
+void
+StaticContentCache::Remove(StaticMap::iterator p_slot)
+{
+  m_bytes -= p_slot->second.m_entry->GetMemorySize();
+  m_lru.erase(p_slot->second.m_lru);
+  m_cache.erase(p_slot);
+}
@@ -0,0 +1,132 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: StaticContentCache.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+#include "FileBuffer.h"
+#include <map>
+#include <list>
+#include <memory>
+
+// Default limits of the static content cache
+constexpr size_t   STATICCACHE_MAXBYTES  = (64 * 1024 * 1024);  // Total cache size 64 MB
+constexpr size_t   STATICCACHE_MAXFILE   = ( 4 * 1024 * 1024);  // Files above 4 MB are not cached
+constexpr size_t   STATICCACHE_MINZIP    = 1024;                // Do not gzip under 1 KB
+constexpr DWORD    STATICCACHE_INTERVAL  = 2000;                // Check file time every 2 seconds
+
+// One cached static file with all its variants
+// Entries are immutable once created. A changed file gets a new entry
+class StaticContent
+{
+public:
+  XString       m_pathname;                 // Full pathname of the file
+  XString       m_etag;                     // Strong entity tag, including the quotes
+  XString       m_lastModified;             // Last-Modified as a HTTP date
+  FILETIME      m_lastWrite     { 0,0 };    // Last write time of the file
+  ULONGLONG     m_fileSize      { 0 };      // Size of the file on disk
+  SharedBuffer  m_identity;                 // Contents as-is
+  SharedBuffer  m_gzip;                     // gzip variant, only if smaller than identity
+
+  // Total memory used by this entry
+  size_t  GetMemorySize() const;
+  // Entity tag of the identity or the gzip variant
+  XString GetETag(bool p_gzip) const;
+  // True if a (not-)modified since time is satisfied by this file
+  bool    GetIsNotModifiedSince(const SYSTEMTIME* p_since) const;
+  // True if the entity tag matches one of the If-None-Match tags
+  bool    GetMatchesETag(const XString& p_ifNoneMatch) const;
+};
+
+using StaticEntry = std::shared_ptr<const StaticContent>;
+using StaticLRU   = std::list<XString>;
+
+typedef struct _staticSlot
+{
+  StaticEntry         m_entry;
+  StaticLRU::iterator m_lru;
+  ULONGLONG           m_checked { 0 };  // Tick count of last file time check
+}
+StaticSlot;
+
+using StaticMap = std::map<XString,StaticSlot>;
+
+// In-memory cache of static content of a HTTPSite
+// - Size bounded, least-recently-used entries are evicted first
+// - Changes on disk are detected by a change notification on the webroot
+//   and by polling the last-write time of the file (as a fallback)
+// - The gzip variant is computed only once, when the file is read
+class StaticContentCache
+{
+public:
+  explicit StaticContentCache(XString p_webroot
+                             ,size_t  p_maxBytes = STATICCACHE_MAXBYTES
+                             ,bool    p_compress = true);
+ ~StaticContentCache();
+
+  // Find (or read in) the content of a file. nullptr if not cacheable
+  StaticEntry Lookup(const XString& p_pathname);
+  // Remove one file from the cache
+  void        Invalidate(const XString& p_pathname);
+  // Remove all files from the cache
+  void        Flush();
+
+  // SETTERS
+  void        SetMaximumBytes(size_t p_bytes)     { m_maxBytes = p_bytes;    }
+  void        SetMaximumFile(size_t p_bytes)      { m_maxFile  = p_bytes;    }
+  void        SetCheckInterval(DWORD p_interval)  { m_interval = p_interval; }
+
+  // GETTERS
+  size_t      GetMaximumBytes() const             { return m_maxBytes; }
+  size_t      GetMaximumFile()  const             { return m_maxFile;  }
+  DWORD       GetCheckInterval() const            { return m_interval; }
+  size_t      GetCurrentBytes();
+  size_t      GetEntries();
+  ULONGLONG   GetHits() const                     { return m_hits;     }
+  ULONGLONG   GetMisses() const                   { return m_misses;   }
+
+private:
+  // Read a file and calculate all variants
+  StaticEntry ReadContent(const XString& p_pathname,const WIN32_FILE_ATTRIBUTE_DATA& p_data);
+  // See if the webroot has changed since last lookup
+  void        CheckNotification();
+  // Remove entries until the new size fits
+  void        Evict(size_t p_needed);
+  // Remove one slot (lock must be held)
+  void        Remove(StaticMap::iterator p_slot);
+
+  XString     m_webroot;                            // Directory being watched
+  size_t      m_maxBytes  { STATICCACHE_MAXBYTES }; // Maximum size of all entries
+  size_t      m_maxFile   { STATICCACHE_MAXFILE  }; // Maximum size of one file
+  DWORD       m_interval  { STATICCACHE_INTERVAL }; // Check file times interval
+  bool        m_compress  { true    };              // Create gzip variants
+  HANDLE      m_notify    { INVALID_HANDLE_VALUE }; // Change notification on the webroot
+  size_t      m_bytes     { 0       };              // Current size of all entries
+  ULONGLONG   m_hits      { 0       };              // Statistics: found in the cache
+  ULONGLONG   m_misses    { 0       };              // Statistics: read from disk
+  StaticMap   m_cache;                              // All cached files
+  StaticLRU   m_lru;                                // Most recently used in front
+  CRITICAL_SECTION m_lock;                          // Locking of the cache
+};
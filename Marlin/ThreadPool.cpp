@@ -54,6 +54,9 @@ static char THIS_FILE[] = __FILE__;
 static unsigned _stdcall RunThread(void* p_myThread);
 static unsigned _stdcall RunHeartBeat(void* p_pool);
 
+// Worker registration of the current thread (work-stealing scheduler)
+static thread_local WorkerSlot* t_worker = nullptr;
+
 
 // Set a name on your thread
 // By executing a fake SEH Exception
@@ -98,6 +101,10 @@ ThreadPool::ThreadPool()
 {
   InitializeCriticalSection(&m_critical);
   InitializeCriticalSection(&m_cpuclock);
+  for(auto& worker : m_workers)
+  {
+    worker.store(nullptr);
+  }
 }
 
 ThreadPool::ThreadPool(int p_minThreads,int p_maxThreads)
@@ -106,6 +113,10 @@ ThreadPool::ThreadPool(int p_minThreads,int p_maxThreads)
 {
   InitializeCriticalSection(&m_critical);
   InitializeCriticalSection(&m_cpuclock);
+  for(auto& worker : m_workers)
+  {
+    worker.store(nullptr);
+  }
 }
 
 ThreadPool::~ThreadPool()
@@ -142,6 +153,49 @@ ThreadPool::InitThreadPool()
   TP_TRACE0("Init threadpool\n");
   m_initialized = true;
 
+  // Getting the number of logical processors on the system
+  SYSTEM_INFO info;
+  GetNativeSystemInfo(&info);
+  m_processors = info.dwNumberOfProcessors;
+
+  if(m_scheduler == PoolScheduler::PS_WorkStealing)
+  {
+    InitStealingLimits();
+  }
+  else
+  {
+    InitCompletionLimits();
+  }
+
+  // Start of the performance counters
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&counter);
+  m_statFrequency = counter.QuadPart;
+  QueryPerformanceCounter(&counter);
+  m_statStart = counter.QuadPart;
+
+  // Create IO Completion Port
+  // Must be done before creating the threads!
+  // But could already have been done by association of an I/O handle
+  if(!m_completion)
+  {
+    m_completion = CreateIoCompletionPort(INVALID_HANDLE_VALUE,NULL,NULL,0);
+  }
+
+  // Create our minimum threads
+  for(int ind = 0; ind < m_minThreads; ++ind)
+  {
+    CreateThreadPoolThread();
+  }
+  // Open for business
+  m_initialized = true;
+  m_openForWork = true;
+}
+
+// Limits for the completion port scheduler
+void
+ThreadPool::InitCompletionLimits()
+{
   // Check the logic of maxThreads
   if(m_maxThreads < NUM_THREADS_DEFAULT)
   {
@@ -163,11 +217,6 @@ ThreadPool::InitThreadPool()
     m_minThreads = NUM_THREADS_MINIMUM;
   }
 
-  // Getting the number of logical processors on the system
-  SYSTEM_INFO info;
-  GetNativeSystemInfo(&info);
-  m_processors = info.dwNumberOfProcessors;
-
   if(m_processors > 0)
   {
     // Adjust maximum of threads for the number of processors
@@ -182,22 +231,30 @@ ThreadPool::InitThreadPool()
       m_maxThreads = ((4 * m_processors)/6);
     }
   }
-  // Create IO Completion Port
-  // Must be done before creating the threads!
-  // But could already have been done by association of an I/O handle
-  if(!m_completion)
+}
+
+// The work-stealing scheduler is sized on the number of cores:
+// one worker per logical processor and room to double for blocking work.
+// Configured values are respected, only unset values get these defaults.
+// The hard maximum for the completion port does not apply here.
+void
+ThreadPool::InitStealingLimits()
+{
+  if(!m_minConfigured)
   {
-    m_completion = CreateIoCompletionPort(INVALID_HANDLE_VALUE,NULL,NULL,0);
+    m_minThreads = max(m_processors,NUM_THREADS_MINIMUM);
   }
+  m_minThreads = min(m_minThreads,NUM_THREADS_STEALING / 2);
 
-  // Create our minimum threads
-  for(int ind = 0; ind < m_minThreads; ++ind)
+  if(!m_maxConfigured)
   {
-    CreateThreadPoolThread();
+    m_maxThreads = 2 * m_minThreads;
   }
-  // Open for business
-  m_initialized = true;
-  m_openForWork = true;
+  if(m_maxThreads < m_minThreads)
+  {
+    m_maxThreads = m_minThreads;
+  }
+  m_maxThreads = min(m_maxThreads,NUM_THREADS_STEALING);
 }
 
 // Create a thread in the threadpool
@@ -294,7 +351,8 @@ ThreadPool::TrySetMinimum(int p_minThreads)
     {
       p_minThreads = NUM_THREADS_MINIMUM;
     }
-    m_minThreads = p_minThreads;
+    m_minThreads    = p_minThreads;
+    m_minConfigured = true;
     TP_TRACE1("Set new minimum for threadpool: %d\n",p_minThreads);
     return true;
   }
@@ -312,14 +370,16 @@ ThreadPool::TrySetMaximum(int p_maxThreads)
   {
     p_maxThreads = NUM_THREADS_DEFAULT;
   }
-  if(p_maxThreads > (4 * NUM_THREADS_MAXIMUM))
+  int limit = (m_scheduler == PoolScheduler::PS_WorkStealing) ? NUM_THREADS_STEALING : (4 * NUM_THREADS_MAXIMUM);
+  if(p_maxThreads > limit)
   {
-    p_maxThreads = 4 * NUM_THREADS_MAXIMUM;
+    p_maxThreads = limit;
   }
   // Raising the bar is simple
   if(m_maxThreads < p_maxThreads)
   {
-    m_maxThreads = p_maxThreads;
+    m_maxThreads    = p_maxThreads;
+    m_maxConfigured = true;
     return true;
   }
   AutoLockTP lock(&m_critical);
@@ -327,7 +387,8 @@ ThreadPool::TrySetMaximum(int p_maxThreads)
   // Only if not so many threads are running.
   if(m_threads.size() <= (unsigned) p_maxThreads)
   {
-    m_maxThreads = p_maxThreads;
+    m_maxThreads    = p_maxThreads;
+    m_maxConfigured = true;
     TP_TRACE1("Set new maximum for threadpool: %d\n",p_maxThreads);
     return true;
   }
@@ -411,6 +472,10 @@ RunThread(void* p_myThread)
 {
   // If we come to here, we exist!
   ThreadRegister* reg = reinterpret_cast<ThreadRegister*>(p_myThread);
+  if(reg->m_pool->GetScheduler() == PoolScheduler::PS_WorkStealing)
+  {
+    return reg->m_pool->RunAStealingThread(reg);
+  }
   return reg->m_pool->RunAThread(reg);
 }
 
@@ -492,10 +557,12 @@ ThreadPool::RunAThread(ThreadRegister* /*p_register*/)
       if(key == COMPLETION_WORK && overlapped == INVALID_HANDLE_VALUE)
       {
         // 1: Thread woke to do some interesting work....
-        LPFN_CALLBACK callback = nullptr;
-        void*         payload  = nullptr;
-        if(WorkToDo(callback,payload))
+        LPFN_CALLBACK callback  = nullptr;
+        void*         payload   = nullptr;
+        __int64       submitted = 0;
+        if(WorkToDo(callback,payload,submitted))
         {
+          AccountWork(nullptr,submitted,false);
           DoTheCallback(callback,payload);
         }
       }
@@ -573,6 +640,13 @@ ThreadPool::RunCleanupJobs()
 // Pool is/MUST BE already in a locked state
 bool 
 ThreadPool::WorkToDo(LPFN_CALLBACK& p_callback,void*& p_argument)
+{
+  __int64 submitted = 0;
+  return WorkToDo(p_callback,p_argument,submitted);
+}
+
+bool 
+ThreadPool::WorkToDo(LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted)
 {
   AutoLockTP lock(&m_critical);
 
@@ -582,10 +656,15 @@ ThreadPool::WorkToDo(LPFN_CALLBACK& p_callback,void*& p_argument)
     return false;
   }
   // User first arguments in the work queue
-  p_callback = m_work[0].m_callback;
-  p_argument = m_work[0].m_argument;
+  p_callback  = m_work[0].m_callback;
+  p_argument  = m_work[0].m_argument;
+  p_submitted = m_work[0].m_submitted;
   // Remove first element in the work queue
   m_work.pop_front();
+  if(m_scheduler == PoolScheduler::PS_WorkStealing)
+  {
+    --m_sharedWork;
+  }
 
   TP_TRACE0("WORK POPPPED from the work queue!\n");
 
@@ -754,6 +833,12 @@ ThreadPool::StopHeartbeat()
 bool
 ThreadPool::SubmitWork(LPFN_CALLBACK p_callback,void* p_argument)
 {
+  // The work-stealing scheduler does not lock the pool
+  if(m_scheduler == PoolScheduler::PS_WorkStealing)
+  {
+    return SubmitStealingWork(p_callback,p_argument);
+  }
+
   // Lock the pool
   AutoLockTP lock(&m_critical);
 
@@ -770,10 +855,15 @@ ThreadPool::SubmitWork(LPFN_CALLBACK p_callback,void* p_argument)
   }
 
   // Queue the work for later use
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
   ThreadWork work;
-  work.m_callback = p_callback;
-  work.m_argument = p_argument;
+  work.m_callback  = p_callback;
+  work.m_argument  = p_argument;
+  work.m_submitted = now.QuadPart;
   m_work.push_back(work);
+  ++m_statSubmitted;
+  ++m_statOverflow;
   TP_TRACE1("Queueing 1 job. Work queue now [%d] items\n",m_work.size());
 
   // Post to free 1 thread from the pool
@@ -833,7 +923,14 @@ ThreadPool::SleepThread(DWORD_PTR p_unique,void* p_payload)
 
   // Add sleeping thread info the queue
   { AutoLockTP lock(&m_critical);
-    m_sleeping.push_back(sleep);
+    if(m_sleeping.insert(std::make_pair(p_unique,sleep)).second == false)
+    {
+      // Unique number already in use by another sleeping thread
+      TP_TRACE0("Sleeping thread unique number not unique!\n");
+      CloseHandle(sleep->m_event);
+      delete sleep;
+      return nullptr;
+    }
   }
 
   // Go to sleep
@@ -853,26 +950,23 @@ ThreadPool::SleepThread(DWORD_PTR p_unique,void* p_payload)
   // Find and remove the sleeping thread info (in a locking block!)
   { AutoLockTP lock(&m_critical);
 
-    SleepingMap::iterator it;
-    for(it = m_sleeping.begin();it != m_sleeping.end(); ++it)
+    SleepingMap::iterator it = m_sleeping.find(p_unique);
+    if(it != m_sleeping.end())
     {
-      sleeper = *it;
-      if(sleeper->m_unique == p_unique)
+      sleeper = it->second;
+
+      // Done with the sleeping thread info
+      bool  abort   = sleeper->m_abort;
+      void* payload = sleeper->m_payload;
+      CloseHandle(sleeper->m_event);
+      delete sleeper;
+
+      // Remove from the queue
+      m_sleeping.erase(it);
+
+      // See if we must abort
+      if(!abort)
       {
-        // Done with the sleeping thread info
-        bool  abort   = sleeper->m_abort;
-        void* payload = sleeper->m_payload;
-        CloseHandle(sleeper->m_event);
-        delete sleeper;
-    
-        // Remove from the queue
-        m_sleeping.erase(it);
-
-        // See if we must abort
-        if(abort)
-        {
-          break;
-        }
         return payload;
       }
     }
@@ -886,6 +980,10 @@ ThreadPool::SleepThread(DWORD_PTR p_unique,void* p_payload)
     DWORD id = GetCurrentThreadId();
     if(IsThreadInThreadPool(id))
     {
+      if(t_worker && t_worker->m_pool == this)
+      {
+        ReleaseWorkerSlot(t_worker);
+      }
       InterlockedDecrement(&m_curThreads);
       InterlockedDecrement(&m_bsyThreads);
       RemoveThreadPoolThread(id);
@@ -904,15 +1002,13 @@ ThreadPool::WakeUpThread(DWORD_PTR p_unique,void* p_result /*=nullptr*/)
 {
   AutoLockTP lock(&m_critical);
 
-  for(auto& sleep : m_sleeping)
+  SleepingMap::iterator it = m_sleeping.find(p_unique);
+  if(it != m_sleeping.end())
   {
-    if(sleep->m_unique == p_unique)
-    {
-      // Set payload result and wake the thread
-      sleep->m_payload = p_result;
-      SetEvent(sleep->m_event);
-      return true;
-    }
+    // Set payload result and wake the thread
+    it->second->m_payload = p_result;
+    SetEvent(it->second->m_event);
+    return true;
   }
   return false;
 }
@@ -924,12 +1020,10 @@ ThreadPool::GetSleepingThreadPayload(DWORD_PTR p_unique)
 {
   AutoLockTP lock(&m_critical);
 
-  for(auto& sleep : m_sleeping)
+  SleepingMap::iterator it = m_sleeping.find(p_unique);
+  if(it != m_sleeping.end())
   {
-    if(sleep->m_unique == p_unique)
-    {
-      return sleep->m_payload;
-    }
+    return it->second->m_payload;
   }
   return nullptr;
 }
@@ -941,18 +1035,14 @@ ThreadPool::EliminateSleepingThread(DWORD_PTR p_unique)
 {
   AutoLockTP lock(&m_critical);
 
-  SleepingMap::iterator it;
-  for(it = m_sleeping.begin();it != m_sleeping.end(); ++it)
+  SleepingMap::iterator it = m_sleeping.find(p_unique);
+  if(it != m_sleeping.end())
   {
-    SleepingThread* sleep = *it;
-    if(sleep->m_unique == p_unique)
-    {
-      // Set the thread abort code
-      sleep->m_abort = true;
-      // And wake the sleeping thread
-      SetEvent(sleep->m_event);
-      return true;
-    }
+    // Set the thread abort code
+    it->second->m_abort = true;
+    // And wake the sleeping thread
+    SetEvent(it->second->m_event);
+    return true;
   }
   return false;
 }
@@ -968,7 +1058,7 @@ ThreadPool::WakeUpAllSleepers()
     AutoLockTP lock(&m_critical);
     for(auto& sleep : m_sleeping)
     {
-      map.push_back(sleep->m_unique);
+      map.push_back(sleep.first);
     }
   }
 
@@ -1017,7 +1107,7 @@ ThreadPool::WaitingForIdle(int p_part)
                               break;
         case WF_IDLE_CLEAN:   if(m_cleanup.empty()) idle = true;
                               break;
-        case WF_IDLE_WORK:    if(m_work.empty())    idle = true;
+        case WF_IDLE_WORK:    if(m_work.empty() && !StealingWorkPending()) idle = true;
                               break;
         case WF_IDLE_THREADS: if(m_threads.empty()) idle = true;
                               break;
@@ -1097,5 +1187,611 @@ ThreadPool::StopThreadPool()
     delete thread;
   }
   m_threads.clear();
+
+  // Free all worker registrations of the work-stealing scheduler
+  FreeWorkerSlots();
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WORK-STEALING SCHEDULER
+//
+// Each worker owns a lock-free deque. Work submitted from a worker goes
+// to the bottom of its own deque and is popped from there (LIFO, cache hot).
+// Work from outside the pool goes through the shared 'm_work' queue.
+// Idle workers steal the oldest work from the top of the other deques.
+// Workers with nothing to do wait in the I/O completion port, so that
+// associated I/O handles, COMPLETION_CALL and heartbeats keep working.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Owner only: push at the bottom
+bool
+WorkStealingQueue::Push(LPFN_CALLBACK p_callback,void* p_argument,__int64 p_submitted)
+{
+  __int64 bottom = m_bottom.load(std::memory_order_relaxed);
+  __int64 top    = m_top.load(std::memory_order_acquire);
+  if(bottom - top >= STEALING_QUEUE_SIZE)
+  {
+    return false;
+  }
+  Slot& slot = m_slots[bottom & (STEALING_QUEUE_SIZE - 1)];
+  slot.m_callback .store(p_callback, std::memory_order_relaxed);
+  slot.m_argument .store(p_argument, std::memory_order_relaxed);
+  slot.m_submitted.store(p_submitted,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  m_bottom.store(bottom + 1,std::memory_order_relaxed);
+  return true;
+}
+
+// Owner only: pop at the bottom
+bool
+WorkStealingQueue::Pop(LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted)
+{
+  __int64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+  m_bottom.store(bottom,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  __int64 top = m_top.load(std::memory_order_relaxed);
+
+  if(top > bottom)
+  {
+    // Deque was empty
+    m_bottom.store(bottom + 1,std::memory_order_relaxed);
+    return false;
+  }
+  Slot& slot = m_slots[bottom & (STEALING_QUEUE_SIZE - 1)];
+  p_callback  = slot.m_callback .load(std::memory_order_relaxed);
+  p_argument  = slot.m_argument .load(std::memory_order_relaxed);
+  p_submitted = slot.m_submitted.load(std::memory_order_relaxed);
+  if(top < bottom)
+  {
+    // More than one item: no race with the stealers
+    return true;
+  }
+  // Last item: race against the stealers for it
+  bool won = m_top.compare_exchange_strong(top,top + 1,std::memory_order_seq_cst,std::memory_order_relaxed);
+  m_bottom.store(bottom + 1,std::memory_order_relaxed);
+  return won;
+}
+
+// Any thread: steal at the top
+bool
+WorkStealingQueue::Steal(LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted)
+{
+  __int64 top = m_top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  __int64 bottom = m_bottom.load(std::memory_order_acquire);
+  if(top >= bottom)
+  {
+    return false;
+  }
+  Slot& slot = m_slots[top & (STEALING_QUEUE_SIZE - 1)];
+  LPFN_CALLBACK callback  = slot.m_callback .load(std::memory_order_relaxed);
+  void*         argument  = slot.m_argument .load(std::memory_order_relaxed);
+  __int64       submitted = slot.m_submitted.load(std::memory_order_relaxed);
+  if(!m_top.compare_exchange_strong(top,top + 1,std::memory_order_seq_cst,std::memory_order_relaxed))
+  {
+    // Lost the race to the owner or another stealer
+    return false;
+  }
+  p_callback  = callback;
+  p_argument  = argument;
+  p_submitted = submitted;
+  return true;
+}
+
+long
+WorkStealingQueue::Size()
+{
+  __int64 bottom = m_bottom.load(std::memory_order_relaxed);
+  __int64 top    = m_top.load(std::memory_order_relaxed);
+  return bottom > top ? (long)(bottom - top) : 0L;
+}
+
+// Choose the scheduler. Can only succeed before the ThreadPool runs
+bool
+ThreadPool::SetScheduler(PoolScheduler p_scheduler)
+{
+  AutoLockTP lock(&m_critical);
+  if(m_initialized)
+  {
+    TP_TRACE0("FAILED: Cannot set threadpool scheduler after init\n");
+    return false;
+  }
+  m_scheduler = p_scheduler;
+  return true;
+}
+
+// Bind the worker threads to the logical processors
+// Only for the work-stealing scheduler and the first 64 processors (one processor group)
+void
+ThreadPool::SetThreadAffinity(bool p_affinity)
+{
+  m_affinity = p_affinity;
+}
+
+bool
+ThreadPool::SubmitStealingWork(LPFN_CALLBACK p_callback,void* p_argument)
+{
+  TP_TRACE0("Submit work stealing\n");
+
+  // See if we are initialized
+  if(!m_initialized)
+  {
+    AutoLockTP lock(&m_critical);
+    InitThreadPool();
+  }
+
+  // Check that we are open for work
+  if(m_openForWork == false)
+  {
+    TP_TRACE0("INTERNAL ERROR: Threadpool not open for work. Program in closing mode.\n");
+    return false;
+  }
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+
+  // Work from one of our own workers stays on that worker
+  WorkerSlot* worker = t_worker;
+  if(worker && worker->m_pool == this && worker->m_queue.Push(p_callback,p_argument,now.QuadPart))
+  {
+    worker->m_submitted.store(worker->m_submitted.load(std::memory_order_relaxed) + 1,std::memory_order_relaxed);
+  }
+  else
+  {
+    // From outside the pool (or a full deque): through the shared queue
+    AutoLockTP lock(&m_critical);
+    ThreadWork work;
+    work.m_callback  = p_callback;
+    work.m_argument  = p_argument;
+    work.m_submitted = now.QuadPart;
+    m_work.push_back(work);
+    ++m_sharedWork;
+    ++m_statSubmitted;
+    ++m_statOverflow;
+  }
+  WakeStealingWorker();
+  return true;
+}
+
+// Wake up one worker waiting in the completion port, but only if
+// there are more waiting workers than wake-up posts underway.
+// The fence pairs with the idle registration in RunAStealingThread
+void
+ThreadPool::WakeStealingWorker()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  long wakeups = m_wakeups.load();
+  while(m_idleThreads.load() > wakeups)
+  {
+    if(m_wakeups.compare_exchange_weak(wakeups,wakeups + 1))
+    {
+      if(!PostQueuedCompletionStatus(m_completion,0,COMPLETION_WORK,(LPOVERLAPPED)INVALID_HANDLE_VALUE))
+      {
+        TP_TRACE0("Posting of I/O Completion failed\n");
+        --m_wakeups;
+      }
+      return;
+    }
+  }
+}
+
+// Find work for a worker: own deque, shared queue, other deques
+bool
+ThreadPool::FindStealingWork(WorkerSlot*    p_worker
+                            ,LPFN_CALLBACK& p_callback
+                            ,void*&         p_argument
+                            ,__int64&       p_submitted
+                            ,bool&          p_stolen)
+{
+  p_stolen = false;
+
+  // 1: Newest work of our own (still hot in the cache)
+  if(p_worker && p_worker->m_queue.Pop(p_callback,p_argument,p_submitted))
+  {
+    return true;
+  }
+
+  // 2: Work from outside the pool
+  if(m_sharedWork.load() > 0 && WorkToDo(p_callback,p_argument,p_submitted))
+  {
+    if(m_sharedWork.load() > 0)
+    {
+      // Let another worker help with the rest
+      WakeStealingWorker();
+    }
+    return true;
+  }
+
+  // 3: Steal the oldest work of another worker
+  static thread_local unsigned victim = 0;
+  int count = m_workerCount.load();
+  for(int index = 0; index < count; ++index)
+  {
+    WorkerSlot* other = m_workers[(++victim) % count].load();
+    if(other && other != p_worker && other->m_queue.Steal(p_callback,p_argument,p_submitted))
+    {
+      if(other->m_queue.Size() > 0)
+      {
+        WakeStealingWorker();
+      }
+      p_stolen = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Is there any work in the deques or the shared queue?
+bool
+ThreadPool::StealingWorkPending()
+{
+  if(m_sharedWork.load() > 0)
+  {
+    return true;
+  }
+  int count = m_workerCount.load();
+  for(int index = 0; index < count; ++index)
+  {
+    WorkerSlot* worker = m_workers[index].load();
+    if(worker && worker->m_queue.Size() > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Registration of a worker in the work-stealing scheduler
+// Slots are reused, but only freed when the ThreadPool stops
+WorkerSlot*
+ThreadPool::AcquireWorkerSlot()
+{
+  AutoLockTP lock(&m_critical);
+
+  for(int index = 0; index < NUM_THREADS_STEALING; ++index)
+  {
+    WorkerSlot* worker = m_workers[index].load();
+    if(worker == nullptr)
+    {
+      worker = new WorkerSlot();
+      worker->m_pool  = this;
+      worker->m_index = index;
+      worker->m_inUse = true;
+      m_workers[index].store(worker);
+      if(m_workerCount.load() < index + 1)
+      {
+        m_workerCount.store(index + 1);
+      }
+      return worker;
+    }
+    if(!worker->m_inUse.load())
+    {
+      worker->m_inUse = true;
+      return worker;
+    }
+  }
+  // All slots in use: thread works from the shared queue and steals
+  return nullptr;
+}
+
+// Worker leaves the pool. Its remaining work goes to the shared queue
+void
+ThreadPool::ReleaseWorkerSlot(WorkerSlot* p_worker)
+{
+  if(p_worker == nullptr)
+  {
+    return;
+  }
+  AutoLockTP lock(&m_critical);
+
+  ThreadWork work;
+  while(p_worker->m_queue.Pop(work.m_callback,work.m_argument,work.m_submitted))
+  {
+    m_work.push_back(work);
+    ++m_sharedWork;
+  }
+  p_worker->m_inUse = false;
+  if(t_worker == p_worker)
+  {
+    t_worker = nullptr;
+  }
+  WakeStealingWorker();
+}
+
+void
+ThreadPool::FreeWorkerSlots()
+{
+  AutoLockTP lock(&m_critical);
+
+  for(auto& slot : m_workers)
+  {
+    WorkerSlot* worker = slot.exchange(nullptr);
+    if(worker)
+    {
+      // Fold the counters into the pool before the slot disappears
+      m_statSubmitted += worker->m_submitted.load();
+      m_statExecuted  += worker->m_executed.load();
+      m_statQueueTime += worker->m_queueTime.load();
+      m_statStolen    += worker->m_stolen.load();
+      __int64 queueMax = worker->m_queueMax.load();
+      __int64 maximum  = m_statQueueMax.load();
+      while(queueMax > maximum && !m_statQueueMax.compare_exchange_weak(maximum,queueMax));
+      delete worker;
+    }
+  }
+  m_workerCount = 0;
 }
 
+// Account for a work item that is started
+void
+ThreadPool::AccountWork(WorkerSlot* p_worker,__int64 p_submitted,bool p_stolen)
+{
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  __int64 ticks = p_submitted ? now.QuadPart - p_submitted : 0;
+
+  if(p_worker)
+  {
+    // Only the owner writes these counters: no interlocked operations needed
+    p_worker->m_executed .store(p_worker->m_executed .load(std::memory_order_relaxed) + 1,    std::memory_order_relaxed);
+    p_worker->m_queueTime.store(p_worker->m_queueTime.load(std::memory_order_relaxed) + ticks,std::memory_order_relaxed);
+    if(p_stolen)
+    {
+      p_worker->m_stolen.store(p_worker->m_stolen.load(std::memory_order_relaxed) + 1,std::memory_order_relaxed);
+    }
+    if(ticks > p_worker->m_queueMax.load(std::memory_order_relaxed))
+    {
+      p_worker->m_queueMax.store(ticks,std::memory_order_relaxed);
+    }
+    return;
+  }
+  ++m_statExecuted;
+  m_statQueueTime += ticks;
+  __int64 maximum = m_statQueueMax.load();
+  while(ticks > maximum && !m_statQueueMax.compare_exchange_weak(maximum,ticks));
+}
+
+// Running a thread of the work-stealing scheduler
+DWORD
+ThreadPool::RunAStealingThread(ThreadRegister* /*p_register*/)
+{
+  // Install SEH to regular exception translator
+  _set_se_translator(SeTranslator);
+
+  bool stayInThePool = true;
+
+  TP_TRACE0("Thread is entering the work-stealing pool\n");
+  InterlockedIncrement(&m_curThreads);
+  InterlockedIncrement(&m_bsyThreads);
+
+  // Register as a worker with our own deque
+  WorkerSlot* worker = AcquireWorkerSlot();
+  t_worker = worker;
+
+  // Optionally bind the worker to one logical processor
+  if(m_affinity && worker && worker->m_index < m_processors && worker->m_index < 64)
+  {
+    SetThreadAffinityMask(GetCurrentThread(),((DWORD_PTR)1) << worker->m_index);
+  }
+
+  // Check that there is a initialization routine
+  if(m_initialization)
+  {
+    AutoCritSec lock(&m_critical);
+    TP_TRACE0("Running thread initialization routine\n");
+    (*m_initialization)(m_initParameter);
+  }
+
+  // MAIN LOOP
+  do
+  {
+    LPFN_CALLBACK callback  = nullptr;
+    void*         payload   = nullptr;
+    __int64       submitted = 0;
+    bool          stolen    = false;
+
+    // 1: As long as there is work: no waiting and no locking
+    if(FindStealingWork(worker,callback,payload,submitted,stolen))
+    {
+      AccountWork(worker,submitted,stolen);
+      DoTheCallback(callback,payload);
+      continue;
+    }
+
+    // 2: Register as idle and look again, so no wake-up can get lost
+    ++m_idleThreads;
+    if(StealingWorkPending())
+    {
+      --m_idleThreads;
+      continue;
+    }
+
+    DWORD     bytes = 0;
+    DWORD     error = 0;
+    ULONG_PTR key   = 0;
+    float     load  = 0.0;
+    LPOVERLAPPED overlapped = nullptr;
+
+    // Stops executing and wait in I/O completion port
+    InterlockedDecrement(&m_bsyThreads);
+    BOOL ok = GetQueuedCompletionStatus(m_completion,&bytes,&key,&overlapped,INFINITE);
+    error = GetLastError();
+
+    // Start executing again
+    --m_idleThreads;
+    InterlockedIncrement(&m_bsyThreads);
+
+    // Check for various stopping criteria
+    // 1) CloseHandle    -> ERROR_OPERATION_ABORTED
+    // 2) Posting a stop -> COMPLETION_STOP
+    if((!ok && error == ERROR_OPERATION_ABORTED) || key == COMPLETION_STOP)
+    {
+      if(m_abortfunction)
+      {
+        AutoCritSec lock(&m_critical);
+        TP_TRACE0("Running thread abort routine\n");
+        (*m_abortfunction)(overlapped,false,true);
+      }
+      break;
+    }
+
+    // Should we add another thread to the pool?
+    if((m_bsyThreads == m_curThreads) &&
+       (m_bsyThreads  < m_maxThreads) &&
+       (GetCPULoad(&m_cpuclock)  < 0.75) &&
+       m_openForWork)
+    {
+      CreateThreadPoolThread();
+    }
+
+    // PROCESSING A ACTION IN THE THREADPOOL
+    if(ok || overlapped)
+    {
+      if(key == COMPLETION_WORK && overlapped == INVALID_HANDLE_VALUE)
+      {
+        // 1: Woken up for work: the main loop will find it
+        --m_wakeups;
+      }
+      else if (key == COMPLETION_CALL)
+      {
+        // 2: Implement your overload of this special call
+        DoTheCallback(overlapped);
+      }
+      else
+      {
+        // 3: The completion key **IS** the callback mechanism
+        LPFN_CALLBACK iocallback = reinterpret_cast<LPFN_CALLBACK>(key);
+        (*iocallback)(overlapped);
+      }
+    }
+
+    // Find CPU load and see if we must remain in the threadpool
+    load = GetCPULoad(&m_cpuclock);
+    TP_TRACE1("CPU Load: %f\n",load);
+    if((load > 0.9) && (m_curThreads > m_minThreads))
+    {
+      stayInThePool = false;
+    }
+    if(m_abortfunction)
+    {
+      AutoCritSec lock(&m_critical);
+      TP_TRACE0("Running thread stay-in-the-pool routine\n");
+      stayInThePool = (*m_abortfunction)(overlapped,stayInThePool,false);
+    }
+  }
+  while(stayInThePool);
+
+  // Leaving the main loop. Our own work goes to the other workers
+  TP_TRACE0("Thread is leaving the work-stealing pool\n");
+  ReleaseWorkerSlot(worker);
+  InterlockedDecrement(&m_bsyThreads);
+  InterlockedDecrement(&m_curThreads);
+
+  // Try removing ourselves
+  // We are now out-of-business
+  RemoveThreadPoolThread(GetCurrentThreadId());
+
+  TP_TRACE0("Thread about to exit. To be removed\n");
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// PERFORMANCE COUNTERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Collect the raw counters of the pool and all workers
+void
+ThreadPool::CollectStatistics(__int64& p_submitted
+                             ,__int64& p_executed
+                             ,__int64& p_stolen
+                             ,__int64& p_queueTime
+                             ,__int64& p_queueMax)
+{
+  p_submitted = m_statSubmitted.load();
+  p_executed  = m_statExecuted.load();
+  p_queueTime = m_statQueueTime.load();
+  p_queueMax  = m_statQueueMax.load();
+  p_stolen    = m_statStolen.load();
+
+  int count = m_workerCount.load();
+  for(int index = 0; index < count; ++index)
+  {
+    WorkerSlot* worker = m_workers[index].load();
+    if(worker)
+    {
+      p_submitted += worker->m_submitted.load(std::memory_order_relaxed);
+      p_executed  += worker->m_executed .load(std::memory_order_relaxed);
+      p_stolen    += worker->m_stolen   .load(std::memory_order_relaxed);
+      p_queueTime += worker->m_queueTime.load(std::memory_order_relaxed);
+      p_queueMax   = max(p_queueMax,worker->m_queueMax.load(std::memory_order_relaxed));
+    }
+  }
+}
+
+// Getting the performance counters since the start or the last reset
+void
+ThreadPool::GetStatistics(ThreadPoolStatistics& p_statistics)
+{
+  AutoLockTP lock(&m_critical);
+
+  __int64 submitted = 0;
+  __int64 executed  = 0;
+  __int64 stolen    = 0;
+  __int64 queueTime = 0;
+  __int64 queueMax  = 0;
+  CollectStatistics(submitted,executed,stolen,queueTime,queueMax);
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  double frequency = (double)m_statFrequency;
+
+  p_statistics.m_submitted    = submitted - m_baseSubmitted;
+  p_statistics.m_executed     = executed  - m_baseExecuted;
+  p_statistics.m_stolen       = stolen    - m_baseStolen;
+  p_statistics.m_overflow     = m_statOverflow.load() - m_baseOverflow;
+  p_statistics.m_elapsed      = m_statStart ? (double)(now.QuadPart - m_statStart) / frequency : 0.0;
+  p_statistics.m_queueTimeMax = (double)queueMax * 1000000.0 / frequency;
+  p_statistics.m_queueTimeAvg = 0.0;
+  p_statistics.m_throughput   = 0.0;
+  if(p_statistics.m_executed > 0)
+  {
+    p_statistics.m_queueTimeAvg = (double)(queueTime - m_baseQueueTime) * 1000000.0 / frequency / (double)p_statistics.m_executed;
+  }
+  if(p_statistics.m_elapsed > 0.0)
+  {
+    p_statistics.m_throughput = (double)p_statistics.m_executed / p_statistics.m_elapsed;
+  }
+}
+
+// Restart the performance counters.
+// The counters of the workers are never written by another thread,
+// so we remember the current values as the new base line.
+void
+ThreadPool::ResetStatistics()
+{
+  AutoLockTP lock(&m_critical);
+
+  __int64 queueMax = 0;
+  CollectStatistics(m_baseSubmitted,m_baseExecuted,m_baseStolen,m_baseQueueTime,queueMax);
+  m_baseOverflow = m_statOverflow.load();
+
+  // Maximum cannot have a base line. Can miss a concurrent update of a worker
+  m_statQueueMax = 0;
+  int count = m_workerCount.load();
+  for(int index = 0; index < count; ++index)
+  {
+    WorkerSlot* worker = m_workers[index].load();
+    if(worker)
+    {
+      worker->m_queueMax.store(0,std::memory_order_relaxed);
+    }
+  }
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  m_statStart = now.QuadPart;
+}
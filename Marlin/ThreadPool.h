@@ -28,6 +28,8 @@
 #pragma once
 #include <vector>
 #include <deque>
+#include <map>
+#include <atomic>
 
 // Define this macro to debug the ThreadPool
 // #define DEBUG_THREADPOOL  1
@@ -37,6 +39,10 @@ constexpr auto NUM_THREADS_MINIMUM =  4;   // No use for a ThreadPool below this
 constexpr auto NUM_THREADS_DEFAULT = 10;   // Default max threads
 constexpr auto NUM_THREADS_MAXIMUM = 20;   // More than this is not wise under Windows-OS
                                            // Theoretically on a deca-core machine with hyper-threading
+constexpr auto NUM_THREADS_STEALING = 128; // Maximum for the work-stealing scheduler (core-count based)
+
+// Work-stealing scheduler: slots in the per-worker deque (power of 2!)
+constexpr auto STEALING_QUEUE_SIZE = 1024;
 
 // Standard stack size of a thread in 64 bits architectures
 constexpr auto THREAD_STACKSIZE = (2 * 1024 * 1024);
@@ -78,7 +84,7 @@ public:
   bool      m_abort;
 };
 
-using SleepingMap = std::vector<SleepingThread*>;
+using SleepingMap = std::map<DWORD_PTR,SleepingThread*>;
 
 // The queue of work items for submitting work to the ThreadPool
 class ThreadWork
@@ -86,11 +92,79 @@ class ThreadWork
 public:
   LPFN_CALLBACK m_callback;
   void*         m_argument;
+  __int64       m_submitted { 0 };    // Performance counter at submit time
 };
 
 // FIFO Queue of work items still to process
 using WorkMap = std::deque<ThreadWork>;
 
+// Scheduler of the ThreadPool
+enum class PoolScheduler
+{
+  PS_Completion     // All work through the I/O completion port and one locked queue
+ ,PS_WorkStealing   // Per-worker lock-free deques with work stealing
+};
+
+// Lock-free work-stealing deque (Chase-Lev)
+// Only the owning worker thread may Push/Pop at the bottom.
+// Every other thread may Steal from the top.
+class WorkStealingQueue
+{
+public:
+  // Owner only. Returns false if the deque is full
+  bool Push (LPFN_CALLBACK p_callback,void* p_argument,__int64 p_submitted);
+  // Owner only. Newest work first
+  bool Pop  (LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted);
+  // Any thread. Oldest work first
+  bool Steal(LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted);
+  // Approximate number of items
+  long Size();
+
+private:
+  // Slots are atomic, as a stealer can read a slot that is being overwritten.
+  // In that case its compare-exchange on 'm_top' fails and the values are discarded
+  class Slot
+  {
+  public:
+    std::atomic<LPFN_CALLBACK> m_callback  { nullptr };
+    std::atomic<void*>         m_argument  { nullptr };
+    std::atomic<__int64>       m_submitted { 0 };
+  };
+  std::atomic<__int64> m_top    { 0 };
+  std::atomic<__int64> m_bottom { 0 };
+  Slot                 m_slots[STEALING_QUEUE_SIZE];
+};
+
+// One worker registration of the work-stealing scheduler
+// The counters are only written by the owning worker thread
+class WorkerSlot
+{
+public:
+  ThreadPool*          m_pool      { nullptr };
+  int                  m_index     { 0 };
+  std::atomic<bool>    m_inUse     { false };
+  WorkStealingQueue    m_queue;
+  std::atomic<__int64> m_submitted { 0 };
+  std::atomic<__int64> m_executed  { 0 };
+  std::atomic<__int64> m_stolen    { 0 };
+  std::atomic<__int64> m_queueTime { 0 };     // Total performance counter ticks in queue
+  std::atomic<__int64> m_queueMax  { 0 };     // Maximum ticks in the queue
+};
+
+// Performance counters of the ThreadPool
+class ThreadPoolStatistics
+{
+public:
+  __int64 m_submitted     { 0 };    // Work items submitted
+  __int64 m_executed      { 0 };    // Work items executed
+  __int64 m_stolen        { 0 };    // Work items stolen from another worker
+  __int64 m_overflow      { 0 };    // Work items through the shared (locked) queue
+  double  m_queueTimeAvg  { 0.0 };  // Average microseconds between submit and start
+  double  m_queueTimeMax  { 0.0 };  // Maximum microseconds between submit and start
+  double  m_elapsed       { 0.0 };  // Seconds since the start/reset of the counters
+  double  m_throughput    { 0.0 };  // Executed work items per second
+};
+
 class ThreadPool
 {
 public:
@@ -122,6 +196,13 @@ public:
   void  RestoreMaximumThreads(AutoIncrementPoolMax& p_increment);
   // Number of current running threads
   long  GetCurrentThreads();
+  // Choose the scheduler. Can only succeed before the ThreadPool runs
+  bool  SetScheduler(PoolScheduler p_scheduler);
+  // Bind the worker threads to the logical processors (work-stealing only)
+  void  SetThreadAffinity(bool p_affinity);
+  // Getting and resetting the performance counters
+  void  GetStatistics(ThreadPoolStatistics& p_statistics);
+  void  ResetStatistics();
 
   // Sleeping and waking-up a thread
   // Sleeps ANY thread. Also threads not originating in this ThreadPool
@@ -155,18 +236,24 @@ public:
   int    GetCleanupJobs()         { return (int)m_cleanup.size(); }
   int    GetHeartBeatTime()       { return m_heartbeat;           }
   HANDLE GetIOCompletionPort()    { return m_completion;          }
+  PoolScheduler GetScheduler()    { return m_scheduler;           }
+  bool   GetThreadAffinity()      { return m_affinity;            }
 
   // These running-a-thread methods are public, but really should only be called 
   // from within the static work functions of the ThreadPool itself, to get things working
   // Do **NOT** call from your application!!
   DWORD RunAThread(ThreadRegister* p_register);
   DWORD RunHeartbeat();
+  DWORD RunAStealingThread(ThreadRegister* p_register);
 
 private:
   // CONTROLING THE THREADPOOL
 
   // Initialize our new ThreadPool
   void InitThreadPool();
+  // Thread limits of the completion port or the work-stealing scheduler
+  void InitCompletionLimits();
+  void InitStealingLimits();
   // Stopping the thread pool
   void StopThreadPool();
   // Create a thread in the ThreadPool
@@ -179,6 +266,24 @@ private:
   bool IsThreadInThreadPool(unsigned p_threadID);
   // More work to do on a thread  (pool must be locked!!)
   bool WorkToDo(LPFN_CALLBACK& p_callback,void*& p_argument);
+  bool WorkToDo(LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted);
+  // WORK STEALING SCHEDULER
+  // Submit work to the deque of the current worker or the shared queue
+  bool SubmitStealingWork(LPFN_CALLBACK p_callback,void* p_argument);
+  // Find work for a worker: own deque, shared queue, other deques
+  bool FindStealingWork(WorkerSlot* p_worker,LPFN_CALLBACK& p_callback,void*& p_argument,__int64& p_submitted,bool& p_stolen);
+  // Is there any work in the deques or the shared queue?
+  bool StealingWorkPending();
+  // Wake up one worker waiting in the completion port (if any)
+  void WakeStealingWorker();
+  // Registration of a worker in the work-stealing scheduler
+  WorkerSlot* AcquireWorkerSlot();
+  void        ReleaseWorkerSlot(WorkerSlot* p_worker);
+  void        FreeWorkerSlots();
+  // Account for a work item that is started
+  void        AccountWork(WorkerSlot* p_worker,__int64 p_submitted,bool p_stolen);
+  // Collect the raw counters of the pool and all workers
+  void        CollectStatistics(__int64& p_submitted,__int64& p_executed,__int64& p_stolen,__int64& p_queueTime,__int64& p_queueMax);
   // Running all cleanup jobs for the ThreadPool
   void RunCleanupJobs();
   // Wake up all sleeping threads as part of the shutdown
@@ -206,6 +311,8 @@ private:
   long              m_bsyThreads      { 0       };              // TP busy    number of threads
   int               m_minThreads      { NUM_THREADS_MINIMUM };  // TP minimum number of threads
   int               m_maxThreads      { NUM_THREADS_MAXIMUM };  // TP maximum number of threads
+  bool              m_minConfigured   { false   };              // TP minimum set by TrySetMinimum
+  bool              m_maxConfigured   { false   };              // TP maximum set by TrySetMaximum
   int               m_stackSize       { THREAD_STACKSIZE    };  // TP size of SP stack of each thread
   int               m_processors      { 1       };              // Number of logical processors on the system
   HANDLE            m_completion      { nullptr };              // I/O Completion port for I/O and thread sync
@@ -224,6 +331,28 @@ private:
   DWORD             m_heartbeat        { 0       };             // HB milliseconds between heartbeats
   HANDLE            m_heartbeatEvent   { nullptr };             // HB event to wake up the heartbeat
   bool              m_extraHeartbeat   { false   };             // HB Extra event?
+  // Work-stealing section
+  PoolScheduler     m_scheduler { PoolScheduler::PS_Completion };  // WS Scheduler in use
+  bool              m_affinity         { false   };             // WS Bind workers to the processors
+  std::atomic<WorkerSlot*> m_workers[NUM_THREADS_STEALING];     // WS Registration of all workers
+  std::atomic<int>  m_workerCount      { 0       };             // WS Highest used slot + 1
+  std::atomic<long> m_idleThreads      { 0       };             // WS Threads waiting in the completion port
+  std::atomic<long> m_sharedWork       { 0       };             // WS Number of items in 'm_work'
+  std::atomic<long> m_wakeups          { 0       };             // WS Wake-up posts not yet consumed
+  // Statistics section (outside the work-stealing workers)
+  __int64           m_statFrequency    { 1       };             // ST Performance counter frequency
+  __int64           m_statStart        { 0       };             // ST Start of the counters
+  std::atomic<__int64> m_statSubmitted { 0       };             // ST Submitted work items
+  std::atomic<__int64> m_statExecuted  { 0       };             // ST Executed work items
+  std::atomic<__int64> m_statOverflow  { 0       };             // ST Work items through the shared queue
+  std::atomic<__int64> m_statStolen    { 0       };             // ST Stolen work items of freed workers
+  std::atomic<__int64> m_statQueueTime { 0       };             // ST Total ticks in the queue
+  std::atomic<__int64> m_statQueueMax  { 0       };             // ST Maximum ticks in the queue
+  __int64           m_baseSubmitted    { 0       };             // ST Counters at the last reset
+  __int64           m_baseExecuted     { 0       };
+  __int64           m_baseStolen       { 0       };
+  __int64           m_baseOverflow     { 0       };
+  __int64           m_baseQueueTime    { 0       };
 };
 
 // Number of current running threads
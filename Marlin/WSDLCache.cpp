@@ -101,6 +101,8 @@ WSDLCache::ClearCache()
   {
     delete it->second.m_input;
     delete it->second.m_output;
+    delete it->second.m_inputCheck;
+    delete it->second.m_outputCheck;
   }
   m_operations.clear();
 }
@@ -150,6 +152,9 @@ WSDLCache::AddOperation(int p_code,XString p_name,SOAPMessage* p_input,SOAPMessa
   operation.m_code   = p_code;
   operation.m_input  = new SOAPMessage(p_input);
   operation.m_output = new SOAPMessage(p_output);
+  // Compile the templates once for the runtime checking
+  operation.m_inputCheck  = new WSDLValidator(operation.m_input);
+  operation.m_outputCheck = new WSDLValidator(operation.m_output);
 
   m_operations.insert(std::make_pair(p_name,operation));
   return true;
@@ -651,7 +656,7 @@ WSDLCache::CheckIncomingMessage(SOAPMessage* p_msg,bool p_checkFields)
 
   if(it != m_operations.end())
   {
-    return CheckMessage(it->second.m_input,p_msg,_T("Client"),p_checkFields);
+    return CheckMessage(it->second.m_input,it->second.m_inputCheck,p_msg,_T("Client"),p_checkFields);
   }
   // No valid operation found
   p_msg->Reset();
@@ -677,7 +682,7 @@ WSDLCache::CheckOutgoingMessage(SOAPMessage* p_msg,bool p_checkFields)
   OperationMap::iterator it = m_operations.find(name);
   if(it != m_operations.end())
   {
-    return CheckMessage(it->second.m_output,p_msg,_T("Server"),p_checkFields);
+    return CheckMessage(it->second.m_output,it->second.m_outputCheck,p_msg,_T("Server"),p_checkFields);
   }
   // No valid operation found
   p_msg->Reset();
@@ -685,9 +690,9 @@ WSDLCache::CheckOutgoingMessage(SOAPMessage* p_msg,bool p_checkFields)
   return false;
 }
 
-// Check message
+// Check message against the compiled template of the operation
 bool
-WSDLCache::CheckMessage(SOAPMessage* p_orig,SOAPMessage* p_tocheck,XString p_who,bool p_checkFields)
+WSDLCache::CheckMessage(SOAPMessage* p_orig,WSDLValidator* p_validator,SOAPMessage* p_tocheck,XString p_who,bool p_checkFields)
 {
   if(p_orig == p_tocheck)
   {
@@ -695,185 +700,7 @@ WSDLCache::CheckMessage(SOAPMessage* p_orig,SOAPMessage* p_tocheck,XString p_who
     p_tocheck->SetFault(_T("No reuse"),p_who,_T("Server cannot reuse registration messages"),_T("While testing against WSDL"));
     return false;
   }
-  // Check parameter object
-  if((p_orig->GetParameterObject() != p_tocheck->GetParameterObject()) &&
-     !p_orig->GetParameterObject().IsEmpty() &&
-     !p_tocheck->GetParameterObject().IsEmpty())
-  {
-    XString msg;
-    msg.Format(_T("Request/Response object not the same. Expected '%s' got '%s'")
-              ,p_orig->GetParameterObject().GetString()
-              ,p_tocheck->GetParameterObject().GetString());
-
-    p_tocheck->Reset();
-    p_tocheck->SetFault(_T("Request/Response object"),p_who,msg,_T("While testing against WSDL"));
-    return false;
-
-  }
-  if(p_orig->GetParameterCount() && p_tocheck->GetParameterCount())
-  {
-    // Recursively check all parameters
-    XMLElement* orig  = p_orig->GetParameterObjectNode();
-    XMLElement* param = p_tocheck->GetParameterObjectNode();
-    return CheckParameters(orig,p_orig,param,p_tocheck,p_who,p_checkFields);
-  }
-  // One of both have no parameters. Always allowed (but no very efficient in calling!)
-  return true;
-}
-
-// Check parameters
-bool
-WSDLCache::CheckParameters(XMLElement*  p_orgBase
-                          ,SOAPMessage* p_orig
-                          ,XMLElement*  p_checkBase
-                          ,SOAPMessage* p_check
-                          ,XString      p_who
-                          ,bool         p_fields)
-{
-  XmlDataType type = 0;
-  XMLElement* orgParam   = p_orig->GetElementFirstChild(p_orgBase);
-  XMLElement* checkParam = p_check->GetElementFirstChild(p_checkBase);
-  bool        scanning   = false;
-  while(orgParam)
-  {
-    // Name of node to find in the message to check
-    XString orgName = orgParam->GetName();
-    type = orgParam->GetType();
-    // If the ordering is choice, instead of sequence: do a free search
-    if(!(type & WSDL_Sequence) && !scanning)
-    {
-      checkParam = p_check->FindElement(p_checkBase,orgName,false);
-    }
-    XString chkName = checkParam ? checkParam->GetName() : XString();
-
-    // DO CHECKS
-
-    // Parameter is mandatory but not given in the definition
-    if((orgName != chkName) && (type & WSDL_Mandatory))
-    {
-      p_check->Reset();
-      p_check->SetFault(_T("Mandatory field not found"),p_who,_T("Message is missing a field"),orgParam->GetName());
-      return false;
-    }
-
-    // Only if parameter field found
-    if(orgName == chkName)
-    {
-      if(checkParam)
-      {
-        if(p_fields)
-        {
-          if(CheckFieldDatatypeValues(orgParam,checkParam,p_check,p_who) == false)
-          {
-            return false;
-          }
-        }
-        // RECURSE
-        if(orgParam->GetChildren().size())
-        {
-          if(CheckParameters(orgParam,p_orig,checkParam,p_check,p_who,p_fields) == false)
-          {
-            return false;
-          }
-        }
-      }
-
-      // Message can have more than one nodes of this name
-      // So check that next node, before continuing on the original template
-      if((type & WSDL_OneMany) || (type & WSDL_ZeroMany))
-      {
-        XMLElement* next = p_check->GetElementSibling(checkParam);
-        if(next && next->GetName().Compare(orgName) == 0)
-        {
-          checkParam = next;
-          scanning = true;
-          continue;
-        }
-      }
-      // Get next parameter in sequence list
-      scanning   = false;
-      checkParam = p_check->GetElementSibling(checkParam);
-    }
-    // Next parameter in the template
-    orgParam = p_orig ->GetElementSibling(orgParam);
-    type     = orgParam ? orgParam->GetType() : 0;
-  }
-
-  // See if we've got something extra left
-  checkParam = p_check->GetElementFirstChild(p_checkBase);
-  while(checkParam)
-  {
-    XString checkName = checkParam->GetName();
-    if(p_orig->FindElement(p_orgBase,checkName,false) == nullptr)
-    {
-      p_check->Reset();
-      p_check->SetFault(_T("Extra field found"),p_who,_T("Message has unexpected parameter"),checkName);
-      return false;
-    }
-    // Get next parameter in sequence list
-    checkParam = p_check->GetElementSibling(checkParam);
-  }
-
-  // Gotten to the end, it's OK
-  return true;
-}
-
-// Check data field in depth
-bool
-WSDLCache::CheckFieldDatatypeValues(XMLElement*   p_origParam
-                                   ,XMLElement*   p_checkParam
-                                   ,SOAPMessage*  p_check
-                                   ,XString       p_who)
-{
-  XString         value;
-  XString         result;
-  XMLRestriction  restrict(_T("empty"));
-  XMLRestriction* restriction = p_checkParam->GetRestriction();
-  XmlDataType     type = p_origParam->GetType() & XDT_MaskTypes;
-
-  // Use the restriction, or an empty one
-  if(restriction)
-  {
-    value  = restriction->HandleWhitespace(type,p_checkParam->GetValue());
-    result = restriction->CheckDatatype(type,value);
-  }
-  else
-  {
-    value  = restrict.HandleWhitespace(type,p_checkParam->GetValue());
-    result = restrict.CheckDatatype(type,value);
-  }
-
-  // Datatype failed?
-  if(!result.IsEmpty())
-  {
-    XString details;
-    details.Format(_T("Datatype check failed! Field: %s Value: %s Result: %s")
-                   ,p_checkParam->GetName().GetString()
-                   ,value.GetString()
-                   ,result.GetString());
-    p_check->Reset();
-    p_check->SetFault(_T("Datatype"),p_who,_T("Restriction"),details);
-    return false;
-  }
-
-  // Variable XSD Restriction check, other than the datatype
-  // including (min/max)length, digits, fraction, notation, enumerations, pattern etc.
-  if(restriction)
-  {
-    result = restriction->CheckRestriction(type,value);
-    if(!result.IsEmpty())
-    {
-      XString details;
-      details.Format(_T("Fieldvalue check failed! Field: %s Value: %s Result: %s")
-                     ,p_checkParam->GetName().GetString()
-                     ,value.GetString()
-                     ,result.GetString());
-      p_check->Reset();
-      p_check->SetFault(_T("Fieldvalue"),p_who,_T("Restriction"),result);
-      return false;
-    }
-  }
-  return true;
+  return p_validator->Validate(p_tocheck,p_who,p_checkFields);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -34,6 +34,7 @@
 #pragma once
 #include "SOAPMessage.h"
 #include "XMLRestriction.h"
+#include "WSDLValidator.h"
 #include <vector>
 #include <map>
 
@@ -42,9 +43,11 @@ class LogAnalysis;
 class WsdlOperation
 {
 public:
-  int          m_code;
-  SOAPMessage* m_input;
-  SOAPMessage* m_output;
+  int            m_code;
+  SOAPMessage*   m_input;
+  SOAPMessage*   m_output;
+  WSDLValidator* m_inputCheck  { nullptr };  // Compiled m_input
+  WSDLValidator* m_outputCheck { nullptr };  // Compiled m_output
 };
 
 using OperationMap = std::map<XString,WsdlOperation>;
@@ -113,19 +116,7 @@ public:
 
 private:
   // Check message
-  bool    CheckMessage(SOAPMessage* p_orig,SOAPMessage* p_tocheck,XString p_who,bool p_checkFields);
-  // Check parameters
-  bool    CheckParameters(XMLElement*  p_orgBase
-                         ,SOAPMessage* p_orig
-                         ,XMLElement*  p_checkBase
-                         ,SOAPMessage* p_check
-                         ,XString      p_who
-                         ,bool         p_fields);
-  // Check data field in depth
-  bool    CheckFieldDatatypeValues(XMLElement*   p_origParam
-                                  ,XMLElement*   p_checkParam
-                                  ,SOAPMessage*  p_check
-                                  ,XString       p_who);
+  bool    CheckMessage(SOAPMessage* p_orig,WSDLValidator* p_validator,SOAPMessage* p_tocheck,XString p_who,bool p_checkFields);
   // GENERATING A WSDL
   void    GenerateTypes(XString& p_wsdlcontent);
   void    GenerateMessageTypes(XString& p_wsdlcontent,SOAPMessage* p_msg,TypeDone& p_gedaan);
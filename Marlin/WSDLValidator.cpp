@@ -0,0 +1,303 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: WSDLValidator.cpp
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "stdafx.h"
+#include "WSDLValidator.h"
+
+#ifdef _AFX
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+#endif
+
+// CTOR: Compile the template once
+WSDLValidator::WSDLValidator(SOAPMessage* p_template)
+{
+  m_parameterObject = p_template->GetParameterObject();
+  m_hasParameters   = p_template->GetParameterCount() > 0;
+
+  // Step 0 is the parameter object node itself
+  m_steps.push_back(ValidationStep());
+
+  XMLElement* base = p_template->GetParameterObjectNode();
+  if(base)
+  {
+    m_steps[0].m_name   = base->GetName();
+    m_steps[0].m_nameID = InternName(m_steps[0].m_name);
+    Compile(base,0);
+  }
+}
+
+// Place all children of a template node contiguously in the steps list
+// and then compile the next level of each child.
+// Only indices are kept, as the list grows while compiling
+void
+WSDLValidator::Compile(XMLElement* p_base,int p_step)
+{
+  XmlElementMap& children = p_base->GetChildren();
+  int first = (int) m_steps.size();
+
+  for(auto& child : children)
+  {
+    ValidationStep step;
+    step.m_name     = child->GetName();
+    step.m_nameID   = InternName(step.m_name);
+    step.m_type     = child->GetType();
+    step.m_datatype = child->GetType() & XDT_MaskTypes;
+    // Field values are always checked against the restriction of the template
+    step.m_restriction = child->GetRestriction();
+    if(step.m_restriction)
+    {
+      step.m_restriction->CompileRanges(step.m_datatype);
+    }
+    m_steps.push_back(step);
+  }
+  m_steps[p_step].m_firstChild = first;
+  m_steps[p_step].m_childCount = (int) children.size();
+
+  for(int index = 0;index < (int) children.size();++index)
+  {
+    if(!children[index]->GetChildren().empty())
+    {
+      Compile(children[index],first + index);
+    }
+  }
+}
+
+int
+WSDLValidator::InternName(const XString& p_name)
+{
+  InternedNames::iterator it = m_names.find(p_name);
+  if(it != m_names.end())
+  {
+    return it->second;
+  }
+  int id = (int) m_names.size() + 1;
+  m_names.insert(std::make_pair(p_name,id));
+  return id;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// CHECKING A MESSAGE
+// Same rules as the template walk: sequences in order, choices by free
+// search, repeated elements for xxx-many, no extra elements allowed.
+//
+//////////////////////////////////////////////////////////////////////////
+
+bool
+WSDLValidator::Validate(SOAPMessage* p_message,XString p_who,bool p_checkFields)
+{
+  // Check parameter object
+  XString object = p_message->GetParameterObject();
+  if((m_parameterObject != object) && !m_parameterObject.IsEmpty() && !object.IsEmpty())
+  {
+    XString msg;
+    msg.Format(_T("Request/Response object not the same. Expected '%s' got '%s'")
+              ,m_parameterObject.GetString()
+              ,object.GetString());
+
+    p_message->Reset();
+    p_message->SetFault(_T("Request/Response object"),p_who,msg,_T("While testing against WSDL"));
+    return false;
+  }
+  if(m_hasParameters && p_message->GetParameterCount())
+  {
+    return CheckLevel(0,p_message->GetParameterObjectNode(),p_message,p_who,p_checkFields);
+  }
+  // One of both have no parameters. Always allowed (but no very efficient in calling!)
+  return true;
+}
+
+bool
+WSDLValidator::CheckLevel(int          p_step
+                         ,XMLElement*  p_checkBase
+                         ,SOAPMessage* p_check
+                         ,XString&     p_who
+                         ,bool         p_fields)
+{
+  if(p_checkBase == nullptr)
+  {
+    return true;
+  }
+  XmlElementMap& children = p_checkBase->GetChildren();
+  size_t size     = children.size();
+  size_t position = 0;      // 'size' stands for no element
+  bool   scanning = false;
+
+  // Interned names of the children. Zero for a name not in the template
+  std::vector<int> names(size,0);
+  for(size_t child = 0;child < size;++child)
+  {
+    InternedNames::iterator it = m_names.find(children[child]->GetName());
+    if(it != m_names.end())
+    {
+      names[child] = it->second;
+    }
+  }
+
+  int index = m_steps[p_step].m_firstChild;
+  int last  = index + m_steps[p_step].m_childCount;
+  while(index < last)
+  {
+    const ValidationStep& step = m_steps[index];
+
+    // If the ordering is choice, instead of sequence: do a free search
+    if(!(step.m_type & WSDL_Sequence) && !scanning)
+    {
+      position = FindChild(names,step.m_nameID);
+    }
+    bool found = position < size && names[position] == step.m_nameID;
+
+    // Parameter is mandatory but not given in the definition
+    if(!found && (step.m_type & WSDL_Mandatory))
+    {
+      p_check->Reset();
+      p_check->SetFault(_T("Mandatory field not found"),p_who,_T("Message is missing a field"),step.m_name);
+      return false;
+    }
+
+    // Only if parameter field found
+    if(found)
+    {
+      XMLElement* checkParam = children[position];
+      if(p_fields && !CheckFieldValue(step,checkParam,p_check,p_who))
+      {
+        return false;
+      }
+      // RECURSE
+      if(step.m_childCount && !CheckLevel(index,checkParam,p_check,p_who,p_fields))
+      {
+        return false;
+      }
+      // Message can have more than one nodes of this name
+      // So check that next node, before continuing on the template
+      if(step.m_type & (WSDL_OneMany | WSDL_ZeroMany))
+      {
+        if(position + 1 < size && names[position + 1] == step.m_nameID)
+        {
+          ++position;
+          scanning = true;
+          continue;
+        }
+      }
+      // Get next parameter in sequence list
+      scanning = false;
+      ++position;
+    }
+    // Next step of the template
+    ++index;
+  }
+
+  // See if we've got something extra left
+  for(size_t child = 0;child < size;++child)
+  {
+    if(names[child] == 0 || !LevelHasName(p_step,names[child]))
+    {
+      p_check->Reset();
+      p_check->SetFault(_T("Extra field found"),p_who,_T("Message has unexpected parameter"),children[child]->GetName());
+      return false;
+    }
+  }
+  // Gotten to the end, it's OK
+  return true;
+}
+
+// Check data field in depth
+bool
+WSDLValidator::CheckFieldValue(const ValidationStep& p_step
+                              ,XMLElement*   p_checkParam
+                              ,SOAPMessage*  p_check
+                              ,XString&      p_who)
+{
+  // Use the restriction of the template field, or an empty one.
+  // Never the restriction of the incoming element: that is in the hands of the sender
+  XMLRestriction* restriction = p_step.m_restriction;
+  XMLRestriction* checking    = restriction ? restriction : &m_empty;
+
+  XString value  = checking->HandleWhitespace(p_step.m_datatype,p_checkParam->GetValue());
+  XString result = checking->CheckDatatype(p_step.m_datatype,value);
+
+  // Datatype failed?
+  if(!result.IsEmpty())
+  {
+    XString details;
+    details.Format(_T("Datatype check failed! Field: %s Value: %s Result: %s")
+                   ,p_step.m_name.GetString()
+                   ,value.GetString()
+                   ,result.GetString());
+    p_check->Reset();
+    p_check->SetFault(_T("Datatype"),p_who,_T("Restriction"),details);
+    return false;
+  }
+
+  // Variable XSD Restriction check, other than the datatype
+  // including (min/max)length, digits, fraction, notation, enumerations, pattern etc.
+  if(restriction)
+  {
+    result = restriction->CheckRestriction(p_step.m_datatype,value);
+    if(!result.IsEmpty())
+    {
+      p_check->Reset();
+      p_check->SetFault(_T("Fieldvalue"),p_who,_T("Restriction"),result);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Non-recursive search of an element in the message by interned name
+size_t
+WSDLValidator::FindChild(const std::vector<int>& p_names,int p_nameID)
+{
+  for(size_t index = 0;index < p_names.size();++index)
+  {
+    if(p_names[index] == p_nameID)
+    {
+      return index;
+    }
+  }
+  return p_names.size();
+}
+
+// Is an interned name one of the children of this step?
+bool
+WSDLValidator::LevelHasName(int p_step,int p_nameID)
+{
+  int index = m_steps[p_step].m_firstChild;
+  int last  = index + m_steps[p_step].m_childCount;
+  for(;index < last;++index)
+  {
+    if(m_steps[index].m_nameID == p_nameID)
+    {
+      return true;
+    }
+  }
+  return false;
+}
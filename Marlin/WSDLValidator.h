@@ -0,0 +1,97 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// SourceFile: WSDLValidator.h
+//
+// Marlin Server: Internet server/client
+// 
+// Copyright (c) 2014-2024 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////
+//
+// WSDLValidator
+//
+// A SOAP message template of the WSDLCache, compiled once into a flat
+// list of validation steps. The children of a template node are stored
+// contiguously, so checking a message is a walk over arrays instead of
+// a search through the template XML tree.
+// Element names are interned: an unknown element name is rejected by
+// one lookup, without scanning the template.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "SOAPMessage.h"
+#include "XMLRestriction.h"
+#include <vector>
+#include <map>
+
+// One compiled template element
+class ValidationStep
+{
+public:
+  XString         m_name;                   // Element name
+  int             m_nameID      { 0 };      // Interned name
+  XmlDataType     m_type        { 0 };      // Type with the WSDL ordering/occurrence bits
+  XmlDataType     m_datatype    { 0 };      // Type masked to the XSD datatype only
+  XMLRestriction* m_restriction { nullptr }; // Restriction of the template field (owned by the WSDL)
+  int             m_firstChild  { 0 };      // Index of the first child step
+  int             m_childCount  { 0 };      // Number of child steps (contiguous)
+};
+
+using ValidationSteps = std::vector<ValidationStep>;
+using InternedNames   = std::map<XString,int>;
+
+class WSDLValidator
+{
+public:
+  explicit WSDLValidator(SOAPMessage* p_template);
+
+  // Check a message against the compiled template
+  bool    Validate(SOAPMessage* p_message,XString p_who,bool p_checkFields);
+
+  // GETTERS
+  size_t  GetStepCount()    { return m_steps.size(); }
+  bool    HasParameters()   { return m_hasParameters; }
+
+private:
+  // Compiling the template
+  void    Compile(XMLElement* p_base,int p_step);
+  int     InternName(const XString& p_name);
+  // Checking a level of the message
+  bool    CheckLevel(int          p_step
+                    ,XMLElement*  p_checkBase
+                    ,SOAPMessage* p_check
+                    ,XString&     p_who
+                    ,bool         p_fields);
+  bool    CheckFieldValue(const ValidationStep& p_step
+                         ,XMLElement*   p_checkParam
+                         ,SOAPMessage*  p_check
+                         ,XString&      p_who);
+  size_t  FindChild(const std::vector<int>& p_names,int p_nameID);
+  bool    LevelHasName(int p_step,int p_nameID);
+
+  XString         m_parameterObject;          // Request/response object of the template
+  bool            m_hasParameters { false };  // Template has parameters
+  ValidationSteps m_steps;                    // Step 0 is the parameter object node
+  InternedNames   m_names;                    // Interned element names
+  XMLRestriction  m_empty { _T("empty") };    // Datatype checking without a restriction
+};
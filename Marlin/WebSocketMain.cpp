@@ -505,19 +505,17 @@ WebSocket::WriteString(XString p_string)
 {
   // Now encode MBCS/Unicode to UTF-8
   bool result  = false;
-  DWORD total  = 0;
-  DWORD toSend = 0;
 
   try
   {
 #ifdef _UNICODE
     AutoCSTR string(p_string);
     BYTE* pointer = (BYTE*) string.cstr();
-    toSend = string.size();
+    DWORD toSend  = string.size();
 #else
     XString encoded = EncodeStringForTheWire(p_string);
     BYTE* pointer   = (BYTE*) encoded.GetString();
-    toSend = encoded.GetLength();
+    DWORD toSend    = encoded.GetLength();
 #endif
     if(MUSTLOG(HLL_LOGGING))
     {
@@ -531,39 +529,71 @@ WebSocket::WriteString(XString p_string)
         }
       }
     }
+    result = WriteUTF8Fragments(pointer,toSend);
+  }
+  catch(StdException& ex)
+  {
+    ERRORLOG(ERROR_INVALID_ACCESS,_T("String not written to websocket. Error: " + ex.GetErrorMessage()));
+  }
+  return result;
+}
 
-    // Go send it in fragments
-    do
-    {
-      // Calculate the length of the next fragment
-      bool last = true;
-      DWORD toWrite = toSend - total;
-      if(toWrite >= (m_fragmentsize - WS_MAX_HEADER))
-      {
-        toWrite = m_fragmentsize - WS_MAX_HEADER;
-        last    = false;
-      }
+// Write an already UTF-8 encoded buffer
+// The buffer is not altered, so it can be shared between sockets
+bool
+WebSocket::WriteUTF8(const BYTE* p_buffer,DWORD p_length)
+{
+  bool result = false;
 
-      // Sent out the next fragment
-      if(!WriteFragment(&pointer[total],toWrite,Opcode::SO_UTF8,last))
+  try
+  {
+    if(MUSTLOG(HLL_LOGGING))
+    {
+      DETAILLOGV(_T("Outgoing message on WebSocket [%s] on [%s] Bytes sent [%u]"),m_key.GetString(),m_uri.GetString(),p_length);
+      if(MUSTLOG(HLL_TRACEDUMP))
       {
-        break;
+        m_logfile->AnalysisHex(_T(__FUNCTION__),m_key,(void*)p_buffer,p_length);
       }
-      // Bookkeeping of the total amount of sent bytes
-      total += toWrite;
     }
-    while(total < toSend);
+    result = WriteUTF8Fragments(p_buffer,p_length);
   }
   catch(StdException& ex)
   {
-    ERRORLOG(ERROR_INVALID_ACCESS,_T("String not written to websocket. Error: " + ex.GetErrorMessage()));
+    ERRORLOG(ERROR_INVALID_ACCESS,_T("Buffer not written to websocket. Error: " + ex.GetErrorMessage()));
   }
-  // Check that we send ALL
-  if(total >= toSend)
+  return result;
+}
+
+// Send an UTF-8 buffer in fragments
+bool
+WebSocket::WriteUTF8Fragments(const BYTE* p_buffer,DWORD p_length)
+{
+  DWORD total = 0;
+
+  // Go send it in fragments
+  do
   {
-    result = true;
+    // Calculate the length of the next fragment
+    bool last = true;
+    DWORD toWrite = p_length - total;
+    if(toWrite >= (m_fragmentsize - WS_MAX_HEADER))
+    {
+      toWrite = m_fragmentsize - WS_MAX_HEADER;
+      last    = false;
+    }
+
+    // Sent out the next fragment
+    if(!WriteFragment(const_cast<BYTE*>(&p_buffer[total]),toWrite,Opcode::SO_UTF8,last))
+    {
+      break;
+    }
+    // Bookkeeping of the total amount of sent bytes
+    total += toWrite;
   }
-  return result;
+  while(total < p_length);
+
+  // Check that we send ALL
+  return total >= p_length;
 }
 
 // Write as a binary object to the channel
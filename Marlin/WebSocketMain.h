@@ -188,6 +188,8 @@ public:
 
   // Write as an UTF-8 string to the WebSocket
   bool WriteString(XString p_string);
+  // Write an already UTF-8 encoded buffer (e.g. shared by a broadcast)
+  bool WriteUTF8(const BYTE* p_buffer,DWORD p_length);
   // Write as a binary object to the channel
   bool WriteObject(BYTE* p_buffer,int64 p_length);
 
@@ -265,6 +267,8 @@ public:
   XString   ServerAcceptKey(XString p_clientKey);
 
 protected:
+  // Send an UTF-8 buffer in fragments
+  bool WriteUTF8Fragments(const BYTE* p_buffer,DWORD p_length);
   // Completely close the connection
   void    Close();
   // Store an incoming WSframe 
@@ -0,0 +1,1760 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLArrow.cpp
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#include "stdafx.h"
+#include "SQLComponents.h"
+#include "SQLArrow.h"
+#include <algorithm>
+#include <deque>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+namespace SQLComponents
+{
+
+// Start and end of an Arrow IPC file
+static const char arrow_magic[8] = { 'A','R','R','O','W','1',0,0 };
+
+// Continuation marker of an encapsulated message
+#define ARROW_CONTINUATION  0xFFFFFFFFU
+#define ARROW_VERSION_V5    4
+
+// Message header union
+#define ARROW_MSG_SCHEMA      1
+#define ARROW_MSG_DICTIONARY  2
+#define ARROW_MSG_RECORDBATCH 3
+
+// Type union
+#define ARROW_TYPE_NULL             1
+#define ARROW_TYPE_INT              2
+#define ARROW_TYPE_FLOATINGPOINT    3
+#define ARROW_TYPE_BINARY           4
+#define ARROW_TYPE_UTF8             5
+#define ARROW_TYPE_BOOL             6
+#define ARROW_TYPE_DECIMAL          7
+#define ARROW_TYPE_DATE             8
+#define ARROW_TYPE_TIME             9
+#define ARROW_TYPE_TIMESTAMP       10
+#define ARROW_TYPE_INTERVAL        11
+#define ARROW_TYPE_FIXEDSIZEBINARY 15
+#define ARROW_TYPE_DURATION        18
+#define ARROW_TYPE_LARGEBINARY     19
+#define ARROW_TYPE_LARGEUTF8       20
+
+// Units
+#define ARROW_DATE_DAY          0
+#define ARROW_DATE_MILLISECOND  1
+#define ARROW_UNIT_SECOND       0
+#define ARROW_UNIT_MILLISECOND  1
+#define ARROW_UNIT_MICROSECOND  2
+#define ARROW_UNIT_NANOSECOND   3
+#define ARROW_INTERVAL_MONTHS   0
+#define ARROW_INTERVAL_DAYTIME  1
+#define ARROW_PRECISION_SINGLE  1
+#define ARROW_PRECISION_DOUBLE  2
+
+// BodyCompression codec
+#define ARROW_CODEC_LZ4_FRAME   0
+
+//////////////////////////////////////////////////////////////////////////
+//
+// FLATBUFFERS
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Builds the few FlatBuffers tables of the Arrow metadata.
+// Tables, strings and vectors are first collected as a tree. Finish() writes
+// every node after its parent, so all offsets point forward, and places the
+// vtable of a table directly before the table.
+class ArrowBuilder
+{
+public:
+  int  Table()
+  {
+    m_nodes.emplace_back();
+    m_nodes.back().m_kind = NODE_TABLE;
+    return (int)m_nodes.size() - 1;
+  }
+  void Scalar(int p_table,int p_id,int p_size,unsigned __int64 p_value)
+  {
+    m_nodes[p_table].m_fields.push_back({ p_id,p_size,p_value,-1 });
+  }
+  void Offset(int p_table,int p_id,int p_child)
+  {
+    m_nodes[p_table].m_fields.push_back({ p_id,4,0,p_child });
+  }
+  int  String(const std::string& p_string)
+  {
+    m_nodes.emplace_back();
+    m_nodes.back().m_kind  = NODE_STRING;
+    m_nodes.back().m_bytes = p_string;
+    return (int)m_nodes.size() - 1;
+  }
+  // Vector of structs with an 8 bytes alignment
+  int  Structs(const std::vector<BYTE>& p_data,int p_count)
+  {
+    m_nodes.emplace_back();
+    m_nodes.back().m_kind  = NODE_STRUCTS;
+    m_nodes.back().m_bytes.assign(p_data.begin(),p_data.end());
+    m_nodes.back().m_count = p_count;
+    return (int)m_nodes.size() - 1;
+  }
+  int  Tables(const std::vector<int>& p_tables)
+  {
+    m_nodes.emplace_back();
+    m_nodes.back().m_kind     = NODE_TABLES;
+    m_nodes.back().m_children = p_tables;
+    return (int)m_nodes.size() - 1;
+  }
+  std::string Finish(int p_root);
+
+private:
+  enum { NODE_TABLE = 0,NODE_STRING,NODE_STRUCTS,NODE_TABLES };
+
+  typedef struct _flatField
+  {
+    int              m_id;
+    int              m_size;
+    unsigned __int64 m_value;
+    int              m_child;
+  }
+  FlatField;
+
+  typedef struct _flatNode
+  {
+    int                    m_kind  { NODE_TABLE };
+    std::vector<FlatField> m_fields;
+    std::string            m_bytes;
+    int                    m_count { 0 };
+    std::vector<int>       m_children;
+  }
+  FlatNode;
+
+  using FlatWork = std::deque<std::pair<int,size_t>>;
+
+  size_t WriteNode(std::string& p_buffer,int p_node,FlatWork& p_work);
+
+  std::vector<FlatNode> m_nodes;
+};
+
+static size_t
+AlignTo(size_t p_position,size_t p_alignment)
+{
+  return (p_position + p_alignment - 1) & ~(p_alignment - 1);
+}
+
+template<typename T>
+static void
+PutValue(std::string& p_buffer,size_t p_position,T p_value)
+{
+  memcpy(&p_buffer[p_position],&p_value,sizeof(T));
+}
+
+std::string
+ArrowBuilder::Finish(int p_root)
+{
+  std::string buffer(4,0);
+  FlatWork work;
+  work.push_back(std::make_pair(p_root,0));
+  while(!work.empty())
+  {
+    std::pair<int,size_t> item = work.front();
+    work.pop_front();
+    size_t position = WriteNode(buffer,item.first,work);
+    PutValue<unsigned>(buffer,item.second,(unsigned)(position - item.second));
+  }
+  buffer.resize(AlignTo(buffer.size(),8),0);
+  return buffer;
+}
+
+size_t
+ArrowBuilder::WriteNode(std::string& p_buffer,int p_node,FlatWork& p_work)
+{
+  const FlatNode& node = m_nodes[p_node];
+  size_t position = 0;
+
+  switch(node.m_kind)
+  {
+    case NODE_TABLE:   {
+                         // Largest fields first, so the padding is minimal
+                         std::vector<FlatField> fields(node.m_fields);
+                         std::stable_sort(fields.begin(),fields.end(),[](const FlatField& a,const FlatField& b) { return a.m_size > b.m_size; });
+                         int maxid = -1;
+                         for(const auto& field : fields)
+                         {
+                           maxid = max(maxid,field.m_id);
+                         }
+                         size_t vtable = AlignTo(p_buffer.size(),2);
+                         size_t vtsize = 4 + 2 * (size_t)(maxid + 1);
+                         // The table starts at 4 modulo 8, so the fields after the vtable offset are aligned
+                         position = AlignTo(vtable + vtsize,4);
+                         if(position % 8 != 4)
+                         {
+                           position += 4;
+                         }
+                         std::vector<size_t> places(fields.size());
+                         size_t current = position + 4;
+                         for(size_t index = 0;index < fields.size();++index)
+                         {
+                           current = AlignTo(current,fields[index].m_size);
+                           places[index] = current;
+                           current += fields[index].m_size;
+                         }
+                         p_buffer.resize(current,0);
+                         PutValue<unsigned short>(p_buffer,vtable,    (unsigned short)vtsize);
+                         PutValue<unsigned short>(p_buffer,vtable + 2,(unsigned short)(current - position));
+                         PutValue<int>(p_buffer,position,(int)(position - vtable));
+                         for(size_t index = 0;index < fields.size();++index)
+                         {
+                           const FlatField& field = fields[index];
+                           PutValue<unsigned short>(p_buffer,vtable + 4 + 2 * (size_t)field.m_id,(unsigned short)(places[index] - position));
+                           if(field.m_child >= 0)
+                           {
+                             p_work.push_back(std::make_pair(field.m_child,places[index]));
+                           }
+                           else
+                           {
+                             memcpy(&p_buffer[places[index]],&field.m_value,field.m_size);
+                           }
+                         }
+                       }
+                       break;
+    case NODE_STRING:  position = AlignTo(p_buffer.size(),4);
+                       p_buffer.resize(position,0);
+                       p_buffer.append(4,0);
+                       PutValue<unsigned>(p_buffer,position,(unsigned)node.m_bytes.size());
+                       p_buffer += node.m_bytes;
+                       p_buffer.push_back(0);
+                       break;
+    case NODE_STRUCTS: position = AlignTo(p_buffer.size(),4);
+                       if(position % 8 != 4)
+                       {
+                         position += 4;
+                       }
+                       p_buffer.resize(position + 4,0);
+                       PutValue<unsigned>(p_buffer,position,(unsigned)node.m_count);
+                       p_buffer += node.m_bytes;
+                       break;
+    case NODE_TABLES:  position = AlignTo(p_buffer.size(),4);
+                       p_buffer.resize(position + 4 + 4 * node.m_children.size(),0);
+                       PutValue<unsigned>(p_buffer,position,(unsigned)node.m_children.size());
+                       for(size_t index = 0;index < node.m_children.size();++index)
+                       {
+                         p_work.push_back(std::make_pair(node.m_children[index],position + 4 + 4 * index));
+                       }
+                       break;
+  }
+  return position;
+}
+
+// Bounds checked access to a FlatBuffers buffer.
+// Position 0 is the root offset and never a table, so it stands for "absent".
+class ArrowFlat
+{
+public:
+  explicit ArrowFlat(const std::string& p_buffer)
+          :m_buffer(reinterpret_cast<const BYTE*>(p_buffer.data()))
+          ,m_size(p_buffer.size())
+  {
+  }
+  template<typename T>
+  T Read(size_t p_position) const
+  {
+    if(p_position + sizeof(T) > m_size || p_position + sizeof(T) < p_position)
+    {
+      throw StdException(_T("Arrow file is corrupt: metadata out of bounds"));
+    }
+    T value;
+    memcpy(&value,m_buffer + p_position,sizeof(T));
+    return value;
+  }
+  size_t Root() const
+  {
+    return Follow(0);
+  }
+  template<typename T>
+  T Scalar(size_t p_table,int p_id,T p_default) const
+  {
+    size_t field = Field(p_table,p_id);
+    return field ? Read<T>(field) : p_default;
+  }
+  size_t Table(size_t p_table,int p_id) const
+  {
+    size_t field = Field(p_table,p_id);
+    return field ? Follow(field) : 0;
+  }
+  std::string String(size_t p_table,int p_id) const
+  {
+    size_t field = Field(p_table,p_id);
+    if(field == 0)
+    {
+      return std::string();
+    }
+    size_t   string = Follow(field);
+    unsigned length = Read<unsigned>(string);
+    if(string + 4 + (size_t)length > m_size)
+    {
+      throw StdException(_T("Arrow file is corrupt: string out of bounds"));
+    }
+    return std::string(reinterpret_cast<const char*>(m_buffer + string + 4),length);
+  }
+  // Position of the first element, 0 if the vector is absent
+  size_t Vector(size_t p_table,int p_id,unsigned& p_count,size_t p_element) const
+  {
+    p_count = 0;
+    size_t field = Field(p_table,p_id);
+    if(field == 0)
+    {
+      return 0;
+    }
+    size_t vector = Follow(field);
+    p_count = Read<unsigned>(vector);
+    if(vector + 4 + (unsigned __int64)p_count * p_element > m_size)
+    {
+      throw StdException(_T("Arrow file is corrupt: vector out of bounds"));
+    }
+    return vector + 4;
+  }
+  // Table in a vector of tables
+  size_t Follow(size_t p_position) const
+  {
+    size_t target = p_position + Read<unsigned>(p_position);
+    if(target >= m_size)
+    {
+      throw StdException(_T("Arrow file is corrupt: offset out of bounds"));
+    }
+    return target;
+  }
+
+private:
+  size_t Field(size_t p_table,int p_id) const
+  {
+    if(p_table == 0)
+    {
+      return 0;
+    }
+    size_t   vtable = p_table - Read<int>(p_table);
+    unsigned vtsize = Read<unsigned short>(vtable);
+    size_t   entry  = 4 + 2 * (size_t)p_id;
+    if(entry + 2 > vtsize)
+    {
+      return 0;
+    }
+    unsigned offset = Read<unsigned short>(vtable + entry);
+    return offset ? p_table + offset : 0;
+  }
+
+  const BYTE* m_buffer;
+  size_t      m_size;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// LZ4 FRAMES
+//
+//////////////////////////////////////////////////////////////////////////
+
+#define LZ4_MAGIC         0x184D2204U
+#define LZ4_BLOCKSIZE     (4 * 1024 * 1024)
+#define LZ4_MINMATCH      4
+#define LZ4_MFLIMIT       12
+#define LZ4_LASTLITERALS  5
+#define LZ4_HASHBITS      16
+
+static unsigned
+Rotate32(unsigned p_value,int p_bits)
+{
+  return (p_value << p_bits) | (p_value >> (32 - p_bits));
+}
+
+// XXH32 for the few bytes of a frame descriptor (shorter than 16 bytes)
+static unsigned
+ShortXXH32(const BYTE* p_data,size_t p_length)
+{
+  const unsigned prime1 = 2654435761U;
+  const unsigned prime2 = 2246822519U;
+  const unsigned prime3 = 3266489917U;
+  const unsigned prime4 =  668265263U;
+  const unsigned prime5 =  374761393U;
+
+  unsigned hash = prime5 + (unsigned)p_length;
+  size_t index = 0;
+  for(;index + 4 <= p_length;index += 4)
+  {
+    unsigned word;
+    memcpy(&word,p_data + index,4);
+    hash = Rotate32(hash + word * prime3,17) * prime4;
+  }
+  for(;index < p_length;++index)
+  {
+    hash = Rotate32(hash + p_data[index] * prime5,11) * prime1;
+  }
+  hash ^= hash >> 15;
+  hash *= prime2;
+  hash ^= hash >> 13;
+  hash *= prime3;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static void
+LZ4Length(std::vector<BYTE>& p_output,size_t p_length)
+{
+  for(;p_length >= 255;p_length -= 255)
+  {
+    p_output.push_back(255);
+  }
+  p_output.push_back((BYTE)p_length);
+}
+
+static void
+LZ4Sequence(std::vector<BYTE>& p_output,const BYTE* p_literals,size_t p_literalLength,size_t p_offset,size_t p_matchLength)
+{
+  size_t matchCode = p_matchLength ? p_matchLength - LZ4_MINMATCH : 0;
+  p_output.push_back((BYTE)((min(p_literalLength,(size_t)15) << 4) | min(matchCode,(size_t)15)));
+  if(p_literalLength >= 15)
+  {
+    LZ4Length(p_output,p_literalLength - 15);
+  }
+  p_output.insert(p_output.end(),p_literals,p_literals + p_literalLength);
+  if(p_matchLength)
+  {
+    p_output.push_back((BYTE)p_offset);
+    p_output.push_back((BYTE)(p_offset >> 8));
+    if(matchCode >= 15)
+    {
+      LZ4Length(p_output,matchCode - 15);
+    }
+  }
+}
+
+// Greedy LZ4 block compression with a single hash table
+static void
+LZ4Block(const BYTE* p_input,size_t p_length,std::vector<int>& p_table,std::vector<BYTE>& p_output)
+{
+  size_t anchor = 0;
+  if(p_length > LZ4_MFLIMIT)
+  {
+    std::fill(p_table.begin(),p_table.end(),-1);
+    size_t limit    = p_length - LZ4_MFLIMIT;
+    size_t matchEnd = p_length - LZ4_LASTLITERALS;
+    size_t position = 0;
+    while(position < limit)
+    {
+      unsigned sequence;
+      memcpy(&sequence,p_input + position,4);
+      unsigned hash = (sequence * 2654435761U) >> (32 - LZ4_HASHBITS);
+      int reference = p_table[hash];
+      p_table[hash] = (int)position;
+      if(reference < 0 || position - reference > 0xFFFF || memcmp(p_input + reference,&sequence,4) != 0)
+      {
+        ++position;
+        continue;
+      }
+      size_t length = LZ4_MINMATCH;
+      while(position + length < matchEnd && p_input[reference + length] == p_input[position + length])
+      {
+        ++length;
+      }
+      LZ4Sequence(p_output,p_input + anchor,position - anchor,position - reference,length);
+      position += length;
+      anchor    = position;
+    }
+  }
+  LZ4Sequence(p_output,p_input + anchor,p_length - anchor,0,0);
+}
+
+static void
+LZ4Compress(const BYTE* p_input,size_t p_length,std::vector<BYTE>& p_output)
+{
+  // Independent blocks of 4MB, no checksums
+  BYTE header[7] = { 0x04,0x22,0x4D,0x18,0x60,0x70,0 };
+  header[6] = (BYTE)(ShortXXH32(&header[4],2) >> 8);
+  p_output.insert(p_output.end(),header,header + sizeof(header));
+
+  std::vector<int>  table((size_t)1 << LZ4_HASHBITS);
+  std::vector<BYTE> block;
+  for(size_t position = 0;position < p_length;position += LZ4_BLOCKSIZE)
+  {
+    size_t size = min((size_t)LZ4_BLOCKSIZE,p_length - position);
+    block.clear();
+    LZ4Block(p_input + position,size,table,block);
+
+    unsigned    blockSize = (unsigned)block.size();
+    const BYTE* data      = block.data();
+    if(block.size() >= size)
+    {
+      blockSize = (unsigned)size | 0x80000000U;
+      data      = p_input + position;
+    }
+    p_output.insert(p_output.end(),reinterpret_cast<BYTE*>(&blockSize),reinterpret_cast<BYTE*>(&blockSize) + 4);
+    p_output.insert(p_output.end(),data,data + (blockSize & 0x7FFFFFFFU));
+  }
+  p_output.insert(p_output.end(),4,0);
+}
+
+static size_t
+LZ4ReadLength(const BYTE* p_input,size_t p_length,size_t& p_position)
+{
+  size_t length = 0;
+  BYTE   next   = 255;
+  while(next == 255)
+  {
+    if(p_position >= p_length)
+    {
+      throw StdException(_T("Arrow file is corrupt: LZ4 block"));
+    }
+    next    = p_input[p_position++];
+    length += next;
+  }
+  return length;
+}
+
+// Decodes into the output after the earlier blocks, so linked blocks work as well
+static void
+LZ4Decompress(const BYTE* p_input,size_t p_length,std::vector<BYTE>& p_output)
+{
+  size_t position = 0;
+  while(position < p_length)
+  {
+    BYTE   token   = p_input[position++];
+    size_t literal = token >> 4;
+    if(literal == 15)
+    {
+      literal += LZ4ReadLength(p_input,p_length,position);
+    }
+    if(literal > p_length - position)
+    {
+      throw StdException(_T("Arrow file is corrupt: LZ4 literals"));
+    }
+    p_output.insert(p_output.end(),p_input + position,p_input + position + literal);
+    position += literal;
+    if(position >= p_length)
+    {
+      break;
+    }
+    if(position + 2 > p_length)
+    {
+      throw StdException(_T("Arrow file is corrupt: LZ4 offset"));
+    }
+    size_t offset = p_input[position] | (p_input[position + 1] << 8);
+    position += 2;
+    size_t match = (token & 15);
+    if(match == 15)
+    {
+      match += LZ4ReadLength(p_input,p_length,position);
+    }
+    match += LZ4_MINMATCH;
+    if(offset == 0 || offset > p_output.size())
+    {
+      throw StdException(_T("Arrow file is corrupt: LZ4 match"));
+    }
+    size_t from = p_output.size() - offset;
+    for(size_t index = 0;index < match;++index)
+    {
+      p_output.push_back(p_output[from + index]);
+    }
+  }
+}
+
+static void
+LZ4FrameDecompress(const BYTE* p_input,size_t p_length,std::vector<BYTE>& p_output)
+{
+  size_t position = 0;
+  while(position + 7 <= p_length)
+  {
+    unsigned magic;
+    memcpy(&magic,p_input + position,4);
+    BYTE flags = p_input[position + 4];
+    if(magic != LZ4_MAGIC || (flags >> 6) != 1)
+    {
+      throw StdException(_T("Arrow file is corrupt: not an LZ4 frame"));
+    }
+    position += 6;                        // Magic, FLG and BD
+    position += (flags & 0x08) ? 8 : 0;   // Content size
+    position += (flags & 0x01) ? 4 : 0;   // Dictionary id
+    position += 1;                        // Header checksum
+    for(;;)
+    {
+      if(position + 4 > p_length)
+      {
+        throw StdException(_T("Arrow file is corrupt: LZ4 frame"));
+      }
+      unsigned size;
+      memcpy(&size,p_input + position,4);
+      position += 4;
+      if(size == 0)
+      {
+        break;
+      }
+      size_t length = size & 0x7FFFFFFFU;
+      if(length > p_length - position)
+      {
+        throw StdException(_T("Arrow file is corrupt: LZ4 block size"));
+      }
+      if(size & 0x80000000U)
+      {
+        p_output.insert(p_output.end(),p_input + position,p_input + position + length);
+      }
+      else
+      {
+        LZ4Decompress(p_input + position,length,p_output);
+      }
+      position += length;
+      position += (flags & 0x10) ? 4 : 0; // Block checksum
+    }
+    position += (flags & 0x04) ? 4 : 0;   // Content checksum
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WRITER
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Type of a column in the Arrow schema. Returns the Type union
+static int
+ArrowTypeTable(ArrowBuilder& p_builder,const ColumnarColumn& p_column,int& p_table)
+{
+  p_table = p_builder.Table();
+  switch(p_column.m_columnar)
+  {
+    case COLTYPE_BOOLEAN:   return ARROW_TYPE_BOOL;
+    case COLTYPE_INT8:      // Fall through
+    case COLTYPE_INT16:     // Fall through
+    case COLTYPE_INT32:     // Fall through
+    case COLTYPE_INT64:     p_builder.Scalar(p_table,0,4,(unsigned)p_column.m_width * 8);
+                            p_builder.Scalar(p_table,1,1,1);
+                            return ARROW_TYPE_INT;
+    case COLTYPE_UINT8:     // Fall through
+    case COLTYPE_UINT16:    // Fall through
+    case COLTYPE_UINT32:    // Fall through
+    case COLTYPE_UINT64:    p_builder.Scalar(p_table,0,4,(unsigned)p_column.m_width * 8);
+                            p_builder.Scalar(p_table,1,1,0);
+                            return ARROW_TYPE_INT;
+    case COLTYPE_FLOAT:     p_builder.Scalar(p_table,0,2,ARROW_PRECISION_SINGLE);
+                            return ARROW_TYPE_FLOATINGPOINT;
+    case COLTYPE_DOUBLE:    p_builder.Scalar(p_table,0,2,ARROW_PRECISION_DOUBLE);
+                            return ARROW_TYPE_FLOATINGPOINT;
+    case COLTYPE_DECIMAL:   p_builder.Scalar(p_table,0,4,(unsigned)p_column.m_precision);
+                            p_builder.Scalar(p_table,1,4,(unsigned)p_column.m_scale);
+                            p_builder.Scalar(p_table,2,4,128);
+                            return ARROW_TYPE_DECIMAL;
+    case COLTYPE_DATE:      p_builder.Scalar(p_table,0,2,ARROW_DATE_DAY);
+                            return ARROW_TYPE_DATE;
+    case COLTYPE_TIME:      p_builder.Scalar(p_table,0,2,ARROW_UNIT_MILLISECOND);
+                            p_builder.Scalar(p_table,1,4,32);
+                            return ARROW_TYPE_TIME;
+    case COLTYPE_TIMESTAMP: p_builder.Scalar(p_table,0,2,ARROW_UNIT_MICROSECOND);
+                            return ARROW_TYPE_TIMESTAMP;
+    case COLTYPE_MONTHS:    p_builder.Scalar(p_table,0,2,ARROW_INTERVAL_MONTHS);
+                            return ARROW_TYPE_INTERVAL;
+    case COLTYPE_DURATION:  p_builder.Scalar(p_table,0,2,ARROW_UNIT_MICROSECOND);
+                            return ARROW_TYPE_DURATION;
+    case COLTYPE_GUID:      p_builder.Scalar(p_table,0,4,16);
+                            return ARROW_TYPE_FIXEDSIZEBINARY;
+    case COLTYPE_STRING:    return ARROW_TYPE_UTF8;
+    default:                return ARROW_TYPE_BINARY;
+  }
+}
+
+static int
+ArrowSchema(ArrowBuilder& p_builder
+           ,const ColumnarSchema& p_schema
+           ,const std::vector<ArrowDictionary>& p_dictionaries
+           ,const std::string& p_types)
+{
+  std::vector<int> fields;
+  for(size_t index = 0;index < p_schema.size();++index)
+  {
+    std::string name;
+    ColumnarToUTF8(p_schema[index].m_name,name);
+
+    int typeTable = 0;
+    int typeType  = ArrowTypeTable(p_builder,p_schema[index],typeTable);
+    int field     = p_builder.Table();
+    p_builder.Offset(field,0,p_builder.String(name));
+    p_builder.Scalar(field,1,1,1);
+    p_builder.Scalar(field,2,1,(unsigned)typeType);
+    p_builder.Offset(field,3,typeTable);
+    if(p_dictionaries[index].m_encoded)
+    {
+      int indexType = p_builder.Table();
+      p_builder.Scalar(indexType,0,4,32);
+      p_builder.Scalar(indexType,1,1,1);
+      int encoding  = p_builder.Table();
+      p_builder.Scalar(encoding,0,8,index);
+      p_builder.Offset(encoding,1,indexType);
+      p_builder.Scalar(encoding,2,1,0);
+      p_builder.Offset(field,4,encoding);
+    }
+    p_builder.Offset(field,5,p_builder.Tables(std::vector<int>()));
+    fields.push_back(field);
+  }
+  int keyvalue = p_builder.Table();
+  p_builder.Offset(keyvalue,0,p_builder.String(SQLCOLUMNAR_METADATA));
+  p_builder.Offset(keyvalue,1,p_builder.String(p_types));
+
+  int schema = p_builder.Table();
+  p_builder.Scalar(schema,0,2,0);   // Little endian
+  p_builder.Offset(schema,1,p_builder.Tables(fields));
+  p_builder.Offset(schema,2,p_builder.Tables(std::vector<int>(1,keyvalue)));
+  return schema;
+}
+
+static std::string
+ArrowMessage(ArrowBuilder& p_builder,int p_type,int p_header,size_t p_body)
+{
+  int message = p_builder.Table();
+  p_builder.Scalar(message,0,2,ARROW_VERSION_V5);
+  p_builder.Scalar(message,1,1,(unsigned)p_type);
+  p_builder.Offset(message,2,p_header);
+  p_builder.Scalar(message,3,8,p_body);
+  return p_builder.Finish(message);
+}
+
+template<typename T>
+static void
+AppendStruct(std::vector<BYTE>& p_buffer,T p_value)
+{
+  const BYTE* data = reinterpret_cast<const BYTE*>(&p_value);
+  p_buffer.insert(p_buffer.end(),data,data + sizeof(T));
+}
+
+// Nodes and buffers of a record batch under construction
+typedef struct _arrowBody
+{
+  std::vector<BYTE> m_body;
+  std::vector<BYTE> m_nodes;
+  std::vector<BYTE> m_buffers;
+  int               m_nodeCount   { 0 };
+  int               m_bufferCount { 0 };
+  bool              m_compress    { false };
+}
+ArrowBody;
+
+static void
+AddNode(ArrowBody& p_body,__int64 p_length,__int64 p_nulls)
+{
+  AppendStruct<__int64>(p_body.m_nodes,p_length);
+  AppendStruct<__int64>(p_body.m_nodes,p_nulls);
+  ++p_body.m_nodeCount;
+}
+
+// A compressed buffer starts with its uncompressed length, -1 if it is stored as is
+static void
+AddBuffer(ArrowBody& p_body,const void* p_data,size_t p_length)
+{
+  size_t offset = p_body.m_body.size();
+  const BYTE* data = reinterpret_cast<const BYTE*>(p_data);
+  if(p_length && p_body.m_compress)
+  {
+    std::vector<BYTE> frame;
+    LZ4Compress(data,p_length,frame);
+    if(frame.size() < p_length)
+    {
+      AppendStruct<__int64>(p_body.m_body,(__int64)p_length);
+      p_body.m_body.insert(p_body.m_body.end(),frame.begin(),frame.end());
+    }
+    else
+    {
+      AppendStruct<__int64>(p_body.m_body,-1);
+      p_body.m_body.insert(p_body.m_body.end(),data,data + p_length);
+    }
+  }
+  else if(p_length)
+  {
+    p_body.m_body.insert(p_body.m_body.end(),data,data + p_length);
+  }
+  AppendStruct<__int64>(p_body.m_buffers,(__int64)offset);
+  AppendStruct<__int64>(p_body.m_buffers,(__int64)(p_body.m_body.size() - offset));
+  p_body.m_body.resize(AlignTo(p_body.m_body.size(),8),0);
+  ++p_body.m_bufferCount;
+}
+
+// Validity bitmap of a column. Empty if there are no NULLs
+static __int64
+AddValidity(ArrowBody& p_body,const std::vector<BYTE>& p_valid)
+{
+  std::vector<BYTE> bitmap((p_valid.size() + 7) / 8,0);
+  __int64 nulls = 0;
+  for(size_t row = 0;row < p_valid.size();++row)
+  {
+    if(p_valid[row])
+    {
+      bitmap[row >> 3] |= (BYTE)(1 << (row & 7));
+    }
+    else
+    {
+      ++nulls;
+    }
+  }
+  AddBuffer(p_body,bitmap.data(),nulls ? bitmap.size() : 0);
+  return nulls;
+}
+
+static int
+ArrowRecordBatch(ArrowBuilder& p_builder,ArrowBody& p_body,__int64 p_rows)
+{
+  int batch = p_builder.Table();
+  p_builder.Scalar(batch,0,8,(unsigned __int64)p_rows);
+  p_builder.Offset(batch,1,p_builder.Structs(p_body.m_nodes,  p_body.m_nodeCount));
+  p_builder.Offset(batch,2,p_builder.Structs(p_body.m_buffers,p_body.m_bufferCount));
+  if(p_body.m_compress)
+  {
+    int compression = p_builder.Table();
+    p_builder.Scalar(compression,0,1,ARROW_CODEC_LZ4_FRAME);
+    p_builder.Scalar(compression,1,1,0);  // Per buffer
+    p_builder.Offset(batch,3,compression);
+  }
+  return batch;
+}
+
+SQLArrowWriter::SQLArrowWriter(const SQLColumnarOptions& p_options)
+               :SQLColumnarWriter(p_options)
+{
+}
+
+void
+SQLArrowWriter::WriteHeader()
+{
+  WriteBytes(arrow_magic,sizeof(arrow_magic));
+}
+
+// Dictionary encoding pays off if the first batch repeats its strings
+void
+SQLArrowWriter::WriteSchema(unsigned p_rows)
+{
+  m_dictionaries.resize(m_schema.size());
+  for(size_t index = 0;index < m_schema.size();++index)
+  {
+    if(!m_options.m_dictionary || m_schema[index].m_columnar != COLTYPE_STRING || p_rows == 0)
+    {
+      continue;
+    }
+    const ColumnarBuffer& buffer = m_buffers[index];
+    std::unordered_map<std::string,int> distinct;
+    for(unsigned row = 0;row < p_rows && distinct.size() <= (size_t)m_options.m_dictionaryMax;++row)
+    {
+      if(buffer.m_valid[row])
+      {
+        distinct.emplace(std::string(reinterpret_cast<const char*>(buffer.m_data.data()) + buffer.m_offsets[row]
+                                    ,buffer.m_offsets[row + 1] - buffer.m_offsets[row]),0);
+      }
+    }
+    m_dictionaries[index].m_encoded = distinct.size() <= (size_t)m_options.m_dictionaryMax
+                                   && distinct.size() * 2 <= p_rows;
+  }
+  ArrowBuilder builder;
+  int schema = ArrowSchema(builder,m_schema,m_dictionaries,GetTypesMetadata());
+  WriteMessage(ArrowMessage(builder,ARROW_MSG_SCHEMA,schema,0),std::vector<BYTE>(),nullptr);
+}
+
+void
+SQLArrowWriter::WriteRowGroup(unsigned p_rows)
+{
+  ArrowBody body;
+  body.m_compress = m_options.m_compress;
+
+  for(size_t index = 0;index < m_schema.size();++index)
+  {
+    const ColumnarColumn& column = m_schema[index];
+    const ColumnarBuffer& buffer = m_buffers[index];
+    ArrowDictionary& dictionary  = m_dictionaries[index];
+
+    size_t nodes = body.m_nodes.size();
+    AddNode(body,p_rows,0);
+    __int64 nulls = AddValidity(body,buffer.m_valid);
+    memcpy(&body.m_nodes[nodes + 8],&nulls,8);
+
+    if(dictionary.m_encoded)
+    {
+      // New strings go to the dictionary, the batch gets the indices
+      std::vector<int> indices(p_rows,0);
+      for(unsigned row = 0;row < p_rows;++row)
+      {
+        if(buffer.m_valid[row])
+        {
+          std::string value(reinterpret_cast<const char*>(buffer.m_data.data()) + buffer.m_offsets[row]
+                           ,buffer.m_offsets[row + 1] - buffer.m_offsets[row]);
+          auto found = dictionary.m_index.find(value);
+          if(found == dictionary.m_index.end())
+          {
+            found = dictionary.m_index.emplace(value,(int)dictionary.m_index.size()).first;
+            dictionary.m_pending.push_back(value);
+          }
+          indices[row] = found->second;
+        }
+      }
+      if(!dictionary.m_sent || !dictionary.m_pending.empty())
+      {
+        WriteDictionary((int)index,dictionary.m_sent);
+      }
+      AddBuffer(body,indices.data(),indices.size() * sizeof(int));
+    }
+    else if(column.m_columnar == COLTYPE_BOOLEAN)
+    {
+      std::vector<BYTE> bits((p_rows + 7) / 8,0);
+      for(unsigned row = 0;row < p_rows;++row)
+      {
+        if(buffer.m_data[row])
+        {
+          bits[row >> 3] |= (BYTE)(1 << (row & 7));
+        }
+      }
+      AddBuffer(body,bits.data(),bits.size());
+    }
+    else if(column.m_width)
+    {
+      AddBuffer(body,buffer.m_data.data(),buffer.m_data.size());
+    }
+    else
+    {
+      AddBuffer(body,buffer.m_offsets.data(),buffer.m_offsets.size() * sizeof(int));
+      AddBuffer(body,buffer.m_data.data(),buffer.m_data.size());
+    }
+  }
+  ArrowBuilder builder;
+  int batch = ArrowRecordBatch(builder,body,p_rows);
+  WriteMessage(ArrowMessage(builder,ARROW_MSG_RECORDBATCH,batch,body.m_body.size()),body.m_body,&m_recordBlocks);
+}
+
+// The first batch of a dictionary, or a delta with the new values
+void
+SQLArrowWriter::WriteDictionary(int p_column,bool p_delta)
+{
+  ArrowDictionary& dictionary = m_dictionaries[p_column];
+  std::vector<int>  offsets(1,0);
+  std::vector<BYTE> data;
+  for(const auto& value : dictionary.m_pending)
+  {
+    data.insert(data.end(),value.begin(),value.end());
+    offsets.push_back((int)data.size());
+  }
+  ArrowBody body;
+  body.m_compress = m_options.m_compress;
+  AddNode(body,(__int64)dictionary.m_pending.size(),0);
+  AddBuffer(body,nullptr,0);
+  AddBuffer(body,offsets.data(),offsets.size() * sizeof(int));
+  AddBuffer(body,data.data(),data.size());
+
+  ArrowBuilder builder;
+  int batch = ArrowRecordBatch(builder,body,(__int64)dictionary.m_pending.size());
+  int header = builder.Table();
+  builder.Scalar(header,0,8,(unsigned __int64)p_column);
+  builder.Offset(header,1,batch);
+  builder.Scalar(header,2,1,p_delta ? 1 : 0);
+  WriteMessage(ArrowMessage(builder,ARROW_MSG_DICTIONARY,header,body.m_body.size()),body.m_body,&m_dictionaryBlocks);
+
+  dictionary.m_pending.clear();
+  dictionary.m_sent = true;
+}
+
+void
+SQLArrowWriter::WriteMessage(const std::string& p_metadata,const std::vector<BYTE>& p_body,std::vector<ArrowBlock>* p_blocks)
+{
+  // Metadata padded so the body starts at a multiple of 8
+  static const BYTE padding[8] = { 0 };
+  unsigned marker = ARROW_CONTINUATION;
+  int      length = (int)AlignTo(p_metadata.size(),8);
+
+  ArrowBlock block;
+  block.m_offset   = m_bytes;
+  block.m_metadata = length + 8;
+  block.m_body     = (__int64)p_body.size();
+
+  WriteBytes(&marker,4);
+  WriteBytes(&length,4);
+  WriteBytes(p_metadata.data(),p_metadata.size());
+  WriteBytes(padding,length - p_metadata.size());
+  WriteBytes(p_body.data(),p_body.size());
+  if(p_blocks)
+  {
+    p_blocks->push_back(block);
+  }
+}
+
+static int
+ArrowBlocks(ArrowBuilder& p_builder,const std::vector<ArrowBlock>& p_blocks)
+{
+  std::vector<BYTE> data;
+  for(const auto& block : p_blocks)
+  {
+    AppendStruct<__int64>(data,block.m_offset);
+    AppendStruct<int>    (data,block.m_metadata);
+    AppendStruct<int>    (data,0);
+    AppendStruct<__int64>(data,block.m_body);
+  }
+  return p_builder.Structs(data,(int)p_blocks.size());
+}
+
+void
+SQLArrowWriter::WriteFooter()
+{
+  unsigned eos[2] = { ARROW_CONTINUATION,0 };
+  WriteBytes(eos,sizeof(eos));
+
+  ArrowBuilder builder;
+  int footer = builder.Table();
+  builder.Scalar(footer,0,2,ARROW_VERSION_V5);
+  builder.Offset(footer,1,ArrowSchema(builder,m_schema,m_dictionaries,GetTypesMetadata()));
+  builder.Offset(footer,2,ArrowBlocks(builder,m_dictionaryBlocks));
+  builder.Offset(footer,3,ArrowBlocks(builder,m_recordBlocks));
+  std::string buffer = builder.Finish(footer);
+
+  int length = (int)buffer.size();
+  WriteBytes(buffer.data(),buffer.size());
+  WriteBytes(&length,4);
+  WriteBytes(arrow_magic,6);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// READER
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Column type of an Arrow field
+static ColumnarType
+ArrowColumnar(const ArrowField& p_field)
+{
+  switch(p_field.m_type)
+  {
+    case ARROW_TYPE_BOOL:             return COLTYPE_BOOLEAN;
+    case ARROW_TYPE_INT:              switch(p_field.m_bitWidth)
+                                      {
+                                        case 8:  return p_field.m_signed ? COLTYPE_INT8  : COLTYPE_UINT8;
+                                        case 16: return p_field.m_signed ? COLTYPE_INT16 : COLTYPE_UINT16;
+                                        case 32: return p_field.m_signed ? COLTYPE_INT32 : COLTYPE_UINT32;
+                                        case 64: return p_field.m_signed ? COLTYPE_INT64 : COLTYPE_UINT64;
+                                      }
+                                      break;
+    case ARROW_TYPE_FLOATINGPOINT:    if(p_field.m_unit == ARROW_PRECISION_SINGLE) return COLTYPE_FLOAT;
+                                      if(p_field.m_unit == ARROW_PRECISION_DOUBLE) return COLTYPE_DOUBLE;
+                                      break;
+    case ARROW_TYPE_DECIMAL:          if(p_field.m_bitWidth == 32 || p_field.m_bitWidth == 64 || p_field.m_bitWidth == 128)
+                                      {
+                                        return COLTYPE_DECIMAL;
+                                      }
+                                      break;
+    case ARROW_TYPE_DATE:             return COLTYPE_DATE;
+    case ARROW_TYPE_TIME:             return COLTYPE_TIME;
+    case ARROW_TYPE_TIMESTAMP:        return COLTYPE_TIMESTAMP;
+    case ARROW_TYPE_INTERVAL:         if(p_field.m_unit == ARROW_INTERVAL_MONTHS)  return COLTYPE_MONTHS;
+                                      if(p_field.m_unit == ARROW_INTERVAL_DAYTIME) return COLTYPE_DURATION;
+                                      break;
+    case ARROW_TYPE_DURATION:         return COLTYPE_DURATION;
+    case ARROW_TYPE_UTF8:             // Fall through
+    case ARROW_TYPE_LARGEUTF8:        return COLTYPE_STRING;
+    case ARROW_TYPE_BINARY:           // Fall through
+    case ARROW_TYPE_LARGEBINARY:      // Fall through
+    case ARROW_TYPE_FIXEDSIZEBINARY:  return COLTYPE_BINARY;
+  }
+  return COLTYPE_UNKNOWN;
+}
+
+// Number of buffers of a field in a record batch
+static int
+ArrowBufferCount(const ArrowField& p_field)
+{
+  if(p_field.m_dictionary >= 0)
+  {
+    return 2;
+  }
+  switch(p_field.m_type)
+  {
+    case ARROW_TYPE_UTF8:         // Fall through
+    case ARROW_TYPE_LARGEUTF8:    // Fall through
+    case ARROW_TYPE_BINARY:       // Fall through
+    case ARROW_TYPE_LARGEBINARY:  return 3;
+    default:                      return 2;
+  }
+}
+
+static __int64
+ReadInteger(const BYTE* p_data,int p_width,bool p_signed)
+{
+  switch(p_width)
+  {
+    case 1:  return p_signed ? (__int64)*reinterpret_cast<const signed char*>(p_data) : (__int64)*p_data;
+    case 2:  { short    value; memcpy(&value,p_data,2); return p_signed ? (__int64)value : (__int64)(unsigned short)value; }
+    case 4:  { int      value; memcpy(&value,p_data,4); return p_signed ? (__int64)value : (__int64)(unsigned)value;       }
+    default: { __int64  value; memcpy(&value,p_data,8); return value; }
+  }
+}
+
+// Floor division by a positive divisor
+static __int64
+ScaleDown(__int64 p_value,__int64 p_divisor)
+{
+  __int64 result = p_value / p_divisor;
+  return (p_value % p_divisor < 0) ? result - 1 : result;
+}
+
+// Microseconds of a value in a time unit. Out of range values wrap around
+static __int64
+ToMicroseconds(__int64 p_value,int p_unit)
+{
+  switch(p_unit)
+  {
+    case ARROW_UNIT_SECOND:       return (__int64)((unsigned __int64)p_value * 1000000);
+    case ARROW_UNIT_MILLISECOND:  return (__int64)((unsigned __int64)p_value * 1000);
+    case ARROW_UNIT_NANOSECOND:   return ScaleDown(p_value,1000);
+    default:                      return p_value;
+  }
+}
+
+// Append one value of an Arrow array in the layout of the column
+static void
+ArrowValue(const ArrowField& p_field,const ColumnarColumn& p_column,const BYTE* p_values,const BYTE* p_offsets,unsigned p_row,ColumnarBuffer& p_buffer)
+{
+  std::vector<BYTE>& data = p_buffer.m_data;
+  const BYTE* value = nullptr;
+  size_t      length = 0;
+
+  switch(p_field.m_type)
+  {
+    case ARROW_TYPE_UTF8:         // Fall through
+    case ARROW_TYPE_BINARY:       {
+                                    int begin = 0,end = 0;
+                                    memcpy(&begin,p_offsets + 4 * (size_t)p_row,4);
+                                    memcpy(&end,  p_offsets + 4 * (size_t)p_row + 4,4);
+                                    value  = p_values + begin;
+                                    length = (size_t)(end - begin);
+                                  }
+                                  break;
+    case ARROW_TYPE_LARGEUTF8:    // Fall through
+    case ARROW_TYPE_LARGEBINARY:  {
+                                    __int64 begin = 0,end = 0;
+                                    memcpy(&begin,p_offsets + 8 * (size_t)p_row,8);
+                                    memcpy(&end,  p_offsets + 8 * (size_t)p_row + 8,8);
+                                    value  = p_values + begin;
+                                    length = (size_t)(end - begin);
+                                  }
+                                  break;
+    case ARROW_TYPE_FIXEDSIZEBINARY:value  = p_values + (size_t)p_row * p_field.m_byteWidth;
+                                  length = p_field.m_byteWidth;
+                                  break;
+    case ARROW_TYPE_BOOL:         data.push_back((p_values[p_row >> 3] >> (p_row & 7)) & 1);
+                                  return;
+    case ARROW_TYPE_DATE:         if(p_field.m_unit == ARROW_DATE_MILLISECOND)
+                                  {
+                                    AppendStruct<int>(data,(int)ScaleDown(ReadInteger(p_values + 8 * (size_t)p_row,8,true),86400000LL));
+                                    return;
+                                  }
+                                  AppendStruct<int>(data,(int)ReadInteger(p_values + 4 * (size_t)p_row,4,true));
+                                  return;
+    case ARROW_TYPE_TIME:         {
+                                    int     width  = p_field.m_bitWidth == 64 ? 8 : 4;
+                                    __int64 micros = ToMicroseconds(ReadInteger(p_values + width * (size_t)p_row,width,true),p_field.m_unit);
+                                    AppendStruct<int>(data,(int)ScaleDown(micros,1000));
+                                  }
+                                  return;
+    case ARROW_TYPE_TIMESTAMP:    // Fall through
+    case ARROW_TYPE_DURATION:     AppendStruct<__int64>(data,ToMicroseconds(ReadInteger(p_values + 8 * (size_t)p_row,8,true),p_field.m_unit));
+                                  return;
+    case ARROW_TYPE_INTERVAL:     if(p_field.m_unit == ARROW_INTERVAL_DAYTIME)
+                                  {
+                                    __int64 days   = ReadInteger(p_values + 8 * (size_t)p_row,    4,true);
+                                    __int64 millis = ReadInteger(p_values + 8 * (size_t)p_row + 4,4,true);
+                                    AppendStruct<__int64>(data,(__int64)((unsigned __int64)days * 86400000000ULL + (unsigned __int64)millis * 1000));
+                                    return;
+                                  }
+                                  AppendStruct<int>(data,(int)ReadInteger(p_values + 4 * (size_t)p_row,4,true));
+                                  return;
+    case ARROW_TYPE_DECIMAL:      if(p_field.m_bitWidth < 128)
+                                  {
+                                    // Sign extended to 128 bits
+                                    int     width   = p_field.m_bitWidth / 8;
+                                    __int64 integer = ReadInteger(p_values + width * (size_t)p_row,width,true);
+                                    AppendStruct<__int64>(data,integer);
+                                    AppendStruct<__int64>(data,integer < 0 ? -1 : 0);
+                                    return;
+                                  }
+                                  value = p_values + 16 * (size_t)p_row;
+                                  data.insert(data.end(),value,value + 16);
+                                  return;
+    default:                      {
+                                    // Integers and floats: the same width as the column
+                                    int width = ColumnarWidth(ArrowColumnar(p_field));
+                                    value = p_values + (size_t)width * p_row;
+                                    if(width == p_column.m_width)
+                                    {
+                                      data.insert(data.end(),value,value + width);
+                                    }
+                                    else
+                                    {
+                                      data.resize(data.size() + p_column.m_width,0);
+                                    }
+                                  }
+                                  return;
+  }
+  if(p_column.m_width)
+  {
+    // Binary of a GUID column
+    if(length == (size_t)p_column.m_width)
+    {
+      data.insert(data.end(),value,value + length);
+    }
+    else
+    {
+      data.resize(data.size() + p_column.m_width,0);
+    }
+    return;
+  }
+  data.insert(data.end(),value,value + length);
+  if(data.size() > INT_MAX)
+  {
+    throw StdException(_T("Arrow record batch too large for column: ") + p_column.m_name);
+  }
+  p_buffer.m_offsets.push_back((int)data.size());
+}
+
+// Checks the buffers of a field against the number of rows
+static void
+ArrowCheckBuffers(const ArrowField& p_field,const ColumnarColumn& p_column,unsigned p_rows,const std::vector<std::vector<BYTE>>& p_buffers)
+{
+  size_t values = p_buffers[1].size();
+  size_t needed = 0;
+  if(p_field.m_dictionary >= 0)
+  {
+    needed = (size_t)p_rows * (p_field.m_indexWidth / 8);
+  }
+  else switch(p_field.m_type)
+  {
+    case ARROW_TYPE_BOOL:             needed = ((size_t)p_rows + 7) / 8; break;
+    case ARROW_TYPE_UTF8:             // Fall through
+    case ARROW_TYPE_BINARY:           needed = ((size_t)p_rows + 1) * 4; break;
+    case ARROW_TYPE_LARGEUTF8:        // Fall through
+    case ARROW_TYPE_LARGEBINARY:      needed = ((size_t)p_rows + 1) * 8; break;
+    case ARROW_TYPE_FIXEDSIZEBINARY:  needed = (size_t)p_rows * p_field.m_byteWidth; break;
+    case ARROW_TYPE_DATE:             needed = (size_t)p_rows * (p_field.m_unit == ARROW_DATE_MILLISECOND ? 8 : 4); break;
+    case ARROW_TYPE_TIME:             needed = (size_t)p_rows * (p_field.m_bitWidth == 64 ? 8 : 4); break;
+    case ARROW_TYPE_INTERVAL:         needed = (size_t)p_rows * (p_field.m_unit == ARROW_INTERVAL_DAYTIME ? 8 : 4); break;
+    case ARROW_TYPE_DECIMAL:          needed = (size_t)p_rows * (p_field.m_bitWidth / 8); break;
+    default:                          needed = (size_t)p_rows * ColumnarWidth(ArrowColumnar(p_field)); break;
+  }
+  if(values < needed || (!p_buffers[0].empty() && p_buffers[0].size() < ((size_t)p_rows + 7) / 8))
+  {
+    throw StdException(_T("Arrow file is corrupt: buffer too small for column: ") + p_column.m_name);
+  }
+  if(p_buffers.size() > 2 && p_rows)
+  {
+    // Offsets must stay within the data
+    int  width = (p_field.m_type == ARROW_TYPE_LARGEUTF8 || p_field.m_type == ARROW_TYPE_LARGEBINARY) ? 8 : 4;
+    __int64 previous = ReadInteger(p_buffers[1].data(),width,true);
+    for(unsigned row = 1;row <= p_rows;++row)
+    {
+      __int64 offset = ReadInteger(p_buffers[1].data() + (size_t)row * width,width,true);
+      if(offset < previous || previous < 0 || (unsigned __int64)offset > p_buffers[2].size())
+      {
+        throw StdException(_T("Arrow file is corrupt: offsets of column: ") + p_column.m_name);
+      }
+      previous = offset;
+    }
+  }
+}
+
+// Decode an Arrow array into the column buffer
+static void
+ArrowDecode(const ArrowField& p_field
+           ,const ColumnarColumn& p_column
+           ,unsigned p_rows
+           ,const std::vector<std::vector<BYTE>>& p_buffers
+           ,const ColumnarBuffer* p_dictionary
+           ,ColumnarBuffer& p_buffer)
+{
+  ArrowCheckBuffers(p_field,p_column,p_rows,p_buffers);
+
+  const std::vector<BYTE>& validity = p_buffers[0];
+  const BYTE* values  = p_buffers.size() > 2 ? p_buffers[2].data() : p_buffers[1].data();
+  const BYTE* offsets = p_buffers[1].data();
+  size_t dictionarySize = p_dictionary ? p_dictionary->m_valid.size() : 0;
+
+  p_buffer.m_valid.resize(p_rows);
+  p_buffer.m_data.clear();
+  p_buffer.m_offsets.assign(1,0);
+  for(unsigned row = 0;row < p_rows;++row)
+  {
+    bool valid = validity.empty() || ((validity[row >> 3] >> (row & 7)) & 1);
+    __int64 index = 0;
+    if(valid && p_dictionary)
+    {
+      index = ReadInteger(p_buffers[1].data() + (size_t)row * (p_field.m_indexWidth / 8),p_field.m_indexWidth / 8,p_field.m_indexSigned);
+      if(index < 0 || (size_t)index >= dictionarySize)
+      {
+        throw StdException(_T("Arrow file is corrupt: dictionary index of column: ") + p_column.m_name);
+      }
+      valid = p_dictionary->m_valid[(size_t)index] != 0;
+    }
+    p_buffer.m_valid[row] = valid ? 1 : 0;
+    if(!valid)
+    {
+      if(p_column.m_width)
+      {
+        p_buffer.m_data.resize(p_buffer.m_data.size() + p_column.m_width,0);
+      }
+      else
+      {
+        p_buffer.m_offsets.push_back((int)p_buffer.m_data.size());
+      }
+    }
+    else if(p_dictionary)
+    {
+      if(p_column.m_width)
+      {
+        const BYTE* value = p_dictionary->m_data.data() + (size_t)index * p_column.m_width;
+        p_buffer.m_data.insert(p_buffer.m_data.end(),value,value + p_column.m_width);
+      }
+      else
+      {
+        const BYTE* value = p_dictionary->m_data.data() + p_dictionary->m_offsets[(size_t)index];
+        p_buffer.m_data.insert(p_buffer.m_data.end(),value,p_dictionary->m_data.data() + p_dictionary->m_offsets[(size_t)index + 1]);
+        if(p_buffer.m_data.size() > INT_MAX)
+        {
+          throw StdException(_T("Arrow record batch too large for column: ") + p_column.m_name);
+        }
+        p_buffer.m_offsets.push_back((int)p_buffer.m_data.size());
+      }
+    }
+    else
+    {
+      ArrowValue(p_field,p_column,values,offsets,row,p_buffer);
+    }
+  }
+}
+
+SQLArrowReader::SQLArrowReader()
+{
+}
+
+bool
+SQLArrowReader::ReadHeader()
+{
+  m_fields.clear();
+  m_dictionaries.clear();
+  m_dictionaryColumns.clear();
+  m_recordBlocks.clear();
+  m_nextBlock  = 0;
+  m_fileFormat = false;
+
+  __int64 size = m_fileSize = GetFileSize();
+  SeekFile(0);
+  std::string metadata;
+  std::vector<BYTE> body;
+
+  if(size >= 8 + 10)
+  {
+    char magic[8];
+    ReadBytes(magic,sizeof(magic));
+    if(memcmp(magic,arrow_magic,6) == 0)
+    {
+      // File format: everything we need is in the footer
+      char trailer[10];
+      SeekFile(size - 10);
+      ReadBytes(trailer,sizeof(trailer));
+      int length = 0;
+      memcpy(&length,trailer,4);
+      if(memcmp(trailer + 4,arrow_magic,6) != 0 || length <= 0 || length > size - 18)
+      {
+        return false;
+      }
+      std::string footer((size_t)length,0);
+      SeekFile(size - 10 - length);
+      ReadBytes(&footer[0],footer.size());
+
+      ArrowFlat flat(footer);
+      size_t root = flat.Root();
+      ReadSchema(footer,flat.Table(root,1));
+
+      unsigned count = 0;
+      size_t blocks = flat.Vector(root,2,count,24);
+      for(unsigned index = 0;index < count;++index)
+      {
+        SeekFile(flat.Read<__int64>(blocks + 24 * (size_t)index));
+        if(!ReadMessage(metadata,body))
+        {
+          throw StdException(_T("Arrow file is corrupt: dictionary block"));
+        }
+        ArrowFlat message(metadata);
+        size_t   header = message.Root();
+        if(message.Scalar<BYTE>(header,1,0) == ARROW_MSG_DICTIONARY)
+        {
+          ReadDictionary(metadata,message.Table(header,2),body);
+        }
+      }
+      blocks = flat.Vector(root,3,count,24);
+      for(unsigned index = 0;index < count;++index)
+      {
+        ArrowBlock block;
+        block.m_offset = flat.Read<__int64>(blocks + 24 * (size_t)index);
+        m_recordBlocks.push_back(block);
+      }
+      m_fileFormat = true;
+      return true;
+    }
+  }
+  // Streaming format: starts with the schema message
+  SeekFile(0);
+  unsigned marker = 0;
+  if(size < 8)
+  {
+    return false;
+  }
+  ReadBytes(&marker,4);
+  if(marker != ARROW_CONTINUATION && (marker == 0 || marker > (unsigned)size))
+  {
+    return false;
+  }
+  SeekFile(0);
+  if(!ReadMessage(metadata,body))
+  {
+    return false;
+  }
+  ArrowFlat message(metadata);
+  size_t root = message.Root();
+  if(message.Scalar<BYTE>(root,1,0) != ARROW_MSG_SCHEMA)
+  {
+    return false;
+  }
+  ReadSchema(metadata,message.Table(root,2));
+  return true;
+}
+
+bool
+SQLArrowReader::ReadRowGroup(unsigned& p_rows)
+{
+  std::string metadata;
+  std::vector<BYTE> body;
+  for(;;)
+  {
+    if(m_fileFormat)
+    {
+      if(m_nextBlock >= m_recordBlocks.size())
+      {
+        return false;
+      }
+      SeekFile(m_recordBlocks[m_nextBlock++].m_offset);
+    }
+    if(!ReadMessage(metadata,body))
+    {
+      return false;
+    }
+    ArrowFlat message(metadata);
+    size_t root   = message.Root();
+    int    type   = message.Scalar<BYTE>(root,1,0);
+    size_t header = message.Table(root,2);
+    if(type == ARROW_MSG_RECORDBATCH)
+    {
+      p_rows = ReadRecordBatch(metadata,header,body);
+      return true;
+    }
+    if(type == ARROW_MSG_DICTIONARY && !m_fileFormat)
+    {
+      ReadDictionary(metadata,header,body);
+    }
+  }
+}
+
+
+// Encapsulated message: continuation marker, length, metadata and body.
+// False at the end of the stream
+bool
+SQLArrowReader::ReadMessage(std::string& p_metadata,std::vector<BYTE>& p_body)
+{
+  __int64 remaining = m_fileSize - GetFilePosition();
+  if(remaining < 4)
+  {
+    return false;
+  }
+  unsigned length = 0;
+  ReadBytes(&length,4);
+  remaining -= 4;
+  if(length == ARROW_CONTINUATION)
+  {
+    if(remaining < 4)
+    {
+      return false;
+    }
+    ReadBytes(&length,4);
+    remaining -= 4;
+  }
+  if(length == 0)
+  {
+    return false;
+  }
+  if((__int64)length > remaining)
+  {
+    throw StdException(_T("Arrow file is corrupt: message length"));
+  }
+  p_metadata.resize(length);
+  ReadBytes(&p_metadata[0],length);
+
+  ArrowFlat flat(p_metadata);
+  __int64 body = flat.Scalar<__int64>(flat.Root(),3,0);
+  if(body < 0 || body > remaining - (__int64)length)
+  {
+    throw StdException(_T("Arrow file is corrupt: message body length"));
+  }
+  p_body.resize((size_t)body);
+  ReadBytes(p_body.data(),p_body.size());
+  return true;
+}
+
+void
+SQLArrowReader::ReadSchema(const std::string& p_buffer,size_t p_schema)
+{
+  ArrowFlat flat(p_buffer);
+  if(p_schema == 0)
+  {
+    throw StdException(_T("Arrow file is corrupt: no schema"));
+  }
+  if(flat.Scalar<short>(p_schema,0,0) != 0)
+  {
+    throw StdException(_T("Arrow file: big endian files are not supported"));
+  }
+  unsigned count  = 0;
+  size_t   fields = flat.Vector(p_schema,1,count,4);
+  for(unsigned index = 0;index < count;++index)
+  {
+    size_t      field = flat.Follow(fields + 4 * (size_t)index);
+    std::string name  = flat.String(field,0);
+    XString     column = ColumnarFromUTF8(reinterpret_cast<const BYTE*>(name.data()),(int)name.size());
+
+    ArrowField arrow;
+    arrow.m_type = flat.Scalar<BYTE>(field,2,0);
+    size_t type  = flat.Table(field,3);
+    int precision = 0;
+    int scale     = 0;
+    switch(arrow.m_type)
+    {
+      case ARROW_TYPE_INT:            arrow.m_bitWidth  = flat.Scalar<int> (type,0,0);
+                                      arrow.m_signed    = flat.Scalar<BYTE>(type,1,0) != 0;
+                                      break;
+      case ARROW_TYPE_FLOATINGPOINT:  arrow.m_unit      = flat.Scalar<short>(type,0,0);
+                                      break;
+      case ARROW_TYPE_DECIMAL:        precision         = flat.Scalar<int>(type,0,0);
+                                      scale             = flat.Scalar<int>(type,1,0);
+                                      arrow.m_bitWidth  = flat.Scalar<int>(type,2,128);
+                                      break;
+      case ARROW_TYPE_DATE:           arrow.m_unit      = flat.Scalar<short>(type,0,ARROW_DATE_MILLISECOND);
+                                      break;
+      case ARROW_TYPE_TIME:           arrow.m_unit      = flat.Scalar<short>(type,0,ARROW_UNIT_MILLISECOND);
+                                      arrow.m_bitWidth  = flat.Scalar<int>  (type,1,32);
+                                      break;
+      case ARROW_TYPE_TIMESTAMP:      arrow.m_unit      = flat.Scalar<short>(type,0,ARROW_UNIT_SECOND);
+                                      break;
+      case ARROW_TYPE_DURATION:       arrow.m_unit      = flat.Scalar<short>(type,0,ARROW_UNIT_MILLISECOND);
+                                      break;
+      case ARROW_TYPE_INTERVAL:       arrow.m_unit      = flat.Scalar<short>(type,0,0);
+                                      break;
+      case ARROW_TYPE_FIXEDSIZEBINARY:arrow.m_byteWidth = flat.Scalar<int>(type,0,0);
+                                      break;
+    }
+    size_t dictionary = flat.Table(field,4);
+    if(dictionary)
+    {
+      // Without an index type the indices are int32
+      size_t indexType    = flat.Table(dictionary,1);
+      arrow.m_dictionary  = flat.Scalar<__int64>(dictionary,0,0);
+      arrow.m_indexWidth  = indexType ? flat.Scalar<int>(indexType,0,0) : 32;
+      arrow.m_indexSigned = indexType ? flat.Scalar<BYTE>(indexType,1,0) != 0 : true;
+      if(arrow.m_indexWidth != 8 && arrow.m_indexWidth != 16 && arrow.m_indexWidth != 32 && arrow.m_indexWidth != 64)
+      {
+        throw StdException(_T("Arrow file: unsupported dictionary index of column: ") + column);
+      }
+      m_dictionaryColumns[arrow.m_dictionary] = (int)index;
+    }
+    unsigned children = 0;
+    flat.Vector(field,5,children,4);
+    ColumnarType columnar = ArrowColumnar(arrow);
+    if(columnar == COLTYPE_UNKNOWN || children)
+    {
+      throw StdException(_T("Arrow file: unsupported datatype of column: ") + column);
+    }
+    if(arrow.m_type == ARROW_TYPE_FIXEDSIZEBINARY && arrow.m_byteWidth <= 0)
+    {
+      throw StdException(_T("Arrow file is corrupt: fixed size binary of column: ") + column);
+    }
+    AddColumn(column,columnar,precision,scale);
+    m_fields.push_back(arrow);
+  }
+
+  // Our own metadata with the types of the variants
+  size_t metadata = flat.Vector(p_schema,2,count,4);
+  for(unsigned index = 0;index < count;++index)
+  {
+    size_t keyvalue = flat.Follow(metadata + 4 * (size_t)index);
+    if(flat.String(keyvalue,0) == SQLCOLUMNAR_METADATA)
+    {
+      SetTypesMetadata(flat.String(keyvalue,1));
+    }
+  }
+}
+
+// All buffers of a record batch, decompressed
+static void
+ArrowBuffers(const ArrowFlat& p_flat,size_t p_batch,const std::vector<BYTE>& p_body,std::vector<std::vector<BYTE>>& p_buffers)
+{
+  size_t compression = p_flat.Table(p_batch,3);
+  if(compression && p_flat.Scalar<BYTE>(compression,0,0) != ARROW_CODEC_LZ4_FRAME)
+  {
+    throw StdException(_T("Arrow file: only LZ4 frame compression is supported"));
+  }
+  unsigned count   = 0;
+  size_t   buffers = p_flat.Vector(p_batch,2,count,16);
+  p_buffers.resize(count);
+  for(unsigned index = 0;index < count;++index)
+  {
+    __int64 offset = p_flat.Read<__int64>(buffers + 16 * (size_t)index);
+    __int64 length = p_flat.Read<__int64>(buffers + 16 * (size_t)index + 8);
+    if(offset < 0 || length < 0 || offset + length > (__int64)p_body.size())
+    {
+      throw StdException(_T("Arrow file is corrupt: buffer out of the body"));
+    }
+    const BYTE* data = p_body.data() + offset;
+    std::vector<BYTE>& buffer = p_buffers[index];
+    buffer.clear();
+    if(compression == 0 || length == 0)
+    {
+      buffer.assign(data,data + length);
+      continue;
+    }
+    __int64 uncompressed = 0;
+    if(length < 8)
+    {
+      throw StdException(_T("Arrow file is corrupt: compressed buffer"));
+    }
+    memcpy(&uncompressed,data,8);
+    if(uncompressed == -1)
+    {
+      buffer.assign(data + 8,data + length);
+      continue;
+    }
+    LZ4FrameDecompress(data + 8,(size_t)length - 8,buffer);
+    if((__int64)buffer.size() != uncompressed)
+    {
+      throw StdException(_T("Arrow file is corrupt: compressed buffer length"));
+    }
+  }
+}
+
+void
+SQLArrowReader::ReadDictionary(const std::string& p_metadata,size_t p_header,const std::vector<BYTE>& p_body)
+{
+  ArrowFlat flat(p_metadata);
+  __int64 id    = flat.Scalar<__int64>(p_header,0,0);
+  size_t  batch = flat.Table(p_header,1);
+  bool    delta = flat.Scalar<BYTE>(p_header,2,0) != 0;
+
+  auto found = m_dictionaryColumns.find(id);
+  if(found == m_dictionaryColumns.end() || batch == 0)
+  {
+    throw StdException(_T("Arrow file is corrupt: unknown dictionary"));
+  }
+  const ColumnarColumn& column = m_schema[found->second];
+  ArrowField field = m_fields[found->second];
+  field.m_dictionary = -1;
+
+  __int64 rows = flat.Scalar<__int64>(batch,0,0);
+  std::vector<std::vector<BYTE>> buffers;
+  ArrowBuffers(flat,batch,p_body,buffers);
+  if(rows < 0 || rows > INT_MAX || (int)buffers.size() < ArrowBufferCount(field))
+  {
+    throw StdException(_T("Arrow file is corrupt: dictionary of column: ") + column.m_name);
+  }
+  buffers.resize(ArrowBufferCount(field));
+
+  ColumnarBuffer values;
+  ArrowDecode(field,column,(unsigned)rows,buffers,nullptr,values);
+
+  ColumnarBuffer& dictionary = m_dictionaries[id];
+  if(!delta || dictionary.m_offsets.empty())
+  {
+    dictionary = std::move(values);
+    return;
+  }
+  // Delta: the new values follow the existing ones
+  int base = (int)dictionary.m_data.size();
+  dictionary.m_valid.insert(dictionary.m_valid.end(),values.m_valid.begin(),values.m_valid.end());
+  dictionary.m_data .insert(dictionary.m_data .end(),values.m_data .begin(),values.m_data .end());
+  for(size_t index = 1;index < values.m_offsets.size();++index)
+  {
+    dictionary.m_offsets.push_back(base + values.m_offsets[index]);
+  }
+}
+
+unsigned
+SQLArrowReader::ReadRecordBatch(const std::string& p_metadata,size_t p_header,const std::vector<BYTE>& p_body)
+{
+  ArrowFlat flat(p_metadata);
+  __int64 rows = flat.Scalar<__int64>(p_header,0,0);
+  if(p_header == 0 || rows < 0 || rows > INT_MAX)
+  {
+    throw StdException(_T("Arrow file is corrupt: record batch length"));
+  }
+  unsigned count = 0;
+  size_t   nodes = flat.Vector(p_header,1,count,16);
+  if(count < m_schema.size())
+  {
+    throw StdException(_T("Arrow file is corrupt: record batch nodes"));
+  }
+  std::vector<std::vector<BYTE>> buffers;
+  ArrowBuffers(flat,p_header,p_body,buffers);
+
+  size_t buffer = 0;
+  for(size_t index = 0;index < m_schema.size();++index)
+  {
+    const ArrowField& field = m_fields[index];
+    size_t parts = ArrowBufferCount(field);
+    if(flat.Read<__int64>(nodes + 16 * index) != rows || buffer + parts > buffers.size())
+    {
+      throw StdException(_T("Arrow file is corrupt: record batch of column: ") + m_schema[index].m_name);
+    }
+    std::vector<std::vector<BYTE>> column;
+    for(size_t part = 0;part < parts;++part)
+    {
+      column.push_back(std::move(buffers[buffer++]));
+    }
+    const ColumnarBuffer* dictionary = nullptr;
+    if(field.m_dictionary >= 0)
+    {
+      auto found = m_dictionaries.find(field.m_dictionary);
+      if(found == m_dictionaries.end())
+      {
+        throw StdException(_T("Arrow file is corrupt: missing dictionary of column: ") + m_schema[index].m_name);
+      }
+      dictionary = &found->second;
+    }
+    ArrowDecode(field,m_schema[index],(unsigned)rows,column,dictionary,m_buffers[index]);
+  }
+  return (unsigned)rows;
+}
+
+}
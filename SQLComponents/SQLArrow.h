@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLArrow.h
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#pragma once
+#include "SQLColumnar.h"
+#include <unordered_map>
+#include <map>
+
+namespace SQLComponents
+{
+
+// Apache Arrow IPC files (Feather version 2, "*.arrow")
+//
+// The writer creates the IPC file format: the schema, the dictionaries and the
+// record batches as encapsulated FlatBuffers messages, followed by a footer
+// with the blocks of all batches. Every row group is one record batch.
+// String columns with few distinct values in the first batch are dictionary
+// encoded with int32 indices. Later batches send their new values as delta
+// dictionary batches. Compressed buffers are LZ4 frames (BodyCompression).
+//
+// The reader accepts the file format and the streaming format (also the
+// pre-0.15 messages without a continuation marker). Supported are all
+// primitive types, (large) strings and binaries, fixed size binaries,
+// decimal128, dictionaries and LZ4 frame compression. Nested types, views
+// and ZSTD compression are refused.
+
+// Arrow type of a field, as far as the reader needs it
+typedef struct _arrowField
+{
+  int     m_type      { 0 };      // Arrow Type union
+  int     m_bitWidth  { 0 };      // Int, Decimal, Time
+  bool    m_signed    { true };   // Int
+  int     m_unit      { 0 };      // Date, Time, Timestamp, Duration, Interval, FloatingPoint precision
+  int     m_byteWidth { 0 };      // FixedSizeBinary
+  __int64 m_dictionary{ -1 };     // Dictionary id. -1 = not dictionary encoded
+  int     m_indexWidth{ 0 };      // Width of the dictionary indices
+  bool    m_indexSigned{ true };
+}
+ArrowField;
+
+// A dictionary of the writer
+typedef struct _arrowDictionary
+{
+  bool                                 m_encoded { false };
+  bool                                 m_sent    { false };
+  std::unordered_map<std::string,int>  m_index;     // Value to index
+  std::vector<std::string>             m_pending;   // Values not yet sent
+}
+ArrowDictionary;
+
+// Position of a message in the file
+typedef struct _arrowBlock
+{
+  __int64 m_offset   { 0 };
+  int     m_metadata { 0 };
+  __int64 m_body     { 0 };
+}
+ArrowBlock;
+
+class SQLArrowWriter : public SQLColumnarWriter
+{
+public:
+  explicit SQLArrowWriter(const SQLColumnarOptions& p_options = SQLColumnarOptions());
+
+protected:
+  void WriteHeader() override;
+  void WriteSchema(unsigned p_rows) override;
+  void WriteRowGroup(unsigned p_rows) override;
+  void WriteFooter() override;
+
+private:
+  void WriteDictionary(int p_column,bool p_delta);
+  void WriteMessage(const std::string& p_metadata,const std::vector<BYTE>& p_body,std::vector<ArrowBlock>* p_blocks);
+
+  std::vector<ArrowDictionary> m_dictionaries;      // One per column
+  std::vector<ArrowBlock>      m_dictionaryBlocks;
+  std::vector<ArrowBlock>      m_recordBlocks;
+};
+
+class SQLArrowReader : public SQLColumnarReader
+{
+public:
+  SQLArrowReader();
+
+protected:
+  bool ReadHeader() override;
+  bool ReadRowGroup(unsigned& p_rows) override;
+
+private:
+  bool ReadMessage(std::string& p_metadata,std::vector<BYTE>& p_body);
+  void ReadSchema(const std::string& p_buffer,size_t p_schema);
+  void ReadDictionary(const std::string& p_metadata,size_t p_header,const std::vector<BYTE>& p_body);
+  unsigned ReadRecordBatch(const std::string& p_metadata,size_t p_header,const std::vector<BYTE>& p_body);
+
+  std::vector<ArrowField>                m_fields;        // One per column
+  std::map<__int64,ColumnarBuffer>       m_dictionaries;  // Decoded dictionaries by id
+  std::map<__int64,int>                  m_dictionaryColumns;
+  std::vector<ArrowBlock>                m_recordBlocks;  // File format: batches from the footer
+  size_t                                 m_nextBlock { 0 };
+  __int64                                m_fileSize  { 0 };
+  bool                                   m_fileFormat{ false };
+};
+
+}
@@ -51,6 +51,15 @@ public:
     }
   }
 
+  // Reading from a read replica of the connection (if any, and if so requested)
+  SQLAutoDBS(SQLDatabasePool& p_pool,XString p_connection,bool p_readReplica)
+            :m_pool(p_pool)
+  {
+    m_database = p_readReplica ? m_pool.GetReadDatabase(p_connection)
+                               : m_pool.GetDatabase(p_connection);
+    m_poolDbs  = true;
+  }
+
  ~SQLAutoDBS()
   {
     if(m_database && m_poolDbs)
@@ -0,0 +1,1074 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLColumnar.cpp
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#include "stdafx.h"
+#include "SQLComponents.h"
+#include "SQLColumnar.h"
+#include "SQLDataSet.h"
+#include "SQLRecord.h"
+#include "SQLQuery.h"
+#include "SQLVariant.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+namespace SQLComponents
+{
+
+#define MICROSECONDS_PER_SECOND 1000000LL
+#define MICROSECONDS_PER_DAY    (86400LL * MICROSECONDS_PER_SECOND)
+
+//////////////////////////////////////////////////////////////////////////
+//
+// TYPES AND CONVERSIONS
+//
+//////////////////////////////////////////////////////////////////////////
+
+void
+ColumnarToUTF8(const XString& p_string,std::string& p_result)
+{
+#ifdef UNICODE
+  const wchar_t* string = p_string.GetString();
+  int            length = p_string.GetLength();
+#else
+  // From the active codepage to UTF-16 first
+  int wlength = ::MultiByteToWideChar(GetACP(),0,p_string.GetString(),p_string.GetLength(),nullptr,0);
+  std::wstring wide((size_t)wlength,0);
+  ::MultiByteToWideChar(GetACP(),0,p_string.GetString(),p_string.GetLength(),&wide[0],wlength);
+  const wchar_t* string = wide.c_str();
+  int            length = wlength;
+#endif
+  int size = ::WideCharToMultiByte(CP_UTF8,0,string,length,nullptr,0,nullptr,nullptr);
+  p_result.resize((size_t)size);
+  if(size > 0)
+  {
+    ::WideCharToMultiByte(CP_UTF8,0,string,length,&p_result[0],size,nullptr,nullptr);
+  }
+}
+
+XString
+ColumnarFromUTF8(const BYTE* p_data,int p_length)
+{
+  XString result;
+  if(p_length <= 0)
+  {
+    return result;
+  }
+  const char* data = reinterpret_cast<const char*>(p_data);
+  int wlength = ::MultiByteToWideChar(CP_UTF8,0,data,p_length,nullptr,0);
+#ifdef UNICODE
+  LPWSTR buffer = result.GetBufferSetLength(wlength);
+  ::MultiByteToWideChar(CP_UTF8,0,data,p_length,buffer,wlength);
+  result.ReleaseBufferSetLength(wlength);
+#else
+  std::wstring wide((size_t)wlength,0);
+  ::MultiByteToWideChar(CP_UTF8,0,data,p_length,&wide[0],wlength);
+  int length = ::WideCharToMultiByte(GetACP(),0,wide.c_str(),wlength,nullptr,0,nullptr,nullptr);
+  LPSTR buffer = result.GetBufferSetLength(length);
+  ::WideCharToMultiByte(GetACP(),0,wide.c_str(),wlength,buffer,length,nullptr,nullptr);
+  result.ReleaseBufferSetLength(length);
+#endif
+  return result;
+}
+
+int
+ColumnarWidth(ColumnarType p_type)
+{
+  switch(p_type)
+  {
+    case COLTYPE_BOOLEAN:   // Fall through
+    case COLTYPE_INT8:      // Fall through
+    case COLTYPE_UINT8:     return 1;
+    case COLTYPE_INT16:     // Fall through
+    case COLTYPE_UINT16:    return 2;
+    case COLTYPE_INT32:     // Fall through
+    case COLTYPE_UINT32:    // Fall through
+    case COLTYPE_FLOAT:     // Fall through
+    case COLTYPE_DATE:      // Fall through
+    case COLTYPE_TIME:      // Fall through
+    case COLTYPE_MONTHS:    return 4;
+    case COLTYPE_INT64:     // Fall through
+    case COLTYPE_UINT64:    // Fall through
+    case COLTYPE_DOUBLE:    // Fall through
+    case COLTYPE_TIMESTAMP: // Fall through
+    case COLTYPE_DURATION:  return 8;
+    case COLTYPE_DECIMAL:   // Fall through
+    case COLTYPE_GUID:      return 16;
+    default:                return 0;
+  }
+}
+
+// Type in the file of a SQL_C_XXX type of a variant
+static ColumnarType
+ColumnarTypeOf(int p_type)
+{
+  switch(p_type)
+  {
+    case SQL_C_CHAR:                      // Fall through
+    case SQL_C_WCHAR:                     return COLTYPE_STRING;
+    case SQL_C_BINARY:                    return COLTYPE_BINARY;
+    case SQL_C_BIT:                       return COLTYPE_BOOLEAN;
+    case SQL_C_TINYINT:                   // Fall through
+    case SQL_C_STINYINT:                  return COLTYPE_INT8;
+    case SQL_C_UTINYINT:                  return COLTYPE_UINT8;
+    case SQL_C_SHORT:                     // Fall through
+    case SQL_C_SSHORT:                    return COLTYPE_INT16;
+    case SQL_C_USHORT:                    return COLTYPE_UINT16;
+    case SQL_C_LONG:                      // Fall through
+    case SQL_C_SLONG:                     return COLTYPE_INT32;
+    case SQL_C_ULONG:                     return COLTYPE_UINT32;
+    case SQL_C_SBIGINT:                   return COLTYPE_INT64;
+    case SQL_C_UBIGINT:                   return COLTYPE_UINT64;
+    case SQL_C_FLOAT:                     return COLTYPE_FLOAT;
+    case SQL_C_DOUBLE:                    return COLTYPE_DOUBLE;
+    case SQL_C_NUMERIC:                   return COLTYPE_DECIMAL;
+    case SQL_C_DATE:                      // Fall through
+    case SQL_C_TYPE_DATE:                 return COLTYPE_DATE;
+    case SQL_C_TIME:                      // Fall through
+    case SQL_C_TYPE_TIME:                 return COLTYPE_TIME;
+    case SQL_C_TIMESTAMP:                 // Fall through
+    case SQL_C_TYPE_TIMESTAMP:            return COLTYPE_TIMESTAMP;
+    case SQL_C_INTERVAL_YEAR:             // Fall through
+    case SQL_C_INTERVAL_MONTH:            // Fall through
+    case SQL_C_INTERVAL_YEAR_TO_MONTH:    return COLTYPE_MONTHS;
+    case SQL_C_INTERVAL_DAY:              // Fall through
+    case SQL_C_INTERVAL_HOUR:             // Fall through
+    case SQL_C_INTERVAL_MINUTE:           // Fall through
+    case SQL_C_INTERVAL_SECOND:           // Fall through
+    case SQL_C_INTERVAL_DAY_TO_HOUR:      // Fall through
+    case SQL_C_INTERVAL_DAY_TO_MINUTE:    // Fall through
+    case SQL_C_INTERVAL_DAY_TO_SECOND:    // Fall through
+    case SQL_C_INTERVAL_HOUR_TO_MINUTE:   // Fall through
+    case SQL_C_INTERVAL_HOUR_TO_SECOND:   // Fall through
+    case SQL_C_INTERVAL_MINUTE_TO_SECOND: return COLTYPE_DURATION;
+    case SQL_C_GUID:                      return COLTYPE_GUID;
+    default:                              return COLTYPE_UNKNOWN;
+  }
+}
+
+// Variant type of a column in a file without our metadata
+static void
+DefaultTypes(ColumnarType p_type,int& p_ctype,int& p_sqltype)
+{
+  switch(p_type)
+  {
+    case COLTYPE_BOOLEAN:   p_ctype = SQL_C_BIT;                    p_sqltype = SQL_BIT;                    break;
+    case COLTYPE_INT8:      p_ctype = SQL_C_STINYINT;               p_sqltype = SQL_TINYINT;                break;
+    case COLTYPE_INT16:     p_ctype = SQL_C_SSHORT;                 p_sqltype = SQL_SMALLINT;               break;
+    case COLTYPE_INT32:     p_ctype = SQL_C_SLONG;                  p_sqltype = SQL_INTEGER;                break;
+    case COLTYPE_INT64:     p_ctype = SQL_C_SBIGINT;                p_sqltype = SQL_BIGINT;                 break;
+    case COLTYPE_UINT8:     p_ctype = SQL_C_UTINYINT;               p_sqltype = SQL_TINYINT;                break;
+    case COLTYPE_UINT16:    p_ctype = SQL_C_USHORT;                 p_sqltype = SQL_SMALLINT;               break;
+    case COLTYPE_UINT32:    p_ctype = SQL_C_ULONG;                  p_sqltype = SQL_INTEGER;                break;
+    case COLTYPE_UINT64:    p_ctype = SQL_C_UBIGINT;                p_sqltype = SQL_BIGINT;                 break;
+    case COLTYPE_FLOAT:     p_ctype = SQL_C_FLOAT;                  p_sqltype = SQL_REAL;                   break;
+    case COLTYPE_DOUBLE:    p_ctype = SQL_C_DOUBLE;                 p_sqltype = SQL_DOUBLE;                 break;
+    case COLTYPE_DECIMAL:   p_ctype = SQL_C_NUMERIC;                p_sqltype = SQL_NUMERIC;                break;
+    case COLTYPE_DATE:      p_ctype = SQL_C_TYPE_DATE;              p_sqltype = SQL_TYPE_DATE;              break;
+    case COLTYPE_TIME:      p_ctype = SQL_C_TYPE_TIME;              p_sqltype = SQL_TYPE_TIME;              break;
+    case COLTYPE_TIMESTAMP: p_ctype = SQL_C_TYPE_TIMESTAMP;         p_sqltype = SQL_TYPE_TIMESTAMP;         break;
+    case COLTYPE_MONTHS:    p_ctype = SQL_C_INTERVAL_YEAR_TO_MONTH; p_sqltype = SQL_INTERVAL_YEAR_TO_MONTH; break;
+    case COLTYPE_DURATION:  p_ctype = SQL_C_INTERVAL_DAY_TO_SECOND; p_sqltype = SQL_INTERVAL_DAY_TO_SECOND; break;
+    case COLTYPE_GUID:      p_ctype = SQL_C_GUID;                   p_sqltype = SQL_GUID;                   break;
+    case COLTYPE_BINARY:    p_ctype = SQL_C_BINARY;                 p_sqltype = SQL_VARBINARY;              break;
+    default:                p_ctype = SQL_C_CHAR;                   p_sqltype = SQL_VARCHAR;                break;
+  }
+}
+
+// Our metadata may refine a plain integer or binary of the file
+static bool
+ColumnarCompatible(ColumnarType p_file,ColumnarType p_variant)
+{
+  return p_file == p_variant
+      || (p_file == COLTYPE_INT32  && p_variant == COLTYPE_MONTHS)
+      || (p_file == COLTYPE_INT64  && p_variant == COLTYPE_DURATION)
+      || (p_file == COLTYPE_BINARY && p_variant == COLTYPE_GUID);
+}
+
+static void
+AppendBytes(std::vector<BYTE>& p_buffer,const void* p_data,size_t p_size)
+{
+  if(p_size)
+  {
+    const BYTE* data = reinterpret_cast<const BYTE*>(p_data);
+    p_buffer.insert(p_buffer.end(),data,data + p_size);
+  }
+}
+
+template<typename T>
+static void
+AppendValue(std::vector<BYTE>& p_buffer,T p_value)
+{
+  AppendBytes(p_buffer,&p_value,sizeof(T));
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static int
+DaysFromCivil(int p_year,unsigned p_month,unsigned p_day)
+{
+  p_year -= p_month <= 2 ? 1 : 0;
+  int      era = (p_year >= 0 ? p_year : p_year - 399) / 400;
+  unsigned yoe = (unsigned)(p_year - era * 400);
+  unsigned doy = (153 * (p_month > 2 ? p_month - 3 : p_month + 9) + 2) / 5 + p_day - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int)doe - 719468;
+}
+
+static void
+CivilFromDays(int p_days,int& p_year,unsigned& p_month,unsigned& p_day)
+{
+  p_days += 719468;
+  int      era = (p_days >= 0 ? p_days : p_days - 146096) / 146097;
+  unsigned doe = (unsigned)(p_days - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp  = (5 * doy + 2) / 153;
+  p_day   = doy - (153 * mp + 2) / 5 + 1;
+  p_month = mp < 10 ? mp + 3 : mp - 9;
+  p_year  = (int)yoe + era * 400 + (p_month <= 2 ? 1 : 0);
+}
+
+// Floor division for negative times before 1970
+static __int64
+FloorDivide(__int64 p_value,__int64 p_divisor,__int64& p_rest)
+{
+  __int64 result = p_value / p_divisor;
+  p_rest = p_value % p_divisor;
+  if(p_rest < 0)
+  {
+    p_rest += p_divisor;
+    --result;
+  }
+  return result;
+}
+
+// A 128 bits decimal as four 32 bits limbs, least significant first
+static bool
+MultiplyLimbs(unsigned p_limbs[4],unsigned p_factor)
+{
+  unsigned __int64 carry = 0;
+  for(int index = 0;index < 4;++index)
+  {
+    carry += (unsigned __int64)p_limbs[index] * p_factor;
+    p_limbs[index] = (unsigned)carry;
+    carry >>= 32;
+  }
+  return carry == 0;
+}
+
+static unsigned
+DivideLimbs(unsigned p_limbs[4],unsigned p_divisor)
+{
+  unsigned __int64 rest = 0;
+  for(int index = 3;index >= 0;--index)
+  {
+    rest = (rest << 32) | p_limbs[index];
+    p_limbs[index] = (unsigned)(rest / p_divisor);
+    rest %= p_divisor;
+  }
+  return (unsigned)rest;
+}
+
+static void
+NegateLimbs(unsigned p_limbs[4])
+{
+  unsigned __int64 carry = 1;
+  for(int index = 0;index < 4;++index)
+  {
+    carry += (unsigned)~p_limbs[index];
+    p_limbs[index] = (unsigned)carry;
+    carry >>= 32;
+  }
+}
+
+// Smaller than 10^38: fits in a decimal(38)
+static bool
+LimbsFitPrecision(const unsigned p_limbs[4])
+{
+  static const unsigned limit[4] = { 0x00000000U,0x098A2240U,0x5A86C47AU,0x4B3B4CA8U };
+  for(int index = 3;index >= 0;--index)
+  {
+    if(p_limbs[index] != limit[index])
+    {
+      return p_limbs[index] < limit[index];
+    }
+  }
+  return false;
+}
+
+// SQL_NUMERIC_STRUCT to the two's complement at the scale of the column
+static bool
+NumericToDecimal(const SQL_NUMERIC_STRUCT* p_numeric,int p_scale,BYTE* p_decimal)
+{
+  unsigned limbs[4];
+  memcpy(limbs,p_numeric->val,sizeof(limbs));
+
+  int  scale = p_numeric->scale;
+  bool round = false;
+  for(;scale < p_scale;++scale)
+  {
+    if(!MultiplyLimbs(limbs,10))
+    {
+      return false;
+    }
+  }
+  for(;scale > p_scale;--scale)
+  {
+    round = DivideLimbs(limbs,10) >= 5;
+  }
+  if(round)
+  {
+    for(int index = 0;index < 4 && ++limbs[index] == 0;++index);
+  }
+  if(!LimbsFitPrecision(limbs))
+  {
+    return false;
+  }
+  if(p_numeric->sign == 0)
+  {
+    NegateLimbs(limbs);
+  }
+  memcpy(p_decimal,limbs,sizeof(limbs));
+  return true;
+}
+
+static void
+DecimalToNumeric(const BYTE* p_decimal,int p_precision,int p_scale,SQL_NUMERIC_STRUCT& p_numeric)
+{
+  unsigned limbs[4];
+  memcpy(limbs,p_decimal,sizeof(limbs));
+
+  memset(&p_numeric,0,sizeof(SQL_NUMERIC_STRUCT));
+  p_numeric.precision = (SQLCHAR) p_precision;
+  p_numeric.scale     = (SQLSCHAR)p_scale;
+  p_numeric.sign      = 1;
+  if(limbs[3] & 0x80000000U)
+  {
+    NegateLimbs(limbs);
+    p_numeric.sign = 0;
+  }
+  memcpy(p_numeric.val,limbs,sizeof(limbs));
+}
+
+// Microseconds of a day-second interval
+static __int64
+IntervalToMicroseconds(const SQL_INTERVAL_STRUCT* p_interval)
+{
+  const SQL_DAY_SECOND_STRUCT& value = p_interval->intval.day_second;
+  __int64 seconds = (((__int64)value.day * 24 + value.hour) * 60 + value.minute) * 60 + value.second;
+  __int64 result  = seconds * MICROSECONDS_PER_SECOND + value.fraction / 1000;
+  return p_interval->interval_sign == SQL_TRUE ? -result : result;
+}
+
+// The leading field of the interval type takes the rest of the value
+static void
+MicrosecondsToInterval(__int64 p_value,SQL_INTERVAL_STRUCT& p_interval)
+{
+  SQL_DAY_SECOND_STRUCT& value = p_interval.intval.day_second;
+  if(p_value < 0)
+  {
+    p_interval.interval_sign = SQL_TRUE;
+    p_value = -p_value;
+  }
+  value.fraction = (SQLUINTEGER)(p_value % MICROSECONDS_PER_SECOND) * 1000;
+  p_value /= MICROSECONDS_PER_SECOND;
+  value.second = (SQLUINTEGER)(p_value % 60);
+  p_value /= 60;
+  value.minute = (SQLUINTEGER)(p_value % 60);
+  p_value /= 60;
+  value.hour   = (SQLUINTEGER)(p_value % 24);
+  value.day    = (SQLUINTEGER)(p_value / 24);
+
+  switch(p_interval.interval_type)
+  {
+    case SQL_IS_HOUR:             // Fall through
+    case SQL_IS_HOUR_TO_MINUTE:   // Fall through
+    case SQL_IS_HOUR_TO_SECOND:   value.hour  += value.day * 24;
+                                  value.day    = 0;
+                                  break;
+    case SQL_IS_MINUTE:           // Fall through
+    case SQL_IS_MINUTE_TO_SECOND: value.minute += (value.day * 24 + value.hour) * 60;
+                                  value.day     = value.hour = 0;
+                                  break;
+    case SQL_IS_SECOND:           value.second += ((value.day * 24 + value.hour) * 60 + value.minute) * 60;
+                                  value.day     = value.hour = value.minute = 0;
+                                  break;
+    default:                      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WRITER
+//
+//////////////////////////////////////////////////////////////////////////
+
+SQLColumnarWriter::SQLColumnarWriter(const SQLColumnarOptions& p_options)
+                  :m_options(p_options)
+{
+  if(m_options.m_rowGroup <= 0)
+  {
+    m_options.m_rowGroup = SQLCOLUMNAR_ROWGROUP;
+  }
+}
+
+// An unclosed file has no footer and will be refused by the readers
+SQLColumnarWriter::~SQLColumnarWriter()
+{
+  if(m_file)
+  {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+bool
+SQLColumnarWriter::Open(XString p_filename)
+{
+  if(m_file)
+  {
+    return false;
+  }
+  if(_tfopen_s(&m_file,p_filename,_T("wb")) || m_file == nullptr)
+  {
+    m_file = nullptr;
+    return false;
+  }
+  WriteHeader();
+  return true;
+}
+
+void
+SQLColumnarWriter::AddColumn(XString p_name,const SQLVariant* p_value)
+{
+  if(m_schemaWritten)
+  {
+    throw StdException(_T("Columnar schema is already written. Cannot add column: ") + p_name);
+  }
+  ColumnarColumn column;
+  column.m_name     = p_name;
+  column.m_type     = p_value->GetDataType();
+  column.m_sqlType  = p_value->GetSQLDataType();
+  column.m_columnar = ColumnarTypeOf(column.m_type);
+  column.m_width    = ColumnarWidth(column.m_columnar);
+  if(column.m_columnar == COLTYPE_UNKNOWN)
+  {
+    throw StdException(_T("Columnar file cannot store the datatype of column: ") + p_name);
+  }
+  if(column.m_columnar == COLTYPE_DECIMAL)
+  {
+    column.m_precision = SQLCOLUMNAR_PRECISION;
+    column.m_scale     = p_value->GetNumericScale();
+    if(column.m_scale < 0 || column.m_scale > SQLCOLUMNAR_PRECISION)
+    {
+      column.m_scale = SQLNUM_DEF_SCALE;
+    }
+  }
+  m_schema.push_back(column);
+
+  ColumnarBuffer buffer;
+  buffer.m_offsets.push_back(0);
+  m_buffers.push_back(buffer);
+}
+
+__int64
+SQLColumnarWriter::WriteDataSet(SQLDataSet& p_set)
+{
+  if(m_schema.empty())
+  {
+    const SQLRecord* first = p_set.GetRecord(0);
+    for(int index = 0;index < p_set.GetNumberOfFields();++index)
+    {
+      if(first)
+      {
+        AddColumn(p_set.GetFieldName(index),first->GetField(index));
+      }
+      else
+      {
+        SQLVariant empty;
+        empty.ReserveSpace(p_set.GetFieldType(index),0);
+        AddColumn(p_set.GetFieldName(index),&empty);
+      }
+    }
+  }
+  int records = p_set.GetNumberOfRecords();
+  for(int index = 0;index < records;++index)
+  {
+    WriteRecord(p_set.GetRecord(index));
+  }
+  return records;
+}
+
+// Only one row group of the query is ever held in memory
+__int64
+SQLColumnarWriter::WriteQuery(SQLQuery& p_query)
+{
+  int columns = p_query.GetNumberOfColumns();
+  if(m_schema.empty())
+  {
+    for(int column = 1;column <= columns;++column)
+    {
+      XString name;
+      p_query.GetColumnName(column,name);
+      AddColumn(name,p_query.GetColumn(column));
+    }
+  }
+  if(columns != (int)m_schema.size())
+  {
+    throw StdException(_T("Columnar schema does not match the columns of the query"));
+  }
+  __int64 rows = 0;
+  while(p_query.GetRecord())
+  {
+    for(int column = 1;column <= columns;++column)
+    {
+      AddValue(column - 1,p_query.GetColumn(column));
+    }
+    EndRow();
+    ++rows;
+  }
+  return rows;
+}
+
+void
+SQLColumnarWriter::WriteRecord(const SQLRecord* p_record)
+{
+  if(m_schema.empty())
+  {
+    throw StdException(_T("Columnar schema must be defined before writing records"));
+  }
+  for(int column = 0;column < (int)m_schema.size();++column)
+  {
+    AddValue(column,p_record->GetField(column));
+  }
+  EndRow();
+}
+
+bool
+SQLColumnarWriter::Close()
+{
+  if(m_file == nullptr)
+  {
+    return false;
+  }
+  FlushRowGroup();
+  WriteFooter();
+
+  bool result = fclose(m_file) == 0;
+  m_file = nullptr;
+  return result;
+}
+
+void
+SQLColumnarWriter::AddValue(int p_column,const SQLVariant* p_value)
+{
+  const ColumnarColumn& column = m_schema[p_column];
+  ColumnarBuffer&       buffer = m_buffers[p_column];
+
+  bool isnull = p_value == nullptr || p_value->IsNULL();
+  buffer.m_valid.push_back(isnull ? 0 : 1);
+
+  if(column.m_width == 0)
+  {
+    if(!isnull)
+    {
+      if(column.m_columnar == COLTYPE_BINARY && p_value->GetDataType() == SQL_C_BINARY)
+      {
+        AppendBytes(buffer.m_data,p_value->GetDataPointer(),(size_t)p_value->GetDataSize());
+      }
+      else
+      {
+        std::string utf8;
+        ColumnarToUTF8(p_value->GetAsString(),utf8);
+        AppendBytes(buffer.m_data,utf8.data(),utf8.size());
+      }
+      if(buffer.m_data.size() > INT_MAX)
+      {
+        throw StdException(_T("Columnar row group too large for column: ") + column.m_name);
+      }
+    }
+    buffer.m_offsets.push_back((int)buffer.m_data.size());
+    return;
+  }
+  if(isnull)
+  {
+    // NULL slots are zero filled, just like Arrow does
+    buffer.m_data.resize(buffer.m_data.size() + column.m_width,0);
+    return;
+  }
+  switch(column.m_columnar)
+  {
+    case COLTYPE_BOOLEAN:   AppendValue<BYTE>            (buffer.m_data,p_value->GetAsBit() ? 1 : 0); break;
+    case COLTYPE_INT8:      AppendValue<char>            (buffer.m_data,p_value->GetAsSTinyInt());    break;
+    case COLTYPE_INT16:     AppendValue<short>           (buffer.m_data,p_value->GetAsSShort());      break;
+    case COLTYPE_INT32:     AppendValue<int>             (buffer.m_data,p_value->GetAsSLong());       break;
+    case COLTYPE_INT64:     AppendValue<__int64>         (buffer.m_data,p_value->GetAsSBigInt());     break;
+    case COLTYPE_UINT8:     AppendValue<unsigned char>   (buffer.m_data,p_value->GetAsUTinyInt());    break;
+    case COLTYPE_UINT16:    AppendValue<unsigned short>  (buffer.m_data,p_value->GetAsUShort());      break;
+    case COLTYPE_UINT32:    AppendValue<unsigned int>    (buffer.m_data,p_value->GetAsULong());       break;
+    case COLTYPE_UINT64:    AppendValue<unsigned __int64>(buffer.m_data,p_value->GetAsUBigInt());     break;
+    case COLTYPE_FLOAT:     AppendValue<float>           (buffer.m_data,p_value->GetAsFloat());       break;
+    case COLTYPE_DOUBLE:    AppendValue<double>          (buffer.m_data,p_value->GetAsDouble());      break;
+    case COLTYPE_DECIMAL:   {
+                              SQL_NUMERIC_STRUCT numeric;
+                              if(p_value->GetDataType() == SQL_C_NUMERIC)
+                              {
+                                numeric = *p_value->GetAsNumeric();
+                              }
+                              else
+                              {
+                                p_value->GetAsBCD().AsNumeric(&numeric);
+                              }
+                              BYTE decimal[16];
+                              if(!NumericToDecimal(&numeric,column.m_scale,decimal))
+                              {
+                                throw StdException(_T("Columnar file: NUMERIC value too large for column: ") + column.m_name);
+                              }
+                              AppendBytes(buffer.m_data,decimal,sizeof(decimal));
+                            }
+                            break;
+    case COLTYPE_DATE:      {
+                              const DATE_STRUCT* date = p_value->GetAsDate();
+                              AppendValue<int>(buffer.m_data,DaysFromCivil(date->year,date->month,date->day));
+                            }
+                            break;
+    case COLTYPE_TIME:      {
+                              const TIME_STRUCT* time = p_value->GetAsTime();
+                              AppendValue<int>(buffer.m_data,((time->hour * 60 + time->minute) * 60 + time->second) * 1000);
+                            }
+                            break;
+    case COLTYPE_TIMESTAMP: {
+                              const TIMESTAMP_STRUCT* stamp = p_value->GetAsTimestamp();
+                              __int64 days    = DaysFromCivil(stamp->year,stamp->month,stamp->day);
+                              __int64 seconds = (stamp->hour * 60 + stamp->minute) * 60 + stamp->second;
+                              AppendValue<__int64>(buffer.m_data,days * MICROSECONDS_PER_DAY + seconds * MICROSECONDS_PER_SECOND + stamp->fraction / 1000);
+                            }
+                            break;
+    case COLTYPE_MONTHS:    {
+                              const SQL_INTERVAL_STRUCT* interval = p_value->GetAsInterval();
+                              int months = (int)(interval->intval.year_month.year * 12 + interval->intval.year_month.month);
+                              AppendValue<int>(buffer.m_data,interval->interval_sign == SQL_TRUE ? -months : months);
+                            }
+                            break;
+    case COLTYPE_DURATION:  AppendValue<__int64>(buffer.m_data,IntervalToMicroseconds(p_value->GetAsInterval()));
+                            break;
+    case COLTYPE_GUID:      {
+                              // RFC 4122 order: the first three fields are big-endian
+                              const SQLGUID* guid = p_value->GetAsGUID();
+                              BYTE rfc[16] = { (BYTE)(guid->Data1 >> 24),(BYTE)(guid->Data1 >> 16),(BYTE)(guid->Data1 >> 8),(BYTE)guid->Data1
+                                              ,(BYTE)(guid->Data2 >> 8), (BYTE)guid->Data2
+                                              ,(BYTE)(guid->Data3 >> 8), (BYTE)guid->Data3 };
+                              memcpy(&rfc[8],guid->Data4,8);
+                              AppendBytes(buffer.m_data,rfc,sizeof(rfc));
+                            }
+                            break;
+    default:                throw StdException(_T("Columnar file cannot store the datatype of column: ") + column.m_name);
+  }
+}
+
+void
+SQLColumnarWriter::EndRow()
+{
+  ++m_rows;
+  if(++m_groupRows >= (unsigned)m_options.m_rowGroup)
+  {
+    FlushRowGroup();
+  }
+}
+
+void
+SQLColumnarWriter::FlushRowGroup()
+{
+  if(!m_schemaWritten)
+  {
+    // The first row group may decide on the encoding of the columns
+    WriteSchema(m_groupRows);
+    m_schemaWritten = true;
+  }
+  if(m_groupRows == 0)
+  {
+    return;
+  }
+  WriteRowGroup(m_groupRows);
+
+  // Ready for the next row group
+  for(auto& buffer : m_buffers)
+  {
+    buffer.m_valid.clear();
+    buffer.m_data.clear();
+    buffer.m_offsets.assign(1,0);
+  }
+  m_groupRows = 0;
+}
+
+// "ctype,sqltype;ctype,sqltype;..." in the order of the columns
+std::string
+SQLColumnarWriter::GetTypesMetadata()
+{
+  std::string types;
+  for(const auto& column : m_schema)
+  {
+    if(!types.empty())
+    {
+      types += ';';
+    }
+    types += std::to_string(column.m_type) + ',' + std::to_string(column.m_sqlType);
+  }
+  return types;
+}
+
+void
+SQLColumnarWriter::WriteBytes(const void* p_data,size_t p_size)
+{
+  if(m_file == nullptr)
+  {
+    throw StdException(_T("Columnar file is not open for writing"));
+  }
+  if(p_size && fwrite(p_data,1,p_size,m_file) != p_size)
+  {
+    throw StdException(_T("Cannot write to the columnar file"));
+  }
+  m_bytes += p_size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// READER
+//
+//////////////////////////////////////////////////////////////////////////
+
+SQLColumnarReader::SQLColumnarReader()
+{
+}
+
+SQLColumnarReader::~SQLColumnarReader()
+{
+  Close();
+}
+
+bool
+SQLColumnarReader::Open(XString p_filename)
+{
+  if(m_file)
+  {
+    return false;
+  }
+  if(_tfopen_s(&m_file,p_filename,_T("rb")) || m_file == nullptr)
+  {
+    m_file = nullptr;
+    return false;
+  }
+  m_schema.clear();
+  if(!ReadHeader())
+  {
+    Close();
+    return false;
+  }
+  m_buffers.resize(m_schema.size());
+  return true;
+}
+
+void
+SQLColumnarReader::Close()
+{
+  if(m_file)
+  {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+  m_buffers.clear();
+}
+
+// Records are added to the dataset. An empty dataset gets the columns of the file
+__int64
+SQLColumnarReader::ReadDataSet(SQLDataSet& p_set)
+{
+  bool define = p_set.GetNumberOfFields() == 0;
+  if(!define && p_set.GetNumberOfFields() != (int)m_schema.size())
+  {
+    throw StdException(_T("Columnar file does not match the fields of the dataset"));
+  }
+  __int64  total = 0;
+  unsigned rows  = 0;
+
+  while(ReadRowGroup(rows))
+  {
+    for(unsigned row = 0;row < rows;++row)
+    {
+      SQLRecord* record = p_set.InsertRecord();
+      for(int column = 0;column < (int)m_schema.size();++column)
+      {
+        SQLVariant value;
+        MakeVariant(column,row,value);
+        if(define)
+        {
+          p_set.InsertField(m_schema[column].m_name,&value);
+        }
+        else
+        {
+          record->AddField(&value,true);
+        }
+      }
+      define = false;
+    }
+    total += rows;
+  }
+  return total;
+}
+
+void
+SQLColumnarReader::AddColumn(const XString& p_name,ColumnarType p_type,int p_precision /*= 0*/,int p_scale /*= 0*/)
+{
+  ColumnarColumn column;
+  column.m_name      = p_name;
+  column.m_columnar  = p_type;
+  column.m_width     = ColumnarWidth(p_type);
+  column.m_precision = p_precision;
+  column.m_scale     = p_scale;
+  DefaultTypes(p_type,column.m_type,column.m_sqlType);
+  m_schema.push_back(column);
+}
+
+// Only applied if every column can hold the type of our metadata
+void
+SQLColumnarReader::SetTypesMetadata(const std::string& p_types)
+{
+  std::vector<std::pair<int,int>> types;
+  size_t position = 0;
+  while(position < p_types.size())
+  {
+    size_t end = p_types.find(';',position);
+    if(end == std::string::npos)
+    {
+      end = p_types.size();
+    }
+    std::string type = p_types.substr(position,end - position);
+    size_t comma = type.find(',');
+    if(comma == std::string::npos)
+    {
+      return;
+    }
+    types.push_back(std::make_pair(atoi(type.c_str()),atoi(type.c_str() + comma + 1)));
+    position = end + 1;
+  }
+  if(types.size() != m_schema.size())
+  {
+    return;
+  }
+  for(size_t index = 0;index < types.size();++index)
+  {
+    if(!ColumnarCompatible(m_schema[index].m_columnar,ColumnarTypeOf(types[index].first)))
+    {
+      return;
+    }
+  }
+  for(size_t index = 0;index < types.size();++index)
+  {
+    ColumnarColumn& column = m_schema[index];
+    column.m_columnar = ColumnarTypeOf(types[index].first);
+    column.m_width    = ColumnarWidth(column.m_columnar);
+    column.m_type     = types[index].first;
+    column.m_sqlType  = types[index].second;
+  }
+}
+
+void
+SQLColumnarReader::MakeVariant(int p_column,unsigned p_row,SQLVariant& p_value)
+{
+  const ColumnarColumn& column = m_schema[p_column];
+  const ColumnarBuffer& buffer = m_buffers[p_column];
+
+  if(!buffer.m_valid[p_row])
+  {
+    p_value.ReserveSpace(column.m_type,0);
+    p_value.SetSQLDataType(column.m_sqlType);
+    p_value.SetNULL();
+    return;
+  }
+  if(column.m_width == 0)
+  {
+    int begin  = buffer.m_offsets[p_row];
+    int length = buffer.m_offsets[(size_t)p_row + 1] - begin;
+    if(begin < 0 || length < 0 || (size_t)begin + length > buffer.m_data.size())
+    {
+      throw StdException(_T("Columnar file is corrupt: value of column: ") + column.m_name);
+    }
+    const BYTE* data = buffer.m_data.data() + begin;
+    if(column.m_type == SQL_C_BINARY)
+    {
+      p_value.SetFromBinaryStreamData(SQL_C_BINARY,length,(void*)data,false);
+    }
+    else
+    {
+      p_value.Set(ColumnarFromUTF8(data,length),column.m_type == SQL_C_WCHAR);
+    }
+    p_value.SetSQLDataType(column.m_sqlType);
+    return;
+  }
+
+  // Rebuild the ODBC structure of the variant type
+  const BYTE* value = buffer.m_data.data() + (size_t)p_row * column.m_width;
+  const void* data  = value;
+  SQL_NUMERIC_STRUCT  numeric;
+  DATE_STRUCT         date;
+  TIME_STRUCT         time;
+  TIMESTAMP_STRUCT    stamp;
+  SQL_INTERVAL_STRUCT interval;
+  SQLGUID             guid;
+
+  switch(column.m_columnar)
+  {
+    case COLTYPE_DECIMAL:   DecimalToNumeric(value,column.m_precision,column.m_scale,numeric);
+                            data = &numeric;
+                            break;
+    case COLTYPE_DATE:      {
+                              int      year  = 0;
+                              unsigned month = 0;
+                              unsigned day   = 0;
+                              CivilFromDays(*reinterpret_cast<const int*>(value),year,month,day);
+                              date.year  = (SQLSMALLINT) year;
+                              date.month = (SQLUSMALLINT)month;
+                              date.day   = (SQLUSMALLINT)day;
+                              data = &date;
+                            }
+                            break;
+    case COLTYPE_TIME:      {
+                              int seconds = *reinterpret_cast<const int*>(value) / 1000;
+                              time.hour   = (SQLUSMALLINT)(seconds / 3600);
+                              time.minute = (SQLUSMALLINT)(seconds / 60 % 60);
+                              time.second = (SQLUSMALLINT)(seconds % 60);
+                              data = &time;
+                            }
+                            break;
+    case COLTYPE_TIMESTAMP: {
+                              __int64  micros = 0;
+                              __int64  days   = FloorDivide(*reinterpret_cast<const __int64*>(value),MICROSECONDS_PER_DAY,micros);
+                              int      year   = 0;
+                              unsigned month  = 0;
+                              unsigned day    = 0;
+                              CivilFromDays((int)days,year,month,day);
+                              __int64 seconds = micros / MICROSECONDS_PER_SECOND;
+                              stamp.year     = (SQLSMALLINT) year;
+                              stamp.month    = (SQLUSMALLINT)month;
+                              stamp.day      = (SQLUSMALLINT)day;
+                              stamp.hour     = (SQLUSMALLINT)(seconds / 3600);
+                              stamp.minute   = (SQLUSMALLINT)(seconds / 60 % 60);
+                              stamp.second   = (SQLUSMALLINT)(seconds % 60);
+                              stamp.fraction = (SQLUINTEGER)(micros % MICROSECONDS_PER_SECOND) * 1000;
+                              data = &stamp;
+                            }
+                            break;
+    case COLTYPE_MONTHS:    {
+                              int months = *reinterpret_cast<const int*>(value);
+                              memset(&interval,0,sizeof(SQL_INTERVAL_STRUCT));
+                              interval.interval_type = (SQLINTERVAL)(column.m_type - SQL_C_INTERVAL_YEAR + SQL_IS_YEAR);
+                              if(months < 0)
+                              {
+                                interval.interval_sign = SQL_TRUE;
+                                months = -months;
+                              }
+                              if(interval.interval_type == SQL_IS_MONTH)
+                              {
+                                interval.intval.year_month.month = months;
+                              }
+                              else
+                              {
+                                interval.intval.year_month.year  = months / 12;
+                                interval.intval.year_month.month = months % 12;
+                              }
+                              data = &interval;
+                            }
+                            break;
+    case COLTYPE_DURATION:  memset(&interval,0,sizeof(SQL_INTERVAL_STRUCT));
+                            interval.interval_type = (SQLINTERVAL)(column.m_type - SQL_C_INTERVAL_YEAR + SQL_IS_YEAR);
+                            MicrosecondsToInterval(*reinterpret_cast<const __int64*>(value),interval);
+                            data = &interval;
+                            break;
+    case COLTYPE_GUID:      guid.Data1 = ((DWORD)value[0] << 24) | ((DWORD)value[1] << 16) | ((DWORD)value[2] << 8) | value[3];
+                            guid.Data2 = (WORD)((value[4] << 8) | value[5]);
+                            guid.Data3 = (WORD)((value[6] << 8) | value[7]);
+                            memcpy(guid.Data4,&value[8],8);
+                            data = &guid;
+                            break;
+    default:                // Integers, floats and booleans are stored as the variant stores them
+                            break;
+  }
+  p_value.ReserveSpace(column.m_type,0);
+  p_value.SetFromRawDataPointer(const_cast<void*>(data),column.m_width);
+  p_value.SetSQLDataType(column.m_sqlType);
+  if(column.m_type == SQL_C_NUMERIC)
+  {
+    p_value.SetNumericPrecisionScale(column.m_precision,column.m_scale);
+  }
+}
+
+void
+SQLColumnarReader::ReadBytes(void* p_data,size_t p_size)
+{
+  if(m_file == nullptr)
+  {
+    throw StdException(_T("Columnar file is not open for reading"));
+  }
+  if(p_size && fread(p_data,1,p_size,m_file) != p_size)
+  {
+    throw StdException(_T("Columnar file is corrupt: unexpected end of file"));
+  }
+}
+
+void
+SQLColumnarReader::SeekFile(__int64 p_position)
+{
+  if(m_file == nullptr || p_position < 0 || _fseeki64(m_file,p_position,SEEK_SET) != 0)
+  {
+    throw StdException(_T("Columnar file is corrupt: cannot seek in the file"));
+  }
+}
+
+__int64
+SQLColumnarReader::GetFilePosition()
+{
+  if(m_file == nullptr)
+  {
+    throw StdException(_T("Columnar file is not open for reading"));
+  }
+  return _ftelli64(m_file);
+}
+
+__int64
+SQLColumnarReader::GetFileSize()
+{
+  __int64 position = GetFilePosition();
+  if(_fseeki64(m_file,0,SEEK_END) != 0)
+  {
+    throw StdException(_T("Columnar file cannot be read"));
+  }
+  __int64 size = _ftelli64(m_file);
+  SeekFile(position);
+  return size;
+}
+
+}
@@ -0,0 +1,230 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLColumnar.h
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#pragma once
+#include "SQLComponents.h"
+#include <XString.h>
+#include <string>
+#include <vector>
+
+namespace SQLComponents
+{
+
+// Columnar export and import of result sets
+//
+// The base classes of the Apache Arrow IPC files (SQLArrow.h) and the
+// Apache Parquet files (SQLParquet.h). Rows are cut into row groups (Arrow:
+// record batches) and only one group is held in memory, so a SQLQuery can be
+// streamed into a file without building a SQLDataSet first.
+// The values of a group are collected per column in a layout that both formats
+// share: a validity byte per row, and fixed width little-endian values or
+// offsets plus data. The format classes do the bitmaps, the dictionaries,
+// the compression and the metadata.
+//
+// Datatypes of the SQLVariant in the files:
+//   CHAR, WCHAR              -> UTF-8 string
+//   BINARY                   -> binary
+//   BIT                      -> boolean
+//   TINYINT .. BIGINT        -> (unsigned) integer of the same width
+//   FLOAT, DOUBLE            -> float, double
+//   NUMERIC (bcd)            -> decimal(38,scale of the first value)
+//   DATE                     -> date (days)
+//   TIME                     -> time (milliseconds)
+//   TIMESTAMP                -> timestamp (microseconds, no timezone)
+//   INTERVAL YEAR .. MONTH   -> months      (Arrow: interval year-month, Parquet: int32)
+//   INTERVAL DAY .. SECOND   -> microseconds (Arrow: duration,           Parquet: int64)
+//   GUID                     -> 16 bytes in RFC 4122 order (Arrow: fixed size binary, Parquet: UUID)
+// Timestamps and intervals keep microseconds. The exact SQL_C_XXX and SQL_XXX
+// types of the columns are stored in the key/value metadata of the file, so
+// the variants read back as they were written. Files of other tools read with
+// the default variant type of each column.
+
+#define SQLCOLUMNAR_ROWGROUP    65536   // Default number of rows in a row group
+#define SQLCOLUMNAR_DICTIONARY  32768   // Default maximum of values in a dictionary
+#define SQLCOLUMNAR_PRECISION   38      // Precision of all decimal columns
+#define SQLCOLUMNAR_METADATA    "SQLComponents.types"
+
+// Logical type of a column in the files
+typedef enum _columnarType
+{
+  COLTYPE_UNKNOWN   = 0
+ ,COLTYPE_BOOLEAN           // 1 byte: 0 or 1
+ ,COLTYPE_INT8
+ ,COLTYPE_INT16
+ ,COLTYPE_INT32
+ ,COLTYPE_INT64
+ ,COLTYPE_UINT8
+ ,COLTYPE_UINT16
+ ,COLTYPE_UINT32
+ ,COLTYPE_UINT64
+ ,COLTYPE_FLOAT
+ ,COLTYPE_DOUBLE
+ ,COLTYPE_DECIMAL           // 16 bytes two's complement of the unscaled value
+ ,COLTYPE_DATE              // int32 days since 1970-01-01
+ ,COLTYPE_TIME              // int32 milliseconds since midnight
+ ,COLTYPE_TIMESTAMP         // int64 microseconds since 1970-01-01
+ ,COLTYPE_MONTHS            // int32 months of a year-month interval
+ ,COLTYPE_DURATION          // int64 microseconds of a day-second interval
+ ,COLTYPE_GUID              // 16 bytes in RFC 4122 order
+ ,COLTYPE_STRING            // Variable length UTF-8
+ ,COLTYPE_BINARY            // Variable length bytes
+}
+ColumnarType;
+
+class SQLDataSet;
+class SQLRecord;
+class SQLQuery;
+class SQLVariant;
+
+// Options for writing a columnar file
+class SQLColumnarOptions
+{
+public:
+  int   m_rowGroup      { SQLCOLUMNAR_ROWGROUP   };  // Rows per row group
+  bool  m_compress      { true };                    // Arrow: LZ4 frames, Parquet: GZIP pages
+  bool  m_dictionary    { true };                    // Dictionary encode string columns
+  int   m_dictionaryMax { SQLCOLUMNAR_DICTIONARY };  // Upper limit of a dictionary
+};
+
+// One column of the schema
+typedef struct _columnarColumn
+{
+  XString      m_name;                          // Name of the column
+  ColumnarType m_columnar  { COLTYPE_UNKNOWN }; // Type in the file
+  int          m_type      { 0 };               // SQL_C_XXX type of the variant
+  int          m_sqlType   { 0 };               // SQL_XXX type of the database
+  int          m_precision { 0 };               // DECIMAL precision
+  int          m_scale     { 0 };               // DECIMAL scale
+  int          m_width     { 0 };               // Width of the values. 0 = variable length
+}
+ColumnarColumn;
+
+// Values of one column in the current row group
+typedef struct _columnarBuffer
+{
+  std::vector<BYTE> m_valid;      // One byte per row: 1 = value, 0 = NULL
+  std::vector<BYTE> m_data;       // Fixed width values (NULL = zeros) or variable length data
+  std::vector<int>  m_offsets;    // Start offsets of variable length values (rows + 1)
+}
+ColumnarBuffer;
+
+using ColumnarSchema  = std::vector<ColumnarColumn>;
+using ColumnarBuffers = std::vector<ColumnarBuffer>;
+
+// All names and strings in the files are UTF-8
+void    ColumnarToUTF8(const XString& p_string,std::string& p_result);
+XString ColumnarFromUTF8(const BYTE* p_data,int p_length);
+// Width of the values of a type in the buffers (0 = variable length)
+int     ColumnarWidth(ColumnarType p_type);
+
+class SQLColumnarWriter
+{
+public:
+  explicit SQLColumnarWriter(const SQLColumnarOptions& p_options);
+  virtual ~SQLColumnarWriter();
+
+  // Create the file
+  bool    Open(XString p_filename);
+  // Write all records of a dataset
+  __int64 WriteDataSet(SQLDataSet& p_set);
+  // Stream all (remaining) records of an executed query, one row group in memory at a time
+  __int64 WriteQuery(SQLQuery& p_query);
+  // Write one record. The first record (or AddColumn) defines the schema
+  void    WriteRecord(const SQLRecord* p_record);
+  // Explicitly define the next column of the schema
+  void    AddColumn(XString p_name,const SQLVariant* p_value);
+  // Flush the last row group and close the file
+  bool    Close();
+
+  // GETTERS
+  __int64 GetRows()  { return m_rows;  }
+  __int64 GetBytes() { return m_bytes; }
+
+protected:
+  // Parts of the file format
+  virtual void WriteHeader() = 0;                   // Directly after opening the file
+  virtual void WriteSchema(unsigned p_rows) = 0;    // Once, before the first row group
+  virtual void WriteRowGroup(unsigned p_rows) = 0;  // The buffers hold 'p_rows' rows
+  virtual void WriteFooter() = 0;                   // Before closing the file
+
+  void    WriteBytes(const void* p_data,size_t p_size);
+  // Our metadata with the exact SQL types of the columns
+  std::string GetTypesMetadata();
+
+  SQLColumnarOptions m_options;
+  ColumnarSchema     m_schema;              // Columns of the file
+  ColumnarBuffers    m_buffers;             // Row group being built
+  __int64            m_rows      { 0 };     // Total rows written
+  __int64            m_bytes     { 0 };     // Total bytes written: the position in the file
+
+private:
+  void    AddValue(int p_column,const SQLVariant* p_value);
+  void    EndRow();
+  void    FlushRowGroup();
+
+  FILE*    m_file          { nullptr };
+  bool     m_schemaWritten { false };
+  unsigned m_groupRows     { 0 };           // Rows in the current row group
+};
+
+class SQLColumnarReader
+{
+public:
+  SQLColumnarReader();
+  virtual ~SQLColumnarReader();
+
+  // Open the file and read the schema. False if the file is not of this format
+  bool    Open(XString p_filename);
+  // Append all rows of the file to a dataset
+  __int64 ReadDataSet(SQLDataSet& p_set);
+  // Close the file
+  void    Close();
+
+  // GETTERS
+  const ColumnarSchema& GetSchema() { return m_schema; }
+
+protected:
+  // Parts of the file format
+  virtual bool ReadHeader() = 0;                    // Read the schema. False if not our format
+  virtual bool ReadRowGroup(unsigned& p_rows) = 0;  // Decode the next group into the buffers
+
+  void    ReadBytes(void* p_data,size_t p_size);
+  void    SeekFile(__int64 p_position);
+  __int64 GetFilePosition();
+  __int64 GetFileSize();
+  // Define a column of a type in the file, with the default variant type
+  void    AddColumn(const XString& p_name,ColumnarType p_type,int p_precision = 0,int p_scale = 0);
+  // Apply our metadata with the exact SQL types of the columns
+  void    SetTypesMetadata(const std::string& p_types);
+
+  ColumnarSchema  m_schema;               // Columns of the file
+  ColumnarBuffers m_buffers;              // Decoded row group
+
+private:
+  void    MakeVariant(int p_column,unsigned p_row,SQLVariant& p_value);
+
+  FILE*   m_file { nullptr };
+};
+
+}
@@ -103,7 +103,8 @@ SQLConnections::AddConnection(XString p_name
                              ,XString p_datasource
                              ,XString p_username
                              ,XString p_password
-                             ,XString p_options)
+                             ,XString p_options
+                             ,XString p_replicaOf /*= ""*/)
 {
   // See if it is a double registration
   const SQLConnection* fnd = GetConnection(p_name);
@@ -119,6 +120,7 @@ SQLConnections::AddConnection(XString p_name
   connect.m_username   = p_username;
   connect.m_password   = p_password;
   connect.m_options    = p_options;
+  connect.m_replicaOf  = p_replicaOf;
 
   // Keep this connection
   p_name.MakeLower();
@@ -174,6 +176,7 @@ SQLConnections::LoadConnectionsFile(XString p_filename /*=""*/,bool p_reset /*=f
     connect.m_username   = msg.GetElement(conn,_T("User"));
     connect.m_options    = msg.GetElement(conn,_T("Options"));
     connect.m_password   = PasswordDecoding(msg.GetElement(conn,_T("Password")));
+    connect.m_replicaOf  = msg.GetElement(conn,_T("ReplicaOf"));
 
     XString name(connect.m_name);
     name.MakeLower();
@@ -211,6 +214,10 @@ SQLConnections::SaveConnectionsFile(XString p_filename /*=""*/)
     msg.AddElement(conn,_T("User"),     XDT_String,connect.second.m_username);
     msg.AddElement(conn,_T("Options"),  XDT_String,connect.second.m_options);
     msg.AddElement(conn,_T("Password"), XDT_String,PasswordScramble(connect.second.m_password));
+    if(!connect.second.m_replicaOf.IsEmpty())
+    {
+      msg.AddElement(conn,_T("ReplicaOf"),XDT_String,connect.second.m_replicaOf);
+    }
   }
 
   // Save the file
@@ -223,6 +230,22 @@ SQLConnections::GetConnectionsCount()
   return (int)m_connections.size();
 }
 
+// Names of all read replicas of a primary connection
+// A replica has the "<ReplicaOf>primary</ReplicaOf>" in "database.xml"
+ConnList
+SQLConnections::GetReplicas(XString p_primary)
+{
+  ConnList replicas;
+  for(auto& connect : m_connections)
+  {
+    if(!connect.second.m_replicaOf.IsEmpty() && connect.second.m_replicaOf.CompareNoCase(p_primary) == 0)
+    {
+      replicas.push_back(connect.first);
+    }
+  }
+  return replicas;
+}
+
 void
 SQLConnections::SetEncryptionKey(XString p_key)
 {
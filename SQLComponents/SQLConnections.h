@@ -25,6 +25,7 @@
 //
 #pragma once
 #include <map>
+#include <vector>
 
 namespace SQLComponents
 {
@@ -36,10 +37,12 @@ typedef struct _connection
   XString m_username;
   XString m_password;
   XString m_options;
+  XString m_replicaOf;    // Read replica of this primary connection (if any)
 }
 SQLConnection;
 
-using ConnMap = std::map<XString,SQLConnection>;
+using ConnMap  = std::map<XString,SQLConnection>;
+using ConnList = std::vector<XString>;
 
 #define DEFAULT_ENCRYPTION_KEY _T("S~Q!L@C#$n%ne^&c*t(i)o<n>s/")
 
@@ -57,11 +60,13 @@ public:
   SQLConnection*  GetConnection(unsigned p_number);
   XString         GetConnectionString(XString p_name);
   int             GetConnectionsCount();
+  // Names of all read replicas of a primary connection
+  ConnList        GetReplicas(XString p_primary);
 
   // SETTERS
   void        Reset();
   void        SetEncryptionKey(XString p_key);
-  bool        AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options);
+  bool        AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options,XString p_replicaOf = _T(""));
   bool        DelConnection(XString p_name);
 
 private:
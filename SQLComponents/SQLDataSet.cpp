@@ -30,6 +30,10 @@
 #include "SQLQuery.h"
 #include "SQLVariantFormat.h"
 #include "SQLInfoDB.h"
+#include "SQLStatementCache.h"
+#include "SQLArrow.h"
+#include "SQLParquet.h"
+#include "SQLTimestamp.h"
 #include <algorithm>
 
 #ifdef _DEBUG
@@ -194,6 +198,7 @@ SQLDataSet::Close()
   // Forget the query
   m_name.Empty();
   m_query.Empty();
+  m_statementCache = nullptr;
   m_selection.Empty();
   m_fromTables.Empty();
   m_primaryTableName.Empty();
@@ -403,11 +408,21 @@ SQLDataSet::SetQuery(XString& p_query)
   m_orderby.Empty();
   m_filters = nullptr;
   m_havings = nullptr;
+  m_statementCache = nullptr;
 
   // Setting the query at once
   m_query = p_query;
 }
 
+// Use a cache of rendered SELECT statements for this query
+// The caller guarantees that the key uniquely identifies the query text
+void
+SQLDataSet::SetStatementCache(SQLStatementCache* p_cache,XString p_key)
+{
+  m_statementCache = p_cache;
+  m_statementKey   = p_key;
+}
+
 void
 SQLDataSet::SetSelection(XString p_selection)
 {
@@ -606,11 +621,60 @@ SQLDataSet::ParseFilters(SQLQuery& p_query,XString p_sql)
   return query;
 }
 
+// Getting the shape key for the statement cache
+// Only full queries without $parameters and HAVING filters are cached
+bool
+SQLDataSet::GetStatementKey(XString& p_key)
+{
+  if(m_statementCache == nullptr || m_query.IsEmpty() || !m_parameters.empty())
+  {
+    return false;
+  }
+  if(m_havings && !m_havings->Empty())
+  {
+    return false;
+  }
+  p_key = m_statementKey + _T("\n");
+  if(m_filters && !m_filters->Empty())
+  {
+    if(!m_filters->GetShapeSignature(p_key))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    p_key += m_whereCondition;
+  }
+  p_key += _T("\n") + m_groupby + _T("\n") + m_orderby;
+  if(m_lockForUpdate)
+  {
+    p_key.AppendFormat(_T("\nLOCK:%u"),m_lockWaitTime);
+  }
+  return true;
+}
+
 // Construct the selection SQL for opening the dataset
 // Getting the total query in effect
 XString
 SQLDataSet::GetSelectionSQL(SQLQuery& p_qry)
 {
+  // See if we rendered a statement of this shape before
+  // If so: only the values of the filters must be bound
+  XString key;
+  if(GetStatementKey(key))
+  {
+    XString cached;
+    if(m_statementCache->FindStatement(key,cached))
+    {
+      if(m_filters && !m_filters->Empty())
+      {
+        m_filters->BindParameters(p_qry);
+      }
+      return cached;
+    }
+  }
+
   XString sql(m_query);
 
   // If parameters, parse them
@@ -666,6 +730,11 @@ SQLDataSet::GetSelectionSQL(SQLQuery& p_qry)
     sql = m_database->GetSQLInfoDB()->GetSelectForUpdateTrailer(sql,m_lockWaitTime);
   }
 
+  // Remember for the next selection of the same shape
+  if(!key.IsEmpty())
+  {
+    m_statementCache->StoreStatement(key,sql);
+  }
   return sql;
 }
 
@@ -1227,6 +1296,27 @@ SQLDataSet::FindObjectRecord(const VariantSet& p_primary)
   return nullptr;
 }
 
+// Inserted records are not in the object index: search all records
+// The most recent records are searched first
+SQLRecord*
+SQLDataSet::SearchObjectRecord(const VariantSet& p_primary)
+{
+  if(!GetPrimaryKeyInfo() || !CheckPrimaryKeyColumns())
+  {
+    return nullptr;
+  }
+  XString key = MakePrimaryKey(p_primary);
+
+  for(RecordSet::reverse_iterator it = m_records.rbegin();it != m_records.rend();++it)
+  {
+    if(MakePrimaryKey(*it) == key)
+    {
+      return *it;
+    }
+  }
+  return nullptr;
+}
+
 // Finding an object through a filter set
 // Finds the first object. In case of an unique record, it will be the only one
 SQLRecord*
@@ -1500,6 +1590,7 @@ SQLDataSet::Synchronize(int p_mutationID /*=0*/,bool p_throw /*=false*/)
 
   // Save status before a possible throw
   int oldStatus = m_status;
+  m_versionConflict = false;
 
   try
   {
@@ -1620,6 +1711,7 @@ SQLDataSet::Deletes(int p_mutationID)
         case MUT_NoMutation: // Fall through: Remove record
         case MUT_MyMutation: sql = GetSQLDelete(&query,record);
                              query.DoSQLStatement(sql);
+                             CheckVersionConflict(query);
                              // Delete this record, continuing to the next
 //                              delete record;
 //                              it = m_records.erase(it);
@@ -1675,6 +1767,12 @@ SQLDataSet::Updates(int p_mutationID)
         case MUT_Mixed:      throw StdException(_T("Mixed mutations"));
         case MUT_MyMutation: sql = GetSQLUpdate(&query,record);
                              query.DoSQLStatement(sql);
+                             CheckVersionConflict(query);
+                             if(!m_versionColumn.IsEmpty())
+                             {
+                               // The record now carries the version as written
+                               record->SetField(GetFieldNumber(m_versionColumn),&m_nextVersion,p_mutationID);
+                             }
                              ++update;
                              break;
       }
@@ -1791,10 +1889,17 @@ SQLDataSet::GetSQLUpdate(SQLQuery* p_query,const SQLRecord* p_record)
   // New set of parameters
   p_query->ResetParameters();
 
+  // The version column is never written by the caller
+  int version = m_versionColumn.IsEmpty() ? -1 : GetFieldNumber(m_versionColumn);
+
   // Check for all fields
   bool first = true;
   for(unsigned ind = 0;ind < m_names.size(); ++ind)
   {
+    if((int)ind == version)
+    {
+      continue;
+    }
     // Filter for specific columns that are allowed to be updated
     bool update = true;
     if(!m_updateColumns.empty())
@@ -1830,6 +1935,14 @@ SQLDataSet::GetSQLUpdate(SQLQuery* p_query,const SQLRecord* p_record)
       first = false;
     }
   }
+  // Optimistic locking: the next version of the record
+  if(version >= 0)
+  {
+    m_nextVersion = GetNextVersion(p_record->GetField(version));
+    sql += first ? _T("   SET ") : _T("      ,");
+    sql += m_names[version] + _T(" = ?\n");
+    p_query->SetParameter(parameter++,&m_nextVersion);
+  }
   // Adding the WHERE clause
   sql += GetWhereClause(p_query,p_record,parameter);
 
@@ -1908,9 +2021,73 @@ SQLDataSet::GetWhereClause(SQLQuery* p_query,const SQLRecord* p_record,int& p_pa
       p_query->SetParameter(p_parameter++,value);
     }
   }
+
+  // Optimistic locking: record must still have the version we read
+  if(!m_versionColumn.IsEmpty())
+  {
+    int column = GetFieldNumber(m_versionColumn);
+    if(column >= 0)
+    {
+      sql += _T("\n   AND ") + m_names[column];
+      SQLVariant* value = p_record->GetField(column);
+      if(value->IsNULL())
+      {
+        sql += _T(" IS NULL");
+      }
+      else
+      {
+        sql += _T(" = ?");
+        p_query->SetParameter(p_parameter++,value);
+      }
+    }
+  }
   return sql;
 }
 
+// Next version of a record for optimistic locking
+// Timestamp versions get the current time, all others are counted up.
+// A timestamp is taken in whole seconds: every DATE/DATETIME/TIMESTAMP
+// column stores those exactly, so the next "WHERE version = ?" matches.
+// It is always later than the current version, also within the same second.
+SQLVariant
+SQLDataSet::GetNextVersion(const SQLVariant* p_version)
+{
+  if(p_version->IsDateTimeType())
+  {
+    SQLTimestamp next = SQLTimestamp::CurrentTimestamp(false);
+    if(!p_version->IsNULL())
+    {
+      SQLTimestamp current = p_version->GetAsSQLTimestamp();
+      current.SetFraction(0);
+      if(next <= current)
+      {
+        next = current.AddSeconds(1);
+      }
+    }
+    return SQLVariant(&next);
+  }
+  if(p_version->IsNULL())
+  {
+    return SQLVariant(1);
+  }
+  SQLVariant version(p_version);
+  return version + SQLVariant(1);
+}
+
+// Optimistic locking: if no row was affected, another writer was first
+void
+SQLDataSet::CheckVersionConflict(SQLQuery& p_query)
+{
+  if(!m_versionColumn.IsEmpty() && GetFieldNumber(m_versionColumn) >= 0)
+  {
+    if(p_query.GetNumberOfRows() == 0)
+    {
+      m_versionConflict = true;
+      throw StdException(_T("Optimistic locking conflict: record changed by another user in table: ") + m_primaryTableName);
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 // Store in XML format
@@ -2031,6 +2208,63 @@ SQLDataSet::XMLLoad(XMLMessage* p_msg,XMLElement* p_dataset,const LONG* p_abort
   }
 }
 
+// Columnar files for other tools (pandas, Spark, DuckDB, Power BI ...)
+// Much smaller and faster than XMLSave for large sets
+// Arrow compresses with LZ4 frames, Parquet with GZIP
+bool
+SQLDataSet::ArrowSave(XString p_filename,bool p_compress /*= true*/)
+{
+  SQLColumnarOptions options;
+  options.m_compress = p_compress;
+
+  SQLArrowWriter writer(options);
+  if(!writer.Open(p_filename))
+  {
+    return false;
+  }
+  writer.WriteDataSet(*this);
+  return writer.Close();
+}
+
+bool
+SQLDataSet::ArrowLoad(XString p_filename)
+{
+  SQLArrowReader reader;
+  if(!reader.Open(p_filename))
+  {
+    return false;
+  }
+  reader.ReadDataSet(*this);
+  return true;
+}
+
+bool
+SQLDataSet::ParquetSave(XString p_filename,bool p_compress /*= true*/)
+{
+  SQLColumnarOptions options;
+  options.m_compress = p_compress;
+
+  SQLParquetWriter writer(options);
+  if(!writer.Open(p_filename))
+  {
+    return false;
+  }
+  writer.WriteDataSet(*this);
+  return writer.Close();
+}
+
+bool
+SQLDataSet::ParquetLoad(XString p_filename)
+{
+  SQLParquetReader reader;
+  if(!reader.Open(p_filename))
+  {
+    return false;
+  }
+  reader.ReadDataSet(*this);
+  return true;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 // FORGETTING ABOUT A RECORD
@@ -88,6 +88,7 @@ public:
 
 class SQLDatabase;
 class SQLQuery;
+class SQLStatementCache;
 
 typedef std::vector<SQLRecord*>     RecordSet;
 typedef std::vector<SQLVariant*>    VariantSet;
@@ -146,6 +147,7 @@ public:
   int          FindObjectRecNum(const VariantSet& p_primary); // If your primary is a compound key (Slower)
   SQLRecord*   FindObjectRecord(int p_primary);               // If your primary is an INTEGER     (Fast!!)
   SQLRecord*   FindObjectRecord(const VariantSet& p_primary); // If your primary is a compound key (Slower)
+  SQLRecord*   SearchObjectRecord(const VariantSet& p_primary); // Also inserted records         (Always slow)
   SQLRecord*   FindObjectFilter(bool p_primary = false);      // Fast & slow
   RecordSet*   FindRecordSet();                               // Always slow
   // Forget the records
@@ -193,6 +195,10 @@ public:
   virtual void SetPrimaryKeyColumn(WordList& p_list);
   // Set if we whish to keep duplicates in the recordset
   virtual void SetKeepDuplicates(bool p_keep);
+  // Version column for optimistic locking of UPDATE/DELETE (number or timestamp)
+  void         SetVersionColumn(XString p_column);
+  // Use a cache of rendered SELECT statements. The key must identify the query (Do SetQuery first)
+  virtual void SetStatementCache(SQLStatementCache* p_cache,XString p_key);
 
   // Open will not take action if no columns selected
   void         SetStopIfNoColumns(bool p_stop);
@@ -261,12 +267,20 @@ public:
   unsigned     GetLockWaitTime();
   // Duplicates
   bool         GetKeepDuplicates();
+  // Optimistic locking
+  XString      GetVersionColumn();
+  bool         GetVersionConflict();
 
   // XML Saving and loading
   bool         XMLSave(XString p_filename,XString p_name,Encoding p_encoding = Encoding::UTF8);
   bool         XMLLoad(XString p_filename);
   void         XMLSave(XMLMessage* p_msg,XMLElement* p_dataset);
   void         XMLLoad(XMLMessage* p_msg,XMLElement* p_dataset,const LONG* p_abort = nullptr);
+  // Apache Arrow IPC and Apache Parquet saving and loading (see SQLColumnar.h)
+  bool         ArrowSave(XString p_filename,bool p_compress = true);
+  bool         ArrowLoad(XString p_filename);
+  bool         ParquetSave(XString p_filename,bool p_compress = true);
+  bool         ParquetLoad(XString p_filename);
 
 protected:
   // Set parameters in the query
@@ -277,6 +291,8 @@ protected:
   virtual XString ParseSelection(SQLQuery& p_query);
   // Parse the filters
   virtual XString ParseFilters(SQLQuery& p_query,XString p_sql);
+  // Getting the shape key for the statement cache
+  bool         GetStatementKey(XString& p_key);
 
   // Get the variant of a parameter
   SQLVariant*  GetParameter(const XString& p_name);
@@ -314,6 +330,9 @@ protected:
   XString      GetSQLUpdate  (SQLQuery* p_query,const SQLRecord* p_record);
   XString      GetSQLInsert  (SQLQuery* p_query,const SQLRecord* p_record);
   XString      GetWhereClause(SQLQuery* p_query,const SQLRecord* p_record,int& p_parameter);
+  // Optimistic locking
+  SQLVariant   GetNextVersion(const SQLVariant* p_version);
+  void         CheckVersionConflict(SQLQuery& p_query);
 
   // Base class data of the dataset
 
@@ -342,10 +361,17 @@ protected:
   bool         m_isolation     { false };
   bool         m_lockForUpdate { false };
   unsigned     m_lockWaitTime  { DEFAULT_LOCK_TIMEOUT };
+  // Optimistic locking
+  XString      m_versionColumn;
+  SQLVariant   m_nextVersion;
+  bool         m_versionConflict { false };
   // Filter sets
   SQLFilterSet* m_filters      { nullptr };
   SQLFilterSet* m_havings      { nullptr };
   bool          m_ownFilters   { false   };
+  // Cache of rendered SELECT statements
+  SQLStatementCache* m_statementCache { nullptr };
+  XString       m_statementKey;
   // Records and objects
   int          m_status    { SQL_Empty };
   int          m_current   { -1 };
@@ -561,5 +587,23 @@ SQLDataSet::SetKeepDuplicates(bool p_keep)
   m_keepDuplicates = p_keep;
 }
 
+inline void
+SQLDataSet::SetVersionColumn(XString p_column)
+{
+  m_versionColumn = p_column;
+}
+
+inline XString
+SQLDataSet::GetVersionColumn()
+{
+  return m_versionColumn;
+}
+
+inline bool
+SQLDataSet::GetVersionConflict()
+{
+  return m_versionConflict;
+}
+
 // End of namespace
 }
\ No newline at end of file
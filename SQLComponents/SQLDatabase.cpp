@@ -1562,9 +1562,10 @@ SQLDatabase::GetSQL_GenerateSerial(XString p_table,XString p_sequence /*=""*/)
     rs.DoSQLStatement(query);
     if(rs.GetRecord())
     {
-      int serial = rs[1];
+      // Sequences can run beyond 32 bits
+      __int64 serial = rs[1].GetAsSBigInt();
       XString result;
-      result.Format(_T("%d"),serial);
+      result.Format(_T("%I64d"),serial);
       return result;
     }
     return "0";
@@ -29,6 +29,7 @@
 #include "SQLDatabase.h"
 #include <AutoCritical.h>
 #include <ServiceReporting.h>
+#include <Metrics.h>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -39,6 +40,9 @@ static char THIS_FILE[] = __FILE__;
 namespace SQLComponents
 {
 
+// Time to get a database from the pool
+static MetricHistogram* s_acquireTime = GetMetricsRegistry().GetHistogram(_T("sql_pool_acquire_seconds"),_T("Getting a database from the SQLDatabasePool"));
+
 //////////////////////////////////////////////////////////////////////////
 //
 // DATABASE POOL
@@ -67,6 +71,9 @@ SQLDatabasePool::~SQLDatabasePool()
 SQLDatabase*
 SQLDatabasePool::GetDatabase(const XString& p_connectionName)
 {
+  // Waiting for the lock and a free database is the acquire time
+  MetricTimer timer(s_acquireTime);
+
   // Lock the pool
   AutoCritSec lock(&m_lock);
 
@@ -84,6 +91,83 @@ SQLDatabasePool::GetDatabase(const XString& p_connectionName)
   return GetDatabaseInternally(m_freeDatabases,name);
 }
 
+// Get a database for reading
+// A replica that cannot be connected is skipped, and we read from the connection itself.
+SQLDatabase*
+SQLDatabasePool::GetReadDatabase(const XString& p_connectionName)
+{
+  XString replica = GetReplicaConnection(p_connectionName);
+  if(replica.CompareNoCase(p_connectionName) != 0)
+  {
+    try
+    {
+      SQLDatabase* database = GetDatabase(replica);
+      if(database)
+      {
+        return database;
+      }
+    }
+    catch(StdException& ex)
+    {
+      XString error;
+      error.Format(_T("Read replica [%s] is skipped: %s"),replica.GetString(),ex.GetErrorMessage().GetString());
+      LogPrint(error);
+    }
+    SetReplicaFailed(replica);
+  }
+  return GetDatabase(p_connectionName);
+}
+
+// Get the name of a read replica of the connection
+// Replicas are used round-robin. Replicas that failed recently are skipped.
+// Without (working) replicas, the connection itself is the one to read from.
+XString
+SQLDatabasePool::GetReplicaConnection(const XString& p_connectionName)
+{
+  // Lock the pool
+  AutoCritSec lock(&m_lock);
+
+  XString name(p_connectionName);
+  name.MakeLower();
+
+  ConnList replicas = m_connections.GetReplicas(name);
+  if(replicas.empty())
+  {
+    return p_connectionName;
+  }
+  ULONGLONG now  = GetTickCount64();
+  unsigned& next = m_replicaNext[name];
+  for(unsigned count = 0;count < (unsigned)replicas.size();++count)
+  {
+    XString& replica = replicas[next++ % replicas.size()];
+    ReplicaFailed::iterator it = m_replicaFailed.find(replica);
+    if(it == m_replicaFailed.end())
+    {
+      return replica;
+    }
+    if((now - it->second) > (ULONGLONG)(REPLICA_RETRY_TIME * 1000))
+    {
+      // Give it another try
+      m_replicaFailed.erase(it);
+      return replica;
+    }
+  }
+  // All replicas are failing
+  return p_connectionName;
+}
+
+// A read replica failed to connect: skip it for a while
+void
+SQLDatabasePool::SetReplicaFailed(const XString& p_replicaName)
+{
+  // Lock the pool
+  AutoCritSec lock(&m_lock);
+
+  XString name(p_replicaName);
+  name.MakeLower();
+  m_replicaFailed[name] = GetTickCount64();
+}
+
 // Return a database connection to the pool
 void
 SQLDatabasePool::GiveUp(SQLDatabase* p_database)
@@ -289,9 +373,9 @@ SQLDatabasePool::AddParameterRebind(int p_sqlType,int p_cppType)
 }
 
 bool
-SQLDatabasePool::AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options)
+SQLDatabasePool::AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options,XString p_replicaOf /*= ""*/)
 {
-  bool added = m_connections.AddConnection(p_name,p_datasource,p_username,p_password,p_options);
+  bool added = m_connections.AddConnection(p_name,p_datasource,p_username,p_password,p_options,p_replicaOf);
   if(!m_isopen && added)
   {
     m_isopen = true;
@@ -40,9 +40,14 @@ namespace SQLComponents
 // Within this term (60 seconds) the cleanup process will come by
 #define CONN_RETRIES  60
 
+// Seconds that a failed read replica is left alone
+#define REPLICA_RETRY_TIME 30
+
 // Lists and maps
 typedef std::deque<SQLDatabase*>     DbsList;
 typedef std::map<XString,DbsList*>   DbsPool;
+typedef std::map<XString,unsigned>   ReplicaNext;
+typedef std::map<XString,ULONGLONG>  ReplicaFailed;
 
 
 class SQLDatabasePool
@@ -53,6 +58,12 @@ public:
 
   // Get or make a database for this connection
   SQLDatabase*    GetDatabase(const XString& p_connectionName);
+  // Get a database for reading: from a read replica if the connection has one
+  SQLDatabase*    GetReadDatabase(const XString& p_connectionName);
+  // Get the name of a read replica of the connection (round-robin). The connection itself if none
+  XString         GetReplicaConnection(const XString& p_connectionName);
+  // A read replica failed to connect: skip it for REPLICA_RETRY_TIME seconds
+  void            SetReplicaFailed(const XString& p_replicaName);
   // Get the connection by name
   SQLConnection*  GetConnection(const XString& p_connectionName);
   SQLConnection*  GetConnection(const int p_index);
@@ -81,7 +92,7 @@ public:
   // Add a parameter rebind for this database session: No bounds checking!
   void            AddParameterRebind(int p_sqlType, int p_cppType);
   // Adding / Deleting connections to the connections list
-  bool            AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options);
+  bool            AddConnection(XString p_name,XString p_datasource,XString p_username,XString p_password,XString p_options,XString p_replicaOf = _T(""));
   bool            DelConnection(XString p_name);
 
   // Support of logging functions (for all databases in the pool)
@@ -126,6 +137,10 @@ private:
   int             m_loggingLevel { 0       };           // Current level
   int             m_logActive    {LOGLEVEL_MAX};        // Threshold: Log only above this loglevel
 
+  // Read replicas
+  ReplicaNext     m_replicaNext;                        // Next replica (round-robin) per primary connection
+  ReplicaFailed   m_replicaFailed;                      // Replicas that failed, and when
+
   // General rebind mapping for new databases
   RebindMap       m_rebindParameters;                   // Rebinding of parameters for SQLBindParam
   RebindMap       m_rebindColumns;                      // Rebinding of result columns for SQLBindCol
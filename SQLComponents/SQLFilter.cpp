@@ -270,16 +270,7 @@ SQLFilter::GetSQLFilter(SQLQuery& p_query)
   }
 
   // Test for special ISNULL case
-  if(m_operator == OP_Equal && m_values.size() == 1)
-  {
-    SQLVariant* var = m_values.front();
-    XString value;
-    var->GetAsString(value);
-    if(var->IsNULL() || value.CompareNoCase(_T("null")) == 0)
-    {
-      m_operator = OP_IsNULL;
-    }
-  }
+  m_operator = GetEffectiveOperator();
 
   // Add the operator
   switch(m_operator)
@@ -393,12 +384,89 @@ SQLFilter::SetCastAs(XString p_datatype,int p_scale /*= 0*/,int p_precision /*=
   m_castPrecision = p_precision;
 }
 
+// Getting the shape of the condition: everything that makes up the SQL text, but not the values.
+// Functions, sub-filters, EXISTS and LIKE render (parts of) their values into the text,
+// or bind them in an order of their own. So they cannot be cached by shape.
+bool
+SQLFilter::GetSQLShape(XString& p_shape) const
+{
+  if(m_function   != FN_NOP     ||
+     m_subfilters != nullptr    ||
+     m_operator   == OP_Exists  ||
+     m_operator   == OP_LikeBegin  ||
+     m_operator   == OP_LikeMiddle ||
+     m_operator   == OP_LikeEnd    )
+  {
+    return false;
+  }
+  XString shape;
+  shape.Format(_T("%s|%d|%d|%d%d%d|%s|%s|%s:%d:%d;")
+               ,m_field.GetString()
+               ,GetEffectiveOperator()
+               ,(int)m_values.size()
+               ,m_negate,m_openParenthesis,m_closeParenthesis
+               ,m_expression.GetString()
+               ,m_field2.GetString()
+               ,m_castType.GetString(),m_castScale,m_castPrecision);
+  p_shape += shape;
+  return true;
+}
+
+// Getting the values in the order in which GetSQLFilter binds them
+// Only valid for filters that have a shape (see GetSQLShape)
+void
+SQLFilter::GetSQLBindValues(VariantSet& p_values) const
+{
+  switch(GetEffectiveOperator())
+  {
+    case OP_IN:       for(auto& var : m_values)
+                      {
+                        p_values.push_back(var);
+                      }
+                      break;
+    case OP_Between:  if(m_values.size() != 2)
+                      {
+                        throw StdException(_T("SQLFilter with BETWEEN operator and number of arguments is not two (2) values"));
+                      }
+                      p_values.push_back(m_values[0]);
+                      p_values.push_back(m_values[1]);
+                      break;
+    case OP_NOP:      // Fall through
+    case OP_IsNULL:   // Fall through
+    case OP_IsNotNULL:break;
+    default:          // See ConstructOperand: only the last value is used
+                      if(m_expression.IsEmpty() && m_field2.IsEmpty() && !m_values.empty())
+                      {
+                        p_values.push_back(m_values.back());
+                      }
+                      break;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // 
 // PRIVATE
 //
 //////////////////////////////////////////////////////////////////////////
 
+// The operator as it will be rendered by GetSQLFilter
+// Comparing for equality with a NULL value becomes an "IS NULL" condition
+SQLOperator
+SQLFilter::GetEffectiveOperator() const
+{
+  if(m_operator == OP_Equal && m_values.size() == 1)
+  {
+    SQLVariant* var = m_values.front();
+    XString value;
+    var->GetAsString(value);
+    if(var->IsNULL() || value.CompareNoCase(_T("null")) == 0)
+    {
+      return OP_IsNULL;
+    }
+  }
+  return m_operator;
+}
+
 // Check that we have at least one operand value
 void
 SQLFilter::CheckValue()
@@ -970,4 +1038,41 @@ SQLFilterSet::ParseFiltersToCondition(SQLQuery& p_query)
   return query;
 }
 
+// Shape of the total condition, without the values of the filters
+bool
+SQLFilterSet::GetShapeSignature(XString& p_signature) const
+{
+  for(auto& filt : m_filters)
+  {
+    if(!filt->GetSQLShape(p_signature))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Bind the values of the filters in the exact order of ParseFiltersToCondition
+void
+SQLFilterSet::BindParameters(SQLQuery& p_query) const
+{
+  VariantSet values;
+  bool first = true;
+
+  for(auto& filt : m_filters)
+  {
+    // Chaining OR's are not rendered, so bind nothing
+    if(!first && filt->GetOperator() == SQLOperator::OP_OR)
+    {
+      continue;
+    }
+    first = false;
+    filt->GetSQLBindValues(values);
+  }
+  for(auto& var : values)
+  {
+    p_query.SetParameter(var);
+  }
+}
+
 }
@@ -93,6 +93,10 @@ public:
   XString     GetSQLFilter(SQLQuery& p_query);
   // Match a record to the filter internally
   bool        MatchRecord(SQLRecord* p_record);
+  // Getting the shape of the condition (without the values). False if not cacheable
+  bool        GetSQLShape(XString& p_shape) const;
+  // Getting the values in the order in which GetSQLFilter binds them
+  void        GetSQLBindValues(VariantSet& p_values) const;
 
   // GETTERS
 
@@ -117,6 +121,8 @@ public:
   void        SetSubFilters(SQLFilterSet* subfilters) { m_subfilters = subfilters; }
 
 private:
+  // The operator as it will be rendered (Equal to NULL becomes IS NULL)
+  SQLOperator GetEffectiveOperator() const;
   // Check that we have at least one operand value
   void        CheckValue();
   void        CheckTwoValues();
@@ -331,6 +337,10 @@ public:
   }
 
   XString ParseFiltersToCondition(SQLQuery& p_query);
+  // Shape of the condition without the values. False if not cacheable
+  bool    GetShapeSignature(XString& p_signature) const;
+  // Bind the values of the filters in the order of ParseFiltersToCondition
+  void    BindParameters(SQLQuery& p_query) const;
 
 private:
   std::vector<SQLFilter*> m_filters;
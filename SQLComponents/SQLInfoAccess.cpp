@@ -558,6 +558,13 @@ SQLInfoAccess::GetCATALOGDefaultCollation() const
   return _T("-");
 }
 
+// Fingerprint of the schema: not supported
+XString
+SQLInfoAccess::GetCATALOGSchemaFingerprint(XString& /*p_schema*/) const
+{
+  return XString();
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoAccess::GetCATALOGTableExists(XString& /*p_schema*/,XString& /*p_tablename*/) const
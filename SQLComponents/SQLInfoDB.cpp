@@ -231,6 +231,41 @@ SQLInfoDB::MakeInfoDefaultCollation(XString& p_default)
   return false;
 }
 
+// One value that changes on any DDL in the schema
+// Returns false if the RDBMS cannot tell us
+bool
+SQLInfoDB::MakeInfoSchemaFingerprint(XString& p_fingerprint,XString& p_errors,XString p_schema)
+{
+  p_fingerprint.Empty();
+  XString sql = GetCATALOGSchemaFingerprint(p_schema);
+  if(sql.IsEmpty())
+  {
+    return false;
+  }
+
+  try
+  {
+    SQLQuery qry(m_database);
+    // The schema for every part of the fingerprint
+    for(int pos = sql.Find('?'); pos >= 0; pos = sql.Find('?',pos + 1))
+    {
+      qry.SetParameter(p_schema);
+    }
+    qry.DoSQLStatement(sql);
+    if(qry.GetRecord())
+    {
+      p_fingerprint = qry[1].GetAsString();
+      return !p_fingerprint.IsEmpty();
+    }
+  }
+  catch(StdException& er)
+  {
+    ReThrowSafeException(er);
+    p_errors += er.GetErrorMessage();
+  }
+  return false;
+}
+
 bool
 SQLInfoDB::MakeInfoTableTable(MTableMap& p_tables
                              ,XString&   p_errors
@@ -70,6 +70,7 @@ public:
   virtual bool    MakeInfoDefaultCharset  (XString&       p_default);
   virtual bool    MakeInfoDefaultCharsetNC(XString&       p_default);
   virtual bool    MakeInfoDefaultCollation(XString&       p_default);
+  virtual bool    MakeInfoSchemaFingerprint(XString&      p_fingerprint,XString& p_errors,XString p_schema);
   // Tables
   virtual bool    MakeInfoTableObject     (MTableMap&     p_tables,    XString& p_errors,XString p_schema,XString p_tablename);  // Not known which type!
   virtual bool    MakeInfoTableTable      (MTableMap&     p_tables,    XString& p_errors,XString p_schema,XString p_tablename);  // TABLE   only
@@ -326,6 +327,8 @@ public:
   virtual XString GetCATALOGDefaultCharset() const = 0;
   virtual XString GetCATALOGDefaultCharsetNCV() const = 0;
   virtual XString GetCATALOGDefaultCollation() const = 0;
+  // One value that changes on any DDL in the schema (empty if not supported)
+  virtual XString GetCATALOGSchemaFingerprint(XString& p_schema) const = 0;
   // All table functions
   virtual XString GetCATALOGTableExists       (XString& p_schema,XString& p_tablename) const = 0;
   virtual XString GetCATALOGTablesList        (XString& p_schema,XString& p_pattern)   const = 0;
@@ -731,6 +731,37 @@ SQLInfoFirebird::GetCATALOGDefaultCollation() const
   return GetCATALOGDefaultCharset();
 }
 
+// Fingerprint of the schema: changes on any DDL of the columns,
+// the constraints and the indices and on any grant on the tables
+// Firebird has no schemas: it's the whole database
+XString
+SQLInfoFirebird::GetCATALOGSchemaFingerprint(XString& /*p_schema*/) const
+{
+  return _T("SELECT (SELECT COUNT(*) || '/' || COALESCE(SUM(MOD(HASH(TRIM(rdb$relation_name) || '.' || TRIM(rdb$field_name) || ':' || TRIM(rdb$field_source)),1000000007)),0)\n"
+            "          FROM rdb$relation_fields\n"
+            "         WHERE COALESCE(rdb$system_flag,0) = 0)\n"
+            "       || '/' ||\n"
+            "       (SELECT COALESCE(SUM(MOD(HASH(TRIM(con.rdb$relation_name) || '.' || TRIM(con.rdb$constraint_name) || ':' || TRIM(con.rdb$constraint_type) || ':' || COALESCE(TRIM(con.rdb$index_name),'')\n"
+            "                                || ':' || COALESCE(TRIM(ref.rdb$const_name_uq),'') || ':' || COALESCE(TRIM(ref.rdb$update_rule),'') || ':' || COALESCE(TRIM(ref.rdb$delete_rule),'')),1000000007)),0)\n"
+            "          FROM rdb$relation_constraints con\n"
+            "               INNER JOIN rdb$relations rel ON rel.rdb$relation_name = con.rdb$relation_name\n"
+            "               LEFT  OUTER JOIN rdb$ref_constraints ref ON ref.rdb$constraint_name = con.rdb$constraint_name\n"
+            "         WHERE COALESCE(rel.rdb$system_flag,0) = 0)\n"
+            "       || '/' ||\n"
+            "       (SELECT COALESCE(SUM(MOD(HASH(TRIM(idx.rdb$relation_name) || '.' || TRIM(idx.rdb$index_name) || ':' || COALESCE(idx.rdb$unique_flag,0) || ':' || COALESCE(idx.rdb$index_type,0)\n"
+            "                                || ':' || COALESCE(idx.rdb$index_inactive,0) || ':' || TRIM(seg.rdb$field_name) || ':' || seg.rdb$field_position),1000000007)),0)\n"
+            "          FROM rdb$indices idx\n"
+            "               INNER JOIN rdb$index_segments seg ON seg.rdb$index_name = idx.rdb$index_name\n"
+            "         WHERE COALESCE(idx.rdb$system_flag,0) = 0)\n"
+            "       || '/' ||\n"
+            "       (SELECT COALESCE(SUM(MOD(HASH(TRIM(prv.rdb$relation_name) || ':' || TRIM(prv.rdb$user) || ':' || TRIM(prv.rdb$privilege) || ':' || COALESCE(prv.rdb$grant_option,0)\n"
+            "                                || ':' || COALESCE(TRIM(prv.rdb$field_name),'')),1000000007)),0)\n"
+            "          FROM rdb$user_privileges prv\n"
+            "               INNER JOIN rdb$relations rel ON rel.rdb$relation_name = prv.rdb$relation_name\n"
+            "         WHERE COALESCE(rel.rdb$system_flag,0) = 0)\n"
+            "  FROM rdb$database");
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoFirebird::GetCATALOGTableExists(XString& p_schema,XString& p_tablename) const
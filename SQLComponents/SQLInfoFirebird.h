@@ -252,6 +252,7 @@ public:
   XString GetCATALOGDefaultCharset() const override;
   XString GetCATALOGDefaultCharsetNCV() const override;
   XString GetCATALOGDefaultCollation() const override;
+  XString GetCATALOGSchemaFingerprint(XString& p_schema) const override;
   // All table functions
   XString GetCATALOGTableExists       (XString& p_schema,XString& p_tablename)  const override;
   XString GetCATALOGTablesList        (XString& p_schema,XString& p_pattern)    const override;
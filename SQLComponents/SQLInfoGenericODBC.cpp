@@ -573,6 +573,13 @@ SQLInfoGenericODBC::GetCATALOGDefaultCollation() const
   return _T("-");
 }
 
+// Fingerprint of the schema: not supported
+XString
+SQLInfoGenericODBC::GetCATALOGSchemaFingerprint(XString& /*p_schema*/) const
+{
+  return XString();
+}
+
 // ALL FUNCTIONS FOR TABLE(s)
 
 XString
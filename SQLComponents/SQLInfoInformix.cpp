@@ -602,6 +602,20 @@ SQLInfoInformix::GetCATALOGDefaultCollation() const
   return _T("-");
 }
 
+// Fingerprint of the schema: the version of a table changes on any DDL
+XString
+SQLInfoInformix::GetCATALOGSchemaFingerprint(XString& p_schema) const
+{
+  XString sql = _T("SELECT COUNT(*) || '/' || SUM(version)\n")
+                _T("  FROM systables\n")
+                _T(" WHERE tabid >= 100\n");
+  if(!p_schema.IsEmpty())
+  {
+    sql += _T("   AND TRIM(owner) = ?\n");
+  }
+  return sql;
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoInformix::GetCATALOGTableExists(XString& p_schema,XString& p_tablename) const
@@ -586,6 +586,31 @@ SQLInfoMySQL::GetCATALOGDefaultCollation() const
   return _T("latin1_swedish_ci");
 }
 
+// Fingerprint of the schema: changes on any DDL of the columns,
+// the keys, the foreign keys and the indices and on any grant on the tables
+XString
+SQLInfoMySQL::GetCATALOGSchemaFingerprint(XString& p_schema) const
+{
+  XString schema = p_schema.IsEmpty() ? _T("DATABASE()") : _T("?");
+  XString sql = _T("SELECT CONCAT_WS('/'\n")
+                _T("      ,(SELECT CONCAT(COUNT(*),'/',COALESCE(SUM(CRC32(CONCAT_WS(':',table_name,column_name,column_type,is_nullable))),0))\n")
+                _T("          FROM information_schema.columns\n")
+                _T("         WHERE table_schema = ") + schema + _T(")\n")
+                _T("      ,(SELECT COALESCE(SUM(CRC32(CONCAT_WS(':',table_name,constraint_name,column_name,ordinal_position,referenced_table_schema,referenced_table_name,referenced_column_name))),0)\n")
+                _T("          FROM information_schema.key_column_usage\n")
+                _T("         WHERE table_schema = ") + schema + _T(")\n")
+                _T("      ,(SELECT COALESCE(SUM(CRC32(CONCAT_WS(':',table_name,constraint_name,unique_constraint_name,update_rule,delete_rule))),0)\n")
+                _T("          FROM information_schema.referential_constraints\n")
+                _T("         WHERE constraint_schema = ") + schema + _T(")\n")
+                _T("      ,(SELECT COALESCE(SUM(CRC32(CONCAT_WS(':',table_name,index_name,non_unique,seq_in_index,column_name,collation,index_type))),0)\n")
+                _T("          FROM information_schema.statistics\n")
+                _T("         WHERE table_schema = ") + schema + _T(")\n")
+                _T("      ,(SELECT COALESCE(SUM(CRC32(CONCAT_WS(':',table_name,grantee,privilege_type,is_grantable))),0)\n")
+                _T("          FROM information_schema.table_privileges\n")
+                _T("         WHERE table_schema = ") + schema + _T("))");
+  return sql;
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoMySQL::GetCATALOGTableExists(XString& /*p_schema*/,XString& /*p_tablename*/) const
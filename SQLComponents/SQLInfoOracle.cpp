@@ -770,6 +770,18 @@ SQLInfoOracle::GetCATALOGDefaultCollation() const
   return XString();
 }
 
+// Fingerprint of the schema: the last DDL time of all objects
+XString
+SQLInfoOracle::GetCATALOGSchemaFingerprint(XString& p_schema) const
+{
+  p_schema.MakeUpper();
+  XString sql = _T("SELECT TO_CHAR(MAX(last_ddl_time),'YYYYMMDDHH24MISS') || '/' || COUNT(*)\n")
+                _T("  FROM all_objects\n")
+                _T(" WHERE object_type IN ('TABLE','VIEW','SEQUENCE','INDEX','SYNONYM')\n");
+  sql += p_schema.IsEmpty() ? _T("   AND owner = SYS_CONTEXT('USERENV','CURRENT_SCHEMA')") : _T("   AND owner = ?");
+  return sql;
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoOracle::GetCATALOGTableExists(XString& p_schema,XString& p_tablename) const
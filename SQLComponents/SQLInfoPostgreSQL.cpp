@@ -587,6 +587,32 @@ SQLInfoPostgreSQL::GetCATALOGDefaultCollation() const
   return _T("ucs_basic");
 }
 
+// Fingerprint of the schema: changes on any DDL of the columns,
+// the constraints and the indices and on any grant on the tables
+XString
+SQLInfoPostgreSQL::GetCATALOGSchemaFingerprint(XString& p_schema) const
+{
+  p_schema.MakeLower();
+  XString schema = p_schema.IsEmpty() ? _T("current_schema()") : _T("?");
+  XString sql = _T("SELECT (SELECT count(*) || '/' || coalesce(md5(string_agg(table_name || '.' || column_name || ':' || data_type || ':' || is_nullable,',' ORDER BY table_name,ordinal_position)),'')\n")
+                _T("          FROM information_schema.columns\n")
+                _T("         WHERE table_schema = ") + schema + _T(")\n")
+                _T("       || '/' ||\n")
+                _T("       (SELECT coalesce(md5(string_agg(con.conrelid::regclass::text || '.' || con.conname || ':' || pg_get_constraintdef(con.oid),',' ORDER BY con.conrelid::regclass::text,con.conname)),'')\n")
+                _T("          FROM pg_constraint con\n")
+                _T("               INNER JOIN pg_namespace nsp ON nsp.oid = con.connamespace\n")
+                _T("         WHERE nsp.nspname = ") + schema + _T(")\n")
+                _T("       || '/' ||\n")
+                _T("       (SELECT coalesce(md5(string_agg(tablename || '.' || indexname || ':' || indexdef,',' ORDER BY tablename,indexname)),'')\n")
+                _T("          FROM pg_indexes\n")
+                _T("         WHERE schemaname = ") + schema + _T(")\n")
+                _T("       || '/' ||\n")
+                _T("       (SELECT coalesce(md5(string_agg(table_name || ':' || grantor || ':' || grantee || ':' || privilege_type || ':' || is_grantable,',' ORDER BY table_name,grantor,grantee,privilege_type)),'')\n")
+                _T("          FROM information_schema.table_privileges\n")
+                _T("         WHERE table_schema = ") + schema + _T(")");
+  return sql;
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoPostgreSQL::GetCATALOGTableExists(XString& p_schema,XString& p_tablename) const
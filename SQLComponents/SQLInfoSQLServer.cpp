@@ -827,6 +827,18 @@ SQLInfoSQLServer::GetCATALOGDefaultCollation() const
   return _T("SELECT SERVERPROPERTY('Collation')");
 }
 
+// Fingerprint of the schema: the last modification of all objects
+XString
+SQLInfoSQLServer::GetCATALOGSchemaFingerprint(XString& p_schema) const
+{
+  XString sql = _T("SELECT CONVERT(VARCHAR(30),MAX(obj.modify_date),121) + '/' + CAST(COUNT(*) AS VARCHAR(20))\n")
+                _T("  FROM sys.objects obj\n")
+                _T("       INNER JOIN sys.schemas sch ON sch.schema_id = obj.schema_id\n")
+                _T(" WHERE obj.type IN ('U','V','SO','PK','F','UQ')\n");
+  sql += p_schema.IsEmpty() ? _T("   AND sch.name = SCHEMA_NAME()") : _T("   AND sch.name = ?");
+  return sql;
+}
+
 // Get SQL to check if a table already exists in the database
 XString
 SQLInfoSQLServer::GetCATALOGTableExists(XString& p_schema,XString& p_tablename) const
@@ -0,0 +1,1912 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLParquet.cpp
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#include "stdafx.h"
+#include "SQLComponents.h"
+#include "SQLParquet.h"
+#include <ZIP\gzip.h>
+#include <unordered_map>
+#include <algorithm>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+namespace SQLComponents
+{
+
+// Start and end of a Parquet file
+static const char parquet_magic[4] = { 'P','A','R','1' };
+
+// Thrift compact protocol types
+#define THRIFT_BOOLEAN_TRUE   1
+#define THRIFT_BOOLEAN_FALSE  2
+#define THRIFT_BYTE           3
+#define THRIFT_I16            4
+#define THRIFT_I32            5
+#define THRIFT_I64            6
+#define THRIFT_DOUBLE         7
+#define THRIFT_BINARY         8
+#define THRIFT_LIST           9
+#define THRIFT_SET           10
+#define THRIFT_MAP           11
+#define THRIFT_STRUCT        12
+#define THRIFT_MAXDEPTH      64
+
+// Physical types
+#define PARQUET_BOOLEAN       0
+#define PARQUET_INT32         1
+#define PARQUET_INT64         2
+#define PARQUET_INT96         3
+#define PARQUET_FLOAT         4
+#define PARQUET_DOUBLE        5
+#define PARQUET_BYTE_ARRAY    6
+#define PARQUET_FIXED         7
+
+// Repetition of a field
+#define PARQUET_REQUIRED      0
+#define PARQUET_OPTIONAL      1
+#define PARQUET_REPEATED      2
+
+// Converted types
+#define PARQUET_CONV_UTF8         0
+#define PARQUET_CONV_ENUM         4
+#define PARQUET_CONV_DECIMAL      5
+#define PARQUET_CONV_DATE         6
+#define PARQUET_CONV_TIME_MILLIS  7
+#define PARQUET_CONV_TIME_MICROS  8
+#define PARQUET_CONV_TS_MILLIS    9
+#define PARQUET_CONV_TS_MICROS   10
+#define PARQUET_CONV_UINT_8      11
+#define PARQUET_CONV_UINT_16     12
+#define PARQUET_CONV_UINT_32     13
+#define PARQUET_CONV_UINT_64     14
+#define PARQUET_CONV_INT_8       15
+#define PARQUET_CONV_INT_16      16
+#define PARQUET_CONV_JSON        19
+
+// LogicalType union
+#define PARQUET_LOGICAL_STRING    1
+#define PARQUET_LOGICAL_ENUM      4
+#define PARQUET_LOGICAL_DECIMAL   5
+#define PARQUET_LOGICAL_DATE      6
+#define PARQUET_LOGICAL_TIME      7
+#define PARQUET_LOGICAL_TIMESTAMP 8
+#define PARQUET_LOGICAL_INTEGER  10
+#define PARQUET_LOGICAL_JSON     12
+#define PARQUET_LOGICAL_UUID     14
+
+// TimeUnit union
+#define PARQUET_UNIT_MILLIS       1
+#define PARQUET_UNIT_MICROS       2
+#define PARQUET_UNIT_NANOS        3
+
+// Encodings
+#define PARQUET_PLAIN             0
+#define PARQUET_PLAIN_DICTIONARY  2
+#define PARQUET_RLE               3
+#define PARQUET_RLE_DICTIONARY    8
+
+// Compression codecs
+#define PARQUET_UNCOMPRESSED      0
+#define PARQUET_SNAPPY            1
+#define PARQUET_GZIP              2
+
+// Page types
+#define PARQUET_PAGE_DATA         0
+#define PARQUET_PAGE_DICTIONARY   2
+#define PARQUET_PAGE_DATA_V2      3
+
+// Julian day of 1970-01-01 in INT96 timestamps
+#define PARQUET_JULIAN_EPOCH      2440588LL
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THRIFT COMPACT PROTOCOL
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void
+AppendVarint(std::vector<BYTE>& p_buffer,unsigned __int64 p_value)
+{
+  while(p_value >= 0x80)
+  {
+    p_buffer.push_back((BYTE)(p_value | 0x80));
+    p_value >>= 7;
+  }
+  p_buffer.push_back((BYTE)p_value);
+}
+
+static unsigned __int64
+ReadVarint(const BYTE* p_data,size_t p_size,size_t& p_position)
+{
+  unsigned __int64 value = 0;
+  for(int shift = 0;shift < 64;shift += 7)
+  {
+    if(p_position >= p_size)
+    {
+      break;
+    }
+    BYTE byte = p_data[p_position++];
+    value |= (unsigned __int64)(byte & 0x7F) << shift;
+    if((byte & 0x80) == 0)
+    {
+      return value;
+    }
+  }
+  throw StdException(_T("Parquet file is corrupt: variable length integer"));
+}
+
+// Writes the structs of the metadata and the page headers.
+// A struct starts with Element() or Struct() and ends with EndStruct().
+class ThriftWriter
+{
+public:
+  void I32(int p_id,int p_value)
+  {
+    Header(p_id,THRIFT_I32);
+    AppendVarint(m_buffer,ZigZag(p_value));
+  }
+  void I64(int p_id,__int64 p_value)
+  {
+    Header(p_id,THRIFT_I64);
+    AppendVarint(m_buffer,ZigZag(p_value));
+  }
+  void Byte(int p_id,int p_value)
+  {
+    Header(p_id,THRIFT_BYTE);
+    m_buffer.push_back((BYTE)p_value);
+  }
+  void Bool(int p_id,bool p_value)
+  {
+    Header(p_id,p_value ? THRIFT_BOOLEAN_TRUE : THRIFT_BOOLEAN_FALSE);
+  }
+  void Binary(int p_id,const std::string& p_value)
+  {
+    Header(p_id,THRIFT_BINARY);
+    String(p_value);
+  }
+  void Struct(int p_id)
+  {
+    Header(p_id,THRIFT_STRUCT);
+    Element();
+  }
+  // Header of a list field. The elements follow
+  void List(int p_id,int p_type,size_t p_count)
+  {
+    Header(p_id,THRIFT_LIST);
+    if(p_count < 15)
+    {
+      m_buffer.push_back((BYTE)((p_count << 4) | p_type));
+    }
+    else
+    {
+      m_buffer.push_back((BYTE)(0xF0 | p_type));
+      AppendVarint(m_buffer,p_count);
+    }
+  }
+  void ListI32(int p_value)
+  {
+    AppendVarint(m_buffer,ZigZag(p_value));
+  }
+  void ListBinary(const std::string& p_value)
+  {
+    String(p_value);
+  }
+  // Struct element of a list, or the outer struct
+  void Element()
+  {
+    m_stack.push_back(m_last);
+    m_last = 0;
+  }
+  void EndStruct()
+  {
+    m_buffer.push_back(0);
+    m_last = m_stack.back();
+    m_stack.pop_back();
+  }
+
+  std::vector<BYTE> m_buffer;
+
+private:
+  static unsigned __int64 ZigZag(__int64 p_value)
+  {
+    return ((unsigned __int64)p_value << 1) ^ (unsigned __int64)(p_value >> 63);
+  }
+  void Header(int p_id,int p_type)
+  {
+    int delta = p_id - m_last;
+    if(delta > 0 && delta <= 15)
+    {
+      m_buffer.push_back((BYTE)((delta << 4) | p_type));
+    }
+    else
+    {
+      m_buffer.push_back((BYTE)p_type);
+      AppendVarint(m_buffer,ZigZag(p_id));
+    }
+    m_last = p_id;
+  }
+  void String(const std::string& p_value)
+  {
+    AppendVarint(m_buffer,p_value.size());
+    m_buffer.insert(m_buffer.end(),p_value.begin(),p_value.end());
+  }
+
+  std::vector<int> m_stack;
+  int              m_last { 0 };
+};
+
+// Reads the structs of the metadata and the page headers, bounds checked.
+// A struct is read with Begin(), Field() until it returns false, and End().
+class ThriftReader
+{
+public:
+  ThriftReader(const BYTE* p_data,size_t p_size)
+              :m_data(p_data)
+              ,m_size(p_size)
+  {
+  }
+  void Begin()
+  {
+    if(m_stack.size() >= THRIFT_MAXDEPTH)
+    {
+      throw StdException(_T("Parquet file is corrupt: metadata nesting"));
+    }
+    m_stack.push_back(m_last);
+    m_last = 0;
+  }
+  void End()
+  {
+    m_last = m_stack.back();
+    m_stack.pop_back();
+  }
+  // Next field of the current struct. False at the end of the struct
+  bool Field(int& p_id,int& p_type)
+  {
+    BYTE header = Byte();
+    if(header == 0)
+    {
+      return false;
+    }
+    p_type = header & 0x0F;
+    int delta = header >> 4;
+    p_id   = delta ? m_last + delta : (int)UnZigZag(ReadVarint(m_data,m_size,m_position));
+    m_last = p_id;
+    return true;
+  }
+  __int64 Integer()
+  {
+    return UnZigZag(ReadVarint(m_data,m_size,m_position));
+  }
+  int Int8()
+  {
+    return (signed char)Byte();
+  }
+  std::string String()
+  {
+    size_t length = Length();
+    std::string value(reinterpret_cast<const char*>(m_data) + m_position,length);
+    m_position += length;
+    return value;
+  }
+  // Header of a list field. Returns the number of elements
+  size_t List(int& p_type)
+  {
+    BYTE header = Byte();
+    p_type = header & 0x0F;
+    size_t count = header >> 4;
+    if(count == 15)
+    {
+      count = Length();
+    }
+    return count;
+  }
+  void Skip(int p_type,bool p_element = false)
+  {
+    if(++m_depth > THRIFT_MAXDEPTH)
+    {
+      throw StdException(_T("Parquet file is corrupt: metadata nesting"));
+    }
+    switch(p_type)
+    {
+      case THRIFT_BOOLEAN_TRUE:   // Fall through
+      case THRIFT_BOOLEAN_FALSE:  if(p_element)
+                                  {
+                                    Byte();
+                                  }
+                                  break;
+      case THRIFT_BYTE:           Byte();
+                                  break;
+      case THRIFT_I16:            // Fall through
+      case THRIFT_I32:            // Fall through
+      case THRIFT_I64:            ReadVarint(m_data,m_size,m_position);
+                                  break;
+      case THRIFT_DOUBLE:         Bytes(8);
+                                  break;
+      case THRIFT_BINARY:         Bytes(Length());
+                                  break;
+      case THRIFT_LIST:           // Fall through
+      case THRIFT_SET:            {
+                                    int type = 0;
+                                    size_t count = List(type);
+                                    for(size_t index = 0;index < count;++index)
+                                    {
+                                      Skip(type,true);
+                                    }
+                                  }
+                                  break;
+      case THRIFT_MAP:            {
+                                    size_t count = Length();
+                                    BYTE   types = count ? Byte() : 0;
+                                    for(size_t index = 0;index < count;++index)
+                                    {
+                                      Skip(types >> 4,true);
+                                      Skip(types & 0x0F,true);
+                                    }
+                                  }
+                                  break;
+      case THRIFT_STRUCT:         {
+                                    int id = 0,type = 0;
+                                    Begin();
+                                    while(Field(id,type))
+                                    {
+                                      Skip(type);
+                                    }
+                                    End();
+                                  }
+                                  break;
+      default:                    throw StdException(_T("Parquet file is corrupt: metadata type"));
+    }
+    --m_depth;
+  }
+  size_t GetPosition()
+  {
+    return m_position;
+  }
+
+private:
+  static __int64 UnZigZag(unsigned __int64 p_value)
+  {
+    return (__int64)(p_value >> 1) ^ -(__int64)(p_value & 1);
+  }
+  BYTE Byte()
+  {
+    if(m_position >= m_size)
+    {
+      throw StdException(_T("Parquet file is corrupt: metadata"));
+    }
+    return m_data[m_position++];
+  }
+  // Length of a string or collection: never more than the remaining bytes
+  size_t Length()
+  {
+    unsigned __int64 length = ReadVarint(m_data,m_size,m_position);
+    if(length > m_size - m_position)
+    {
+      throw StdException(_T("Parquet file is corrupt: metadata length"));
+    }
+    return (size_t)length;
+  }
+  void Bytes(size_t p_length)
+  {
+    if(p_length > m_size - m_position)
+    {
+      throw StdException(_T("Parquet file is corrupt: metadata"));
+    }
+    m_position += p_length;
+  }
+
+  const BYTE*      m_data;
+  size_t           m_size;
+  size_t           m_position { 0 };
+  std::vector<int> m_stack;
+  int              m_last     { 0 };
+  int              m_depth    { 0 };
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+// ENCODINGS AND COMPRESSION
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Number of bits for values up to 'p_maximum'
+static int
+BitWidth(size_t p_maximum)
+{
+  int width = 0;
+  while(p_maximum)
+  {
+    ++width;
+    p_maximum >>= 1;
+  }
+  return width;
+}
+
+// Bit packed run of the RLE/bit-packing hybrid: whole groups of 8 values
+static void
+HybridPacked(std::vector<unsigned>& p_values,int p_bitWidth,std::vector<BYTE>& p_output)
+{
+  if(p_values.empty())
+  {
+    return;
+  }
+  p_values.resize((p_values.size() + 7) / 8 * 8,0);
+  AppendVarint(p_output,((unsigned __int64)(p_values.size() / 8) << 1) | 1);
+
+  unsigned __int64 buffer = 0;
+  int              bits   = 0;
+  for(unsigned value : p_values)
+  {
+    buffer |= (unsigned __int64)value << bits;
+    bits   += p_bitWidth;
+    while(bits >= 8)
+    {
+      p_output.push_back((BYTE)buffer);
+      buffer >>= 8;
+      bits    -= 8;
+    }
+  }
+  p_values.clear();
+}
+
+// RLE/bit-packing hybrid of definition levels and dictionary indices.
+// Runs of 8 or more equal values are RLE runs. Padding only ends the last
+// bit packed run, so an RLE run may only start after whole groups.
+template<typename T>
+static void
+HybridEncode(const T* p_values,size_t p_count,int p_bitWidth,std::vector<BYTE>& p_output)
+{
+  std::vector<unsigned> packed;
+  size_t bytes = (p_bitWidth + 7) / 8;
+  size_t index = 0;
+  while(index < p_count)
+  {
+    size_t run = 1;
+    while(index + run < p_count && p_values[index + run] == p_values[index])
+    {
+      ++run;
+    }
+    if(run >= 8 && packed.size() % 8 == 0)
+    {
+      HybridPacked(packed,p_bitWidth,p_output);
+      AppendVarint(p_output,(unsigned __int64)run << 1);
+      for(size_t byte = 0;byte < bytes;++byte)
+      {
+        p_output.push_back((BYTE)((unsigned)p_values[index] >> (8 * byte)));
+      }
+      index += run;
+    }
+    else
+    {
+      packed.push_back((unsigned)p_values[index++]);
+    }
+  }
+  HybridPacked(packed,p_bitWidth,p_output);
+}
+
+static void
+HybridDecode(const BYTE* p_data,size_t p_size,int p_bitWidth,size_t p_count,std::vector<unsigned>& p_values)
+{
+  size_t   bytes    = (p_bitWidth + 7) / 8;
+  unsigned mask     = p_bitWidth >= 32 ? 0xFFFFFFFFU : (1U << p_bitWidth) - 1;
+  size_t   position = 0;
+
+  p_values.clear();
+  p_values.reserve(p_count);
+  while(p_values.size() < p_count)
+  {
+    unsigned __int64 header = ReadVarint(p_data,p_size,position);
+    if(header & 1)
+    {
+      unsigned __int64 groups = header >> 1;
+      if(groups > p_count || groups * p_bitWidth > p_size - position)
+      {
+        throw StdException(_T("Parquet file is corrupt: bit packed run"));
+      }
+      const BYTE* packed = p_data + position;
+      size_t      length = (size_t)groups * p_bitWidth;
+      for(size_t index = 0;index < groups * 8 && p_values.size() < p_count;++index)
+      {
+        size_t bit   = index * p_bitWidth;
+        size_t first = bit >> 3;
+        unsigned __int64 word = 0;
+        memcpy(&word,packed + first,min((size_t)8,length - first));
+        p_values.push_back((unsigned)(word >> (bit & 7)) & mask);
+      }
+      position += length;
+    }
+    else
+    {
+      unsigned __int64 run = header >> 1;
+      if(bytes > p_size - position)
+      {
+        throw StdException(_T("Parquet file is corrupt: RLE run"));
+      }
+      unsigned value = 0;
+      for(size_t byte = 0;byte < bytes;++byte)
+      {
+        value |= (unsigned)p_data[position++] << (8 * byte);
+      }
+      run = min(run,(unsigned __int64)(p_count - p_values.size()));
+      p_values.insert(p_values.end(),(size_t)run,value);
+    }
+  }
+}
+
+// Snappy raw block, the default codec of most Parquet writers
+static void
+SnappyDecompress(const BYTE* p_input,size_t p_length,std::vector<BYTE>& p_output)
+{
+  size_t position = 0;
+  unsigned __int64 size = ReadVarint(p_input,p_length,position);
+  if(size > INT_MAX)
+  {
+    throw StdException(_T("Parquet file is corrupt: snappy length"));
+  }
+  p_output.clear();
+  p_output.reserve((size_t)size);
+
+  while(position < p_length)
+  {
+    BYTE   tag    = p_input[position++];
+    size_t length = 0;
+    size_t offset = 0;
+    switch(tag & 3)
+    {
+      case 0: // Literal
+              length = (tag >> 2) + 1;
+              if(length > 60)
+              {
+                size_t extra = length - 60;
+                if(extra > p_length - position)
+                {
+                  throw StdException(_T("Parquet file is corrupt: snappy literal"));
+                }
+                length = 0;
+                for(size_t byte = 0;byte < extra;++byte)
+                {
+                  length |= (size_t)p_input[position++] << (8 * byte);
+                }
+                ++length;
+              }
+              if(length > p_length - position || length > size - p_output.size())
+              {
+                throw StdException(_T("Parquet file is corrupt: snappy literal"));
+              }
+              p_output.insert(p_output.end(),p_input + position,p_input + position + length);
+              position += length;
+              continue;
+      case 1: // Copy with a 1 byte offset
+              if(position + 1 > p_length)
+              {
+                throw StdException(_T("Parquet file is corrupt: snappy copy"));
+              }
+              length = 4 + ((tag >> 2) & 7);
+              offset = ((size_t)(tag >> 5) << 8) | p_input[position++];
+              break;
+      case 2: // Copy with a 2 bytes offset
+              if(position + 2 > p_length)
+              {
+                throw StdException(_T("Parquet file is corrupt: snappy copy"));
+              }
+              length = 1 + (tag >> 2);
+              offset = p_input[position] | ((size_t)p_input[position + 1] << 8);
+              position += 2;
+              break;
+      case 3: // Copy with a 4 bytes offset
+              if(position + 4 > p_length)
+              {
+                throw StdException(_T("Parquet file is corrupt: snappy copy"));
+              }
+              length = 1 + (tag >> 2);
+              offset = p_input[position] | ((size_t)p_input[position + 1] << 8) | ((size_t)p_input[position + 2] << 16) | ((size_t)p_input[position + 3] << 24);
+              position += 4;
+              break;
+    }
+    if(offset == 0 || offset > p_output.size() || length > size - p_output.size())
+    {
+      throw StdException(_T("Parquet file is corrupt: snappy copy"));
+    }
+    // Copies may overlap their own output
+    size_t from = p_output.size() - offset;
+    for(size_t index = 0;index < length;++index)
+    {
+      p_output.push_back(p_output[from + index]);
+    }
+  }
+  if(p_output.size() != size)
+  {
+    throw StdException(_T("Parquet file is corrupt: snappy length"));
+  }
+}
+
+static void
+ParquetDecompress(int p_codec,const BYTE* p_input,size_t p_length,__int64 p_uncompressed,std::vector<BYTE>& p_output)
+{
+  switch(p_codec)
+  {
+    case PARQUET_UNCOMPRESSED:p_output.assign(p_input,p_input + p_length);
+                              break;
+    case PARQUET_SNAPPY:      SnappyDecompress(p_input,p_length,p_output);
+                              break;
+    case PARQUET_GZIP:        p_output.clear();
+                              if(!gzip_decompress_memory(const_cast<BYTE*>(p_input),p_length,p_output))
+                              {
+                                throw StdException(_T("Parquet file is corrupt: GZIP page"));
+                              }
+                              break;
+    default:                  throw StdException(_T("Parquet file: only SNAPPY and GZIP compression are supported"));
+  }
+  if((__int64)p_output.size() != p_uncompressed)
+  {
+    throw StdException(_T("Parquet file is corrupt: uncompressed page size"));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// WRITER
+//
+//////////////////////////////////////////////////////////////////////////
+
+static int
+ParquetPhysical(ColumnarType p_type)
+{
+  switch(p_type)
+  {
+    case COLTYPE_BOOLEAN:   return PARQUET_BOOLEAN;
+    case COLTYPE_INT8:      // Fall through
+    case COLTYPE_INT16:     // Fall through
+    case COLTYPE_INT32:     // Fall through
+    case COLTYPE_UINT8:     // Fall through
+    case COLTYPE_UINT16:    // Fall through
+    case COLTYPE_UINT32:    // Fall through
+    case COLTYPE_DATE:      // Fall through
+    case COLTYPE_TIME:      // Fall through
+    case COLTYPE_MONTHS:    return PARQUET_INT32;
+    case COLTYPE_INT64:     // Fall through
+    case COLTYPE_UINT64:    // Fall through
+    case COLTYPE_TIMESTAMP: // Fall through
+    case COLTYPE_DURATION:  return PARQUET_INT64;
+    case COLTYPE_FLOAT:     return PARQUET_FLOAT;
+    case COLTYPE_DOUBLE:    return PARQUET_DOUBLE;
+    case COLTYPE_DECIMAL:   // Fall through
+    case COLTYPE_GUID:      return PARQUET_FIXED;
+    default:                return PARQUET_BYTE_ARRAY;
+  }
+}
+
+// SchemaElement of a column with its converted and logical type.
+// Intervals have no annotation: our metadata restores them.
+static void
+ParquetSchemaElement(ThriftWriter& p_thrift,const ColumnarColumn& p_column)
+{
+  std::string name;
+  ColumnarToUTF8(p_column.m_name,name);
+  int physical  = ParquetPhysical(p_column.m_columnar);
+  int converted = -1;
+  int logical   = 0;
+  int bitWidth  = 0;
+  switch(p_column.m_columnar)
+  {
+    case COLTYPE_INT8:      converted = PARQUET_CONV_INT_8;   logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 8;  break;
+    case COLTYPE_INT16:     converted = PARQUET_CONV_INT_16;  logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 16; break;
+    case COLTYPE_UINT8:     converted = PARQUET_CONV_UINT_8;  logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 8;  break;
+    case COLTYPE_UINT16:    converted = PARQUET_CONV_UINT_16; logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 16; break;
+    case COLTYPE_UINT32:    converted = PARQUET_CONV_UINT_32; logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 32; break;
+    case COLTYPE_UINT64:    converted = PARQUET_CONV_UINT_64; logical = PARQUET_LOGICAL_INTEGER;   bitWidth = 64; break;
+    case COLTYPE_DECIMAL:   converted = PARQUET_CONV_DECIMAL; logical = PARQUET_LOGICAL_DECIMAL;   break;
+    case COLTYPE_DATE:      converted = PARQUET_CONV_DATE;    logical = PARQUET_LOGICAL_DATE;      break;
+    case COLTYPE_TIME:      converted = PARQUET_CONV_TIME_MILLIS; logical = PARQUET_LOGICAL_TIME;  break;
+    case COLTYPE_TIMESTAMP: logical   = PARQUET_LOGICAL_TIMESTAMP; break;
+    case COLTYPE_GUID:      logical   = PARQUET_LOGICAL_UUID;      break;
+    case COLTYPE_STRING:    converted = PARQUET_CONV_UTF8;    logical = PARQUET_LOGICAL_STRING;    break;
+    default:                break;
+  }
+  p_thrift.Element();
+  p_thrift.I32(1,physical);
+  if(physical == PARQUET_FIXED)
+  {
+    p_thrift.I32(2,16);
+  }
+  p_thrift.I32(3,PARQUET_OPTIONAL);
+  p_thrift.Binary(4,name);
+  if(converted >= 0)
+  {
+    p_thrift.I32(6,converted);
+  }
+  if(p_column.m_columnar == COLTYPE_DECIMAL)
+  {
+    p_thrift.I32(7,p_column.m_scale);
+    p_thrift.I32(8,p_column.m_precision);
+  }
+  if(logical)
+  {
+    p_thrift.Struct(10);
+    p_thrift.Struct(logical);
+    switch(logical)
+    {
+      case PARQUET_LOGICAL_INTEGER:   p_thrift.Byte(1,bitWidth);
+                                      p_thrift.Bool(2,converted >= PARQUET_CONV_INT_8);
+                                      break;
+      case PARQUET_LOGICAL_DECIMAL:   p_thrift.I32(1,p_column.m_scale);
+                                      p_thrift.I32(2,p_column.m_precision);
+                                      break;
+      case PARQUET_LOGICAL_TIME:      // Fall through
+      case PARQUET_LOGICAL_TIMESTAMP: p_thrift.Bool(1,false);
+                                      p_thrift.Struct(2);
+                                      p_thrift.Struct(logical == PARQUET_LOGICAL_TIME ? PARQUET_UNIT_MILLIS : PARQUET_UNIT_MICROS);
+                                      p_thrift.EndStruct();
+                                      p_thrift.EndStruct();
+                                      break;
+    }
+    p_thrift.EndStruct();
+    p_thrift.EndStruct();
+  }
+  p_thrift.EndStruct();
+}
+
+template<typename T>
+static void
+AppendPlain(std::vector<BYTE>& p_buffer,T p_value)
+{
+  const BYTE* data = reinterpret_cast<const BYTE*>(&p_value);
+  p_buffer.insert(p_buffer.end(),data,data + sizeof(T));
+}
+
+// PLAIN encoding of the non-NULL values of a column
+static void
+ParquetPlain(const ColumnarColumn& p_column,const ColumnarBuffer& p_buffer,unsigned p_rows,std::vector<BYTE>& p_content)
+{
+  const BYTE* data = p_buffer.m_data.data();
+  unsigned    bit  = 0;
+  for(unsigned row = 0;row < p_rows;++row)
+  {
+    if(!p_buffer.m_valid[row])
+    {
+      continue;
+    }
+    const BYTE* value = data + (size_t)row * p_column.m_width;
+    switch(p_column.m_columnar)
+    {
+      case COLTYPE_BOOLEAN: if((bit & 7) == 0)
+                            {
+                              p_content.push_back(0);
+                            }
+                            if(*value)
+                            {
+                              p_content.back() |= (BYTE)(1 << (bit & 7));
+                            }
+                            ++bit;
+                            break;
+      case COLTYPE_INT8:    AppendPlain<int>(p_content,*reinterpret_cast<const signed char*>(value));
+                            break;
+      case COLTYPE_UINT8:   AppendPlain<int>(p_content,*value);
+                            break;
+      case COLTYPE_INT16:   { short integer; memcpy(&integer,value,2); AppendPlain<int>(p_content,integer); }
+                            break;
+      case COLTYPE_UINT16:  { unsigned short integer; memcpy(&integer,value,2); AppendPlain<int>(p_content,integer); }
+                            break;
+      case COLTYPE_DECIMAL: // Big-endian two's complement
+                            for(int index = 15;index >= 0;--index)
+                            {
+                              p_content.push_back(value[index]);
+                            }
+                            break;
+      case COLTYPE_STRING:  // Fall through
+      case COLTYPE_BINARY:  {
+                              int begin = p_buffer.m_offsets[row];
+                              int end   = p_buffer.m_offsets[(size_t)row + 1];
+                              AppendPlain<int>(p_content,end - begin);
+                              p_content.insert(p_content.end(),data + begin,data + end);
+                            }
+                            break;
+      default:              // Same width and layout as the column
+                            p_content.insert(p_content.end(),value,value + p_column.m_width);
+                            break;
+    }
+  }
+}
+
+SQLParquetWriter::SQLParquetWriter(const SQLColumnarOptions& p_options)
+                 :SQLColumnarWriter(p_options)
+{
+}
+
+void
+SQLParquetWriter::WriteHeader()
+{
+  WriteBytes(parquet_magic,sizeof(parquet_magic));
+}
+
+// The schema is part of the footer
+void
+SQLParquetWriter::WriteSchema(unsigned /*p_rows*/)
+{
+}
+
+// One column chunk per column. String and binary chunks with few distinct
+// values are dictionary encoded.
+void
+SQLParquetWriter::WriteRowGroup(unsigned p_rows)
+{
+  ParquetRowGroup group;
+  group.m_rows = p_rows;
+
+  for(size_t index = 0;index < m_schema.size();++index)
+  {
+    const ColumnarColumn& column = m_schema[index];
+    const ColumnarBuffer& buffer = m_buffers[index];
+    ParquetChunk chunk;
+
+    // Definition levels: 1 = value, 0 = NULL
+    std::vector<BYTE> content(4,0);
+    HybridEncode(buffer.m_valid.data(),p_rows,1,content);
+    unsigned levels = (unsigned)(content.size() - 4);
+    memcpy(content.data(),&levels,4);
+
+    int encoding = PARQUET_PLAIN;
+    if(m_options.m_dictionary && column.m_width == 0)
+    {
+      std::unordered_map<std::string,unsigned> distinct;
+      std::vector<unsigned> indices;
+      std::vector<BYTE>     dictionary;
+      for(unsigned row = 0;row < p_rows && distinct.size() <= (size_t)m_options.m_dictionaryMax;++row)
+      {
+        if(buffer.m_valid[row])
+        {
+          int begin = buffer.m_offsets[row];
+          int end   = buffer.m_offsets[(size_t)row + 1];
+          auto found = distinct.emplace(std::string(reinterpret_cast<const char*>(buffer.m_data.data()) + begin,end - begin)
+                                       ,(unsigned)distinct.size());
+          if(found.second)
+          {
+            AppendPlain<int>(dictionary,end - begin);
+            dictionary.insert(dictionary.end(),buffer.m_data.data() + begin,buffer.m_data.data() + end);
+          }
+          indices.push_back(found.first->second);
+        }
+      }
+      if(!distinct.empty() && distinct.size() <= (size_t)m_options.m_dictionaryMax && distinct.size() * 2 <= indices.size())
+      {
+        WritePage(true,(int)distinct.size(),PARQUET_PLAIN,dictionary,chunk);
+        int width = max(1,BitWidth(distinct.size() - 1));
+        content.push_back((BYTE)width);
+        HybridEncode(indices.data(),indices.size(),width,content);
+        encoding = PARQUET_RLE_DICTIONARY;
+      }
+    }
+    if(encoding == PARQUET_PLAIN)
+    {
+      ParquetPlain(column,buffer,p_rows,content);
+    }
+    WritePage(false,(int)p_rows,encoding,content,chunk);
+    group.m_bytes += chunk.m_uncompressed;
+    group.m_chunks.push_back(chunk);
+  }
+  m_rowGroups.push_back(group);
+}
+
+void
+SQLParquetWriter::WritePage(bool p_dictionary,int p_values,int p_encoding,const std::vector<BYTE>& p_content,ParquetChunk& p_chunk)
+{
+  std::vector<BYTE> compressed;
+  const std::vector<BYTE>* body = &p_content;
+  if(m_options.m_compress)
+  {
+    if(!gzip_compress_memory(const_cast<BYTE*>(p_content.data()),p_content.size(),compressed))
+    {
+      throw StdException(_T("Parquet file: cannot compress a page"));
+    }
+    body = &compressed;
+  }
+  if(p_content.size() > INT_MAX || body->size() > INT_MAX)
+  {
+    throw StdException(_T("Parquet page too large. Use a smaller row group"));
+  }
+  ThriftWriter header;
+  header.Element();
+  header.I32(1,p_dictionary ? PARQUET_PAGE_DICTIONARY : PARQUET_PAGE_DATA);
+  header.I32(2,(int)p_content.size());
+  header.I32(3,(int)body->size());
+  if(p_dictionary)
+  {
+    header.Struct(7);
+    header.I32(1,p_values);
+    header.I32(2,p_encoding);
+    header.EndStruct();
+    p_chunk.m_dictionaryPage = m_bytes;
+  }
+  else
+  {
+    header.Struct(5);
+    header.I32(1,p_values);
+    header.I32(2,p_encoding);
+    header.I32(3,PARQUET_RLE);
+    header.I32(4,PARQUET_RLE);
+    header.EndStruct();
+    p_chunk.m_dataPage = m_bytes;
+  }
+  header.EndStruct();
+
+  WriteBytes(header.m_buffer.data(),header.m_buffer.size());
+  WriteBytes(body->data(),body->size());
+  p_chunk.m_uncompressed += (__int64)(header.m_buffer.size() + p_content.size());
+  p_chunk.m_compressed   += (__int64)(header.m_buffer.size() + body->size());
+}
+
+// FileMetaData with the schema, the row groups and our types
+void
+SQLParquetWriter::WriteFooter()
+{
+  ThriftWriter meta;
+  meta.Element();
+  meta.I32(1,1);
+  meta.List(2,THRIFT_STRUCT,m_schema.size() + 1);
+  meta.Element();
+  meta.Binary(4,"schema");
+  meta.I32(5,(int)m_schema.size());
+  meta.EndStruct();
+  for(const auto& column : m_schema)
+  {
+    ParquetSchemaElement(meta,column);
+  }
+  meta.I64(3,m_rows);
+  meta.List(4,THRIFT_STRUCT,m_rowGroups.size());
+  for(const auto& group : m_rowGroups)
+  {
+    meta.Element();
+    meta.List(1,THRIFT_STRUCT,group.m_chunks.size());
+    for(size_t index = 0;index < group.m_chunks.size();++index)
+    {
+      const ParquetChunk& chunk = group.m_chunks[index];
+      bool dictionary = chunk.m_dictionaryPage >= 0;
+      std::string name;
+      ColumnarToUTF8(m_schema[index].m_name,name);
+
+      meta.Element();
+      meta.I64(2,dictionary ? chunk.m_dictionaryPage : chunk.m_dataPage);
+      meta.Struct(3);
+      meta.I32(1,ParquetPhysical(m_schema[index].m_columnar));
+      meta.List(2,THRIFT_I32,dictionary ? 3 : 2);
+      meta.ListI32(PARQUET_PLAIN);
+      meta.ListI32(PARQUET_RLE);
+      if(dictionary)
+      {
+        meta.ListI32(PARQUET_RLE_DICTIONARY);
+      }
+      meta.List(3,THRIFT_BINARY,1);
+      meta.ListBinary(name);
+      meta.I32(4,m_options.m_compress ? PARQUET_GZIP : PARQUET_UNCOMPRESSED);
+      meta.I64(5,group.m_rows);
+      meta.I64(6,chunk.m_uncompressed);
+      meta.I64(7,chunk.m_compressed);
+      meta.I64(9,chunk.m_dataPage);
+      if(dictionary)
+      {
+        meta.I64(11,chunk.m_dictionaryPage);
+      }
+      meta.EndStruct();
+      meta.EndStruct();
+    }
+    meta.I64(2,group.m_bytes);
+    meta.I64(3,group.m_rows);
+    meta.EndStruct();
+  }
+  meta.List(5,THRIFT_STRUCT,1);
+  meta.Element();
+  meta.Binary(1,SQLCOLUMNAR_METADATA);
+  meta.Binary(2,GetTypesMetadata());
+  meta.EndStruct();
+  meta.Binary(6,"SQLComponents");
+  meta.EndStruct();
+
+  unsigned length = (unsigned)meta.m_buffer.size();
+  WriteBytes(meta.m_buffer.data(),meta.m_buffer.size());
+  WriteBytes(&length,4);
+  WriteBytes(parquet_magic,sizeof(parquet_magic));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// READER
+//
+//////////////////////////////////////////////////////////////////////////
+
+// SchemaElement of the file
+typedef struct _parquetElement
+{
+  ParquetField m_field;
+  std::string  m_name;
+  bool         m_leaf       { false };
+  int          m_repetition { PARQUET_REQUIRED };
+  int          m_children   { 0 };
+  int          m_precision  { 0 };
+  int          m_scale      { 0 };
+}
+ParquetElement;
+
+// Header of a page
+typedef struct _parquetPage
+{
+  int     m_type          { -1 };
+  __int64 m_uncompressed  { 0 };
+  __int64 m_compressed    { 0 };
+  __int64 m_values        { 0 };
+  int     m_encoding      { 0 };
+  __int64 m_definition    { 0 };    // Version 2: length of the definition levels
+  __int64 m_repetition    { 0 };    // Version 2: length of the repetition levels
+  bool    m_isCompressed  { true }; // Version 2: values are compressed
+}
+ParquetPage;
+
+// A PLAIN encoded value in a page
+typedef struct _parquetValue
+{
+  const BYTE* m_data;
+  size_t      m_length;
+}
+ParquetValue;
+
+static const BYTE parquet_booleans[2] = { 0,1 };
+
+static void
+ParquetLogicalType(ThriftReader& p_thrift,ParquetElement& p_element)
+{
+  int id = 0,type = 0;
+  p_thrift.Begin();
+  while(p_thrift.Field(id,type))
+  {
+    if(type != THRIFT_STRUCT)
+    {
+      p_thrift.Skip(type);
+      continue;
+    }
+    p_element.m_field.m_logical = id;
+    int member = 0,kind = 0;
+    p_thrift.Begin();
+    while(p_thrift.Field(member,kind))
+    {
+      if(id == PARQUET_LOGICAL_DECIMAL && member == 1 && kind == THRIFT_I32)
+      {
+        p_element.m_scale = (int)p_thrift.Integer();
+      }
+      else if(id == PARQUET_LOGICAL_DECIMAL && member == 2 && kind == THRIFT_I32)
+      {
+        p_element.m_precision = (int)p_thrift.Integer();
+      }
+      else if(id == PARQUET_LOGICAL_INTEGER && member == 1 && kind == THRIFT_BYTE)
+      {
+        p_element.m_field.m_bitWidth = p_thrift.Int8();
+      }
+      else if(id == PARQUET_LOGICAL_INTEGER && member == 2 && (kind == THRIFT_BOOLEAN_TRUE || kind == THRIFT_BOOLEAN_FALSE))
+      {
+        p_element.m_field.m_signed = kind == THRIFT_BOOLEAN_TRUE;
+      }
+      else if((id == PARQUET_LOGICAL_TIME || id == PARQUET_LOGICAL_TIMESTAMP) && member == 2 && kind == THRIFT_STRUCT)
+      {
+        int unit = 0,empty = 0;
+        p_thrift.Begin();
+        while(p_thrift.Field(unit,empty))
+        {
+          p_element.m_field.m_unit = unit;
+          p_thrift.Skip(empty);
+        }
+        p_thrift.End();
+      }
+      else
+      {
+        p_thrift.Skip(kind);
+      }
+    }
+    p_thrift.End();
+  }
+  p_thrift.End();
+}
+
+static void
+ParquetSchemaElement(ThriftReader& p_thrift,ParquetElement& p_element)
+{
+  int id = 0,type = 0;
+  p_thrift.Begin();
+  while(p_thrift.Field(id,type))
+  {
+    if(type == THRIFT_I32 && id >= 1 && id <= 8 && id != 4)
+    {
+      int value = (int)p_thrift.Integer();
+      switch(id)
+      {
+        case 1: p_element.m_field.m_physical  = value; p_element.m_leaf = true; break;
+        case 2: p_element.m_field.m_length    = value; break;
+        case 3: p_element.m_repetition        = value; break;
+        case 5: p_element.m_children          = value; break;
+        case 6: p_element.m_field.m_converted = value; break;
+        case 7: p_element.m_scale             = value; break;
+        case 8: p_element.m_precision         = value; break;
+      }
+    }
+    else if(id == 4 && type == THRIFT_BINARY)
+    {
+      p_element.m_name = p_thrift.String();
+    }
+    else if(id == 10 && type == THRIFT_STRUCT)
+    {
+      ParquetLogicalType(p_thrift,p_element);
+    }
+    else
+    {
+      p_thrift.Skip(type);
+    }
+  }
+  p_thrift.End();
+
+  // Time unit of the older converted types
+  if(p_element.m_field.m_unit == 0)
+  {
+    switch(p_element.m_field.m_converted)
+    {
+      case PARQUET_CONV_TIME_MILLIS:  // Fall through
+      case PARQUET_CONV_TS_MILLIS:    p_element.m_field.m_unit = PARQUET_UNIT_MILLIS; break;
+      case PARQUET_CONV_TIME_MICROS:  // Fall through
+      case PARQUET_CONV_TS_MICROS:    p_element.m_field.m_unit = PARQUET_UNIT_MICROS; break;
+    }
+  }
+}
+
+static ParquetColumnChunk
+ParquetColumnMeta(ThriftReader& p_thrift)
+{
+  ParquetColumnChunk chunk;
+  __int64 dataPage       = 0;
+  __int64 dictionaryPage = 0;
+  int id = 0,type = 0;
+
+  p_thrift.Begin();
+  while(p_thrift.Field(id,type))
+  {
+    if(id == 1 && type == THRIFT_BINARY)
+    {
+      throw StdException(_T("Parquet file: column chunks in other files are not supported"));
+    }
+    if(id != 3 || type != THRIFT_STRUCT)
+    {
+      p_thrift.Skip(type);
+      continue;
+    }
+    int field = 0,kind = 0;
+    p_thrift.Begin();
+    while(p_thrift.Field(field,kind))
+    {
+      if(kind != THRIFT_I32 && kind != THRIFT_I64)
+      {
+        p_thrift.Skip(kind);
+        continue;
+      }
+      __int64 value = p_thrift.Integer();
+      switch(field)
+      {
+        case 4:  chunk.m_codec   = (int)value; break;
+        case 5:  chunk.m_values  = value;      break;
+        case 7:  chunk.m_size    = value;      break;
+        case 9:  dataPage        = value;      break;
+        case 11: dictionaryPage  = value;      break;
+      }
+    }
+    p_thrift.End();
+  }
+  p_thrift.End();
+
+  // Some writers store a zero dictionary offset for chunks without one
+  chunk.m_start = (dictionaryPage > 0 && dictionaryPage < dataPage) ? dictionaryPage : dataPage;
+  return chunk;
+}
+
+static ColumnarType
+ParquetColumnar(const ParquetField& p_field)
+{
+  bool decimal = p_field.m_logical == PARQUET_LOGICAL_DECIMAL || p_field.m_converted == PARQUET_CONV_DECIMAL;
+  switch(p_field.m_physical)
+  {
+    case PARQUET_BOOLEAN:     return COLTYPE_BOOLEAN;
+    case PARQUET_INT32:       if(decimal)
+                              {
+                                return COLTYPE_DECIMAL;
+                              }
+                              if(p_field.m_logical == PARQUET_LOGICAL_INTEGER)
+                              {
+                                switch(p_field.m_bitWidth)
+                                {
+                                  case 8:  return p_field.m_signed ? COLTYPE_INT8  : COLTYPE_UINT8;
+                                  case 16: return p_field.m_signed ? COLTYPE_INT16 : COLTYPE_UINT16;
+                                  default: return p_field.m_signed ? COLTYPE_INT32 : COLTYPE_UINT32;
+                                }
+                              }
+                              switch(p_field.m_converted)
+                              {
+                                case PARQUET_CONV_INT_8:        return COLTYPE_INT8;
+                                case PARQUET_CONV_INT_16:       return COLTYPE_INT16;
+                                case PARQUET_CONV_UINT_8:       return COLTYPE_UINT8;
+                                case PARQUET_CONV_UINT_16:      return COLTYPE_UINT16;
+                                case PARQUET_CONV_UINT_32:      return COLTYPE_UINT32;
+                                case PARQUET_CONV_DATE:         return COLTYPE_DATE;
+                                case PARQUET_CONV_TIME_MILLIS:  return COLTYPE_TIME;
+                              }
+                              if(p_field.m_logical == PARQUET_LOGICAL_DATE) return COLTYPE_DATE;
+                              if(p_field.m_logical == PARQUET_LOGICAL_TIME) return COLTYPE_TIME;
+                              return COLTYPE_INT32;
+    case PARQUET_INT64:       if(decimal)
+                              {
+                                return COLTYPE_DECIMAL;
+                              }
+                              if((p_field.m_logical == PARQUET_LOGICAL_INTEGER && !p_field.m_signed) || p_field.m_converted == PARQUET_CONV_UINT_64)
+                              {
+                                return COLTYPE_UINT64;
+                              }
+                              if(p_field.m_logical == PARQUET_LOGICAL_TIME || p_field.m_converted == PARQUET_CONV_TIME_MICROS)
+                              {
+                                return COLTYPE_TIME;
+                              }
+                              if(p_field.m_logical   == PARQUET_LOGICAL_TIMESTAMP ||
+                                 p_field.m_converted == PARQUET_CONV_TS_MILLIS    ||
+                                 p_field.m_converted == PARQUET_CONV_TS_MICROS)
+                              {
+                                return COLTYPE_TIMESTAMP;
+                              }
+                              return COLTYPE_INT64;
+    case PARQUET_INT96:       return COLTYPE_TIMESTAMP;
+    case PARQUET_FLOAT:       return COLTYPE_FLOAT;
+    case PARQUET_DOUBLE:      return COLTYPE_DOUBLE;
+    case PARQUET_BYTE_ARRAY:  if(decimal)
+                              {
+                                return COLTYPE_DECIMAL;
+                              }
+                              if(p_field.m_logical   == PARQUET_LOGICAL_STRING || p_field.m_logical   == PARQUET_LOGICAL_ENUM ||
+                                 p_field.m_logical   == PARQUET_LOGICAL_JSON   || p_field.m_converted == PARQUET_CONV_UTF8    ||
+                                 p_field.m_converted == PARQUET_CONV_ENUM      || p_field.m_converted == PARQUET_CONV_JSON)
+                              {
+                                return COLTYPE_STRING;
+                              }
+                              return COLTYPE_BINARY;
+    case PARQUET_FIXED:       if(decimal)
+                              {
+                                return COLTYPE_DECIMAL;
+                              }
+                              if(p_field.m_logical == PARQUET_LOGICAL_UUID && p_field.m_length == 16)
+                              {
+                                return COLTYPE_GUID;
+                              }
+                              return COLTYPE_BINARY;
+  }
+  return COLTYPE_UNKNOWN;
+}
+
+// Splits a PLAIN encoded page into its values
+static void
+ParquetPlainValues(const ParquetField& p_field,const BYTE* p_data,size_t p_size,size_t p_count,std::vector<ParquetValue>& p_values)
+{
+  p_values.clear();
+  p_values.reserve(p_count);
+  if(p_field.m_physical == PARQUET_BOOLEAN)
+  {
+    if(p_count > p_size * 8)
+    {
+      throw StdException(_T("Parquet file is corrupt: boolean values"));
+    }
+    for(size_t index = 0;index < p_count;++index)
+    {
+      p_values.push_back({ &parquet_booleans[(p_data[index >> 3] >> (index & 7)) & 1],1 });
+    }
+    return;
+  }
+  if(p_field.m_physical == PARQUET_BYTE_ARRAY)
+  {
+    size_t position = 0;
+    for(size_t index = 0;index < p_count;++index)
+    {
+      unsigned length = 0;
+      if(p_size - position < 4)
+      {
+        throw StdException(_T("Parquet file is corrupt: byte array values"));
+      }
+      memcpy(&length,p_data + position,4);
+      position += 4;
+      if(length > p_size - position)
+      {
+        throw StdException(_T("Parquet file is corrupt: byte array values"));
+      }
+      p_values.push_back({ p_data + position,length });
+      position += length;
+    }
+    return;
+  }
+  size_t width = 0;
+  switch(p_field.m_physical)
+  {
+    case PARQUET_INT32:   // Fall through
+    case PARQUET_FLOAT:   width = 4;  break;
+    case PARQUET_INT64:   // Fall through
+    case PARQUET_DOUBLE:  width = 8;  break;
+    case PARQUET_INT96:   width = 12; break;
+    case PARQUET_FIXED:   width = p_field.m_length > 0 ? (size_t)p_field.m_length : 0; break;
+  }
+  if(width == 0 || p_count > p_size / width)
+  {
+    throw StdException(_T("Parquet file is corrupt: fixed width values"));
+  }
+  for(size_t index = 0;index < p_count;++index)
+  {
+    p_values.push_back({ p_data + index * width,width });
+  }
+}
+
+static __int64
+ParquetInteger(const ParquetValue& p_value)
+{
+  if(p_value.m_length == 4)
+  {
+    int value = 0;
+    memcpy(&value,p_value.m_data,4);
+    return value;
+  }
+  __int64 value = 0;
+  memcpy(&value,p_value.m_data,min(p_value.m_length,(size_t)8));
+  return value;
+}
+
+// Floor division by a positive divisor
+static __int64
+ScaleDown(__int64 p_value,__int64 p_divisor)
+{
+  __int64 result = p_value / p_divisor;
+  return (p_value % p_divisor < 0) ? result - 1 : result;
+}
+
+// Append one value in the layout of the column
+static void
+ParquetAppend(const ParquetField& p_field,const ColumnarColumn& p_column,const ParquetValue& p_value,ColumnarBuffer& p_buffer)
+{
+  std::vector<BYTE>& data = p_buffer.m_data;
+  switch(p_column.m_columnar)
+  {
+    case COLTYPE_STRING:    // Fall through
+    case COLTYPE_BINARY:    data.insert(data.end(),p_value.m_data,p_value.m_data + p_value.m_length);
+                            if(data.size() > INT_MAX)
+                            {
+                              throw StdException(_T("Parquet row group too large for column: ") + p_column.m_name);
+                            }
+                            p_buffer.m_offsets.push_back((int)data.size());
+                            return;
+    case COLTYPE_TIME:      {
+                              __int64 value = ParquetInteger(p_value);
+                              switch(p_field.m_unit)
+                              {
+                                case PARQUET_UNIT_MICROS: value = ScaleDown(value,1000);    break;
+                                case PARQUET_UNIT_NANOS:  value = ScaleDown(value,1000000); break;
+                              }
+                              AppendPlain<int>(data,(int)value);
+                            }
+                            return;
+    case COLTYPE_TIMESTAMP: {
+                              // Out of range values wrap around instead of overflowing
+                              __int64 value = 0;
+                              if(p_field.m_physical == PARQUET_INT96)
+                              {
+                                // Nanoseconds of the day and the Julian day
+                                __int64 nanos = 0;
+                                int     day   = 0;
+                                memcpy(&nanos,p_value.m_data,8);
+                                memcpy(&day,p_value.m_data + 8,4);
+                                value = (__int64)((unsigned __int64)(day - PARQUET_JULIAN_EPOCH) * 86400000000ULL + (unsigned __int64)ScaleDown(nanos,1000));
+                              }
+                              else
+                              {
+                                value = ParquetInteger(p_value);
+                                switch(p_field.m_unit)
+                                {
+                                  case PARQUET_UNIT_MILLIS: value  = (__int64)((unsigned __int64)value * 1000); break;
+                                  case PARQUET_UNIT_NANOS:  value  = ScaleDown(value,1000); break;
+                                }
+                              }
+                              AppendPlain<__int64>(data,value);
+                            }
+                            return;
+    case COLTYPE_DECIMAL:   {
+                              // 128 bits little-endian of a sign extended integer or big-endian bytes
+                              BYTE decimal[16];
+                              if(p_field.m_physical == PARQUET_INT32 || p_field.m_physical == PARQUET_INT64)
+                              {
+                                __int64 value = ParquetInteger(p_value);
+                                memset(decimal,value < 0 ? 0xFF : 0,16);
+                                memcpy(decimal,&value,8);
+                              }
+                              else
+                              {
+                                if(p_value.m_length > 16)
+                                {
+                                  throw StdException(_T("Parquet file: decimal wider than 128 bits in column: ") + p_column.m_name);
+                                }
+                                memset(decimal,(p_value.m_length && (p_value.m_data[0] & 0x80)) ? 0xFF : 0,16);
+                                for(size_t index = 0;index < p_value.m_length;++index)
+                                {
+                                  decimal[index] = p_value.m_data[p_value.m_length - 1 - index];
+                                }
+                              }
+                              data.insert(data.end(),decimal,decimal + 16);
+                            }
+                            return;
+    default:                // Little-endian: the low bytes of the physical value
+                            if(p_value.m_length >= (size_t)p_column.m_width)
+                            {
+                              data.insert(data.end(),p_value.m_data,p_value.m_data + p_column.m_width);
+                            }
+                            else
+                            {
+                              data.resize(data.size() + p_column.m_width,0);
+                            }
+                            return;
+  }
+}
+
+static void
+ParquetPageHeader(ThriftReader& p_thrift,ParquetPage& p_page)
+{
+  int id = 0,type = 0;
+  p_thrift.Begin();
+  while(p_thrift.Field(id,type))
+  {
+    if((id == 1 || id == 2 || id == 3) && type == THRIFT_I32)
+    {
+      __int64 value = p_thrift.Integer();
+      switch(id)
+      {
+        case 1: p_page.m_type         = (int)value; break;
+        case 2: p_page.m_uncompressed = value;      break;
+        case 3: p_page.m_compressed   = value;      break;
+      }
+      continue;
+    }
+    if((id != 5 && id != 7 && id != 8) || type != THRIFT_STRUCT)
+    {
+      p_thrift.Skip(type);
+      continue;
+    }
+    // DataPageHeader, DictionaryPageHeader or DataPageHeaderV2
+    int field = 0,kind = 0;
+    p_thrift.Begin();
+    while(p_thrift.Field(field,kind))
+    {
+      if(id == 8 && field == 7 && (kind == THRIFT_BOOLEAN_TRUE || kind == THRIFT_BOOLEAN_FALSE))
+      {
+        p_page.m_isCompressed = kind == THRIFT_BOOLEAN_TRUE;
+        continue;
+      }
+      if(kind != THRIFT_I32)
+      {
+        p_thrift.Skip(kind);
+        continue;
+      }
+      __int64 value = p_thrift.Integer();
+      if(field == 1)
+      {
+        p_page.m_values = value;
+      }
+      else if(id == 8)
+      {
+        switch(field)
+        {
+          case 4: p_page.m_encoding   = (int)value; break;
+          case 5: p_page.m_definition = value;      break;
+          case 6: p_page.m_repetition = value;      break;
+        }
+      }
+      else if(field == 2)
+      {
+        p_page.m_encoding = (int)value;
+      }
+    }
+    p_thrift.End();
+  }
+  p_thrift.End();
+  if(p_page.m_compressed < 0 || p_page.m_uncompressed < 0 || p_page.m_values < 0)
+  {
+    throw StdException(_T("Parquet file is corrupt: page header"));
+  }
+}
+
+SQLParquetReader::SQLParquetReader()
+{
+}
+
+bool
+SQLParquetReader::ReadHeader()
+{
+  m_fields.clear();
+  m_groupRows.clear();
+  m_groups.clear();
+  m_nextGroup = 0;
+
+  __int64 size = GetFileSize();
+  if(size < 12)
+  {
+    return false;
+  }
+  char magic[4];
+  BYTE trailer[8];
+  SeekFile(0);
+  ReadBytes(magic,sizeof(magic));
+  SeekFile(size - 8);
+  ReadBytes(trailer,sizeof(trailer));
+  if(memcmp(magic,parquet_magic,4) != 0 || memcmp(trailer + 4,parquet_magic,4) != 0)
+  {
+    return false;
+  }
+  unsigned length = 0;
+  memcpy(&length,trailer,4);
+  if(length == 0 || length > size - 12)
+  {
+    throw StdException(_T("Parquet file is corrupt: footer length"));
+  }
+  std::vector<BYTE> footer(length);
+  SeekFile(size - 8 - length);
+  ReadBytes(footer.data(),footer.size());
+  __int64 pages = size - 8 - length;
+
+  std::vector<ParquetElement> elements;
+  std::string types;
+  ThriftReader thrift(footer.data(),footer.size());
+  int id = 0,type = 0,element = 0;
+  thrift.Begin();
+  while(thrift.Field(id,type))
+  {
+    if(id == 2 && type == THRIFT_LIST)
+    {
+      size_t count = thrift.List(element);
+      for(size_t index = 0;index < count;++index)
+      {
+        elements.emplace_back();
+        ParquetSchemaElement(thrift,elements.back());
+      }
+    }
+    else if(id == 4 && type == THRIFT_LIST)
+    {
+      // RowGroup: the column chunks and the number of rows
+      size_t count = thrift.List(element);
+      for(size_t index = 0;index < count;++index)
+      {
+        std::vector<ParquetColumnChunk> chunks;
+        __int64 rows = -1;
+        int field = 0,kind = 0;
+        thrift.Begin();
+        while(thrift.Field(field,kind))
+        {
+          if(field == 1 && kind == THRIFT_LIST)
+          {
+            size_t columns = thrift.List(element);
+            for(size_t column = 0;column < columns;++column)
+            {
+              chunks.push_back(ParquetColumnMeta(thrift));
+            }
+          }
+          else if(field == 3 && kind == THRIFT_I64)
+          {
+            rows = thrift.Integer();
+          }
+          else
+          {
+            thrift.Skip(kind);
+          }
+        }
+        thrift.End();
+        m_groups.push_back(chunks);
+        m_groupRows.push_back(rows);
+      }
+    }
+    else if(id == 5 && type == THRIFT_LIST)
+    {
+      // KeyValue metadata
+      size_t count = thrift.List(element);
+      for(size_t index = 0;index < count;++index)
+      {
+        std::string key,value;
+        int field = 0,kind = 0;
+        thrift.Begin();
+        while(thrift.Field(field,kind))
+        {
+          if(field == 1 && kind == THRIFT_BINARY)
+          {
+            key = thrift.String();
+          }
+          else if(field == 2 && kind == THRIFT_BINARY)
+          {
+            value = thrift.String();
+          }
+          else
+          {
+            thrift.Skip(kind);
+          }
+        }
+        thrift.End();
+        if(key == SQLCOLUMNAR_METADATA)
+        {
+          types = value;
+        }
+      }
+    }
+    else
+    {
+      thrift.Skip(type);
+    }
+  }
+  thrift.End();
+
+  // Flat schema only: the root and its leaf columns
+  if(elements.empty() || elements[0].m_children != (int)elements.size() - 1)
+  {
+    throw StdException(_T("Parquet file: only flat schemas are supported"));
+  }
+  for(size_t index = 1;index < elements.size();++index)
+  {
+    ParquetElement& column = elements[index];
+    if(!column.m_leaf || column.m_children > 0 || column.m_repetition == PARQUET_REPEATED)
+    {
+      throw StdException(_T("Parquet file: nested and repeated columns are not supported"));
+    }
+    column.m_field.m_optional = column.m_repetition == PARQUET_OPTIONAL;
+    XString name = ColumnarFromUTF8(reinterpret_cast<const BYTE*>(column.m_name.data()),(int)column.m_name.size());
+    ColumnarType columnar = ParquetColumnar(column.m_field);
+    if(columnar == COLTYPE_UNKNOWN)
+    {
+      throw StdException(_T("Parquet file: unsupported type of column: ") + name);
+    }
+    AddColumn(name,columnar,column.m_precision,column.m_scale);
+    m_fields.push_back(column.m_field);
+  }
+  for(size_t group = 0;group < m_groups.size();++group)
+  {
+    if(m_groups[group].size() != m_fields.size() || m_groupRows[group] < 0 || m_groupRows[group] > INT_MAX)
+    {
+      throw StdException(_T("Parquet file is corrupt: row group"));
+    }
+    for(const auto& chunk : m_groups[group])
+    {
+      if(chunk.m_start < 4 || chunk.m_size <= 0 || chunk.m_size > pages - chunk.m_start)
+      {
+        throw StdException(_T("Parquet file is corrupt: column chunk"));
+      }
+    }
+  }
+  if(!types.empty())
+  {
+    SetTypesMetadata(types);
+  }
+  return true;
+}
+
+bool
+SQLParquetReader::ReadRowGroup(unsigned& p_rows)
+{
+  if(m_nextGroup >= m_groups.size())
+  {
+    return false;
+  }
+  p_rows = (unsigned)m_groupRows[m_nextGroup];
+  for(size_t index = 0;index < m_fields.size();++index)
+  {
+    ReadColumnChunk((int)index,m_groups[m_nextGroup][index],p_rows);
+  }
+  ++m_nextGroup;
+  return true;
+}
+
+// Decodes the pages of a column chunk until it has all rows of the group
+void
+SQLParquetReader::ReadColumnChunk(int p_column,const ParquetColumnChunk& p_chunk,unsigned p_rows)
+{
+  const ParquetField&   field  = m_fields[p_column];
+  const ColumnarColumn& column = m_schema[p_column];
+  ColumnarBuffer&       buffer = m_buffers[p_column];
+  buffer.m_valid.clear();
+  buffer.m_data.clear();
+  buffer.m_offsets.assign(1,0);
+
+  std::vector<BYTE> chunk((size_t)p_chunk.m_size);
+  SeekFile(p_chunk.m_start);
+  ReadBytes(chunk.data(),chunk.size());
+
+  std::vector<BYTE>         dictionaryPage;   // Holds the dictionary values
+  std::vector<ParquetValue> dictionary;
+  bool                      hasDictionary = false;
+  std::vector<BYTE>         page;
+  std::vector<unsigned>     levels;
+  std::vector<unsigned>     indices;
+  std::vector<ParquetValue> values;
+  size_t position = 0;
+
+  while(buffer.m_valid.size() < p_rows)
+  {
+    if(position >= chunk.size())
+    {
+      throw StdException(_T("Parquet file is corrupt: missing pages of column: ") + column.m_name);
+    }
+    ParquetPage  header;
+    ThriftReader thrift(chunk.data() + position,chunk.size() - position);
+    ParquetPageHeader(thrift,header);
+    position += thrift.GetPosition();
+    if(header.m_compressed > (__int64)(chunk.size() - position))
+    {
+      throw StdException(_T("Parquet file is corrupt: page of column: ") + column.m_name);
+    }
+    const BYTE* data = chunk.data() + position;
+    size_t      size = (size_t)header.m_compressed;
+    position += size;
+
+    if(header.m_type == PARQUET_PAGE_DICTIONARY)
+    {
+      if(header.m_encoding != PARQUET_PLAIN && header.m_encoding != PARQUET_PLAIN_DICTIONARY)
+      {
+        throw StdException(_T("Parquet file: unsupported dictionary encoding in column: ") + column.m_name);
+      }
+      ParquetDecompress(p_chunk.m_codec,data,size,header.m_uncompressed,dictionaryPage);
+      ParquetPlainValues(field,dictionaryPage.data(),dictionaryPage.size(),(size_t)header.m_values,dictionary);
+      hasDictionary = true;
+      continue;
+    }
+    if(header.m_type != PARQUET_PAGE_DATA && header.m_type != PARQUET_PAGE_DATA_V2)
+    {
+      // Index pages
+      continue;
+    }
+    if(header.m_values > (__int64)(p_rows - buffer.m_valid.size()))
+    {
+      throw StdException(_T("Parquet file is corrupt: too many values in column: ") + column.m_name);
+    }
+    size_t      count   = (size_t)header.m_values;
+    const BYTE* content = nullptr;
+    size_t      length  = 0;
+    levels.clear();
+
+    if(header.m_type == PARQUET_PAGE_DATA)
+    {
+      ParquetDecompress(p_chunk.m_codec,data,size,header.m_uncompressed,page);
+      content = page.data();
+      length  = page.size();
+      if(field.m_optional)
+      {
+        unsigned levelLength = 0;
+        if(length < 4)
+        {
+          throw StdException(_T("Parquet file is corrupt: definition levels of column: ") + column.m_name);
+        }
+        memcpy(&levelLength,content,4);
+        if(levelLength > length - 4)
+        {
+          throw StdException(_T("Parquet file is corrupt: definition levels of column: ") + column.m_name);
+        }
+        HybridDecode(content + 4,levelLength,1,count,levels);
+        content += 4 + levelLength;
+        length  -= 4 + levelLength;
+      }
+    }
+    else
+    {
+      // Version 2: the levels are never compressed
+      if(header.m_repetition < 0 || header.m_definition < 0 ||
+         header.m_repetition + header.m_definition > (__int64)size)
+      {
+        throw StdException(_T("Parquet file is corrupt: levels of column: ") + column.m_name);
+      }
+      size_t skip = (size_t)(header.m_repetition + header.m_definition);
+      if(field.m_optional)
+      {
+        HybridDecode(data + header.m_repetition,(size_t)header.m_definition,1,count,levels);
+      }
+      if(header.m_isCompressed)
+      {
+        ParquetDecompress(p_chunk.m_codec,data + skip,size - skip,header.m_uncompressed - (__int64)skip,page);
+        content = page.data();
+        length  = page.size();
+      }
+      else
+      {
+        content = data + skip;
+        length  = size - skip;
+      }
+    }
+
+    size_t defined = levels.empty() ? count : (size_t)std::count(levels.begin(),levels.end(),1U);
+    if(header.m_encoding == PARQUET_PLAIN)
+    {
+      ParquetPlainValues(field,content,length,defined,values);
+    }
+    else if(header.m_encoding == PARQUET_PLAIN_DICTIONARY || header.m_encoding == PARQUET_RLE_DICTIONARY)
+    {
+      if(!hasDictionary || length < 1 || content[0] > 32)
+      {
+        throw StdException(_T("Parquet file is corrupt: dictionary indices of column: ") + column.m_name);
+      }
+      HybridDecode(content + 1,length - 1,content[0],defined,indices);
+      values.clear();
+      for(unsigned index : indices)
+      {
+        if(index >= dictionary.size())
+        {
+          throw StdException(_T("Parquet file is corrupt: dictionary index of column: ") + column.m_name);
+        }
+        values.push_back(dictionary[index]);
+      }
+    }
+    else if(header.m_encoding == PARQUET_RLE && field.m_physical == PARQUET_BOOLEAN)
+    {
+      // Booleans of version 2 pages: a length and the hybrid with bit width 1
+      unsigned runs = 0;
+      if(length < 4)
+      {
+        throw StdException(_T("Parquet file is corrupt: boolean values of column: ") + column.m_name);
+      }
+      memcpy(&runs,content,4);
+      if(runs > length - 4)
+      {
+        throw StdException(_T("Parquet file is corrupt: boolean values of column: ") + column.m_name);
+      }
+      HybridDecode(content + 4,runs,1,defined,indices);
+      values.clear();
+      for(unsigned index : indices)
+      {
+        values.push_back({ &parquet_booleans[index & 1],1 });
+      }
+    }
+    else
+    {
+      throw StdException(_T("Parquet file: only PLAIN and dictionary encodings are supported. Column: ") + column.m_name);
+    }
+
+    size_t next = 0;
+    for(size_t index = 0;index < count;++index)
+    {
+      if(levels.empty() || levels[index] == 1)
+      {
+        ParquetAppend(field,column,values[next++],buffer);
+        buffer.m_valid.push_back(1);
+      }
+      else
+      {
+        if(column.m_width)
+        {
+          buffer.m_data.resize(buffer.m_data.size() + column.m_width,0);
+        }
+        else
+        {
+          buffer.m_offsets.push_back((int)buffer.m_data.size());
+        }
+        buffer.m_valid.push_back(0);
+      }
+    }
+  }
+}
+
+}
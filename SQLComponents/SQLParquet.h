@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLParquet.h
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#pragma once
+#include "SQLColumnar.h"
+
+namespace SQLComponents
+{
+
+// Apache Parquet files ("*.parquet")
+//
+// The writer creates a flat schema of OPTIONAL columns. Every row group has
+// one column chunk per column with one data page (version 1). String and
+// binary chunks with few distinct values get a dictionary page and
+// RLE_DICTIONARY encoded indices, all other values are PLAIN encoded.
+// Compressed files use GZIP pages. The metadata is Thrift compact protocol.
+//
+// The reader accepts flat schemas of REQUIRED and OPTIONAL columns, data pages
+// of version 1 and 2, the PLAIN, PLAIN_DICTIONARY and RLE_DICTIONARY encodings,
+// INT96 timestamps, and the UNCOMPRESSED, SNAPPY and GZIP codecs. Nested and
+// repeated columns, other encodings and other codecs are refused.
+
+// Column chunk of the writer
+typedef struct _parquetChunk
+{
+  __int64 m_dataPage        { 0 };
+  __int64 m_dictionaryPage  { -1 };   // -1 = no dictionary
+  __int64 m_uncompressed    { 0 };    // Size of the chunk, with page headers
+  __int64 m_compressed      { 0 };
+}
+ParquetChunk;
+
+// Row group of the writer
+typedef struct _parquetRowGroup
+{
+  __int64                   m_rows  { 0 };
+  __int64                   m_bytes { 0 };
+  std::vector<ParquetChunk> m_chunks;
+}
+ParquetRowGroup;
+
+// Column of a file, as far as the reader needs it
+typedef struct _parquetField
+{
+  int  m_physical   { 0 };      // Physical type
+  int  m_length     { 0 };      // FIXED_LEN_BYTE_ARRAY length
+  bool m_optional   { false };  // Maximum definition level of 1
+  int  m_converted  { -1 };     // ConvertedType. -1 = none
+  int  m_logical    { 0 };      // LogicalType union. 0 = none
+  int  m_unit       { 0 };      // Time unit of TIME and TIMESTAMP
+  int  m_bitWidth   { 0 };      // INTEGER
+  bool m_signed     { true };   // INTEGER
+}
+ParquetField;
+
+// Column chunk of the reader
+typedef struct _parquetColumnChunk
+{
+  __int64 m_start   { 0 };      // First page
+  __int64 m_size    { 0 };      // Total compressed size
+  __int64 m_values  { 0 };
+  int     m_codec   { 0 };
+}
+ParquetColumnChunk;
+
+class SQLParquetWriter : public SQLColumnarWriter
+{
+public:
+  explicit SQLParquetWriter(const SQLColumnarOptions& p_options = SQLColumnarOptions());
+
+protected:
+  void WriteHeader() override;
+  void WriteSchema(unsigned p_rows) override;
+  void WriteRowGroup(unsigned p_rows) override;
+  void WriteFooter() override;
+
+private:
+  void WritePage(bool p_dictionary,int p_values,int p_encoding,const std::vector<BYTE>& p_content,ParquetChunk& p_chunk);
+
+  std::vector<ParquetRowGroup> m_rowGroups;
+};
+
+class SQLParquetReader : public SQLColumnarReader
+{
+public:
+  SQLParquetReader();
+
+protected:
+  bool ReadHeader() override;
+  bool ReadRowGroup(unsigned& p_rows) override;
+
+private:
+  void ReadColumnChunk(int p_column,const ParquetColumnChunk& p_chunk,unsigned p_rows);
+
+  std::vector<ParquetField>                    m_fields;     // One per column
+  std::vector<__int64>                         m_groupRows;  // Rows of the row groups
+  std::vector<std::vector<ParquetColumnChunk>> m_groups;     // Column chunks of the row groups
+  size_t                                       m_nextGroup { 0 };
+};
+
+}
@@ -33,6 +33,7 @@
 #include "bcd.h"
 #include "sqlncli.h"
 #include <sqlext.h>
+#include <Metrics.h>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -43,6 +44,10 @@ static char THIS_FILE[] = __FILE__;
 namespace SQLComponents
 {
 
+// Execute and fetch times of all queries
+static MetricHistogram* s_executeTime = GetMetricsRegistry().GetHistogram(_T("sql_query_execute_seconds"),_T("Executing SQL statements by SQLQuery"));
+static MetricHistogram* s_fetchTime   = GetMetricsRegistry().GetHistogram(_T("sql_query_fetch_seconds"),  _T("Fetching a record by SQLQuery"));
+
 // CTOR: To be later connected to a database
 // by calling Init() seperatly
 SQLQuery::SQLQuery()
@@ -687,7 +692,9 @@ SQLQuery::DoSQLStatement(const XString& p_statement)
   } 
 
   // GO DO IT RIGHT AWAY
+  MetricTimer timer(s_executeTime);
   m_retCode = SqlExecDirect(m_hstmt,reinterpret_cast<SQLTCHAR*>(const_cast<TCHAR*>(statement.GetString())),lengthStatement);
+  timer.Stop();
 
   if(SQL_SUCCEEDED(m_retCode))
   {
@@ -941,11 +948,13 @@ SQLQuery::DoSQLExecute(bool p_rebind /*=false*/)
   }
 
   // Go execute it (again)
+  MetricTimer timer(s_executeTime);
   m_retCode = SqlExecute(m_hstmt);
   if(m_retCode == SQL_NEED_DATA)
   {
     m_retCode = (short)ProvideAtExecData();
   }
+  timer.Stop();
 
   if(SQL_SUCCEEDED(m_retCode))
   {
@@ -1567,7 +1576,9 @@ SQLQuery::GetRecord()
   ResetColumns();
 
   // Do the fetch
+  MetricTimer timer(s_fetchTime);
   m_retCode = SqlFetch(m_hstmt);
+  timer.Stop();
   if(SQL_SUCCEEDED(m_retCode))
   {
     // Gotten record
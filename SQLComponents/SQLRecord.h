@@ -57,6 +57,7 @@ public:
   SQLVariant* GetField(int p_num) const;
   SQLVariant* GetField(XString p_name) const;
   int         GetGenerator() const;
+  SQLDataSet* GetDataSet() const;
   // Setting a generator column
   void        SetGenerator(int p_generator);
   // Adding a field to the record
@@ -175,5 +176,11 @@ SQLRecord::GetNumberOfFields() const
   return (int) m_fields.size();
 }
 
+inline SQLDataSet*
+SQLRecord::GetDataSet() const
+{
+  return m_dataSet;
+}
+
 // End of namespace
 }
\ No newline at end of file
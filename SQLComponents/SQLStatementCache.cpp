@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLStatementCache.cpp
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#include "stdafx.h"
+#include "SQLComponents.h"
+#include "SQLStatementCache.h"
+#include <AutoCritical.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+namespace SQLComponents
+{
+
+SQLStatementCache::SQLStatementCache(unsigned p_maxStatements /*= SQLSTATEMENT_CACHE_SIZE*/)
+                  :m_maxStatements(p_maxStatements)
+{
+  InitializeCriticalSection(&m_lock);
+}
+
+SQLStatementCache::~SQLStatementCache()
+{
+  Reset();
+  DeleteCriticalSection(&m_lock);
+}
+
+bool
+SQLStatementCache::FindStatement(const XString& p_key,XString& p_statement)
+{
+  AutoCritSec lock(&m_lock);
+
+  auto it = m_statements.find(p_key);
+  if(it == m_statements.end())
+  {
+    ++m_misses;
+    return false;
+  }
+  p_statement = it->second;
+  ++m_hits;
+  return true;
+}
+
+void
+SQLStatementCache::StoreStatement(const XString& p_key,const XString& p_statement)
+{
+  AutoCritSec lock(&m_lock);
+
+  // Shapes come from program code, so the set is normally small.
+  // Should a program generate shapes without end, we start all over again.
+  if(m_statements.size() >= m_maxStatements)
+  {
+    m_statements.clear();
+  }
+  m_statements[p_key] = p_statement;
+}
+
+void
+SQLStatementCache::Reset()
+{
+  AutoCritSec lock(&m_lock);
+  m_statements.clear();
+}
+
+unsigned
+SQLStatementCache::GetSize()
+{
+  AutoCritSec lock(&m_lock);
+  return (unsigned)m_statements.size();
+}
+
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: SQLStatementCache.h
+//
+// Copyright (c) 1998-2025 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version number: See SQLComponents.h
+#pragma once
+#include "SQLComponents.h"
+#include <XString.h>
+#include <map>
+
+namespace SQLComponents
+{
+
+// Default maximum of different statement shapes remembered by one cache
+#define SQLSTATEMENT_CACHE_SIZE 256
+
+// Cache of fully rendered SELECT statements.
+// The key is the 'shape' of a selection: the base query, the filter fields and operators
+// and the ordering, but never the filter values. Values are bound as parameters in the
+// same order that SQLFilterSet::ParseFiltersToCondition binds them.
+
+class SQLStatementCache
+{
+public:
+  explicit SQLStatementCache(unsigned p_maxStatements = SQLSTATEMENT_CACHE_SIZE);
+ ~SQLStatementCache();
+
+  // Find a rendered statement for a shape key
+  bool      FindStatement (const XString& p_key,XString& p_statement);
+  // Remember a rendered statement for a shape key
+  void      StoreStatement(const XString& p_key,const XString& p_statement);
+  // Forget all statements (e.g. after a change in the mapping)
+  void      Reset();
+
+  // GETTERS
+  unsigned  GetSize();
+  unsigned  GetHits()   { return m_hits;   }
+  unsigned  GetMisses() { return m_misses; }
+
+private:
+  std::map<XString,XString> m_statements;   // Shape key -> rendered SQL text
+  unsigned  m_maxStatements;                // Upper limit on the number of shapes
+  unsigned  m_hits   { 0 };                 // Number of statements found
+  unsigned  m_misses { 0 };                 // Number of statements rendered
+  CRITICAL_SECTION m_lock;                  // Locking for multi-threaded sessions
+};
+
+}
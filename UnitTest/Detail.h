@@ -44,6 +44,8 @@ public:
 
   // Serialization of our persistent objects
   DECLARE_CXO_SERIALIZATION;
+  // Ordinal bound de-serialization of result sets
+  DECLARE_CXO_ORDINALS(Detail);
 
   // GETTERS
   int     GetID()            { return m_id;          };
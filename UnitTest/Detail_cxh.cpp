@@ -74,6 +74,14 @@ BEGIN_DBS_DESERIALIZE(Detail,CXObject)
   CXO_DBS_DESERIALIZE(m_amount,     _T("amount"));
 END_DBS_DESERIALIZE
 
+BEGIN_DBS_ORDINALS(Detail,CXObject)
+  CXO_DBS_ORDINAL(m_id,         _T("id"));
+  CXO_DBS_ORDINAL(m_mast_id,    _T("mast_id"));
+  CXO_DBS_ORDINAL(m_line,       _T("line"));
+  CXO_DBS_ORDINAL(m_description,_T("description"));
+  CXO_DBS_ORDINAL(m_amount,     _T("amount"));
+END_DBS_ORDINALS
+
 BEGIN_DESERIALIZE_GENERATOR(Detail)
   CXO_DBS_DESERIALIZE(m_id, _T("id"));
 END_DESERIALIZE_GENERATOR
@@ -37,6 +37,8 @@ public:
 
   // Serialization of our persistent objects
   DECLARE_CXO_SERIALIZATION;
+  // Ordinal bound de-serialization of result sets
+  DECLARE_CXO_ORDINALS(Master);
 
   // GETTERS
   int     GetID()           { return m_id;          };
@@ -66,6 +66,13 @@ BEGIN_DBS_DESERIALIZE(Master,CXObject)
   CXO_DBS_DESERIALIZE(m_total,      _T("total"));
 END_DBS_DESERIALIZE
 
+BEGIN_DBS_ORDINALS(Master,CXObject)
+  CXO_DBS_ORDINAL(m_id,         _T("id"));
+  CXO_DBS_ORDINAL(m_invoice,    _T("invoice"));
+  CXO_DBS_ORDINAL(m_description,_T("description"));
+  CXO_DBS_ORDINAL(m_total,      _T("total"));
+END_DBS_ORDINALS
+
 BEGIN_DESERIALIZE_GENERATOR(Master)
   CXO_DBS_DESERIALIZE(m_id,_T("id"));
 END_DESERIALIZE_GENERATOR
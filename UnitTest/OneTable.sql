@@ -8,6 +8,7 @@ create table subject
    ,adresline1      varchar(250)
    ,adresline2      varchar(250)
    ,account_id      integer
+   ,changed         timestamp
    -- Natural person
    ,firstname       varchar(200)
    ,date_of_birth   timestamp
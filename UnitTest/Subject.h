@@ -29,6 +29,7 @@ public:
   CString    GetAdresline1()      { return m_adresline1;        };
   CString    GetAdresline2()      { return m_adresline2;        };
   int        GetAccount_id()      { return m_account_id;        };
+  SQLTimestamp GetChanged()       { return m_changed;           };
 
   // SETTERS
   void       SetName(CString p_name)             { m_name       = p_name;       };
@@ -43,6 +44,7 @@ protected:
   CString    m_adresline1        ;
   CString    m_adresline2        ;
   int        m_account_id         { 0 };
+  SQLTimestamp m_changed         ;
 
 private:
   // Transient attributes go here
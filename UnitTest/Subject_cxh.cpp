@@ -18,6 +18,7 @@ BEGIN_XML_SERIALIZE(Subject,CXObject)
   CXO_XML_SERIALIZE(m_adresline1      ,_T("adresline1"));
   CXO_XML_SERIALIZE(m_adresline2      ,_T("adresline2"));
   CXO_XML_SERIALIZE(m_account_id      ,_T("account_id"));
+  CXO_XML_SERIALIZE(m_changed         ,_T("changed"));
 END_XML_SERIALIZE
 
 BEGIN_XML_DESERIALIZE(Subject,CXObject)
@@ -26,6 +27,7 @@ BEGIN_XML_DESERIALIZE(Subject,CXObject)
   CXO_XML_DESERIALIZE(m_adresline1      ,_T("adresline1"));
   CXO_XML_DESERIALIZE(m_adresline2      ,_T("adresline2"));
   CXO_XML_DESERIALIZE(m_account_id      ,_T("account_id"));
+  CXO_XML_DESERIALIZE(m_changed         ,_T("changed"));
 END_XML_DESERIALIZE
 
 BEGIN_DBS_SERIALIZE(Subject,CXObject)
@@ -34,6 +36,7 @@ BEGIN_DBS_SERIALIZE(Subject,CXObject)
   CXO_DBS_SERIALIZE(m_adresline1      ,_T("adresline1"));
   CXO_DBS_SERIALIZE(m_adresline2      ,_T("adresline2"));
   CXO_DBS_SERIALIZE(m_account_id      ,_T("account_id"));
+  CXO_DBS_SERIALIZE(m_changed         ,_T("changed"));
 END_DBS_SERIALIZE
 
 BEGIN_DBS_DESERIALIZE(Subject,CXObject)
@@ -42,6 +45,7 @@ BEGIN_DBS_DESERIALIZE(Subject,CXObject)
   CXO_DBS_DESERIALIZE(m_adresline1      ,_T("adresline1"));
   CXO_DBS_DESERIALIZE(m_adresline2      ,_T("adresline2"));
   CXO_DBS_DESERIALIZE(m_account_id      ,_T("account_id"));
+  CXO_DBS_DESERIALIZE(m_changed         ,_T("changed"));
 END_DBS_DESERIALIZE
 
 BEGIN_DESERIALIZE_GENERATOR(Subject)
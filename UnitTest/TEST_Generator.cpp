@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: TEST_Generator.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include <CppUnitTest.h>
+#include <CXSession.h>
+#include <CXGenerator.h>
+#include <SQLAutoDBS.h>
+#include <SQLComponents.h>
+#include <SQLVariant.h>
+#include <SQLQuery.h>
+#include <set>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace SQLComponents;
+
+namespace HibernateTest
+{
+  // Client side key generators: hilo, pooled, table and uuidv7
+  TEST_CLASS(KeyGenerators)
+  {
+  public:
+    ~KeyGenerators()
+    {
+      hibernate.CloseAllSessions();
+    }
+
+    TEST_METHOD(T01_StrategyNames)
+    {
+      Logger::WriteMessage(_T("T01_StrategyNames: configuration names of the strategies"));
+
+      CXGenStrategy strategies[] = { GEN_NATIVE,GEN_HILO,GEN_POOLED,GEN_TABLE,GEN_UUIDV7 };
+      for(auto strategy : strategies)
+      {
+        Assert::IsTrue(CXStringToGenStrategy(CXGenStrategyToString(strategy)) == strategy);
+      }
+      Assert::IsTrue(CXStringToGenStrategy(_T("HiLo"))    == GEN_HILO);
+      Assert::IsTrue(CXStringToGenStrategy(_T("unknown")) == GEN_NATIVE);
+
+      // Native keys are taken by the INSERT, never by the client
+      CXGenerator native(_T("native_seq"),GEN_NATIVE);
+      Assert::IsFalse(native.IsClientSide());
+      Assert::ExpectException<StdException>([&native]() { native.NextKey(); });
+
+      // A block strategy needs a session for its database
+      CXGenerator hilo(_T("hilo_seq"),GEN_HILO,1,10);
+      Assert::IsTrue(hilo.IsClientSide());
+      Assert::ExpectException<StdException>([&hilo]() { hilo.NextKey(); });
+    }
+
+    TEST_METHOD(T02_UUIDv7)
+    {
+      Logger::WriteMessage(_T("T02_UUIDv7: time ordered and unique version 7 UUIDs"));
+
+      CXGenerator generator(_T("uuid"),GEN_UUIDV7);
+      std::set<CString> keys;
+      CString previous;
+      for(int index = 0; index < 10000; ++index)
+      {
+        CString key = generator.NextKey().GetAsString();
+        Assert::AreEqual(36,key.GetLength());
+        Assert::AreEqual(_T('7'),key.GetAt(14));
+        Assert::IsTrue(CString(_T("89ab")).Find(key.GetAt(19)) >= 0);
+        Assert::IsTrue(previous < key);
+        Assert::IsTrue(keys.insert(key).second);
+        previous = key;
+      }
+    }
+
+    TEST_METHOD(T03_HiLo)
+    {
+      Logger::WriteMessage(_T("T03_HiLo: consecutive keys over the blocks of a sequence"));
+      OpenSession();
+      Execute(_T("DROP SEQUENCE test_hilo_seq"),true);
+      Execute(_T("CREATE SEQUENCE test_hilo_seq"));
+
+      CXGenerator generator(_T("test_hilo_seq"),GEN_HILO,1000,10);
+      generator.SetSession(m_session);
+
+      // Sequence value 1 gives the first block from 'start'
+      for(__int64 expected = 1000; expected < 1025; ++expected)
+      {
+        Assert::IsTrue(generator.NextKey().GetAsSBigInt() == expected);
+      }
+    }
+
+    TEST_METHOD(T04_Pooled)
+    {
+      Logger::WriteMessage(_T("T04_Pooled: blocks of an 'increment by' sequence, never below 'start'"));
+      OpenSession();
+      Execute(_T("DROP SEQUENCE test_pooled_seq"),true);
+      Execute(_T("CREATE SEQUENCE test_pooled_seq START WITH 1 INCREMENT BY 10"));
+
+      CXGenerator generator(_T("test_pooled_seq"),GEN_POOLED,5,10);
+      generator.SetSession(m_session);
+
+      __int64 previous = 0;
+      for(int index = 0; index < 25; ++index)
+      {
+        __int64 key = generator.NextKey().GetAsSBigInt();
+        Assert::IsTrue(key >= 5);
+        Assert::IsTrue(key > previous);
+        previous = key;
+      }
+    }
+
+    TEST_METHOD(T05_Table)
+    {
+      Logger::WriteMessage(_T("T05_Table: blocks from a keys table, the first one by an INSERT"));
+      OpenSession();
+      Execute(_T("CREATE TABLE test_keys (name varchar(100) not null primary key,next_value bigint)"),true);
+      Execute(_T("DELETE FROM test_keys WHERE name = 'test_table'"));
+
+      CXGenerator generator(_T("test_table"),GEN_TABLE,1000,10);
+      generator.SetTable(_T("test_keys"));
+      generator.SetSession(m_session);
+
+      for(__int64 expected = 1000; expected < 1025; ++expected)
+      {
+        Assert::IsTrue(generator.NextKey().GetAsSBigInt() == expected);
+      }
+      // Three blocks are taken
+      Assert::IsTrue(NextValue(_T("test_table")) == 1030);
+
+      // Another process with the same generator gets the next block
+      CXGenerator other(_T("test_table"),GEN_TABLE,1000,10);
+      other.SetTable(_T("test_keys"));
+      other.SetSession(m_session);
+      Assert::IsTrue(other.NextKey().GetAsSBigInt() == 1030);
+      Assert::IsTrue(generator.NextKey().GetAsSBigInt() == 1025);
+    }
+
+  private:
+    void Execute(CString p_sql,bool p_mayFail = false)
+    {
+      SQLAutoDBS database(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+      try
+      {
+        SQLQuery query(database);
+        query.DoSQLStatementNonQuery(p_sql);
+      }
+      catch(StdException& er)
+      {
+        if(!p_mayFail)
+        {
+          Logger::WriteMessage(er.GetErrorMessage());
+          Assert::Fail();
+        }
+      }
+    }
+
+    __int64 NextValue(CString p_name)
+    {
+      SQLAutoDBS database(*m_session->GetDatabasePool(),m_session->GetDatabaseConnection());
+      SQLQuery query(database);
+      SQLVariant name(p_name.GetString());
+      query.SetParameter(1,&name);
+      SQLVariant* value = query.DoSQLStatementScalar(_T("SELECT next_value FROM test_keys WHERE name = ?"));
+      return value ? value->GetAsSBigInt() : 0;
+    }
+
+    // Database session on the test database
+    void OpenSession()
+    {
+      if(m_session)
+      {
+        return;
+      }
+      try
+      {
+        m_session = hibernate.CreateSession();
+        m_session->SetDatabaseConnection(_T("hibtest"),_T("sysdba"),_T("altijd"));
+        return;
+      }
+      catch(StdException& er)
+      {
+        Logger::WriteMessage(er.GetErrorMessage());
+      }
+      Assert::Fail();
+    }
+
+    CXSession* m_session { nullptr };
+  };
+}
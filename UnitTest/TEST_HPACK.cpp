@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: TEST_HPACK.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include <CppUnitTest.h>
+#include <HPACK.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace HibernateTest
+{
+  // HPACK header compression of HTTP/2 against the examples of RFC 7541 Appendix C
+  TEST_CLASS(HPACKCodec)
+  {
+  public:
+    TEST_METHOD(T01_LiteralFields)
+    {
+      Logger::WriteMessage(_T("T01_LiteralFields: RFC 7541 C.2 header field representations"));
+
+      HPACKDecoder decoder;
+      HPACKHeaders headers;
+      // C.2.1 Literal header field with indexing
+      Assert::IsTrue(Decode(decoder,"400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572",headers));
+      Assert::IsTrue(headers.size() == 1);
+      CheckHeader(headers[0],"custom-key","custom-header");
+      // C.2.2 Literal header field without indexing
+      Assert::IsTrue(Decode(decoder,"040c 2f73 616d 706c 652f 7061 7468",headers));
+      CheckHeader(headers[0],":path","/sample/path");
+      // C.2.3 Literal header field never indexed
+      Assert::IsTrue(Decode(decoder,"1008 7061 7373 776f 7264 0673 6563 7265 74",headers));
+      CheckHeader(headers[0],"password","secret");
+      // C.2.4 Indexed header field
+      Assert::IsTrue(Decode(decoder,"82",headers));
+      CheckHeader(headers[0],":method","GET");
+    }
+
+    TEST_METHOD(T02_RequestsPlain)
+    {
+      Logger::WriteMessage(_T("T02_RequestsPlain: RFC 7541 C.3 requests without Huffman coding"));
+
+      const char* requests[3] =
+      {
+        "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"
+       ,"8286 84be 5808 6e6f 2d63 6163 6865"
+       ,"8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65"
+      };
+      CheckRequests(requests);
+    }
+
+    TEST_METHOD(T03_RequestsHuffman)
+    {
+      Logger::WriteMessage(_T("T03_RequestsHuffman: RFC 7541 C.4 requests with Huffman coding"));
+
+      const char* requests[3] =
+      {
+        "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"
+       ,"8286 84be 5886 a8eb 1064 9cbf"
+       ,"8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"
+      };
+      CheckRequests(requests);
+    }
+
+    TEST_METHOD(T04_EncoderRoundTrip)
+    {
+      Logger::WriteMessage(_T("T04_EncoderRoundTrip: our encoder against our decoder"));
+
+      HPACKEncoder encoder;
+      HPACKDecoder decoder;
+      HPACKHeaders request = { {":method","GET"},{":scheme","http"},{":path","/index.html"}
+                              ,{":authority","www.example.com"},{"custom-key","custom-value"} };
+      for(int round = 0; round < 2; ++round)
+      {
+        std::string block;
+        encoder.Encode(request,block);
+        HPACKHeaders headers;
+        Assert::IsTrue(decoder.Decode(reinterpret_cast<const unsigned char*>(block.data()),block.size(),headers));
+        Assert::IsTrue(headers == request);
+      }
+    }
+
+    TEST_METHOD(T05_HeaderListBomb)
+    {
+      Logger::WriteMessage(_T("T05_HeaderListBomb: indexed references to a large entry stop at the list size"));
+
+      HPACKDecoder decoder;
+      decoder.SetMaximumListSize(32 * 1024);
+
+      // One literal of 4000 bytes with indexing, then 128K references to it
+      std::string block;
+      HPACKEncodeInteger(block,0x40,6,0);
+      HPACKEncodeInteger(block,0x00,7,1);
+      block += "x";
+      HPACKEncodeInteger(block,0x00,7,4000);
+      block += std::string(4000,'a');
+      block += std::string(128 * 1024,(char)0xBE);
+
+      HPACKHeaders headers;
+      Assert::IsFalse(decoder.Decode(reinterpret_cast<const unsigned char*>(block.data()),block.size(),headers));
+      Assert::IsTrue(decoder.GetListTooLarge());
+      Assert::IsTrue(headers.size() <= 8);
+
+      // A corrupt block is a compression error, not a list that is too large
+      HPACKDecoder corrupt;
+      Assert::IsFalse(Decode(corrupt,"0085 ffff ffff ff00",headers));
+      Assert::IsFalse(corrupt.GetListTooLarge());
+    }
+
+  private:
+    // C.3 and C.4: three requests on one connection, sharing the dynamic table
+    void CheckRequests(const char* p_requests[3])
+    {
+      HPACKDecoder decoder;
+      HPACKHeaders headers;
+
+      Assert::IsTrue(Decode(decoder,p_requests[0],headers));
+      Assert::IsTrue(headers.size() == 4);
+      CheckHeader(headers[0],":method",   "GET");
+      CheckHeader(headers[1],":scheme",   "http");
+      CheckHeader(headers[2],":path",     "/");
+      CheckHeader(headers[3],":authority","www.example.com");
+
+      Assert::IsTrue(Decode(decoder,p_requests[1],headers));
+      Assert::IsTrue(headers.size() == 5);
+      CheckHeader(headers[3],":authority",   "www.example.com");
+      CheckHeader(headers[4],"cache-control","no-cache");
+
+      Assert::IsTrue(Decode(decoder,p_requests[2],headers));
+      Assert::IsTrue(headers.size() == 5);
+      CheckHeader(headers[0],":method",   "GET");
+      CheckHeader(headers[1],":scheme",   "https");
+      CheckHeader(headers[2],":path",     "/index.html");
+      CheckHeader(headers[3],":authority","www.example.com");
+      CheckHeader(headers[4],"custom-key","custom-value");
+    }
+
+    bool Decode(HPACKDecoder& p_decoder,const char* p_hex,HPACKHeaders& p_headers)
+    {
+      std::string block;
+      for(const char* pos = p_hex; *pos; ++pos)
+      {
+        if(isxdigit((unsigned char)pos[0]) && isxdigit((unsigned char)pos[1]))
+        {
+          block += (char)strtol(std::string(pos,2).c_str(),nullptr,16);
+          ++pos;
+        }
+      }
+      p_headers.clear();
+      return p_decoder.Decode(reinterpret_cast<const unsigned char*>(block.data()),block.size(),p_headers);
+    }
+
+    void CheckHeader(const HPACKHeader& p_header,const char* p_name,const char* p_value)
+    {
+      Assert::AreEqual(p_name, p_header.first.c_str());
+      Assert::AreEqual(p_value,p_header.second.c_str());
+    }
+  };
+}
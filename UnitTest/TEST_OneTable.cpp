@@ -205,6 +205,47 @@ namespace HibernateTest
       }
     }
 
+    TEST_METHOD(T07_UpdateVersionedPerson)
+    {
+      Logger::WriteMessage(_T("T07_UpdateVersionedPerson updates a person twice on the 'changed' version"));
+
+      try
+      {
+        OpenSession();
+
+        NaturalPerson* person = (NaturalPerson*) m_session->CreateObject(NaturalPerson::ClassName());
+        person->SetName(_T("Test person 2"));
+        person->SetFirstname(_T("Versioned"));
+        person->SetAccount_id(1);
+        Assert::IsTrue(m_session->Save(person));
+
+        // Two consecutive updates, the second one within the same second
+        // Each must find the version the previous one has written
+        SQLTimestamp previous = person->GetChanged();
+        for(int update = 2; update <= 3; ++update)
+        {
+          person->SetAccount_id(update);
+          Assert::IsTrue(m_session->Update(person));
+
+          SQLTimestamp changed = person->GetChanged();
+          Logger::WriteMessage(_T("Version         : ") + changed.AsString());
+          Assert::IsFalse(changed.IsNull());
+          Assert::AreEqual(0,changed.Fraction());
+          if(!previous.IsNull())
+          {
+            Assert::IsTrue(previous < changed);
+          }
+          previous = changed;
+        }
+        Assert::IsTrue(m_session->Delete(person));
+      }
+      catch(StdException& ex)
+      {
+        Logger::WriteMessage(ex.GetErrorMessage());
+        Assert::Fail();
+      }
+    }
+
     void PrintSubject(Subject* p_subject)
     {
       CString text;
@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////
+//
+// File: TEST_Streaming.cpp
+//
+// Copyright (c) 2015-2022 ir. W.E. Huisman
+// All rights reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of 
+// this software and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, including without limitation the rights 
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, 
+// and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Last version date: See CXHibernate.h
+// Version number:    See CXHibernate.h
+//
+#include "stdafx.h"
+#include <CppUnitTest.h>
+#include <HTTPMessage.h>
+#include <MultiPartStream.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace HibernateTest
+{
+  // Streaming of an incoming body to a body sink
+  TEST_CLASS(StreamingBody)
+  {
+  public:
+    TEST_METHOD(T01_StreamMultiPart)
+    {
+      Logger::WriteMessage(_T("T01_StreamMultiPart parses a form-data body in small chunks"));
+
+      HTTPMessage msg(HTTPCommand::http_post,_T("http://localhost/upload/"));
+      msg.SetBodySink(new MultiPartStream(m_contentType));
+      StreamBody(msg,7);
+
+      Assert::IsTrue(msg.EndBodySink(true));
+      Assert::IsTrue(msg.GetBodyStreamed() == strlen(m_body));
+      Assert::IsTrue(msg.GetBodyLength() == 0);
+
+      MultiPartStream* stream = dynamic_cast<MultiPartStream*>(msg.GetBodySink());
+      Assert::IsNotNull(stream);
+      Assert::IsTrue(stream->GetIsComplete());
+      CheckParts(stream);
+    }
+
+    TEST_METHOD(T02_AnswerAfterUpload)
+    {
+      Logger::WriteMessage(_T("T02_AnswerAfterUpload sends a body in the answer to a streamed upload"));
+
+      HTTPMessage msg(HTTPCommand::http_post,_T("http://localhost/upload/"));
+      msg.SetBodySink(new MultiPartStream(m_contentType));
+      StreamBody(msg,64);
+      Assert::IsTrue(msg.EndBodySink(true));
+
+      // Like a form-data handler: keep the parts and reset for the answer
+      MultiPartStream* stream = dynamic_cast<MultiPartStream*>(msg.DetachBodySink());
+      Assert::IsNotNull(stream);
+      msg.Reset();
+      Assert::IsNull(msg.GetBodySink());
+
+      char answer[] = "Upload received";
+      msg.AddBody(answer,(unsigned)strlen(answer));
+      Assert::IsTrue(msg.GetBodyLength() == strlen(answer));
+
+      CheckParts(stream);
+      delete stream;
+    }
+
+    TEST_METHOD(T03_ResetEndsSink)
+    {
+      Logger::WriteMessage(_T("T03_ResetEndsSink: the answer never goes to the sink of the request"));
+
+      HTTPMessage msg(HTTPCommand::http_post,_T("http://localhost/upload/"));
+      msg.SetBodySink(new MultiPartStream(m_contentType));
+      StreamBody(msg,16);
+      Assert::IsTrue(msg.EndBodySink(true));
+
+      msg.Reset();
+      Assert::IsNull(msg.GetBodySink());
+      Assert::IsTrue(msg.GetBodyStreamed() == 0);
+
+      char answer[] = "<html>OK</html>";
+      msg.AddBody(answer,(unsigned)strlen(answer));
+      Assert::IsTrue(msg.GetBodyLength() == strlen(answer));
+      Assert::IsTrue(msg.GetBodyStreamed() == 0);
+    }
+
+  private:
+    // Pass the body on as the network would: in chunks
+    void StreamBody(HTTPMessage& p_msg,size_t p_chunk)
+    {
+      size_t length = strlen(m_body);
+      for(size_t pos = 0; pos < length; pos += p_chunk)
+      {
+        size_t size = min(p_chunk,length - pos);
+        p_msg.AddBody((void*)&m_body[pos],(unsigned)size);
+      }
+    }
+
+    void CheckParts(MultiPartStream* p_stream)
+    {
+      MultiPartBuffer* buffer = p_stream->GetMultiPartBuffer();
+      Assert::IsTrue(buffer->GetParts() == 2);
+
+      MultiPart* first = buffer->GetPart(_T("first"));
+      Assert::IsNotNull(first);
+      Assert::AreEqual(_T("Hello world"),first->GetData().GetString());
+
+      MultiPart* second = buffer->GetPart(_T("second"));
+      Assert::IsNotNull(second);
+      Assert::AreEqual(_T("Line one\r\nLine two"),second->GetData().GetString());
+    }
+
+    XString     m_contentType { _T("multipart/form-data; boundary=----MarlinBoundary42") };
+    const char* m_body        { "------MarlinBoundary42\r\n"
+                                "Content-Disposition: form-data; name=\"first\"\r\n"
+                                "\r\n"
+                                "Hello world\r\n"
+                                "------MarlinBoundary42\r\n"
+                                "Content-Disposition: form-data; name=\"second\"\r\n"
+                                "Content-Type: text/plain\r\n"
+                                "\r\n"
+                                "Line one\r\nLine two\r\n"
+                                "------MarlinBoundary42--\r\n" };
+  };
+}
@@ -149,6 +149,8 @@ void WriteInterfaceClass(FILE* p_file,CXClass* p_class)
   _ftprintf(p_file,_T("\n"));
   _ftprintf(p_file,_T("  // Serialization of our persistent objects\n"));
   _ftprintf(p_file,_T("  DECLARE_CXO_SERIALIZATION;\n"));
+  _ftprintf(p_file,_T("  // Ordinal bound de-serialization of result sets\n"));
+  _ftprintf(p_file,_T("  DECLARE_CXO_ORDINALS(%s);\n"),classname.GetString());
   _ftprintf(p_file,_T("\n"));
 }
 
@@ -504,6 +506,29 @@ void PrintCXHDeSerialize(FILE* p_file,CXClass* p_class,CString p_type)
   _ftprintf(p_file,_T("\n"));
 }
 
+// Columns in the same sequence as the name based DBS_DESERIALIZE
+void PrintCXHOrdinals(FILE* p_file,CXClass* p_class)
+{
+  CString classname = p_class->GetName();
+  CString superclass = p_class->GetSuperClass() ? p_class->GetSuperClass()->GetName() : CString(_T("CXObject"));
+
+  _ftprintf(p_file,_T("BEGIN_DBS_ORDINALS(%s,%s)\n"),classname.GetString(),superclass.GetString());
+
+  int index = 0;
+  CXAttribute* attribute = p_class->FindAttribute(index);
+  while(attribute)
+  {
+    _ftprintf(p_file,_T("  CXO_DBS_ORDINAL(%-18s,%-18s);\n")
+                  , (_T("m_") + attribute->GetName()).GetString()
+                  , (_T("_T(\"") + attribute->GetDatabaseColumn() + _T("\")")).GetString());
+
+    // Next attribute
+    attribute = p_class->FindAttribute(++index);
+  }
+  _ftprintf(p_file,_T("END_DBS_ORDINALS\n"));
+  _ftprintf(p_file,_T("\n"));
+}
+
 void PrintGenDeSerialize(FILE* p_file,CXClass* p_class)
 {
   CXAttribute* gen = p_class->FindGenerator();
@@ -557,6 +582,7 @@ void WriteCXHFile(CXClass* p_class)
   PrintCXHDeSerialize(file, p_class,_T("XML_DE"));
   PrintCXHDeSerialize(file, p_class,_T("DBS_"));
   PrintCXHDeSerialize(file, p_class,_T("DBS_DE"));
+  PrintCXHOrdinals   (file, p_class);
   PrintGenDeSerialize(file, p_class);
   PrintCXHFactory    (file, p_class);
 